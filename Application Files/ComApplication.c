@@ -24,6 +24,12 @@
 //
 //////////
 
+// AttachConsole needs Windows XP
+#if defined(_WIN32) && (!defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0501))
+#undef _WIN32_WINNT
+#define _WIN32_WINNT				0x0501
+#endif
+
 #include "ComApplication.h"
 #include "QTDataEx.h"
 
@@ -39,6 +45,9 @@ extern ICMProgressUPP				gImageProgressProcUPP;		// UPP to our custom image prog
 extern UserItemUPP					gProgressUserItemProcUPP;	// UPP to our custom progress dialog user item procedure
 
 extern StringPtr					gSettingsFileName;			// the name of our settings preferences file
+#if USE_SETTINGS_CACHE
+extern QTSetCachePtr				gSettingsCache;				// exporter settings we've already read from settings files
+#endif
 extern OSType 						*gValidFileTypes;			// the list of file types that our application can open
 
 #if TARGET_OS_MAC
@@ -67,6 +76,8 @@ extern HWND				ghWnd;									// the MDI frame window; this window has the menu
 
 void QTApp_Init (UInt32 theStartPhase)
 {
+	char			myPath[kQTSysMaxPath];
+
 	// do any start-up activities that should occur before the MDI frame window is created
 	if (theStartPhase & kInitAppPhase_BeforeCreateFrameWindow) {
 #if TARGET_OS_MAC
@@ -87,13 +98,200 @@ void QTApp_Init (UInt32 theStartPhase)
 		gProgressUserItemProcUPP = NewUserItemUPP(QTDX_ProgressBoxUserItemProcedure);
 		
 		gSettingsFileName = QTUtils_ConvertCToPascalString(kSettingsFileName);
+#if USE_SETTINGS_CACHE
+		QTSet_NewCache(kSettingsCacheCapacity, QTDX_DisposeCachedSettings, &gSettingsCache);
+#endif
 		
-		if (gValidFileTypes == NULL)
-			QTFrame_BuildFileTypeList();
+		// read the rates of earlier operations, so time estimates can start from them
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_ReadHistory(myPath);
+
+		// we don't build the list of file types we can open here; whoever first needs it builds it
+	}
+}
+
+
+//////////
+//
+// QTApp_RunHeadless
+// Run one of the application's headless (no user interface) modes, if the command line asks for one.
+//
+// Return true if a headless mode ran, in which case theExitCode holds the process exit code and the
+// framework quits without creating any windows; return false to start up normally.
+//
+//////////
+
+Boolean QTApp_RunHeadless (int theArgc, char *theArgv[], int *theExitCode)
+{
+	char			myPath[kQTSysMaxPath];
+#if TARGET_OS_WIN32
+	int				myIndex;
+#endif
+
+	// we're called before anything else, headless or not, and before there are any threads; the estimators
+	// of exports, hinting and imports on other threads share one history
+	QTEst_InitHistory();
+
+#if TARGET_OS_WIN32
+	// every headless mode is chosen by a switch; only then may there be something to write to a console
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (theArgv[myIndex][0] == '-') {
+			QTApp_AttachParentConsole();
+			break;
+		}
+#endif
+
+	// reference imports estimate the time they save from the rates of earlier conversions
+	if (QTBatch_IsBatchCommandLine(theArgc, theArgv)) {
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_ReadHistory(myPath);
+
+		*theExitCode = QTBatch_Main(theArgc, theArgv, QTDX_GetBatchImporter());
+
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_WriteHistory(myPath);
+		return(true);
+	}
+
+	// exports and hinting estimate their jobs from, and add to, the same history
+	if (QTSched_IsSchedulerCommandLine(theArgc, theArgv)) {
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_ReadHistory(myPath);
+
+		*theExitCode = QTSched_Main(theArgc, theArgv, QTDX_GetSchedulerExporter());
+
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_WriteHistory(myPath);
+		return(true);
+	}
+
+	if (QTHint_IsHintCommandLine(theArgc, theArgv)) {
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_ReadHistory(myPath);
+
+		*theExitCode = QTHint_Main(theArgc, theArgv);
+
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_WriteHistory(myPath);
+		return(true);
+	}
+
+	if (QTSet_IsSettingsCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTSet_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTReg_IsRegistryCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTReg_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTProbe_IsProbeCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTProbe_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTStbl_IsFrameCountCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTStbl_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTProg_IsProgressCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTProg_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTPre_IsLadderCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTPre_Main(theArgc, theArgv, QTDX_GetLadderRenderer());
+		return(true);
+	}
+
+	if (QTRemux_IsRemuxCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTRemux_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTUpd_IsUpdateCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTUpd_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTTag_IsTagCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTTag_Main(theArgc, theArgv);
+		return(true);
 	}
+
+	if (QTCmd_IsOpenCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTCmd_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTScan_IsScanCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTScan_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	// a reference import converts nothing in full, so it has no rate to add to the history; it only reads the
+	// rates that batch imports have recorded, and until there are some, it reports no estimate of the time saved
+	if (QTRef_IsReferenceCommandLine(theArgc, theArgv)) {
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_ReadHistory(myPath);
+
+		*theExitCode = QTRef_Main(theArgc, theArgv, kBatchImportOperation);
+		return(true);
+	}
+
+	if (QTSeq_IsSequenceCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTSeq_Main(theArgc, theArgv, QTDX_GetSequenceImporter());
+		return(true);
+	}
+
+	if (QTSwap_IsSwapCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTSwap_Main(theArgc, theArgv);
+		return(true);
+	}
+
+	if (QTEst_IsStringCheckCommandLine(theArgc, theArgv)) {
+		*theExitCode = QTEst_StringCheckMain(theArgc, theArgv, QTDX_CheckStrings);
+		return(true);
+	}
+
+	return(false);
 }
 
 
+#if TARGET_OS_WIN32
+//////////
+//
+// QTApp_AttachParentConsole
+// Send our standard output and standard error to the console of the program that started us, if it has one.
+//
+// QTDataEx is a Windows application, not a console application, so when it's run from a command prompt or a
+// batch file it gets no console, and what the headless modes write to stdout and stderr would go nowhere.
+// A stream that the command line redirected to a file or a pipe is left alone.
+//
+//////////
+
+void QTApp_AttachParentConsole (void)
+{
+	Boolean			myHasOutput = (GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) != FILE_TYPE_UNKNOWN);
+	Boolean			myHasError = (GetFileType(GetStdHandle(STD_ERROR_HANDLE)) != FILE_TYPE_UNKNOWN);
+	FILE			*myFile = NULL;
+
+	if (myHasOutput && myHasError)
+		return;
+
+	if (!AttachConsole(ATTACH_PARENT_PROCESS))
+		return;
+
+	if (!myHasOutput)
+		freopen_s(&myFile, "CONOUT$", "w", stdout);
+	if (!myHasError)
+		freopen_s(&myFile, "CONOUT$", "w", stderr);
+}
+#endif
+
+
 //////////
 //
 // QTApp_Stop
@@ -106,12 +304,31 @@ void QTApp_Init (UInt32 theStartPhase)
 
 void QTApp_Stop (UInt32 theStopPhase)
 {	
+	char			myPath[kQTSysMaxPath];
+#if USE_SETTINGS_CACHE
+	QTSetCacheStatsRecord	myStats;
+#endif
+
 	// do any shut-down activities that should occur before the movie windows are destroyed
 	if (theStopPhase & kStopAppPhase_BeforeDestroyWindows) {
 		DisposeMovieProgressUPP(gMovieProgressProcUPP);
 		DisposeICMProgressUPP(gImageProgressProcUPP);
 		DisposeUserItemUPP(gProgressUserItemProcUPP);
 		free(gSettingsFileName);
+#if USE_SETTINGS_CACHE
+		// how well the cache did is worth knowing when tuning kSettingsCacheCapacity
+		if (QTSys_IsTracing()) {
+			QTDX_GetSettingsCacheStats(&myStats);
+			QTSys_Trace("{\"trace\":\"settingsCache\",\"hits\":%llu,\"misses\":%llu,\"invalidations\":%llu,\"evictions\":%llu,\"entries\":%ld}",
+						(unsigned long long)myStats.fHits, (unsigned long long)myStats.fMisses, (unsigned long long)myStats.fInvalidations,
+						(unsigned long long)myStats.fEvictions, myStats.fEntryCount);
+		}
+		QTSet_DisposeCache(gSettingsCache);
+		gSettingsCache = NULL;
+#endif
+		
+		if (QTDX_GetEstimateHistoryPath(myPath, sizeof(myPath)) == noErr)
+			QTEst_WriteHistory(myPath);
 	}
 	
 	// do any shut-down activities that should occur after the movie windows are destroyed
@@ -310,7 +527,7 @@ Boolean QTApp_HandleMenu (UInt16 theMenuItem)
 			break;
 			
 		case IDM_EXPORT_AS_HINTED:
-			QTDX_ExportMovieAsHintedMovie(myMovie, true);
+			QTDX_ExportMovieAsHintedMovie(myMovie, &(**myWindowObject).fFileFSSpec, true);
 			myIsHandled = true;
 			break;
 			
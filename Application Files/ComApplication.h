@@ -91,4 +91,8 @@ PASCAL_RTN OSErr		QTApp_HandlePrintDocumentAppleEvent (const AppleEvent *theMess
 PASCAL_RTN OSErr		QTApp_HandleQuitApplicationAppleEvent (const AppleEvent *theMessage, AppleEvent *theReply, long theRefcon);
 #endif	// TARGET_OS_MAC
 
+#if TARGET_OS_WIN32
+void					QTApp_AttachParentConsole (void);
+#endif
+
 // the other function prototypes are in the file MacFramework.h or WinFramework.h
\ No newline at end of file
@@ -86,5 +86,8 @@
 #define IDI_APPICON                     101
 #define IDI_CHILDICON                   102
 #define IDD_ABOUT                       103
+#define IDD_HINTSETTINGS                104
+#define IDC_HINTPACKETSIZE              1001
+#define IDC_HINTPAYLOADTYPE             1002
 
 
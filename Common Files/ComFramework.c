@@ -86,6 +86,12 @@
 Rect					gMCResizeBounds;						// maximum size for any movie window
 Handle 					gValidFileTypes = NULL;					// the list of file types that our application can open
 long					gFirstGITypeIndex;						// the index in gValidFileTypes of the first graphics importer file type
+QTTypeRegistryPtr		gFileTypeRegistry = NULL;				// the same file types (and extensions), indexed for quick lookup
+
+// the constant strings we give to the Toolbox, as Pascal strings built by the compiler
+QTUTILS_DEFINE_PSTRING(gNewMovieName, kNewMovieName);
+QTUTILS_DEFINE_PSTRING(gSavePrompt, kSavePrompt);
+QTUTILS_DEFINE_PSTRING(gSaveMovieFileName, kSaveMovieFileName);
 
 #if TARGET_OS_WIN32
 extern HWND				ghWnd;
@@ -372,16 +378,13 @@ Boolean QTFrame_CreateNewMovie (void)
 {
 	Movie				myMovie = NULL;
 	FSSpec				myFSSpec;
-	StringPtr 			myName = QTUtils_ConvertCToPascalString(kNewMovieName);
 	
 	myMovie = NewMovie(newMovieActive);
 	if (myMovie == NULL)
 		return(false);
 	
 	// create a default FSSpec
-	FSMakeFSSpec(0, 0L, myName, &myFSSpec);
-	
-	free(myName);
+	FSMakeFSSpec(0, 0L, QTUTILS_PSTRING(gNewMovieName), &myFSSpec);
 	
 	return(QTFrame_OpenMovieInWindow(myMovie, &myFSSpec));
 }
@@ -675,8 +678,8 @@ OSErr QTFrame_SaveAsMovieFile (WindowReference theWindow)
 	FSSpec				myFile;
 	Boolean				myIsSelected = false;
 	Boolean				myIsReplacing = false;	
-	StringPtr 			myPrompt = QTUtils_ConvertCToPascalString(kSavePrompt);
-	StringPtr 			myFileName = QTUtils_ConvertCToPascalString(kSaveMovieFileName);
+	ConstStringPtr		myPrompt = QTUTILS_PSTRING(gSavePrompt);
+	ConstStringPtr		myFileName = QTUTILS_PSTRING(gSaveMovieFileName);
 	OSErr				myErr = paramErr;
 	
 	// get the window object associated with the specified window
@@ -710,43 +713,57 @@ OSErr QTFrame_SaveAsMovieFile (WindowReference theWindow)
 				goto bail;
 		}
 		
-		myNewMovie = FlattenMovieData(	myMovie,
-										flattenAddMovieToDataFork | flattenForceMovieResourceBeforeMovieData,
-										&myFile,
-										FOUR_CHAR_CODE('TVOD'),
-										smSystemScript,
-										createMovieFileDeleteCurFile | createMovieFileDontCreateResFile);
-		myErr = GetMoviesError();
-		if ((myNewMovie == NULL) || (myErr != noErr))
-			goto bail;
+#if USE_FAST_START_FLATTENER
+		// a movie that is just what's in its movie file can be flattened by copying the file's samples;
+		// that gives us the new movie directly, so we don't need to read it back from the new file
+		if (QTFrame_FlattenMovieFile(myWindowObject, &myFile, &myNewMovie) == noErr) {
+			myErr = OpenMovieFile(&myFile, &myRefNum, fsRdWrPerm);
+			if (myErr != noErr) {
+				DisposeMovie(myNewMovie);
+				goto bail;
+			}
+		}
+#endif
 
-		// FlattenMovieData creates a new movie file and returns the movie to us; but it doesn't
-		// return the file reference number or the movie resource ID, which we want to have; so
-		// we will dump the movie returned by FlattenMovieData and open the movie file ourselves
-		DisposeMovie(myNewMovie);
+		if (myNewMovie == NULL) {
+			myNewMovie = FlattenMovieData(	myMovie,
+											flattenAddMovieToDataFork | flattenForceMovieResourceBeforeMovieData,
+											&myFile,
+											FOUR_CHAR_CODE('TVOD'),
+											smSystemScript,
+											createMovieFileDeleteCurFile | createMovieFileDontCreateResFile);
+			myErr = GetMoviesError();
+			if ((myNewMovie == NULL) || (myErr != noErr))
+				goto bail;
 
-		// also, on MacOS, FlattenMovieData *always* creates a resource fork, even if we told it
-		// not to do so (didn't we say "createMovieFileDontCreateResFile"?); so we'll explicitly
-		// delete the resource fork now....
+			// FlattenMovieData creates a new movie file and returns the movie to us; but it doesn't
+			// return the file reference number or the movie resource ID, which we want to have; so
+			// we will dump the movie returned by FlattenMovieData and open the movie file ourselves
+			DisposeMovie(myNewMovie);
+
+			// also, on MacOS, FlattenMovieData *always* creates a resource fork, even if we told it
+			// not to do so (didn't we say "createMovieFileDontCreateResFile"?); so we'll explicitly
+			// delete the resource fork now....
 #if TARGET_OS_MAC
-		myErr = FSpOpenRF(&myFile, fsRdWrPerm, &myRefNum);
-		if (myErr == noErr) {
-			SetEOF(myRefNum, 0L);
-			FSClose(myRefNum);
-		}
+			myErr = FSpOpenRF(&myFile, fsRdWrPerm, &myRefNum);
+			if (myErr == noErr) {
+				SetEOF(myRefNum, 0L);
+				FSClose(myRefNum);
+			}
 #endif
-		
-		myErr = OpenMovieFile(&myFile, &myRefNum, fsRdWrPerm);
-		if (myErr != noErr)
-			goto bail;
+			
+			myErr = OpenMovieFile(&myFile, &myRefNum, fsRdWrPerm);
+			if (myErr != noErr)
+				goto bail;
 
-		// TO DO: use QTInfo_MakeFilePreview here, which doesn't always create a resource fork
-//		MakeFilePreview(myRefNum, (ICMProgressProcRecordPtr)-1);
+			// TO DO: use QTInfo_MakeFilePreview here, which doesn't always create a resource fork
+//			MakeFilePreview(myRefNum, (ICMProgressProcRecordPtr)-1);
 
-		// get the new movie from the file
-		myErr = NewMovieFromFile(&myNewMovie, myRefNum, &myResID, NULL, newMovieActive, NULL);		
-		if (myErr != noErr)
-			goto bail;
+			// get the new movie from the file
+			myErr = NewMovieFromFile(&myNewMovie, myRefNum, &myResID, NULL, newMovieActive, NULL);		
+			if (myErr != noErr)
+				goto bail;
+		}
 
 		// create a new movie controller
 		myMC = QTFrame_SetupController(myNewMovie, theWindow, false);
@@ -787,13 +804,94 @@ OSErr QTFrame_SaveAsMovieFile (WindowReference theWindow)
 	}
 
 bail:
-	free(myPrompt);
-	free(myFileName);
-	
 	return(myErr);
 }
 
 
+#if USE_FAST_START_FLATTENER
+//////////
+//
+// QTFrame_FlattenMovieFile
+// Flatten the movie in the specified window object into a new fast-start movie file, and return the new movie.
+//
+// FlattenMovieData has to write the movie data before it knows how big the movie atom will be, so it
+// writes the file, rewrites it with the movie atom first, and hands back a movie that we then throw away
+// and read back from the file. If the movie is just what's in its movie file, QTRemux_RemuxFile can
+// instead copy the file's samples in one pass behind a movie atom whose size it works out beforehand,
+// and give us that movie atom, from which we make the new movie. Any other movie gets paramErr, and
+// the caller falls back to FlattenMovieData.
+//
+//////////
+
+static OSErr QTFrame_FlattenMovieFile (WindowObject theWindowObject, FSSpecPtr theFSSpecPtr, Movie *theNewMovie)
+{
+	Movie					myMovie = (**theWindowObject).fMovie;
+	QTAtomBufferRecord		myMovieAtom;
+	Handle					myHandle = NULL;
+	AliasHandle				myAlias = NULL;
+	Boolean					myFileCreated = false;
+	char					myInPath[kQTSysMaxPath];
+	char					myOutPath[kQTSysMaxPath];
+	OSErr					myErr = noErr;
+
+	*theNewMovie = NULL;
+	QTAtom_InitBuffer(&myMovieAtom);
+
+	// the movie must have come from the data fork of a movie file, and not have changed since
+	if (((**theWindowObject).fFileRefNum == kInvalidFileRefNum) || ((**theWindowObject).fFileResID != movieInDataForkResID))
+		return(paramErr);
+
+	if ((**theWindowObject).fIsDirty || HasMovieChanged(myMovie))
+		return(paramErr);
+
+	myErr = FSSpecToNativePathName(&(**theWindowObject).fFileFSSpec, myInPath, sizeof(myInPath), kFullNativePath);
+	if (myErr == noErr)
+		myErr = FSSpecToNativePathName(theFSSpecPtr, myOutPath, sizeof(myOutPath), kFullNativePath);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTRemux_RemuxFile(myInPath, myOutPath, kRemuxFastStart, &myMovieAtom, NULL);
+	if (myErr != noErr)
+		goto bail;
+
+	myFileCreated = true;
+
+	// make the new movie from its movie atom; its tracks refer to their own file, so tell it which file that is
+	myErr = PtrToHand(myMovieAtom.fData, &myHandle, (long)myMovieAtom.fSize);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = NewMovieFromHandle(theNewMovie, myHandle, newMovieActive, NULL);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTNewAlias(theFSSpecPtr, &myAlias, true);
+	if (myErr == noErr)
+		myErr = SetMovieDefaultDataRef(*theNewMovie, (Handle)myAlias, rAliasType);
+
+bail:
+	if ((myErr != noErr) && (*theNewMovie != NULL)) {
+		DisposeMovie(*theNewMovie);
+		*theNewMovie = NULL;
+	}
+
+	// let FlattenMovieData start afresh
+	if ((myErr != noErr) && myFileCreated)
+		FSpDelete(theFSSpecPtr);
+
+	if (myAlias != NULL)
+		DisposeHandle((Handle)myAlias);
+
+	if (myHandle != NULL)
+		DisposeHandle(myHandle);
+
+	QTAtom_DisposeBuffer(&myMovieAtom);
+
+	return(myErr);
+}
+#endif
+
+
 //////////
 //
 // QTFrame_UpdateMovieFile
@@ -821,8 +919,14 @@ Boolean QTFrame_UpdateMovieFile (WindowReference theWindow)
 	
 	if ((**myWindowObject).fFileRefNum == kInvalidFileRefNum)		// brand new movie, so no file attached to it
 		myErr = QTFrame_SaveAsMovieFile(theWindow);
-	else															// we have an existing file; just update the movie resource
-		myErr = UpdateMovieResource(myMovie, (**myWindowObject).fFileRefNum, (**myWindowObject).fFileResID, NULL);
+	else {															// we have an existing file; just update the movie resource
+#if USE_INCREMENTAL_MOVIE_UPDATE
+		// fall back only if we still have the file open; if we couldn't reopen it, the save has failed
+		myErr = QTFrame_UpdateMovieAtom(myWindowObject);
+		if ((myErr != noErr) && ((**myWindowObject).fFileRefNum != kInvalidFileRefNum))
+#endif
+			myErr = UpdateMovieResource(myMovie, (**myWindowObject).fFileRefNum, (**myWindowObject).fFileResID, NULL);
+	}
 	
 	// TO DO: use QTInfo_MakeFilePreview here, which doesn't always create a resource fork
 	//MakeFilePreview((**myWindowObject).fFileRefNum, (ICMProgressProcRecordPtr)-1);
@@ -833,6 +937,86 @@ Boolean QTFrame_UpdateMovieFile (WindowReference theWindow)
 }
 
 
+#if USE_INCREMENTAL_MOVIE_UPDATE
+//////////
+//
+// QTFrame_UpdateMovieAtom
+// Save the movie in the specified window object into its movie file by replacing just the movie atom.
+//
+// UpdateMovieResource rewrites the whole movie atom at the end of the file whatever has changed, and
+// for a movie whose data follows its movie atom, it can't put it back where it was. QTUpd_UpdateMovieAtom
+// writes only the bytes that differ when the movie atom is the same size, as it is after a change to the
+// looping state; otherwise it writes it where it was, if it fits, or at the end. Either way, it doesn't
+// read or move the movie data. Any movie that isn't in the data fork of its file gets paramErr, and the
+// caller falls back to UpdateMovieResource.
+//
+// We close the movie file while we write it. If we can't open it again, we return that error even if the
+// update worked, and the window object is left with no file; the caller mustn't fall back then.
+//
+//////////
+
+static OSErr QTFrame_UpdateMovieAtom (WindowObject theWindowObject)
+{
+	Movie					myMovie = (**theWindowObject).fMovie;
+	Handle					myHandle = NULL;
+	AliasHandle				myAlias = NULL;
+	short					myRefNum = kInvalidFileRefNum;
+	char					myPath[kQTSysMaxPath];
+	OSErr					myOpenErr = noErr;
+	OSErr					myErr = noErr;
+
+	if ((**theWindowObject).fFileResID != movieInDataForkResID)
+		return(paramErr);
+
+	myErr = FSSpecToNativePathName(&(**theWindowObject).fFileFSSpec, myPath, sizeof(myPath), kFullNativePath);
+	if (myErr != noErr)
+		goto bail;
+
+	// get the movie atom as UpdateMovieResource would write it, with the tracks' data in this same file
+	myErr = QTNewAlias(&(**theWindowObject).fFileFSSpec, &myAlias, true);
+	if (myErr != noErr)
+		goto bail;
+
+	myHandle = NewHandle(0);
+	if (myHandle == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = PutMovieForDataRefIntoHandle(myMovie, (Handle)myAlias, rAliasType, myHandle);
+	if (myErr != noErr)
+		goto bail;
+
+	// we write the file ourselves, so let go of it until we're done
+	CloseMovieFile((**theWindowObject).fFileRefNum);
+	(**theWindowObject).fFileRefNum = kInvalidFileRefNum;
+
+	HLock(myHandle);
+	myErr = QTUpd_UpdateMovieAtom(myPath, *myHandle, (UInt32)GetHandleSize(myHandle), NULL);
+	HUnlock(myHandle);
+
+	myOpenErr = OpenMovieFile(&(**theWindowObject).fFileFSSpec, &myRefNum, fsRdWrPerm);
+	if (myOpenErr == noErr)
+		(**theWindowObject).fFileRefNum = myRefNum;
+
+	if (myErr == noErr)
+		ClearMovieChanged(myMovie);
+
+	if (myOpenErr != noErr)
+		myErr = myOpenErr;
+
+bail:
+	if (myHandle != NULL)
+		DisposeHandle(myHandle);
+
+	if (myAlias != NULL)
+		DisposeHandle((Handle)myAlias);
+
+	return(myErr);
+}
+#endif
+
+
 //////////
 //
 // QTFrame_IdleMovieWindows
@@ -1590,11 +1774,11 @@ void QTFrame_SetWindowTitleFromFSSpec (WindowReference theWindow, FSSpecPtr theF
 	SetWTitle(theWindow, theFSSpecPtr->name);
 #endif
 #if TARGET_OS_WIN32
-	char	*myTempName;
+	char	myTempName[256];
 	char	myWindName[MAX_PATH];
 
 	// get the full pathname contained in the FSSpec (which is a Str255)
-	myTempName = QTUtils_ConvertPascalToCString(theFSSpecPtr->name);
+	QTUtils_CopyPascalToCString(theFSSpecPtr->name, myTempName);
 
 	// get the movie file name from the full pathname
 	QTFrame_GetDisplayName(myTempName, MAX_PATH, myWindName);
@@ -1605,8 +1789,6 @@ void QTFrame_SetWindowTitleFromFSSpec (WindowReference theWindow, FSSpecPtr theF
 	// add this document to the Documents list, if so instructed
 	if (theAddToRecentDocs)
 		SHAddToRecentDocs(SHARD_PATH, myTempName);
-	
-	free(myTempName);
 #endif
 }
 
@@ -1935,18 +2117,9 @@ PASCAL_RTN Boolean QTFrame_FilterFiles (AEDesc *theItem, void *theInfo, void *th
 	if (theItem->descriptorType == typeFSS) {
 		if (!myInfo->isFolder) {
 			OSType			myType = myInfo->fileAndFolder.fileInfo.finderInfo.fdType;
-			OSType			*myTypes = (OSType *)*gValidFileTypes;
-			short			myCount;
-			short			myIndex;
 			
-			// see whether the file type is in the list of file types that our application can open 
-			myCount = GetHandleSize(gValidFileTypes) / sizeof(OSType);
-			for (myIndex = 0; myIndex < myCount; myIndex++)
-				if (myType == myTypes[myIndex])
-					return(true);
-
-			// if we got to here, it's a file we cannot open
-			return(false);		
+			// see whether the file type is one that our application can open
+			return(QTReg_LookupFileType(gFileTypeRegistry, myType, NULL));
 		}
 	}
 	
@@ -1968,39 +2141,137 @@ PASCAL_RTN Boolean QTFrame_FilterFiles (CInfoPBPtr thePBPtr)
 // QTFrame_BuildFileTypeList
 // Build a list of file types that QuickTime can open.
 //
+// We also build gFileTypeRegistry, which holds the same file types (plus the file name extensions
+// that movie importers declare) in a hash table; file filters should look types up there instead of
+// scanning gValidFileTypes, which can hold several hundred types.
+//
+// Nobody calls this function at startup any more; whoever first needs the list builds it. And the list
+// usually comes from a cache file rather than from the importer components; see QTFrame_LoadFileTypeRegistry.
+//
 //////////
 
 OSErr QTFrame_BuildFileTypeList (void)
 {
-	long		myIndex = 0;
-	OSType		*myTypes;
+	OSErr				myErr = noErr;
 
 	// if we've already built the list, just return
-	if (gValidFileTypes != NULL)
+	if ((gValidFileTypes != NULL) && (gFileTypeRegistry != NULL))
 		return(noErr);
 	
-	// allocate a block of memory to hold a preset number of file types; we'll resize this block
-	// while building the list if we need more room; we always resize it after building the list,
-	// to truncate it to the exact size required
-	gValidFileTypes = NewHandleClear(sizeof(OSType) * kDefaultFileTypeCount);
+	if (gFileTypeRegistry == NULL)
+		myErr = QTFrame_LoadFileTypeRegistry();
+	
+	if ((myErr == noErr) && (gValidFileTypes == NULL))
+		myErr = QTFrame_FillFileTypeList();
+	
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFrame_LoadFileTypeRegistry
+// Build gFileTypeRegistry, from the cache file if we can and from the importer components if we must.
+//
+// Asking every movie importer and graphics importer for its file types takes a noticeable time when many
+// of them are installed, so we save the result in a cache file and read it back at the next launch. The
+// cache file is tagged with a fingerprint of the installed components (see QTFrame_GetComponentFingerprint);
+// if they've changed, we ignore the cache, ask the components, and write a new cache.
+//
+// If tracing is turned on, we note how long this took and where the file types came from.
+//
+//////////
+
+static OSErr QTFrame_LoadFileTypeRegistry (void)
+{
+	QTRegBuilderRecord	myBuilder;
+	char				myCachePath[kQTSysMaxPath];
+	Boolean				myHaveCachePath;
+	QTUInt64			myFingerprint;
+	QTUInt64			myStartTime = QTSys_GetMicroseconds();
+	Boolean				myFromCache;
+	OSErr				myErr = noErr;
+
+	myFingerprint = QTFrame_GetComponentFingerprint();
+	myHaveCachePath = (QTFrame_GetFileTypeCachePath(myCachePath, sizeof(myCachePath)) == noErr);
+	
+	// a missing, damaged, or stale cache file leaves gFileTypeRegistry set to NULL
+	if (myHaveCachePath)
+		myErr = QTReg_ReadCache(myCachePath, myFingerprint, &gFileTypeRegistry);
+	
+	myFromCache = (gFileTypeRegistry != NULL);
+	
+	if ((myErr == noErr) && !myFromCache) {
+		QTReg_InitBuilder(&myBuilder);
+
+		// we can open any files of type kQTFileTypeMovie
+		QTReg_AddFileType(&myBuilder, kQTFileTypeMovie, kRegNoImporter, 0, 0);
+		
+		// we can open any files for which QuickTime supplies a movie importer component
+		QTFrame_AddComponentFileTypes(MovieImportType, &myBuilder);
+		
+		// we can open any files for which QuickTime supplies a graphics importer component
+		QTFrame_AddComponentFileTypes(GraphicsImporterComponentType, &myBuilder);
+		
+		// freeze the registry; it never changes after this
+		myErr = QTReg_NewRegistry(&myBuilder, &gFileTypeRegistry);
+		
+		QTReg_DisposeBuilder(&myBuilder);
+		
+		// if we can't write the cache file, we'll just have to ask the components again next time
+		if ((myErr == noErr) && myHaveCachePath)
+			QTReg_WriteCache(myCachePath, gFileTypeRegistry, myFingerprint);
+	}
+	
+	QTSys_Trace("{\"trace\":\"startup\",\"event\":\"filetypes\",\"source\":\"%s\",\"entries\":%ld,\"err\":%d,\"microseconds\":%llu}",
+				myFromCache ? "cache" : "components", QTReg_GetEntryCount(gFileTypeRegistry), myErr, QTSys_GetMicroseconds() - myStartTime);
+	
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFrame_FillFileTypeList
+// Fill gValidFileTypes with the file types in gFileTypeRegistry.
+//
+// The registry keeps its entries in the order they were added, so kQTFileTypeMovie comes first and the
+// movie importer file types come before the graphics importer file types, just as they always have; a
+// type that several components can open appears only once.
+//
+//////////
+
+static OSErr QTFrame_FillFileTypeList (void)
+{
+	const QTRegEntryRecord	*myEntries = QTReg_GetEntries(gFileTypeRegistry);
+	long					myCount = QTReg_GetEntryCount(gFileTypeRegistry);
+	long					myIndex;
+	long					myNumTypes = 0;
+	OSType					*myTypes;
+	
+	// allocate room for every entry; we truncate the block once we know how many are file types
+	gValidFileTypes = NewHandleClear(sizeof(OSType) * (myCount + 1));
 	if (gValidFileTypes == NULL)
 		return(memFullErr);
 	
 	myTypes = (OSType *)*gValidFileTypes;
+	gFirstGITypeIndex = -1;
 	
-	// we can open any files of type kQTFileTypeMovie
-	myTypes[myIndex++] = kQTFileTypeMovie;
-	
-	// we can open any files for which QuickTime supplies a movie importer component
-	QTFrame_AddComponentFileTypes(MovieImportType, &myIndex);
+	for (myIndex = 0; myIndex < myCount; myIndex++) {
+		if (myEntries[myIndex].fKeyKind != kRegKeyFileType)
+			continue;
+		
+		if ((gFirstGITypeIndex < 0) && (myEntries[myIndex].fComponentType == GraphicsImporterComponentType))
+			gFirstGITypeIndex = myNumTypes;
+		
+		myTypes[myNumTypes++] = myEntries[myIndex].fKey;
+	}
 	
-	// we can open any files for which QuickTime supplies a graphics importer component
-	gFirstGITypeIndex = myIndex;
-	QTFrame_AddComponentFileTypes(GraphicsImporterComponentType, &myIndex);
-
-	// resize the pointer to hold the exact number of valid file types
-	SetHandleSize(gValidFileTypes, myIndex * sizeof(OSType));
+	if (gFirstGITypeIndex < 0)
+		gFirstGITypeIndex = myNumTypes;
 	
+	// resize the block to hold the exact number of valid file types
+	SetHandleSize(gValidFileTypes, myNumTypes * sizeof(OSType));
 	return(MemError());
 }
 
@@ -2008,44 +2279,120 @@ OSErr QTFrame_BuildFileTypeList (void)
 //////////
 //
 // QTFrame_AddComponentFileTypes
-// Add all subtypes of the specified component type to the global list of file types.
+// Add all subtypes of the specified component type to the specified file type registry builder.
+//
+// Components whose subtype is a file name extension (movieImportSubTypeIsFileExtension) are added
+// to the registry as extensions; all others, as file types.
 //
 //////////
 
-static void QTFrame_AddComponentFileTypes (OSType theComponentType, long *theNextIndex)
+static void QTFrame_AddComponentFileTypes (OSType theComponentType, QTRegBuilderPtr theBuilder)
 {
 	ComponentDescription		myFindCompDesc = {0, 0, 0, 0, 0};
 	ComponentDescription		myInfoCompDesc = {0, 0, 0, 0, 0};
 	Component					myComponent = NULL;
-	OSType						*myTypes = NULL;
+	char						myExtension[5];
 
 	myFindCompDesc.componentType = theComponentType;
-	myFindCompDesc.componentFlags = 0;
+	myFindCompDesc.componentFlags = movieImportSubTypeIsFileExtension;
 	myFindCompDesc.componentFlagsMask = movieImportSubTypeIsFileExtension;
 
 	myComponent = FindNextComponent(myComponent, &myFindCompDesc);
 	while (myComponent != NULL) {
 		GetComponentInfo(myComponent, &myInfoCompDesc, NULL, NULL, NULL);
 		
-		if (gValidFileTypes == NULL)
-			return;
-			
-		myTypes = (OSType *)*gValidFileTypes;
-		myTypes[*theNextIndex] = myInfoCompDesc.componentSubType;
-		*theNextIndex += 1;
+		// unpack the extension; QTReg_AddExtension folds it to lowercase, and pads it with
+		// spaces just as the subtype is padded, so we can leave any trailing spaces alone
+		myExtension[0] = (char)(myInfoCompDesc.componentSubType >> 24);
+		myExtension[1] = (char)(myInfoCompDesc.componentSubType >> 16);
+		myExtension[2] = (char)(myInfoCompDesc.componentSubType >> 8);
+		myExtension[3] = (char)(myInfoCompDesc.componentSubType);
+		myExtension[4] = '\0';
 		
-		// resize the block of file types, if we are about to reach the limit
-		if (*theNextIndex == GetHandleSize(gValidFileTypes) / (long)sizeof(OSType)) {
-			SetHandleSize(gValidFileTypes, GetHandleSize(gValidFileTypes) + (kDefaultFileTypeCount * sizeof(OSType)));
-			if (MemError() != noErr)
-				return;
-		}
+		QTReg_AddExtension(theBuilder, myExtension, theComponentType, myInfoCompDesc.componentSubType, myInfoCompDesc.componentManufacturer);
+		
+		myComponent = FindNextComponent(myComponent, &myFindCompDesc);
+	}
+
+	myFindCompDesc.componentFlags = 0;
+	myComponent = FindNextComponent(NULL, &myFindCompDesc);
+	while (myComponent != NULL) {
+		GetComponentInfo(myComponent, &myInfoCompDesc, NULL, NULL, NULL);
+		
+		QTReg_AddFileType(theBuilder, myInfoCompDesc.componentSubType, theComponentType, myInfoCompDesc.componentSubType, myInfoCompDesc.componentManufacturer);
 		
 		myComponent = FindNextComponent(myComponent, &myFindCompDesc);
 	}
 }
 
 
+//////////
+//
+// QTFrame_GetComponentFingerprint
+// Return a fingerprint of the installed importer components, for tagging the file type cache.
+//
+// This has to be much cheaper than asking each component for its file types, so we don't look at the
+// components one by one; we use the QuickTime version and the number of components of each interesting
+// type (and of all types). Installing or removing an importer, or updating QuickTime, changes the
+// fingerprint; replacing one importer with another, without changing the count, does not. Deleting the
+// cache file always forces a rebuild.
+//
+//////////
+
+static QTUInt64 QTFrame_GetComponentFingerprint (void)
+{
+	ComponentDescription		myCompDesc = {0, 0, 0, 0, 0};
+	QTUInt64					myFingerprint = kRegFingerprintSeed;
+	
+	myFingerprint = QTReg_MixFingerprint(myFingerprint, (UInt32)QTUtils_GetQTVersion());
+	myFingerprint = QTReg_MixFingerprint(myFingerprint, (UInt32)CountComponents(&myCompDesc));
+	
+	myCompDesc.componentType = MovieImportType;
+	myFingerprint = QTReg_MixFingerprint(myFingerprint, (UInt32)CountComponents(&myCompDesc));
+	
+	myCompDesc.componentType = GraphicsImporterComponentType;
+	myFingerprint = QTReg_MixFingerprint(myFingerprint, (UInt32)CountComponents(&myCompDesc));
+	
+	return(myFingerprint);
+}
+
+
+//////////
+//
+// QTFrame_GetFileTypeCachePath
+// Get the full path of the file type cache.
+//
+//////////
+
+static OSErr QTFrame_GetFileTypeCachePath (char *theBuffer, size_t theBufferSize)
+{
+	char				myDirectory[kQTSysMaxPath];
+	OSErr				myErr = noErr;
+	
+	myErr = QTSys_GetCacheDirectory(myDirectory, sizeof(myDirectory));
+	if (myErr == noErr)
+		myErr = QTSys_MakePath(theBuffer, theBufferSize, myDirectory, kFileTypeCacheFileName);
+	
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFrame_GetFileTypeRegistry
+// Return the registry of file types and extensions that our application can open, building it if necessary.
+//
+//////////
+
+QTTypeRegistryPtr QTFrame_GetFileTypeRegistry (void)
+{
+	if (gFileTypeRegistry == NULL)
+		QTFrame_BuildFileTypeList();
+
+	return(gFileTypeRegistry);
+}
+
+
 #if TARGET_OS_WIN32
 //////////
 //
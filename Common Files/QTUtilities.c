@@ -63,6 +63,7 @@
 //
 //////////
 
+#define QTSYS_COUNT_ALLOCATIONS						// so that the string check (see QTEstimate.c) sees our allocations
 #ifndef __QTUtilities__
 #include "QTUtilities.h"
 
@@ -1356,6 +1357,9 @@ Boolean QTUtils_IsImageFile (FSSpec *theFSSpec)
 // QTUtils_IsMovieFile
 // Is the specified file a file that can be opened by QuickTime as a movie?
 //
+// On Windows, files have no file type; but QuickTime movies and MPEG-4 files can be recognized by
+// their atoms (QTProbe.c), which is much quicker than looking for a movie importer.
+//
 //////////
 
 Boolean QTUtils_IsMovieFile (FSSpec *theFSSpec)
@@ -1365,6 +1369,10 @@ Boolean QTUtils_IsMovieFile (FSSpec *theFSSpec)
 	Component					myImporter = NULL;
 	FInfo						myFinderInfo;
 	OSErr						myErr = noErr;
+#if TARGET_OS_WIN32
+	char						myPath[kQTSysMaxPath];
+	QTProbeInfoRecord			myInfo;
+#endif
 			
 	// see whether the file type is MovieFileType; to do this, get the Finder information
 	myErr = FSpGetFInfo(theFSSpec, &myFinderInfo);	
@@ -1372,6 +1380,13 @@ Boolean QTUtils_IsMovieFile (FSSpec *theFSSpec)
 		if (myFinderInfo.fdType == kQTFileTypeMovie)
 			return(true);
 
+#if TARGET_OS_WIN32
+	// see whether the file holds a movie atom
+	if (FSSpecToNativePathName(theFSSpec, myPath, sizeof(myPath), kFullNativePath) == noErr)
+		if ((QTProbe_ProbeFile(myPath, &myInfo) == noErr) && QTProbe_IsMovie(&myInfo))
+			return(true);
+#endif
+
 	// if it isn't a movie file, see whether the file can be imported as a movie
 	myErr = QTNewAlias(theFSSpec, &myAlias, true);
 	if (myErr == noErr) {
@@ -1410,22 +1425,19 @@ void QTUtils_ConvertFloatToBigEndian (float *theFloat)
 // Convert a C string into a Pascal string.
 //
 // The caller is responsible for disposing of the pointer returned by this function (by calling free).
+// For a constant string, QTUTILS_DEFINE_PSTRING is better; for a string needed only for a while,
+// QTUtils_CopyCToPascalString into a Str255 on the stack.
 //
 //////////
 
 StringPtr QTUtils_ConvertCToPascalString (char *theString)
 {
 	StringPtr	myString = malloc(min(strlen(theString) + 1, 256));
-	short		myIndex = 0;
 
-	while ((theString[myIndex] != '\0') && (myIndex < 255)) {
-		myString[myIndex + 1] = theString[myIndex];
-		myIndex++;
-	}
-	
-	myString[0] = (unsigned char)myIndex;
-	
-	return(myString);
+	if (myString == NULL)
+		return(NULL);
+
+	return(QTUtils_CopyCToPascalString(theString, myString));
 }
 
 
@@ -1441,14 +1453,54 @@ StringPtr QTUtils_ConvertCToPascalString (char *theString)
 char *QTUtils_ConvertPascalToCString (StringPtr theString)
 {
 	char 		*myString = malloc(theString[0] + 1);
+
+	if (myString == NULL)
+		return(NULL);
+
+	return(QTUtils_CopyPascalToCString(theString, myString));
+}
+
+
+//////////
+//
+// QTUtils_CopyCToPascalString
+// Copy a C string into a Pascal string buffer that the caller supplies, such as a Str255 on the stack.
+//
+// At most 255 characters are copied; theBuffer must have room for them and the length byte. Returns theBuffer.
+//
+//////////
+
+StringPtr QTUtils_CopyCToPascalString (const char *theString, StringPtr theBuffer)
+{
 	short		myIndex = 0;
 
-	for (myIndex = 0; myIndex < theString[0]; myIndex++)
-		myString[myIndex] = theString[myIndex + 1];
+	while ((theString[myIndex] != '\0') && (myIndex < 255)) {
+		theBuffer[myIndex + 1] = theString[myIndex];
+		myIndex++;
+	}
 	
-	myString[theString[0]] = '\0';
+	theBuffer[0] = (unsigned char)myIndex;
 	
-	return(myString);
+	return(theBuffer);
+}
+
+
+//////////
+//
+// QTUtils_CopyPascalToCString
+// Copy a Pascal string into a C string buffer that the caller supplies.
+//
+// theBuffer must have room for the string's characters and a terminating null (256 bytes will always do).
+// Returns theBuffer.
+//
+//////////
+
+char *QTUtils_CopyPascalToCString (ConstStr255Param theString, char *theBuffer)
+{
+	memcpy(theBuffer, &theString[1], theString[0]);
+	theBuffer[theString[0]] = '\0';
+	
+	return(theBuffer);
 }
 
 
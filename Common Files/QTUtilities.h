@@ -102,6 +102,8 @@
 #include <Traps.h>
 #endif
 
+#include "QTProbe.h"
+
 
 //////////
 //
@@ -113,6 +115,17 @@
 #define min(a, b)					((a)<(b)?(a):(b))
 #endif
 
+// define a constant Pascal string with the characters of a C string literal, built by the compiler; unlike
+// QTUtils_ConvertCToPascalString, this takes no memory at run time and gives nothing to free, and a literal
+// longer than 255 characters doesn't compile; QTUTILS_PSTRING gives its address as a ConstStringPtr
+#define QTUTILS_DEFINE_PSTRING(theName, theLiteral)																\
+	static const struct { unsigned char fLength; char fChars[sizeof(theLiteral)]; } theName = {					\
+		(unsigned char)(sizeof(theLiteral) - 1), theLiteral														\
+	};																											\
+	typedef char theName##IsTooLong[(sizeof(theLiteral) <= 256) ? 1 : -1]
+
+#define QTUTILS_PSTRING(theName)	((ConstStringPtr)&(theName))
+
 
 //////////
 //
@@ -258,6 +271,8 @@ Boolean						QTUtils_IsMovieFile (FSSpec *theFSSpec);
 void						QTUtils_ConvertFloatToBigEndian (float *theFloat);
 StringPtr					QTUtils_ConvertCToPascalString (char *theString);
 char *						QTUtils_ConvertPascalToCString (StringPtr theString);
+StringPtr					QTUtils_CopyCToPascalString (const char *theString, StringPtr theBuffer);
+char *						QTUtils_CopyPascalToCString (ConstStr255Param theString, char *theBuffer);
 OSErr						QTUtils_DeleteAllReferencesToTrack (Track theTrack);
 TimeValue					QTUtils_GetFrameDuration (Track theTrack);
 long						QTUtils_GetFrameCount (Track theTrack);
@@ -59,7 +59,6 @@ HWND				ghWnd;								// the MDI frame window; this window has the menu bar
 HWND				ghWndMDIClient; 					// the MDI client window
 
 char				gChildName[] = "QTShellChild";
-char				gMovieType[] = "QuickTime Movie";
 
 short 				gAppResFile = kInvalidFileRefNum;	// file reference number for this application's resource file
 FSSpec				gAppFSSpec;							// file specification for the application itself
@@ -91,6 +90,8 @@ int CALLBACK WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR theCmd
     WNDCLASSEX			myWC;
 	char				myFileName[MAX_PATH];
 	DWORD				myLength;
+	int					myExitCode = 0;
+	QTUInt64			myStartTime = QTSys_GetMicroseconds();
 	OSErr				myErr = noErr;
 
 	ghInst = hInstance;
@@ -168,6 +169,18 @@ int CALLBACK WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR theCmd
 			UseResFile(gAppResFile);
 	}
 	
+	// if the command line selects one of the application's headless modes, run it and quit without
+	// creating any windows
+	if (QTApp_RunHeadless(__argc, __argv, &myExitCode)) {
+		if (gAppResFile != kInvalidFileRefNum)
+			CloseResFile(gAppResFile);
+
+		ExitMovies();
+		TerminateQTML();
+
+		return(myExitCode);
+	}
+	
 	// do any application-specific initialization that must occur before the frame window is created
 	QTApp_Init(kInitAppPhase_BeforeCreateFrameWindow);
 	
@@ -194,6 +207,9 @@ int CALLBACK WinMain (HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR theCmd
 	// do any application-specific initialization that must occur after the frame window is created
 	QTApp_Init(kInitAppPhase_AfterCreateFrameWindow);
 	
+	// the application is ready for the user; record how long it took to get here
+	QTSys_Trace("{\"trace\":\"startup\",\"event\":\"ready\",\"microseconds\":%llu}", QTSys_GetMicroseconds() - myStartTime);
+	
 	// get and process events until the user quits
     while (GetMessage(&myMsg, NULL, 0, 0)) {	
 		if (!TranslateMDISysAccel(ghWndMDIClient, &myMsg)) {
@@ -627,82 +643,58 @@ void QTFrame_QuitFramework (void)
 // Parse the command line when the application first starts up and
 // open as movie documents any files specified on the command line.
 //
-// Based on the routine ParseCmdLinePriv in GraphicImporter.c.
+// The command line is split the way the C runtime splits it (QTCommandLine.c), and "@list" stands for
+// the files named in list. We find out which files are movies on a pool of threads, reading just their
+// top-level atoms, and then open those in the order they were given.
 //
 //////////
 
 void QTFrame_OpenCommandLineMovies (LPSTR theCmdLine)
 {
 #pragma unused(theCmdLine)
-	LPSTR				myCmdLine;
-	FSSpec				myFSSpec;
-	SHFILEINFO			myFileInfo;
+	QTCmdArgListRecord		myArgs = {NULL, 0, 0};
+	QTCmdArgListRecord		myFiles = {NULL, 0, 0};
+	QTCmdOpenEntryPtr		myEntries = NULL;
+	FSSpec					myFSSpec;
+	long					myIndex;
 	
-	// get the command line for the current process
-	myCmdLine = GetCommandLine();
-
-	// parse the command line
-	if (*myCmdLine) {
-		LPSTR			myTempLine;
+	// get the command line for the current process; the first argument is the name of the application
+	if (QTCmd_SplitCommandLine(GetCommandLine(), true, &myArgs) != noErr)
+		goto bail;
+	
+	// open whatever files we found, even if some response file couldn't be read
+	if (myArgs.fCount > 1)
+		QTCmd_ExpandResponseFiles(myArgs.fArgs + 1, myArgs.fCount - 1, &myFiles);
+	
+	if (myFiles.fCount == 0)
+		goto bail;
+	
+	myEntries = (QTCmdOpenEntryPtr)calloc(myFiles.fCount, sizeof(QTCmdOpenEntryRecord));
+	if (myEntries == NULL)
+		goto bail;
+	
+	for (myIndex = 0; myIndex < myFiles.fCount; myIndex++)
+		myEntries[myIndex].fPath = myFiles.fArgs[myIndex];
+	
+	// make sure each filename picks out a QuickTime movie
+	QTCmd_OpenFiles(myEntries, myFiles.fCount, 0, 0L);
+	
+	for (myIndex = 0; myIndex < myFiles.fCount; myIndex++) {
+		if ((myEntries[myIndex].fErr != noErr) || !myEntries[myIndex].fIsMovie)
+			continue;
 		
-		// the string preceding any white space is the name of the module (that is, the application)
-		myTempLine = strchr(myCmdLine, ' ');
-		if (myTempLine) {
-			myCmdLine = myTempLine;  				// skip the name of the application
-			while (*myCmdLine == ' ')
-				myCmdLine++;            			// skip spaces to end of string or to first command
-
-			while (*myCmdLine != '\0') {
-				char 	myFileName[MAX_PATH];
-				char 	myTempName[MAX_PATH];
-				char 	myBuffName[MAX_PATH];
-				int 	myIndex;
-				
-				// read thru the remaining string to find file names
-				for (myIndex = 0; *myCmdLine != '\0'; myIndex++, myCmdLine++) {
-					// if we encounter a space character, it might be a filename delimiter or a space in the filename;
-					// we'll try to open the filename we have so far to see whether it's a valid filename; if not, the
-					// space must be part of the filename we're constructing
-					if (*myCmdLine == ' ') {
-						HANDLE				myFindFile;
-						WIN32_FIND_DATA		myFile;
-					
-						myTempName[myIndex] = '\0';
-						strcpy_s(myBuffName, MAX_PATH, myTempName);
-						myFindFile = FindFirstFile(myBuffName, &myFile);
-						if (myFindFile != INVALID_HANDLE_VALUE) {
-							// we found a file having the specified name; close our file search and
-							// break out of our character-gobbling loop (since we've got a valid filename)
-							FindClose(myFindFile);
-							break;
-						}
-					}
-				
-					// if we made it here, *myCmdLine is part of the filename (possibly a space)
-					myFileName[myIndex] = myTempName[myIndex] = *myCmdLine;
-				}
-				
-				if (*myCmdLine != '\0')
-					myCmdLine++;
-				
-				// add a terminating NULL character
-				myFileName[myIndex] = '\0';
-
-				// make sure the filename picks out a QuickTime movie
-				SHGetFileInfo(myFileName, (DWORD)0, &myFileInfo, sizeof(myFileInfo), SHGFI_TYPENAME);
-				if (strcmp(myFileInfo.szTypeName, gMovieType) != 0)
-					continue;
-				
-				// make an FSSpec record
-				NativePathNameToFSSpec(myFileName, &myFSSpec, 0L);
-
-				// open the file in a movie window
-				QTFrame_OpenMovieInWindow(NULL, &myFSSpec);
-			}
-
-		} else
-			myCmdLine += strlen(myCmdLine);   		// point to NULL
+		// make an FSSpec record
+		if (NativePathNameToFSSpec((char *)myEntries[myIndex].fPath, &myFSSpec, 0L) != noErr)
+			continue;
+		
+		// open the file in a movie window
+		QTFrame_OpenMovieInWindow(NULL, &myFSSpec);
 	}
+	
+bail:
+	free(myEntries);
+	QTCmd_DisposeArguments(&myFiles);
+	QTCmd_DisposeArguments(&myArgs);
 }
 
 
@@ -68,6 +68,15 @@
 #endif
 
 #include "ComResource.h"
+#include "QTTypeRegistry.h"
+#include "QTRemux.h"
+#include "QTUpdate.h"
+#include "QTTag.h"
+#include "QTCommandLine.h"
+#include "QTScan.h"
+#include "QTReference.h"
+#include "QTSequence.h"
+#include "QTSwap.h"
 
 #if TARGET_OS_WIN32
 #ifndef __QTML__
@@ -92,7 +101,15 @@
 
 #define kInvalidFileRefNum					-1				// an invalid file reference number
 
-#define kDefaultFileTypeCount				100				// a generous guess at the number of file types we can open
+#define kFileTypeCacheFileName				"QTFrameFileTypes.cache"	// the cache of gFileTypeRegistry, in the user's cache folder
+
+// set this to 1 to save unchanged movies with our own fast-start flattener (QTRemux.c) instead of FlattenMovieData;
+// the flattener works on files, and only QTML gives us the pathname of an FSSpec (FSSpecToNativePathName)
+#define USE_FAST_START_FLATTENER			TARGET_OS_WIN32
+
+// set this to 1 to save changes to a movie file by patching or appending its movie atom (QTUpdate.c) instead of
+// with UpdateMovieResource; like the flattener, it needs the pathname of the movie file
+#define USE_INCREMENTAL_MOVIE_UPDATE		TARGET_OS_WIN32
 
 // constants for selecting InitApplication phase
 enum {
@@ -252,7 +269,13 @@ Boolean 					QTFrame_CreateNewMovie (void);
 Boolean 					QTFrame_OpenMovieInWindow (Movie theMovie, FSSpec *theFSSpec);
 MovieController				QTFrame_SetupController (Movie theMovie, WindowReference theWindow, Boolean theMoveWindow);
 OSErr						QTFrame_SaveAsMovieFile (WindowReference theWindow);
+#if USE_FAST_START_FLATTENER
+static OSErr				QTFrame_FlattenMovieFile (WindowObject theWindowObject, FSSpecPtr theFSSpecPtr, Movie *theNewMovie);
+#endif
 Boolean 					QTFrame_UpdateMovieFile (WindowReference theWindow);
+#if USE_INCREMENTAL_MOVIE_UPDATE
+static OSErr				QTFrame_UpdateMovieAtom (WindowObject theWindowObject);
+#endif
 void						QTFrame_IdleMovieWindows (void);
 void						QTFrame_CloseMovieWindows (void);
 void						QTFrame_CreateWindowObject (WindowReference theWindow);
@@ -296,7 +319,12 @@ PASCAL_RTN void				QTFrame_HandleNavEvent (NavEventCallbackMessage theCallBackSe
 Handle						QTFrame_CreateOpenHandle (OSType theApplicationSignature, short theNumTypes, QTFrameTypeListPtr theTypeList);
 QTFrameFileFilterUPP		QTFrame_GetFileFilterUPP (ProcPtr theFileFilterProc);
 OSErr						QTFrame_BuildFileTypeList (void);
-static void					QTFrame_AddComponentFileTypes (OSType theComponentType, long *theNextIndex);
+static OSErr				QTFrame_LoadFileTypeRegistry (void);
+static OSErr				QTFrame_FillFileTypeList (void);
+static void					QTFrame_AddComponentFileTypes (OSType theComponentType, QTRegBuilderPtr theBuilder);
+static QTUInt64				QTFrame_GetComponentFingerprint (void);
+static OSErr				QTFrame_GetFileTypeCachePath (char *theBuffer, size_t theBufferSize);
+QTTypeRegistryPtr			QTFrame_GetFileTypeRegistry (void);
 
 #if TARGET_OS_MAC
 PASCAL_RTN Boolean			QTFrame_FilterFiles (AEDesc *theItem, void *theInfo, void *theCallBackUD, NavFilterModes theFilterMode);
@@ -319,6 +347,7 @@ void						QTFrame_ConvertMacToWinMenuItemLabel (MovieController theMC, MenuRefer
 //////////
 
 void						QTApp_Init (UInt32 theStartPhase);
+Boolean						QTApp_RunHeadless (int theArgc, char *theArgv[], int *theExitCode);
 void						QTApp_Stop (UInt32 theStopPhase);
 void						QTApp_Idle (WindowReference theWindow);
 void						QTApp_Draw (WindowReference theWindow);
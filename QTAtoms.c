@@ -0,0 +1,553 @@
+//////////
+//
+//	File:		QTAtoms.c
+//
+//	Contains:	Portable functions for reading and writing the atoms in QuickTime and MPEG-4 files.
+//				All utilities start with the prefix "QTAtom_".
+//
+//	The engine files need to look inside movie files without QuickTime (the Movie Toolbox isn't available
+//	on our Linux tier, and it isn't thread-safe enough to use from worker threads anyway). These functions
+//	walk the atom tree through a QTAtomReaderRecord, which reads bytes at random offsets from a file or
+//	from memory, and build new atoms in a QTAtomBufferRecord.
+//
+//	A few notes on the file format: an atom's 32-bit size field may be 1, in which case a 64-bit size
+//	follows the type; or 0, in which case the atom extends to the end of its container (in practice, only
+//	top-level atoms do that). All numbers are big-endian.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTAtoms.h"
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTAtom_ReadFile (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength);
+static OSErr				QTAtom_ReadMemory (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength);
+static Boolean				QTAtom_GrowBuffer (QTAtomBufferPtr theBuffer, UInt32 theLength);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Reader functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTAtom_OpenFileReader
+// Open the file at the specified path and set up theReader to read from it.
+//
+//////////
+
+OSErr QTAtom_OpenFileReader (const char *thePath, QTAtomReaderPtr theReader)
+{
+	QTSysFile		myFile = kQTSysInvalidFile;
+	OSErr			myErr = noErr;
+
+	theReader->fRefCon = NULL;
+	theReader->fRead = QTAtom_ReadFile;
+	theReader->fSize = 0;
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenRead, &myFile);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTSys_GetFileSize(myFile, &theReader->fSize);
+	if (myErr != noErr) {
+		QTSys_CloseFile(myFile);
+		return(myErr);
+	}
+
+	theReader->fRefCon = myFile;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTAtom_CloseFileReader
+// Close the file opened by QTAtom_OpenFileReader.
+//
+//////////
+
+void QTAtom_CloseFileReader (QTAtomReaderPtr theReader)
+{
+	if ((theReader != NULL) && (theReader->fRefCon != NULL)) {
+		QTSys_CloseFile((QTSysFile)theReader->fRefCon);
+		theReader->fRefCon = NULL;
+	}
+}
+
+
+//////////
+//
+// QTAtom_InitMemoryReader
+// Set up theReader to read from a block of memory; the memory must outlive the reader.
+//
+//////////
+
+void QTAtom_InitMemoryReader (QTAtomReaderPtr theReader, const void *theData, QTUInt64 theSize)
+{
+	theReader->fRefCon = (void *)theData;
+	theReader->fRead = QTAtom_ReadMemory;
+	theReader->fSize = theSize;
+}
+
+
+//////////
+//
+// QTAtom_ReadFile
+// The read function of file readers.
+//
+//////////
+
+static OSErr QTAtom_ReadFile (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength)
+{
+	UInt32			myRead = 0;
+	OSErr			myErr = noErr;
+
+	myErr = QTSys_ReadFile((QTSysFile)theRefCon, theOffset, theBuffer, theLength, &myRead);
+	if ((myErr == noErr) && (myRead != theLength))
+		myErr = eofErr;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTAtom_ReadMemory
+// The read function of memory readers. The refcon is the start of the memory; the reader has already
+// checked the range against its size.
+//
+//////////
+
+static OSErr QTAtom_ReadMemory (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength)
+{
+	memcpy(theBuffer, (const UInt8 *)theRefCon + (size_t)theOffset, theLength);
+	return(noErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Atom-walking functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTAtom_ReadHeader
+// Read the header of the atom at theOffset, which must lie inside a container that ends at theEnd.
+//
+// We reject any atom that doesn't fit inside its container, so callers can trust fOffset + fSize.
+//
+//////////
+
+OSErr QTAtom_ReadHeader (QTAtomReaderPtr theReader, QTUInt64 theOffset, QTUInt64 theEnd, QTAtomHeaderPtr theHeader)
+{
+	UInt8			myBytes[kAtomExtendedHeaderSize];
+	QTUInt64		mySize;
+	OSErr			myErr = noErr;
+
+	if (theEnd > theReader->fSize)
+		theEnd = theReader->fSize;
+
+	if ((theOffset >= theEnd) || (theEnd - theOffset < kAtomHeaderSize))
+		return(eofErr);
+
+	myErr = theReader->fRead(theReader->fRefCon, theOffset, myBytes, kAtomHeaderSize);
+	if (myErr != noErr)
+		return(myErr);
+
+	mySize = QTAtom_GetBE32(myBytes);
+	theHeader->fType = QTAtom_GetBE32(myBytes + 4);
+	theHeader->fOffset = theOffset;
+	theHeader->fHeaderSize = kAtomHeaderSize;
+
+	if (mySize == 1) {
+		// a 64-bit size follows the type
+		if (theEnd - theOffset < kAtomExtendedHeaderSize)
+			return(invalidAtomErr);
+
+		myErr = theReader->fRead(theReader->fRefCon, theOffset + kAtomHeaderSize, myBytes + kAtomHeaderSize, kAtomExtendedHeaderSize - kAtomHeaderSize);
+		if (myErr != noErr)
+			return(myErr);
+
+		mySize = QTAtom_GetBE64(myBytes + kAtomHeaderSize);
+		theHeader->fHeaderSize = kAtomExtendedHeaderSize;
+	} else if (mySize == 0) {
+		// the atom extends to the end of its container
+		mySize = theEnd - theOffset;
+	}
+
+	if ((mySize < theHeader->fHeaderSize) || (mySize > theEnd - theOffset))
+		return(invalidAtomErr);
+
+	theHeader->fSize = mySize;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTAtom_FindChild
+// Find the theIndex'th (1-based) child of theParent whose type is theType.
+//
+// A NULL parent means the top level of the file. The children of an atom start right after its header;
+// the few atoms whose children follow other data (such as 'stsd') must be searched by the caller.
+//
+//////////
+
+OSErr QTAtom_FindChild (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, OSType theType, long theIndex, QTAtomHeaderPtr theChild)
+{
+	QTUInt64		myOffset = 0;
+	QTUInt64		myEnd = theReader->fSize;
+	OSErr			myErr = noErr;
+
+	if (theParent != NULL) {
+		myOffset = theParent->fOffset + theParent->fHeaderSize;
+		myEnd = theParent->fOffset + theParent->fSize;
+	}
+
+	while (myEnd - myOffset >= kAtomHeaderSize) {
+		myErr = QTAtom_ReadHeader(theReader, myOffset, myEnd, theChild);
+		if (myErr != noErr)
+			return(myErr);
+
+		if ((theChild->fType == theType) && (--theIndex <= 0))
+			return(noErr);
+
+		myOffset += theChild->fSize;
+	}
+
+	return(invalidAtomErr);
+}
+
+
+//////////
+//
+// QTAtom_FindTopLevel
+// Find the first top-level atom of the specified type.
+//
+//////////
+
+OSErr QTAtom_FindTopLevel (QTAtomReaderPtr theReader, OSType theType, QTAtomHeaderPtr theAtom)
+{
+	return(QTAtom_FindChild(theReader, NULL, theType, 1, theAtom));
+}
+
+
+//////////
+//
+// QTAtom_FindPath
+// Follow a path of atom types (the first child of each type) down from theParent.
+//
+//////////
+
+OSErr QTAtom_FindPath (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, const OSType *thePath, long theDepth, QTAtomHeaderPtr theAtom)
+{
+	QTAtomHeaderRecord		myParent;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if ((theDepth <= 0) || (theDepth > kAtomMaxDepth))
+		return(paramErr);
+
+	for (myIndex = 0; myIndex < theDepth; myIndex++) {
+		myErr = QTAtom_FindChild(theReader, (myIndex == 0) ? theParent : &myParent, thePath[myIndex], 1, theAtom);
+		if (myErr != noErr)
+			return(myErr);
+
+		myParent = *theAtom;
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTAtom_ReadPayload
+// Read the data of an atom (everything after its header) into a new block of memory, which the caller must free.
+//
+//////////
+
+OSErr QTAtom_ReadPayload (QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, UInt8 **theData, UInt32 *theSize)
+{
+	QTUInt64		mySize = theAtom->fSize - theAtom->fHeaderSize;
+	UInt8			*myData = NULL;
+	OSErr			myErr = noErr;
+
+	*theData = NULL;
+	*theSize = 0;
+
+	// atoms that we read into memory are tables, never media data; anything this big is damaged
+	if (mySize >= 0x7FFFFFFF)
+		return(invalidAtomErr);
+
+	// allocate at least one byte, so that an empty atom still gets a block of memory
+	myData = (UInt8 *)malloc((size_t)mySize + 1);
+	if (myData == NULL)
+		return(memFullErr);
+
+	if (mySize > 0) {
+		myErr = theReader->fRead(theReader->fRefCon, theAtom->fOffset + theAtom->fHeaderSize, myData, (UInt32)mySize);
+		if (myErr != noErr) {
+			free(myData);
+			return(myErr);
+		}
+	}
+
+	*theData = myData;
+	*theSize = (UInt32)mySize;
+	return(noErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Buffer functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTAtom_InitBuffer
+// Initialize an empty atom buffer.
+//
+//////////
+
+void QTAtom_InitBuffer (QTAtomBufferPtr theBuffer)
+{
+	theBuffer->fData = NULL;
+	theBuffer->fSize = 0;
+	theBuffer->fCapacity = 0;
+	theBuffer->fErr = noErr;
+}
+
+
+//////////
+//
+// QTAtom_DisposeBuffer
+// Dispose of the memory held by an atom buffer.
+//
+//////////
+
+void QTAtom_DisposeBuffer (QTAtomBufferPtr theBuffer)
+{
+	free(theBuffer->fData);
+	QTAtom_InitBuffer(theBuffer);
+}
+
+
+//////////
+//
+// QTAtom_GrowBuffer
+// Make room for theLength more bytes; return false (and set the buffer's error) if we can't.
+//
+//////////
+
+static Boolean QTAtom_GrowBuffer (QTAtomBufferPtr theBuffer, UInt32 theLength)
+{
+	UInt32			myCapacity;
+	UInt8			*myData;
+
+	if (theBuffer->fErr != noErr)
+		return(false);
+
+	if (theLength > 0x7FFFFFFF - theBuffer->fSize) {
+		theBuffer->fErr = memFullErr;
+		return(false);
+	}
+
+	if (theBuffer->fSize + theLength <= theBuffer->fCapacity)
+		return(true);
+
+	myCapacity = (theBuffer->fCapacity == 0) ? kAtomBufferInitialSize : theBuffer->fCapacity;
+	while (myCapacity < theBuffer->fSize + theLength)
+		myCapacity = (myCapacity > 0x3FFFFFFF) ? 0x7FFFFFFF : 2 * myCapacity;
+
+	myData = (UInt8 *)realloc(theBuffer->fData, myCapacity);
+	if (myData == NULL) {
+		theBuffer->fErr = memFullErr;
+		return(false);
+	}
+
+	theBuffer->fData = myData;
+	theBuffer->fCapacity = myCapacity;
+	return(true);
+}
+
+
+//////////
+//
+// QTAtom_AppendBytes
+// Append bytes to an atom buffer.
+//
+//////////
+
+void QTAtom_AppendBytes (QTAtomBufferPtr theBuffer, const void *theData, UInt32 theLength)
+{
+	// an empty value may come with a NULL pointer, which memcpy mustn't be given even for no bytes
+	if (theLength == 0)
+		return;
+
+	if (!QTAtom_GrowBuffer(theBuffer, theLength))
+		return;
+
+	memcpy(theBuffer->fData + theBuffer->fSize, theData, theLength);
+	theBuffer->fSize += theLength;
+}
+
+
+//////////
+//
+// QTAtom_AppendZeros
+// Append zero bytes to an atom buffer.
+//
+//////////
+
+void QTAtom_AppendZeros (QTAtomBufferPtr theBuffer, UInt32 theLength)
+{
+	if (theLength == 0)
+		return;
+
+	if (!QTAtom_GrowBuffer(theBuffer, theLength))
+		return;
+
+	memset(theBuffer->fData + theBuffer->fSize, 0, theLength);
+	theBuffer->fSize += theLength;
+}
+
+
+//////////
+//
+// QTAtom_Append8, QTAtom_Append16, QTAtom_Append32, QTAtom_Append64
+// Append a big-endian number to an atom buffer.
+//
+//////////
+
+void QTAtom_Append8 (QTAtomBufferPtr theBuffer, UInt8 theValue)
+{
+	QTAtom_AppendBytes(theBuffer, &theValue, 1);
+}
+
+void QTAtom_Append16 (QTAtomBufferPtr theBuffer, UInt16 theValue)
+{
+	UInt8			myBytes[2];
+
+	QTAtom_PutBE16(myBytes, theValue);
+	QTAtom_AppendBytes(theBuffer, myBytes, sizeof(myBytes));
+}
+
+void QTAtom_Append32 (QTAtomBufferPtr theBuffer, UInt32 theValue)
+{
+	UInt8			myBytes[4];
+
+	QTAtom_PutBE32(myBytes, theValue);
+	QTAtom_AppendBytes(theBuffer, myBytes, sizeof(myBytes));
+}
+
+void QTAtom_Append64 (QTAtomBufferPtr theBuffer, QTUInt64 theValue)
+{
+	UInt8			myBytes[8];
+
+	QTAtom_PutBE64(myBytes, theValue);
+	QTAtom_AppendBytes(theBuffer, myBytes, sizeof(myBytes));
+}
+
+
+//////////
+//
+// QTAtom_BeginAtom
+// Append the header of a new atom, with a placeholder size; return the offset to pass to QTAtom_EndAtom.
+//
+//////////
+
+UInt32 QTAtom_BeginAtom (QTAtomBufferPtr theBuffer, OSType theType)
+{
+	UInt32			myOffset = theBuffer->fSize;
+
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, theType);
+
+	return(myOffset);
+}
+
+
+//////////
+//
+// QTAtom_BeginFullAtom
+// Append the header of a new atom that starts with a version and flags.
+//
+//////////
+
+UInt32 QTAtom_BeginFullAtom (QTAtomBufferPtr theBuffer, OSType theType, UInt8 theVersion, UInt32 theFlags)
+{
+	UInt32			myOffset = QTAtom_BeginAtom(theBuffer, theType);
+
+	QTAtom_Append32(theBuffer, ((UInt32)theVersion << 24) | (theFlags & 0x00FFFFFF));
+
+	return(myOffset);
+}
+
+
+//////////
+//
+// QTAtom_EndAtom
+// Fill in the size of the atom begun at theAtomOffset, which ends at the current end of the buffer.
+//
+//////////
+
+void QTAtom_EndAtom (QTAtomBufferPtr theBuffer, UInt32 theAtomOffset)
+{
+	if (theBuffer->fErr != noErr)
+		return;
+
+	QTAtom_PutBE32(theBuffer->fData + theAtomOffset, theBuffer->fSize - theAtomOffset);
+}
+
+
+//////////
+//
+// QTAtom_AppendAtomFrom
+// Copy a whole atom, header included, from a reader into an atom buffer.
+//
+// An atom whose size field was 0 (to the end of its container) is given an explicit size, since it
+// probably won't end its container any more.
+//
+//////////
+
+OSErr QTAtom_AppendAtomFrom (QTAtomBufferPtr theBuffer, QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom)
+{
+	UInt32			myStart = theBuffer->fSize;
+	OSErr			myErr = noErr;
+
+	if (theAtom->fSize >= 0x7FFFFFFF)
+		return(memFullErr);
+
+	if (!QTAtom_GrowBuffer(theBuffer, (UInt32)theAtom->fSize))
+		return(theBuffer->fErr);
+
+	myErr = theReader->fRead(theReader->fRefCon, theAtom->fOffset, theBuffer->fData + myStart, (UInt32)theAtom->fSize);
+	if (myErr != noErr)
+		return(myErr);
+
+	theBuffer->fSize += (UInt32)theAtom->fSize;
+
+	if (theAtom->fHeaderSize == kAtomHeaderSize)
+		QTAtom_PutBE32(theBuffer->fData + myStart, (UInt32)theAtom->fSize);
+
+	return(noErr);
+}
@@ -0,0 +1,182 @@
+//////////
+//
+//	File:		QTAtoms.h
+//
+//	Contains:	Portable functions for reading and writing the atoms in QuickTime and MPEG-4 files.
+//				All utilities start with the prefix "QTAtom_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTAtoms__
+#define __QTAtoms__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSystem.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kAtomHeaderSize						8						// size + type
+#define kAtomExtendedHeaderSize				16						// size (1) + type + 64-bit size
+#define kAtomFullHeaderSize					4						// version + flags, after the atom header
+
+// atom types used by the engine files
+#define kAtomTypeMovie						FOUR_CHAR_CODE('moov')
+#define kAtomTypeMovieHeader				FOUR_CHAR_CODE('mvhd')
+#define kAtomTypeMovieData					FOUR_CHAR_CODE('mdat')
+#define kAtomTypeFileType					FOUR_CHAR_CODE('ftyp')
+#define kAtomTypeFree						FOUR_CHAR_CODE('free')
+#define kAtomTypeSkip						FOUR_CHAR_CODE('skip')
+#define kAtomTypeWide						FOUR_CHAR_CODE('wide')
+#define kAtomTypeTrack						FOUR_CHAR_CODE('trak')
+#define kAtomTypeTrackHeader				FOUR_CHAR_CODE('tkhd')
+#define kAtomTypeTrackReference				FOUR_CHAR_CODE('tref')
+#define kAtomTypeEdits						FOUR_CHAR_CODE('edts')
+#define kAtomTypeMedia						FOUR_CHAR_CODE('mdia')
+#define kAtomTypeMediaHeader				FOUR_CHAR_CODE('mdhd')
+#define kAtomTypeHandler					FOUR_CHAR_CODE('hdlr')
+#define kAtomTypeMediaInfo					FOUR_CHAR_CODE('minf')
+#define kAtomTypeDataInfo					FOUR_CHAR_CODE('dinf')
+#define kAtomTypeDataRef					FOUR_CHAR_CODE('dref')
+#define kAtomTypeDataRefURL					FOUR_CHAR_CODE('url ')
+#define kAtomTypeSampleTable				FOUR_CHAR_CODE('stbl')
+#define kAtomTypeSampleDesc					FOUR_CHAR_CODE('stsd')
+#define kAtomTypeTimeToSample				FOUR_CHAR_CODE('stts')
+#define kAtomTypeSampleToChunk				FOUR_CHAR_CODE('stsc')
+#define kAtomTypeSampleSize					FOUR_CHAR_CODE('stsz')
+#define kAtomTypeChunkOffset				FOUR_CHAR_CODE('stco')
+#define kAtomTypeChunkOffset64				FOUR_CHAR_CODE('co64')
+#define kAtomTypeSyncSample					FOUR_CHAR_CODE('stss')
+#define kAtomTypeUserData					FOUR_CHAR_CODE('udta')
+#define kAtomTypeHintHeader					FOUR_CHAR_CODE('hmhd')
+#define kAtomTypeHintInfo					FOUR_CHAR_CODE('hnti')
+#define kAtomTypeHintSDP					FOUR_CHAR_CODE('sdp ')
+#define kAtomTypeHintTimeScale				FOUR_CHAR_CODE('tims')
+
+// handler types
+#define kAtomHandlerVideo					FOUR_CHAR_CODE('vide')
+#define kAtomHandlerSound					FOUR_CHAR_CODE('soun')
+#define kAtomHandlerHint					FOUR_CHAR_CODE('hint')
+#define kAtomHandlerMedia					FOUR_CHAR_CODE('mhlr')
+
+// MPEG-4 brands; a file with no 'ftyp' atom, or with the 'qt  ' major brand, is a QuickTime movie
+#define kAtomBrandQuickTime					FOUR_CHAR_CODE('qt  ')
+
+#define kAtomBufferInitialSize				4096					// initial capacity of a QTAtomBuffer
+#define kAtomMaxDepth						16						// deepest nesting we follow
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a source of bytes at random offsets; fRead must read exactly theLength bytes, or fail with eofErr
+typedef struct QTAtomReaderRecord {
+	void					*fRefCon;
+	OSErr					(*fRead) (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength);
+	QTUInt64				fSize;					// total number of bytes available
+} QTAtomReaderRecord, *QTAtomReaderPtr;
+
+// the location of one atom
+typedef struct QTAtomHeaderRecord {
+	OSType					fType;
+	QTUInt64				fOffset;				// offset of the atom header
+	QTUInt64				fSize;					// size of the whole atom, header included
+	UInt32					fHeaderSize;			// kAtomHeaderSize or kAtomExtendedHeaderSize
+} QTAtomHeaderRecord, *QTAtomHeaderPtr;
+
+// a growable buffer for building atoms in memory; the first error sticks, so callers check fErr once at the end
+typedef struct QTAtomBufferRecord {
+	UInt8					*fData;
+	UInt32					fSize;
+	UInt32					fCapacity;
+	OSErr					fErr;
+} QTAtomBufferRecord, *QTAtomBufferPtr;
+
+
+//////////
+//
+// big-endian accessors
+//
+//////////
+
+QTSYS_INLINE UInt16 QTAtom_GetBE16 (const UInt8 *theBytes)
+{
+	return((UInt16)((theBytes[0] << 8) | theBytes[1]));
+}
+
+QTSYS_INLINE UInt32 QTAtom_GetBE32 (const UInt8 *theBytes)
+{
+	return(((UInt32)theBytes[0] << 24) | ((UInt32)theBytes[1] << 16) | ((UInt32)theBytes[2] << 8) | (UInt32)theBytes[3]);
+}
+
+QTSYS_INLINE QTUInt64 QTAtom_GetBE64 (const UInt8 *theBytes)
+{
+	return(((QTUInt64)QTAtom_GetBE32(theBytes) << 32) | (QTUInt64)QTAtom_GetBE32(theBytes + 4));
+}
+
+QTSYS_INLINE void QTAtom_PutBE16 (UInt8 *theBytes, UInt16 theValue)
+{
+	theBytes[0] = (UInt8)(theValue >> 8);
+	theBytes[1] = (UInt8)theValue;
+}
+
+QTSYS_INLINE void QTAtom_PutBE32 (UInt8 *theBytes, UInt32 theValue)
+{
+	theBytes[0] = (UInt8)(theValue >> 24);
+	theBytes[1] = (UInt8)(theValue >> 16);
+	theBytes[2] = (UInt8)(theValue >> 8);
+	theBytes[3] = (UInt8)theValue;
+}
+
+QTSYS_INLINE void QTAtom_PutBE64 (UInt8 *theBytes, QTUInt64 theValue)
+{
+	QTAtom_PutBE32(theBytes, (UInt32)(theValue >> 32));
+	QTAtom_PutBE32(theBytes + 4, (UInt32)theValue);
+}
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTAtom_OpenFileReader (const char *thePath, QTAtomReaderPtr theReader);
+void						QTAtom_CloseFileReader (QTAtomReaderPtr theReader);
+void						QTAtom_InitMemoryReader (QTAtomReaderPtr theReader, const void *theData, QTUInt64 theSize);
+
+OSErr						QTAtom_ReadHeader (QTAtomReaderPtr theReader, QTUInt64 theOffset, QTUInt64 theEnd, QTAtomHeaderPtr theHeader);
+OSErr						QTAtom_FindChild (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, OSType theType, long theIndex, QTAtomHeaderPtr theChild);
+OSErr						QTAtom_FindTopLevel (QTAtomReaderPtr theReader, OSType theType, QTAtomHeaderPtr theAtom);
+OSErr						QTAtom_FindPath (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, const OSType *thePath, long theDepth, QTAtomHeaderPtr theAtom);
+OSErr						QTAtom_ReadPayload (QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, UInt8 **theData, UInt32 *theSize);
+
+void						QTAtom_InitBuffer (QTAtomBufferPtr theBuffer);
+void						QTAtom_DisposeBuffer (QTAtomBufferPtr theBuffer);
+void						QTAtom_AppendBytes (QTAtomBufferPtr theBuffer, const void *theData, UInt32 theLength);
+void						QTAtom_AppendZeros (QTAtomBufferPtr theBuffer, UInt32 theLength);
+void						QTAtom_Append8 (QTAtomBufferPtr theBuffer, UInt8 theValue);
+void						QTAtom_Append16 (QTAtomBufferPtr theBuffer, UInt16 theValue);
+void						QTAtom_Append32 (QTAtomBufferPtr theBuffer, UInt32 theValue);
+void						QTAtom_Append64 (QTAtomBufferPtr theBuffer, QTUInt64 theValue);
+UInt32						QTAtom_BeginAtom (QTAtomBufferPtr theBuffer, OSType theType);
+UInt32						QTAtom_BeginFullAtom (QTAtomBufferPtr theBuffer, OSType theType, UInt8 theVersion, UInt32 theFlags);
+void						QTAtom_EndAtom (QTAtomBufferPtr theBuffer, UInt32 theAtomOffset);
+OSErr						QTAtom_AppendAtomFrom (QTAtomBufferPtr theBuffer, QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom);
+
+#endif	// __QTAtoms__
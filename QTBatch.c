@@ -0,0 +1,498 @@
+//////////
+//
+//	File:		QTBatch.c
+//
+//	Contains:	A headless batch-conversion engine for importing non-movie files.
+//				All utilities start with the prefix "QTBatch_".
+//
+//	QTDX_ImportAnyNonMovie asks the user for one file and converts it. This file does the same work for
+//	a whole manifest of files, without any user interface: each manifest line names an input file and
+//	(optionally) an output directory, separated by a tab. For every line we ask the importer whether the
+//	file can be opened in place; if not, we write a reference movie that points into it (QTReference.c)
+//	or, failing that, convert it into a movie file in the output directory. The outcome of each line is
+//	written to a report as one JSON object per line, so that other tools can read it.
+//
+//	The QuickTime calls live behind the QTBatchImporterRecord interface; this file itself uses only the
+//	services in QTSystem.c and QTReference.c.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTBatch.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kBatchInitialCapacity		64						// initial number of entries in a manifest
+#define kBatchMaxLineLength			(2 * kQTSysMaxPath + 2)	// longest manifest line we accept
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static const char *			QTBatch_GetStatusName (long theStatus);
+static Boolean				QTBatch_StubCanImportInPlace (void *theRefCon, const char *theInPath);
+static OSErr				QTBatch_StubConvertFile (void *theRefCon, const char *theInPath, const char *theOutPath);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Manifest functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTBatch_ReadManifest
+// Read the manifest file at the specified path and append its entries to theManifest.
+//
+// Blank lines and lines beginning with '#' are ignored. A line with no tab gets theDefaultOutDirectory
+// (or, if that is NULL, the directory of the input file).
+//
+//////////
+
+OSErr QTBatch_ReadManifest (const char *thePath, const char *theDefaultOutDirectory, QTBatchManifestPtr theManifest)
+{
+	FILE			*myFile = NULL;
+	char			myLine[kBatchMaxLineLength];
+	char			*myInPath;
+	char			*myOutDirectory;
+	OSErr			myErr = noErr;
+
+	if ((thePath == NULL) || (theManifest == NULL))
+		return(paramErr);
+
+	myFile = fopen(thePath, "r");
+	if (myFile == NULL)
+		return(fnfErr);
+
+	while ((myErr == noErr) && (fgets(myLine, sizeof(myLine), myFile) != NULL)) {
+		myInPath = QTSys_TrimLine(myLine);
+		if ((*myInPath == '\0') || (*myInPath == kBatchManifestComment))
+			continue;
+
+		myOutDirectory = strchr(myInPath, kBatchManifestSeparator);
+		if (myOutDirectory != NULL) {
+			*myOutDirectory++ = '\0';
+			myInPath = QTSys_TrimLine(myInPath);
+			myOutDirectory = QTSys_TrimLine(myOutDirectory);
+		}
+
+		if ((myOutDirectory == NULL) || (*myOutDirectory == '\0'))
+			myOutDirectory = (char *)theDefaultOutDirectory;
+
+		myErr = QTBatch_AddEntry(theManifest, myInPath, myOutDirectory);
+	}
+
+	fclose(myFile);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTBatch_AddEntry
+// Append an entry to the specified manifest; a NULL output directory means "next to the input file".
+//
+//////////
+
+OSErr QTBatch_AddEntry (QTBatchManifestPtr theManifest, const char *theInPath, const char *theOutDirectory)
+{
+	QTBatchEntryPtr		myEntry = NULL;
+
+	if ((theManifest == NULL) || (theInPath == NULL))
+		return(paramErr);
+
+	// grow the entry array, if necessary
+	if (theManifest->fCount == theManifest->fCapacity) {
+		long				myCapacity = (theManifest->fCapacity == 0) ? kBatchInitialCapacity : theManifest->fCapacity * 2;
+		QTBatchEntryPtr		myEntries;
+
+		myEntries = (QTBatchEntryPtr)realloc(theManifest->fEntries, myCapacity * sizeof(QTBatchEntryRecord));
+		if (myEntries == NULL)
+			return(memFullErr);
+
+		theManifest->fEntries = myEntries;
+		theManifest->fCapacity = myCapacity;
+	}
+
+	myEntry = &theManifest->fEntries[theManifest->fCount];
+	memset(myEntry, 0, sizeof(QTBatchEntryRecord));
+
+	myEntry->fInPath = QTSys_CopyString(theInPath);
+	if (theOutDirectory != NULL)
+		myEntry->fOutDirectory = QTSys_CopyString(theOutDirectory);
+	else {
+		// use the directory that contains the input file
+		myEntry->fOutDirectory = QTSys_CopyString(theInPath);
+		if (myEntry->fOutDirectory != NULL)
+			myEntry->fOutDirectory[QTSys_GetFileName(theInPath) - theInPath] = '\0';
+	}
+
+	if ((myEntry->fInPath == NULL) || (myEntry->fOutDirectory == NULL)) {
+		free(myEntry->fInPath);
+		free(myEntry->fOutDirectory);
+		return(memFullErr);
+	}
+
+	myEntry->fStatus = kBatchStatusPending;
+	theManifest->fCount++;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTBatch_DisposeManifest
+// Release the memory held by the specified manifest; the manifest record itself is not freed.
+//
+//////////
+
+void QTBatch_DisposeManifest (QTBatchManifestPtr theManifest)
+{
+	long		myIndex;
+
+	if (theManifest == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theManifest->fCount; myIndex++) {
+		free(theManifest->fEntries[myIndex].fInPath);
+		free(theManifest->fEntries[myIndex].fOutDirectory);
+	}
+
+	free(theManifest->fEntries);
+	memset(theManifest, 0, sizeof(QTBatchManifestRecord));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Conversion functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTBatch_ProcessEntry
+// Import the file named by a single manifest entry, filling in the entry's status, timing and size.
+//
+//////////
+
+OSErr QTBatch_ProcessEntry (QTBatchImporterPtr theImporter, QTBatchEntryPtr theEntry)
+{
+	char			myFileName[kQTSysMaxPath];
+	QTUInt64		myStartTime = QTSys_GetMicroseconds();
+	OSErr			myErr = noErr;
+
+	if ((theImporter == NULL) || (theEntry == NULL))
+		return(paramErr);
+
+	theEntry->fBytesWritten = 0;
+	memset(&theEntry->fReference, 0, sizeof(theEntry->fReference));
+	theEntry->fOutPath[0] = '\0';
+
+	if (!QTSys_FileExists(theEntry->fInPath)) {
+		myErr = fnfErr;
+		goto bail;
+	}
+
+	// a file that can be imported in place needs no conversion at all
+	if (theImporter->fCanImportInPlace(theImporter->fRefCon, theEntry->fInPath)) {
+		QTSys_FormatString(theEntry->fOutPath, sizeof(theEntry->fOutPath), "%s", theEntry->fInPath);
+		theEntry->fStatus = kBatchStatusInPlace;
+		goto bail;
+	}
+
+	myErr = QTSys_ReplaceExtension(myFileName, sizeof(myFileName), QTSys_GetFileName(theEntry->fInPath), kBatchConvertedExtension);
+	if (myErr == noErr)
+		myErr = QTSys_MakePath(theEntry->fOutPath, sizeof(theEntry->fOutPath), theEntry->fOutDirectory, myFileName);
+	if (myErr != noErr)
+		goto bail;
+
+	// delete any existing file of that name
+	myErr = QTSys_DeletePath(theEntry->fOutPath);
+	if (myErr != noErr)
+		goto bail;
+
+	// a file whose media a movie can point into needs only a reference movie; we convert anything else
+	if (QTRef_WriteReferenceMovie(theEntry->fInPath, theEntry->fOutPath, theImporter->fConversionOperation, &theEntry->fReference) == noErr) {
+		theEntry->fBytesWritten = theEntry->fReference.fBytesWritten;
+		theEntry->fStatus = kBatchStatusReferenced;
+		goto bail;
+	}
+
+	myErr = theImporter->fConvertFile(theImporter->fRefCon, theEntry->fInPath, theEntry->fOutPath);
+	if (myErr == noErr) {
+		QTSys_GetPathSize(theEntry->fOutPath, &theEntry->fBytesWritten);
+		theEntry->fStatus = kBatchStatusConverted;
+	}
+
+bail:
+	if (myErr != noErr)
+		theEntry->fStatus = kBatchStatusFailed;
+
+	theEntry->fErr = myErr;
+	theEntry->fWallMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTBatch_ProcessManifest
+// Process every entry in the manifest, writing one report line per entry and a summary line at the end.
+// Returns the number of entries that failed.
+//
+//////////
+
+long QTBatch_ProcessManifest (QTBatchImporterPtr theImporter, QTBatchManifestPtr theManifest, FILE *theReport)
+{
+	QTUInt64		myStartTime = QTSys_GetMicroseconds();
+	QTUInt64		myTotalBytes = 0;
+	QTUInt64		myBytesSaved = 0;
+	long			myCounts[kBatchStatusFailed + 1] = {0, 0, 0, 0, 0};
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < theManifest->fCount; myIndex++) {
+		QTBatchEntryPtr		myEntry = &theManifest->fEntries[myIndex];
+
+		QTBatch_ProcessEntry(theImporter, myEntry);
+
+		myCounts[myEntry->fStatus]++;
+		myTotalBytes += myEntry->fBytesWritten;
+		if (myEntry->fStatus == kBatchStatusReferenced)
+			myBytesSaved += myEntry->fReference.fBytesSaved;
+
+		if (theReport != NULL) {
+			QTBatch_WriteEntryReport(theReport, myEntry);
+			fflush(theReport);
+		}
+	}
+
+	if (theReport != NULL) {
+		fprintf(theReport, "{\"summary\":true,\"files\":%ld,\"converted\":%ld,\"inPlace\":%ld,\"referenced\":%ld,\"failed\":%ld,\"wallMicroseconds\":%llu,\"bytesWritten\":%llu,\"bytesSaved\":%llu}\n",
+						theManifest->fCount,
+						myCounts[kBatchStatusConverted],
+						myCounts[kBatchStatusInPlace],
+						myCounts[kBatchStatusReferenced],
+						myCounts[kBatchStatusFailed],
+						(unsigned long long)(QTSys_GetMicroseconds() - myStartTime),
+						(unsigned long long)myTotalBytes,
+						(unsigned long long)myBytesSaved);
+		fflush(theReport);
+	}
+
+	return(myCounts[kBatchStatusFailed]);
+}
+
+
+//////////
+//
+// QTBatch_WriteEntryReport
+// Write the outcome of one manifest entry as a single line of JSON.
+//
+//////////
+
+void QTBatch_WriteEntryReport (FILE *theReport, QTBatchEntryPtr theEntry)
+{
+	fputs("{\"input\":", theReport);
+	QTSys_WriteJSONString(theReport, theEntry->fInPath);
+	fputs(",\"output\":", theReport);
+	QTSys_WriteJSONString(theReport, theEntry->fOutPath);
+	fprintf(theReport, ",\"status\":\"%s\",\"err\":%d,\"wallMicroseconds\":%llu,\"bytesWritten\":%llu",
+						QTBatch_GetStatusName(theEntry->fStatus),
+						(int)theEntry->fErr,
+						(unsigned long long)theEntry->fWallMicroseconds,
+						(unsigned long long)theEntry->fBytesWritten);
+
+	// for a reference movie, what a full conversion would have cost
+	if (theEntry->fStatus == kBatchStatusReferenced) {
+		fprintf(theReport, ",\"bytesSaved\":%llu,\"microsecondsSaved\":", (unsigned long long)theEntry->fReference.fBytesSaved);
+		if (theEntry->fReference.fHasEstimate)
+			fprintf(theReport, "%llu", (unsigned long long)theEntry->fReference.fMicrosecondsSaved);
+		else
+			fputs("null", theReport);
+	}
+
+	fputs("}\n", theReport);
+}
+
+
+//////////
+//
+// QTBatch_GetStatusName
+// Return the name used for the specified status in reports.
+//
+//////////
+
+static const char *QTBatch_GetStatusName (long theStatus)
+{
+	switch (theStatus) {
+		case kBatchStatusConverted:		return("converted");
+		case kBatchStatusInPlace:		return("inPlace");
+		case kBatchStatusReferenced:	return("referenced");
+		case kBatchStatusFailed:		return("failed");
+		default:						return("pending");
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Stub importer.
+//
+// The stub importer treats .mov files as importable in place and "converts" everything else by copying
+// it; this gives the engine real files to write and time when QuickTime is not available.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static QTBatchImporterRecord		gStubImporter = {
+	NULL,
+	QTBatch_StubCanImportInPlace,
+	QTBatch_StubConvertFile,
+	0
+};
+
+
+//////////
+//
+// QTBatch_GetStubImporter
+// Return an importer that does not need QuickTime.
+//
+//////////
+
+QTBatchImporterPtr QTBatch_GetStubImporter (void)
+{
+	return(&gStubImporter);
+}
+
+
+//////////
+//
+// QTBatch_StubCanImportInPlace
+// The stub importer can open only movie files in place.
+//
+//////////
+
+static Boolean QTBatch_StubCanImportInPlace (void *theRefCon, const char *theInPath)
+{
+#pragma unused(theRefCon)
+
+	return(QTSys_CompareStringsNoCase(QTSys_GetFileExtension(theInPath), kBatchConvertedExtension) == 0);
+}
+
+
+//////////
+//
+// QTBatch_StubConvertFile
+// The stub importer "converts" a file by copying its data.
+//
+//////////
+
+static OSErr QTBatch_StubConvertFile (void *theRefCon, const char *theInPath, const char *theOutPath)
+{
+#pragma unused(theRefCon)
+
+	return(QTSys_CopyFile(theInPath, theOutPath, NULL));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTBatch_IsBatchCommandLine
+// Does the specified command line ask for batch mode?
+//
+//////////
+
+Boolean QTBatch_IsBatchCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kBatchSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTBatch_Main
+// Run batch mode, using the specified importer. Returns one of the kBatchExit constants.
+//
+// Usage: -batch <manifest> [-outdir <directory>] [-report <file>]
+//
+//////////
+
+int QTBatch_Main (int theArgc, char *theArgv[], QTBatchImporterPtr theImporter)
+{
+	QTBatchManifestRecord	myManifest = {NULL, 0, 0};
+	const char				*myManifestPath = NULL;
+	const char				*myOutDirectory = NULL;
+	const char				*myReportPath = NULL;
+	FILE					*myReport = stdout;
+	long					myFailedCount = 0;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kBatchSwitch) == 0) && (myIndex + 1 < theArgc))
+			myManifestPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kBatchOutDirSwitch) == 0) && (myIndex + 1 < theArgc))
+			myOutDirectory = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kBatchReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if ((myManifestPath == NULL) || (theImporter == NULL)) {
+		fprintf(stderr, "usage: %s %s <manifest> [%s <directory>] [%s <file>]\n", theArgv[0], kBatchSwitch, kBatchOutDirSwitch, kBatchReportSwitch);
+		return(kBatchExitUsage);
+	}
+
+	myErr = QTBatch_ReadManifest(myManifestPath, myOutDirectory, &myManifest);
+	if (myErr != noErr) {
+		fprintf(stderr, "cannot read manifest %s (error %d)\n", myManifestPath, (int)myErr);
+		return(kBatchExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			QTBatch_DisposeManifest(&myManifest);
+			return(kBatchExitUsage);
+		}
+	}
+
+	myFailedCount = QTBatch_ProcessManifest(theImporter, &myManifest, myReport);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	QTBatch_DisposeManifest(&myManifest);
+
+	return((myFailedCount == 0) ? kBatchExitSuccess : kBatchExitSomeFailed);
+}
+
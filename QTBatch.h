@@ -0,0 +1,109 @@
+//////////
+//
+//	File:		QTBatch.h
+//
+//	Contains:	A headless batch-conversion engine for importing non-movie files.
+//				All utilities start with the prefix "QTBatch_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTBatch__
+#define __QTBatch__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTReference.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kBatchSwitch						"-batch"				// command-line switch that selects batch mode
+#define kBatchReportSwitch					"-report"				// write the report to a file instead of stdout
+#define kBatchOutDirSwitch					"-outdir"				// default output directory for manifest lines that have none
+#define kBatchConvertedExtension			"mov"					// extension given to converted files
+
+#define kBatchManifestComment				'#'
+#define kBatchManifestSeparator				'\t'
+
+// status of a single manifest entry
+enum {
+	kBatchStatusPending						= 0,					// not processed yet
+	kBatchStatusConverted					= 1,					// converted into a new movie file
+	kBatchStatusInPlace						= 2,					// can be opened in place; nothing written
+	kBatchStatusReferenced					= 3,					// imported as a reference movie, pointing into the input file
+	kBatchStatusFailed						= 4						// the importer returned an error
+};
+
+// exit codes returned by QTBatch_Main
+enum {
+	kBatchExitSuccess						= 0,
+	kBatchExitSomeFailed					= 1,
+	kBatchExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// the importer interface; QTDataEx.c supplies one that calls QuickTime, and QTBatch_GetStubImporter
+// supplies one that runs anywhere, so the engine can be exercised without QuickTime
+typedef struct QTBatchImporterRecord {
+	void					*fRefCon;
+	Boolean					(*fCanImportInPlace) (void *theRefCon, const char *theInPath);
+	OSErr					(*fConvertFile) (void *theRefCon, const char *theInPath, const char *theOutPath);
+	OSType					fConversionOperation;	// the estimator history fConvertFile's rates go into, or 0
+} QTBatchImporterRecord, *QTBatchImporterPtr;
+
+// one line of a manifest, together with the outcome of processing it
+typedef struct QTBatchEntryRecord {
+	char					*fInPath;				// the file to import
+	char					*fOutDirectory;			// the directory to write the converted movie into
+	char					fOutPath[kQTSysMaxPath];// the converted movie file (valid once processed)
+	long					fStatus;				// one of the kBatchStatus constants
+	OSErr					fErr;					// error returned by the importer, if any
+	QTUInt64				fWallMicroseconds;		// wall time spent on this entry
+	QTUInt64				fBytesWritten;			// size of the converted movie file
+	QTRefStatsRecord		fReference;				// what importing by reference saved (if fStatus is kBatchStatusReferenced)
+} QTBatchEntryRecord, *QTBatchEntryPtr;
+
+typedef struct QTBatchManifestRecord {
+	QTBatchEntryPtr			fEntries;
+	long					fCount;
+	long					fCapacity;
+} QTBatchManifestRecord, *QTBatchManifestPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTBatch_ReadManifest (const char *thePath, const char *theDefaultOutDirectory, QTBatchManifestPtr theManifest);
+OSErr						QTBatch_AddEntry (QTBatchManifestPtr theManifest, const char *theInPath, const char *theOutDirectory);
+void						QTBatch_DisposeManifest (QTBatchManifestPtr theManifest);
+
+OSErr						QTBatch_ProcessEntry (QTBatchImporterPtr theImporter, QTBatchEntryPtr theEntry);
+long						QTBatch_ProcessManifest (QTBatchImporterPtr theImporter, QTBatchManifestPtr theManifest, FILE *theReport);
+void						QTBatch_WriteEntryReport (FILE *theReport, QTBatchEntryPtr theEntry);
+
+QTBatchImporterPtr			QTBatch_GetStubImporter (void);
+
+Boolean						QTBatch_IsBatchCommandLine (int theArgc, char *theArgv[]);
+int							QTBatch_Main (int theArgc, char *theArgv[], QTBatchImporterPtr theImporter);
+
+#endif	// __QTBatch__
@@ -0,0 +1,589 @@
+//////////
+//
+//	File:		QTCommandLine.c
+//
+//	Contains:	Portable functions for splitting command lines, reading response files, and opening the files they name in parallel.
+//				All utilities start with the prefix "QTCmd_".
+//
+//	QTFrame_OpenCommandLineMovies used to find where one file name ends and the next begins by asking
+//	FindFirstFile about every prefix of the command line that ends at a space, and then asked the shell
+//	for the type name of each file; with many files, or files on a server, that took a long time. Now we
+//	split the command line the way the C runtime splits it for main (QTCmd_SplitCommandLine), so names
+//	with spaces must be quoted, as Explorer quotes them. An argument "@list" stands for the arguments in
+//	the file list, one per line, so a command line can name more files than fit on it.
+//
+//	QTCmd_OpenFiles then probes the files (QTProbe.c), and reads the sample tables of those that are
+//	movies (QTSampleTable.c), on a pool of worker threads. The framework opens the movies it finds,
+//	in the order they were given; -open does the same work without QuickTime and reports on it.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTCommandLine.h"
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// what the workers of QTCmd_OpenFiles share
+typedef struct QTCmdOpenRunRecord {
+	QTCmdOpenEntryPtr		fEntries;
+	long					fCount;
+	long					fFlags;
+	volatile long			fNextIndex;				// of the next file to open
+} QTCmdOpenRunRecord, *QTCmdOpenRunPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static Boolean				QTCmd_IsSpace (char theChar);
+static OSErr				QTCmd_ReadResponseFile (const char *thePath, long theDepth, QTCmdArgListPtr theArgs);
+static OSErr				QTCmd_AddExpandedArgument (const char *theArg, long theDepth, QTCmdArgListPtr theArgs);
+static void					QTCmd_OpenEntry (QTCmdOpenEntryPtr theEntry, long theFlags);
+static void					QTCmd_OpenThread (void *theRefCon);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Argument functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTCmd_AddArgument
+// Append a copy of the theLength characters at theArg to the specified argument list.
+//
+//////////
+
+OSErr QTCmd_AddArgument (QTCmdArgListPtr theArgs, const char *theArg, size_t theLength)
+{
+	char			*myArg = NULL;
+
+	if ((theArgs == NULL) || (theArg == NULL))
+		return(paramErr);
+
+	// grow the argument array, if necessary
+	if (theArgs->fCount == theArgs->fCapacity) {
+		long			myCapacity = (theArgs->fCapacity == 0) ? kCmdInitialCapacity : theArgs->fCapacity * 2;
+		char			**myArgs;
+
+		myArgs = (char **)realloc(theArgs->fArgs, myCapacity * sizeof(char *));
+		if (myArgs == NULL)
+			return(memFullErr);
+
+		theArgs->fArgs = myArgs;
+		theArgs->fCapacity = myCapacity;
+	}
+
+	myArg = (char *)malloc(theLength + 1);
+	if (myArg == NULL)
+		return(memFullErr);
+
+	memcpy(myArg, theArg, theLength);
+	myArg[theLength] = '\0';
+
+	theArgs->fArgs[theArgs->fCount++] = myArg;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTCmd_SplitCommandLine
+// Split a command line (such as GetCommandLine returns) into arguments, and append them to theArgs.
+//
+// We follow the rules of the Microsoft C runtime. Arguments are separated by spaces and tabs, except
+// inside double quotes. A backslash is an ordinary character unless a double quote follows a run of
+// them: then 2n backslashes stand for n, and the quote marks the start or end of a quoted part, while
+// 2n + 1 backslashes stand for n and a literal quote. Inside quotes, two quotes in a row stand for one.
+// If theHasProgramName is true, the first argument is the program's name, which ends at the next quote
+// if it starts with one and at the next space or tab if not, and has no escapes.
+//
+//////////
+
+OSErr QTCmd_SplitCommandLine (const char *theCommandLine, Boolean theHasProgramName, QTCmdArgListPtr theArgs)
+{
+	const char		*myChar = theCommandLine;
+	char			*myArg = NULL;
+	size_t			myLength;
+	Boolean			myInQuotes;
+	long			myBackslashes;
+	OSErr			myErr = noErr;
+
+	if ((theCommandLine == NULL) || (theArgs == NULL))
+		return(paramErr);
+
+	// no argument can be longer than the whole command line
+	myArg = (char *)malloc(strlen(theCommandLine) + 1);
+	if (myArg == NULL)
+		return(memFullErr);
+
+	if (theHasProgramName && (*myChar != '\0')) {
+		const char		*myStart;
+
+		if (*myChar == kCmdQuote) {
+			myStart = ++myChar;
+			while ((*myChar != '\0') && (*myChar != kCmdQuote))
+				myChar++;
+			myErr = QTCmd_AddArgument(theArgs, myStart, myChar - myStart);
+			if (*myChar == kCmdQuote)
+				myChar++;
+		} else {
+			myStart = myChar;
+			while ((*myChar != '\0') && !QTCmd_IsSpace(*myChar))
+				myChar++;
+			myErr = QTCmd_AddArgument(theArgs, myStart, myChar - myStart);
+		}
+	}
+
+	while (myErr == noErr) {
+		while (QTCmd_IsSpace(*myChar))
+			myChar++;
+
+		if (*myChar == '\0')
+			break;
+
+		myLength = 0;
+		myInQuotes = false;
+
+		for (;;) {
+			for (myBackslashes = 0; *myChar == kCmdEscape; myChar++)
+				myBackslashes++;
+
+			if (*myChar == kCmdQuote) {
+				for (; myBackslashes >= 2; myBackslashes -= 2)
+					myArg[myLength++] = kCmdEscape;
+
+				if (myBackslashes == 1) {
+					myArg[myLength++] = kCmdQuote;
+				} else if (myInQuotes && (myChar[1] == kCmdQuote)) {
+					myArg[myLength++] = kCmdQuote;
+					myChar++;
+				} else {
+					myInQuotes = !myInQuotes;
+				}
+
+				myChar++;
+				continue;
+			}
+
+			for (; myBackslashes > 0; myBackslashes--)
+				myArg[myLength++] = kCmdEscape;
+
+			if ((*myChar == '\0') || (QTCmd_IsSpace(*myChar) && !myInQuotes))
+				break;
+
+			myArg[myLength++] = *myChar++;
+		}
+
+		myErr = QTCmd_AddArgument(theArgs, myArg, myLength);
+	}
+
+	free(myArg);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTCmd_ExpandResponseFiles
+// Append theArgc arguments to theArgs, replacing each "@list" with the arguments in the file list.
+//
+// A response file holds one argument per line, so a file name needs no quotes even if it has spaces
+// in it; if it is quoted anyway, the quotes are removed. Blank lines and lines beginning with '#' are
+// ignored, and a line beginning with '@' names another response file.
+//
+//////////
+
+OSErr QTCmd_ExpandResponseFiles (char *theArgv[], long theArgc, QTCmdArgListPtr theArgs)
+{
+	long			myIndex;
+	OSErr			myErr = noErr;
+
+	if ((theArgv == NULL) || (theArgs == NULL))
+		return(paramErr);
+
+	for (myIndex = 0; (myIndex < theArgc) && (myErr == noErr); myIndex++)
+		myErr = QTCmd_AddExpandedArgument(theArgv[myIndex], 0, theArgs);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTCmd_DisposeArguments
+// Release the memory held by the specified argument list; the list record itself is not freed.
+//
+//////////
+
+void QTCmd_DisposeArguments (QTCmdArgListPtr theArgs)
+{
+	long		myIndex;
+
+	if (theArgs == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theArgs->fCount; myIndex++)
+		free(theArgs->fArgs[myIndex]);
+
+	free(theArgs->fArgs);
+	memset(theArgs, 0, sizeof(QTCmdArgListRecord));
+}
+
+
+//////////
+//
+// QTCmd_IsSpace
+// Does the specified character separate arguments?
+//
+//////////
+
+static Boolean QTCmd_IsSpace (char theChar)
+{
+	return((theChar == ' ') || (theChar == '\t'));
+}
+
+
+//////////
+//
+// QTCmd_AddExpandedArgument
+// Append an argument to theArgs, or, if it names a response file, the arguments in that file.
+//
+//////////
+
+static OSErr QTCmd_AddExpandedArgument (const char *theArg, long theDepth, QTCmdArgListPtr theArgs)
+{
+	if ((theArg[0] == kCmdResponseFilePrefix) && (theArg[1] != '\0'))
+		return(QTCmd_ReadResponseFile(theArg + 1, theDepth + 1, theArgs));
+
+	return(QTCmd_AddArgument(theArgs, theArg, strlen(theArg)));
+}
+
+
+//////////
+//
+// QTCmd_ReadResponseFile
+// Append the arguments in a response file to theArgs.
+//
+//////////
+
+static OSErr QTCmd_ReadResponseFile (const char *thePath, long theDepth, QTCmdArgListPtr theArgs)
+{
+	FILE			*myFile = NULL;
+	char			myLine[kCmdMaxLineLength];
+	char			*myArg;
+	size_t			myLength;
+	OSErr			myErr = noErr;
+
+	// a response file that names itself would go on for ever
+	if (theDepth > kCmdMaxResponseDepth)
+		return(paramErr);
+
+	myFile = fopen(thePath, "r");
+	if (myFile == NULL)
+		return(fnfErr);
+
+	while ((myErr == noErr) && (fgets(myLine, sizeof(myLine), myFile) != NULL)) {
+		myArg = QTSys_TrimLine(myLine);
+		if ((*myArg == '\0') || (*myArg == kCmdResponseFileComment))
+			continue;
+
+		myLength = strlen(myArg);
+		if ((myLength >= 2) && (myArg[0] == kCmdQuote) && (myArg[myLength - 1] == kCmdQuote)) {
+			myArg[myLength - 1] = '\0';
+			myErr = QTCmd_AddArgument(theArgs, myArg + 1, myLength - 2);
+		} else {
+			myErr = QTCmd_AddExpandedArgument(myArg, theDepth, theArgs);
+		}
+	}
+
+	fclose(myFile);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Opening functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTCmd_OpenFiles
+// Probe the files named by theEntries (and, if theFlags asks, read the sample tables of the movies)
+// on theWorkerCount threads, filling in the rest of each entry.
+//
+// A worker count of 0 or less means one worker per processor.
+//
+//////////
+
+OSErr QTCmd_OpenFiles (QTCmdOpenEntryPtr theEntries, long theCount, long theWorkerCount, long theFlags)
+{
+	QTCmdOpenRunRecord		myRun;
+	QTSysThread				myThreads[kCmdMaxWorkers];
+	long					myThreadCount = 0;
+	long					myIndex;
+
+	if ((theEntries == NULL) && (theCount > 0))
+		return(paramErr);
+
+	if (theWorkerCount <= 0)
+		theWorkerCount = QTSys_GetProcessorCount();
+	if (theWorkerCount > kCmdMaxWorkers)
+		theWorkerCount = kCmdMaxWorkers;
+	if (theWorkerCount > theCount)
+		theWorkerCount = theCount;
+
+	myRun.fEntries = theEntries;
+	myRun.fCount = theCount;
+	myRun.fFlags = theFlags;
+	myRun.fNextIndex = 0;
+
+	// a single file isn't worth a thread
+	for (myIndex = 0; (myIndex < theWorkerCount) && (theWorkerCount > 1); myIndex++) {
+		if (QTSys_NewThread(QTCmd_OpenThread, &myRun, &myThreads[myThreadCount]) != noErr)
+			break;
+
+		myThreadCount++;
+	}
+
+	// this thread takes part too, so the work gets done even if we couldn't start any threads
+	QTCmd_OpenThread(&myRun);
+
+	for (myIndex = 0; myIndex < myThreadCount; myIndex++)
+		QTSys_JoinThread(myThreads[myIndex]);
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTCmd_WriteOpenEntry
+// Write what we found out about one file to theStream, as one line of JSON.
+//
+//////////
+
+void QTCmd_WriteOpenEntry (FILE *theStream, QTCmdOpenEntryPtr theEntry)
+{
+	static const char		*myKindNames[] = {"none", "quicktime", "mpeg4"};
+
+	fputs("{\"file\":", theStream);
+	QTSys_WriteJSONString(theStream, theEntry->fPath);
+	fprintf(theStream, ",\"err\":%d,\"kind\":\"%s\",\"movie\":%s,\"trackCount\":%ld,\"samples\":%llu,\"microseconds\":%llu}\n",
+				(int)theEntry->fErr,
+				myKindNames[theEntry->fInfo.fKind],
+				theEntry->fIsMovie ? "true" : "false",
+				theEntry->fInfo.fTrackCount,
+				(unsigned long long)theEntry->fSampleCount,
+				(unsigned long long)theEntry->fMicroseconds);
+}
+
+
+//////////
+//
+// QTCmd_OpenEntry
+// Probe one file and, if theFlags asks and it's a movie, read its sample tables.
+//
+//////////
+
+static void QTCmd_OpenEntry (QTCmdOpenEntryPtr theEntry, long theFlags)
+{
+	QTAtomReaderRecord		myReader;
+	QTStblMovieRecord		myMovie;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	memset(&theEntry->fInfo, 0, sizeof(theEntry->fInfo));
+	theEntry->fIsMovie = false;
+	theEntry->fSampleCount = 0;
+
+	myErr = QTProbe_ProbeFile(theEntry->fPath, &theEntry->fInfo);
+	if (myErr == noErr)
+		theEntry->fIsMovie = QTProbe_IsMovie(&theEntry->fInfo);
+
+	if ((myErr == noErr) && theEntry->fIsMovie && (theFlags & kCmdOpenSampleTables)) {
+		myErr = QTAtom_OpenFileReader(theEntry->fPath, &myReader);
+		if (myErr == noErr) {
+			myErr = QTStbl_ReadMovie(&myReader, &myMovie);
+			if (myErr == noErr) {
+				for (myIndex = 0; myIndex < myMovie.fTrackCount; myIndex++)
+					theEntry->fSampleCount += myMovie.fTracks[myIndex].fSampleCount;
+
+				QTStbl_DisposeMovie(&myMovie);
+			}
+
+			QTAtom_CloseFileReader(&myReader);
+		}
+	}
+
+	theEntry->fErr = myErr;
+	theEntry->fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+}
+
+
+//////////
+//
+// QTCmd_OpenThread
+// Open files until there are none left.
+//
+//////////
+
+static void QTCmd_OpenThread (void *theRefCon)
+{
+	QTCmdOpenRunPtr		myRun = (QTCmdOpenRunPtr)theRefCon;
+	long				myIndex;
+
+	for (;;) {
+		myIndex = QTSys_AtomicAdd(&myRun->fNextIndex, 1) - 1;
+		if (myIndex >= myRun->fCount)
+			break;
+
+		QTCmd_OpenEntry(&myRun->fEntries[myIndex], myRun->fFlags);
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTCmd_IsOpenCommandLine
+// Does the specified command line ask to open files without the user interface?
+//
+//////////
+
+Boolean QTCmd_IsOpenCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kCmdOpenSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTCmd_Main
+// Open the files named on the command line, in parallel, and report on them. Returns one of the kCmdExit constants.
+//
+// Usage: -open <file or @list> ... [-workers <count>] [-probeonly] [-report <file>]
+//
+// The report has a line of JSON per file, in the order they were given, and a summary.
+//
+//////////
+
+int QTCmd_Main (int theArgc, char *theArgv[])
+{
+	QTCmdArgListRecord		myFiles = {NULL, 0, 0};
+	QTCmdOpenEntryPtr		myEntries = NULL;
+	const char				*myReportPath = NULL;
+	FILE					*myReport = stdout;
+	QTUInt64				myStartTime;
+	QTUInt64				myElapsed;
+	QTUInt64				mySampleCount = 0;
+	long					myWorkerCount = 0;
+	long					myFlags = kCmdOpenSampleTables;
+	long					myMovieCount = 0;
+	long					myFailedCount = 0;
+	long					myIndex;
+	int						myExitCode = kCmdExitUsage;
+	OSErr					myErr = noErr;
+
+	myStartTime = QTSys_GetMicroseconds();
+
+	for (myIndex = 1; (myIndex < theArgc) && (myErr == noErr); myIndex++) {
+		if ((strcmp(theArgv[myIndex], kCmdWorkersSwitch) == 0) && (myIndex + 1 < theArgc))
+			myWorkerCount = atol(theArgv[++myIndex]);
+		else if (strcmp(theArgv[myIndex], kCmdProbeOnlySwitch) == 0)
+			myFlags &= ~kCmdOpenSampleTables;
+		else if ((strcmp(theArgv[myIndex], kCmdReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+		else if (strcmp(theArgv[myIndex], kCmdOpenSwitch) != 0)
+			myErr = QTCmd_ExpandResponseFiles(&theArgv[myIndex], 1, &myFiles);
+	}
+
+	if ((myErr != noErr) || (myFiles.fCount == 0)) {
+		if (myErr != noErr)
+			fprintf(stderr, "cannot read the list of files (error %d)\n", (int)myErr);
+		fprintf(stderr, "usage: %s %s <file or @list> ... [%s <count>] [%s] [%s <file>]\n", theArgv[0], kCmdOpenSwitch, kCmdWorkersSwitch, kCmdProbeOnlySwitch, kCmdReportSwitch);
+		goto bail;
+	}
+
+	myEntries = (QTCmdOpenEntryPtr)calloc(myFiles.fCount, sizeof(QTCmdOpenEntryRecord));
+	if (myEntries == NULL) {
+		fprintf(stderr, "not enough memory for %ld files\n", myFiles.fCount);
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < myFiles.fCount; myIndex++)
+		myEntries[myIndex].fPath = myFiles.fArgs[myIndex];
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			goto bail;
+		}
+	}
+
+	QTCmd_OpenFiles(myEntries, myFiles.fCount, myWorkerCount, myFlags);
+
+	for (myIndex = 0; myIndex < myFiles.fCount; myIndex++) {
+		QTCmd_WriteOpenEntry(myReport, &myEntries[myIndex]);
+
+		if (myEntries[myIndex].fErr != noErr)
+			myFailedCount++;
+		else if (myEntries[myIndex].fIsMovie)
+			myMovieCount++;
+
+		mySampleCount += myEntries[myIndex].fSampleCount;
+	}
+
+	myElapsed = QTSys_GetMicroseconds() - myStartTime;
+	fprintf(myReport, "{\"summary\":true,\"files\":%ld,\"movies\":%ld,\"failed\":%ld,\"samples\":%llu,\"wallMicroseconds\":%llu,\"filesPerSecond\":%.1f}\n",
+				myFiles.fCount,
+				myMovieCount,
+				myFailedCount,
+				(unsigned long long)mySampleCount,
+				(unsigned long long)myElapsed,
+				(myElapsed > 0) ? (double)myFiles.fCount * 1000000.0 / (double)myElapsed : 0.0);
+	fflush(myReport);
+
+	myExitCode = (myFailedCount == 0) ? kCmdExitSuccess : kCmdExitSomeFailed;
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+bail:
+	free(myEntries);
+	QTCmd_DisposeArguments(&myFiles);
+
+	return(myExitCode);
+}
@@ -0,0 +1,99 @@
+//////////
+//
+//	File:		QTCommandLine.h
+//
+//	Contains:	Portable functions for splitting command lines, reading response files, and opening the files they name in parallel.
+//				All utilities start with the prefix "QTCmd_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTCommandLine__
+#define __QTCommandLine__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTProbe.h"
+#include "QTSampleTable.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kCmdOpenSwitch						"-open"					// command-line switch that opens the files that follow it
+#define kCmdWorkersSwitch					"-workers"				// number of files opened at once
+#define kCmdProbeOnlySwitch					"-probeonly"			// just probe the files, without reading their sample tables
+#define kCmdReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kCmdResponseFilePrefix				'@'						// "@list" stands for the arguments in the file list
+#define kCmdResponseFileComment				'#'
+#define kCmdQuote							'"'
+#define kCmdEscape							'\\'
+#define kCmdMaxResponseDepth				8						// response files may name other response files, this deep
+#define kCmdMaxLineLength					(kQTSysMaxPath + 16)
+#define kCmdInitialCapacity					64
+#define kCmdMaxWorkers						64
+
+// flags for QTCmd_OpenFiles
+enum {
+	kCmdOpenSampleTables					= 1L << 0				// read the sample tables of every movie, as opening it would
+};
+
+// exit codes returned by QTCmd_Main
+enum {
+	kCmdExitSuccess							= 0,
+	kCmdExitSomeFailed						= 1,
+	kCmdExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTCmdArgListRecord {
+	char					**fArgs;
+	long					fCount;
+	long					fCapacity;
+} QTCmdArgListRecord, *QTCmdArgListPtr;
+
+// one file to open, and what we found
+typedef struct QTCmdOpenEntryRecord {
+	const char				*fPath;
+	OSErr					fErr;
+	QTProbeInfoRecord		fInfo;
+	Boolean					fIsMovie;
+	QTUInt64				fSampleCount;			// in all tracks, if we read the sample tables
+	QTUInt64				fMicroseconds;
+} QTCmdOpenEntryRecord, *QTCmdOpenEntryPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTCmd_AddArgument (QTCmdArgListPtr theArgs, const char *theArg, size_t theLength);
+OSErr						QTCmd_SplitCommandLine (const char *theCommandLine, Boolean theHasProgramName, QTCmdArgListPtr theArgs);
+OSErr						QTCmd_ExpandResponseFiles (char *theArgv[], long theArgc, QTCmdArgListPtr theArgs);
+void						QTCmd_DisposeArguments (QTCmdArgListPtr theArgs);
+
+OSErr						QTCmd_OpenFiles (QTCmdOpenEntryPtr theEntries, long theCount, long theWorkerCount, long theFlags);
+void						QTCmd_WriteOpenEntry (FILE *theStream, QTCmdOpenEntryPtr theEntry);
+
+Boolean						QTCmd_IsOpenCommandLine (int theArgc, char *theArgv[]);
+int							QTCmd_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTCommandLine__
@@ -45,11 +45,61 @@ MovieProgressUPP			gMovieProgressProcUPP = NULL;				// UPP to our custom movie p
 ICMProgressUPP				gImageProgressProcUPP = NULL;				// UPP to our custom image progress dialog box procedure
 UserItemUPP					gProgressUserItemProcUPP = NULL;			// UPP to our custom progress dialog user item procedure
 Boolean						gUserCancelled = false;						// did the user cancel a long operation? (Windows only)
+QTProgressRecord			gMovieProgress;								// the progress that QTDX_MovieProgressProc has been told about
+QTEstimatorRecord			gMovieEstimator;							// and how long it thinks the operation has left
+QTTelStreamRecord			gMovieTelemetry;							// and its telemetry, if QTDATAEX_TELEMETRY names a sink
 
 extern short 				gAppResFile;								// file reference number for this application's resource file
+#if USE_NATIVE_HINTER
+extern HANDLE				ghInst;										// the instance of this application
+extern HWND					ghWnd;										// the MDI frame window, which owns our dialog boxes
+#endif
 extern Handle 				gValidFileTypes;							// the list of file types that our application can open
 
 StringPtr					gSettingsFileName;							// the name of our settings preferences file
+#if USE_SETTINGS_CACHE
+QTSetCachePtr				gSettingsCache = NULL;						// exporter settings we've already read from settings files
+#endif
+
+static QTBatchImporterRecord	gBatchImporter = {							// importer used by the headless batch mode
+	NULL,
+	QTDX_BatchCanImportInPlace,
+	QTDX_BatchConvertFile,
+	kBatchImportOperation
+};
+
+static QTSchedExporterRecord	gSchedulerExporter = {						// exporter used by the headless parallel export mode
+	NULL,
+	QTDX_SchedulerNewWorker,
+	QTDX_SchedulerExportJob,
+	QTDX_SchedulerDisposeWorker
+};
+
+static QTPreRendererRecord		gLadderRenderer = {							// renderer used by the headless ladder mode
+	NULL,
+	QTDX_LadderOpenSource,
+	QTDX_LadderRender,
+	QTDX_LadderCloseSource
+};
+
+static QTSeqImporterRecord		gSequenceImporter = {						// importer used by the headless sequence mode
+	NULL,
+	QTDX_SequenceGetFrameSize,
+	QTDX_SequenceNewDecoder,
+	QTDX_SequenceDecodeFrame,
+	QTDX_SequenceDisposeDecoder,
+	QTDX_SequenceBeginMovie,
+	QTDX_SequenceAddFrame,
+	QTDX_SequenceEndMovie
+};
+
+// the constant strings we give to the Toolbox, as Pascal strings built by the compiler
+QTUTILS_DEFINE_PSTRING(gImportSavePrompt, kImportSavePrompt);
+QTUTILS_DEFINE_PSTRING(gHintedMovieSavePrompt, kHintedMovieSavePrompt);
+QTUTILS_DEFINE_PSTRING(gHintedMovieFileName, kHintedMovieFileName);
+QTUTILS_DEFINE_PSTRING(gHintedMovieTempFileName, kHintedMovieTempFileName);
+QTUTILS_DEFINE_PSTRING(gSettingsTempFileName, kSettingsTempFileName);
+QTUTILS_DEFINE_PSTRING(gTimeRemainingLabel, kTimeRemainingLabel);
 
 
 //////////
@@ -67,10 +117,14 @@ OSErr QTDX_ImportAnyNonMovie (void)
 	Movie					myMovie = NULL;
 	FSSpec					myFileToConvert;
 	FSSpec					myConvertedFile;
-	StringPtr 				myPrompt = QTUtils_ConvertCToPascalString(kImportSavePrompt);
+	ConstStringPtr			myPrompt = QTUTILS_PSTRING(gImportSavePrompt);
 	OSErr					myErr = noErr;
 
 #if TARGET_OS_WIN32
+	myErr = QTFrame_BuildFileTypeList();
+	if (myErr != noErr)
+		goto bail;
+		
 	myTypeListPtr = (QTFrameTypeListPtr)&gValidFileTypes[1];						// [0] is kQTFileTypeMovie	
 	myNumTypes = (short)(GetPtrSize((Ptr)gValidFileTypes) / sizeof(OSType)) - 1;
 #endif
@@ -130,8 +184,6 @@ OSErr QTDX_ImportAnyNonMovie (void)
 bail:
 	if (myFileFilterUPP != NULL)
 		DisposeNavObjectFilterUPP(myFileFilterUPP);
-		
-	free(myPrompt);
 
 	return(myErr);
 }
@@ -139,123 +191,1856 @@ bail:
 
 //////////
 //
-// QTDX_ExportMovieAsAnyTypeFile
-// Export the specified movie as a file whose type the user selects.
+// QTDX_GetBatchImporter
+// Return the importer that the batch engine in QTBatch.c uses to import files with QuickTime.
+//
+// The batch engine runs without any user interface, so unlike QTDX_ImportAnyNonMovie we do the
+// conversion ourselves on both platforms (there is no StandardGetFilePreview to do it for us).
 //
 //////////
 
-OSErr QTDX_ExportMovieAsAnyTypeFile (Movie theMovie, FSSpec *theFSSpec)
+QTBatchImporterPtr QTDX_GetBatchImporter (void)
 {
-	FSSpec					myFSSpec = *theFSSpec;
-	long					myFlags = 0L;
+	return(&gBatchImporter);
+}
+
+
+//////////
+//
+// QTDX_BatchCanImportInPlace
+// Can the file at the specified path be opened in place?
+//
+//////////
+
+static Boolean QTDX_BatchCanImportInPlace (void *theRefCon, const char *theInPath)
+{
+#pragma unused(theRefCon)
+
+	FSSpec					myFSSpec;
+	FInfo					myFileInfo;
 	OSErr					myErr = noErr;
 
-	myFlags = createMovieFileDeleteCurFile | showUserSettingsDialog | movieFileSpecValid | movieToFileOnlyExport;
-	
+	myErr = NativePathNameToFSSpec((char *)theInPath, &myFSSpec, 0L);
+	if (myErr != noErr)
+		return(false);
+
+	// movie files need no importer at all
+	myErr = FSpGetFInfo(&myFSSpec, &myFileInfo);
+	if ((myErr == noErr) && (myFileInfo.fdType == kQTFileTypeMovie))
+		return(true);
+
+	return(QTDX_FileCanBeImportedInPlace(&myFSSpec));
+}
+
+
+//////////
+//
+// QTDX_BatchConvertFile
+// Convert the file at theInPath into a movie file at theOutPath.
+//
+//////////
+
+static OSErr QTDX_BatchConvertFile (void *theRefCon, const char *theInPath, const char *theOutPath)
+{
+#pragma unused(theRefCon)
+
+	FSSpec					myFileToConvert;
+	FSSpec					myConvertedFile;
+	QTTelSinkPtr			mySink = QTTel_GetDefaultSink();
+	QTDXImportProgressRecord	myProgress;
+	MovieProgressUPP		myProgressUPP = NULL;
+	QTUInt64				myInputBytes = 0;
+	OSErr					myErr = noErr;
+
+	// there is no one to watch a progress dialog box, but there may be someone reading our telemetry;
+	// and we always time the conversion, so that reference imports can tell how much time they save
+	memset(&myProgress, 0, sizeof(myProgress));
+	QTSys_GetPathSize(theInPath, &myInputBytes);
+	QTEst_Init(&myProgress.fEstimator, kBatchImportOperation, myInputBytes, QTSys_GetMicroseconds());
+	if (mySink != NULL)
+		QTTel_BeginStream(&myProgress.fTelemetry, mySink, QTSys_GetFileName(theInPath), "import", 0, theOutPath, myInputBytes, 0, &myProgress.fEstimator);
+	myProgressUPP = NewMovieProgressUPP(QTDX_ImportProgressProc);
+
+	myErr = NativePathNameToFSSpec((char *)theInPath, &myFileToConvert, 0L);
+	if (myErr != noErr)
+		goto bail;
+
+	// the converted file doesn't exist yet, so we expect fnfErr here
+	myErr = NativePathNameToFSSpec((char *)theOutPath, &myConvertedFile, 0L);
+	if ((myErr != noErr) && (myErr != fnfErr))
+		goto bail;
+
+  	// import the file into a movie; the progress procedure only keeps the estimate and reports telemetry
+	myErr = ConvertFileToMovieFile(
+						&myFileToConvert,			// the file to convert
+						&myConvertedFile,			// the file to convert it into
+						FOUR_CHAR_CODE('TVOD'),		// the output file creator
+						smSystemScript,				// the script
+						NULL,
+						createMovieFileDeleteCurFile,
+						NULL,
+						myProgressUPP,
+						(long)&myProgress);
+
+	if (myErr == noErr) {
+		QTEst_Update(&myProgress.fEstimator, kProgDone, QTSys_GetMicroseconds());
+		QTEst_Finish(&myProgress.fEstimator, QTSys_GetMicroseconds());
+	}
+
+bail:
+	QTTel_EndStream(&myProgress.fTelemetry, myErr);
+	DisposeMovieProgressUPP(myProgressUPP);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_ImportProgressProc
+// Movie progress procedure for batch imports; it keeps the import's time estimate up to date and reports telemetry.
+//
+// The refcon is the import's QTDXImportProgressRecord.
+//
+//////////
+
+PASCAL_RTN OSErr QTDX_ImportProgressProc (Movie theMovie, short theMessage, short theOperation, Fixed thePercentDone, long theRefcon)
+{
+#pragma unused(theMovie, theOperation)
+
+	QTDXImportProgressPtr	myProgress = (QTDXImportProgressPtr)theRefcon;
+
+	if (theMessage == movieProgressUpdatePercent) {
+		QTEst_Update(&myProgress->fEstimator, (long)thePercentDone, QTSys_GetMicroseconds());
+		QTTel_UpdateStream(&myProgress->fTelemetry, (long)thePercentDone);
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_GetSchedulerExporter
+// Return the exporter that the parallel export scheduler in QTScheduler.c uses to export movies with QuickTime.
+//
+// This does the work of QTDX_ExportMovieAsAnyTypeFile, but on the scheduler's worker threads and without
+// any user interface: there is no settings dialog box, so each exporter runs with its default settings.
+//
+//////////
+
+QTSchedExporterPtr QTDX_GetSchedulerExporter (void)
+{
+	return(&gSchedulerExporter);
+}
+
+
+//////////
+//
+// QTDX_SchedulerNewWorker
+// Prepare the calling worker thread to use QuickTime, and create its (initially empty) worker state.
+//
+// After EnterMoviesOnThread, the Component Manager hands this thread only components that are marked as
+// thread-safe; a job whose file type has no thread-safe exporter fails with badComponentType, rather than
+// running an exporter that might corrupt the state of another thread's exporter.
+//
+//////////
+
+static OSErr QTDX_SchedulerNewWorker (void *theRefCon, void **theWorkerData)
+{
+#pragma unused(theRefCon)
+
+	QTDXExportWorkerPtr		myWorker = NULL;
+	OSErr					myErr = noErr;
+
+	*theWorkerData = NULL;
+
+	myErr = EnterMoviesOnThread(0L);
+	if (myErr != noErr)
+		return(myErr);
+
+	myWorker = (QTDXExportWorkerPtr)calloc(1, sizeof(QTDXExportWorkerRecord));
+	if (myWorker == NULL) {
+		ExitMoviesOnThread();
+		return(memFullErr);
+	}
+
+	myWorker->fProgressUPP = NewMovieProgressUPP(QTDX_SchedulerProgressProc);
+
+	*theWorkerData = myWorker;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_SchedulerExportJob
+// Export the movie named by the specified job, using this worker's own exporter instance.
+//
+// A worker keeps its exporter open from one job to the next, and opens a new one only when the job asks
+// for a different file type. A job whose file type is kRemuxFileType needs no exporter at all.
+//
+//////////
+
+static OSErr QTDX_SchedulerExportJob (void *theWorkerData, QTSchedJobPtr theJob)
+{
+	QTDXExportWorkerPtr		myWorker = (QTDXExportWorkerPtr)theWorkerData;
+	ComponentDescription	myCompDesc;
+	FSSpec					myInFSSpec;
+	FSSpec					myOutFSSpec;
+	Movie					myMovie = NULL;
+	short					myRefNum = kInvalidFileRefNum;
+	long					myFlags = createMovieFileDeleteCurFile | movieFileSpecValid | movieToFileOnlyExport;
+	QTUInt64				myInputBytes;
+	OSErr					myErr = noErr;
+
+	if (theJob->fFileType == kRemuxFileType)
+		return(QTDX_SchedulerRemuxJob(myWorker, theJob));
+
+	// find and open an exporter for the job's file type, if this worker doesn't already have one
+	if ((myWorker->fExporter == NULL) || (myWorker->fFileType != theJob->fFileType)) {
+		if (myWorker->fExporter != NULL)
+			CloseComponent(myWorker->fExporter);
+
+		myCompDesc.componentType = MovieExportType;
+		myCompDesc.componentSubType = theJob->fFileType;
+		myCompDesc.componentManufacturer = 0;
+		myCompDesc.componentFlags = canMovieExportFiles;
+		myCompDesc.componentFlagsMask = canMovieExportFiles;
+		myWorker->fExporter = OpenComponent(FindNextComponent(NULL, &myCompDesc));
+		myWorker->fFileType = theJob->fFileType;
+		if (myWorker->fExporter == NULL) {
+			myErr = badComponentType;
+			goto bail;
+		}
+	}
+
+	myErr = NativePathNameToFSSpec((char *)theJob->fInPath, &myInFSSpec, 0L);
+	if (myErr != noErr)
+		goto bail;
+
+	// the exported file usually doesn't exist yet, so we expect fnfErr here
+	myErr = NativePathNameToFSSpec((char *)theJob->fOutPath, &myOutFSSpec, 0L);
+	if ((myErr != noErr) && (myErr != fnfErr))
+		goto bail;
+
+	myErr = OpenMovieFile(&myInFSSpec, &myRefNum, fsRdPerm);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = NewMovieFromFile(&myMovie, myRefNum, NULL, NULL, newMovieActive, NULL);
+	if (myErr != noErr)
+		goto bail;
+
+	// the progress procedure is where we notice that the job has been cancelled, and where we update
+	// its time estimate and telemetry; the work is the length of the movie, and the history is that of
+	// its file type
+	myWorker->fJob = theJob;
+	SetMovieProgressProc(myMovie, myWorker->fProgressUPP, (long)myWorker);
+	QTEst_Init(&theJob->fEstimator, theJob->fFileType, (GetMovieTimeScale(myMovie) > 0) ? ((QTUInt64)GetMovieDuration(myMovie) * 1000) / GetMovieTimeScale(myMovie) : 0, QTSys_GetMicroseconds());
+
+	myInputBytes = 0;
+	QTSys_GetPathSize(theJob->fInPath, &myInputBytes);
+	QTTel_BeginStream(&myWorker->fTelemetry, QTTel_GetDefaultSink(), QTSys_GetFileName(theJob->fInPath), "export", theJob->fFileType, theJob->fOutPath, myInputBytes, QTDX_GetMovieFrameTotal(myMovie), &theJob->fEstimator);
+
 	// export the movie into a file
 	myErr = ConvertMovieToFile(
-						theMovie,					// the movie to convert
+						myMovie,					// the movie to convert
 						NULL,						// all tracks in the movie
-						&myFSSpec,					// the output file
-						0L,							// the output file type
+						&myOutFSSpec,				// the output file
+						theJob->fFileType,			// the output file type
 						FOUR_CHAR_CODE('TVOD'),		// the output file creator
 						smSystemScript,				// the script
 						NULL, 						// no resource ID to be returned
 						myFlags,					// export flags
-						NULL);						// no specific export component
-						
+						myWorker->fExporter);		// this worker's export component
+
+	if (myErr == noErr) {
+		QTEst_Update(&theJob->fEstimator, kProgDone, QTSys_GetMicroseconds());
+		QTEst_Finish(&theJob->fEstimator, QTSys_GetMicroseconds());
+	}
+
+bail:
+	if (myMovie != NULL)
+		DisposeMovie(myMovie);
+
+	if (myRefNum != kInvalidFileRefNum)
+		CloseMovieFile(myRefNum);
+
+	if ((myErr != noErr) && QTSched_IsJobCancelled(theJob))
+		myErr = userCanceledErr;
+
+	// a job that failed before its export began still gets a start and an end event
+	if (myWorker->fTelemetry.fSink == NULL)
+		QTTel_BeginStream(&myWorker->fTelemetry, QTTel_GetDefaultSink(), QTSys_GetFileName(theJob->fInPath), "export", theJob->fFileType, NULL, 0, 0, NULL);
+	QTTel_EndStream(&myWorker->fTelemetry, myErr);
+
 	return(myErr);
 }
 
 
 //////////
 //
-// QTDX_ExportMovieAsHintedMovie
-// Add a hint track to a QuickTime movie, using the hinter movie export component.
+// QTDX_SchedulerRemuxJob
+// Copy the samples of the movie named by the specified job into its output file, without re-encoding them.
 //
-// The thePromptUser parameter determines whether we display the movie exporter
-// settings dialog box to allow the user to select export options (true) or whether we
-// try to read the export options from an existing preferences file (false).
+// QTRemux_RemuxFile doesn't call back as it goes, so the job can be cancelled only before it starts; its
+// time estimate counts bytes of input rather than milliseconds of movie.
+//
+//////////
+
+static OSErr QTDX_SchedulerRemuxJob (QTDXExportWorkerPtr theWorker, QTSchedJobPtr theJob)
+{
+	QTRemuxStatsRecord		myStats;
+	QTUInt64				myInputBytes = 0;
+	OSErr					myErr = noErr;
+
+	QTSys_GetPathSize(theJob->fInPath, &myInputBytes);
+	QTEst_Init(&theJob->fEstimator, theJob->fFileType, myInputBytes, QTSys_GetMicroseconds());
+	QTTel_BeginStream(&theWorker->fTelemetry, QTTel_GetDefaultSink(), QTSys_GetFileName(theJob->fInPath), "remux", theJob->fFileType, theJob->fOutPath, myInputBytes, 0, &theJob->fEstimator);
+
+	if (QTSched_IsJobCancelled(theJob))
+		myErr = userCanceledErr;
+	else
+		myErr = QTRemux_RemuxFile(theJob->fInPath, theJob->fOutPath, kRemuxFastStart, NULL, &myStats);
+
+	if (myErr == noErr) {
+		QTEst_Update(&theJob->fEstimator, kProgDone, QTSys_GetMicroseconds());
+		QTEst_Finish(&theJob->fEstimator, QTSys_GetMicroseconds());
+	}
+
+	QTTel_EndStream(&theWorker->fTelemetry, myErr);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_SchedulerDisposeWorker
+// Close the worker's exporter and detach the calling worker thread from QuickTime.
+//
+//////////
+
+static void QTDX_SchedulerDisposeWorker (void *theWorkerData)
+{
+	QTDXExportWorkerPtr		myWorker = (QTDXExportWorkerPtr)theWorkerData;
+
+	if (myWorker != NULL) {
+		if (myWorker->fExporter != NULL)
+			CloseComponent(myWorker->fExporter);
+
+		DisposeMovieProgressUPP(myWorker->fProgressUPP);
+		free(myWorker);
+	}
+
+	ExitMoviesOnThread();
+}
+
+
+//////////
+//
+// QTDX_SchedulerProgressProc
+// Movie progress procedure for scheduler exports; it shows no progress, but stops the export if the job is cancelled.
+//
+// The refcon is the worker doing the export.
+//
+//////////
+
+PASCAL_RTN OSErr QTDX_SchedulerProgressProc (Movie theMovie, short theMessage, short theOperation, Fixed thePercentDone, long theRefcon)
+{
+#pragma unused(theMovie, theOperation)
+
+	QTDXExportWorkerPtr		myWorker = (QTDXExportWorkerPtr)theRefcon;
+	QTSchedJobPtr			myJob = myWorker->fJob;
+
+	if (QTSched_IsJobCancelled(myJob))
+		return(userCanceledErr);
+
+	// keep the job's time estimate up to date, for QTSched_GetJobRemainingMilliseconds and for telemetry
+	if (theMessage == movieProgressUpdatePercent) {
+		QTEst_Update(&myJob->fEstimator, (long)thePercentDone, QTSys_GetMicroseconds());
+		QTTel_UpdateStream(&myWorker->fTelemetry, (long)thePercentDone);
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_GetLadderRenderer
+// Return the renderer that ladder mode (QTPresets.c) uses to make the renditions of a movie with QuickTime.
+//
+// Exporting each rendition with ConvertMovieToFile would decode the source once per rendition. Instead we
+// play the source into an offscreen graphics world one frame at a time, on this thread, and hand each
+// frame to every rendition through a bounded ring (QTFanout.c). Each rendition scales and compresses the
+// frames on a thread of its own, with its own standard compression component (or graphics exporter, for
+// thumbnails), so the renditions are compressed in parallel; the sound tracks are copied as they are.
+//
+//////////
+
+QTPreRendererPtr QTDX_GetLadderRenderer (void)
+{
+	return(&gLadderRenderer);
+}
+
+
+//////////
+//
+// QTDX_LadderOpenSource
+// Open the source movie of a ladder, and get the settings that its renditions start from.
+//
+// The settings are the default settings of the QuickTime movie exporter; if it has none, the renditions
+// start from empty settings, which is to say the standard compression component's defaults.
+//
+//////////
+
+static OSErr QTDX_LadderOpenSource (void *theRefCon, QTPreSourcePtr theSource)
+{
+	QTDXLadderSourcePtr		mySource = NULL;
+	FSSpec					myFSSpec;
+	MovieExportComponent	myExporter = NULL;
+	QTAtomContainer			myContainer = NULL;
+	long					mySize;
+	OSErr					myErr = noErr;
+
+	mySource = (QTDXLadderSourcePtr)calloc(1, sizeof(QTDXLadderSourceRecord));
+	if (mySource == NULL)
+		return(memFullErr);
+
+	mySource->fRefNum = kInvalidFileRefNum;
+	theSource->fPrivate = mySource;
+
+	myErr = NativePathNameToFSSpec((char *)theSource->fPath, &myFSSpec, 0L);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = OpenMovieFile(&myFSSpec, &mySource->fRefNum, fsRdPerm);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = NewMovieFromFile(&mySource->fMovie, mySource->fRefNum, NULL, NULL, newMovieActive, NULL);
+	if (myErr != noErr)
+		goto bail;
+
+	if (GetMovieIndTrackType(mySource->fMovie, 1, VideoMediaType, movieTrackMediaType) == NULL) {
+		myErr = invalidMovie;
+		goto bail;
+	}
+
+	// the movie draws each frame into our graphics world, at its own size; the renditions' threads read
+	// copies of its pixels, so we give it the same pixel format on every platform
+	GetMovieBox(mySource->fMovie, &mySource->fBounds);
+	MacOffsetRect(&mySource->fBounds, -mySource->fBounds.left, -mySource->fBounds.top);
+	SetMovieBox(mySource->fMovie, &mySource->fBounds);
+
+	myErr = QTNewGWorld(&mySource->fGWorld, k32ARGBPixelFormat, &mySource->fBounds, NULL, NULL, 0L);
+	if (myErr != noErr)
+		goto bail;
+
+	LockPixels(GetGWorldPixMap(mySource->fGWorld));
+	SetMovieGWorld(mySource->fMovie, mySource->fGWorld, NULL);
+
+	theSource->fWidth = mySource->fBounds.right;
+	theSource->fHeight = mySource->fBounds.bottom;
+
+	// get the exporter's settings; QTPre_CompileTemplate copes with there being none
+	if (OpenADefaultComponent(MovieExportType, MovieFileType, &myExporter) == noErr) {
+		if (MovieExportGetSettingsAsAtomContainer(myExporter, &myContainer) == noErr) {
+			mySize = GetHandleSize((Handle)myContainer);
+			theSource->fSettings = (UInt8 *)malloc(mySize);
+			if (theSource->fSettings == NULL) {
+				myErr = memFullErr;
+				goto bail;
+			}
+
+			memcpy(theSource->fSettings, *myContainer, mySize);
+			theSource->fSettingsSize = (UInt32)mySize;
+		}
+	}
+
+bail:
+	if (myContainer != NULL)
+		QTDisposeAtomContainer(myContainer);
+
+	if (myExporter != NULL)
+		CloseComponent(myExporter);
+
+	if (myErr != noErr)
+		QTDX_LadderCloseSource(theRefCon, theSource);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_LadderRender
+// Decode each frame of the source once, and have every rendition of the ladder compress it.
+//
+// A rendition that fails doesn't stop the others; its fErr says why. We return an error only if the
+// source itself can't be decoded.
+//
+//////////
+
+static OSErr QTDX_LadderRender (void *theRefCon, QTPreSourcePtr theSource, QTPreLadderPtr theLadder)
+{
+#pragma unused(theRefCon)
+
+	QTDXLadderSourcePtr		mySource = (QTDXLadderSourcePtr)theSource->fPrivate;
+	QTDXLadderOutputRecord	myOutputs[kPreMaxRenditions];
+	QTFanSinkRecord			mySinks[kPreMaxRenditions];
+	QTFanSourceRecord		myFanSource;
+	QTFanFormatRecord		myFormat;
+	QTDXLadderOutputPtr		myOutput;
+	QTPreRenditionPtr		myRendition;
+	OSType					myMediaType = VideoMediaType;
+	TimeScale				myTimeScale = GetMovieTimeScale(mySource->fMovie);
+	QTUInt64				myInputBytes = 0;
+	long					mySinkCount = 0;
+	long					myIndex;
+	Boolean					myCreated;
+	OSErr					myErr = noErr;
+
+	memset(myOutputs, 0, sizeof(myOutputs));
+	memset(mySinks, 0, sizeof(mySinks));
+
+	// each rendition is one sink of the fan-out
+	for (myIndex = 0; myIndex < theLadder->fRenditionCount; myIndex++) {
+		myRendition = &theLadder->fRenditions[myIndex];
+		if (myRendition->fSkipped)
+			continue;
+
+		myOutput = &myOutputs[mySinkCount];
+		myOutput->fRendition = myRendition;
+		myOutput->fRefNum = kInvalidFileRefNum;
+
+		mySinks[mySinkCount].fName = myRendition->fName;
+		mySinks[mySinkCount].fRefCon = myOutput;
+		mySinks[mySinkCount].fBegin = QTDX_LadderBeginSink;
+		mySinks[mySinkCount].fWrite = QTDX_LadderWriteSink;
+		mySinks[mySinkCount].fEnd = QTDX_LadderEndSink;
+		mySinkCount++;
+	}
+
+	if (mySinkCount == 0)
+		return(noErr);
+
+	myFanSource.fRefCon = mySource;
+	myFanSource.fReadFrame = QTDX_LadderReadFrame;
+
+	myFormat.fWidth = mySource->fBounds.right;
+	myFormat.fHeight = mySource->fBounds.bottom;
+	myFormat.fTimeScale = myTimeScale;
+	myFormat.fFrameCount = (long)QTDX_GetMovieFrameTotal(mySource->fMovie);
+
+	// the work is the length of the movie, as for scheduler exports
+	mySource->fDuration = GetMovieDuration(mySource->fMovie);
+	QTEst_Init(&mySource->fEstimator, kLadderOperation, (myTimeScale > 0) ? ((QTUInt64)mySource->fDuration * 1000) / myTimeScale : 0, QTSys_GetMicroseconds());
+	QTSys_GetPathSize(theSource->fPath, &myInputBytes);
+	QTTel_BeginStream(&mySource->fTelemetry, QTTel_GetDefaultSink(), QTSys_GetFileName(theSource->fPath), "ladder", MovieFileType, NULL, myInputBytes, (QTUInt64)myFormat.fFrameCount, &mySource->fEstimator);
+
+	GetMovieNextInterestingTime(mySource->fMovie, nextTimeMediaSample + nextTimeEdgeOK, 1, &myMediaType, 0, fixed1, &mySource->fTime, NULL);
+
+	myErr = QTFan_Run(&myFanSource, &myFormat, mySinks, mySinkCount, theLadder->fRingFrames, &theSource->fStats);
+	theSource->fFrameCount = theSource->fStats.fFrameCount;
+
+	if (myErr == noErr) {
+		QTEst_Update(&mySource->fEstimator, kProgDone, QTSys_GetMicroseconds());
+		QTEst_Finish(&mySource->fEstimator, QTSys_GetMicroseconds());
+	}
+
+	// finish each rendition's movie here, where the source movie lives, or throw away the file of one that failed
+	for (myIndex = 0; myIndex < mySinkCount; myIndex++) {
+		myOutput = &myOutputs[myIndex];
+		myRendition = myOutput->fRendition;
+
+		myRendition->fErr = mySinks[myIndex].fErr;
+		if (myRendition->fErr == noErr)
+			myRendition->fErr = myErr;
+		myRendition->fWaitMicroseconds = mySinks[myIndex].fWaitMicroseconds;
+		myRendition->fBusyMicroseconds = mySinks[myIndex].fBusyMicroseconds;
+
+		if (myRendition->fKind != kPreRenditionMovie)
+			continue;
+
+		myCreated = (myOutput->fMovie != NULL);
+		myRendition->fErr = QTDX_LadderEndOutput(myOutput, mySource->fMovie, myRendition->fErr);
+		if (myRendition->fErr == noErr)
+			QTSys_GetPathSize(myRendition->fOutPath, &myRendition->fBytesWritten);
+		else if (myCreated)
+			QTSys_DeletePath(myRendition->fOutPath);
+	}
+
+	QTTel_EndStream(&mySource->fTelemetry, myErr);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_LadderCloseSource
+// Close the source movie of a ladder.
+//
+//////////
+
+static void QTDX_LadderCloseSource (void *theRefCon, QTPreSourcePtr theSource)
+{
+#pragma unused(theRefCon)
+
+	QTDXLadderSourcePtr		mySource = (QTDXLadderSourcePtr)theSource->fPrivate;
+
+	if (mySource != NULL) {
+		if (mySource->fMovie != NULL)
+			DisposeMovie(mySource->fMovie);
+
+		if (mySource->fRefNum != kInvalidFileRefNum)
+			CloseMovieFile(mySource->fRefNum);
+
+		if (mySource->fGWorld != NULL)
+			DisposeGWorld(mySource->fGWorld);
+
+		free(mySource);
+	}
+
+	free(theSource->fSettings);
+	theSource->fSettings = NULL;
+	theSource->fSettingsSize = 0;
+	theSource->fPrivate = NULL;
+}
+
+
+//////////
+//
+// QTDX_LadderReadFrame
+// Decode the next frame of the source, and copy its pixels into a slot of the fan-out's ring.
+//
+// This is the only place the source is decoded; it runs on the thread that called QTFan_Run.
+//
+//////////
+
+static OSErr QTDX_LadderReadFrame (void *theRefCon, QTFanFramePtr theFrame)
+{
+	QTDXLadderSourcePtr		mySource = (QTDXLadderSourcePtr)theRefCon;
+	PixMapHandle			myPixMap = GetGWorldPixMap(mySource->fGWorld);
+	long					myRowBytes = QTGetPixMapHandleRowBytes(myPixMap);
+	OSType					myMediaType = VideoMediaType;
+	TimeValue				myNextTime = -1;
+	long					myPercentDone;
+	OSErr					myErr = noErr;
+
+	if (mySource->fTime < 0)
+		return(eofErr);
+
+	GetMovieNextInterestingTime(mySource->fMovie, nextTimeMediaSample, 1, &myMediaType, mySource->fTime, fixed1, &myNextTime, NULL);
+
+	SetMovieTimeValue(mySource->fMovie, mySource->fTime);
+	UpdateMovie(mySource->fMovie);
+	MoviesTask(mySource->fMovie, 0L);
+	myErr = GetMoviesError();
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTFan_ReserveFrame(theFrame, (UInt32)(myRowBytes * mySource->fBounds.bottom));
+	if (myErr != noErr)
+		return(myErr);
+
+	memcpy(theFrame->fData, GetPixBaseAddr(myPixMap), theFrame->fSize);
+	theFrame->fWidth = mySource->fBounds.right;
+	theFrame->fHeight = mySource->fBounds.bottom;
+	theFrame->fRowBytes = myRowBytes;
+	theFrame->fTime = mySource->fTime;
+	theFrame->fDuration = ((myNextTime >= 0) ? myNextTime : mySource->fDuration) - mySource->fTime;
+	if (theFrame->fDuration <= 0)
+		theFrame->fDuration = 1;
+
+	if (mySource->fDuration > 0) {
+		myPercentDone = (long)(((QTUInt64)(theFrame->fTime + theFrame->fDuration) * kProgDone) / (QTUInt64)mySource->fDuration);
+		QTEst_Update(&mySource->fEstimator, myPercentDone, QTSys_GetMicroseconds());
+		QTTel_UpdateStream(&mySource->fTelemetry, myPercentDone);
+	}
+
+	mySource->fTime = myNextTime;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_LadderBeginSink
+// Prepare to compress one rendition; this and the other sink functions run on the rendition's own thread.
+//
+// After EnterMoviesOnThread, this thread gets only thread-safe components; a rendition whose compressor
+// isn't thread-safe fails with badComponentType, as a scheduler export does.
+//
+//////////
+
+static OSErr QTDX_LadderBeginSink (void *theRefCon, const QTFanFormatRecord *theFormat)
+{
+	QTDXLadderOutputPtr		myOutput = (QTDXLadderOutputPtr)theRefCon;
+	QTPreRenditionPtr		myRendition = myOutput->fRendition;
+	OSErr					myErr = noErr;
+
+	myErr = EnterMoviesOnThread(0L);
+	if (myErr != noErr)
+		return(myErr);
+	myOutput->fOnThread = true;
+
+	MacSetRect(&myOutput->fBounds, 0, 0, (short)myRendition->fWidth, (short)myRendition->fHeight);
+
+	myErr = QTNewGWorld(&myOutput->fGWorld, k32ARGBPixelFormat, &myOutput->fBounds, NULL, NULL, 0L);
+	if (myErr != noErr)
+		return(myErr);
+
+	LockPixels(GetGWorldPixMap(myOutput->fGWorld));
+	myOutput->fTimeScale = theFormat->fTimeScale;
+
+	if (myRendition->fKind == kPreRenditionThumbnails) {
+		myErr = OpenADefaultComponent(GraphicsExporterComponentType, kQTFileTypeJPEG, &myOutput->fExporter);
+		if (myErr == noErr)
+			myErr = GraphicsExportSetInputGWorld(myOutput->fExporter, myOutput->fGWorld);
+		return(myErr);
+	}
+
+	return(QTDX_LadderBeginMovie(myOutput));
+}
+
+
+//////////
+//
+// QTDX_LadderBeginMovie
+// Open the compressor and create the movie file of one rendition.
+//
+//////////
+
+static OSErr QTDX_LadderBeginMovie (QTDXLadderOutputPtr theOutput)
+{
+	QTPreRenditionPtr		myRendition = theOutput->fRendition;
+	PixMapHandle			myPixMap = GetGWorldPixMap(theOutput->fGWorld);
+	FSSpec					myFSSpec;
+	Handle					mySettings = NULL;
+	OSErr					myErr = noErr;
+
+	// give the compressor the rendition's video settings, which QTPre_CompileLadder built for just this
+	myErr = OpenADefaultComponent(StandardCompressionType, StandardCompressionSubType, &theOutput->fCompressor);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = SCDefaultPixMapSettings(theOutput->fCompressor, myPixMap, true);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = PtrToHand(myRendition->fVideoSettings, &mySettings, (long)myRendition->fVideoSettingsSize);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = SCSetSettingsFromAtomContainer(theOutput->fCompressor, (QTAtomContainer)mySettings);
+	if (myErr != noErr)
+		goto bail;
+
+	// the rendition's file usually doesn't exist yet, so we expect fnfErr here
+	myErr = NativePathNameToFSSpec(myRendition->fOutPath, &myFSSpec, 0L);
+	if ((myErr != noErr) && (myErr != fnfErr))
+		goto bail;
+
+	myErr = CreateMovieFile(&myFSSpec, FOUR_CHAR_CODE('TVOD'), smSystemScript, createMovieFileDeleteCurFile | createMovieFileDontCreateResFile, &theOutput->fRefNum, &theOutput->fMovie);
+	if (myErr != noErr)
+		goto bail;
+
+	// the video track has the source movie's time scale, so each frame keeps its duration
+	SetMovieTimeScale(theOutput->fMovie, theOutput->fTimeScale);
+
+	theOutput->fTrack = NewMovieTrack(theOutput->fMovie, (Fixed)myRendition->fWidth << 16, (Fixed)myRendition->fHeight << 16, kNoVolume);
+	if (theOutput->fTrack != NULL)
+		theOutput->fMedia = NewTrackMedia(theOutput->fTrack, VideoMediaType, theOutput->fTimeScale, NULL, 0);
+	if (theOutput->fMedia == NULL) {
+		myErr = GetMoviesError();
+		if (myErr == noErr)
+			myErr = invalidMedia;
+		goto bail;
+	}
+
+	myErr = BeginMediaEdits(theOutput->fMedia);
+	if (myErr != noErr)
+		goto bail;
+	theOutput->fEditing = true;
+
+	myErr = SCCompressSequenceBegin(theOutput->fCompressor, myPixMap, &theOutput->fBounds, &theOutput->fImageDesc);
+	if (myErr != noErr)
+		goto bail;
+	theOutput->fCompressing = true;
+
+bail:
+	if (mySettings != NULL)
+		DisposeHandle(mySettings);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_LadderWriteSink
+// Scale a decoded frame to the size of a rendition, and add it to the rendition's movie (or, if a thumbnail
+// is due, write it as a thumbnail).
+//
+//////////
+
+static OSErr QTDX_LadderWriteSink (void *theRefCon, const QTFanFrameRecord *theFrame)
+{
+	QTDXLadderOutputPtr		myOutput = (QTDXLadderOutputPtr)theRefCon;
+	QTPreRenditionPtr		myRendition = myOutput->fRendition;
+	GWorldPtr				myFrameGWorld = NULL;
+	Rect					myFrameRect;
+	CGrafPtr				mySavedPort;
+	GDHandle				mySavedDevice;
+	Handle					myData = NULL;
+	long					myDataSize = 0;
+	short					mySyncFlag = 0;
+	OSErr					myErr = noErr;
+
+	if ((myRendition->fKind == kPreRenditionThumbnails) && (theFrame->fTime < myOutput->fNextThumbnailTime))
+		return(noErr);
+
+	// the frame's pixels stay in the ring; we just wrap a graphics world around them
+	MacSetRect(&myFrameRect, 0, 0, (short)theFrame->fWidth, (short)theFrame->fHeight);
+	myErr = NewGWorldFromPtr(&myFrameGWorld, k32ARGBPixelFormat, &myFrameRect, NULL, NULL, 0L, (Ptr)theFrame->fData, theFrame->fRowBytes);
+	if (myErr != noErr)
+		return(myErr);
+
+	GetGWorld(&mySavedPort, &mySavedDevice);
+	SetGWorld(myOutput->fGWorld, NULL);
+
+	CopyBits(GetPortBitMapForCopyBits(myFrameGWorld),
+			 GetPortBitMapForCopyBits(myOutput->fGWorld),
+			 &myFrameRect,
+			 &myOutput->fBounds,
+			 srcCopy,
+			 NULL);
+
+	SetGWorld(mySavedPort, mySavedDevice);
+	DisposeGWorld(myFrameGWorld);
+
+	if (myRendition->fKind == kPreRenditionThumbnails) {
+		myErr = QTDX_LadderWriteThumbnail(myOutput);
+		myOutput->fNextThumbnailTime = theFrame->fTime + (myRendition->fIntervalSeconds * myOutput->fTimeScale);
+		return(myErr);
+	}
+
+	// the compressed data belongs to the compressor, and stays valid until the next frame
+	myErr = SCCompressSequenceFrame(myOutput->fCompressor, GetGWorldPixMap(myOutput->fGWorld), &myOutput->fBounds, &myData, &myDataSize, &mySyncFlag);
+	if (myErr == noErr)
+		myErr = AddMediaSample(myOutput->fMedia, myData, 0, myDataSize, theFrame->fDuration, (SampleDescriptionHandle)myOutput->fImageDesc, 1, mySyncFlag, NULL);
+	if (myErr == noErr)
+		myRendition->fFrameCount++;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_LadderWriteThumbnail
+// Write the frame in a thumbnail rendition's graphics world as the next thumbnail.
+//
+//////////
+
+static OSErr QTDX_LadderWriteThumbnail (QTDXLadderOutputPtr theOutput)
+{
+	QTPreRenditionPtr		myRendition = theOutput->fRendition;
+	char					myPath[kQTSysMaxPath];
+	FSSpec					myFSSpec;
+	unsigned long			mySize = 0;
+	OSErr					myErr = noErr;
+
+	if (QTSys_FormatString(myPath, sizeof(myPath), "%s_%04ld%s", myRendition->fOutPath, myRendition->fFrameCount + 1, kPreThumbnailExtension) < 0)
+		return(paramErr);
+
+	myErr = NativePathNameToFSSpec(myPath, &myFSSpec, 0L);
+	if ((myErr != noErr) && (myErr != fnfErr))
+		return(myErr);
+
+	myErr = GraphicsExportSetOutputFile(theOutput->fExporter, &myFSSpec);
+	if (myErr == noErr)
+		myErr = GraphicsExportDoExport(theOutput->fExporter, &mySize);
+	if (myErr != noErr)
+		return(myErr);
+
+	myRendition->fFrameCount++;
+	myRendition->fBytesWritten += mySize;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_LadderEndSink
+// Finish compressing one rendition, and hand its movie over to the thread that will finish it.
+//
+//////////
+
+static OSErr QTDX_LadderEndSink (void *theRefCon, OSErr theErr)
+{
+	QTDXLadderOutputPtr		myOutput = (QTDXLadderOutputPtr)theRefCon;
+
+	if (myOutput->fCompressing)
+		SCCompressSequenceEnd(myOutput->fCompressor);
+	myOutput->fCompressing = false;
+
+	if (myOutput->fEditing)
+		EndMediaEdits(myOutput->fMedia);
+	myOutput->fEditing = false;
+
+	if ((theErr == noErr) && (myOutput->fMedia != NULL))
+		theErr = InsertMediaIntoTrack(myOutput->fTrack, 0, 0, GetMediaDuration(myOutput->fMedia), fixed1);
+
+	if (myOutput->fCompressor != NULL)
+		CloseComponent(myOutput->fCompressor);
+	myOutput->fCompressor = NULL;
+	myOutput->fImageDesc = NULL;
+
+	if (myOutput->fExporter != NULL)
+		CloseComponent(myOutput->fExporter);
+	myOutput->fExporter = NULL;
+
+	if (myOutput->fGWorld != NULL)
+		DisposeGWorld(myOutput->fGWorld);
+	myOutput->fGWorld = NULL;
+
+	// a movie belongs to the thread that created it until it is detached
+	if (myOutput->fMovie != NULL)
+		DetachMovieFromCurrentThread(myOutput->fMovie);
+
+	if (myOutput->fOnThread)
+		ExitMoviesOnThread();
+	myOutput->fOnThread = false;
+
+	return(theErr);
+}
+
+
+//////////
+//
+// QTDX_LadderEndOutput
+// Finish the movie of one rendition, if theErr is noErr, and close it; this runs on the thread that opened the source.
+//
+// The rendition gets the source's sound tracks too. InsertTrackSegment copies their sample data into the
+// rendition's file, since their media are new and have no data reference of their own.
+//
+//////////
+
+static OSErr QTDX_LadderEndOutput (QTDXLadderOutputPtr theOutput, Movie theSourceMovie, OSErr theErr)
+{
+	Track					mySrcTrack = NULL;
+	Track					myDstTrack = NULL;
+	Media					myDstMedia = NULL;
+	short					myResID = movieInDataForkResID;
+	long					myIndex;
+
+	if (theOutput->fMovie != NULL) {
+		OSErr		myErr = AttachMovieToCurrentThread(theOutput->fMovie);
+
+		if (theErr == noErr)
+			theErr = myErr;
+	} else if (theErr == noErr) {
+		theErr = invalidMovie;
+	}
+
+	for (myIndex = 1; theErr == noErr; myIndex++) {
+		mySrcTrack = GetMovieIndTrackType(theSourceMovie, myIndex, SoundMediaType, movieTrackMediaType);
+		if (mySrcTrack == NULL)
+			break;
+
+		myDstTrack = NewMovieTrack(theOutput->fMovie, 0, 0, GetTrackVolume(mySrcTrack));
+		if (myDstTrack != NULL)
+			myDstMedia = NewTrackMedia(myDstTrack, SoundMediaType, GetMediaTimeScale(GetTrackMedia(mySrcTrack)), NULL, 0);
+		if ((myDstTrack == NULL) || (myDstMedia == NULL)) {
+			theErr = GetMoviesError();
+			if (theErr == noErr)
+				theErr = invalidMedia;
+			break;
+		}
+
+		theErr = BeginMediaEdits(myDstMedia);
+		if (theErr == noErr) {
+			theErr = InsertTrackSegment(mySrcTrack, myDstTrack, 0, GetTrackDuration(mySrcTrack), 0);
+			EndMediaEdits(myDstMedia);
+		}
+	}
+
+	if (theErr == noErr)
+		theErr = AddMovieResource(theOutput->fMovie, theOutput->fRefNum, &myResID, NULL);
+
+	if (theOutput->fRefNum != kInvalidFileRefNum)
+		CloseMovieFile(theOutput->fRefNum);
+
+	if (theOutput->fMovie != NULL)
+		DisposeMovie(theOutput->fMovie);
+
+	theOutput->fMovie = NULL;
+	theOutput->fRefNum = kInvalidFileRefNum;
+
+	return(theErr);
+}
+
+
+//////////
+//
+// QTDX_GetSequenceImporter
+// Return the importer that sequence mode (QTSequence.c) uses to make a movie of numbered stills with QuickTime.
+//
+// QTFrame_OpenMovieInWindow opens one still at a time with a graphics importer. Here each decoding thread
+// keeps a graphics importer of its own, and draws each still straight into the frame buffer it is given;
+// the calling thread compresses the frames in order with a standard compression component and adds them
+// to a single video track, each with its own duration.
+//
+//////////
+
+QTSeqImporterPtr QTDX_GetSequenceImporter (void)
+{
+	return(&gSequenceImporter);
+}
+
+
+//////////
+//
+// QTDX_SequenceGetFrameSize
+// Get the natural size of a still, which becomes the size of the movie.
+//
+//////////
+
+static OSErr QTDX_SequenceGetFrameSize (void *theRefCon, const char *thePath, long *theWidth, long *theHeight)
+{
+#pragma unused(theRefCon)
+
+	GraphicsImportComponent	myImporter = NULL;
+	FSSpec					myFSSpec;
+	Rect					myBounds;
+	OSErr					myErr = noErr;
+
+	myErr = NativePathNameToFSSpec((char *)thePath, &myFSSpec, 0L);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = GetGraphicsImporterForFile(&myFSSpec, &myImporter);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = GraphicsImportGetNaturalBounds(myImporter, &myBounds);
+	if (myErr == noErr) {
+		*theWidth = myBounds.right - myBounds.left;
+		*theHeight = myBounds.bottom - myBounds.top;
+	}
+
+	CloseComponent(myImporter);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_SequenceNewDecoder
+// Prepare one thread to decode stills; this and the other decoder functions run on that thread.
+//
+// After EnterMoviesOnThread, this thread gets only thread-safe graphics importers; a sequence in a format
+// whose importer isn't thread-safe fails with badComponentType, as a scheduler export does.
+//
+//////////
+
+static OSErr QTDX_SequenceNewDecoder (void *theRefCon, void **theDecoder)
+{
+#pragma unused(theRefCon)
+
+	QTDXSequenceDecoderPtr	myDecoder = NULL;
+	OSErr					myErr = noErr;
+
+	myDecoder = (QTDXSequenceDecoderPtr)calloc(1, sizeof(QTDXSequenceDecoderRecord));
+	if (myDecoder == NULL)
+		return(memFullErr);
+
+	myErr = EnterMoviesOnThread(0L);
+	if (myErr != noErr) {
+		free(myDecoder);
+		return(myErr);
+	}
+
+	*theDecoder = myDecoder;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_SequenceDecodeFrame
+// Draw a still into a frame buffer, scaled to the size of the frame.
+//
+//////////
+
+static OSErr QTDX_SequenceDecodeFrame (void *theDecoder, const char *thePath, QTFanFramePtr theFrame)
+{
+	QTDXSequenceDecoderPtr	myDecoder = (QTDXSequenceDecoderPtr)theDecoder;
+	GWorldPtr				myFrameGWorld = NULL;
+	Rect					myFrameRect;
+	FSSpec					myFSSpec;
+	OSErr					myErr = noErr;
+
+	myErr = NativePathNameToFSSpec((char *)thePath, &myFSSpec, 0L);
+	if (myErr != noErr)
+		return(myErr);
+
+	// the stills of a sequence are all in one format, so the importer we opened for the first will do for
+	// the rest; we open another only if it won't take a file
+	if (myDecoder->fImporter != NULL)
+		myErr = GraphicsImportSetDataFile(myDecoder->fImporter, &myFSSpec);
+
+	if ((myDecoder->fImporter == NULL) || (myErr != noErr)) {
+		if (myDecoder->fImporter != NULL)
+			CloseComponent(myDecoder->fImporter);
+		myDecoder->fImporter = NULL;
+
+		myErr = GetGraphicsImporterForFile(&myFSSpec, &myDecoder->fImporter);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	// the buffer still holds an earlier frame, which mustn't show through a still with transparent parts
+	memset(theFrame->fData, 0xFF, theFrame->fSize);
+
+	// the importer draws straight into the buffer; we just wrap a graphics world around it
+	MacSetRect(&myFrameRect, 0, 0, (short)theFrame->fWidth, (short)theFrame->fHeight);
+	myErr = NewGWorldFromPtr(&myFrameGWorld, k32ARGBPixelFormat, &myFrameRect, NULL, NULL, 0L, (Ptr)theFrame->fData, theFrame->fRowBytes);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = GraphicsImportSetGWorld(myDecoder->fImporter, myFrameGWorld, NULL);
+	if (myErr == noErr)
+		myErr = GraphicsImportSetBoundsRect(myDecoder->fImporter, &myFrameRect);
+	if (myErr == noErr)
+		myErr = GraphicsImportDraw(myDecoder->fImporter);
+
+	DisposeGWorld(myFrameGWorld);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_SequenceDisposeDecoder
+// Close a thread's graphics importer, and let the thread go.
+//
+//////////
+
+static void QTDX_SequenceDisposeDecoder (void *theDecoder)
+{
+	QTDXSequenceDecoderPtr	myDecoder = (QTDXSequenceDecoderPtr)theDecoder;
+
+	if (myDecoder->fImporter != NULL)
+		CloseComponent(myDecoder->fImporter);
+
+	ExitMoviesOnThread();
+	free(myDecoder);
+}
+
+
+//////////
+//
+// QTDX_SequenceBeginMovie
+// Create the movie file of a sequence, with an empty video track, and open the compressor.
+//
+// The compressor gets the default settings for a graphics world of the movie's size.
+//
+//////////
+
+static OSErr QTDX_SequenceBeginMovie (void *theRefCon, const char *theOutPath, const QTFanFormatRecord *theFormat, void **theMovie)
+{
+#pragma unused(theRefCon)
+
+	QTDXSequenceMoviePtr	myMovie = NULL;
+	PixMapHandle			myPixMap = NULL;
+	OSErr					myErr = noErr;
+
+	myMovie = (QTDXSequenceMoviePtr)calloc(1, sizeof(QTDXSequenceMovieRecord));
+	if (myMovie == NULL)
+		return(memFullErr);
+
+	myMovie->fRefNum = kInvalidFileRefNum;
+	MacSetRect(&myMovie->fBounds, 0, 0, (short)theFormat->fWidth, (short)theFormat->fHeight);
+
+	myErr = QTNewGWorld(&myMovie->fGWorld, k32ARGBPixelFormat, &myMovie->fBounds, NULL, NULL, 0L);
+	if (myErr != noErr)
+		goto bail;
+
+	myPixMap = GetGWorldPixMap(myMovie->fGWorld);
+	LockPixels(myPixMap);
+
+	myErr = OpenADefaultComponent(StandardCompressionType, StandardCompressionSubType, &myMovie->fCompressor);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = SCDefaultPixMapSettings(myMovie->fCompressor, myPixMap, true);
+	if (myErr != noErr)
+		goto bail;
+
+	// the movie's file usually doesn't exist yet, so we expect fnfErr here
+	myErr = NativePathNameToFSSpec((char *)theOutPath, &myMovie->fFSSpec, 0L);
+	if ((myErr != noErr) && (myErr != fnfErr))
+		goto bail;
+
+	myErr = CreateMovieFile(&myMovie->fFSSpec, FOUR_CHAR_CODE('TVOD'), smSystemScript, createMovieFileDeleteCurFile | createMovieFileDontCreateResFile, &myMovie->fRefNum, &myMovie->fMovie);
+	if (myErr != noErr)
+		goto bail;
+
+	SetMovieTimeScale(myMovie->fMovie, theFormat->fTimeScale);
+
+	myMovie->fTrack = NewMovieTrack(myMovie->fMovie, (Fixed)theFormat->fWidth << 16, (Fixed)theFormat->fHeight << 16, kNoVolume);
+	if (myMovie->fTrack != NULL)
+		myMovie->fMedia = NewTrackMedia(myMovie->fTrack, VideoMediaType, theFormat->fTimeScale, NULL, 0);
+	if (myMovie->fMedia == NULL) {
+		myErr = GetMoviesError();
+		if (myErr == noErr)
+			myErr = invalidMedia;
+		goto bail;
+	}
+
+	myErr = BeginMediaEdits(myMovie->fMedia);
+	if (myErr != noErr)
+		goto bail;
+	myMovie->fEditing = true;
+
+	myErr = SCCompressSequenceBegin(myMovie->fCompressor, myPixMap, &myMovie->fBounds, &myMovie->fImageDesc);
+	if (myErr != noErr)
+		goto bail;
+	myMovie->fCompressing = true;
+
+bail:
+	if (myErr != noErr) {
+		QTDX_SequenceEndMovie(myMovie, myErr);
+		return(myErr);
+	}
+
+	*theMovie = myMovie;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_SequenceAddFrame
+// Compress a frame and add it to the movie of a sequence.
+//
+//////////
+
+static OSErr QTDX_SequenceAddFrame (void *theMovie, const QTFanFrameRecord *theFrame)
+{
+	QTDXSequenceMoviePtr	myMovie = (QTDXSequenceMoviePtr)theMovie;
+	GWorldPtr				myFrameGWorld = NULL;
+	Handle					myData = NULL;
+	long					myDataSize = 0;
+	short					mySyncFlag = 0;
+	OSErr					myErr = noErr;
+
+	// the frame is already the movie's size, so we compress it where it is, without copying it
+	myErr = NewGWorldFromPtr(&myFrameGWorld, k32ARGBPixelFormat, &myMovie->fBounds, NULL, NULL, 0L, (Ptr)theFrame->fData, theFrame->fRowBytes);
+	if (myErr != noErr)
+		return(myErr);
+
+	// the compressed data belongs to the compressor, and stays valid until the next frame
+	myErr = SCCompressSequenceFrame(myMovie->fCompressor, GetGWorldPixMap(myFrameGWorld), &myMovie->fBounds, &myData, &myDataSize, &mySyncFlag);
+	if (myErr == noErr)
+		myErr = AddMediaSample(myMovie->fMedia, myData, 0, myDataSize, theFrame->fDuration, (SampleDescriptionHandle)myMovie->fImageDesc, 1, mySyncFlag, NULL);
+
+	DisposeGWorld(myFrameGWorld);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_SequenceEndMovie
+// Finish the movie of a sequence, if theErr is noErr, and close it; if theErr isn't noErr, delete it.
+//
+//////////
+
+static OSErr QTDX_SequenceEndMovie (void *theMovie, OSErr theErr)
+{
+	QTDXSequenceMoviePtr	myMovie = (QTDXSequenceMoviePtr)theMovie;
+	short					myResID = movieInDataForkResID;
+
+	if (myMovie->fCompressing)
+		SCCompressSequenceEnd(myMovie->fCompressor);
+
+	if (myMovie->fEditing)
+		EndMediaEdits(myMovie->fMedia);
+
+	if ((theErr == noErr) && (myMovie->fMedia != NULL))
+		theErr = InsertMediaIntoTrack(myMovie->fTrack, 0, 0, GetMediaDuration(myMovie->fMedia), fixed1);
+
+	if ((theErr == noErr) && (myMovie->fMovie != NULL))
+		theErr = AddMovieResource(myMovie->fMovie, myMovie->fRefNum, &myResID, NULL);
+
+	if (myMovie->fRefNum != kInvalidFileRefNum)
+		CloseMovieFile(myMovie->fRefNum);
+
+	if (myMovie->fMovie != NULL)
+		DisposeMovie(myMovie->fMovie);
+
+	if ((theErr != noErr) && (myMovie->fRefNum != kInvalidFileRefNum))
+		DeleteMovieFile(&myMovie->fFSSpec);
+
+	if (myMovie->fCompressor != NULL)
+		CloseComponent(myMovie->fCompressor);
+
+	if (myMovie->fGWorld != NULL)
+		DisposeGWorld(myMovie->fGWorld);
+
+	free(myMovie);
+
+	return(theErr);
+}
+
+
+//////////
+//
+// QTDX_ExportMovieAsAnyTypeFile
+// Export the specified movie as a file whose type the user selects.
+//
+//////////
+
+OSErr QTDX_ExportMovieAsAnyTypeFile (Movie theMovie, FSSpec *theFSSpec)
+{
+	FSSpec					myFSSpec = *theFSSpec;
+	long					myFlags = 0L;
+	OSErr					myErr = noErr;
+
+	myFlags = createMovieFileDeleteCurFile | showUserSettingsDialog | movieFileSpecValid | movieToFileOnlyExport;
+	
+	// export the movie into a file
+	myErr = ConvertMovieToFile(
+						theMovie,					// the movie to convert
+						NULL,						// all tracks in the movie
+						&myFSSpec,					// the output file
+						0L,							// the output file type
+						FOUR_CHAR_CODE('TVOD'),		// the output file creator
+						smSystemScript,				// the script
+						NULL, 						// no resource ID to be returned
+						myFlags,					// export flags
+						NULL);						// no specific export component
+						
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_ExportMovieAsHintedMovie
+// Add a hint track to a QuickTime movie, using the hinter movie export component.
+//
+// The thePromptUser parameter determines whether we display the movie exporter
+// settings dialog box to allow the user to select export options (true) or whether we
+// try to read the export options from an existing preferences file (false).
+//
+// If USE_NATIVE_HINTER is set, we hint the movie with QTDX_HintMovieNatively instead, as long as it can send
+// every audio and video track in a standard payload format (MPEG-4 video and AAC); any other movie still goes
+// to the component. Our hinter's settings (the packet size and the payload type) are kept in the same
+// preferences file, and thePromptUser determines whether we let the user change them first. theMovieFile
+// is the file the movie was opened from, or NULL; only our own hinter uses it.
+//
+//////////
+
+OSErr QTDX_ExportMovieAsHintedMovie (Movie theMovie, FSSpec *theMovieFile, Boolean thePromptUser)
+{
+#if USE_NATIVE_HINTER
+	QTHintSettingsRecord		mySettings;
+#endif
+	FSSpec						myHintedFile;
+	FSSpec						myPrefsFile;
+	Boolean						myIsSelected = false;
+	Boolean						myIsReplacing = false;
+	ConstStringPtr				myPrompt = QTUTILS_PSTRING(gHintedMovieSavePrompt);
+	ConstStringPtr				myFileName = QTUTILS_PSTRING(gHintedMovieFileName);
+	OSErr						myErr = noErr;
+
+	// get an output file for the hinted movie
+	QTFrame_PutFile(myPrompt, myFileName, &myHintedFile, &myIsSelected, &myIsReplacing);
+	if (!myIsSelected) {
+		myErr = userCanceledErr;
+		goto bail;
+	}
+	
+	if (myIsReplacing) {
+		myErr = FSpDelete(&myHintedFile);
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	// get the preferences file for this application
+	QTDX_GetPrefsFileSpec(&myPrefsFile, (void *)&myHintedFile);
+
+#if USE_NATIVE_HINTER
+	if (QTDX_MovieHasStandardPayloads(theMovie)) {
+		// read our hinter's settings from the file; if we prompt the user, these are the initial values
+		QTHint_InitSettings(&mySettings);
+		QTDX_GetHintSettingsFromFile(&mySettings, &myPrefsFile);
+
+		if (thePromptUser) {
+			myErr = QTDX_GetHintSettingsFromUser(&mySettings);
+			if (myErr != noErr)
+				goto bail;
+
+			QTDX_SaveHintSettingsInFile(&mySettings, &myPrefsFile);
+		}
+
+		// the sample descriptions can still hide something the hinter has no standard format for (MPEG-4
+		// audio that isn't AAC, say); it tells us so before it writes anything, and we use the component
+		mySettings.fStandardOnly = true;
+		myErr = QTDX_HintMovieNatively(theMovie, theMovieFile, &myHintedFile, &mySettings);
+		if (myErr != unimpErr)
+			goto bail;
+	}
+#endif
+
+	myErr = QTDX_HintMovieWithComponent(theMovie, &myHintedFile, &myPrefsFile, thePromptUser);
+
+bail:
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_HintMovieWithComponent
+// Add a hint track to a QuickTime movie, using the hinter movie export component, and save it in the specified file.
+//
+// The component's settings are kept in the preferences file thePrefsFile; see QTDX_ExportMovieAsHintedMovie.
+//
+//////////
+
+static OSErr QTDX_HintMovieWithComponent (Movie theMovie, FSSpec *theHintedFile, FSSpec *thePrefsFile, Boolean thePromptUser)
+{
+	ComponentDescription		myCompDesc;
+	MovieExportComponent		myExporter = NULL;
+	long						myFlags = createMovieFileDeleteCurFile | movieFileSpecValid;
+	ComponentResult				myErr = badComponentType;
+
+	// find and open a movie export component that can hint a movie file
+	myCompDesc.componentType = MovieExportType;
+	myCompDesc.componentSubType = MovieFileType;
+	myCompDesc.componentManufacturer = FOUR_CHAR_CODE('hint');
+	myCompDesc.componentFlags = 0;
+	myCompDesc.componentFlagsMask = 0;
+	myExporter = OpenComponent(FindNextComponent(NULL, &myCompDesc));
+	if (myExporter == NULL)
+		goto bail;
+
+	// read existing movie exporter settings from a file; if we aren't going to prompt
+	// the user for exporter settings, these stored settings will be used; otherwise,
+	// these stored settings will be used as initial values in the settings dialog box
+	QTDX_GetExporterSettingsFromFile(myExporter, thePrefsFile);
+	
+	if (thePromptUser && QTDX_ComponentHasUI(MovieExportType, myExporter)) {
+		Boolean		myCancelled = false;
+		
+		// display a dialog box to prompt the user for desired movie exporter settings		
+		myErr = MovieExportDoUserDialog(myExporter, theMovie, NULL, 0, 0, &myCancelled);
+		if (myCancelled)
+			goto bail;
+		
+		// save the existing settings into our preferences file
+		QTDX_SaveExporterSettingsInFile(myExporter, thePrefsFile);
+	}
+
+	// export the movie into a file
+	myErr = ConvertMovieToFile(	theMovie,				// the movie to convert
+								NULL,					// all tracks in the movie
+								theHintedFile,			// the output file
+								MovieFileType,			// the output file type
+								FOUR_CHAR_CODE('TVOD'),	// the output file creator
+								smSystemScript,			// the script
+								NULL, 					// no resource ID to be returned
+								myFlags,				// conversion flags
+								myExporter);			// hinter movie export component
+
+bail:
+	// close the movie export component
+	if (myExporter != NULL)
+		CloseComponent(myExporter);
+
+	return((OSErr)myErr);
+}
+
+
+#if USE_NATIVE_HINTER
+//////////
+//
+// QTDX_HintMovieNatively
+// Add hint tracks to a QuickTime movie, using our own hinter (QTHinter.c), and save it in the specified file.
+//
+// The hinter reads the sample tables of a movie file, and copies that file into the hinted one as it goes.
+// If the movie is saved in theMovieFile together with all its media, we hint it straight from there; otherwise
+// we first flatten it into a temporary file next to the hinted movie file. The hinter builds the hint tracks
+// for all the movie's tracks in parallel, so this is much faster than the 'hint' movie export component for
+// movies with several tracks.
+//
+//////////
+
+OSErr QTDX_HintMovieNatively (Movie theMovie, FSSpec *theMovieFile, FSSpec *theHintedFile, QTHintSettingsPtr theSettings)
+{
+	FSSpec						myTempFile;
+	Movie						myTempMovie = NULL;
+	Boolean						myTempCreated = false;
+	char						myInPath[kQTSysMaxPath];
+	char						myHintedPath[kQTSysMaxPath];
+	ConstStringPtr				myTempName = QTUTILS_PSTRING(gHintedMovieTempFileName);
+	OSErr						myErr = noErr;
+
+	myErr = FSSpecToNativePathName(theHintedFile, myHintedPath, sizeof(myHintedPath), kFullNativePath);
+	if (myErr != noErr)
+		goto bail;
+
+	if ((theMovieFile != NULL) && !HasMovieChanged(theMovie) && QTDX_MovieIsSelfContained(theMovie)) {
+		myErr = FSSpecToNativePathName(theMovieFile, myInPath, sizeof(myInPath), kFullNativePath);
+		if (myErr == noErr)
+			myErr = QTDX_HintFileWithProgress(theMovie, myInPath, myHintedPath, theSettings);
+
+		// the hinter can't read a movie kept in a resource fork, or a file that QuickTime imported in place;
+		// those we flatten after all
+		if ((myErr != invalidMovie) && (myErr != invalidAtomErr))
+			goto bail;
+	}
+
+	// the temporary file doesn't exist yet, so we expect fnfErr here
+	myErr = FSMakeFSSpec(theHintedFile->vRefNum, theHintedFile->parID, myTempName, &myTempFile);
+	if ((myErr != noErr) && (myErr != fnfErr))
+		goto bail;
+
+	// flatten the movie into the temporary file, with our progress dialog box; we don't need the new movie, just the file
+	SetMovieProgressProc(theMovie, gMovieProgressProcUPP, 0L);
+	myTempMovie = FlattenMovieData(	theMovie,
+									flattenAddMovieToDataFork,
+									&myTempFile,
+									FOUR_CHAR_CODE('TVOD'),
+									smSystemScript,
+									createMovieFileDeleteCurFile | createMovieFileDontCreateResFile);
+	myErr = GetMoviesError();
+	SetMovieProgressProc(theMovie, NULL, 0L);
+	if (myTempMovie == NULL) {
+		if (myErr == noErr)
+			myErr = invalidMovie;
+		goto bail;
+	}
+
+	myTempCreated = true;
+	DisposeMovie(myTempMovie);
+
+	myErr = FSSpecToNativePathName(&myTempFile, myInPath, sizeof(myInPath), kFullNativePath);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTDX_HintFileWithProgress(theMovie, myInPath, myHintedPath, theSettings);
+
+bail:
+	if (myTempCreated)
+		FSpDelete(&myTempFile);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_MovieHasStandardPayloads
+// Is every audio and video track of the specified movie one that our hinter sends in a standard payload format?
+//
+// We go by the type of each track's first sample description; QTHint_HintFile looks inside them.
+//
+//////////
+
+static Boolean QTDX_MovieHasStandardPayloads (Movie theMovie)
+{
+	static const OSType			kMediaTypes[2] = {VideoMediaType, SoundMediaType};
+	static const OSType			kFormats[2] = {FOUR_CHAR_CODE('mp4v'), FOUR_CHAR_CODE('mp4a')};
+	SampleDescriptionHandle		myDesc = (SampleDescriptionHandle)NewHandle(0);
+	Track						myTrack = NULL;
+	Boolean						isStandard = (myDesc != NULL);
+	long						myType;
+	long						myIndex;
+
+	for (myType = 0; (myType < 2) && isStandard; myType++) {
+		for (myIndex = 1; isStandard; myIndex++) {
+			myTrack = GetMovieIndTrackType(theMovie, myIndex, kMediaTypes[myType], movieTrackMediaType);
+			if (myTrack == NULL)
+				break;
+
+			GetMediaSampleDescription(GetTrackMedia(myTrack), 1, myDesc);
+			if ((GetMoviesError() != noErr) || (GetHandleSize((Handle)myDesc) < sizeof(SampleDescription)) || ((**myDesc).dataFormat != kFormats[myType]))
+				isStandard = false;
+		}
+	}
+
+	if (myDesc != NULL)
+		DisposeHandle((Handle)myDesc);
+
+	return(isStandard);
+}
+
+
+//////////
+//
+// QTDX_MovieIsSelfContained
+// Is all the media of the specified movie in the movie's own file?
+//
+//////////
+
+static Boolean QTDX_MovieIsSelfContained (Movie theMovie)
+{
+	Media			myMedia = NULL;
+	short			myCount = 0;
+	long			myAttributes = 0;
+	long			myTrackIndex;
+	short			myIndex;
+
+	for (myTrackIndex = 1; myTrackIndex <= GetMovieTrackCount(theMovie); myTrackIndex++) {
+		myMedia = GetTrackMedia(GetMovieIndTrack(theMovie, myTrackIndex));
+		if (myMedia == NULL)
+			continue;
+
+		if (GetMediaDataRefCount(myMedia, &myCount) != noErr)
+			return(false);
+
+		for (myIndex = 1; myIndex <= myCount; myIndex++)
+			if ((GetMediaDataRef(myMedia, myIndex, NULL, NULL, &myAttributes) != noErr) || !(myAttributes & dataRefSelfReference))
+				return(false);
+	}
+
+	return(true);
+}
+
+
+//////////
+//
+// QTDX_HintFileWithProgress
+// Hint the movie file at theInPath into theOutPath, showing the progress in our movie progress dialog box.
+//
+// We open the dialog box only once the hinter has read the movie and started on it, so that a file
+// it can't read doesn't flash a dialog box at the user.
+//
+//////////
+
+static OSErr QTDX_HintFileWithProgress (Movie theMovie, const char *theInPath, const char *theOutPath, QTHintSettingsPtr theSettings)
+{
+	QTHintSettingsRecord		mySettings = *theSettings;
+	QTDXHintProgressRecord		myProgress;
+	OSErr						myErr = noErr;
+
+	myProgress.fMovie = theMovie;
+	myProgress.fInputBytes = 0;
+	myProgress.fOpened = false;
+	QTSys_GetPathSize(theInPath, &myProgress.fInputBytes);
+
+	mySettings.fProgressProc = QTDX_HintProgressProc;
+	mySettings.fProgressRefCon = (void *)&myProgress;
+
+	myErr = QTHint_HintFile(theInPath, theOutPath, &mySettings, NULL);
+
+	if (myProgress.fOpened)
+		QTDX_MovieProgressProc(theMovie, movieProgressClose, progressOpExportMovie, (myErr == noErr) ? fixed1 : 0, 0L);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_HintProgressProc
+// Pass the hinter's progress on to our movie progress procedure; the percentages are on the same scale.
+//
+// The movie progress procedure starts its estimator for the export operation, whose work is media time;
+// we start it again as a hinting estimator, so it uses and adds to the rates of earlier hinting jobs.
+//
+//////////
+
+static OSErr QTDX_HintProgressProc (void *theRefCon, long thePercentDone)
+{
+	QTDXHintProgressPtr			myProgress = (QTDXHintProgressPtr)theRefCon;
+
+	if (!myProgress->fOpened) {
+		QTDX_MovieProgressProc(myProgress->fMovie, movieProgressOpen, progressOpExportMovie, 0, 0L);
+		QTEst_Init(&gMovieEstimator, kHintOperation, myProgress->fInputBytes, QTSys_GetMicroseconds());
+		myProgress->fOpened = true;
+	}
+
+	return(QTDX_MovieProgressProc(myProgress->fMovie, movieProgressUpdatePercent, progressOpExportMovie, (Fixed)thePercentDone, 0L));
+}
+
+
+//////////
+//
+// QTDX_GetHintSettingsFromUser
+// Display a dialog box that lets the user change our hinter's settings.
+//
+// Return userCanceledErr if the user cancels the dialog box, in which case theSettings is unchanged.
+//
+//////////
+
+OSErr QTDX_GetHintSettingsFromUser (QTHintSettingsPtr theSettings)
+{
+	if (DialogBoxParam(ghInst, MAKEINTRESOURCE(IDD_HINTSETTINGS), ghWnd, (DLGPROC)QTDX_HintSettingsDialogProcedure, (LPARAM)theSettings) != IDOK)
+		return(userCanceledErr);
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTDX_HintSettingsDialogProcedure
+// Dialog callback procedure for our hinter's settings dialog box.
+//
+// We don't let the user click OK with settings that QTHint_HintFile would refuse.
+//
+//////////
+
+static UINT APIENTRY QTDX_HintSettingsDialogProcedure (HWND theDialog, UINT theMessage, WPARAM wParam, LPARAM lParam)
+{
+	QTHintSettingsPtr	mySettings = (QTHintSettingsPtr)GetWindowLongPtr(theDialog, DWLP_USER);
+	BOOL				isHandled = false;
+
+	switch (theMessage) {
+
+		case WM_INITDIALOG:
+			SetWindowLongPtr(theDialog, DWLP_USER, (LONG_PTR)lParam);
+			mySettings = (QTHintSettingsPtr)lParam;
+
+			SetDlgItemInt(theDialog, IDC_HINTPACKETSIZE, (UINT)mySettings->fMaxPacketSize, false);
+			SetDlgItemInt(theDialog, IDC_HINTPAYLOADTYPE, (UINT)mySettings->fPayloadType, false);
+
+			// let Windows set the input focus
+			isHandled = true;
+			break;
+
+		case WM_COMMAND:
+			switch (LOWORD(wParam)) {
+				case IDOK: {
+					BOOL		myPacketSizeValid = false;
+					BOOL		myPayloadTypeValid = false;
+					UINT		myPacketSize = GetDlgItemInt(theDialog, IDC_HINTPACKETSIZE, &myPacketSizeValid, false);
+					UINT		myPayloadType = GetDlgItemInt(theDialog, IDC_HINTPAYLOADTYPE, &myPayloadTypeValid, false);
+
+					if (!myPacketSizeValid || (myPacketSize < kHintMinPacketSize) || (myPacketSize > kHintMaxPacketSize)) {
+						QTFrame_Beep();
+						SetFocus(GetDlgItem(theDialog, IDC_HINTPACKETSIZE));
+					} else if (!myPayloadTypeValid || (myPayloadType > kHintMaxPayloadType)) {
+						QTFrame_Beep();
+						SetFocus(GetDlgItem(theDialog, IDC_HINTPAYLOADTYPE));
+					} else {
+						mySettings->fMaxPacketSize = (UInt32)myPacketSize;
+						mySettings->fPayloadType = (UInt8)myPayloadType;
+						EndDialog(theDialog, IDOK);
+					}
+
+					isHandled = true;
+					break;
+				}
+
+				case IDCANCEL:
+					EndDialog(theDialog, IDCANCEL);
+					isHandled = true;
+					break;
+
+				default:
+					isHandled = false;
+					break;
+			}
+			break;
+
+		default:
+			isHandled = false;
+			break;
+	}
+
+	return(isHandled);
+}
+
+
+//////////
+//
+// QTDX_SaveHintSettingsInFile
+// Save our hinter's settings into a file, as an atom container.
+//
+//////////
+
+OSErr QTDX_SaveHintSettingsInFile (QTHintSettingsPtr theSettings, FSSpecPtr theFSSpecPtr)
+{
+	QTAtomContainer		myContainer = NULL;
+	UInt32				myPacketSize = EndianU32_NtoB(theSettings->fMaxPacketSize);
+	OSErr				myErr = noErr;
+
+	myErr = QTNewAtomContainer(&myContainer);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTInsertChild(myContainer, kParentAtomIsContainer, kHintPacketSizeAtomType, 1, 0, sizeof(myPacketSize), &myPacketSize, NULL);
+	if (myErr == noErr)
+		myErr = QTInsertChild(myContainer, kParentAtomIsContainer, kHintPayloadTypeAtomType, 1, 0, sizeof(theSettings->fPayloadType), &theSettings->fPayloadType, NULL);
+	if (myErr == noErr)
+		myErr = QTDX_WriteHandleToFile((Handle)myContainer, theFSSpecPtr);
+
+bail:
+	if (myContainer != NULL)
+		QTDisposeAtomContainer(myContainer);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_GetHintSettingsFromFile
+// Read our hinter's settings saved in the specified file.
+//
+// A setting that is missing from the file, or that QTHint_HintFile would refuse, keeps its current value.
 //
 //////////
 
-OSErr QTDX_ExportMovieAsHintedMovie (Movie theMovie, Boolean thePromptUser)
+OSErr QTDX_GetHintSettingsFromFile (QTHintSettingsPtr theSettings, FSSpecPtr theFSSpecPtr)
 {
-	ComponentDescription		myCompDesc;
-	MovieExportComponent		myExporter = NULL;
-	long						myFlags = createMovieFileDeleteCurFile | movieFileSpecValid;
-	FSSpec						myHintedFile;
-	FSSpec						myPrefsFile;
-	Boolean						myIsSelected = false;
-	Boolean						myIsReplacing = false;
-	StringPtr 					myPrompt = QTUtils_ConvertCToPascalString(kHintedMovieSavePrompt);
-	StringPtr 					myFileName = QTUtils_ConvertCToPascalString(kHintedMovieFileName);
-	ComponentResult				myErr = badComponentType;
+	Handle				myHandle = NULL;
+	QTAtom				myAtom = 0;
+	UInt32				myPacketSize = 0;
+	UInt8				myPayloadType = 0;
+	OSErr				myErr = fnfErr;		// assume we cannot find the file
 
-	// get an output file for the hinted movie
-	QTFrame_PutFile(myPrompt, myFileName, &myHintedFile, &myIsSelected, &myIsReplacing);
-	if (!myIsSelected) {
-		myErr = userCanceledErr;
-		goto bail;
-	}
-	
-	if (myIsReplacing) {
-		myErr = FSpDelete(&myHintedFile);
-		if (myErr != noErr)
-			goto bail;
-	}
-		
-	// find and open a movie export component that can hint a movie file
-	myCompDesc.componentType = MovieExportType;
-	myCompDesc.componentSubType = MovieFileType;
-	myCompDesc.componentManufacturer = FOUR_CHAR_CODE('hint');
-	myCompDesc.componentFlags = 0;
-	myCompDesc.componentFlagsMask = 0;
-	myExporter = OpenComponent(FindNextComponent(NULL, &myCompDesc));
-	if (myExporter == NULL)
+	myHandle = QTDX_ReadHandleFromFile(theFSSpecPtr);
+	if (myHandle == NULL)
 		goto bail;
 
-	// get the preferences file for this application
-	QTDX_GetPrefsFileSpec(&myPrefsFile, (void *)&myHintedFile);
-	
-	// read existing movie exporter settings from a file; if we aren't going to prompt
-	// the user for exporter settings, these stored settings will be used; otherwise,
-	// these stored settings will be used as initial values in the settings dialog box
-	QTDX_GetExporterSettingsFromFile(myExporter, &myPrefsFile);
-	
-	if (thePromptUser && QTDX_ComponentHasUI(MovieExportType, myExporter)) {
-		Boolean		myCancelled = false;
-		
-		// display a dialog box to prompt the user for desired movie exporter settings		
-		myErr = MovieExportDoUserDialog(myExporter, theMovie, NULL, 0, 0, &myCancelled);
-		if (myCancelled)
-			goto bail;
-		
-		// save the existing settings into our preferences file
-		QTDX_SaveExporterSettingsInFile(myExporter, &myPrefsFile);
+	myAtom = QTFindChildByID((QTAtomContainer)myHandle, kParentAtomIsContainer, kHintPacketSizeAtomType, 1, NULL);
+	if ((myAtom != 0) && (QTCopyAtomDataToPtr((QTAtomContainer)myHandle, myAtom, false, sizeof(myPacketSize), &myPacketSize, NULL) == noErr)) {
+		myPacketSize = EndianU32_BtoN(myPacketSize);
+		if ((myPacketSize >= kHintMinPacketSize) && (myPacketSize <= kHintMaxPacketSize))
+			theSettings->fMaxPacketSize = myPacketSize;
 	}
 
-	// export the movie into a file
-	myErr = ConvertMovieToFile(	theMovie,				// the movie to convert
-								NULL,					// all tracks in the movie
-								&myHintedFile,			// the output file
-								MovieFileType,			// the output file type
-								FOUR_CHAR_CODE('TVOD'),	// the output file creator
-								smSystemScript,			// the script
-								NULL, 					// no resource ID to be returned
-								myFlags,				// conversion flags
-								myExporter);			// hinter movie export component
+	myAtom = QTFindChildByID((QTAtomContainer)myHandle, kParentAtomIsContainer, kHintPayloadTypeAtomType, 1, NULL);
+	if ((myAtom != 0) && (QTCopyAtomDataToPtr((QTAtomContainer)myHandle, myAtom, false, sizeof(myPayloadType), &myPayloadType, NULL) == noErr))
+		if (myPayloadType <= kHintMaxPayloadType)
+			theSettings->fPayloadType = myPayloadType;
+
+	myErr = noErr;
 
 bail:
-	// close the movie export component
-	if (myExporter != NULL)
-		CloseComponent(myExporter);
-		
-	free(myPrompt);
-	free(myFileName);
+	if (myHandle != NULL)
+		DisposeHandle(myHandle);
 
-	return((OSErr)myErr);
+	return(myErr);
 }
+#endif
 
 
 //////////
@@ -323,6 +2108,9 @@ OSErr QTDX_SetExportedMovieDimensions (MovieExportComponent theExporter, Fixed t
 // Can the specified file be opened in place (that is, without having
 // to create an intermediate file to hold the converted file data)?
 //
+// QuickTime movies and MPEG-4 files always can; we recognize those by their atoms, which is much quicker
+// than looking for an importer, and works whatever the file name extension.
+//
 //////////
 
 Boolean QTDX_FileCanBeImportedInPlace (FSSpec *theFSSpec)
@@ -334,6 +2122,15 @@ Boolean QTDX_FileCanBeImportedInPlace (FSSpec *theFSSpec)
 	unsigned long				myFlags = 0;
 	OSErr						myErr = noErr;
 
+#if USE_NATIVE_PROBE
+	char						myPath[kQTSysMaxPath];
+	QTProbeInfoRecord			myInfo;
+
+	if (FSSpecToNativePathName(theFSSpec, myPath, sizeof(myPath), kFullNativePath) == noErr)
+		if ((QTProbe_ProbeFile(myPath, &myInfo) == noErr) && QTProbe_IsMovie(&myInfo))
+			return(true);
+#endif
+
 #if TARGET_OS_MAC
 	FInfo						myFileInfo;
 
@@ -420,25 +2217,16 @@ PASCAL_RTN Boolean QTDX_FilterFiles (AEDesc *theItem, void *theInfo, void *theCa
 #pragma unused(theCallBackUD, theFilterMode)
 	NavFileOrFolderInfo		*myInfo = (NavFileOrFolderInfo *)theInfo;
 	
-	if (gValidFileTypes == NULL)
-		QTFrame_BuildFileTypeList();
-
 	if (theItem->descriptorType == typeFSS) {
 		if (!myInfo->isFolder) {
 			OSType			myType = myInfo->fileAndFolder.fileInfo.finderInfo.fdType;
-			OSType			*myTypes = (OSType *)*gValidFileTypes;
-			long			myCount;
-			long			myIndex;
 			
-			// see whether the file type is in the list of file types that our application can open 
+			// see whether the file type is one that our application can open,
 			// but do not allow movie files
-			myCount = GetHandleSize(gValidFileTypes) / sizeof(OSType);
-			for (myIndex = 0; myIndex < myCount; myIndex++)
-				if ((myType == myTypes[myIndex]) && (myType != kQTFileTypeMovie))
-					return(true);
-
-			// if we got to here, it's a file we cannot open
-			return(false);		
+			if (myType == kQTFileTypeMovie)
+				return(false);
+				
+			return(QTReg_LookupFileType(QTFrame_GetFileTypeRegistry(), myType, NULL));
 		}
 	}
 	
@@ -480,19 +2268,17 @@ PASCAL_RTN Boolean QTDX_FilterFiles (CInfoPBPtr thePBPtr)
 // QTDX_MovieProgressProc
 // Handle a custom progress dialog box.
 //
-// The theRefCon parameter is a window object; we don't actually use it here, however.
+// The theRefCon parameter is a window object (or 0); we use it only to name the operation in our telemetry.
 //
 //////////
 
 PASCAL_RTN OSErr QTDX_MovieProgressProc (Movie theMovie, short theMessage, short theOperation, Fixed thePercentDone, long theRefcon)
 {
-#pragma unused(theMovie, theRefcon)
-
 	CGrafPtr 				mySavedPort = NULL;
 	GDHandle				mySavedDevice = NULL;
 	static DialogPtr		myDialog = NULL;
 	static ControlHandle	myBar = NULL;
-	static UInt32			myTicks = 0;
+	static Boolean			myCancelled = false;
 	short					myItemKind;
 	Handle					myItemHandle = NULL;
 	Rect					myItemRect;
@@ -502,6 +2288,26 @@ PASCAL_RTN OSErr QTDX_MovieProgressProc (Movie theMovie, short theMessage, short
 	char					myKey;	
 	OSErr					myErr = noErr;
 	
+	// telemetry sees every update, and writes an event no more than once per interval
+	if (theMessage == movieProgressUpdatePercent)
+		QTTel_UpdateStream(&gMovieTelemetry, (long)thePercentDone);
+
+	// most updates just publish the new percentage; we look for events and redraw the dialog box no more
+	// than once every kProgDefaultIntervalMilliseconds (and at 100%), so that drawing doesn't slow down the
+	// operation itself
+	if ((theMessage == movieProgressUpdatePercent) && (myDialog != NULL)) {
+		QTProg_Publish(&gMovieProgress, (long)thePercentDone, 0);
+		if (!QTProg_ShouldRender(&gMovieProgress)) {
+#if TARGET_OS_WIN32
+			if (gUserCancelled) {
+				myCancelled = true;
+				return(userCanceledErr);
+			}
+#endif
+			return(noErr);
+		}
+	}
+
 	GetGWorld(&mySavedPort, &mySavedDevice);
 	if (myDialog != NULL)
 #if TARGET_API_MAC_CARBON
@@ -554,7 +2360,7 @@ PASCAL_RTN OSErr QTDX_MovieProgressProc (Movie theMovie, short theMessage, short
 				QTDX_ProgressBoxUserItemProcedure(myDialog, kProgressPictureItemID);
 				DrawDialog(myDialog);
 				
-				myTicks = TickCount();
+				QTProg_Init(&gMovieProgress, kProgDefaultIntervalMilliseconds);
 
 #if TARGET_OS_WIN32
 				// set a dialog callback procedure, to notify our progress proc that the user has cancelled
@@ -566,6 +2372,18 @@ PASCAL_RTN OSErr QTDX_MovieProgressProc (Movie theMovie, short theMessage, short
 #endif
 			}
 			
+			// the amount of work is the length of the movie, if there is one; the estimator uses it to
+			// start from the rates of earlier operations of the same kind. We start it even without a
+			// dialog box, so that movieProgressClose never finishes an estimate left from the last operation
+			if ((theMovie != NULL) && (GetMovieTimeScale(theMovie) > 0))
+				QTEst_Init(&gMovieEstimator, (OSType)theOperation, ((QTUInt64)GetMovieDuration(theMovie) * 1000) / GetMovieTimeScale(theMovie), QTSys_GetMicroseconds());
+			else
+				QTEst_Init(&gMovieEstimator, (OSType)theOperation, 0, QTSys_GetMicroseconds());
+
+			// report on the operation to whoever is reading our telemetry, dialog box or no dialog box
+			myCancelled = false;
+			QTDX_BeginMovieTelemetry(&gMovieTelemetry, theMovie, theOperation, theRefcon, (myDialog != NULL) ? &gMovieEstimator : NULL);
+
 			break;
 			
 		case movieProgressUpdatePercent:
@@ -639,7 +2457,8 @@ PASCAL_RTN OSErr QTDX_MovieProgressProc (Movie theMovie, short theMessage, short
 									
 			// update the estimated time remaining
 			GetDialogItem(myDialog, kProgressTimeItemID, &myItemKind, &myItemHandle, &myItemRect);
-			QTDX_EstimateRemainingTime(&myItemRect, thePercentDone, TickCount() - myTicks);
+			QTEst_Update(&gMovieEstimator, (long)thePercentDone, QTSys_GetMicroseconds());
+			QTDX_DrawRemainingTime(&myItemRect, &gMovieEstimator);
 									
 			break;
 			
@@ -657,12 +2476,20 @@ PASCAL_RTN OSErr QTDX_MovieProgressProc (Movie theMovie, short theMessage, short
 
 			myDialog = NULL;
 			myBar = NULL;			
-			myTicks = 0;
 			
+			// if the operation finished, its rate goes into the history
+			QTEst_Finish(&gMovieEstimator, QTSys_GetMicroseconds());
+			
+			// we aren't told whether the operation succeeded; all we know is whether we cancelled it
+			QTTel_EndStream(&gMovieTelemetry, myCancelled ? userCanceledErr : noErr);
+
 			break;
 	}
 
 bail:	
+	if (myErr == userCanceledErr)
+		myCancelled = true;
+
 	SetGWorld(mySavedPort, mySavedDevice);
 	
 	return(myErr);
@@ -794,6 +2621,9 @@ OSErr QTDX_SaveExporterSettingsInFile (MovieExportComponent theExporter, FSSpecP
 {	
 	QTAtomContainer		myContainer = NULL;
 	ComponentResult		myErr = noErr;
+#if USE_SETTINGS_CACHE
+	char				myPath[kQTSysMaxPath];
+#endif
 		
 	myErr = MovieExportGetSettingsAsAtomContainer(theExporter, &myContainer);
 	if (myErr != noErr)
@@ -801,6 +2631,12 @@ OSErr QTDX_SaveExporterSettingsInFile (MovieExportComponent theExporter, FSSpecP
 		
 	myErr = QTDX_WriteHandleToFile((Handle)myContainer, theFSSpecPtr);
 
+#if USE_SETTINGS_CACHE
+	// the modification time would tell the cache that the file changed, but there's no need to wait for that
+	if (FSSpecToNativePathName(theFSSpecPtr, myPath, sizeof(myPath), kFullNativePath) == noErr)
+		QTSet_InvalidateCachedPath(gSettingsCache, myPath);
+#endif
+
 bail:
 	if (myContainer != NULL)
 		QTDisposeAtomContainer(myContainer);
@@ -814,18 +2650,51 @@ bail:
 // QTDX_GetExporterSettingsFromFile
 // Read the movie exporter settings saved in the specified file.
 //
+// If USE_SETTINGS_CACHE is set, we keep the atom container we read in gSettingsCache, keyed by the
+// exporter's subtype and manufacturer and the file's pathname, and reuse it for as long as the file's
+// size and modification time stay the same; so hinting a folder full of movies reads the settings
+// file once instead of once per movie.
+//
 //////////
 
 OSErr QTDX_GetExporterSettingsFromFile (MovieExportComponent theExporter, FSSpecPtr theFSSpecPtr)
 {	
-	Handle				myHandle = NULL;
-	ComponentResult		myErr = fnfErr;		// assume we cannot find the file
+	Handle					myHandle = NULL;
+	ComponentResult			myErr = fnfErr;		// assume we cannot find the file
+#if USE_SETTINGS_CACHE
+	ComponentDescription	myCompDesc;
+	QTSetFileStampRecord	myStamp;
+	QTSetCacheEntryPtr		myEntry = NULL;
+	char					myPath[kQTSysMaxPath];
+	Boolean					myCacheable = false;
+
+	if ((gSettingsCache != NULL) &&
+		(GetComponentInfo((Component)theExporter, &myCompDesc, NULL, NULL, NULL) == noErr) &&
+		(FSSpecToNativePathName(theFSSpecPtr, myPath, sizeof(myPath), kFullNativePath) == noErr)) {
+		
+		myCacheable = true;
+		
+		myEntry = QTSet_AcquireCachedValue(gSettingsCache, myCompDesc.componentSubType, myCompDesc.componentManufacturer, myPath, &myStamp, (void **)&myHandle);
+		if (myEntry != NULL) {
+			myErr = MovieExportSetSettingsFromAtomContainer(theExporter, (QTAtomContainer)myHandle);
+			QTSet_ReleaseCachedValue(gSettingsCache, myEntry);
+			return((OSErr)myErr);
+		}
+	}
+#endif
 		
 	myHandle = QTDX_ReadHandleFromFile(theFSSpecPtr);
 	if (myHandle == NULL)
 		goto bail;
 		
 	myErr = MovieExportSetSettingsFromAtomContainer(theExporter, (QTAtomContainer)myHandle);
+	
+#if USE_SETTINGS_CACHE
+	// settings the exporter accepted are worth keeping; the cache now owns the handle
+	if ((myErr == noErr) && myCacheable)
+		if (QTSet_StoreCachedValue(gSettingsCache, myCompDesc.componentSubType, myCompDesc.componentManufacturer, myPath, &myStamp, myHandle) == noErr)
+			myHandle = NULL;
+#endif
 		
 bail:
 	if (myHandle != NULL)
@@ -841,64 +2710,120 @@ bail:
 // Write the data in the specified handle into the specified file;
 // if the file already exists, it is overwritten.
 //
+// We used to delete the existing file and then write a new one, so a crash in between lost the settings.
+// Now the data goes into a temporary file first, which then replaces the existing file: with QTSet_WriteFile
+// (which renames the temporary file over the existing one) if USE_ATOMIC_SETTINGS_WRITER is set, or else
+// with FSpExchangeFiles. If the file already holds exactly this data, we don't write anything.
+//
 //////////
 
 OSErr QTDX_WriteHandleToFile (Handle theHandle, FSSpecPtr theFSSpecPtr)
 {
-	short			myRefNum = 0;
-	long			mySize = 0;
-	OSErr			myErr = paramErr;
+	Handle				myOldHandle = NULL;
+	FSSpec				myTempSpec;
+	ConstStringPtr		myTempName = QTUTILS_PSTRING(gSettingsTempFileName);
+	Boolean				myTempCreated = false;
+	short				myRefNum = 0;
+	long				mySize = 0;
+	OSErr				myErr = paramErr;
+#if USE_ATOMIC_SETTINGS_WRITER
+	char				myPath[kQTSysMaxPath];
+	QTSysIOVecRecord	myPart;
+#endif
 #if TARGET_OS_MAC	
-	short			myVolNum;
+	short				myVolNum;
 #endif	
 
 	if (theHandle == NULL)
-		goto bail;
+		return(myErr);
 
 	mySize = GetHandleSize(theHandle);
 	if (mySize == 0)
-		goto bail;
+		return(myErr);
 
 	HLock(theHandle);
 	
-	// delete the file;
-	// if it doesn't exist yet, we'll get an error (fnfErr), which we just ignore
-	myErr = FSpDelete(theFSSpecPtr);
-	
-	// create and open the file
-	myErr = FSpCreate(theFSSpecPtr, kSettingsFileCreator, kSettingsFileType, smSystemScript);
+#if USE_ATOMIC_SETTINGS_WRITER
+	myErr = FSSpecToNativePathName(theFSSpecPtr, myPath, sizeof(myPath), kFullNativePath);
+	if (myErr == noErr) {
+		myPart.fData = *theHandle;
+		myPart.fLength = (UInt32)mySize;
+		myErr = QTSet_WriteFile(myPath, &myPart, 1, NULL);
+		goto bail;
+	}
+#endif
 
-	if (myErr == noErr)
-		myErr = FSpOpenDF(theFSSpecPtr, fsRdWrPerm, &myRefNum);
+	// if the file already holds this data, there's nothing to do
+	myOldHandle = QTDX_ReadHandleFromFile(theFSSpecPtr);
+	if ((myOldHandle != NULL) && (GetHandleSize(myOldHandle) == mySize) && (memcmp(*myOldHandle, *theHandle, (size_t)mySize) == 0)) {
+		myErr = noErr;
+		goto bail;
+	}
+
+	// the temporary file normally doesn't exist, so we expect fnfErr here
+	myErr = FSMakeFSSpec(theFSSpecPtr->vRefNum, theFSSpecPtr->parID, myTempName, &myTempSpec);
+	if ((myErr != noErr) && (myErr != fnfErr))
+		goto bail;
 	
-	// position the file mark to the beginning of the file and write the data
-	if (myErr == noErr)
-		myErr = SetFPos(myRefNum, fsFromStart, 0);
+	// delete any temporary file left over from a crash, then create and open a new one
+	FSpDelete(&myTempSpec);
+	
+	myErr = FSpCreate(&myTempSpec, kSettingsFileCreator, kSettingsFileType, smSystemScript);
+	if (myErr != noErr)
+		goto bail;
 
-	if (myErr == noErr)
-		myErr = FSWrite(myRefNum, &mySize, *theHandle);
+	myTempCreated = true;
 
+	myErr = FSpOpenDF(&myTempSpec, fsRdWrPerm, &myRefNum);
+	
+	// write the data and resize the file to the number of bytes written
 	if (myErr == noErr)
-		myErr = SetFPos(myRefNum, fsFromStart, mySize);
+		myErr = FSWrite(myRefNum, &mySize, *theHandle);
 
-	// resize the file to the number of bytes written
 	if (myErr == noErr)
 		myErr = SetEOF(myRefNum, mySize);
-				
-	// close the file			 
-	if (myErr == noErr)		
-		myErr = FSClose(myRefNum);
 
 #if TARGET_OS_MAC	
-	// flush the volume
 	if (myErr == noErr)		
 		myErr = GetVRefNum(myRefNum, &myVolNum);
+#endif	
+
+	// close the file			 
+	if (myRefNum != 0)
+		if (FSClose(myRefNum) != noErr)
+			if (myErr == noErr)
+				myErr = ioErr;
 
+#if TARGET_OS_MAC	
+	// flush the volume, so that the new data is on disk before it replaces the old data
 	if (myErr == noErr)		
 		myErr = FlushVol(NULL, myVolNum);
 #endif	
 
+	if (myErr != noErr)
+		goto bail;
+
+	// swap the new data into the settings file; afterwards, the temporary file holds the old data;
+	// if there is no settings file yet, we just give the temporary file its name
+#if TARGET_OS_MAC	
+	myErr = FSpExchangeFiles(&myTempSpec, theFSSpecPtr);
+#else
+	// without FSpExchangeFiles, we delete the old file first; the new data is complete by now,
+	// so a crash here leaves it in the temporary file instead of losing it
+	myErr = FSpDelete(theFSSpecPtr);
+	if (myErr == noErr)
+		myErr = fnfErr;
+#endif
+	if (myErr == fnfErr)
+		myErr = FSpRename(&myTempSpec, theFSSpecPtr->name);
+
 bail:
+	if (myTempCreated)
+		FSpDelete(&myTempSpec);
+
+	if (myOldHandle != NULL)
+		DisposeHandle(myOldHandle);
+
 	HUnlock(theHandle);
 
 	return(myErr);
@@ -910,6 +2835,11 @@ bail:
 // QTDX_ReadHandleFromFile
 // Read the data in the specified file into a new handle.
 //
+// If USE_MAPPED_SETTINGS_READER is set, we map the file and check that it holds a well-formed atom
+// container before copying it (once) into the handle; a damaged settings file gives us NULL, just as
+// a missing one does. If the file can't be mapped, QTSet_OpenView reads it instead; we use the File
+// Manager only if we can't get a pathname for the file.
+//
 //////////
 
 Handle QTDX_ReadHandleFromFile (FSSpecPtr theFSSpecPtr)
@@ -918,9 +2848,24 @@ Handle QTDX_ReadHandleFromFile (FSSpecPtr theFSSpecPtr)
 	short			myRefNum = 0;
 	long			mySize = 0;
 	OSErr			myErr = noErr;
+#if USE_MAPPED_SETTINGS_READER
+	char			myPath[kQTSysMaxPath];
+	QTSetViewRecord	myView;
+
+	myErr = FSSpecToNativePathName(theFSSpecPtr, myPath, sizeof(myPath), kFullNativePath);
+	if (myErr == noErr) {
+		if (QTSet_OpenView(myPath, 0, &myView) == noErr) {
+			if (QTSet_ValidateContainer(myView.fData, myView.fSize, NULL) == noErr)
+				PtrToHand(myView.fData, &myHandle, (long)myView.fSize);
+			QTSet_CloseView(&myView);
+		}
+		
+		return(myHandle);
+	}
+#endif
 
-	// open the file
-	myErr = FSpOpenDF(theFSSpecPtr, fsRdWrPerm, &myRefNum);
+	// open the file; we only read it, so don't ask for write permission
+	myErr = FSpOpenDF(theFSSpecPtr, fsRdPerm, &myRefNum);
 	
 	if (myErr == noErr)
 		myErr = SetFPos(myRefNum, fsFromStart, 0);
@@ -929,9 +2874,9 @@ Handle QTDX_ReadHandleFromFile (FSSpecPtr theFSSpecPtr)
 	if (myErr == noErr)
 		myErr = GetEOF(myRefNum, &mySize);
 		
-	// allocate a new handle
+	// allocate a new handle; FSRead fills all of it, so there's no need to clear it
 	if (myErr == noErr)
-		myHandle = NewHandleClear(mySize);
+		myHandle = NewHandle(mySize);
 	
 	if (myHandle == NULL)
 		goto bail;
@@ -948,55 +2893,255 @@ bail:
 }
 
 
+#if USE_SETTINGS_CACHE
 //////////
 //
-// QTDX_EstimateRemainingTime
-// Estimate the amount of time remaining in the operation.
+// QTDX_DisposeCachedSettings
+// Dispose of an atom container that gSettingsCache no longer needs.
 //
 //////////
 
-void QTDX_EstimateRemainingTime (Rect *theRect, Fixed thePercentDone, UInt32 theTicksElapsed)
+void QTDX_DisposeCachedSettings (void *theValue)
 {
-	char 			myString[32];
-	Fixed			myEstTicks;
-	UInt32			myRemSeconds;
-	Rect			myEraseRect;
-	StringPtr		myPString = NULL;
+	QTDisposeAtomContainer((QTAtomContainer)theValue);
+}
+
+
+//////////
+//
+// QTDX_GetSettingsCacheStats
+// Get the hit and miss counters of our settings cache.
+//
+//////////
+
+void QTDX_GetSettingsCacheStats (QTSetCacheStatsPtr theStats)
+{
+	QTSet_GetCacheStats(gSettingsCache, theStats);
+}
+#endif
+
+
+//////////
+//
+// QTDX_GetEstimateHistoryPath
+// Get the full path of the file that keeps the rates of earlier operations, for our time estimates.
+//
+//////////
+
+OSErr QTDX_GetEstimateHistoryPath (char *theBuffer, size_t theBufferSize)
+{
+	char				myDirectory[kQTSysMaxPath];
+	OSErr				myErr = noErr;
+	
+	myErr = QTSys_GetCacheDirectory(myDirectory, sizeof(myDirectory));
+	if (myErr == noErr)
+		myErr = QTSys_MakePath(theBuffer, theBufferSize, myDirectory, kEstimateHistoryFileName);
 	
-	myEstTicks = FixMul(FixDiv(fixed1, thePercentDone), Long2Fix(theTicksElapsed));
-	myRemSeconds = Fix2Long(FixDiv(myEstTicks - Long2Fix(theTicksElapsed), Long2Fix(60)));
+	return(myErr);
+}
+
+
+//////////
+//
+// QTDX_DrawRemainingTime
+// Draw the estimated amount of time remaining in the operation.
+//
+// The estimate comes from theEstimator (see QTEstimate.c); we draw nothing after the label until it has one.
+// This runs on every update of the progress dialog box, so it allocates nothing: the label is built by the
+// compiler, and the time is formatted on the stack. The "-stringcheck" mode makes sure of that.
+//
+//////////
 
+void QTDX_DrawRemainingTime (Rect *theRect, QTEstimatorPtr theEstimator)
+{
+	Rect			myEraseRect;
+	Str255			myPString;
+	
 	TextSize(kTimeRemainingLabelSize);
 	TextFont(1);
 
-	myPString = QTUtils_ConvertCToPascalString(kTimeRemainingLabel);
-
 	MoveTo(theRect->left, theRect->bottom);
-	DrawString(myPString);
+	DrawString(QTUTILS_PSTRING(gTimeRemainingLabel));
 	
 	MacSetRect(&myEraseRect,
-				theRect->left + StringWidth(myPString),
+				theRect->left + StringWidth(QTUTILS_PSTRING(gTimeRemainingLabel)),
 				theRect->top,
 				theRect->right,
 				theRect->bottom);
-				
-	free(myPString);
 	
 	EraseRect(&myEraseRect);
 	MoveTo(myEraseRect.left, myEraseRect.bottom);
 	
-	// the early percentages give inaccurate estimates, so don't start displaying the
-	// time until we've reached a minimum threshold
-	if (thePercentDone < kMinimumUsefulPercent)
-		return;
+	if (QTDX_FormatRemainingTime(QTEst_GetRemainingMilliseconds(theEstimator), myPString))
+		DrawString(myPString);
+}
+
+
+//////////
+//
+// QTDX_FormatRemainingTime
+// Put an estimate of the time remaining, in milliseconds, into theString as whole seconds.
+//
+// Returns false, leaving theString alone, if theRemaining is kEstUnknown.
+//
+//////////
+
+Boolean QTDX_FormatRemainingTime (long theRemaining, StringPtr theString)
+{
+	char 			myString[kEstMaxTimeStringLength];
 	
-	if (myRemSeconds == 1)
-		sprintf_s(myString, 32,"%u second", myRemSeconds);
-	else
-		sprintf_s(myString, 32,"%u seconds", myRemSeconds);
+	if (!QTEst_FormatRemainingTime(theRemaining, myString, sizeof(myString)))
+		return(false);
 		
-	myPString = QTUtils_ConvertCToPascalString(myString);
-	DrawString(myPString);
+	QTUtils_CopyCToPascalString(myString, theString);
 	
-	free(myPString);
+	return(true);
+}
+
+
+//////////
+//
+// QTDX_BeginMovieTelemetry
+// Start reporting telemetry (see QTTelemetry.c) for an operation that QTDX_MovieProgressProc has been told about.
+//
+// The theRefcon parameter is the window object of the movie or image, if any; the job is named after its file.
+//
+//////////
+
+static void QTDX_BeginMovieTelemetry (QTTelStreamPtr theStream, Movie theMovie, short theOperation, long theRefcon, QTEstimatorPtr theEstimator)
+{
+	WindowObject		myWindowObject = (WindowObject)theRefcon;
+	QTTelSinkPtr		mySink = QTTel_GetDefaultSink();
+	char				myName[kTelMaxJobNameLength];
+	QTUInt64			myInputBytes = 0;
+#if TARGET_OS_WIN32
+	char				myPath[kQTSysMaxPath];
+#endif
+
+	myName[0] = '\0';
+
+	if (mySink == NULL) {
+		QTTel_BeginStream(theStream, NULL, NULL, NULL, 0, NULL, 0, 0, NULL);
+		return;
+	}
+
+	if (myWindowObject != NULL) {
+		FSSpec			myFSSpec = (**myWindowObject).fFileFSSpec;
+		
+		memcpy(myName, &myFSSpec.name[1], myFSSpec.name[0]);
+		myName[myFSSpec.name[0]] = '\0';
+
+#if TARGET_OS_WIN32
+		if (FSSpecToNativePathName(&myFSSpec, myPath, sizeof(myPath), kFullNativePath) == noErr)
+			QTSys_GetPathSize(myPath, &myInputBytes);
+#endif
+	}
+
+	QTTel_BeginStream(theStream, mySink, myName, QTDX_GetOperationName(theOperation), 0, NULL, myInputBytes, QTDX_GetMovieFrameTotal(theMovie), theEstimator);
+}
+
+
+//////////
+//
+// QTDX_GetOperationName
+// Return the name our telemetry uses for a movie progress operation.
+//
+//////////
+
+static const char *QTDX_GetOperationName (short theOperation)
+{
+	static const char		*myNames[] = {
+		"image",						// QTDX_ImageProgressProc passes 0
+		"flatten",						// progressOpFlatten
+		"insertTrackSegment",			// progressOpInsertTrackSegment
+		"insertMovieSegment",			// progressOpInsertMovieSegment
+		"paste",						// progressOpPaste
+		"addMovieSelection",			// progressOpAddMovieSelection
+		"copy",							// progressOpCopy
+		"cut",							// progressOpCut
+		"loadMovieIntoRam",				// progressOpLoadMovieIntoRam
+		"loadTrackIntoRam",				// progressOpLoadTrackIntoRam
+		"loadMediaIntoRam",				// progressOpLoadMediaIntoRam
+		"import",						// progressOpImportMovie
+		"export"						// progressOpExportMovie
+	};
+
+	if ((theOperation < 0) || (theOperation > progressOpExportMovie))
+		return("unknown");
+
+	return(myNames[theOperation]);
+}
+
+
+//////////
+//
+// QTDX_GetMovieFrameTotal
+// Return the number of frames in the movie's first video track, or 0 if it has none.
+//
+// We count the samples in the track's media, which QuickTime reads from the sample table; stepping through
+// the track as QTUtils_GetFrameCount does would take far too long to do at the start of every operation.
+//
+//////////
+
+static QTUInt64 QTDX_GetMovieFrameTotal (Movie theMovie)
+{
+	Track				myTrack = NULL;
+
+	if (theMovie == NULL)
+		return(0);
+
+	myTrack = GetMovieIndTrackType(theMovie, 1, VideoMediaType, movieTrackMediaType);
+	if (myTrack == NULL)
+		return(0);
+
+	return((QTUInt64)GetMediaSampleCount(GetTrackMedia(myTrack)));
+}
+
+
+//////////
+//
+// QTDX_CheckStrings
+// Our part of the string check (see QTEst_RunStringCheck): check the Pascal strings the progress dialog box and
+// our prompts give to the Toolbox; return how many came out wrong.
+//
+// The Memory Manager's NewPtr and NewHandle allocate inside QuickTime's own library, where no allocation count
+// reaches, but nothing on these paths calls them either.
+//
+//////////
+
+long QTDX_CheckStrings (void)
+{
+	static const long		myTimes[] = {kEstUnknown, 0, 1499, 0x7FFFFFFFL};
+	static const struct {
+		ConstStringPtr		fPString;
+		const char			*fCString;
+	} myPrompts[] = {
+		{QTUTILS_PSTRING(gImportSavePrompt), kImportSavePrompt},
+		{QTUTILS_PSTRING(gHintedMovieSavePrompt), kHintedMovieSavePrompt},
+		{QTUTILS_PSTRING(gHintedMovieFileName), kHintedMovieFileName},
+		{QTUTILS_PSTRING(gHintedMovieTempFileName), kHintedMovieTempFileName},
+		{QTUTILS_PSTRING(gSettingsTempFileName), kSettingsTempFileName},
+		{QTUTILS_PSTRING(gTimeRemainingLabel), kTimeRemainingLabel}
+	};
+	Str255					myPString;
+	char					myCString[256];
+	char					myExpected[kEstMaxTimeStringLength];
+	long					myIndex;
+	long					myMismatches = 0;
+
+	// the time as QTDX_DrawRemainingTime draws it must say what the engine's own string says
+	for (myIndex = 0; myIndex < (long)(sizeof(myTimes) / sizeof(myTimes[0])); myIndex++) {
+		myPString[0] = 0;
+		myExpected[0] = '\0';
+		if (QTDX_FormatRemainingTime(myTimes[myIndex], myPString) != QTEst_FormatRemainingTime(myTimes[myIndex], myExpected, sizeof(myExpected)))
+			myMismatches++;
+		else if (strcmp(QTUtils_CopyPascalToCString(myPString, myCString), myExpected) != 0)
+			myMismatches++;
+	}
+
+	for (myIndex = 0; myIndex < (long)(sizeof(myPrompts) / sizeof(myPrompts[0])); myIndex++)
+		if (strcmp(QTUtils_CopyPascalToCString(myPrompts[myIndex].fPString, myCString), myPrompts[myIndex].fCString) != 0)
+			myMismatches++;
+
+	return(myMismatches);
 }
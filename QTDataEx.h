@@ -24,6 +24,17 @@
 //////////
 
 #include "ComApplication.h"
+#include "QTBatch.h"
+#include "QTScheduler.h"
+#include "QTHinter.h"
+#include "QTSettings.h"
+#include "QTProbe.h"
+#include "QTProgress.h"
+#include "QTEstimate.h"
+#include "QTTelemetry.h"
+#include "QTPresets.h"
+#include "QTRemux.h"
+#include "QTSequence.h"
 
 #ifndef _STDIO_H
 #include <stdio.h>
@@ -36,6 +47,26 @@
 //
 //////////
 
+// set this to 1 to hint movies with our own hinter (QTHinter.c) instead of the 'hint' movie export component;
+// the hinter works on files, and only QTML gives us the pathname of an FSSpec (FSSpecToNativePathName), so
+// this works only on Windows. Our hinter writes standard payload formats only for MPEG-4 video and AAC, so
+// movies with any other audio or video still go to the component
+#define USE_NATIVE_HINTER					TARGET_OS_WIN32
+
+// set this to 1 to read settings files by mapping them (QTSettings.c) instead of with the File Manager;
+// like the hinter, this needs FSSpecToNativePathName
+#define USE_MAPPED_SETTINGS_READER			TARGET_OS_WIN32
+
+// set this to 1 to save settings files with QTSet_WriteFile (temporary file + rename) instead of with the File Manager
+#define USE_ATOMIC_SETTINGS_WRITER			TARGET_OS_WIN32
+
+// set this to 1 to keep exporter settings read from settings files in memory (QTSettings.c), keyed by pathname
+#define USE_SETTINGS_CACHE					TARGET_OS_WIN32
+
+// set this to 1 to recognize QuickTime movies and MPEG-4 files by reading their atoms (QTProbe.c) before
+// asking the Component Manager; this too needs FSSpecToNativePathName
+#define USE_NATIVE_PROBE					TARGET_OS_WIN32
+
 
 //////////
 //
@@ -67,10 +98,14 @@
 
 // the name of our preferences file
 #define kSettingsFileName					"HintPrefs.rtm"
+#define kSettingsTempFileName				"HintPrefs.tmp"
+#define kSettingsCacheCapacity				16						// settings files we keep in memory at once
 
 // constants for displaying the remaining time
 #define kTimeRemainingLabel					"Time remaining: "
-#define kMinimumUsefulPercent				(Fixed)0x00000600
+#define kEstimateHistoryFileName			"QTDataExRates.txt"		// in the user's cache folder; see QTEstimate.c
+#define kBatchImportOperation				FOUR_CHAR_CODE('BImp')	// the estimator history of batch imports, whose work is input bytes
+#define kLadderOperation					FOUR_CHAR_CODE('Ladr')	// and of ladders, whose work is media milliseconds
 #if TARGET_OS_MAC
 #define kTimeRemainingLabelSize				10
 #endif
@@ -81,6 +116,91 @@
 // constants for exporting hinted movies
 #define kHintedMovieSavePrompt				"Save hinted movie as: "
 #define kHintedMovieFileName				"hinted.mov"
+#define kHintedMovieTempFileName			"hinted.tmp"
+
+// atoms that hold our own hinter's settings in the preferences file
+#define kHintPacketSizeAtomType				FOUR_CHAR_CODE('HPkS')	// a big-endian UInt32
+#define kHintPayloadTypeAtomType			FOUR_CHAR_CODE('HPlT')	// a UInt8
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a movie being hinted by QTDX_HintMovieNatively, whose progress we show with QTDX_MovieProgressProc
+typedef struct QTDXHintProgressRecord {
+	Movie					fMovie;
+	QTUInt64				fInputBytes;			// the work of the hinting estimator
+	Boolean					fOpened;				// we've sent movieProgressOpen
+} QTDXHintProgressRecord, *QTDXHintProgressPtr;
+
+// the state of one worker thread of the parallel export scheduler
+typedef struct QTDXExportWorkerRecord {
+	MovieExportComponent	fExporter;				// this worker's own exporter instance
+	OSType					fFileType;				// the file type fExporter exports
+	MovieProgressUPP		fProgressUPP;			// progress procedure that polls for cancellation
+	QTSchedJobPtr			fJob;					// the job being exported
+	QTTelStreamRecord		fTelemetry;				// and its telemetry
+} QTDXExportWorkerRecord, *QTDXExportWorkerPtr;
+
+// the progress of one batch import; there is no dialog box, only telemetry
+typedef struct QTDXImportProgressRecord {
+	QTTelStreamRecord		fTelemetry;
+	QTEstimatorRecord		fEstimator;
+} QTDXImportProgressRecord, *QTDXImportProgressPtr;
+
+// the source of a ladder (QTPresets.c), which is decoded once into fGWorld
+typedef struct QTDXLadderSourceRecord {
+	Movie					fMovie;
+	short					fRefNum;
+	GWorldPtr				fGWorld;
+	Rect					fBounds;
+	TimeValue				fTime;					// of the next frame to decode, or -1 after the last
+	TimeValue				fDuration;
+	QTEstimatorRecord		fEstimator;
+	QTTelStreamRecord		fTelemetry;
+} QTDXLadderSourceRecord, *QTDXLadderSourcePtr;
+
+// one rendition of a ladder, as it is being compressed on its own thread
+typedef struct QTDXLadderOutputRecord {
+	QTPreRenditionPtr		fRendition;
+	Boolean					fOnThread;				// EnterMoviesOnThread succeeded
+	GWorldPtr				fGWorld;				// the decoded frame, scaled to the rendition's size
+	Rect					fBounds;
+	TimeScale				fTimeScale;				// of the source's frame times
+	ComponentInstance		fCompressor;			// a standard compression component with the rendition's video settings
+	ImageDescriptionHandle	fImageDesc;				// owned by fCompressor
+	Movie					fMovie;
+	short					fRefNum;
+	Track					fTrack;
+	Media					fMedia;
+	Boolean					fCompressing;			// SCCompressSequenceBegin succeeded
+	Boolean					fEditing;				// BeginMediaEdits succeeded
+	GraphicsExportComponent	fExporter;				// for thumbnails, instead of fCompressor and fMovie
+	TimeValue				fNextThumbnailTime;
+} QTDXLadderOutputRecord, *QTDXLadderOutputPtr;
+
+// a thread of sequence mode (QTSequence.c), with the graphics importer it decodes stills with
+typedef struct QTDXSequenceDecoderRecord {
+	GraphicsImportComponent	fImporter;				// opened for the first still this thread decodes
+} QTDXSequenceDecoderRecord, *QTDXSequenceDecoderPtr;
+
+// the movie that sequence mode makes
+typedef struct QTDXSequenceMovieRecord {
+	GWorldPtr				fGWorld;				// a frame of the movie's size, to set up the compressor with
+	Rect					fBounds;
+	ComponentInstance		fCompressor;			// a standard compression component with its default settings
+	ImageDescriptionHandle	fImageDesc;				// owned by fCompressor
+	FSSpec					fFSSpec;
+	Movie					fMovie;
+	short					fRefNum;
+	Track					fTrack;
+	Media					fMedia;
+	Boolean					fCompressing;			// SCCompressSequenceBegin succeeded
+	Boolean					fEditing;				// BeginMediaEdits succeeded
+} QTDXSequenceMovieRecord, *QTDXSequenceMoviePtr;
 
 
 //////////
@@ -91,7 +211,19 @@
 
 OSErr						QTDX_ImportAnyNonMovie (void);
 OSErr						QTDX_ExportMovieAsAnyTypeFile (Movie theMovie, FSSpec *theFSSpec);
-OSErr						QTDX_ExportMovieAsHintedMovie (Movie theMovie, Boolean thePromptUser);
+OSErr						QTDX_ExportMovieAsHintedMovie (Movie theMovie, FSSpec *theMovieFile, Boolean thePromptUser);
+static OSErr				QTDX_HintMovieWithComponent (Movie theMovie, FSSpec *theHintedFile, FSSpec *thePrefsFile, Boolean thePromptUser);
+#if USE_NATIVE_HINTER
+OSErr						QTDX_HintMovieNatively (Movie theMovie, FSSpec *theMovieFile, FSSpec *theHintedFile, QTHintSettingsPtr theSettings);
+static Boolean				QTDX_MovieHasStandardPayloads (Movie theMovie);
+static Boolean				QTDX_MovieIsSelfContained (Movie theMovie);
+static OSErr				QTDX_HintFileWithProgress (Movie theMovie, const char *theInPath, const char *theOutPath, QTHintSettingsPtr theSettings);
+static OSErr				QTDX_HintProgressProc (void *theRefCon, long thePercentDone);
+OSErr						QTDX_GetHintSettingsFromUser (QTHintSettingsPtr theSettings);
+static UINT APIENTRY		QTDX_HintSettingsDialogProcedure (HWND theDialog, UINT theMessage, WPARAM wParam, LPARAM lParam);
+OSErr						QTDX_SaveHintSettingsInFile (QTHintSettingsPtr theSettings, FSSpecPtr theFSSpecPtr);
+OSErr						QTDX_GetHintSettingsFromFile (QTHintSettingsPtr theSettings, FSSpecPtr theFSSpecPtr);
+#endif
 
 OSErr						QTDX_SetExportedMovieDimensions (MovieExportComponent theExporter, Fixed theHeight, Fixed theWidth);
 
@@ -113,11 +245,56 @@ PASCAL_RTN void				QTDX_ProgressBoxUserItemProcedure (DialogPtr theDialog, short
 static void					QTDX_ModelessCallback (EventRecord *theEvent, DialogPtr theDialog, short theItemHit);
 #endif
 
+QTBatchImporterPtr			QTDX_GetBatchImporter (void);
+static Boolean				QTDX_BatchCanImportInPlace (void *theRefCon, const char *theInPath);
+static OSErr				QTDX_BatchConvertFile (void *theRefCon, const char *theInPath, const char *theOutPath);
+PASCAL_RTN OSErr			QTDX_ImportProgressProc (Movie theMovie, short theMessage, short theOperation, Fixed thePercentDone, long theRefcon);
+
+QTSchedExporterPtr			QTDX_GetSchedulerExporter (void);
+static OSErr				QTDX_SchedulerNewWorker (void *theRefCon, void **theWorkerData);
+static OSErr				QTDX_SchedulerExportJob (void *theWorkerData, QTSchedJobPtr theJob);
+static OSErr				QTDX_SchedulerRemuxJob (QTDXExportWorkerPtr theWorker, QTSchedJobPtr theJob);
+static void					QTDX_SchedulerDisposeWorker (void *theWorkerData);
+PASCAL_RTN OSErr			QTDX_SchedulerProgressProc (Movie theMovie, short theMessage, short theOperation, Fixed thePercentDone, long theRefcon);
+
+QTPreRendererPtr			QTDX_GetLadderRenderer (void);
+static OSErr				QTDX_LadderOpenSource (void *theRefCon, QTPreSourcePtr theSource);
+static OSErr				QTDX_LadderRender (void *theRefCon, QTPreSourcePtr theSource, QTPreLadderPtr theLadder);
+static void					QTDX_LadderCloseSource (void *theRefCon, QTPreSourcePtr theSource);
+static OSErr				QTDX_LadderReadFrame (void *theRefCon, QTFanFramePtr theFrame);
+static OSErr				QTDX_LadderBeginSink (void *theRefCon, const QTFanFormatRecord *theFormat);
+static OSErr				QTDX_LadderBeginMovie (QTDXLadderOutputPtr theOutput);
+static OSErr				QTDX_LadderWriteSink (void *theRefCon, const QTFanFrameRecord *theFrame);
+static OSErr				QTDX_LadderWriteThumbnail (QTDXLadderOutputPtr theOutput);
+static OSErr				QTDX_LadderEndSink (void *theRefCon, OSErr theErr);
+static OSErr				QTDX_LadderEndOutput (QTDXLadderOutputPtr theOutput, Movie theSourceMovie, OSErr theErr);
+
+QTSeqImporterPtr			QTDX_GetSequenceImporter (void);
+static OSErr				QTDX_SequenceGetFrameSize (void *theRefCon, const char *thePath, long *theWidth, long *theHeight);
+static OSErr				QTDX_SequenceNewDecoder (void *theRefCon, void **theDecoder);
+static OSErr				QTDX_SequenceDecodeFrame (void *theDecoder, const char *thePath, QTFanFramePtr theFrame);
+static void					QTDX_SequenceDisposeDecoder (void *theDecoder);
+static OSErr				QTDX_SequenceBeginMovie (void *theRefCon, const char *theOutPath, const QTFanFormatRecord *theFormat, void **theMovie);
+static OSErr				QTDX_SequenceAddFrame (void *theMovie, const QTFanFrameRecord *theFrame);
+static OSErr				QTDX_SequenceEndMovie (void *theMovie, OSErr theErr);
+
 OSErr						QTDX_GetPrefsFileSpec (FSSpecPtr thePrefsSpecPtr, void *theRefCon);
 
 OSErr						QTDX_SaveExporterSettingsInFile (MovieExportComponent theExporter, FSSpecPtr theFSSpecPtr);
 OSErr						QTDX_GetExporterSettingsFromFile (MovieExportComponent theExporter, FSSpecPtr theFSSpecPtr);
 OSErr						QTDX_WriteHandleToFile (Handle theHandle, FSSpecPtr theFSSpecPtr);
 Handle						QTDX_ReadHandleFromFile (FSSpecPtr theFSSpecPtr);
+#if USE_SETTINGS_CACHE
+void						QTDX_DisposeCachedSettings (void *theValue);
+void						QTDX_GetSettingsCacheStats (QTSetCacheStatsPtr theStats);
+#endif
+
+void						QTDX_DrawRemainingTime (Rect *theRect, QTEstimatorPtr theEstimator);
+Boolean						QTDX_FormatRemainingTime (long theRemaining, StringPtr theString);
+OSErr						QTDX_GetEstimateHistoryPath (char *theBuffer, size_t theBufferSize);
+
+static void					QTDX_BeginMovieTelemetry (QTTelStreamPtr theStream, Movie theMovie, short theOperation, long theRefcon, QTEstimatorPtr theEstimator);
+static const char *			QTDX_GetOperationName (short theOperation);
+static QTUInt64				QTDX_GetMovieFrameTotal (Movie theMovie);
 
-void						QTDX_EstimateRemainingTime (Rect *theRect, Fixed thePercentDone, UInt32 theTicksElapsed);
+long						QTDX_CheckStrings (void);
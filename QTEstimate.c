@@ -0,0 +1,631 @@
+//////////
+//
+//	File:		QTEstimate.c
+//
+//	Contains:	Portable functions for estimating how long a long operation has left to run.
+//				All utilities start with the prefix "QTEst_".
+//
+//	QTDX_EstimateRemainingTime used to divide the total time elapsed by the fraction done, which
+//	assumes the operation runs at the same speed from start to finish. Exports of variable-bitrate
+//	movies don't: the estimate swung about as the content changed, and was so poor at the start that
+//	we hid it until 1/40 of the way through. Here we measure the rate over short intervals instead and
+//	smooth it with an exponentially weighted moving average whose weights halve every
+//	kEstHalfLifeMilliseconds, so the estimate follows real changes in speed without jumping at every
+//	blip.
+//
+//	We also remember, for each kind of operation, how many units of work per second (bytes, media
+//	milliseconds, whatever the caller counts) earlier operations managed. An operation that says how
+//	much work it has can then show an estimate from its very first update, based on that history, and
+//	blend its own measurements in as they become trustworthy. QTEst_ReadHistory and QTEst_WriteHistory
+//	keep the history from one launch to the next.
+//
+//	Estimators don't draw anything; the progress dialog box and the export scheduler both just ask
+//	QTEst_GetRemainingMilliseconds, which any thread may call. QTEst_FormatRemainingTime turns an
+//	estimate into the words the progress dialog box shows, and the -stringcheck mode checks that doing
+//	so (on every update of the dialog box) gives the right words without allocating memory.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#define QTSYS_COUNT_ALLOCATIONS						// so that the string check sees any allocation we make
+#include "QTEstimate.h"
+#include "QTSettings.h"
+#include <math.h>
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kEstHistoryHeader			"QTDataEx rates 1"		// first line of a history file
+#define kEstMaxLineLength			128
+#define kEstMaxRemaining			0x7FFFFFFFL				// the longest estimate we can return, in milliseconds
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTEstHistoryEntryRecord {
+	OSType					fOperation;
+	double					fRate;					// units of work per second
+	long					fJobCount;				// operations that went into fRate, up to kEstHistoryJobs
+} QTEstHistoryEntryRecord, *QTEstHistoryEntryPtr;
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static QTEstHistoryEntryRecord	gEstHistory[kEstMaxOperations];
+static long						gEstHistoryCount = 0;
+static QTSysMutex				gEstHistoryMutex = NULL;	// made by QTEst_InitHistory, before there are other threads
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTEst_LockHistory (void);
+static void					QTEst_UnlockHistory (void);
+static QTEstHistoryEntryPtr	QTEst_FindHistoryEntry (OSType theOperation);
+static long					QTEst_CheckTimeStrings (void);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Estimator functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTEst_Init
+// Prepare an estimator for an operation that starts at theTime (in microseconds).
+//
+// theOperation selects the history to use and add to, and theTotalWork says how much work the operation
+// has, in whatever units it likes; pass 0 for either if there's no sensible value, and we'll go by this
+// operation's own measurements alone.
+//
+//////////
+
+void QTEst_Init (QTEstimatorPtr theEstimator, OSType theOperation, QTUInt64 theTotalWork, QTUInt64 theTime)
+{
+	memset(theEstimator, 0, sizeof(QTEstimatorRecord));
+
+	theEstimator->fOperation = theOperation;
+	theEstimator->fTotalWork = theTotalWork;
+	theEstimator->fStartTime = theTime;
+	theEstimator->fSampleTime = theTime;
+	theEstimator->fBasis = kEstBasisNone;
+	theEstimator->fRemainingMilliseconds = kEstUnknown;
+
+	if ((theOperation != 0) && (theTotalWork != 0) && QTEst_GetHistoryRate(theOperation, &theEstimator->fHistoryRate)) {
+		theEstimator->fBasis = kEstBasisHistory;
+		theEstimator->fRemainingMilliseconds = (long)(1000.0 * (double)theTotalWork / theEstimator->fHistoryRate);
+	}
+}
+
+
+//////////
+//
+// QTEst_Update
+// Tell the estimator how far the operation has got (0 to kProgDone) at theTime, and recompute the estimate.
+//
+//////////
+
+void QTEst_Update (QTEstimatorPtr theEstimator, long thePercentDone, QTUInt64 theTime)
+{
+	double			myDone = (double)thePercentDone / (double)kProgDone;
+	double			myElapsed;
+	double			myInterval;
+	double			myHistoryRate = 0.0;
+	double			myRate = 0.0;
+	double			myRemaining;
+
+	if (myDone < 0.0)
+		myDone = 0.0;
+	if (myDone > 1.0)
+		myDone = 1.0;
+
+	// some operations make several passes, starting again from 0; we keep the rate we've measured so far
+	if (myDone < theEstimator->fSampleDone) {
+		theEstimator->fSampleTime = theTime;
+		theEstimator->fSampleDone = myDone;
+	}
+
+	theEstimator->fDone = myDone;
+
+	// measure the rate over the interval since the last sample, if it's long enough to mean anything
+	myInterval = (theTime > theEstimator->fSampleTime) ? (double)(theTime - theEstimator->fSampleTime) / 1000.0 : 0.0;
+	if (myInterval >= kEstSampleMilliseconds) {
+		double		mySampleRate = 1000.0 * (myDone - theEstimator->fSampleDone) / myInterval;
+
+		if (theEstimator->fMeasuredRate == 0.0)
+			theEstimator->fMeasuredRate = mySampleRate;
+		else
+			theEstimator->fMeasuredRate += (1.0 - pow(0.5, myInterval / kEstHalfLifeMilliseconds)) * (mySampleRate - theEstimator->fMeasuredRate);
+
+		theEstimator->fSampleTime = theTime;
+		theEstimator->fSampleDone = myDone;
+	}
+
+	// the history rate is in units per second, and we want the fraction done per second
+	if ((theEstimator->fHistoryRate > 0.0) && (theEstimator->fTotalWork != 0))
+		myHistoryRate = theEstimator->fHistoryRate / (double)theEstimator->fTotalWork;
+
+	myElapsed = (theTime > theEstimator->fStartTime) ? (double)(theTime - theEstimator->fStartTime) / 1000.0 : 0.0;
+	if ((theEstimator->fMeasuredRate > 0.0) && (myElapsed >= kEstMinimumMilliseconds)) {
+		double		myWeight = myElapsed / (myElapsed + kEstPriorMilliseconds);
+
+		// the longer we've been running, the more we trust our own measurements over the history
+		if (myHistoryRate > 0.0)
+			myRate = (myWeight * theEstimator->fMeasuredRate) + ((1.0 - myWeight) * myHistoryRate);
+		else
+			myRate = theEstimator->fMeasuredRate;
+
+		theEstimator->fBasis = kEstBasisMeasured;
+	} else if (myHistoryRate > 0.0) {
+		myRate = myHistoryRate;
+		theEstimator->fBasis = kEstBasisHistory;
+	}
+
+	if (myRate <= 0.0) {
+		QTSys_AtomicStore(&theEstimator->fRemainingMilliseconds, kEstUnknown);
+		return;
+	}
+
+	myRemaining = 1000.0 * (1.0 - myDone) / myRate;
+	QTSys_AtomicStore(&theEstimator->fRemainingMilliseconds, (myRemaining < (double)kEstMaxRemaining) ? (long)myRemaining : kEstMaxRemaining);
+}
+
+
+//////////
+//
+// QTEst_Finish
+// Tell the estimator that the operation has stopped at theTime; if it got all the way, add its rate
+// to the history of its kind of operation.
+//
+//////////
+
+void QTEst_Finish (QTEstimatorPtr theEstimator, QTUInt64 theTime)
+{
+	double			myElapsed = (theTime > theEstimator->fStartTime) ? (double)(theTime - theEstimator->fStartTime) / 1000000.0 : 0.0;
+
+	if ((theEstimator->fDone >= 1.0) && (theEstimator->fOperation != 0) && (theEstimator->fTotalWork != 0) && (myElapsed > 0.0))
+		QTEst_RecordHistoryRate(theEstimator->fOperation, (double)theEstimator->fTotalWork / myElapsed);
+
+	QTSys_AtomicStore(&theEstimator->fRemainingMilliseconds, (theEstimator->fDone >= 1.0) ? 0 : kEstUnknown);
+}
+
+
+//////////
+//
+// QTEst_GetRemainingMilliseconds
+// Return the latest estimate of the time the operation has left, or kEstUnknown. Any thread may call this.
+//
+//////////
+
+long QTEst_GetRemainingMilliseconds (QTEstimatorPtr theEstimator)
+{
+	return(QTSys_AtomicLoad(&theEstimator->fRemainingMilliseconds));
+}
+
+
+//////////
+//
+// QTEst_GetBasis
+// Return what the latest estimate is based on: one of the kEstBasis constants.
+//
+//////////
+
+long QTEst_GetBasis (QTEstimatorPtr theEstimator)
+{
+	return(theEstimator->fBasis);
+}
+
+
+//////////
+//
+// QTEst_FormatRemainingTime
+// Put an estimate of the time remaining, in milliseconds, into theString as whole seconds.
+//
+// Returns false, leaving theString alone, if theRemaining is kEstUnknown. A buffer of kEstMaxTimeStringLength
+// characters is always big enough.
+//
+//////////
+
+Boolean QTEst_FormatRemainingTime (long theRemaining, char *theString, size_t theSize)
+{
+	UInt32			myRemSeconds;
+
+	if (theRemaining == kEstUnknown)
+		return(false);
+
+	// unsigned, so that the longest estimate doesn't overflow as it's rounded
+	myRemSeconds = ((UInt32)theRemaining + 500) / 1000;
+	if (myRemSeconds == 1)
+		QTSys_FormatString(theString, theSize, "%lu second", (unsigned long)myRemSeconds);
+	else
+		QTSys_FormatString(theString, theSize, "%lu seconds", (unsigned long)myRemSeconds);
+
+	return(true);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// History functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTEst_InitHistory
+// Make the lock that guards the history; call this before starting any thread that may use an estimator.
+//
+// Until then, the history has no lock, and only one thread may use estimators. Calling this again does nothing.
+// The lock lasts as long as the process.
+//
+//////////
+
+OSErr QTEst_InitHistory (void)
+{
+	if (gEstHistoryMutex != NULL)
+		return(noErr);
+
+	return(QTSys_NewMutex(&gEstHistoryMutex));
+}
+
+
+//////////
+//
+// QTEst_GetHistoryRate
+// Get the rate, in units of work per second, that earlier operations of the specified kind managed.
+//
+//////////
+
+Boolean QTEst_GetHistoryRate (OSType theOperation, double *theRate)
+{
+	QTEstHistoryEntryPtr	myEntry;
+	Boolean					myFound = false;
+
+	QTEst_LockHistory();
+
+	myEntry = QTEst_FindHistoryEntry(theOperation);
+	if ((myEntry != NULL) && (myEntry->fRate > 0.0)) {
+		*theRate = myEntry->fRate;
+		myFound = true;
+	}
+
+	QTEst_UnlockHistory();
+
+	return(myFound);
+}
+
+
+//////////
+//
+// QTEst_RecordHistoryRate
+// Add the rate of a finished operation to the history of its kind.
+//
+// The history rate is a running average that gives the latest job a weight of 1/kEstHistoryJobs, once
+// there have been that many; so a faster machine or a new codec shows up after a few jobs.
+//
+//////////
+
+void QTEst_RecordHistoryRate (OSType theOperation, double theRate)
+{
+	QTEstHistoryEntryPtr	myEntry;
+
+	if ((theOperation == 0) || !(theRate > 0.0))
+		return;
+
+	QTEst_LockHistory();
+
+	myEntry = QTEst_FindHistoryEntry(theOperation);
+	if (myEntry == NULL) {
+		// when the table is full, the newest kind of operation replaces the last one added
+		if (gEstHistoryCount < kEstMaxOperations)
+			gEstHistoryCount++;
+
+		myEntry = &gEstHistory[gEstHistoryCount - 1];
+		myEntry->fOperation = theOperation;
+		myEntry->fRate = 0.0;
+		myEntry->fJobCount = 0;
+	}
+
+	if (myEntry->fJobCount < kEstHistoryJobs)
+		myEntry->fJobCount++;
+
+	myEntry->fRate += (theRate - myEntry->fRate) / (double)myEntry->fJobCount;
+
+	QTEst_UnlockHistory();
+}
+
+
+//////////
+//
+// QTEst_ReadHistory
+// Read the history from the specified file, replacing whatever history we have.
+//
+// A missing file isn't an error; we just start with no history. Lines we don't understand are skipped.
+//
+//////////
+
+OSErr QTEst_ReadHistory (const char *thePath)
+{
+	FILE					*myFile = NULL;
+	char					myLine[kEstMaxLineLength];
+	QTEstHistoryEntryRecord	myEntries[kEstMaxOperations];
+	long					myCount = 0;
+
+	myFile = fopen(thePath, "r");
+	if (myFile == NULL)
+		return(QTSys_FileExists(thePath) ? ioErr : noErr);
+
+	if ((fgets(myLine, sizeof(myLine), myFile) == NULL) || (strcmp(QTSys_TrimLine(myLine), kEstHistoryHeader) != 0)) {
+		fclose(myFile);
+		return(noErr);
+	}
+
+	while ((myCount < kEstMaxOperations) && (fgets(myLine, sizeof(myLine), myFile) != NULL)) {
+		char		*myText = QTSys_TrimLine(myLine);
+		char		*myEnd;
+
+		myEntries[myCount].fOperation = (OSType)strtoul(myText, &myEnd, 16);
+		myEntries[myCount].fRate = strtod(myEnd, &myEnd);
+		myEntries[myCount].fJobCount = strtol(myEnd, &myEnd, 10);
+
+		if ((myEntries[myCount].fOperation != 0) && (myEntries[myCount].fRate > 0.0) && (myEntries[myCount].fJobCount > 0) && (myEntries[myCount].fJobCount <= kEstHistoryJobs))
+			myCount++;
+	}
+
+	fclose(myFile);
+
+	QTEst_LockHistory();
+	memcpy(gEstHistory, myEntries, (size_t)myCount * sizeof(QTEstHistoryEntryRecord));
+	gEstHistoryCount = myCount;
+	QTEst_UnlockHistory();
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTEst_WriteHistory
+// Write the history to the specified file, atomically; if it hasn't changed, we leave the file alone.
+//
+//////////
+
+OSErr QTEst_WriteHistory (const char *thePath)
+{
+	char					myText[(kEstMaxOperations + 1) * kEstMaxLineLength];
+	QTSysIOVecRecord		myPart;
+	size_t					myLength;
+	long					myIndex;
+
+	QTEst_LockHistory();
+
+	QTSys_FormatString(myText, sizeof(myText), "%s\n", kEstHistoryHeader);
+	for (myIndex = 0; myIndex < gEstHistoryCount; myIndex++) {
+		myLength = strlen(myText);
+		QTSys_FormatString(myText + myLength, sizeof(myText) - myLength, "%08lX %.9g %ld\n",
+							(unsigned long)gEstHistory[myIndex].fOperation,
+							gEstHistory[myIndex].fRate,
+							gEstHistory[myIndex].fJobCount);
+	}
+
+	QTEst_UnlockHistory();
+
+	myPart.fData = myText;
+	myPart.fLength = (UInt32)strlen(myText);
+
+	return(QTSet_WriteFile(thePath, &myPart, 1, NULL));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// String check functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTEst_RunStringCheck
+// Check that formatting the time remaining, and the application's own strings, give the right strings without
+// allocating; write one JSON line to theReport.
+//
+// This formats the times the progress dialog box is given, as it does on every update, theIterations times over,
+// calling theCheckProc (if any) on each pass. Allocations are counted with QTSys_StartAllocationCount: with
+// Microsoft's debug C run-time library that sees every malloc, calloc and realloc in the process, and the report
+// says "crt"; elsewhere it sees those of the files built with QTSYS_COUNT_ALLOCATIONS (this one and QTUtilities.c,
+// whose string conversions are what would allocate), and the report says "counted".
+//
+//////////
+
+OSErr QTEst_RunStringCheck (FILE *theReport, long theIterations, QTEstStringCheckProcPtr theCheckProc)
+{
+	long					myIteration;
+	long					myMismatches = 0;
+	long					myAllocations;
+	Boolean					mySeesAll;
+
+	if (theIterations <= 0)
+		theIterations = kEstDefaultIterations;
+
+	mySeesAll = QTSys_StartAllocationCount();
+
+	// nothing between here and the end of the count may allocate, other than by mistake
+	for (myIteration = 0; myIteration < theIterations; myIteration++) {
+		myMismatches += QTEst_CheckTimeStrings();
+		if (theCheckProc != NULL)
+			myMismatches += (*theCheckProc)();
+	}
+
+	myAllocations = QTSys_StopAllocationCount();
+
+	fprintf(theReport, "{\"check\":\"strings\",\"iterations\":%ld,\"mismatches\":%ld,\"allocations\":%ld,\"counter\":\"%s\"}\n",
+				theIterations, myMismatches, myAllocations, mySeesAll ? "crt" : "counted");
+
+	return(((myMismatches > 0) || (myAllocations > 0)) ? paramErr : noErr);
+}
+
+
+//////////
+//
+// QTEst_IsStringCheckCommandLine
+// Does the specified command line ask for the string check?
+//
+//////////
+
+Boolean QTEst_IsStringCheckCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kEstStringCheckSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTEst_StringCheckMain
+// Run the string check, with the application's part of it in theCheckProc (or NULL). Returns one of the kEstExit
+// constants.
+//
+// Usage: -stringcheck [-iterations <count>] [-report <file>]
+//
+//////////
+
+int QTEst_StringCheckMain (int theArgc, char *theArgv[], QTEstStringCheckProcPtr theCheckProc)
+{
+	const char			*myReportPath = NULL;
+	FILE				*myReport = stdout;
+	long				myIterations = 0;
+	int					myIndex;
+	OSErr				myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kEstIterationsSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myIterations = atol(theArgv[++myIndex]);
+		} else if ((strcmp(theArgv[myIndex], kEstReportSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myReportPath = theArgv[++myIndex];
+		} else if (strcmp(theArgv[myIndex], kEstStringCheckSwitch) != 0) {
+			fprintf(stderr, "usage: %s %s [%s <count>] [%s <file>]\n", theArgv[0], kEstStringCheckSwitch, kEstIterationsSwitch, kEstReportSwitch);
+			return(kEstExitUsage);
+		}
+	}
+
+	if (myIterations < 0) {
+		fprintf(stderr, "usage: %s %s [%s <count>] [%s <file>]\n", theArgv[0], kEstStringCheckSwitch, kEstIterationsSwitch, kEstReportSwitch);
+		return(kEstExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kEstExitUsage);
+		}
+	}
+
+	myErr = QTEst_RunStringCheck(myReport, myIterations, theCheckProc);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kEstExitSuccess : kEstExitFailed);
+}
+
+
+//////////
+//
+// QTEst_LockHistory
+// Take the history lock, if QTEst_InitHistory has made it, waiting if another thread has it.
+//
+//////////
+
+static void QTEst_LockHistory (void)
+{
+	if (gEstHistoryMutex != NULL)
+		QTSys_LockMutex(gEstHistoryMutex);
+}
+
+
+//////////
+//
+// QTEst_UnlockHistory
+// Release the history lock.
+//
+//////////
+
+static void QTEst_UnlockHistory (void)
+{
+	if (gEstHistoryMutex != NULL)
+		QTSys_UnlockMutex(gEstHistoryMutex);
+}
+
+
+//////////
+//
+// QTEst_FindHistoryEntry
+// Return the history of the specified kind of operation, or NULL. The caller must hold the history lock.
+//
+//////////
+
+static QTEstHistoryEntryPtr QTEst_FindHistoryEntry (OSType theOperation)
+{
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < gEstHistoryCount; myIndex++)
+		if (gEstHistory[myIndex].fOperation == theOperation)
+			return(&gEstHistory[myIndex]);
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTEst_CheckTimeStrings
+// Format a range of estimates, from none to the longest; return how many came out wrong.
+//
+//////////
+
+static long QTEst_CheckTimeStrings (void)
+{
+	static const long		myTimes[] = {kEstUnknown, 0, 499, 500, 1499, 1500, 59999, 86400000, kEstMaxRemaining};
+	static const char		*myStrings[] = {NULL, "0 seconds", "0 seconds", "1 second", "1 second", "2 seconds", "60 seconds", "86400 seconds", "2147484 seconds"};
+	char					myString[kEstMaxTimeStringLength];
+	long					myIndex;
+	long					myMismatches = 0;
+
+	for (myIndex = 0; myIndex < (long)(sizeof(myTimes) / sizeof(myTimes[0])); myIndex++) {
+		myString[0] = '\0';
+		if (QTEst_FormatRemainingTime(myTimes[myIndex], myString, sizeof(myString)) != (myStrings[myIndex] != NULL))
+			myMismatches++;
+		else if ((myStrings[myIndex] != NULL) && (strcmp(myString, myStrings[myIndex]) != 0))
+			myMismatches++;
+	}
+
+	return(myMismatches);
+}
@@ -0,0 +1,107 @@
+//////////
+//
+//	File:		QTEstimate.h
+//
+//	Contains:	Portable functions for estimating how long a long operation has left to run.
+//				All utilities start with the prefix "QTEst_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTEstimate__
+#define __QTEstimate__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTProgress.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kEstUnknown							-1L						// QTEst_GetRemainingMilliseconds has no estimate yet
+#define kEstSampleMilliseconds				250						// shortest interval we measure a rate over
+#define kEstHalfLifeMilliseconds			10000					// a measured rate counts half as much after this long
+#define kEstMinimumMilliseconds				1000					// we don't trust our own measurements before this
+#define kEstPriorMilliseconds				10000					// after this long, our measurements count as much as the history
+#define kEstMaxOperations					32						// kinds of operation we keep a history for
+#define kEstHistoryJobs						4						// the history rate is roughly the average of this many recent jobs
+#define kEstMaxTimeStringLength				32						// longest string QTEst_FormatRemainingTime makes, with its terminator
+
+#define kEstStringCheckSwitch				"-stringcheck"			// command-line switch that selects the string check
+#define kEstIterationsSwitch				"-iterations"			// passes over the times (and the caller's strings)
+#define kEstReportSwitch					"-report"				// write the report to a file instead of stdout
+#define kEstDefaultIterations				1000
+
+// what an estimate is based on
+enum {
+	kEstBasisNone							= 0,					// nothing yet
+	kEstBasisHistory						= 1,					// only the rates of earlier operations of the same kind
+	kEstBasisMeasured						= 2						// this operation's own rate, blended with the history if there is any
+};
+
+// exit codes returned by QTEst_StringCheckMain
+enum {
+	kEstExitSuccess							= 0,
+	kEstExitFailed							= 1,
+	kEstExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// the estimator of one operation; one thread updates it, and any thread may call QTEst_GetRemainingMilliseconds
+typedef struct QTEstimatorRecord {
+	OSType					fOperation;				// the kind of operation, for its history; 0 for none
+	QTUInt64				fTotalWork;				// in the operation's own units (bytes, media milliseconds...), or 0 if unknown
+	QTUInt64				fStartTime;				// microseconds
+	QTUInt64				fSampleTime;			// start of the interval we're measuring
+	double					fSampleDone;			// the fraction done at fSampleTime
+	double					fDone;					// the fraction done at the last update
+	double					fMeasuredRate;			// smoothed fraction done per second, or 0
+	double					fHistoryRate;			// units per second from earlier operations, or 0
+	volatile long			fBasis;					// one of the kEstBasis constants
+	volatile long			fRemainingMilliseconds;	// the latest estimate, or kEstUnknown
+} QTEstimatorRecord, *QTEstimatorPtr;
+
+// an application's part of the string check: check its own strings once; return how many were wrong
+typedef long (*QTEstStringCheckProcPtr) (void);
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+void						QTEst_Init (QTEstimatorPtr theEstimator, OSType theOperation, QTUInt64 theTotalWork, QTUInt64 theTime);
+void						QTEst_Update (QTEstimatorPtr theEstimator, long thePercentDone, QTUInt64 theTime);
+void						QTEst_Finish (QTEstimatorPtr theEstimator, QTUInt64 theTime);
+long						QTEst_GetRemainingMilliseconds (QTEstimatorPtr theEstimator);
+long						QTEst_GetBasis (QTEstimatorPtr theEstimator);
+Boolean						QTEst_FormatRemainingTime (long theRemaining, char *theString, size_t theSize);
+
+OSErr						QTEst_InitHistory (void);
+Boolean						QTEst_GetHistoryRate (OSType theOperation, double *theRate);
+void						QTEst_RecordHistoryRate (OSType theOperation, double theRate);
+OSErr						QTEst_ReadHistory (const char *thePath);
+OSErr						QTEst_WriteHistory (const char *thePath);
+
+OSErr						QTEst_RunStringCheck (FILE *theReport, long theIterations, QTEstStringCheckProcPtr theCheckProc);
+Boolean						QTEst_IsStringCheckCommandLine (int theArgc, char *theArgv[]);
+int							QTEst_StringCheckMain (int theArgc, char *theArgv[], QTEstStringCheckProcPtr theCheckProc);
+
+#endif	// __QTEstimate__
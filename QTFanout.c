@@ -0,0 +1,335 @@
+//////////
+//
+//	File:		QTFanout.c
+//
+//	Contains:	Portable functions for feeding one decoded source to several output sinks at once.
+//				All utilities start with the prefix "QTFan_".
+//
+//	Making several outputs from one movie one export at a time reads and decodes the movie once for
+//	each output, and runs each encoder only while the others sit idle. QTFan_Run decodes the source
+//	once, on the calling thread, and gives every frame to each of the sinks, which run on threads of
+//	their own and so encode in parallel.
+//
+//	The frames pass through a ring of a fixed number of slots. The source fills the slot after the
+//	newest frame, and each sink reads the slots in order at its own pace; a slot is filled again only
+//	once every sink has read it. So when the ring is full, the source waits for the slowest sink: a
+//	slow encoder holds the decoder back instead of making it buffer more and more frames. The time the
+//	source spends waiting, and the time each sink spends waiting for frames, show which side is the
+//	bottleneck. A sink that fails drops out without holding up the others.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTFanout.h"
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTFanRingRecord			*QTFanRingPtr;
+
+// the thread of one sink
+typedef struct QTFanWorkerRecord {
+	QTFanRingPtr			fRing;
+	long					fIndex;					// of the sink
+	QTSysThread				fThread;
+	long					fReadCount;				// frames this sink has finished with
+	Boolean					fActive;				// false once the sink has stopped reading
+} QTFanWorkerRecord, *QTFanWorkerPtr;
+
+typedef struct QTFanRingRecord {
+	QTSysMutex				fMutex;
+	QTSysCondition			fFrameAvailable;		// signalled when the source adds a frame, or finishes
+	QTSysCondition			fSlotAvailable;			// signalled when a sink finishes with a frame, or stops
+	QTFanFrameRecord		fSlots[kFanMaxRingFrames];
+	long					fSlotCount;
+	long					fWriteCount;			// frames the source has added
+	Boolean					fFinished;				// the source has no more frames
+	long					fActiveCount;			// sinks still reading
+	QTFanSinkPtr			fSinks;
+	QTFanWorkerRecord		fWorkers[kFanMaxSinks];
+	const QTFanFormatRecord	*fFormat;
+} QTFanRingRecord;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTFan_SinkThread (void *theRefCon);
+static long					QTFan_GetQueuedCount (QTFanRingPtr theRing);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fan-out functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTFan_Run
+// Read every frame of theSource and give it to each of theSinks, with at most theRingFrames frames in
+// memory at once; theStats, which may be NULL, is filled in with how it went.
+//
+// Returns the source's error, if it had one; each sink's own error is in its fErr. The source stops early
+// if every sink has failed.
+//
+//////////
+
+OSErr QTFan_Run (QTFanSourcePtr theSource, const QTFanFormatRecord *theFormat, QTFanSinkPtr theSinks, long theSinkCount, long theRingFrames, QTFanStatsPtr theStats)
+{
+	QTFanRingPtr			myRing = NULL;
+	QTFanFramePtr			mySlot;
+	QTUInt64				myWaitStart;
+	QTUInt64				myWaitTime = 0;
+	long					myQueued;
+	long					myPeakQueued = 0;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if ((theSource == NULL) || (theFormat == NULL) || (theSinks == NULL) || (theSinkCount <= 0) || (theSinkCount > kFanMaxSinks))
+		return(paramErr);
+
+	if (theRingFrames <= 0)
+		theRingFrames = kFanDefaultRingFrames;
+	if (theRingFrames > kFanMaxRingFrames)
+		theRingFrames = kFanMaxRingFrames;
+
+	if (theStats != NULL)
+		memset(theStats, 0, sizeof(QTFanStatsRecord));
+
+	for (myIndex = 0; myIndex < theSinkCount; myIndex++) {
+		theSinks[myIndex].fErr = noErr;
+		theSinks[myIndex].fFrameCount = 0;
+		theSinks[myIndex].fWaitMicroseconds = 0;
+		theSinks[myIndex].fBusyMicroseconds = 0;
+	}
+
+	myRing = (QTFanRingPtr)calloc(1, sizeof(QTFanRingRecord));
+	if (myRing == NULL)
+		return(memFullErr);
+
+	myRing->fSlotCount = theRingFrames;
+	myRing->fSinks = theSinks;
+	myRing->fFormat = theFormat;
+
+	myErr = QTSys_NewMutex(&myRing->fMutex);
+	if (myErr == noErr)
+		myErr = QTSys_NewCondition(&myRing->fFrameAvailable);
+	if (myErr == noErr)
+		myErr = QTSys_NewCondition(&myRing->fSlotAvailable);
+	if (myErr != noErr)
+		goto bail;
+
+	// start the sinks; one that can't be started fails, and the others go on without it
+	for (myIndex = 0; myIndex < theSinkCount; myIndex++) {
+		QTFanWorkerPtr		myWorker = &myRing->fWorkers[myIndex];
+
+		myWorker->fRing = myRing;
+		myWorker->fIndex = myIndex;
+		myWorker->fActive = true;
+
+		QTSys_LockMutex(myRing->fMutex);
+		myRing->fActiveCount++;
+		QTSys_UnlockMutex(myRing->fMutex);
+
+		theSinks[myIndex].fErr = QTSys_NewThread(QTFan_SinkThread, myWorker, &myWorker->fThread);
+		if (theSinks[myIndex].fErr != noErr) {
+			QTSys_LockMutex(myRing->fMutex);
+			myWorker->fActive = false;
+			myRing->fActiveCount--;
+			QTSys_UnlockMutex(myRing->fMutex);
+		}
+	}
+
+	for (;;) {
+		// wait for the slowest sink to finish with the oldest frame, if the ring is full
+		QTSys_LockMutex(myRing->fMutex);
+		myWaitStart = 0;
+		while ((myRing->fActiveCount > 0) && (QTFan_GetQueuedCount(myRing) >= myRing->fSlotCount)) {
+			if (myWaitStart == 0)
+				myWaitStart = QTSys_GetMicroseconds();
+			QTSys_WaitCondition(myRing->fSlotAvailable, myRing->fMutex);
+		}
+
+		if (myWaitStart != 0)
+			myWaitTime += QTSys_GetMicroseconds() - myWaitStart;
+
+		if (myRing->fActiveCount == 0) {
+			QTSys_UnlockMutex(myRing->fMutex);
+			break;
+		}
+
+		QTSys_UnlockMutex(myRing->fMutex);
+
+		// no sink reads this slot until we publish it below, so we can fill it without the lock
+		mySlot = &myRing->fSlots[myRing->fWriteCount % myRing->fSlotCount];
+		mySlot->fKind = kFanFrameVideo;
+		mySlot->fIndex = myRing->fWriteCount;
+		myErr = theSource->fReadFrame(theSource->fRefCon, mySlot);
+		if (myErr != noErr) {
+			if (myErr == eofErr)
+				myErr = noErr;
+			break;
+		}
+
+		QTSys_LockMutex(myRing->fMutex);
+		myRing->fWriteCount++;
+		myQueued = QTFan_GetQueuedCount(myRing);
+		if (myQueued > myPeakQueued)
+			myPeakQueued = myQueued;
+		QTSys_BroadcastCondition(myRing->fFrameAvailable);
+		QTSys_UnlockMutex(myRing->fMutex);
+	}
+
+	QTSys_LockMutex(myRing->fMutex);
+	myRing->fFinished = true;
+	QTSys_BroadcastCondition(myRing->fFrameAvailable);
+	QTSys_UnlockMutex(myRing->fMutex);
+
+	for (myIndex = 0; myIndex < theSinkCount; myIndex++)
+		if (myRing->fWorkers[myIndex].fThread != NULL)
+			QTSys_JoinThread(myRing->fWorkers[myIndex].fThread);
+
+	if (theStats != NULL) {
+		theStats->fRingFrames = myRing->fSlotCount;
+		theStats->fFrameCount = myRing->fWriteCount;
+		theStats->fPeakQueued = myPeakQueued;
+		theStats->fWaitMicroseconds = myWaitTime;
+		for (myIndex = 0; myIndex < myRing->fSlotCount; myIndex++)
+			theStats->fRingBytes += myRing->fSlots[myIndex].fCapacity;
+	}
+
+bail:
+	for (myIndex = 0; myIndex < kFanMaxRingFrames; myIndex++)
+		free(myRing->fSlots[myIndex].fData);
+
+	QTSys_DisposeCondition(myRing->fSlotAvailable);
+	QTSys_DisposeCondition(myRing->fFrameAvailable);
+	QTSys_DisposeMutex(myRing->fMutex);
+	free(myRing);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTFan_ReserveFrame
+// Make sure a frame's data can hold theSize bytes, and set its size; sources call this before they fill
+// in a frame. A slot keeps its memory from one frame to the next, so this allocates only at the start.
+//
+//////////
+
+OSErr QTFan_ReserveFrame (QTFanFramePtr theFrame, UInt32 theSize)
+{
+	UInt8			*myData;
+
+	if (theSize > theFrame->fCapacity) {
+		myData = (UInt8 *)realloc(theFrame->fData, theSize);
+		if (myData == NULL)
+			return(memFullErr);
+
+		theFrame->fData = myData;
+		theFrame->fCapacity = theSize;
+	}
+
+	theFrame->fSize = theSize;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTFan_SinkThread
+// Give each frame of the ring, in order, to one sink.
+//
+//////////
+
+static void QTFan_SinkThread (void *theRefCon)
+{
+	QTFanWorkerPtr			myWorker = (QTFanWorkerPtr)theRefCon;
+	QTFanRingPtr			myRing = myWorker->fRing;
+	QTFanSinkPtr			mySink = &myRing->fSinks[myWorker->fIndex];
+	QTFanFramePtr			mySlot;
+	QTUInt64				myTime;
+	OSErr					myErr = noErr;
+
+	if (mySink->fBegin != NULL)
+		myErr = mySink->fBegin(mySink->fRefCon, myRing->fFormat);
+
+	while (myErr == noErr) {
+		QTSys_LockMutex(myRing->fMutex);
+		myTime = QTSys_GetMicroseconds();
+		while ((myWorker->fReadCount == myRing->fWriteCount) && !myRing->fFinished)
+			QTSys_WaitCondition(myRing->fFrameAvailable, myRing->fMutex);
+		mySink->fWaitMicroseconds += QTSys_GetMicroseconds() - myTime;
+
+		if (myWorker->fReadCount == myRing->fWriteCount) {
+			QTSys_UnlockMutex(myRing->fMutex);
+			break;
+		}
+
+		mySlot = &myRing->fSlots[myWorker->fReadCount % myRing->fSlotCount];
+		QTSys_UnlockMutex(myRing->fMutex);
+
+		myTime = QTSys_GetMicroseconds();
+		myErr = mySink->fWrite(mySink->fRefCon, mySlot);
+		mySink->fBusyMicroseconds += QTSys_GetMicroseconds() - myTime;
+		if (myErr != noErr)
+			break;
+
+		mySink->fFrameCount++;
+
+		QTSys_LockMutex(myRing->fMutex);
+		myWorker->fReadCount++;
+		QTSys_SignalCondition(myRing->fSlotAvailable);
+		QTSys_UnlockMutex(myRing->fMutex);
+	}
+
+	// stop holding the source back before we finish up, which may take a while
+	QTSys_LockMutex(myRing->fMutex);
+	myWorker->fActive = false;
+	myRing->fActiveCount--;
+	QTSys_SignalCondition(myRing->fSlotAvailable);
+	QTSys_UnlockMutex(myRing->fMutex);
+
+	if (mySink->fEnd != NULL)
+		myErr = mySink->fEnd(mySink->fRefCon, myErr);
+
+	mySink->fErr = myErr;
+}
+
+
+//////////
+//
+// QTFan_GetQueuedCount
+// Return the number of frames that the slowest active sink has yet to finish with; the ring's mutex must be held.
+//
+//////////
+
+static long QTFan_GetQueuedCount (QTFanRingPtr theRing)
+{
+	long			myQueued = 0;
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < kFanMaxSinks; myIndex++) {
+		QTFanWorkerPtr		myWorker = &theRing->fWorkers[myIndex];
+
+		if (myWorker->fActive && (theRing->fWriteCount - myWorker->fReadCount > myQueued))
+			myQueued = theRing->fWriteCount - myWorker->fReadCount;
+	}
+
+	return(myQueued);
+}
@@ -0,0 +1,110 @@
+//////////
+//
+//	File:		QTFanout.h
+//
+//	Contains:	Portable functions for feeding one decoded source to several output sinks at once.
+//				All utilities start with the prefix "QTFan_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTFanout__
+#define __QTFanout__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSystem.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kFanMaxSinks						16
+#define kFanDefaultRingFrames				8						// decoded frames a slow sink may fall behind by
+#define kFanMaxRingFrames					64
+
+// kinds of frame
+enum {
+	kFanFrameVideo							= 0						// 32-bit pixels, fRowBytes bytes per row
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// what the source produces; set by the caller of QTFan_Run before it starts
+typedef struct QTFanFormatRecord {
+	long					fWidth;
+	long					fHeight;
+	long					fTimeScale;				// units of the frames' times and durations
+	long					fFrameCount;			// or 0 if unknown
+} QTFanFormatRecord, *QTFanFormatPtr;
+
+// one slot of the ring; the source fills it, and the sinks only read it
+typedef struct QTFanFrameRecord {
+	long					fKind;					// one of the kFanFrame constants
+	long					fIndex;					// 0 for the first frame of the source
+	long					fTime;
+	long					fDuration;
+	long					fWidth;
+	long					fHeight;
+	long					fRowBytes;
+	UInt8					*fData;
+	UInt32					fSize;
+	UInt32					fCapacity;				// see QTFan_ReserveFrame
+} QTFanFrameRecord, *QTFanFramePtr;
+
+// the source: fReadFrame fills in the next frame, or returns eofErr after the last one; it runs on the
+// thread that called QTFan_Run
+typedef struct QTFanSourceRecord {
+	void					*fRefCon;
+	OSErr					(*fReadFrame) (void *theRefCon, QTFanFramePtr theFrame);
+} QTFanSourceRecord, *QTFanSourcePtr;
+
+// a sink: each runs on a thread of its own, which calls fBegin, then fWrite for each frame in order, then
+// fEnd with the error that stopped it (or noErr); fEnd's result is the sink's final error
+typedef struct QTFanSinkRecord {
+	const char				*fName;
+	void					*fRefCon;
+	OSErr					(*fBegin) (void *theRefCon, const QTFanFormatRecord *theFormat);
+	OSErr					(*fWrite) (void *theRefCon, const QTFanFrameRecord *theFrame);
+	OSErr					(*fEnd) (void *theRefCon, OSErr theErr);
+
+	// set by QTFan_Run
+	OSErr					fErr;
+	long					fFrameCount;			// frames written
+	QTUInt64				fWaitMicroseconds;		// waiting for the source
+	QTUInt64				fBusyMicroseconds;		// in fWrite
+} QTFanSinkRecord, *QTFanSinkPtr;
+
+typedef struct QTFanStatsRecord {
+	long					fRingFrames;
+	long					fFrameCount;			// frames read from the source
+	long					fPeakQueued;			// most frames waiting for the slowest sink at once
+	QTUInt64				fRingBytes;				// memory held by the ring at the end
+	QTUInt64				fWaitMicroseconds;		// time the source spent held back by a full ring
+} QTFanStatsRecord, *QTFanStatsPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTFan_Run (QTFanSourcePtr theSource, const QTFanFormatRecord *theFormat, QTFanSinkPtr theSinks, long theSinkCount, long theRingFrames, QTFanStatsPtr theStats);
+OSErr						QTFan_ReserveFrame (QTFanFramePtr theFrame, UInt32 theSize);
+
+#endif	// __QTFanout__
@@ -0,0 +1,1834 @@
+//////////
+//
+//	File:		QTHinter.c
+//
+//	Contains:	A portable engine that adds RTP hint tracks to QuickTime and MPEG-4 files.
+//				All utilities start with the prefix "QTHint_".
+//
+//	QTDX_ExportMovieAsHintedMovie hands the whole job to the 'hint' movie export component, which
+//	packetizes one track after another on the calling thread and doesn't tell us how. This file does
+//	the same job itself, from the sample tables in the file:
+//
+//	  * Every audio-visual track gets a hint track. Each hint sample holds the RTP packets for one media
+//	    sample; a sample larger than a packet is split across several packets, with the RTP marker bit set
+//	    on the last one. Sound samples are small, so for sound tracks we instead gather consecutive samples
+//	    into a single packet, up to the packet size. The packets contain no media data, only references
+//	    ("sample constructors") to the media samples, so the hint data is small.
+//
+//	  * The tracks are hinted in parallel, one scheduler job (see QTScheduler.c) per track. Each job
+//	    streams its hint samples to a spill file next to the output file and keeps only the hint sample
+//	    sizes and durations in memory.
+//
+//	  * The output file starts with an exact copy of the input file, except that the old movie atom is
+//	    turned into a 'free' atom; since nothing moves, every existing chunk offset stays valid. Then come
+//	    a new 'mdat' atom holding the spill files, one after the other, and a new movie atom holding the
+//	    old tracks and the new hint tracks. Hinting is therefore one sequential pass over the input file,
+//	    and is limited by the speed of the disk.
+//
+//	MPEG-4 video tracks are sent as RFC 3016 describes (MP4V-ES), which is our generic fragmenting with the
+//	decoder configuration in the SDP text, and AAC tracks as RFC 3640 describes (mpeg4-generic, AAC-hbr),
+//	which puts an AU header in front of every access unit. We build the AU headers with immediate-data
+//	constructors, so they're still the only bytes of the packets that are in the hint samples. Any other
+//	track gets our own payload format (kHintGenericEncodingName), which is simply the sample data,
+//	fragmented, and which only our own clients can depacketize; fStandardOnly refuses such tracks.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTHinter.h"
+#include "QTScheduler.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kHintSpillBufferSize		(1024L * 1024L)			// hint data gathered in memory before it goes to the spill file
+#define kHintCopyBufferSize			(1024L * 1024L)			// size of the buffer used to copy the input and spill files
+#define kHintInitialTableCapacity	1024					// initial number of hint sample sizes and durations
+
+#define kHintSampleHeaderSize		4						// packet count, reserved
+#define kHintPacketHeaderSize		12						// relative time, header info, sequence, flags, entry count
+#define kHintEntrySize				16						// every data-table entry is this size
+#define kHintMarkerBit				0x0080					// in the RTP header info of a packet
+#define kHintConstructorImmediate	1						// data-table entry that holds the data itself
+#define kHintConstructorSample		2						// data-table entry that refers to media sample data
+#define kHintImmediateSize			14						// most data one immediate-data entry holds
+#define kHintTrackRefIndex			0						// the first track in our 'hint' track reference
+#define kHintMaxAggregateEntries	64						// most entries in one gathered sound packet
+#define kHintHintingPercent			(kProgDone / 4)			// share of the progress for building the hint samples; the rest is writing the file
+#define kHintPollMilliseconds		20						// how often we look at the tracks' progress while they're hinted
+
+#define kHintFormatMP4V				FOUR_CHAR_CODE('mp4v')	// sample description types with standard payload formats
+#define kHintFormatMP4A				FOUR_CHAR_CODE('mp4a')
+#define kHintAtomTypeESDS			FOUR_CHAR_CODE('esds')	// the elementary stream descriptor in a sample description
+#define kHintAtomTypeWave			FOUR_CHAR_CODE('wave')	// QuickTime puts a sound description's 'esds' in here
+#define kHintVisualEntrySize		86						// the fixed part of a visual sample description, header included
+#define kHintSoundEntrySize			36						// the fixed part of a version 0 sound description, header included
+#define kHintSoundVersion1Size		16						// what version 1 adds to it
+#define kHintSoundVersion2Size		36						// what version 2 adds to it
+#define kHintESDescriptorTag		3						// MPEG-4 descriptor tags
+#define kHintDecoderConfigTag		4
+#define kHintDecoderSpecificTag		5
+#define kHintDecoderConfigSize		13						// the decoder configuration descriptor, before its own descriptors
+#define kHintObjectMPEG4Visual		0x20					// objectTypeIndication values
+#define kHintObjectMPEG4Audio		0x40
+#define kHintObjectMPEG2AACFirst	0x66					// MPEG-2 AAC main, LC and SSR profiles
+#define kHintObjectMPEG2AACLast		0x68
+#define kHintAUHeadersLengthSize	2						// RFC 3640 AU-headers-length field
+#define kHintAUHeaderSize			2						// AAC-hbr AU header: 13 bits of size, 3 of index
+#define kHintMaxAUSize				0x1FFF					// largest size an AAC-hbr AU header holds
+
+#define kHintSpillExtension			"hint"
+#define kHintHandlerName			"Hint Handler"
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// one sample constructor: theLength bytes at theOffset in media sample fSampleNumber
+typedef struct QTHintEntryRecord {
+	UInt32					fSampleNumber;
+	UInt32					fOffset;
+	UInt32					fLength;
+} QTHintEntryRecord, *QTHintEntryPtr;
+
+// one track being hinted; owned by the worker that hints it until its job finishes
+typedef struct QTHintTrackRecord {
+	QTStblTrackPtr			fMedia;
+	UInt32					fMaxPayload;			// largest packet payload
+	Boolean					fAggregate;				// gather small samples into one packet?
+	QTHintTrackResultRecord	fResult;
+	UInt8					fConfig[kHintMaxConfigSize];	// decoder specific info, for the SDP text
+	UInt32					fConfigSize;
+	UInt32					fChannelCount;			// of an AAC track
+
+	char					fSpillPath[kQTSysMaxPath];
+	QTSysFile				fSpill;
+	QTAtomBufferRecord		fBuffer;				// hint samples not yet written to the spill file
+	QTUInt64				fSpillSize;
+
+	UInt32					*fSampleSizes;			// the hint sample sizes
+	UInt32					fSampleCapacity;
+	QTStblTimeEntryPtr		fTimeEntries;			// the hint sample durations, run-length encoded
+	UInt32					fTimeEntryCount;
+	UInt32					fTimeEntryCapacity;
+	QTUInt64				fDuration;
+
+	QTHintEntryRecord		fPending[kHintMaxAggregateEntries];	// the sound packet being gathered
+	long					fPendingCount;
+	UInt32					fPendingBytes;
+	UInt32					fPendingDuration;
+	UInt32					fPendingChunk;
+	QTUInt64				fPendingEnd;			// file offset just past the last gathered sample
+	Boolean					fHasPending;
+
+	QTUInt64				fSecond;				// for measuring the peak bit rate
+	QTUInt64				fSecondBytes;
+	UInt16					fSequence;				// RTP sequence number seed
+
+	volatile long			fSamplesDone;			// media samples hinted so far, published every thousand or so
+} QTHintTrackRecord, *QTHintTrackPtr;
+
+// how far QTHint_HintFile has got, for the caller's progress function; only the calling thread uses it
+typedef struct QTHintProgressRecord {
+	QTHintSettingsPtr		fSettings;
+	QTUInt64				fNextTime;				// we don't call the progress function again before this time (microseconds)
+	QTUInt64				fWriteTotal;			// bytes we write to the output file
+	QTUInt64				fWriteDone;
+} QTHintProgressRecord, *QTHintProgressPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTHint_NewWorker (void *theRefCon, void **theWorkerData);
+static OSErr				QTHint_HintTrackJob (void *theWorkerData, QTSchedJobPtr theJob);
+static void					QTHint_DisposeWorker (void *theWorkerData);
+
+static void					QTHint_BeginSample (QTHintTrackPtr theTrack, UInt16 thePacketCount);
+static void					QTHint_AppendPacket (QTHintTrackPtr theTrack, UInt16 theEntryCount, Boolean theMarker, UInt32 thePayloadSize);
+static void					QTHint_AppendEntry (QTHintTrackPtr theTrack, QTHintEntryPtr theEntry);
+static void					QTHint_AppendImmediate (QTHintTrackPtr theTrack, const UInt8 *theData, UInt32 theLength);
+static OSErr				QTHint_EndSample (QTHintTrackPtr theTrack, UInt32 theSampleStart, QTUInt64 theTime, UInt32 theDuration, UInt32 thePacketBytes);
+static OSErr				QTHint_HintLargeSample (QTHintTrackPtr theTrack, QTStblSamplePtr theSample);
+static OSErr				QTHint_GatherSample (QTHintTrackPtr theTrack, QTStblSamplePtr theSample);
+static OSErr				QTHint_FlushPending (QTHintTrackPtr theTrack);
+static OSErr				QTHint_FlushBuffer (QTHintTrackPtr theTrack);
+static void					QTHint_DisposeTrack (QTHintTrackPtr theTrack);
+
+static void					QTHint_ReadPayloadFormat (QTAtomReaderPtr theReader, QTHintTrackPtr theTrack);
+static Boolean				QTHint_ReadDecoderConfig (const UInt8 *theData, UInt32 theSize, UInt8 *theObjectType, QTHintTrackPtr theTrack);
+static const UInt8 *		QTHint_ReadDescriptor (const UInt8 *theData, const UInt8 *theEnd, UInt8 *theTag, UInt32 *theLength);
+static UInt32				QTHint_GetAACChannelCount (const UInt8 *theConfig, UInt32 theSize);
+static UInt32				QTHint_GetBits (const UInt8 *theData, UInt32 theSize, UInt32 *theBitOffset, UInt32 theCount);
+
+static OSErr				QTHint_WriteAtomHeader (QTSysFile theFile, OSType theType, QTUInt64 theSize, UInt32 theHeaderSize);
+static OSErr				QTHint_WaitForTracks (QTSchedulerPtr theScheduler, QTSchedJobPtr theJobs, QTHintTrackPtr theTracks, long theTrackCount, QTHintProgressPtr theProgress);
+static OSErr				QTHint_ReportProgress (QTHintProgressPtr theProgress, long thePercentDone);
+
+static OSErr				QTHint_CopyRange (QTAtomReaderPtr theReader, QTSysFile theFile, QTUInt64 theOffset, QTUInt64 theLength, UInt8 *theBuffer, QTHintProgressPtr theProgress);
+static OSErr				QTHint_CopyInputFile (QTAtomReaderPtr theReader, QTSysFile theFile, UInt8 *theBuffer, QTUInt64 *theOutSize, QTHintProgressPtr theProgress);
+static OSErr				QTHint_AppendSpillFile (QTSysFile theFile, const char *theSpillPath, UInt8 *theBuffer, QTHintProgressPtr theProgress);
+static OSErr				QTHint_BuildMovieAtom (QTAtomReaderPtr theReader, QTStblMoviePtr theMovie, QTHintTrackPtr theTracks, long theTrackCount, QTUInt64 theDataOffset, QTAtomBufferPtr theBuffer);
+static void					QTHint_AppendHintTrack (QTAtomBufferPtr theBuffer, QTStblMoviePtr theMovie, QTHintTrackPtr theTrack, QTUInt64 theChunkOffset);
+static void					QTHint_AppendSDP (QTAtomBufferPtr theBuffer, QTHintTrackPtr theTrack);
+static const char *			QTHint_GetMediaName (OSType theHandlerType);
+static const char *			QTHint_GetEncodingName (long thePayloadFormat);
+static void					QTHint_FormatHex (char *theText, const UInt8 *theData, UInt32 theSize);
+
+static OSErr				QTHint_MainProgressProc (void *theRefCon, long thePercentDone);
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static QTSchedExporterRecord		gHintExporter = {						// runs one hinting job per track
+	NULL,
+	QTHint_NewWorker,
+	QTHint_HintTrackJob,
+	QTHint_DisposeWorker
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Hinting functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTHint_InitSettings
+// Fill in the default hinting settings.
+//
+//////////
+
+void QTHint_InitSettings (QTHintSettingsPtr theSettings)
+{
+	theSettings->fMaxPacketSize = kHintDefaultPacketSize;
+	theSettings->fPayloadType = kHintDefaultPayloadType;
+	theSettings->fWorkerCount = 0;
+	theSettings->fStandardOnly = false;
+	theSettings->fProgressProc = NULL;
+	theSettings->fProgressRefCon = NULL;
+}
+
+
+//////////
+//
+// QTHint_HintFile
+// Write a copy of the movie file at theInPath, with a hint track for every audio-visual track, to theOutPath.
+//
+// If the settings ask for standard payload formats only, we return unimpErr, before writing anything, when
+// an audio or video track has none; we then skip any other tracks instead of hinting them. Existing hint tracks are dropped (their hint samples stay in the file, unreferenced). If theReport isn't
+// NULL, we write one JSON line per hinted track to it.
+//
+// If the settings have a progress function, we call it on this thread, about every kProgDefaultIntervalMilliseconds,
+// with the fraction done (0 to kProgDone); if it returns an error, we stop and return that error.
+//
+//////////
+
+OSErr QTHint_HintFile (const char *theInPath, const char *theOutPath, QTHintSettingsPtr theSettings, FILE *theReport)
+{
+	QTAtomReaderRecord		myReader = {NULL, NULL, 0};
+	QTStblMovieRecord		myMovie;
+	QTHintTrackPtr			myTracks = NULL;
+	QTSchedJobPtr			myJobs = NULL;
+	QTSchedulerPtr			mySched = NULL;
+	QTSysFile				myOutFile = kQTSysInvalidFile;
+	QTAtomBufferRecord		myMovieAtom;
+	QTHintProgressRecord	myProgress;
+	UInt8					*myCopyBuffer = NULL;
+	QTUInt64				myOutSize = 0;
+	QTUInt64				myDataSize = 0;
+	QTUInt64				myDataOffset = 0;
+	UInt32					myDataHeaderSize = kAtomHeaderSize;
+	UInt32					myNextTrackID;
+	long					myTrackCount = 0;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	memset(&myMovie, 0, sizeof(myMovie));
+	memset(&myProgress, 0, sizeof(myProgress));
+	QTAtom_InitBuffer(&myMovieAtom);
+
+	if ((theInPath == NULL) || (theOutPath == NULL) || (theSettings == NULL))
+		return(paramErr);
+
+	if ((theSettings->fMaxPacketSize < kHintMinPacketSize) || (theSettings->fMaxPacketSize > kHintMaxPacketSize) || (theSettings->fPayloadType > kHintMaxPayloadType))
+		return(paramErr);
+
+	if (strcmp(theInPath, theOutPath) == 0)
+		return(dupFNErr);
+
+	myProgress.fSettings = theSettings;
+
+	myErr = QTAtom_OpenFileReader(theInPath, &myReader);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTStbl_ReadMovie(&myReader, &myMovie);
+	if (myErr != noErr)
+		goto bail;
+
+	myTracks = (QTHintTrackPtr)calloc((size_t)myMovie.fTrackCount + 1, sizeof(QTHintTrackRecord));
+	myJobs = (QTSchedJobPtr)calloc((size_t)myMovie.fTrackCount + 1, sizeof(QTSchedJobRecord));
+	myCopyBuffer = (UInt8 *)malloc(kHintCopyBufferSize);
+	if ((myTracks == NULL) || (myJobs == NULL) || (myCopyBuffer == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	// new tracks get IDs from the movie's next track ID on, unless that is missing or already taken
+	myNextTrackID = myMovie.fNextTrackID;
+	for (myIndex = 0; myIndex < myMovie.fTrackCount; myIndex++)
+		if (myMovie.fTracks[myIndex].fTrackID >= myNextTrackID)
+			myNextTrackID = myMovie.fTracks[myIndex].fTrackID + 1;
+
+	// pick the tracks to hint
+	for (myIndex = 0; myIndex < myMovie.fTrackCount; myIndex++) {
+		QTStblTrackPtr		myMedia = &myMovie.fTracks[myIndex];
+		QTHintTrackPtr		myTrack = &myTracks[myTrackCount];
+
+		if ((myMedia->fHandlerType == kAtomHandlerHint) || (myMedia->fSampleCount == 0) || (myMedia->fTimeScale == 0))
+			continue;
+
+		myTrack->fMedia = myMedia;
+		QTHint_ReadPayloadFormat(&myReader, myTrack);
+
+		if (theSettings->fStandardOnly && (myTrack->fResult.fPayloadFormat == kHintPayloadGeneric)) {
+			if ((myMedia->fHandlerType == kAtomHandlerVideo) || (myMedia->fHandlerType == kAtomHandlerSound)) {
+				myErr = unimpErr;
+				goto bail;
+			}
+			continue;
+		}
+
+		myTrack->fMaxPayload = theSettings->fMaxPacketSize - kHintRTPHeaderSize;
+		myTrack->fAggregate = (myMedia->fHandlerType == kAtomHandlerSound);
+		myTrack->fSpill = kQTSysInvalidFile;
+		myTrack->fResult.fMediaTrackID = myMedia->fTrackID;
+		myTrack->fResult.fHintTrackID = myNextTrackID++;
+		myTrack->fResult.fHandlerType = myMedia->fHandlerType;
+		myTrack->fResult.fPayloadType = (UInt8)((theSettings->fPayloadType + myTrackCount <= kHintMaxPayloadType) ? theSettings->fPayloadType + myTrackCount : kHintMaxPayloadType);
+		myTrack->fResult.fMediaSampleCount = myMedia->fSampleCount;
+		QTAtom_InitBuffer(&myTrack->fBuffer);
+
+		QTSys_FormatString(myTrack->fSpillPath, sizeof(myTrack->fSpillPath), "%s.%lu.%s", theOutPath, (unsigned long)myTrack->fResult.fHintTrackID, kHintSpillExtension);
+		QTSched_InitJob(&myJobs[myTrackCount], theInPath, myTrack->fSpillPath, FOUR_CHAR_CODE('rtp '), kSchedPriorityNormal);
+		myJobs[myTrackCount].fRefCon = myTrack;
+
+		// start the longest tracks first, so the last one to finish isn't a long one started late
+		myJobs[myTrackCount].fPriority = (long)(myMedia->fSampleCount >> 8);
+
+		myTrackCount++;
+	}
+
+	// hint the tracks in parallel; each job writes its hint samples to its own spill file
+	myErr = QTSched_NewScheduler(&gHintExporter, theSettings->fWorkerCount, myTrackCount + 1, &mySched);
+	if (myErr != noErr)
+		goto bail;
+
+	for (myIndex = 0; myIndex < myTrackCount; myIndex++)
+		QTSched_SubmitJob(mySched, &myJobs[myIndex]);
+
+	myErr = QTHint_WaitForTracks(mySched, myJobs, myTracks, myTrackCount, &myProgress);
+	QTSched_DisposeScheduler(mySched);
+	mySched = NULL;
+
+	for (myIndex = 0; myIndex < myTrackCount; myIndex++) {
+		if ((myErr == noErr) && (myJobs[myIndex].fErr != noErr))
+			myErr = myJobs[myIndex].fErr;
+
+		myTracks[myIndex].fResult.fErr = myJobs[myIndex].fErr;
+		myDataSize += myTracks[myIndex].fSpillSize;
+	}
+
+	if (myErr != noErr)
+		goto bail;
+
+	// write the output file: the input file (with the old movie atom freed), the hint data, the new movie atom
+	myErr = QTSys_OpenFile(theOutPath, kQTSysOpenWrite, &myOutFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myProgress.fWriteTotal = myReader.fSize + myDataSize;
+
+	myErr = QTHint_CopyInputFile(&myReader, myOutFile, myCopyBuffer, &myOutSize, &myProgress);
+	if (myErr != noErr)
+		goto bail;
+
+	if (kAtomHeaderSize + myDataSize > 0xFFFFFFFFUL)
+		myDataHeaderSize = kAtomExtendedHeaderSize;
+
+	myErr = QTHint_WriteAtomHeader(myOutFile, kAtomTypeMovieData, myDataHeaderSize + myDataSize, myDataHeaderSize);
+	if (myErr != noErr)
+		goto bail;
+
+	myDataOffset = myOutSize + myDataHeaderSize;
+
+	for (myIndex = 0; myIndex < myTrackCount; myIndex++) {
+		myErr = QTHint_AppendSpillFile(myOutFile, myTracks[myIndex].fSpillPath, myCopyBuffer, &myProgress);
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	myErr = QTHint_BuildMovieAtom(&myReader, &myMovie, myTracks, myTrackCount, myDataOffset, &myMovieAtom);
+	if (myErr == noErr)
+		myErr = QTSys_WriteFile(myOutFile, myMovieAtom.fData, myMovieAtom.fSize);
+
+	// the file is complete, so there's nothing left to cancel
+	if (myErr == noErr)
+		QTHint_ReportProgress(&myProgress, kProgDone);
+
+bail:
+	QTSched_DisposeScheduler(mySched);
+
+	if (myOutFile != kQTSysInvalidFile) {
+		QTSys_CloseFile(myOutFile);
+		if (myErr != noErr)
+			QTSys_DeletePath(theOutPath);
+	}
+
+	if (myTracks != NULL) {
+		for (myIndex = 0; myIndex < myTrackCount; myIndex++) {
+			if (theReport != NULL) {
+				QTHint_WriteTrackReport(theReport, &myTracks[myIndex].fResult);
+				fflush(theReport);
+			}
+
+			QTSys_DeletePath(myTracks[myIndex].fSpillPath);
+			QTHint_DisposeTrack(&myTracks[myIndex]);
+		}
+	}
+
+	QTAtom_DisposeBuffer(&myMovieAtom);
+	QTStbl_DisposeMovie(&myMovie);
+	QTAtom_CloseFileReader(&myReader);
+
+	free(myCopyBuffer);
+	free(myJobs);
+	free(myTracks);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_WriteTrackReport
+// Write what we did to one track as a single line of JSON.
+//
+//////////
+
+void QTHint_WriteTrackReport (FILE *theReport, QTHintTrackResultPtr theResult)
+{
+	fprintf(theReport, "{\"mediaTrackID\":%lu,\"hintTrackID\":%lu,\"media\":\"%s\",\"encoding\":\"%s\",\"payloadType\":%u,\"mediaSamples\":%lu,\"hintSamples\":%lu,\"packets\":%llu,\"packetBytes\":%llu,\"maxPacketSize\":%lu,\"maxBitRate\":%lu,\"avgBitRate\":%lu,\"wallMicroseconds\":%llu,\"err\":%d}\n",
+						(unsigned long)theResult->fMediaTrackID,
+						(unsigned long)theResult->fHintTrackID,
+						QTHint_GetMediaName(theResult->fHandlerType),
+						QTHint_GetEncodingName(theResult->fPayloadFormat),
+						(unsigned int)theResult->fPayloadType,
+						(unsigned long)theResult->fMediaSampleCount,
+						(unsigned long)theResult->fHintSampleCount,
+						(unsigned long long)theResult->fPacketCount,
+						(unsigned long long)theResult->fPacketBytes,
+						(unsigned long)theResult->fMaxPacketSize,
+						(unsigned long)theResult->fMaxBitRate,
+						(unsigned long)theResult->fAvgBitRate,
+						(unsigned long long)theResult->fWallMicroseconds,
+						(int)theResult->fErr);
+}
+
+
+//////////
+//
+// QTHint_WaitForTracks
+// Wait until every track has been hinted, reporting the progress of the tracks as a whole while we wait.
+//
+// If the progress function asks us to stop, we cancel the jobs that haven't finished and return its error.
+//
+//////////
+
+static OSErr QTHint_WaitForTracks (QTSchedulerPtr theScheduler, QTSchedJobPtr theJobs, QTHintTrackPtr theTracks, long theTrackCount, QTHintProgressPtr theProgress)
+{
+	QTUInt64				myTotal = 0;
+	QTUInt64				myDone;
+	long					myRunning = theTrackCount;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 0; myIndex < theTrackCount; myIndex++)
+		myTotal += theTracks[myIndex].fMedia->fSampleCount;
+
+	// without a progress function, there's nothing to do but wait
+	while ((theProgress->fSettings->fProgressProc != NULL) && (myRunning > 0) && (myTotal > 0)) {
+		myRunning = 0;
+		myDone = 0;
+		for (myIndex = 0; myIndex < theTrackCount; myIndex++) {
+			if (QTSys_AtomicLoad(&theJobs[myIndex].fState) < kSchedJobDone)
+				myRunning++;
+			myDone += (UInt32)QTSys_AtomicLoad(&theTracks[myIndex].fSamplesDone);
+		}
+
+		myErr = QTHint_ReportProgress(theProgress, (long)((myDone * kHintHintingPercent) / myTotal));
+		if (myErr != noErr) {
+			QTSched_CancelAllJobs(theScheduler);
+			break;
+		}
+
+		if (myRunning > 0)
+			QTSys_Sleep(kHintPollMilliseconds);
+	}
+
+	QTSched_WaitForAllJobs(theScheduler);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_ReportProgress
+// Pass the fraction done to the caller's progress function, if it has one and it's been long enough
+// since we last did; the caller may well redraw something every time.
+//
+//////////
+
+static OSErr QTHint_ReportProgress (QTHintProgressPtr theProgress, long thePercentDone)
+{
+	QTHintSettingsPtr		mySettings = theProgress->fSettings;
+	QTUInt64				myTime;
+
+	if (mySettings->fProgressProc == NULL)
+		return(noErr);
+
+	myTime = QTSys_GetMicroseconds();
+	if ((myTime < theProgress->fNextTime) && (thePercentDone < kProgDone))
+		return(noErr);
+
+	theProgress->fNextTime = myTime + (QTUInt64)kProgDefaultIntervalMilliseconds * 1000;
+	return(mySettings->fProgressProc(mySettings->fProgressRefCon, thePercentDone));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Track-hinting functions.
+//
+// These run on the scheduler's worker threads, one job per track. A job touches only its own
+// QTHintTrackRecord and the (read-only) sample tables of its media track.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTHint_NewWorker
+// Hinting workers need no state of their own.
+//
+//////////
+
+static OSErr QTHint_NewWorker (void *theRefCon, void **theWorkerData)
+{
+#pragma unused(theRefCon)
+
+	*theWorkerData = NULL;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTHint_DisposeWorker
+// Hinting workers need no state of their own.
+//
+//////////
+
+static void QTHint_DisposeWorker (void *theWorkerData)
+{
+#pragma unused(theWorkerData)
+}
+
+
+//////////
+//
+// QTHint_HintTrackJob
+// Build the hint samples for one track and write them to the track's spill file.
+//
+//////////
+
+static OSErr QTHint_HintTrackJob (void *theWorkerData, QTSchedJobPtr theJob)
+{
+#pragma unused(theWorkerData)
+
+	QTHintTrackPtr			myTrack = (QTHintTrackPtr)theJob->fRefCon;
+	QTHintTrackResultPtr	myResult = &myTrack->fResult;
+	QTStblIteratorRecord	myIterator;
+	QTStblSampleRecord		mySample;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	UInt32					myCount = 0;
+	UInt32					myOverhead = 0;			// payload bytes a sample needs besides its data, alone in a packet
+	OSErr					myErr = noErr;
+
+	if (myResult->fPayloadFormat == kHintPayloadAAC)
+		myOverhead = kHintAUHeadersLengthSize + kHintAUHeaderSize;
+
+	myErr = QTSys_OpenFile(myTrack->fSpillPath, kQTSysOpenWrite, &myTrack->fSpill);
+	if (myErr != noErr)
+		goto bail;
+
+	myTrack->fSampleSizes = (UInt32 *)malloc(kHintInitialTableCapacity * sizeof(UInt32));
+	myTrack->fTimeEntries = (QTStblTimeEntryPtr)malloc(kHintInitialTableCapacity * sizeof(QTStblTimeEntryRecord));
+	if ((myTrack->fSampleSizes == NULL) || (myTrack->fTimeEntries == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+	myTrack->fSampleCapacity = kHintInitialTableCapacity;
+	myTrack->fTimeEntryCapacity = kHintInitialTableCapacity;
+
+	QTStbl_InitIterator(myTrack->fMedia, &myIterator);
+	while (QTStbl_NextSample(&myIterator, &mySample)) {
+		// checking every sample would be wasteful; a thousand samples take well under a millisecond
+		if ((++myCount & 0x3FF) == 0) {
+			QTSys_AtomicStore(&myTrack->fSamplesDone, (long)myCount);
+			if (QTSched_IsJobCancelled(theJob)) {
+				myErr = userCanceledErr;
+				goto bail;
+			}
+		}
+
+		// an AU header has no room for the size of a larger access unit
+		if ((myResult->fPayloadFormat == kHintPayloadAAC) && (mySample.fSize > kHintMaxAUSize)) {
+			myErr = unimpErr;
+			goto bail;
+		}
+
+		if (myTrack->fAggregate && (mySample.fSize + myOverhead <= myTrack->fMaxPayload))
+			myErr = QTHint_GatherSample(myTrack, &mySample);
+		else
+			myErr = QTHint_HintLargeSample(myTrack, &mySample);
+
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	// the tables ran out before the sample count did
+	if (myCount != myTrack->fMedia->fSampleCount) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	QTSys_AtomicStore(&myTrack->fSamplesDone, (long)myCount);
+
+	myErr = QTHint_FlushPending(myTrack);
+	if (myErr == noErr)
+		myErr = QTHint_FlushBuffer(myTrack);
+	if (myErr != noErr)
+		goto bail;
+
+	// the bit rates, including the last (partial) second
+	if (myTrack->fSecondBytes * 8 > myResult->fMaxBitRate)
+		myResult->fMaxBitRate = (UInt32)(myTrack->fSecondBytes * 8);
+
+	if (myTrack->fDuration > 0)
+		myResult->fAvgBitRate = (UInt32)((myResult->fPacketBytes * 8 * myTrack->fMedia->fTimeScale) / myTrack->fDuration);
+
+bail:
+	if (myTrack->fSpill != kQTSysInvalidFile) {
+		QTSys_CloseFile(myTrack->fSpill);
+		myTrack->fSpill = kQTSysInvalidFile;
+	}
+
+	QTAtom_DisposeBuffer(&myTrack->fBuffer);
+	myResult->fWallMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_HintLargeSample
+// Build a hint sample that sends one media sample, split into as many packets as it takes.
+//
+// In AAC-hbr, every fragment of an access unit starts with the AU headers of the whole access unit.
+//
+//////////
+
+static OSErr QTHint_HintLargeSample (QTHintTrackPtr theTrack, QTStblSamplePtr theSample)
+{
+	QTHintEntryRecord		myEntry;
+	Boolean					myIsAAC = (theTrack->fResult.fPayloadFormat == kHintPayloadAAC);
+	UInt8					myHeaders[kHintAUHeadersLengthSize + kHintAUHeaderSize];
+	UInt32					myFragmentSize = theTrack->fMaxPayload - (myIsAAC ? sizeof(myHeaders) : 0);
+	UInt32					myStart;
+	UInt32					myPacketCount = (theSample->fSize + myFragmentSize - 1) / myFragmentSize;
+	UInt32					myPacketBytes = 0;
+	UInt32					myIndex;
+	OSErr					myErr = noErr;
+
+	myErr = QTHint_FlushPending(theTrack);
+	if (myErr != noErr)
+		return(myErr);
+
+	if (myPacketCount > 0xFFFF)
+		return(invalidAtomErr);
+
+	// the AU-headers-length is in bits
+	QTAtom_PutBE16(myHeaders, kHintAUHeaderSize * 8);
+	QTAtom_PutBE16(myHeaders + kHintAUHeadersLengthSize, (UInt16)(theSample->fSize << 3));
+
+	myStart = theTrack->fBuffer.fSize;
+	QTHint_BeginSample(theTrack, (UInt16)myPacketCount);
+
+	myEntry.fSampleNumber = theSample->fNumber;
+	for (myIndex = 0; myIndex < myPacketCount; myIndex++) {
+		UInt32			myPayloadSize;
+
+		myEntry.fOffset = myIndex * myFragmentSize;
+		myEntry.fLength = theSample->fSize - myEntry.fOffset;
+		if (myEntry.fLength > myFragmentSize)
+			myEntry.fLength = myFragmentSize;
+
+		// the marker bit flags the last packet of the sample
+		if (myIsAAC) {
+			myPayloadSize = sizeof(myHeaders) + myEntry.fLength;
+			QTHint_AppendPacket(theTrack, 2, (myIndex == myPacketCount - 1), myPayloadSize);
+			QTHint_AppendImmediate(theTrack, myHeaders, sizeof(myHeaders));
+		} else {
+			myPayloadSize = myEntry.fLength;
+			QTHint_AppendPacket(theTrack, 1, (myIndex == myPacketCount - 1), myPayloadSize);
+		}
+
+		QTHint_AppendEntry(theTrack, &myEntry);
+		myPacketBytes += kHintRTPHeaderSize + myPayloadSize;
+	}
+
+	return(QTHint_EndSample(theTrack, myStart, theSample->fTime, theSample->fDuration, myPacketBytes));
+}
+
+
+//////////
+//
+// QTHint_GatherSample
+// Add a small sample to the sound packet being gathered, sending that packet first if the sample won't fit.
+//
+// When every sample has the same size (as with QuickTime's uncompressed and IMA sound), consecutive
+// samples in a chunk are contiguous and one constructor covers them all; otherwise each sample gets its own.
+// AAC samples always get their own, since each one needs its own AU header (see QTHint_FlushPending).
+//
+//////////
+
+static OSErr QTHint_GatherSample (QTHintTrackPtr theTrack, QTStblSamplePtr theSample)
+{
+	Boolean			myIsAAC = (theTrack->fResult.fPayloadFormat == kHintPayloadAAC);
+	UInt32			mySize = theSample->fSize + (myIsAAC ? kHintAUHeaderSize : 0);
+	Boolean			myIsContiguous;
+	OSErr			myErr = noErr;
+
+	myIsContiguous = !myIsAAC && theTrack->fHasPending && (theTrack->fPendingCount > 0) && (theTrack->fMedia->fSampleSizes == NULL) &&
+					 (theSample->fChunk == theTrack->fPendingChunk) && (theSample->fOffset == theTrack->fPendingEnd);
+
+	if (theTrack->fHasPending &&
+		((theTrack->fPendingBytes + mySize > theTrack->fMaxPayload) ||
+		 (!myIsContiguous && (theTrack->fPendingCount == kHintMaxAggregateEntries)))) {
+		myErr = QTHint_FlushPending(theTrack);
+		if (myErr != noErr)
+			return(myErr);
+		myIsContiguous = false;
+	}
+
+	// an AAC packet starts with the length of its AU headers
+	if (!theTrack->fHasPending && myIsAAC)
+		theTrack->fPendingBytes = kHintAUHeadersLengthSize;
+
+	theTrack->fHasPending = true;
+
+	if ((theSample->fSize > 0) || myIsAAC) {
+		if (myIsContiguous) {
+			theTrack->fPending[theTrack->fPendingCount - 1].fLength += theSample->fSize;
+		} else {
+			QTHintEntryPtr		myEntry = &theTrack->fPending[theTrack->fPendingCount++];
+
+			myEntry->fSampleNumber = theSample->fNumber;
+			myEntry->fOffset = 0;
+			myEntry->fLength = theSample->fSize;
+		}
+
+		theTrack->fPendingChunk = theSample->fChunk;
+		theTrack->fPendingEnd = theSample->fOffset + theSample->fSize;
+	}
+
+	theTrack->fPendingBytes += mySize;
+	theTrack->fPendingDuration += theSample->fDuration;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTHint_FlushPending
+// Build a hint sample that sends the gathered sound samples in a single packet.
+//
+// An AAC packet starts with the AU-headers-length and an AU header for each access unit, which we send as
+// immediate data, followed by the access units themselves.
+//
+//////////
+
+static OSErr QTHint_FlushPending (QTHintTrackPtr theTrack)
+{
+	UInt32			myStart = theTrack->fBuffer.fSize;
+	QTUInt64		myTime = 0;
+	long			myIndex;
+	OSErr			myErr = noErr;
+
+	if (!theTrack->fHasPending)
+		return(noErr);
+
+	QTHint_BeginSample(theTrack, (UInt16)((theTrack->fPendingCount > 0) ? 1 : 0));
+
+	if (theTrack->fPendingCount > 0) {
+		if (theTrack->fResult.fPayloadFormat == kHintPayloadAAC) {
+			UInt8		myHeaders[kHintAUHeadersLengthSize + kHintAUHeaderSize * kHintMaxAggregateEntries];
+			UInt32		myHeaderSize = kHintAUHeadersLengthSize + kHintAUHeaderSize * (UInt32)theTrack->fPendingCount;
+			UInt32		myOffset;
+
+			// the AU-headers-length is in bits; every AU index (delta) is 0, since the access units are consecutive
+			QTAtom_PutBE16(myHeaders, (UInt16)((myHeaderSize - kHintAUHeadersLengthSize) * 8));
+			for (myIndex = 0; myIndex < theTrack->fPendingCount; myIndex++)
+				QTAtom_PutBE16(myHeaders + kHintAUHeadersLengthSize + kHintAUHeaderSize * myIndex, (UInt16)(theTrack->fPending[myIndex].fLength << 3));
+
+			QTHint_AppendPacket(theTrack, (UInt16)(theTrack->fPendingCount + (myHeaderSize + kHintImmediateSize - 1) / kHintImmediateSize), true, theTrack->fPendingBytes);
+			for (myOffset = 0; myOffset < myHeaderSize; myOffset += kHintImmediateSize)
+				QTHint_AppendImmediate(theTrack, myHeaders + myOffset, (myHeaderSize - myOffset > kHintImmediateSize) ? kHintImmediateSize : myHeaderSize - myOffset);
+		} else {
+			QTHint_AppendPacket(theTrack, (UInt16)theTrack->fPendingCount, true, theTrack->fPendingBytes);
+		}
+
+		for (myIndex = 0; myIndex < theTrack->fPendingCount; myIndex++)
+			QTHint_AppendEntry(theTrack, &theTrack->fPending[myIndex]);
+	}
+
+	// hint samples are contiguous, so the gathered samples start where the previous hint sample ended
+	myTime = theTrack->fDuration;
+
+	myErr = QTHint_EndSample(theTrack, myStart, myTime, theTrack->fPendingDuration, (theTrack->fPendingCount > 0) ? kHintRTPHeaderSize + theTrack->fPendingBytes : 0);
+
+	theTrack->fHasPending = false;
+	theTrack->fPendingCount = 0;
+	theTrack->fPendingBytes = 0;
+	theTrack->fPendingDuration = 0;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_BeginSample
+// Append the header of a hint sample.
+//
+//////////
+
+static void QTHint_BeginSample (QTHintTrackPtr theTrack, UInt16 thePacketCount)
+{
+	QTAtom_Append16(&theTrack->fBuffer, thePacketCount);
+	QTAtom_Append16(&theTrack->fBuffer, 0);
+}
+
+
+//////////
+//
+// QTHint_AppendPacket
+// Append the header of one packet to the hint sample being built.
+//
+//////////
+
+static void QTHint_AppendPacket (QTHintTrackPtr theTrack, UInt16 theEntryCount, Boolean theMarker, UInt32 thePayloadSize)
+{
+	QTHintTrackResultPtr	myResult = &theTrack->fResult;
+
+	QTAtom_Append32(&theTrack->fBuffer, 0);											// relative transmission time
+	QTAtom_Append16(&theTrack->fBuffer, (UInt16)((theMarker ? kHintMarkerBit : 0) | myResult->fPayloadType));
+	QTAtom_Append16(&theTrack->fBuffer, theTrack->fSequence++);						// RTP sequence number seed
+	QTAtom_Append16(&theTrack->fBuffer, 0);											// flags
+	QTAtom_Append16(&theTrack->fBuffer, theEntryCount);
+
+	myResult->fPacketCount++;
+	if (kHintRTPHeaderSize + thePayloadSize > myResult->fMaxPacketSize)
+		myResult->fMaxPacketSize = kHintRTPHeaderSize + thePayloadSize;
+}
+
+
+//////////
+//
+// QTHint_AppendEntry
+// Append a sample constructor to the packet being built.
+//
+//////////
+
+static void QTHint_AppendEntry (QTHintTrackPtr theTrack, QTHintEntryPtr theEntry)
+{
+	QTAtom_Append8(&theTrack->fBuffer, kHintConstructorSample);
+	QTAtom_Append8(&theTrack->fBuffer, kHintTrackRefIndex);
+	QTAtom_Append16(&theTrack->fBuffer, (UInt16)theEntry->fLength);
+	QTAtom_Append32(&theTrack->fBuffer, theEntry->fSampleNumber);
+	QTAtom_Append32(&theTrack->fBuffer, theEntry->fOffset);
+	QTAtom_Append16(&theTrack->fBuffer, 1);											// bytes per compression block
+	QTAtom_Append16(&theTrack->fBuffer, 1);											// samples per compression block
+}
+
+
+//////////
+//
+// QTHint_AppendImmediate
+// Append an immediate-data constructor, which holds up to kHintImmediateSize bytes, to the packet being built.
+//
+//////////
+
+static void QTHint_AppendImmediate (QTHintTrackPtr theTrack, const UInt8 *theData, UInt32 theLength)
+{
+	QTAtom_Append8(&theTrack->fBuffer, kHintConstructorImmediate);
+	QTAtom_Append8(&theTrack->fBuffer, (UInt8)theLength);
+	QTAtom_AppendBytes(&theTrack->fBuffer, theData, theLength);
+	QTAtom_AppendZeros(&theTrack->fBuffer, kHintImmediateSize - theLength);
+}
+
+
+//////////
+//
+// QTHint_EndSample
+// Record the size and duration of the hint sample that starts at theSampleStart in the track's buffer.
+//
+//////////
+
+static OSErr QTHint_EndSample (QTHintTrackPtr theTrack, UInt32 theSampleStart, QTUInt64 theTime, UInt32 theDuration, UInt32 thePacketBytes)
+{
+	QTHintTrackResultPtr	myResult = &theTrack->fResult;
+	QTUInt64				mySecond = theTime / theTrack->fMedia->fTimeScale;
+
+	if (theTrack->fBuffer.fErr != noErr)
+		return(theTrack->fBuffer.fErr);
+
+	// the sample size
+	if (myResult->fHintSampleCount == theTrack->fSampleCapacity) {
+		UInt32		*mySizes = (UInt32 *)realloc(theTrack->fSampleSizes, 2 * (size_t)theTrack->fSampleCapacity * sizeof(UInt32));
+
+		if (mySizes == NULL)
+			return(memFullErr);
+
+		theTrack->fSampleSizes = mySizes;
+		theTrack->fSampleCapacity *= 2;
+	}
+
+	theTrack->fSampleSizes[myResult->fHintSampleCount++] = theTrack->fBuffer.fSize - theSampleStart;
+
+	// the sample duration, run-length encoded as in 'stts'
+	if ((theTrack->fTimeEntryCount > 0) && (theTrack->fTimeEntries[theTrack->fTimeEntryCount - 1].fDuration == theDuration)) {
+		theTrack->fTimeEntries[theTrack->fTimeEntryCount - 1].fCount++;
+	} else {
+		if (theTrack->fTimeEntryCount == theTrack->fTimeEntryCapacity) {
+			QTStblTimeEntryPtr	myEntries = (QTStblTimeEntryPtr)realloc(theTrack->fTimeEntries, 2 * (size_t)theTrack->fTimeEntryCapacity * sizeof(QTStblTimeEntryRecord));
+
+			if (myEntries == NULL)
+				return(memFullErr);
+
+			theTrack->fTimeEntries = myEntries;
+			theTrack->fTimeEntryCapacity *= 2;
+		}
+
+		theTrack->fTimeEntries[theTrack->fTimeEntryCount].fCount = 1;
+		theTrack->fTimeEntries[theTrack->fTimeEntryCount].fDuration = theDuration;
+		theTrack->fTimeEntryCount++;
+	}
+
+	theTrack->fDuration += theDuration;
+
+	// the bit rates
+	if (mySecond != theTrack->fSecond) {
+		if (theTrack->fSecondBytes * 8 > myResult->fMaxBitRate)
+			myResult->fMaxBitRate = (UInt32)(theTrack->fSecondBytes * 8);
+
+		theTrack->fSecond = mySecond;
+		theTrack->fSecondBytes = 0;
+	}
+
+	theTrack->fSecondBytes += thePacketBytes;
+	myResult->fPacketBytes += thePacketBytes;
+
+	if (theTrack->fBuffer.fSize >= kHintSpillBufferSize)
+		return(QTHint_FlushBuffer(theTrack));
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTHint_FlushBuffer
+// Write the hint samples gathered in the track's buffer to its spill file.
+//
+//////////
+
+static OSErr QTHint_FlushBuffer (QTHintTrackPtr theTrack)
+{
+	OSErr			myErr = theTrack->fBuffer.fErr;
+
+	if ((myErr == noErr) && (theTrack->fBuffer.fSize > 0)) {
+		myErr = QTSys_WriteFile(theTrack->fSpill, theTrack->fBuffer.fData, theTrack->fBuffer.fSize);
+		theTrack->fSpillSize += theTrack->fBuffer.fSize;
+		theTrack->fBuffer.fSize = 0;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_DisposeTrack
+// Dispose of the memory held by a track record.
+//
+//////////
+
+static void QTHint_DisposeTrack (QTHintTrackPtr theTrack)
+{
+	QTAtom_DisposeBuffer(&theTrack->fBuffer);
+
+	free(theTrack->fSampleSizes);
+	free(theTrack->fTimeEntries);
+
+	theTrack->fSampleSizes = NULL;
+	theTrack->fTimeEntries = NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Payload format functions.
+//
+// These run on the calling thread, while QTHint_HintFile picks the tracks to hint.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTHint_ReadPayloadFormat
+// Choose the RTP payload format of a track, from its first sample description.
+//
+// The standard formats need the decoder configuration from the elementary stream descriptor ('esds')
+// for the SDP text; a track whose descriptor is missing or damaged gets our generic format.
+//
+//////////
+
+static void QTHint_ReadPayloadFormat (QTAtomReaderPtr theReader, QTHintTrackPtr theTrack)
+{
+	static const OSType		kSampleDescPath[4] = {kAtomTypeMedia, kAtomTypeMediaInfo, kAtomTypeSampleTable, kAtomTypeSampleDesc};
+	QTStblTrackPtr			myMedia = theTrack->fMedia;
+	Boolean					myIsSound = (myMedia->fSampleFormat == kHintFormatMP4A);
+	QTAtomReaderRecord		myReader;
+	QTAtomHeaderRecord		myAtom, myEntry, myWave, myESDS;
+	UInt8					*myData = NULL;
+	UInt32					mySize = 0;
+	UInt8					myObjectType = 0;
+
+	theTrack->fResult.fPayloadFormat = kHintPayloadGeneric;
+	theTrack->fConfigSize = 0;
+	theTrack->fChannelCount = 0;
+
+	if ((myMedia->fSampleFormat != kHintFormatMP4V) && (myMedia->fSampleFormat != kHintFormatMP4A))
+		return;
+
+	if (QTAtom_FindPath(theReader, &myMedia->fTrackAtom, kSampleDescPath, 4, &myAtom) != noErr)
+		return;
+
+	if (QTAtom_ReadPayload(theReader, &myAtom, &myData, &mySize) != noErr)
+		return;
+
+	// version and flags, then the entry count; the first entry follows
+	QTAtom_InitMemoryReader(&myReader, myData, mySize);
+	if ((mySize < 8) || (QTAtom_ReadHeader(&myReader, 8, mySize, &myEntry) != noErr))
+		goto bail;
+
+	// the entry's children follow its fixed fields; we pass them to QTAtom_FindChild as if they followed its header
+	if (myIsSound) {
+		if (myEntry.fSize < kHintSoundEntrySize)
+			goto bail;
+
+		theTrack->fChannelCount = QTAtom_GetBE16(myData + myEntry.fOffset + 24);
+		switch (QTAtom_GetBE16(myData + myEntry.fOffset + 16)) {
+			case 0:			myEntry.fHeaderSize = kHintSoundEntrySize;											break;
+			case 1:			myEntry.fHeaderSize = kHintSoundEntrySize + kHintSoundVersion1Size;					break;
+			case 2:			myEntry.fHeaderSize = kHintSoundEntrySize + kHintSoundVersion2Size;					break;
+			default:		goto bail;
+		}
+	} else {
+		myEntry.fHeaderSize = kHintVisualEntrySize;
+	}
+
+	if (myEntry.fHeaderSize > myEntry.fSize)
+		goto bail;
+
+	if (QTAtom_FindChild(&myReader, &myEntry, kHintAtomTypeESDS, 1, &myESDS) != noErr) {
+		if (!myIsSound || (QTAtom_FindChild(&myReader, &myEntry, kHintAtomTypeWave, 1, &myWave) != noErr) ||
+			(QTAtom_FindChild(&myReader, &myWave, kHintAtomTypeESDS, 1, &myESDS) != noErr))
+			goto bail;
+	}
+
+	if (!QTHint_ReadDecoderConfig(myData + myESDS.fOffset + myESDS.fHeaderSize, (UInt32)(myESDS.fSize - myESDS.fHeaderSize), &myObjectType, theTrack))
+		goto bail;
+
+	if (!myIsSound && (myObjectType == kHintObjectMPEG4Visual)) {
+		theTrack->fResult.fPayloadFormat = kHintPayloadMP4V;
+	} else if (myIsSound && ((myObjectType == kHintObjectMPEG4Audio) || ((myObjectType >= kHintObjectMPEG2AACFirst) && (myObjectType <= kHintObjectMPEG2AACLast)))) {
+		// the channel configuration in the decoder configuration is more reliable than the sample description's
+		if (QTHint_GetAACChannelCount(theTrack->fConfig, theTrack->fConfigSize) > 0)
+			theTrack->fChannelCount = QTHint_GetAACChannelCount(theTrack->fConfig, theTrack->fConfigSize);
+
+		theTrack->fResult.fPayloadFormat = kHintPayloadAAC;
+	}
+
+bail:
+	free(myData);
+}
+
+
+//////////
+//
+// QTHint_ReadDecoderConfig
+// Read the object type and the decoder specific info from the data of an 'esds' atom.
+//
+// We copy the decoder specific info into the track record. Returns false if there is none, or it's too big.
+//
+//////////
+
+static Boolean QTHint_ReadDecoderConfig (const UInt8 *theData, UInt32 theSize, UInt8 *theObjectType, QTHintTrackPtr theTrack)
+{
+	const UInt8			*myEnd = theData + theSize;
+	UInt8				myTag;
+	UInt32				myLength;
+	UInt8				myFlags;
+
+	// version and flags, then the ES descriptor
+	if (theSize < 4)
+		return(false);
+
+	theData = QTHint_ReadDescriptor(theData + 4, myEnd, &myTag, &myLength);
+	if ((theData == NULL) || (myTag != kHintESDescriptorTag) || (myLength < 3))
+		return(false);
+
+	// the ES ID, then flags that say which optional fields follow
+	myEnd = theData + myLength;
+	myFlags = theData[2];
+	theData += 3;
+
+	if (myFlags & 0x80)										// the ID of the stream this one depends on
+		theData += 2;
+	if ((myFlags & 0x40) && (theData < myEnd))				// a URL, as a Pascal string
+		theData += 1 + theData[0];
+	if (myFlags & 0x20)										// the ID of the OCR stream
+		theData += 2;
+
+	// the decoder configuration descriptor, which holds the decoder specific info descriptor
+	theData = QTHint_ReadDescriptor(theData, myEnd, &myTag, &myLength);
+	if ((theData == NULL) || (myTag != kHintDecoderConfigTag) || (myLength < kHintDecoderConfigSize))
+		return(false);
+
+	*theObjectType = theData[0];
+	myEnd = theData + myLength;
+
+	theData = QTHint_ReadDescriptor(theData + kHintDecoderConfigSize, myEnd, &myTag, &myLength);
+	if ((theData == NULL) || (myTag != kHintDecoderSpecificTag) || (myLength == 0) || (myLength > kHintMaxConfigSize))
+		return(false);
+
+	memcpy(theTrack->fConfig, theData, myLength);
+	theTrack->fConfigSize = myLength;
+
+	return(true);
+}
+
+
+//////////
+//
+// QTHint_ReadDescriptor
+// Read the tag and length of the MPEG-4 descriptor at theData, and return the address of its data.
+//
+// Returns NULL if the descriptor doesn't fit between theData and theEnd.
+//
+//////////
+
+static const UInt8 *QTHint_ReadDescriptor (const UInt8 *theData, const UInt8 *theEnd, UInt8 *theTag, UInt32 *theLength)
+{
+	long				myIndex;
+
+	if (theData >= theEnd)
+		return(NULL);
+
+	*theTag = *theData++;
+	*theLength = 0;
+
+	// the length takes one to four bytes, seven bits in each; the top bit says another byte follows
+	for (myIndex = 0; myIndex < 4; myIndex++) {
+		if (theData >= theEnd)
+			return(NULL);
+
+		*theLength = (*theLength << 7) | (*theData & 0x7F);
+		if ((*theData++ & 0x80) == 0)
+			break;
+	}
+
+	if (*theLength > (UInt32)(theEnd - theData))
+		return(NULL);
+
+	return(theData);
+}
+
+
+//////////
+//
+// QTHint_GetAACChannelCount
+// Return the number of channels that an AudioSpecificConfig describes, or 0 if it doesn't say.
+//
+//////////
+
+static UInt32 QTHint_GetAACChannelCount (const UInt8 *theConfig, UInt32 theSize)
+{
+	UInt32				myBit = 0;
+	UInt32				myChannels;
+
+	// the audio object type, which may be escaped, then the sampling frequency index, which may be escaped too
+	if (QTHint_GetBits(theConfig, theSize, &myBit, 5) == 31)
+		myBit += 6;
+	if (QTHint_GetBits(theConfig, theSize, &myBit, 4) == 15)
+		myBit += 24;
+
+	// channel configuration 7 is 7.1; 0 means the channels are described elsewhere
+	myChannels = QTHint_GetBits(theConfig, theSize, &myBit, 4);
+	return((myChannels == 7) ? 8 : myChannels);
+}
+
+
+//////////
+//
+// QTHint_GetBits
+// Read theCount bits (most significant first) at *theBitOffset, and advance past them. Bits past the end read as 0.
+//
+//////////
+
+static UInt32 QTHint_GetBits (const UInt8 *theData, UInt32 theSize, UInt32 *theBitOffset, UInt32 theCount)
+{
+	UInt32				myValue = 0;
+
+	while (theCount-- > 0) {
+		UInt32			myByte = *theBitOffset >> 3;
+
+		myValue <<= 1;
+		if (myByte < theSize)
+			myValue |= (theData[myByte] >> (7 - (*theBitOffset & 7))) & 1;
+
+		(*theBitOffset)++;
+	}
+
+	return(myValue);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Output functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTHint_WriteAtomHeader
+// Write an atom header with an explicit size.
+//
+//////////
+
+static OSErr QTHint_WriteAtomHeader (QTSysFile theFile, OSType theType, QTUInt64 theSize, UInt32 theHeaderSize)
+{
+	UInt8			myBytes[kAtomExtendedHeaderSize];
+
+	if (theHeaderSize == kAtomExtendedHeaderSize) {
+		QTAtom_PutBE32(myBytes, 1);
+		QTAtom_PutBE32(myBytes + 4, theType);
+		QTAtom_PutBE64(myBytes + 8, theSize);
+	} else {
+		if (theSize > 0xFFFFFFFFUL)
+			return(unimpErr);
+
+		QTAtom_PutBE32(myBytes, (UInt32)theSize);
+		QTAtom_PutBE32(myBytes + 4, theType);
+	}
+
+	return(QTSys_WriteFile(theFile, myBytes, theHeaderSize));
+}
+
+
+//////////
+//
+// QTHint_CopyRange
+// Copy bytes from the reader to the end of the file.
+//
+//////////
+
+static OSErr QTHint_CopyRange (QTAtomReaderPtr theReader, QTSysFile theFile, QTUInt64 theOffset, QTUInt64 theLength, UInt8 *theBuffer, QTHintProgressPtr theProgress)
+{
+	OSErr			myErr = noErr;
+
+	while ((theLength > 0) && (myErr == noErr)) {
+		UInt32		myLength = (theLength > kHintCopyBufferSize) ? kHintCopyBufferSize : (UInt32)theLength;
+
+		myErr = theReader->fRead(theReader->fRefCon, theOffset, theBuffer, myLength);
+		if (myErr == noErr)
+			myErr = QTSys_WriteFile(theFile, theBuffer, myLength);
+
+		theProgress->fWriteDone += myLength;
+		if ((myErr == noErr) && (theProgress->fWriteTotal > 0))
+			myErr = QTHint_ReportProgress(theProgress, kHintHintingPercent + (long)(((kProgDone - kHintHintingPercent) * theProgress->fWriteDone) / theProgress->fWriteTotal));
+
+		theOffset += myLength;
+		theLength -= myLength;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_CopyInputFile
+// Copy the input file, atom by atom, to the output file, turning the movie atom into a 'free' atom.
+//
+// Every atom keeps its offset, so the existing chunk offsets stay valid. We write every header with an
+// explicit size, since an atom that used to extend to the end of the file won't any more.
+//
+//////////
+
+static OSErr QTHint_CopyInputFile (QTAtomReaderPtr theReader, QTSysFile theFile, UInt8 *theBuffer, QTUInt64 *theOutSize, QTHintProgressPtr theProgress)
+{
+	QTAtomHeaderRecord		myAtom;
+	QTUInt64				myOffset = 0;
+	OSErr					myErr = noErr;
+
+	while ((myOffset < theReader->fSize) && (myErr == noErr)) {
+		myErr = QTAtom_ReadHeader(theReader, myOffset, theReader->fSize, &myAtom);
+		if (myErr != noErr)
+			break;
+
+		myErr = QTHint_WriteAtomHeader(theFile, (myAtom.fType == kAtomTypeMovie) ? kAtomTypeFree : myAtom.fType, myAtom.fSize, myAtom.fHeaderSize);
+		if (myErr == noErr)
+			myErr = QTHint_CopyRange(theReader, theFile, myAtom.fOffset + myAtom.fHeaderSize, myAtom.fSize - myAtom.fHeaderSize, theBuffer, theProgress);
+
+		myOffset += myAtom.fSize;
+	}
+
+	*theOutSize = myOffset;
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_AppendSpillFile
+// Copy a spill file to the end of the output file.
+//
+//////////
+
+static OSErr QTHint_AppendSpillFile (QTSysFile theFile, const char *theSpillPath, UInt8 *theBuffer, QTHintProgressPtr theProgress)
+{
+	QTAtomReaderRecord		myReader;
+	OSErr					myErr = noErr;
+
+	myErr = QTAtom_OpenFileReader(theSpillPath, &myReader);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTHint_CopyRange(&myReader, theFile, 0, myReader.fSize, theBuffer, theProgress);
+
+	QTAtom_CloseFileReader(&myReader);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTHint_BuildMovieAtom
+// Build the new movie atom: the old one, less its hint tracks, plus a hint track for each hinted track.
+//
+// theDataOffset is the file offset of the first byte of hint data; the tracks' spill files follow one
+// another from there.
+//
+//////////
+
+static OSErr QTHint_BuildMovieAtom (QTAtomReaderPtr theReader, QTStblMoviePtr theMovie, QTHintTrackPtr theTracks, long theTrackCount, QTUInt64 theDataOffset, QTAtomBufferPtr theBuffer)
+{
+	QTAtomHeaderRecord		myAtom;
+	QTUInt64				myOffset = theMovie->fMovieAtom.fOffset + theMovie->fMovieAtom.fHeaderSize;
+	QTUInt64				myEnd = theMovie->fMovieAtom.fOffset + theMovie->fMovieAtom.fSize;
+	UInt32					myMovieStart;
+	UInt32					myNextTrackID = 1;
+	long					myTrackIndex = 0;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 0; myIndex < theTrackCount; myIndex++)
+		if (theTracks[myIndex].fResult.fHintTrackID >= myNextTrackID)
+			myNextTrackID = theTracks[myIndex].fResult.fHintTrackID + 1;
+
+	myMovieStart = QTAtom_BeginAtom(theBuffer, kAtomTypeMovie);
+
+	while ((myEnd - myOffset >= kAtomHeaderSize) && (myErr == noErr)) {
+		myErr = QTAtom_ReadHeader(theReader, myOffset, myEnd, &myAtom);
+		if (myErr != noErr)
+			break;
+
+		myOffset += myAtom.fSize;
+
+		if (myAtom.fType == kAtomTypeTrack) {
+			// QTStbl_ReadMovie read the tracks in this same order
+			QTStblTrackPtr		myTrack = &theMovie->fTracks[myTrackIndex++];
+
+			if (myTrack->fHandlerType == kAtomHandlerHint)
+				continue;
+		}
+
+		myErr = QTAtom_AppendAtomFrom(theBuffer, theReader, &myAtom);
+
+		// the next track ID is the last field of the movie header
+		if ((myErr == noErr) && (myAtom.fType == kAtomTypeMovieHeader) && (myNextTrackID > theMovie->fNextTrackID))
+			QTAtom_PutBE32(theBuffer->fData + theBuffer->fSize - 4, myNextTrackID);
+	}
+
+	for (myIndex = 0; (myIndex < theTrackCount) && (myErr == noErr); myIndex++) {
+		QTHint_AppendHintTrack(theBuffer, theMovie, &theTracks[myIndex], theDataOffset);
+		theDataOffset += theTracks[myIndex].fSpillSize;
+	}
+
+	QTAtom_EndAtom(theBuffer, myMovieStart);
+
+	return((myErr != noErr) ? myErr : theBuffer->fErr);
+}
+
+
+//////////
+//
+// QTHint_AppendHintTrack
+// Append a complete 'trak' atom for the specified hint track, whose hint samples start at theChunkOffset.
+//
+// All of a track's hint samples are contiguous, so the track has a single chunk.
+//
+//////////
+
+static void QTHint_AppendHintTrack (QTAtomBufferPtr theBuffer, QTStblMoviePtr theMovie, QTHintTrackPtr theTrack, QTUInt64 theChunkOffset)
+{
+	static const UInt32		kIdentityMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+	QTHintTrackResultPtr	myResult = &theTrack->fResult;
+	QTStblTrackPtr			myMedia = theTrack->fMedia;
+	Boolean					myIs64Bit = (theChunkOffset + theTrack->fSpillSize > 0xFFFFFFFFUL);
+	Boolean					myIsLong = (theTrack->fDuration > 0xFFFFFFFFUL) || (myMedia->fMovieDuration > 0xFFFFFFFFUL);
+	UInt32					myTrack, myAtom, myMediaAtom, myInfo, myTable, myEntry;
+	UInt32					myIndex;
+
+	myTrack = QTAtom_BeginAtom(theBuffer, kAtomTypeTrack);
+
+	// track header: enabled, and as long as the track it hints
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTrackHeader, myIsLong ? 1 : 0, 0x000001);
+	if (myIsLong) {
+		QTAtom_Append64(theBuffer, 0);													// creation time
+		QTAtom_Append64(theBuffer, 0);													// modification time
+		QTAtom_Append32(theBuffer, myResult->fHintTrackID);
+		QTAtom_Append32(theBuffer, 0);
+		QTAtom_Append64(theBuffer, myMedia->fMovieDuration);
+	} else {
+		QTAtom_Append32(theBuffer, 0);
+		QTAtom_Append32(theBuffer, 0);
+		QTAtom_Append32(theBuffer, myResult->fHintTrackID);
+		QTAtom_Append32(theBuffer, 0);
+		QTAtom_Append32(theBuffer, (UInt32)myMedia->fMovieDuration);
+	}
+	QTAtom_AppendZeros(theBuffer, 8 + 2 + 2 + 2 + 2);									// reserved, layer, group, volume, reserved
+	for (myIndex = 0; myIndex < 9; myIndex++)
+		QTAtom_Append32(theBuffer, kIdentityMatrix[myIndex]);
+	QTAtom_Append32(theBuffer, 0);														// width
+	QTAtom_Append32(theBuffer, 0);														// height
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// track reference: this track hints the media track
+	myAtom = QTAtom_BeginAtom(theBuffer, kAtomTypeTrackReference);
+	myEntry = QTAtom_BeginAtom(theBuffer, kAtomHandlerHint);
+	QTAtom_Append32(theBuffer, myResult->fMediaTrackID);
+	QTAtom_EndAtom(theBuffer, myEntry);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myMediaAtom = QTAtom_BeginAtom(theBuffer, kAtomTypeMedia);
+
+	// media header: the hint track uses the media track's time scale
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMediaHeader, myIsLong ? 1 : 0, 0);
+	if (myIsLong) {
+		QTAtom_Append64(theBuffer, 0);
+		QTAtom_Append64(theBuffer, 0);
+		QTAtom_Append32(theBuffer, myMedia->fTimeScale);
+		QTAtom_Append64(theBuffer, theTrack->fDuration);
+	} else {
+		QTAtom_Append32(theBuffer, 0);
+		QTAtom_Append32(theBuffer, 0);
+		QTAtom_Append32(theBuffer, myMedia->fTimeScale);
+		QTAtom_Append32(theBuffer, (UInt32)theTrack->fDuration);
+	}
+	QTAtom_Append16(theBuffer, theMovie->fIsQuickTime ? 0 : 0x55C4);					// language: English, or 'und'
+	QTAtom_Append16(theBuffer, 0);														// quality
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// handler: QuickTime wants a media handler component type and a Pascal-string name; MPEG-4 wants zero and a C string
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeHandler, 0, 0);
+	QTAtom_Append32(theBuffer, theMovie->fIsQuickTime ? kAtomHandlerMedia : 0);
+	QTAtom_Append32(theBuffer, kAtomHandlerHint);
+	QTAtom_AppendZeros(theBuffer, 12);
+	if (theMovie->fIsQuickTime) {
+		QTAtom_Append8(theBuffer, (UInt8)strlen(kHintHandlerName));
+		QTAtom_AppendBytes(theBuffer, kHintHandlerName, (UInt32)strlen(kHintHandlerName));
+	} else {
+		QTAtom_AppendBytes(theBuffer, kHintHandlerName, (UInt32)strlen(kHintHandlerName) + 1);
+	}
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myInfo = QTAtom_BeginAtom(theBuffer, kAtomTypeMediaInfo);
+
+	// hint media header: packet sizes and bit rates
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeHintHeader, 0, 0);
+	QTAtom_Append16(theBuffer, (UInt16)myResult->fMaxPacketSize);
+	QTAtom_Append16(theBuffer, (UInt16)((myResult->fPacketCount > 0) ? (myResult->fPacketBytes / myResult->fPacketCount) : 0));
+	QTAtom_Append32(theBuffer, myResult->fMaxBitRate);
+	QTAtom_Append32(theBuffer, myResult->fAvgBitRate);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// data information: the hint samples are in this file
+	myAtom = QTAtom_BeginAtom(theBuffer, kAtomTypeDataInfo);
+	myEntry = QTAtom_BeginFullAtom(theBuffer, kAtomTypeDataRef, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_EndAtom(theBuffer, QTAtom_BeginFullAtom(theBuffer, kAtomTypeDataRefURL, 0, 0x000001));
+	QTAtom_EndAtom(theBuffer, myEntry);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myTable = QTAtom_BeginAtom(theBuffer, kAtomTypeSampleTable);
+
+	// sample description: one 'rtp ' entry, with the RTP time scale
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleDesc, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	myEntry = QTAtom_BeginAtom(theBuffer, FOUR_CHAR_CODE('rtp '));
+	QTAtom_AppendZeros(theBuffer, 6);
+	QTAtom_Append16(theBuffer, 1);														// data reference index
+	QTAtom_Append16(theBuffer, 1);														// hint track version
+	QTAtom_Append16(theBuffer, 1);														// last compatible version
+	QTAtom_Append32(theBuffer, theTrack->fMaxPayload + kHintRTPHeaderSize);
+	QTAtom_Append32(theBuffer, 12);
+	QTAtom_Append32(theBuffer, kAtomTypeHintTimeScale);
+	QTAtom_Append32(theBuffer, myMedia->fTimeScale);
+	QTAtom_EndAtom(theBuffer, myEntry);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// time-to-sample
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTimeToSample, 0, 0);
+	QTAtom_Append32(theBuffer, theTrack->fTimeEntryCount);
+	for (myIndex = 0; myIndex < theTrack->fTimeEntryCount; myIndex++) {
+		QTAtom_Append32(theBuffer, theTrack->fTimeEntries[myIndex].fCount);
+		QTAtom_Append32(theBuffer, theTrack->fTimeEntries[myIndex].fDuration);
+	}
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// sample-to-chunk: every sample in the one chunk
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleToChunk, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, myResult->fHintSampleCount);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// sample sizes
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleSize, 0, 0);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, myResult->fHintSampleCount);
+	for (myIndex = 0; myIndex < myResult->fHintSampleCount; myIndex++)
+		QTAtom_Append32(theBuffer, theTrack->fSampleSizes[myIndex]);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// chunk offset
+	myAtom = QTAtom_BeginFullAtom(theBuffer, myIs64Bit ? kAtomTypeChunkOffset64 : kAtomTypeChunkOffset, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	if (myIs64Bit)
+		QTAtom_Append64(theBuffer, theChunkOffset);
+	else
+		QTAtom_Append32(theBuffer, (UInt32)theChunkOffset);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	QTAtom_EndAtom(theBuffer, myTable);
+	QTAtom_EndAtom(theBuffer, myInfo);
+	QTAtom_EndAtom(theBuffer, myMediaAtom);
+
+	// user data: the SDP text that a streaming server sends for this track
+	myAtom = QTAtom_BeginAtom(theBuffer, kAtomTypeUserData);
+	myEntry = QTAtom_BeginAtom(theBuffer, kAtomTypeHintInfo);
+	QTHint_AppendSDP(theBuffer, theTrack);
+	QTAtom_EndAtom(theBuffer, myEntry);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	QTAtom_EndAtom(theBuffer, myTrack);
+}
+
+
+//////////
+//
+// QTHint_AppendSDP
+// Append the 'sdp ' atom of a hint track.
+//
+//////////
+
+static void QTHint_AppendSDP (QTAtomBufferPtr theBuffer, QTHintTrackPtr theTrack)
+{
+	QTHintTrackResultPtr	myResult = &theTrack->fResult;
+	char					myText[1024];
+	char					myRTPMap[64];
+	char					myFormat[2 * kHintMaxConfigSize + 256];
+	char					myConfig[2 * kHintMaxConfigSize + 1];
+	const char				*myMediaName = QTHint_GetMediaName(myResult->fHandlerType);
+	UInt32					myAtom;
+
+	// SDP wants "application" for anything that isn't audio or video
+	if ((myResult->fHandlerType != kAtomHandlerVideo) && (myResult->fHandlerType != kAtomHandlerSound))
+		myMediaName = "application";
+
+	// the standard formats carry the decoder configuration in hex; MPEG-4 video also wants the profile
+	// and level, which is the byte after the visual object sequence start code, if the configuration has one
+	QTHint_FormatHex(myConfig, theTrack->fConfig, theTrack->fConfigSize);
+	myFormat[0] = '\0';
+
+	switch (myResult->fPayloadFormat) {
+		case kHintPayloadMP4V:
+			QTSys_FormatString(myRTPMap, sizeof(myRTPMap), "%s/%lu", kHintMP4VEncodingName, (unsigned long)theTrack->fMedia->fTimeScale);
+			if ((theTrack->fConfigSize > 4) && (QTAtom_GetBE32(theTrack->fConfig) == 0x000001B0))
+				QTSys_FormatString(myFormat, sizeof(myFormat), "a=fmtp:%u profile-level-id=%u;config=%s\r\n", (unsigned int)myResult->fPayloadType, (unsigned int)theTrack->fConfig[4], myConfig);
+			else
+				QTSys_FormatString(myFormat, sizeof(myFormat), "a=fmtp:%u config=%s\r\n", (unsigned int)myResult->fPayloadType, myConfig);
+			break;
+
+		case kHintPayloadAAC:
+			QTSys_FormatString(myRTPMap, sizeof(myRTPMap), "%s/%lu/%lu", kHintAACEncodingName, (unsigned long)theTrack->fMedia->fTimeScale, (unsigned long)theTrack->fChannelCount);
+			QTSys_FormatString(myFormat, sizeof(myFormat), "a=fmtp:%u streamtype=5;profile-level-id=15;mode=AAC-hbr;sizelength=13;indexlength=3;indexdeltalength=3;config=%s\r\n", (unsigned int)myResult->fPayloadType, myConfig);
+			break;
+
+		default:
+			QTSys_FormatString(myRTPMap, sizeof(myRTPMap), "%s/%lu", kHintGenericEncodingName, (unsigned long)theTrack->fMedia->fTimeScale);
+			break;
+	}
+
+	QTSys_FormatString(myText, sizeof(myText), "m=%s 0 RTP/AVP %u\r\nb=AS:%lu\r\na=rtpmap:%u %s\r\n%sa=control:trackID=%lu\r\n",
+						myMediaName,
+						(unsigned int)myResult->fPayloadType,
+						(unsigned long)((myResult->fAvgBitRate + 999) / 1000),
+						(unsigned int)myResult->fPayloadType,
+						myRTPMap,
+						myFormat,
+						(unsigned long)myResult->fHintTrackID);
+
+	myAtom = QTAtom_BeginAtom(theBuffer, kAtomTypeHintSDP);
+	QTAtom_AppendBytes(theBuffer, myText, (UInt32)strlen(myText));
+	QTAtom_EndAtom(theBuffer, myAtom);
+}
+
+
+//////////
+//
+// QTHint_GetMediaName
+// Return the name used for the specified handler type in reports and SDP text.
+//
+//////////
+
+static const char *QTHint_GetMediaName (OSType theHandlerType)
+{
+	switch (theHandlerType) {
+		case kAtomHandlerVideo:			return("video");
+		case kAtomHandlerSound:			return("audio");
+		default:						return("other");
+	}
+}
+
+
+//////////
+//
+// QTHint_GetEncodingName
+// Return the RTP encoding name of the specified payload format.
+//
+//////////
+
+static const char *QTHint_GetEncodingName (long thePayloadFormat)
+{
+	switch (thePayloadFormat) {
+		case kHintPayloadMP4V:			return(kHintMP4VEncodingName);
+		case kHintPayloadAAC:			return(kHintAACEncodingName);
+		default:						return(kHintGenericEncodingName);
+	}
+}
+
+
+//////////
+//
+// QTHint_FormatHex
+// Write theSize bytes as a C string of hex digits, two per byte; theText must have room for 2 * theSize + 1 characters.
+//
+//////////
+
+static void QTHint_FormatHex (char *theText, const UInt8 *theData, UInt32 theSize)
+{
+	static const char		kHexDigits[] = "0123456789abcdef";
+	UInt32					myIndex;
+
+	for (myIndex = 0; myIndex < theSize; myIndex++) {
+		*theText++ = kHexDigits[theData[myIndex] >> 4];
+		*theText++ = kHexDigits[theData[myIndex] & 0x0F];
+	}
+
+	*theText = '\0';
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTHint_IsHintCommandLine
+// Does the specified command line ask for hinting mode?
+//
+//////////
+
+Boolean QTHint_IsHintCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kHintSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTHint_Main
+// Run hinting mode. Returns one of the kHintExit constants.
+//
+// Usage: -hint <input movie> <output movie> [-packetsize <bytes>] [-payloadtype <type>] [-workers <count>] [-standard] [-report <file>]
+//
+//////////
+
+int QTHint_Main (int theArgc, char *theArgv[])
+{
+	QTHintSettingsRecord	mySettings;
+	QTEstimatorRecord		myEstimator;
+	const char				*myInPath = NULL;
+	const char				*myOutPath = NULL;
+	const char				*myReportPath = NULL;
+	FILE					*myReport = stdout;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	QTUInt64				myInSize = 0;
+	QTUInt64				myOutSize = 0;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	QTHint_InitSettings(&mySettings);
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kHintSwitch) == 0) && (myIndex + 2 < theArgc)) {
+			myInPath = theArgv[++myIndex];
+			myOutPath = theArgv[++myIndex];
+		} else if ((strcmp(theArgv[myIndex], kHintPacketSizeSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			mySettings.fMaxPacketSize = (UInt32)atol(theArgv[++myIndex]);
+		} else if ((strcmp(theArgv[myIndex], kHintPayloadTypeSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			mySettings.fPayloadType = (UInt8)atoi(theArgv[++myIndex]);
+		} else if ((strcmp(theArgv[myIndex], kHintWorkersSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			mySettings.fWorkerCount = atol(theArgv[++myIndex]);
+		} else if (strcmp(theArgv[myIndex], kHintStandardSwitch) == 0) {
+			mySettings.fStandardOnly = true;
+		} else if ((strcmp(theArgv[myIndex], kHintReportSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myReportPath = theArgv[++myIndex];
+		}
+	}
+
+	if ((myInPath == NULL) || (myOutPath == NULL)) {
+		fprintf(stderr, "usage: %s %s <input movie> <output movie> [%s <bytes>] [%s <type>] [%s <count>] [%s] [%s <file>]\n", theArgv[0], kHintSwitch, kHintPacketSizeSwitch, kHintPayloadTypeSwitch, kHintWorkersSwitch, kHintStandardSwitch, kHintReportSwitch);
+		return(kHintExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kHintExitUsage);
+		}
+	}
+
+	// hinting a file that's been read once is limited by the disk, so the estimator's work is the input bytes;
+	// a finished job adds its rate to the history, which the caller loads and saves
+	QTSys_GetPathSize(myInPath, &myInSize);
+	QTEst_Init(&myEstimator, kHintOperation, myInSize, myStartTime);
+	mySettings.fProgressProc = QTHint_MainProgressProc;
+	mySettings.fProgressRefCon = &myEstimator;
+
+	myErr = QTHint_HintFile(myInPath, myOutPath, &mySettings, myReport);
+	if (myErr == noErr)
+		QTSys_GetPathSize(myOutPath, &myOutSize);
+
+	QTEst_Finish(&myEstimator, QTSys_GetMicroseconds());
+
+	fputs("{\"summary\":true,\"input\":", myReport);
+	QTSys_WriteJSONString(myReport, myInPath);
+	fputs(",\"output\":", myReport);
+	QTSys_WriteJSONString(myReport, myOutPath);
+	fprintf(myReport, ",\"err\":%d,\"wallMicroseconds\":%llu,\"bytesWritten\":%llu}\n",
+						(int)myErr,
+						(unsigned long long)(QTSys_GetMicroseconds() - myStartTime),
+						(unsigned long long)myOutSize);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kHintExitSuccess : kHintExitFailed);
+}
+
+
+//////////
+//
+// QTHint_MainProgressProc
+// Keep the hinting mode's estimator up to date.
+//
+//////////
+
+static OSErr QTHint_MainProgressProc (void *theRefCon, long thePercentDone)
+{
+	QTEst_Update((QTEstimatorPtr)theRefCon, thePercentDone, QTSys_GetMicroseconds());
+	return(noErr);
+}
@@ -0,0 +1,112 @@
+//////////
+//
+//	File:		QTHinter.h
+//
+//	Contains:	A portable engine that adds RTP hint tracks to QuickTime and MPEG-4 files.
+//				All utilities start with the prefix "QTHint_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTHinter__
+#define __QTHinter__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSampleTable.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kHintSwitch							"-hint"					// command-line switch that selects hinting mode
+#define kHintPacketSizeSwitch				"-packetsize"			// maximum RTP packet size, header included
+#define kHintPayloadTypeSwitch				"-payloadtype"			// RTP payload type of the first hint track
+#define kHintWorkersSwitch					"-workers"				// number of tracks to hint at once
+#define kHintStandardSwitch					"-standard"				// fail rather than send audio or video in our generic payload format
+#define kHintReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kHintRTPHeaderSize					12						// size of an RTP header with no CSRCs
+#define kHintDefaultPacketSize				1450					// fits in an Ethernet frame, with room for IP and UDP
+#define kHintMinPacketSize					(kHintRTPHeaderSize + 16)
+#define kHintMaxPacketSize					65535
+#define kHintDefaultPayloadType				96						// the first dynamic payload type
+#define kHintMaxPayloadType					127
+#define kHintGenericEncodingName			"X-GENERIC"				// our own payload format: sample data, fragmented
+#define kHintMP4VEncodingName				"MP4V-ES"				// MPEG-4 video (RFC 3016)
+#define kHintAACEncodingName				"mpeg4-generic"			// AAC audio, in the AAC-hbr mode of RFC 3640
+#define kHintMaxConfigSize					128						// largest decoder configuration we put into SDP text
+#define kHintOperation						FOUR_CHAR_CODE('hint')	// the estimator history of hinting, whose work is input bytes
+
+// the RTP payload formats we build
+enum {
+	kHintPayloadGeneric						= 0,					// for any media; only our own clients can depacketize it
+	kHintPayloadMP4V						= 1,					// 'mp4v' sample descriptions
+	kHintPayloadAAC							= 2						// 'mp4a' sample descriptions with AAC in them
+};
+
+// exit codes returned by QTHint_Main
+enum {
+	kHintExitSuccess						= 0,
+	kHintExitFailed							= 1,
+	kHintExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTHintSettingsRecord {
+	UInt32					fMaxPacketSize;			// largest RTP packet we build, RTP header included
+	UInt8					fPayloadType;			// payload type of the first hint track; each further track gets the next one
+	long					fWorkerCount;			// number of tracks to hint at once; 0 means one per processor
+	Boolean					fStandardOnly;			// fail with unimpErr if an audio or video track has no standard payload format
+	OSErr					(*fProgressProc) (void *theRefCon, long thePercentDone);	// or NULL; see QTHint_HintFile
+	void					*fProgressRefCon;
+} QTHintSettingsRecord, *QTHintSettingsPtr;
+
+// what we did to one media track
+typedef struct QTHintTrackResultRecord {
+	UInt32					fMediaTrackID;
+	UInt32					fHintTrackID;
+	OSType					fHandlerType;
+	long					fPayloadFormat;			// one of the kHintPayload constants
+	UInt8					fPayloadType;
+	UInt32					fMediaSampleCount;
+	UInt32					fHintSampleCount;
+	QTUInt64				fPacketCount;
+	QTUInt64				fPacketBytes;			// RTP headers included
+	UInt32					fMaxPacketSize;
+	UInt32					fMaxBitRate;			// bits per second, over the busiest second
+	UInt32					fAvgBitRate;
+	QTUInt64				fWallMicroseconds;		// time the worker spent on this track
+	OSErr					fErr;
+} QTHintTrackResultRecord, *QTHintTrackResultPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+void						QTHint_InitSettings (QTHintSettingsPtr theSettings);
+OSErr						QTHint_HintFile (const char *theInPath, const char *theOutPath, QTHintSettingsPtr theSettings, FILE *theReport);
+void						QTHint_WriteTrackReport (FILE *theReport, QTHintTrackResultPtr theResult);
+
+Boolean						QTHint_IsHintCommandLine (int theArgc, char *theArgv[]);
+int							QTHint_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTHinter__
@@ -0,0 +1,845 @@
+//////////
+//
+//	File:		QTPresets.c
+//
+//	Contains:	Portable functions for compiling rendition presets (resize/transcode ladders) into exporter settings.
+//				All utilities start with the prefix "QTPre_".
+//
+//	A ladder is a set of renditions of one movie at different sizes and data rates, such as the
+//	1080/720/480/360 ladder of adaptive-bitrate streaming. QTDX_SetExportedMovieDimensions sets the size
+//	of one export: it gets the exporter's whole settings container, searches it for the size atoms
+//	(adding them if need be) and sets it again, and then the export decodes the movie. Doing that once
+//	for each rendition means N searches of the settings and, worse, N decodes of the same source.
+//
+//	So we compile a ladder instead. QTPre_CompileTemplate takes the exporter's settings once, makes sure
+//	they have the atoms a rendition changes (the video settings' height, width and data rate), and notes
+//	where the data of those atoms is. QTPre_CompileLadder then builds each rendition's settings by
+//	copying the template and storing its own values at those offsets; nothing is searched again. Each
+//	rendition gets two containers: the exporter's settings, and just the video settings, which is what
+//	the standard compression component takes. A renderer (see QTDataEx.c) then decodes each frame of
+//	the source once and hands it to every rendition, each of which compresses it on a thread of its own
+//	(QTFanout.c). A ladder can also have a sequence of thumbnails, which are fed the same frames.
+//
+//	Settings containers are QT atom containers, not the atoms of movie files: a 12-byte header and then
+//	a root atom of type 'sean', where each atom has a 20-byte header holding its size, type, ID and
+//	number of children. An atom with no children is a leaf, and its data follows its header. We read
+//	and write them here, rather than with QTFindChildByID and QTInsertChild, so that this file builds
+//	without QuickTime like the other engine files.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTPresets.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kPreMaxDimension				16384					// larger sizes in a ladder are surely mistakes
+#define kPreMaxSpecLength				512
+
+// offsets of the fields of a QT atom header
+#define kPreAtomSizeOffset				0
+#define kPreAtomTypeOffset				4
+#define kPreAtomIDOffset				8
+#define kPreAtomChildCountOffset		14
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTPre_ParseRendition (const char *theEntry, QTPreRenditionPtr theRendition);
+static long					QTPre_RoundToEven (double theValue);
+static OSErr				QTPre_FindChild (QTAtomBufferPtr theContainer, UInt32 theParent, OSType theType, UInt32 theID, UInt32 *theChild);
+static OSErr				QTPre_InsertChild (QTAtomBufferPtr theContainer, const UInt32 *theAncestors, long theDepth, OSType theType, UInt32 theID, UInt32 theDataSize, UInt32 *theChild);
+static OSErr				QTPre_FindOrInsertLeaf (QTPreTemplatePtr theTemplate, OSType theType, UInt32 theDataSize, UInt32 *theDataOffset);
+static void					QTPre_PutAtomHeader (UInt8 *theBytes, UInt32 theSize, OSType theType, UInt32 theID, UInt16 theChildCount);
+static OSErr				QTPre_RunLadder (FILE *theReport, QTPreRendererPtr theRenderer, const char *thePath, const char *theSpec, const char *theDirectory, long theThumbnailSeconds, long theRingFrames);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Ladder functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTPre_ParseLadder
+// Fill in theLadder from a preset name or a comma-separated list of renditions.
+//
+// A rendition is a height ("720" or "720p"), which keeps the source's aspect ratio, or a width and height
+// ("640x360"); either may be followed by a data rate in kilobits per second ("720p@2800k").
+//
+//////////
+
+OSErr QTPre_ParseLadder (const char *theSpec, QTPreLadderPtr theLadder)
+{
+	char			mySpec[kPreMaxSpecLength];
+	char			*myEntry;
+	char			*myComma;
+	OSErr			myErr = noErr;
+
+	memset(theLadder, 0, sizeof(QTPreLadderRecord));
+
+	if ((theSpec == NULL) || (QTSys_CompareStringsNoCase(theSpec, kPrePresetABR) == 0))
+		theSpec = kPreLadderABR;
+
+	if (QTSys_FormatString(mySpec, sizeof(mySpec), "%s", theSpec) < 0)
+		return(paramErr);
+
+	for (myEntry = mySpec; myEntry != NULL; myEntry = (myComma != NULL) ? myComma + 1 : NULL) {
+		myComma = strchr(myEntry, ',');
+		if (myComma != NULL)
+			*myComma = '\0';
+
+		if (theLadder->fRenditionCount >= kPreMaxRenditions)
+			return(paramErr);
+
+		myErr = QTPre_ParseRendition(QTSys_TrimLine(myEntry), &theLadder->fRenditions[theLadder->fRenditionCount]);
+		if (myErr != noErr)
+			return(myErr);
+
+		theLadder->fRenditionCount++;
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_ParseRendition
+// Parse one rendition of a ladder.
+//
+//////////
+
+static OSErr QTPre_ParseRendition (const char *theEntry, QTPreRenditionPtr theRendition)
+{
+	const char		*myChar = theEntry;
+	char			*myEnd;
+	long			myFirst;
+	long			mySecond = 0;
+
+	memset(theRendition, 0, sizeof(QTPreRenditionRecord));
+
+	myFirst = strtol(myChar, &myEnd, 10);
+	if (myEnd == myChar)
+		return(paramErr);
+	myChar = myEnd;
+
+	if ((*myChar == 'x') || (*myChar == 'X')) {
+		myChar++;
+		mySecond = strtol(myChar, &myEnd, 10);
+		if (myEnd == myChar)
+			return(paramErr);
+		myChar = myEnd;
+	} else if ((*myChar == 'p') || (*myChar == 'P')) {
+		myChar++;
+	}
+
+	if (*myChar == '@') {
+		myChar++;
+		theRendition->fKilobitsPerSecond = strtol(myChar, &myEnd, 10);
+		if ((myEnd == myChar) || (theRendition->fKilobitsPerSecond <= 0))
+			return(paramErr);
+		myChar = myEnd;
+		if ((*myChar == 'k') || (*myChar == 'K'))
+			myChar++;
+	}
+
+	if (*myChar != '\0')
+		return(paramErr);
+
+	if (mySecond != 0) {
+		theRendition->fRequestedWidth = myFirst;
+		theRendition->fRequestedHeight = mySecond;
+		QTSys_FormatString(theRendition->fName, sizeof(theRendition->fName), "%ldx%ld", myFirst, mySecond);
+	} else {
+		theRendition->fRequestedHeight = myFirst;
+		QTSys_FormatString(theRendition->fName, sizeof(theRendition->fName), "%ldp", myFirst);
+	}
+
+	if ((theRendition->fRequestedWidth < 0) || (theRendition->fRequestedWidth > kPreMaxDimension) ||
+		(theRendition->fRequestedHeight <= 0) || (theRendition->fRequestedHeight > kPreMaxDimension))
+		return(paramErr);
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_AddThumbnails
+// Add a rendition to a ladder that writes a still image of the source every theIntervalSeconds seconds.
+//
+//////////
+
+OSErr QTPre_AddThumbnails (QTPreLadderPtr theLadder, long theIntervalSeconds)
+{
+	QTPreRenditionPtr	myRendition;
+
+	if ((theIntervalSeconds <= 0) || (theLadder->fRenditionCount >= kPreMaxRenditions))
+		return(paramErr);
+
+	myRendition = &theLadder->fRenditions[theLadder->fRenditionCount++];
+	memset(myRendition, 0, sizeof(QTPreRenditionRecord));
+	myRendition->fKind = kPreRenditionThumbnails;
+	myRendition->fRequestedHeight = kPreThumbnailHeight;
+	myRendition->fIntervalSeconds = theIntervalSeconds;
+	QTSys_FormatString(myRendition->fName, sizeof(myRendition->fName), "%s", kPreThumbnailName);
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_PlanLadder
+// Work out the size of each rendition of a source of the specified size.
+//
+// A rendition given only a height keeps the source's aspect ratio. Sizes are rounded to even numbers,
+// which every codec we know of accepts. We don't scale up: a rendition larger than the source in either
+// direction is skipped, except that thumbnails of a small source are just as large as it is.
+//
+//////////
+
+OSErr QTPre_PlanLadder (QTPreLadderPtr theLadder, long theSourceWidth, long theSourceHeight)
+{
+	QTPreRenditionPtr	myRendition;
+	long				myIndex;
+
+	if ((theSourceWidth <= 0) || (theSourceHeight <= 0))
+		return(paramErr);
+
+	for (myIndex = 0; myIndex < theLadder->fRenditionCount; myIndex++) {
+		myRendition = &theLadder->fRenditions[myIndex];
+
+		myRendition->fHeight = QTPre_RoundToEven((double)myRendition->fRequestedHeight);
+		if (myRendition->fRequestedWidth != 0)
+			myRendition->fWidth = QTPre_RoundToEven((double)myRendition->fRequestedWidth);
+		else
+			myRendition->fWidth = QTPre_RoundToEven(((double)theSourceWidth * (double)myRendition->fRequestedHeight) / (double)theSourceHeight);
+
+		myRendition->fSkipped = ((myRendition->fWidth > theSourceWidth) || (myRendition->fHeight > theSourceHeight));
+		if (myRendition->fSkipped && (myRendition->fKind == kPreRenditionThumbnails)) {
+			myRendition->fWidth = theSourceWidth;
+			myRendition->fHeight = theSourceHeight;
+			myRendition->fSkipped = false;
+		}
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_RoundToEven
+// Round a dimension to the nearest even number, and to no less than 2.
+//
+//////////
+
+static long QTPre_RoundToEven (double theValue)
+{
+	long			myValue = 2 * (long)((theValue / 2.0) + 0.5);
+
+	return((myValue < 2) ? 2 : myValue);
+}
+
+
+//////////
+//
+// QTPre_MakeOutputPaths
+// Name the file of each rendition after the source and the rendition ("clip_720p.mov"), in theDirectory
+// or, if that is NULL, next to the source. The renderer adds a number and an extension to the name of
+// the thumbnails ("clip_thumbs" becomes "clip_thumbs_0001.jpg").
+//
+//////////
+
+OSErr QTPre_MakeOutputPaths (QTPreLadderPtr theLadder, const char *theSourcePath, const char *theDirectory)
+{
+	char				myDirectory[kQTSysMaxPath];
+	char				myFileName[kQTSysMaxPath];
+	const char			*myName = QTSys_GetFileName(theSourcePath);
+	const char			*myExtension = QTSys_GetFileExtension(myName);
+	int					myStemLength = (int)(myExtension - myName);
+	long				myIndex;
+	OSErr				myErr = noErr;
+
+	// back up over the period, if there was an extension
+	if (*myExtension != '\0')
+		myStemLength--;
+
+	if (theDirectory == NULL) {
+		if (QTSys_FormatString(myDirectory, sizeof(myDirectory), "%.*s", (int)(myName - theSourcePath), theSourcePath) < 0)
+			return(paramErr);
+		theDirectory = myDirectory;
+	}
+
+	for (myIndex = 0; myIndex < theLadder->fRenditionCount; myIndex++) {
+		QTPreRenditionPtr	myRendition = &theLadder->fRenditions[myIndex];
+
+		if (QTSys_FormatString(myFileName, sizeof(myFileName), "%.*s_%s%s", myStemLength, myName, myRendition->fName, (myRendition->fKind == kPreRenditionMovie) ? kPreRenditionExtension : "") < 0)
+			return(paramErr);
+
+		myErr = QTSys_MakePath(myRendition->fOutPath, sizeof(myRendition->fOutPath), theDirectory, myFileName);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_WriteRenditionReport
+// Write the outcome of one rendition as a single line of JSON.
+//
+//////////
+
+void QTPre_WriteRenditionReport (FILE *theReport, QTPreRenditionPtr theRendition)
+{
+	fputs("{\"rendition\":", theReport);
+	QTSys_WriteJSONString(theReport, theRendition->fName);
+	fputs(",\"output\":", theReport);
+	QTSys_WriteJSONString(theReport, theRendition->fOutPath);
+	fprintf(theReport, ",\"kind\":\"%s\",\"width\":%ld,\"height\":%ld,\"kilobitsPerSecond\":%ld,\"status\":\"%s\",\"err\":%d,\"frames\":%ld,\"bytes\":%llu,\"waitMicroseconds\":%llu,\"busyMicroseconds\":%llu}\n",
+						(theRendition->fKind == kPreRenditionMovie) ? "movie" : "thumbnails",
+						theRendition->fWidth,
+						theRendition->fHeight,
+						theRendition->fKilobitsPerSecond,
+						theRendition->fSkipped ? "skipped" : ((theRendition->fErr == noErr) ? "done" : "failed"),
+						(int)theRendition->fErr,
+						theRendition->fFrameCount,
+						(unsigned long long)theRendition->fBytesWritten,
+						(unsigned long long)theRendition->fWaitMicroseconds,
+						(unsigned long long)theRendition->fBusyMicroseconds);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Settings functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTPre_CompileTemplate
+// Prepare an exporter's settings container (as returned by MovieExportGetSettingsAsAtomContainer) for
+// QTPre_CompileLadder; if theSettings is NULL, we start from an empty container.
+//
+// We add a video settings atom, and height, width and data rate atoms inside it, if the settings don't
+// have them already. A data rate of 0 means no limit, so adding that atom doesn't change the settings.
+//
+//////////
+
+OSErr QTPre_CompileTemplate (const UInt8 *theSettings, UInt32 theSize, QTPreTemplatePtr theTemplate)
+{
+	UInt8				*myData;
+	UInt32				myRootSize;
+	UInt32				myRoot = kPreContainerHeaderSize;
+	OSErr				myErr = noErr;
+
+	memset(theTemplate, 0, sizeof(QTPreTemplateRecord));
+	QTAtom_InitBuffer(&theTemplate->fContainer);
+
+	if ((theSettings != NULL) && (theSize >= kPreContainerHeaderSize + kPreAtomHeaderSize)) {
+		QTAtom_AppendBytes(&theTemplate->fContainer, theSettings, theSize);
+	} else {
+		QTAtom_AppendZeros(&theTemplate->fContainer, kPreContainerHeaderSize + kPreAtomHeaderSize);
+		if (theTemplate->fContainer.fErr == noErr)
+			QTPre_PutAtomHeader(theTemplate->fContainer.fData + myRoot, kPreAtomHeaderSize, kPreSettingsRoot, 1, 0);
+	}
+
+	myErr = theTemplate->fContainer.fErr;
+	if (myErr != noErr)
+		goto bail;
+
+	// the root atom must fill the container; anything after it would be lost when we insert atoms
+	myData = theTemplate->fContainer.fData;
+	myRootSize = QTAtom_GetBE32(myData + myRoot + kPreAtomSizeOffset);
+	if ((QTAtom_GetBE32(myData + myRoot + kPreAtomTypeOffset) != kPreSettingsRoot) ||
+		(myRootSize < kPreAtomHeaderSize) || (myRootSize > theTemplate->fContainer.fSize - myRoot)) {
+		myErr = invalidAtomContainerErr;
+		goto bail;
+	}
+
+	theTemplate->fContainer.fSize = myRoot + myRootSize;
+
+	myErr = QTPre_FindChild(&theTemplate->fContainer, myRoot, kPreSettingsVideo, 1, &theTemplate->fVideoOffset);
+	if (myErr == invalidAtomErr)
+		myErr = QTPre_InsertChild(&theTemplate->fContainer, &myRoot, 1, kPreSettingsVideo, 1, 0, &theTemplate->fVideoOffset);
+	if (myErr != noErr)
+		goto bail;
+
+	// the video settings atom must be a parent atom, even if it has no children yet
+	myData = theTemplate->fContainer.fData;
+	if ((QTAtom_GetBE16(myData + theTemplate->fVideoOffset + kPreAtomChildCountOffset) == 0) &&
+		(QTAtom_GetBE32(myData + theTemplate->fVideoOffset + kPreAtomSizeOffset) != kPreAtomHeaderSize)) {
+		myErr = invalidAtomContainerErr;
+		goto bail;
+	}
+
+	// each insertion goes at the end of the video settings atom, after the atoms we've already found
+	myErr = QTPre_FindOrInsertLeaf(theTemplate, kPreSettingsHeight, sizeof(UInt32), &theTemplate->fHeightOffset);
+	if (myErr == noErr)
+		myErr = QTPre_FindOrInsertLeaf(theTemplate, kPreSettingsWidth, sizeof(UInt32), &theTemplate->fWidthOffset);
+	if (myErr == noErr)
+		myErr = QTPre_FindOrInsertLeaf(theTemplate, kPreSettingsDataRate, kPreDataRateSize, &theTemplate->fDataRateOffset);
+
+bail:
+	if (myErr != noErr)
+		QTPre_DisposeTemplate(theTemplate);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTPre_DisposeTemplate
+// Dispose of the memory held by a template.
+//
+//////////
+
+void QTPre_DisposeTemplate (QTPreTemplatePtr theTemplate)
+{
+	QTAtom_DisposeBuffer(&theTemplate->fContainer);
+	memset(theTemplate, 0, sizeof(QTPreTemplateRecord));
+}
+
+
+//////////
+//
+// QTPre_CompileLadder
+// Build the settings of each rendition of a planned ladder from a template.
+//
+// Heights and widths are Fixed, and the data rate (the first field of an SCDataRateSettings record)
+// is in bytes per second; like everything in an atom container, they are big-endian.
+//
+//////////
+
+OSErr QTPre_CompileLadder (QTPreLadderPtr theLadder, QTPreTemplatePtr theTemplate)
+{
+	const UInt8			*myTemplate = theTemplate->fContainer.fData;
+	UInt32				myVideoSize = QTAtom_GetBE32(myTemplate + theTemplate->fVideoOffset + kPreAtomSizeOffset);
+	UInt16				myVideoChildCount = QTAtom_GetBE16(myTemplate + theTemplate->fVideoOffset + kPreAtomChildCountOffset);
+	long				myIndex;
+
+	for (myIndex = 0; myIndex < theLadder->fRenditionCount; myIndex++) {
+		QTPreRenditionPtr	myRendition = &theLadder->fRenditions[myIndex];
+		UInt8				*mySettings;
+		UInt8				*myVideoSettings;
+
+		free(myRendition->fSettings);
+		free(myRendition->fVideoSettings);
+		myRendition->fSettings = NULL;
+		myRendition->fVideoSettings = NULL;
+
+		if (myRendition->fSkipped || (myRendition->fKind != kPreRenditionMovie))
+			continue;
+
+		mySettings = (UInt8 *)malloc(theTemplate->fContainer.fSize);
+		myVideoSettings = (UInt8 *)malloc(kPreContainerHeaderSize + myVideoSize);
+		if ((mySettings == NULL) || (myVideoSettings == NULL)) {
+			free(mySettings);
+			free(myVideoSettings);
+			return(memFullErr);
+		}
+
+		memcpy(mySettings, myTemplate, theTemplate->fContainer.fSize);
+		QTAtom_PutBE32(mySettings + theTemplate->fHeightOffset, (UInt32)myRendition->fHeight << 16);
+		QTAtom_PutBE32(mySettings + theTemplate->fWidthOffset, (UInt32)myRendition->fWidth << 16);
+		if (myRendition->fKilobitsPerSecond > 0)
+			QTAtom_PutBE32(mySettings + theTemplate->fDataRateOffset, (UInt32)myRendition->fKilobitsPerSecond * 125);
+
+		// the video settings on their own: a new root atom whose children are those of the video settings atom
+		memset(myVideoSettings, 0, kPreContainerHeaderSize);
+		QTPre_PutAtomHeader(myVideoSettings + kPreContainerHeaderSize, myVideoSize, kPreSettingsRoot, 1, myVideoChildCount);
+		memcpy(myVideoSettings + kPreContainerHeaderSize + kPreAtomHeaderSize, mySettings + theTemplate->fVideoOffset + kPreAtomHeaderSize, myVideoSize - kPreAtomHeaderSize);
+
+		myRendition->fSettings = mySettings;
+		myRendition->fSettingsSize = theTemplate->fContainer.fSize;
+		myRendition->fVideoSettings = myVideoSettings;
+		myRendition->fVideoSettingsSize = kPreContainerHeaderSize + myVideoSize;
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_DisposeLadder
+// Dispose of the compiled settings of a ladder.
+//
+//////////
+
+void QTPre_DisposeLadder (QTPreLadderPtr theLadder)
+{
+	long				myIndex;
+
+	for (myIndex = 0; myIndex < theLadder->fRenditionCount; myIndex++) {
+		free(theLadder->fRenditions[myIndex].fSettings);
+		free(theLadder->fRenditions[myIndex].fVideoSettings);
+		theLadder->fRenditions[myIndex].fSettings = NULL;
+		theLadder->fRenditions[myIndex].fVideoSettings = NULL;
+	}
+}
+
+
+//////////
+//
+// QTPre_FindChild
+// Find the child of the parent atom at offset theParent with the specified type and ID; return
+// invalidAtomErr if there is none, or invalidAtomContainerErr if the parent is damaged.
+//
+//////////
+
+static OSErr QTPre_FindChild (QTAtomBufferPtr theContainer, UInt32 theParent, OSType theType, UInt32 theID, UInt32 *theChild)
+{
+	const UInt8			*myData = theContainer->fData;
+	UInt32				myEnd = theParent + QTAtom_GetBE32(myData + theParent + kPreAtomSizeOffset);
+	UInt16				myCount = QTAtom_GetBE16(myData + theParent + kPreAtomChildCountOffset);
+	UInt32				myOffset = theParent + kPreAtomHeaderSize;
+	UInt32				mySize;
+
+	*theChild = 0;
+
+	if (myEnd > theContainer->fSize)
+		return(invalidAtomContainerErr);
+
+	for (; myCount > 0; myCount--) {
+		if (myEnd - myOffset < kPreAtomHeaderSize)
+			return(invalidAtomContainerErr);
+
+		mySize = QTAtom_GetBE32(myData + myOffset + kPreAtomSizeOffset);
+		if ((mySize < kPreAtomHeaderSize) || (mySize > myEnd - myOffset))
+			return(invalidAtomContainerErr);
+
+		if ((QTAtom_GetBE32(myData + myOffset + kPreAtomTypeOffset) == theType) &&
+			(QTAtom_GetBE32(myData + myOffset + kPreAtomIDOffset) == theID)) {
+			*theChild = myOffset;
+			return(noErr);
+		}
+
+		myOffset += mySize;
+	}
+
+	return(invalidAtomErr);
+}
+
+
+//////////
+//
+// QTPre_InsertChild
+// Insert a child atom with theDataSize bytes of zeros as the last child of the innermost of theAncestors
+// (the offsets of the root atom, its child, and so on); theChild is set to the offset of the new atom.
+//
+// Since the new atom goes after all the ancestors' headers, none of them moves; we just add its size to
+// each of them, and count it as a child of its parent.
+//
+//////////
+
+static OSErr QTPre_InsertChild (QTAtomBufferPtr theContainer, const UInt32 *theAncestors, long theDepth, OSType theType, UInt32 theID, UInt32 theDataSize, UInt32 *theChild)
+{
+	QTAtomBufferRecord	myContainer;
+	UInt32				myParent = theAncestors[theDepth - 1];
+	UInt32				myInsertion = myParent + QTAtom_GetBE32(theContainer->fData + myParent + kPreAtomSizeOffset);
+	UInt32				myAtomSize = kPreAtomHeaderSize + theDataSize;
+	UInt32				myAtom;
+	long				myIndex;
+
+	QTAtom_InitBuffer(&myContainer);
+	QTAtom_AppendBytes(&myContainer, theContainer->fData, myInsertion);
+	myAtom = myContainer.fSize;
+	QTAtom_AppendZeros(&myContainer, myAtomSize);
+	QTAtom_AppendBytes(&myContainer, theContainer->fData + myInsertion, theContainer->fSize - myInsertion);
+	if (myContainer.fErr != noErr) {
+		QTAtom_DisposeBuffer(&myContainer);
+		return(memFullErr);
+	}
+
+	QTPre_PutAtomHeader(myContainer.fData + myAtom, myAtomSize, theType, theID, 0);
+
+	for (myIndex = 0; myIndex < theDepth; myIndex++) {
+		UInt8		*myAncestor = myContainer.fData + theAncestors[myIndex];
+
+		QTAtom_PutBE32(myAncestor + kPreAtomSizeOffset, QTAtom_GetBE32(myAncestor + kPreAtomSizeOffset) + myAtomSize);
+	}
+
+	QTAtom_PutBE16(myContainer.fData + myParent + kPreAtomChildCountOffset, (UInt16)(QTAtom_GetBE16(myContainer.fData + myParent + kPreAtomChildCountOffset) + 1));
+
+	QTAtom_DisposeBuffer(theContainer);
+	*theContainer = myContainer;
+	*theChild = myAtom;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_FindOrInsertLeaf
+// Find the leaf atom with the specified type (and ID 1) in the template's video settings, adding it
+// if need be, and return the offset of its data; the atom must hold at least theDataSize bytes.
+//
+//////////
+
+static OSErr QTPre_FindOrInsertLeaf (QTPreTemplatePtr theTemplate, OSType theType, UInt32 theDataSize, UInt32 *theDataOffset)
+{
+	UInt32				myAncestors[2];
+	UInt32				myAtom = 0;
+	const UInt8			*myData;
+	OSErr				myErr = noErr;
+
+	myAncestors[0] = kPreContainerHeaderSize;
+	myAncestors[1] = theTemplate->fVideoOffset;
+
+	myErr = QTPre_FindChild(&theTemplate->fContainer, theTemplate->fVideoOffset, theType, 1, &myAtom);
+	if (myErr == invalidAtomErr)
+		myErr = QTPre_InsertChild(&theTemplate->fContainer, myAncestors, 2, theType, 1, theDataSize, &myAtom);
+	if (myErr != noErr)
+		return(myErr);
+
+	myData = theTemplate->fContainer.fData;
+	if ((QTAtom_GetBE16(myData + myAtom + kPreAtomChildCountOffset) != 0) ||
+		(QTAtom_GetBE32(myData + myAtom + kPreAtomSizeOffset) < kPreAtomHeaderSize + theDataSize))
+		return(invalidAtomContainerErr);
+
+	*theDataOffset = myAtom + kPreAtomHeaderSize;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTPre_PutAtomHeader
+// Write a QT atom header.
+//
+//////////
+
+static void QTPre_PutAtomHeader (UInt8 *theBytes, UInt32 theSize, OSType theType, UInt32 theID, UInt16 theChildCount)
+{
+	memset(theBytes, 0, kPreAtomHeaderSize);
+	QTAtom_PutBE32(theBytes + kPreAtomSizeOffset, theSize);
+	QTAtom_PutBE32(theBytes + kPreAtomTypeOffset, theType);
+	QTAtom_PutBE32(theBytes + kPreAtomIDOffset, theID);
+	QTAtom_PutBE16(theBytes + kPreAtomChildCountOffset, theChildCount);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTPre_IsLadderCommandLine
+// Does the specified command line ask for ladder mode?
+//
+//////////
+
+Boolean QTPre_IsLadderCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kPreLadderSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTPre_Main
+// Run ladder mode, using the specified renderer. Returns one of the kPreExit constants.
+//
+// Usage: -ladder <movie> [-preset <ladder>] [-thumbnails <seconds>] [-ring <frames>] [-out <directory>] [-report <file>]
+//
+// The report has one JSON line per rendition and a summary line at the end.
+//
+//////////
+
+int QTPre_Main (int theArgc, char *theArgv[], QTPreRendererPtr theRenderer)
+{
+	const char			*myPath = NULL;
+	const char			*mySpec = kPreDefaultPreset;
+	const char			*myDirectory = NULL;
+	const char			*myReportPath = NULL;
+	long				myThumbnailSeconds = 0;
+	long				myRingFrames = kFanDefaultRingFrames;
+	FILE				*myReport = stdout;
+	int					myIndex;
+	OSErr				myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kPreLadderSwitch) == 0) && (myIndex + 1 < theArgc))
+			myPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kPrePresetSwitch) == 0) && (myIndex + 1 < theArgc))
+			mySpec = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kPreOutSwitch) == 0) && (myIndex + 1 < theArgc))
+			myDirectory = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kPreReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kPreThumbnailsSwitch) == 0) && (myIndex + 1 < theArgc))
+			myThumbnailSeconds = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kPreRingSwitch) == 0) && (myIndex + 1 < theArgc))
+			myRingFrames = atol(theArgv[++myIndex]);
+	}
+
+	if ((myPath == NULL) || (theRenderer == NULL) || (myThumbnailSeconds < 0) || (myRingFrames <= 0) || (myRingFrames > kFanMaxRingFrames)) {
+		fprintf(stderr, "usage: %s %s <movie> [%s <ladder>] [%s <seconds>] [%s <frames>] [%s <directory>] [%s <file>]\n", theArgv[0], kPreLadderSwitch, kPrePresetSwitch, kPreThumbnailsSwitch, kPreRingSwitch, kPreOutSwitch, kPreReportSwitch);
+		fprintf(stderr, "       a ladder is \"%s\" or a list such as \"%s\"\n", kPrePresetABR, kPreLadderABR);
+		fprintf(stderr, "       the ring holds 1 to %d frames\n", kFanMaxRingFrames);
+		return(kPreExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kPreExitUsage);
+		}
+	}
+
+	myErr = QTPre_RunLadder(myReport, theRenderer, myPath, mySpec, myDirectory, myThumbnailSeconds, myRingFrames);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	if (myErr == paramErr)
+		return(kPreExitUsage);
+
+	return((myErr == noErr) ? kPreExitSuccess : kPreExitSomeFailed);
+}
+
+
+//////////
+//
+// QTPre_RunLadder
+// Render every rendition of a ladder from one decode of the source, and report on each.
+//
+// Returns paramErr if the ladder can't be parsed, or the first error of any rendition.
+//
+//////////
+
+static OSErr QTPre_RunLadder (FILE *theReport, QTPreRendererPtr theRenderer, const char *thePath, const char *theSpec, const char *theDirectory, long theThumbnailSeconds, long theRingFrames)
+{
+	QTPreLadderRecord	myLadder;
+	QTPreTemplateRecord	myTemplate;
+	QTPreSourceRecord	mySource;
+	Boolean				mySourceOpen = false;
+	QTUInt64			myStartTime = QTSys_GetMicroseconds();
+	QTUInt64			myCompileTime = 0;
+	QTUInt64			myRenderTime = 0;
+	long				myRenderedCount = 0;
+	long				myIndex;
+	OSErr				myErr = noErr;
+
+	memset(&myTemplate, 0, sizeof(myTemplate));
+	memset(&mySource, 0, sizeof(mySource));
+	mySource.fPath = thePath;
+
+	myErr = QTPre_ParseLadder(theSpec, &myLadder);
+	if ((myErr == noErr) && (theThumbnailSeconds > 0))
+		myErr = QTPre_AddThumbnails(&myLadder, theThumbnailSeconds);
+	if (myErr != noErr) {
+		fprintf(stderr, "cannot parse the ladder \"%s\"\n", theSpec);
+		return(paramErr);
+	}
+
+	myLadder.fRingFrames = theRingFrames;
+
+	myErr = theRenderer->fOpenSource(theRenderer->fRefCon, &mySource);
+	if (myErr != noErr)
+		goto bail;
+	mySourceOpen = true;
+
+	myErr = QTPre_PlanLadder(&myLadder, mySource.fWidth, mySource.fHeight);
+	if (myErr == noErr)
+		myErr = QTPre_MakeOutputPaths(&myLadder, thePath, theDirectory);
+	if (myErr != noErr)
+		goto bail;
+
+	for (myIndex = 0; myIndex < myLadder.fRenditionCount; myIndex++)
+		if (!myLadder.fRenditions[myIndex].fSkipped)
+			myRenderedCount++;
+
+	// a source with no video at all, or smaller than every rendition, has nothing to render
+	if (myRenderedCount == 0) {
+		myErr = invalidMovie;
+		goto bail;
+	}
+
+	// compile the settings once, for all renditions
+	myCompileTime = QTSys_GetMicroseconds();
+	myErr = QTPre_CompileTemplate(mySource.fSettings, mySource.fSettingsSize, &myTemplate);
+	if (myErr == noErr)
+		myErr = QTPre_CompileLadder(&myLadder, &myTemplate);
+	myCompileTime = QTSys_GetMicroseconds() - myCompileTime;
+	if (myErr != noErr)
+		goto bail;
+
+	myRenderTime = QTSys_GetMicroseconds();
+	myErr = theRenderer->fRender(theRenderer->fRefCon, &mySource, &myLadder);
+	myRenderTime = QTSys_GetMicroseconds() - myRenderTime;
+
+	for (myIndex = 0; myIndex < myLadder.fRenditionCount; myIndex++) {
+		QTPreRenditionPtr	myRendition = &myLadder.fRenditions[myIndex];
+
+		// a rendition that the renderer never got to fails with the renderer's error
+		if (!myRendition->fSkipped && (myRendition->fErr == noErr) && (myErr != noErr))
+			myRendition->fErr = myErr;
+
+		if ((myErr == noErr) && (myRendition->fErr != noErr))
+			myErr = myRendition->fErr;
+
+		QTPre_WriteRenditionReport(theReport, myRendition);
+	}
+
+bail:
+	fputs("{\"summary\":true,\"source\":", theReport);
+	QTSys_WriteJSONString(theReport, thePath);
+	fprintf(theReport, ",\"width\":%ld,\"height\":%ld,\"renditions\":%ld,\"rendered\":%ld,\"decodedFrames\":%ld,\"ringFrames\":%ld,\"peakQueued\":%ld,\"ringBytes\":%llu,\"decoderWaitMicroseconds\":%llu,\"err\":%d,\"compileMicroseconds\":%llu,\"renderMicroseconds\":%llu,\"wallMicroseconds\":%llu}\n",
+						mySource.fWidth,
+						mySource.fHeight,
+						myLadder.fRenditionCount,
+						myRenderedCount,
+						mySource.fFrameCount,
+						mySource.fStats.fRingFrames,
+						mySource.fStats.fPeakQueued,
+						(unsigned long long)mySource.fStats.fRingBytes,
+						(unsigned long long)mySource.fStats.fWaitMicroseconds,
+						(int)myErr,
+						(unsigned long long)myCompileTime,
+						(unsigned long long)myRenderTime,
+						(unsigned long long)(QTSys_GetMicroseconds() - myStartTime));
+	fflush(theReport);
+
+	if (mySourceOpen)
+		theRenderer->fCloseSource(theRenderer->fRefCon, &mySource);
+
+	QTPre_DisposeTemplate(&myTemplate);
+	QTPre_DisposeLadder(&myLadder);
+
+	return(myErr);
+}
@@ -0,0 +1,169 @@
+//////////
+//
+//	File:		QTPresets.h
+//
+//	Contains:	Portable functions for compiling rendition presets (resize/transcode ladders) into exporter settings.
+//				All utilities start with the prefix "QTPre_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTPresets__
+#define __QTPresets__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTAtoms.h"
+#include "QTFanout.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kPreLadderSwitch					"-ladder"				// command-line switch that selects ladder mode
+#define kPrePresetSwitch					"-preset"				// the ladder: a preset name or a list of renditions
+#define kPreOutSwitch						"-out"					// directory for the renditions (default: next to the source)
+#define kPreReportSwitch					"-report"				// write the report to a file instead of stdout
+#define kPreThumbnailsSwitch				"-thumbnails"			// also write a JPEG thumbnail every so many seconds
+#define kPreRingSwitch						"-ring"					// decoded frames a slow rendition may fall behind by
+
+#define kPreMaxRenditions					8
+#define kPreMaxNameLength					16
+#define kPreRenditionExtension				".mov"
+#define kPreThumbnailName					"thumbs"
+#define kPreThumbnailHeight					180
+#define kPreThumbnailExtension				".jpg"					// each thumbnail is <name>_thumbs_0001.jpg and so on
+
+// the preset names we know, and what they stand for; see QTPre_ParseLadder for the syntax
+#define kPrePresetABR						"abr"
+#define kPreLadderABR						"1080p@5000k,720p@2800k,480p@1400k,360p@800k"
+#define kPreDefaultPreset					kPrePresetABR
+
+// the atoms of an exporter settings container that a rendition changes; these are the values of
+// kQTSettingsVideo, movieExportHeight, movieExportWidth and scDataRateSettingsType in the QuickTime headers
+#define kPreSettingsRoot					FOUR_CHAR_CODE('sean')
+#define kPreSettingsVideo					FOUR_CHAR_CODE('vide')
+#define kPreSettingsHeight					FOUR_CHAR_CODE('hght')
+#define kPreSettingsWidth					FOUR_CHAR_CODE('wdth')
+#define kPreSettingsDataRate				FOUR_CHAR_CODE('drat')
+
+#define kPreContainerHeaderSize				12						// 10 reserved bytes and a lock count
+#define kPreAtomHeaderSize					20						// size, type, ID, reserved, child count, reserved
+#define kPreDataRateSize					16						// an SCDataRateSettings record
+
+// kinds of rendition
+enum {
+	kPreRenditionMovie						= 0,
+	kPreRenditionThumbnails					= 1						// a sequence of still images
+};
+
+// exit codes returned by QTPre_Main
+enum {
+	kPreExitSuccess							= 0,
+	kPreExitSomeFailed						= 1,
+	kPreExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// one rendition of a ladder
+typedef struct QTPreRenditionRecord {
+	long					fKind;					// one of the kPreRendition constants
+	char					fName[kPreMaxNameLength];	// "720p", "640x360" and so on
+	long					fRequestedWidth;		// 0 to follow the source's aspect ratio
+	long					fRequestedHeight;
+	long					fKilobitsPerSecond;		// 0 to keep the exporter's data rate
+	long					fWidth;					// as planned by QTPre_PlanLadder
+	long					fHeight;
+	Boolean					fSkipped;				// larger than the source; we don't scale up
+	long					fIntervalSeconds;		// between thumbnails
+
+	// set by QTPre_CompileLadder; each is a complete QT atom container
+	UInt8					*fSettings;				// the exporter's settings, with this rendition's size and data rate
+	UInt32					fSettingsSize;
+	UInt8					*fVideoSettings;		// just the video settings, as the standard compression component wants them
+	UInt32					fVideoSettingsSize;
+
+	// set by the renderer
+	char					fOutPath[kQTSysMaxPath];	// for thumbnails, without the number and extension
+	OSErr					fErr;
+	long					fFrameCount;
+	QTUInt64				fBytesWritten;
+	QTUInt64				fWaitMicroseconds;		// waiting for decoded frames
+	QTUInt64				fBusyMicroseconds;		// compressing them
+} QTPreRenditionRecord, *QTPreRenditionPtr;
+
+typedef struct QTPreLadderRecord {
+	long					fRingFrames;			// see QTFan_Run
+	long					fRenditionCount;
+	QTPreRenditionRecord	fRenditions[kPreMaxRenditions];
+} QTPreLadderRecord, *QTPreLadderPtr;
+
+// an exporter settings container, with the atoms a rendition changes added if they were missing, and
+// the offsets of their data; see QTPre_CompileTemplate
+typedef struct QTPreTemplateRecord {
+	QTAtomBufferRecord		fContainer;
+	UInt32					fVideoOffset;			// of the kPreSettingsVideo atom
+	UInt32					fHeightOffset;			// of the data of each atom
+	UInt32					fWidthOffset;
+	UInt32					fDataRateOffset;
+} QTPreTemplateRecord, *QTPreTemplatePtr;
+
+// the source of a ladder, as opened by the renderer
+typedef struct QTPreSourceRecord {
+	const char				*fPath;
+	long					fWidth;
+	long					fHeight;
+	UInt8					*fSettings;				// the exporter's default settings, or NULL; the renderer owns them
+	UInt32					fSettingsSize;
+	long					fFrameCount;			// decoded frames, set by fRender
+	QTFanStatsRecord		fStats;					// and how the renditions kept up with the decoder
+	void					*fPrivate;				// for the renderer's use
+} QTPreSourceRecord, *QTPreSourcePtr;
+
+// the renderer interface; QTDataEx.c supplies one that decodes the source once with QuickTime and
+// compresses every rendition from each decoded frame, each rendition on a thread of its own (QTFanout.c)
+typedef struct QTPreRendererRecord {
+	void					*fRefCon;
+	OSErr					(*fOpenSource) (void *theRefCon, QTPreSourcePtr theSource);
+	OSErr					(*fRender) (void *theRefCon, QTPreSourcePtr theSource, QTPreLadderPtr theLadder);
+	void					(*fCloseSource) (void *theRefCon, QTPreSourcePtr theSource);
+} QTPreRendererRecord, *QTPreRendererPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTPre_ParseLadder (const char *theSpec, QTPreLadderPtr theLadder);
+OSErr						QTPre_AddThumbnails (QTPreLadderPtr theLadder, long theIntervalSeconds);
+OSErr						QTPre_PlanLadder (QTPreLadderPtr theLadder, long theSourceWidth, long theSourceHeight);
+
+OSErr						QTPre_CompileTemplate (const UInt8 *theSettings, UInt32 theSize, QTPreTemplatePtr theTemplate);
+void						QTPre_DisposeTemplate (QTPreTemplatePtr theTemplate);
+OSErr						QTPre_CompileLadder (QTPreLadderPtr theLadder, QTPreTemplatePtr theTemplate);
+void						QTPre_DisposeLadder (QTPreLadderPtr theLadder);
+
+OSErr						QTPre_MakeOutputPaths (QTPreLadderPtr theLadder, const char *theSourcePath, const char *theDirectory);
+void						QTPre_WriteRenditionReport (FILE *theReport, QTPreRenditionPtr theRendition);
+
+Boolean						QTPre_IsLadderCommandLine (int theArgc, char *theArgv[]);
+int							QTPre_Main (int theArgc, char *theArgv[], QTPreRendererPtr theRenderer);
+
+#endif	// __QTPresets__
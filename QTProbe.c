@@ -0,0 +1,1282 @@
+//////////
+//
+//	File:		QTProbe.c
+//
+//	Contains:	Portable functions for finding out what a QuickTime or MPEG-4 file holds, without QuickTime.
+//				All utilities start with the prefix "QTProbe_".
+//
+//	QTDX_FileCanBeImportedInPlace and QTUtils_IsMovieFile ask the Component Manager what a file is, which
+//	means finding (and sometimes opening) an importer component for it. That's slow, and the Component
+//	Manager isn't there at all on our Linux tier. But for the files we care about most -- QuickTime movies
+//	and MPEG-4 files -- the answer is in the first few atoms of the file.
+//
+//	QTProbe_ProbeReader walks the top-level atoms of a file, and the movie atom's track atoms, reading
+//	only atom headers and the few fields it reports (time scales, durations, handler types, codecs and
+//	picture sizes). It never skims media data, and it never allocates memory: all of its reads go through
+//	a fixed window of kProbeWindowSize bytes on the stack, which turns the many small header reads into a
+//	few large ones. Any QTAtomReaderRecord can feed it, so the same code probes files and blocks of memory.
+//
+//	A damaged file is never an error here: it's a file of kind kProbeKindNone, or a movie with the
+//	kProbeFlagDamaged or kProbeFlagTruncated flag. QTProbe_RunFuzzer checks that that holds for a few
+//	hundred thousand mangled files, and can write its seed files out for use with other fuzzers.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTProbe.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kProbeTypeMovieFragment			FOUR_CHAR_CODE('moof')
+#define kProbeTypeMovieExtends			FOUR_CHAR_CODE('mvex')
+#define kProbeTypeCompressedMovie		FOUR_CHAR_CODE('cmov')
+#define kProbeTypePreview				FOUR_CHAR_CODE('pnot')
+#define kProbeTypeUUID					FOUR_CHAR_CODE('uuid')
+
+#define kProbeBenchmarkMediaSize		(16L * 1024L * 1024L)	// media data in the benchmark's movie; probing should never touch it
+#define kProbeFuzzMediaSize				256						// media data in the fuzzer's seed movies
+#define kProbeFuzzMaxMutations			4
+
+// flags for QTProbe_BuildSampleMovie
+enum {
+	kProbeSampleMPEG4					= 1L << 0,				// start with an 'ftyp' atom
+	kProbeSampleFastStart				= 1L << 1,				// put the movie atom before the media data
+	kProbeSampleLargeMediaData			= 1L << 2,				// give the 'mdat' atom a 64-bit size
+	kProbeSampleOpenEnded				= 1L << 3				// give the last atom the size 0 (to the end of the file)
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a window onto another reader; QTProbe_ReadWindow serves small reads from it
+typedef struct QTProbeWindowRecord {
+	QTAtomReaderPtr			fSource;
+	QTUInt64				fOffset;				// of fBytes[0] in the source
+	UInt32					fLength;				// number of valid bytes in fBytes
+	UInt32					fReadCount;				// calls to fSource->fRead
+	UInt8					fBytes[kProbeWindowSize];
+} QTProbeWindowRecord, *QTProbeWindowPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTProbe_ReadWindow (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength);
+static OSErr				QTProbe_ReadAtomData (QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, UInt32 theOffset, void *theBuffer, UInt32 theLength);
+static OSErr				QTProbe_FindChild (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, OSType theType, QTAtomHeaderPtr theChild);
+static Boolean				QTProbe_IsTopLevelType (OSType theType);
+static OSErr				QTProbe_ParseMovie (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMovie, QTProbeInfoPtr theInfo);
+static OSErr				QTProbe_ParseTrack (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrack, QTProbeTrackPtr theTrackInfo);
+static OSErr				QTProbe_ParseMedia (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMedia, QTProbeTrackPtr theTrackInfo);
+static void					QTProbe_WriteFourCharCode (FILE *theStream, OSType theCode);
+static void					QTProbe_BuildSampleMovie (QTAtomBufferPtr theBuffer, long theTrackCount, UInt32 theMediaSize, long theFlags);
+static UInt32				QTProbe_NextRandom (UInt32 *theSeed);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Probe functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTProbe_ProbeReader
+// Find out what kind of file theReader reads, and what's in it.
+//
+// We return an error only if theReader fails; a file that isn't a movie, or is damaged, yields noErr
+// and a QTProbeInfoRecord that says so.
+//
+//////////
+
+OSErr QTProbe_ProbeReader (QTAtomReaderPtr theReader, QTProbeInfoPtr theInfo)
+{
+	QTProbeWindowRecord		myWindow;
+	QTAtomReaderRecord		myReader;
+	QTAtomHeaderRecord		myAtom;
+	QTUInt64				myOffset = 0;
+	long					myAtomCount;
+	UInt8					myBytes[8];
+	OSErr					myErr = noErr;
+
+	if ((theReader == NULL) || (theInfo == NULL))
+		return(paramErr);
+
+	memset(theInfo, 0, sizeof(QTProbeInfoRecord));
+
+	// read through a window onto theReader
+	myWindow.fSource = theReader;
+	myWindow.fOffset = 0;
+	myWindow.fLength = 0;
+	myWindow.fReadCount = 0;
+
+	myReader.fRefCon = &myWindow;
+	myReader.fRead = QTProbe_ReadWindow;
+	myReader.fSize = theReader->fSize;
+
+	for (myAtomCount = 0; myOffset < myReader.fSize; myAtomCount++) {
+		if (myAtomCount == kProbeMaxTopLevelAtoms) {
+			theInfo->fFlags |= kProbeFlagTooManyAtoms;
+			break;
+		}
+
+		myErr = QTAtom_ReadHeader(&myReader, myOffset, myReader.fSize, &myAtom);
+		if ((myErr == invalidAtomErr) || (myErr == eofErr)) {
+			myErr = noErr;
+
+			// a file that doesn't start with an atom isn't ours; one that ends in a partial atom was cut short
+			if (myAtomCount > 0)
+				theInfo->fFlags |= kProbeFlagTruncated;
+			break;
+		}
+
+		if (myErr != noErr)
+			goto bail;
+
+		// the first atom tells us whether this is a QuickTime or MPEG-4 file at all
+		if (myAtomCount == 0) {
+			if (!QTProbe_IsTopLevelType(myAtom.fType))
+				break;
+
+			theInfo->fKind = kProbeKindQuickTime;
+		}
+
+		switch (myAtom.fType) {
+			case kAtomTypeFileType:
+				if ((myAtomCount == 0) && (QTProbe_ReadAtomData(&myReader, &myAtom, 0, myBytes, sizeof(myBytes)) == noErr)) {
+					theInfo->fMajorBrand = QTAtom_GetBE32(myBytes);
+					theInfo->fMinorVersion = QTAtom_GetBE32(myBytes + 4);
+					if (theInfo->fMajorBrand != kAtomBrandQuickTime)
+						theInfo->fKind = kProbeKindMPEG4;
+				}
+				break;
+
+			case kAtomTypeMovie:
+				if (theInfo->fFlags & kProbeFlagMovieAtom)
+					break;
+
+				theInfo->fFlags |= kProbeFlagMovieAtom;
+				if (!(theInfo->fFlags & kProbeFlagMovieData))
+					theInfo->fFlags |= kProbeFlagFastStart;
+
+				theInfo->fMovieOffset = myAtom.fOffset;
+				theInfo->fMovieSize = myAtom.fSize;
+
+				myErr = QTProbe_ParseMovie(&myReader, &myAtom, theInfo);
+				if ((myErr == invalidAtomErr) || (myErr == eofErr)) {
+					theInfo->fFlags |= kProbeFlagDamaged;
+					myErr = noErr;
+				}
+
+				if (myErr != noErr)
+					goto bail;
+				break;
+
+			case kAtomTypeMovieData:
+				theInfo->fFlags |= kProbeFlagMovieData;
+				break;
+
+			case kProbeTypeMovieFragment:
+				theInfo->fFlags |= kProbeFlagFragmented;
+				break;
+
+			default:
+				break;
+		}
+
+		myOffset += myAtom.fSize;
+	}
+
+bail:
+	theInfo->fReadCount = myWindow.fReadCount;
+
+	if (myErr != noErr)
+		theInfo->fKind = kProbeKindNone;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTProbe_ProbeFile
+// Find out what kind of file is at the specified path, and what's in it.
+//
+//////////
+
+OSErr QTProbe_ProbeFile (const char *thePath, QTProbeInfoPtr theInfo)
+{
+	QTAtomReaderRecord		myReader;
+	OSErr					myErr = noErr;
+
+	myErr = QTAtom_OpenFileReader(thePath, &myReader);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTProbe_ProbeReader(&myReader, theInfo);
+
+	QTAtom_CloseFileReader(&myReader);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTProbe_ProbeMemory
+// Find out what kind of file is in the specified block of memory, and what's in it.
+//
+//////////
+
+OSErr QTProbe_ProbeMemory (const void *theData, QTUInt64 theSize, QTProbeInfoPtr theInfo)
+{
+	QTAtomReaderRecord		myReader;
+
+	QTAtom_InitMemoryReader(&myReader, theData, theSize);
+	return(QTProbe_ProbeReader(&myReader, theInfo));
+}
+
+
+//////////
+//
+// QTProbe_IsMovie
+// Is the probed file a QuickTime movie or MPEG-4 file with a movie atom (and so one that QuickTime
+// can open in place, without an importer)?
+//
+//////////
+
+Boolean QTProbe_IsMovie (QTProbeInfoPtr theInfo)
+{
+	return((theInfo->fKind != kProbeKindNone) && ((theInfo->fFlags & kProbeFlagMovieAtom) != 0));
+}
+
+
+//////////
+//
+// QTProbe_ReadWindow
+// The read function of the window reader that QTProbe_ProbeReader sets up.
+//
+// Reads that fit in the window are served from it, refilling it (starting at the requested offset)
+// when they fall outside it; larger reads go straight to the underlying reader.
+//
+//////////
+
+static OSErr QTProbe_ReadWindow (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength)
+{
+	QTProbeWindowPtr		myWindow = (QTProbeWindowPtr)theRefCon;
+	QTAtomReaderPtr			mySource = myWindow->fSource;
+	UInt32					myLength;
+	OSErr					myErr = noErr;
+
+	if ((theOffset > mySource->fSize) || (theLength > mySource->fSize - theOffset))
+		return(eofErr);
+
+	if (theLength > kProbeWindowSize) {
+		myWindow->fReadCount++;
+		return(mySource->fRead(mySource->fRefCon, theOffset, theBuffer, theLength));
+	}
+
+	if ((theOffset < myWindow->fOffset) || (theLength > myWindow->fLength) || (theOffset - myWindow->fOffset > myWindow->fLength - theLength)) {
+		myLength = kProbeWindowSize;
+		if (mySource->fSize - theOffset < myLength)
+			myLength = (UInt32)(mySource->fSize - theOffset);
+
+		myWindow->fLength = 0;
+		myWindow->fReadCount++;
+
+		myErr = mySource->fRead(mySource->fRefCon, theOffset, myWindow->fBytes, myLength);
+		if (myErr != noErr)
+			return(myErr);
+
+		myWindow->fOffset = theOffset;
+		myWindow->fLength = myLength;
+	}
+
+	memcpy(theBuffer, myWindow->fBytes + (size_t)(theOffset - myWindow->fOffset), theLength);
+	return(noErr);
+}
+
+
+//////////
+//
+// QTProbe_ReadAtomData
+// Read theLength bytes at theOffset in the data of an atom (that is, after its header).
+//
+//////////
+
+static OSErr QTProbe_ReadAtomData (QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, UInt32 theOffset, void *theBuffer, UInt32 theLength)
+{
+	QTUInt64				myDataSize = theAtom->fSize - theAtom->fHeaderSize;
+
+	if ((theOffset > myDataSize) || (theLength > myDataSize - theOffset))
+		return(invalidAtomErr);
+
+	return(theReader->fRead(theReader->fRefCon, theAtom->fOffset + theAtom->fHeaderSize + theOffset, theBuffer, theLength));
+}
+
+
+//////////
+//
+// QTProbe_FindChild
+// Find the first child of theParent whose type is theType, looking at no more than kProbeMaxTrackChildren children.
+//
+// Unlike QTAtom_FindChild, a damaged child ends the search without an error, if it comes after the one we want.
+//
+//////////
+
+static OSErr QTProbe_FindChild (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, OSType theType, QTAtomHeaderPtr theChild)
+{
+	QTUInt64				myOffset = theParent->fOffset + theParent->fHeaderSize;
+	QTUInt64				myEnd = theParent->fOffset + theParent->fSize;
+	long					myCount;
+	OSErr					myErr = noErr;
+
+	for (myCount = 0; (myCount < kProbeMaxTrackChildren) && (myEnd - myOffset >= kAtomHeaderSize); myCount++) {
+		myErr = QTAtom_ReadHeader(theReader, myOffset, myEnd, theChild);
+		if (myErr != noErr)
+			return(myErr);
+
+		if (theChild->fType == theType)
+			return(noErr);
+
+		myOffset += theChild->fSize;
+	}
+
+	return(invalidAtomErr);
+}
+
+
+//////////
+//
+// QTProbe_IsTopLevelType
+// Can a QuickTime or MPEG-4 file start with an atom of the specified type?
+//
+//////////
+
+static Boolean QTProbe_IsTopLevelType (OSType theType)
+{
+	switch (theType) {
+		case kAtomTypeFileType:
+		case kAtomTypeMovie:
+		case kAtomTypeMovieData:
+		case kAtomTypeFree:
+		case kAtomTypeSkip:
+		case kAtomTypeWide:
+		case kProbeTypePreview:
+		case kProbeTypeUUID:
+			return(true);
+
+		default:
+			return(false);
+	}
+}
+
+
+//////////
+//
+// QTProbe_ParseMovie
+// Read the movie header and the tracks of a movie atom.
+//
+//////////
+
+static OSErr QTProbe_ParseMovie (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMovie, QTProbeInfoPtr theInfo)
+{
+	QTAtomHeaderRecord		myChild;
+	QTUInt64				myOffset = theMovie->fOffset + theMovie->fHeaderSize;
+	QTUInt64				myEnd = theMovie->fOffset + theMovie->fSize;
+	UInt8					myBytes[32];
+	long					myCount;
+	OSErr					myErr = noErr;
+
+	for (myCount = 0; myEnd - myOffset >= kAtomHeaderSize; myCount++) {
+		if (myCount == kProbeMaxTopLevelAtoms) {
+			theInfo->fFlags |= kProbeFlagTooManyAtoms;
+			break;
+		}
+
+		myErr = QTAtom_ReadHeader(theReader, myOffset, myEnd, &myChild);
+		if (myErr != noErr)
+			return(myErr);
+
+		switch (myChild.fType) {
+			case kAtomTypeMovieHeader:
+				// version 0 has 32-bit times and durations; version 1, 64-bit ones
+				myErr = QTProbe_ReadAtomData(theReader, &myChild, 0, myBytes, 4);
+				if (myErr != noErr)
+					return(myErr);
+
+				if (myBytes[0] == 1) {
+					myErr = QTProbe_ReadAtomData(theReader, &myChild, 4, myBytes, 28);
+					if (myErr != noErr)
+						return(myErr);
+
+					theInfo->fTimeScale = QTAtom_GetBE32(myBytes + 16);
+					theInfo->fDuration = QTAtom_GetBE64(myBytes + 20);
+				} else {
+					myErr = QTProbe_ReadAtomData(theReader, &myChild, 4, myBytes, 16);
+					if (myErr != noErr)
+						return(myErr);
+
+					theInfo->fTimeScale = QTAtom_GetBE32(myBytes + 8);
+					theInfo->fDuration = QTAtom_GetBE32(myBytes + 12);
+				}
+				break;
+
+			case kAtomTypeTrack:
+				if (theInfo->fTrackCount < kProbeMaxTracks) {
+					myErr = QTProbe_ParseTrack(theReader, &myChild, &theInfo->fTracks[theInfo->fTrackCount]);
+					if (myErr != noErr) {
+						// keep what we found out about the track before the damage
+						theInfo->fTrackCount++;
+						return(myErr);
+					}
+				}
+
+				theInfo->fTrackCount++;
+				break;
+
+			case kProbeTypeMovieExtends:
+				theInfo->fFlags |= kProbeFlagFragmented;
+				break;
+
+			case kProbeTypeCompressedMovie:
+				theInfo->fFlags |= kProbeFlagCompressed;
+				break;
+
+			default:
+				break;
+		}
+
+		myOffset += myChild.fSize;
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTProbe_ParseTrack
+// Read the track header and the media of a track atom.
+//
+//////////
+
+static OSErr QTProbe_ParseTrack (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrack, QTProbeTrackPtr theTrackInfo)
+{
+	QTAtomHeaderRecord		myChild;
+	UInt8					myBytes[96];
+	OSErr					myErr = noErr;
+
+	myErr = QTProbe_FindChild(theReader, theTrack, kAtomTypeTrackHeader, &myChild);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTProbe_ReadAtomData(theReader, &myChild, 0, myBytes, 4);
+	if (myErr != noErr)
+		return(myErr);
+
+	// the track ID follows the creation and modification times; the width and height (16.16 fixed-point
+	// numbers) end the atom
+	if (myBytes[0] == 1) {
+		myErr = QTProbe_ReadAtomData(theReader, &myChild, 0, myBytes, 96);
+		if (myErr != noErr)
+			return(myErr);
+
+		theTrackInfo->fTrackID = QTAtom_GetBE32(myBytes + 20);
+		theTrackInfo->fWidth = QTAtom_GetBE32(myBytes + 88) >> 16;
+		theTrackInfo->fHeight = QTAtom_GetBE32(myBytes + 92) >> 16;
+	} else {
+		myErr = QTProbe_ReadAtomData(theReader, &myChild, 0, myBytes, 84);
+		if (myErr != noErr)
+			return(myErr);
+
+		theTrackInfo->fTrackID = QTAtom_GetBE32(myBytes + 12);
+		theTrackInfo->fWidth = QTAtom_GetBE32(myBytes + 76) >> 16;
+		theTrackInfo->fHeight = QTAtom_GetBE32(myBytes + 80) >> 16;
+	}
+
+	myErr = QTProbe_FindChild(theReader, theTrack, kAtomTypeMedia, &myChild);
+	if (myErr != noErr)
+		return(myErr);
+
+	return(QTProbe_ParseMedia(theReader, &myChild, theTrackInfo));
+}
+
+
+//////////
+//
+// QTProbe_ParseMedia
+// Read the media header, the handler type and the first sample description of a media atom.
+//
+//////////
+
+static OSErr QTProbe_ParseMedia (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMedia, QTProbeTrackPtr theTrackInfo)
+{
+	static const OSType		myDescPath[] = {kAtomTypeMediaInfo, kAtomTypeSampleTable, kAtomTypeSampleDesc};
+	QTAtomHeaderRecord		myChild;
+	UInt8					myBytes[36];
+	UInt32					myEntrySize;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	// the media header: version 0 has 32-bit times and durations; version 1, 64-bit ones
+	myErr = QTProbe_FindChild(theReader, theMedia, kAtomTypeMediaHeader, &myChild);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTProbe_ReadAtomData(theReader, &myChild, 0, myBytes, 4);
+	if (myErr != noErr)
+		return(myErr);
+
+	if (myBytes[0] == 1) {
+		myErr = QTProbe_ReadAtomData(theReader, &myChild, 4, myBytes, 28);
+		if (myErr != noErr)
+			return(myErr);
+
+		theTrackInfo->fTimeScale = QTAtom_GetBE32(myBytes + 16);
+		theTrackInfo->fDuration = QTAtom_GetBE64(myBytes + 20);
+	} else {
+		myErr = QTProbe_ReadAtomData(theReader, &myChild, 4, myBytes, 16);
+		if (myErr != noErr)
+			return(myErr);
+
+		theTrackInfo->fTimeScale = QTAtom_GetBE32(myBytes + 8);
+		theTrackInfo->fDuration = QTAtom_GetBE32(myBytes + 12);
+	}
+
+	// the handler type (the component subtype of the media handler)
+	myErr = QTProbe_FindChild(theReader, theMedia, kAtomTypeHandler, &myChild);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTProbe_ReadAtomData(theReader, &myChild, 0, myBytes, 12);
+	if (myErr != noErr)
+		return(myErr);
+
+	theTrackInfo->fHandlerType = QTAtom_GetBE32(myBytes + 8);
+
+	// the sample descriptions; we look only at the first one
+	myChild = *theMedia;
+	for (myIndex = 0; myIndex < (long)(sizeof(myDescPath) / sizeof(OSType)); myIndex++) {
+		QTAtomHeaderRecord		myParent = myChild;
+
+		myErr = QTProbe_FindChild(theReader, &myParent, myDescPath[myIndex], &myChild);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	myErr = QTProbe_ReadAtomData(theReader, &myChild, 0, myBytes, 16);
+	if (myErr != noErr)
+		return(myErr);
+
+	theTrackInfo->fSampleDescriptionCount = QTAtom_GetBE32(myBytes + 4);
+	if (theTrackInfo->fSampleDescriptionCount == 0)
+		return(noErr);
+
+	myEntrySize = QTAtom_GetBE32(myBytes + 8);
+	theTrackInfo->fCodec = QTAtom_GetBE32(myBytes + 12);
+
+	// a sound sample description has the channel count at offset 24 and the sample rate (16.16) at offset 32
+	if ((theTrackInfo->fHandlerType == kAtomHandlerSound) && (myEntrySize >= 36)) {
+		myErr = QTProbe_ReadAtomData(theReader, &myChild, 8, myBytes, 36);
+		if (myErr != noErr)
+			return(myErr);
+
+		theTrackInfo->fChannelCount = QTAtom_GetBE16(myBytes + 24);
+		theTrackInfo->fSampleRate = QTAtom_GetBE32(myBytes + 32) >> 16;
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTProbe_WriteInfo
+// Write what we found out about a file to theStream, as one line of JSON.
+//
+//////////
+
+void QTProbe_WriteInfo (FILE *theStream, const char *thePath, OSErr theErr, QTProbeInfoPtr theInfo)
+{
+	static const char		*myKindNames[] = {"none", "quicktime", "mpeg4"};
+	long					myIndex;
+
+	fputs("{\"file\":", theStream);
+	QTSys_WriteJSONString(theStream, thePath);
+	fprintf(theStream, ",\"err\":%d", (int)theErr);
+
+	if (theErr == noErr) {
+		fprintf(theStream, ",\"kind\":\"%s\",\"movie\":%s", myKindNames[theInfo->fKind], QTProbe_IsMovie(theInfo) ? "true" : "false");
+
+		if (theInfo->fMajorBrand != 0) {
+			fputs(",\"brand\":", theStream);
+			QTProbe_WriteFourCharCode(theStream, theInfo->fMajorBrand);
+		}
+
+		fprintf(theStream, ",\"fastStart\":%s,\"fragmented\":%s,\"compressed\":%s,\"truncated\":%s,\"damaged\":%s",
+					(theInfo->fFlags & kProbeFlagFastStart) ? "true" : "false",
+					(theInfo->fFlags & kProbeFlagFragmented) ? "true" : "false",
+					(theInfo->fFlags & kProbeFlagCompressed) ? "true" : "false",
+					(theInfo->fFlags & kProbeFlagTruncated) ? "true" : "false",
+					(theInfo->fFlags & kProbeFlagDamaged) ? "true" : "false");
+		fprintf(theStream, ",\"timeScale\":%lu,\"duration\":%llu,\"trackCount\":%ld,\"tracks\":[",
+					(unsigned long)theInfo->fTimeScale,
+					(unsigned long long)theInfo->fDuration,
+					theInfo->fTrackCount);
+
+		for (myIndex = 0; (myIndex < theInfo->fTrackCount) && (myIndex < kProbeMaxTracks); myIndex++) {
+			QTProbeTrackPtr		myTrack = &theInfo->fTracks[myIndex];
+
+			fprintf(theStream, "%s{\"id\":%lu,\"handler\":", (myIndex > 0) ? "," : "", (unsigned long)myTrack->fTrackID);
+			QTProbe_WriteFourCharCode(theStream, myTrack->fHandlerType);
+			fputs(",\"codec\":", theStream);
+			QTProbe_WriteFourCharCode(theStream, myTrack->fCodec);
+			fprintf(theStream, ",\"timeScale\":%lu,\"duration\":%llu",
+						(unsigned long)myTrack->fTimeScale,
+						(unsigned long long)myTrack->fDuration);
+
+			if ((myTrack->fWidth != 0) || (myTrack->fHeight != 0))
+				fprintf(theStream, ",\"width\":%lu,\"height\":%lu", (unsigned long)myTrack->fWidth, (unsigned long)myTrack->fHeight);
+
+			if (myTrack->fChannelCount != 0)
+				fprintf(theStream, ",\"channels\":%u,\"sampleRate\":%lu", (unsigned)myTrack->fChannelCount, (unsigned long)myTrack->fSampleRate);
+
+			fputc('}', theStream);
+		}
+
+		fputc(']', theStream);
+	}
+
+	fprintf(theStream, ",\"reads\":%lu}\n", (unsigned long)theInfo->fReadCount);
+}
+
+
+//////////
+//
+// QTProbe_WriteFourCharCode
+// Write a four-character code as a JSON string; unprintable characters become '?'.
+//
+//////////
+
+static void QTProbe_WriteFourCharCode (FILE *theStream, OSType theCode)
+{
+	char					myString[5];
+	long					myIndex;
+
+	for (myIndex = 0; myIndex < 4; myIndex++) {
+		myString[myIndex] = (char)((theCode >> (24 - (8 * myIndex))) & 0xFF);
+		if ((myString[myIndex] < 0x20) || (myString[myIndex] > 0x7E))
+			myString[myIndex] = '?';
+	}
+
+	myString[4] = '\0';
+	QTSys_WriteJSONString(theStream, myString);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark and fuzzer functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTProbe_BuildSampleMovie
+// Build a small but complete movie file in theBuffer, with alternating video and sound tracks.
+//
+//////////
+
+static void QTProbe_BuildSampleMovie (QTAtomBufferPtr theBuffer, long theTrackCount, UInt32 theMediaSize, long theFlags)
+{
+	UInt32					myMovie;
+	UInt32					myAtoms[6];
+	long					myIndex;
+	Boolean					myMediaFirst = ((theFlags & kProbeSampleFastStart) == 0);
+	long					myPass;
+
+	if (theFlags & kProbeSampleMPEG4) {
+		myAtoms[0] = QTAtom_BeginAtom(theBuffer, kAtomTypeFileType);
+		QTAtom_Append32(theBuffer, FOUR_CHAR_CODE('isom'));
+		QTAtom_Append32(theBuffer, 0x00000200);
+		QTAtom_Append32(theBuffer, FOUR_CHAR_CODE('isom'));
+		QTAtom_Append32(theBuffer, FOUR_CHAR_CODE('mp41'));
+		QTAtom_EndAtom(theBuffer, myAtoms[0]);
+	} else {
+		QTAtom_Append32(theBuffer, kAtomHeaderSize);
+		QTAtom_Append32(theBuffer, kAtomTypeWide);
+	}
+
+	for (myPass = 0; myPass < 2; myPass++) {
+		if (myMediaFirst == (myPass == 0)) {
+			// the media data; an open-ended atom must be the last one in the file
+			if ((theFlags & kProbeSampleOpenEnded) && (myPass == 1)) {
+				QTAtom_Append32(theBuffer, 0);
+				QTAtom_Append32(theBuffer, kAtomTypeMovieData);
+			} else if (theFlags & kProbeSampleLargeMediaData) {
+				QTAtom_Append32(theBuffer, 1);
+				QTAtom_Append32(theBuffer, kAtomTypeMovieData);
+				QTAtom_Append64(theBuffer, (QTUInt64)theMediaSize + kAtomExtendedHeaderSize);
+			} else {
+				QTAtom_Append32(theBuffer, theMediaSize + kAtomHeaderSize);
+				QTAtom_Append32(theBuffer, kAtomTypeMovieData);
+			}
+
+			QTAtom_AppendZeros(theBuffer, theMediaSize);
+			continue;
+		}
+
+		myMovie = QTAtom_BeginAtom(theBuffer, kAtomTypeMovie);
+
+		// the movie header (version 0)
+		myAtoms[0] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMovieHeader, 0, 0);
+		QTAtom_Append32(theBuffer, 0);							// creation time
+		QTAtom_Append32(theBuffer, 0);							// modification time
+		QTAtom_Append32(theBuffer, 600);						// time scale
+		QTAtom_Append32(theBuffer, 6000);						// duration
+		QTAtom_Append32(theBuffer, 0x00010000);					// preferred rate
+		QTAtom_Append16(theBuffer, 0x0100);						// preferred volume
+		QTAtom_AppendZeros(theBuffer, 10);
+		QTAtom_AppendZeros(theBuffer, 36);						// matrix
+		QTAtom_AppendZeros(theBuffer, 24);						// preview and poster times, selection, current time
+		QTAtom_Append32(theBuffer, (UInt32)theTrackCount + 1);	// next track ID
+		QTAtom_EndAtom(theBuffer, myAtoms[0]);
+
+		for (myIndex = 0; myIndex < theTrackCount; myIndex++) {
+			Boolean				myIsVideo = ((myIndex % 2) == 0);
+
+			myAtoms[0] = QTAtom_BeginAtom(theBuffer, kAtomTypeTrack);
+
+			// the track header (version 0)
+			myAtoms[1] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTrackHeader, 0, 0x0F);
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_Append32(theBuffer, (UInt32)myIndex + 1);	// track ID
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_Append32(theBuffer, 6000);					// duration
+			QTAtom_AppendZeros(theBuffer, 8);
+			QTAtom_Append16(theBuffer, 0);						// layer
+			QTAtom_Append16(theBuffer, 0);						// alternate group
+			QTAtom_Append16(theBuffer, myIsVideo ? 0 : 0x0100);	// volume
+			QTAtom_Append16(theBuffer, 0);
+			QTAtom_AppendZeros(theBuffer, 36);					// matrix
+			QTAtom_Append32(theBuffer, myIsVideo ? (640UL << 16) : 0);
+			QTAtom_Append32(theBuffer, myIsVideo ? (480UL << 16) : 0);
+			QTAtom_EndAtom(theBuffer, myAtoms[1]);
+
+			myAtoms[1] = QTAtom_BeginAtom(theBuffer, kAtomTypeMedia);
+
+			// the media header (version 0)
+			myAtoms[2] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMediaHeader, 0, 0);
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_Append32(theBuffer, myIsVideo ? 30000 : 44100);
+			QTAtom_Append32(theBuffer, myIsVideo ? 300000 : 441000);
+			QTAtom_Append16(theBuffer, 0);						// language
+			QTAtom_Append16(theBuffer, 0);						// quality
+			QTAtom_EndAtom(theBuffer, myAtoms[2]);
+
+			myAtoms[2] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeHandler, 0, 0);
+			QTAtom_Append32(theBuffer, kAtomHandlerMedia);
+			QTAtom_Append32(theBuffer, myIsVideo ? kAtomHandlerVideo : kAtomHandlerSound);
+			QTAtom_AppendZeros(theBuffer, 12);
+			QTAtom_Append8(theBuffer, 0);						// empty name
+			QTAtom_EndAtom(theBuffer, myAtoms[2]);
+
+			myAtoms[2] = QTAtom_BeginAtom(theBuffer, kAtomTypeMediaInfo);
+			myAtoms[3] = QTAtom_BeginAtom(theBuffer, kAtomTypeSampleTable);
+
+			// one sample description
+			myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleDesc, 0, 0);
+			QTAtom_Append32(theBuffer, 1);
+			myAtoms[5] = QTAtom_BeginAtom(theBuffer, myIsVideo ? FOUR_CHAR_CODE('avc1') : FOUR_CHAR_CODE('mp4a'));
+			QTAtom_AppendZeros(theBuffer, 6);
+			QTAtom_Append16(theBuffer, 1);						// data reference index
+			if (myIsVideo) {
+				QTAtom_AppendZeros(theBuffer, 16);				// version, revision, vendor, temporal and spatial quality
+				QTAtom_Append16(theBuffer, 640);
+				QTAtom_Append16(theBuffer, 480);
+				QTAtom_Append32(theBuffer, 0x00480000);			// 72 dpi
+				QTAtom_Append32(theBuffer, 0x00480000);
+				QTAtom_Append32(theBuffer, 0);
+				QTAtom_Append16(theBuffer, 1);					// frame count
+				QTAtom_AppendZeros(theBuffer, 32);				// compressor name
+				QTAtom_Append16(theBuffer, 24);					// depth
+				QTAtom_Append16(theBuffer, 0xFFFF);				// color table ID
+			} else {
+				QTAtom_AppendZeros(theBuffer, 8);				// version, revision, vendor
+				QTAtom_Append16(theBuffer, 2);					// channels
+				QTAtom_Append16(theBuffer, 16);					// sample size
+				QTAtom_Append16(theBuffer, 0);					// compression ID
+				QTAtom_Append16(theBuffer, 0);					// packet size
+				QTAtom_Append32(theBuffer, 44100UL << 16);		// sample rate
+			}
+			QTAtom_EndAtom(theBuffer, myAtoms[5]);
+			QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+			// empty sample tables
+			myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTimeToSample, 0, 0);
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+			myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleSize, 0, 0);
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+			QTAtom_EndAtom(theBuffer, myAtoms[3]);
+			QTAtom_EndAtom(theBuffer, myAtoms[2]);
+			QTAtom_EndAtom(theBuffer, myAtoms[1]);
+			QTAtom_EndAtom(theBuffer, myAtoms[0]);
+		}
+
+		if ((theFlags & kProbeSampleOpenEnded) && (myPass == 1)) {
+			// the movie atom is the last one in the file
+			QTAtom_EndAtom(theBuffer, myMovie);
+			if (theBuffer->fErr == noErr)
+				QTAtom_PutBE32(theBuffer->fData + myMovie, 0);
+		} else {
+			QTAtom_EndAtom(theBuffer, myMovie);
+		}
+	}
+}
+
+
+//////////
+//
+// QTProbe_NextRandom
+// A small xorshift generator, so that the fuzzer mangles files the same way every time it's given the same seed.
+//
+//////////
+
+static UInt32 QTProbe_NextRandom (UInt32 *theSeed)
+{
+	UInt32					myValue = *theSeed;
+
+	myValue ^= myValue << 13;
+	myValue ^= myValue >> 17;
+	myValue ^= myValue << 5;
+
+	*theSeed = myValue;
+	return(myValue);
+}
+
+
+//////////
+//
+// QTProbe_RunBenchmark
+// Measure how fast we can probe a movie with theTrackCount tracks and 16 MB of media data, from memory
+// and (if theScratchPath isn't NULL) from a file, and write the results to theReport.
+//
+//////////
+
+OSErr QTProbe_RunBenchmark (FILE *theReport, const char *theScratchPath, long theIterations, long theTrackCount)
+{
+	static const char		*mySourceNames[] = {"memory", "file"};
+	QTAtomBufferRecord		myBuffer;
+	QTAtomReaderRecord		myReader;
+	QTProbeInfoRecord		myInfo;
+	QTSysFile				myFile = kQTSysInvalidFile;
+	Boolean					myHaveReader = false;
+	long					mySource;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theIterations <= 0)
+		theIterations = kProbeDefaultBenchmarkIterations;
+	if ((theTrackCount <= 0) || (theTrackCount > kProbeMaxTracks))
+		theTrackCount = kProbeDefaultBenchmarkTracks;
+
+	QTAtom_InitBuffer(&myBuffer);
+	QTProbe_BuildSampleMovie(&myBuffer, theTrackCount, kProbeBenchmarkMediaSize, 0);
+	myErr = myBuffer.fErr;
+	if (myErr != noErr)
+		goto bail;
+
+	if (theScratchPath != NULL) {
+		myErr = QTSys_OpenFile(theScratchPath, kQTSysOpenWrite, &myFile);
+		if (myErr != noErr)
+			goto bail;
+
+		myErr = QTSys_WriteFile(myFile, myBuffer.fData, myBuffer.fSize);
+		QTSys_CloseFile(myFile);
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	for (mySource = 0; mySource < ((theScratchPath != NULL) ? 2 : 1); mySource++) {
+		QTUInt64			myStartTime;
+		QTUInt64			myWallTime;
+		QTUInt64			myReadCount = 0;
+
+		if (mySource == 0) {
+			QTAtom_InitMemoryReader(&myReader, myBuffer.fData, myBuffer.fSize);
+		} else {
+			myErr = QTAtom_OpenFileReader(theScratchPath, &myReader);
+			if (myErr != noErr)
+				goto bail;
+
+			myHaveReader = true;
+		}
+
+		myStartTime = QTSys_GetMicroseconds();
+
+		for (myIndex = 0; myIndex < theIterations; myIndex++) {
+			myErr = QTProbe_ProbeReader(&myReader, &myInfo);
+			if (myErr != noErr)
+				goto bail;
+
+			// every probe must see the whole movie
+			if (!QTProbe_IsMovie(&myInfo) || (myInfo.fTrackCount != theTrackCount) || (myInfo.fTracks[0].fCodec != FOUR_CHAR_CODE('avc1'))) {
+				myErr = invalidAtomErr;
+				goto bail;
+			}
+
+			myReadCount += myInfo.fReadCount;
+		}
+
+		myWallTime = QTSys_GetMicroseconds() - myStartTime;
+
+		if (theReport != NULL) {
+			fprintf(theReport, "{\"benchmark\":\"probe\",\"source\":\"%s\",\"tracks\":%ld,\"fileBytes\":%lu,\"iterations\":%ld,\"wallMicroseconds\":%llu,\"microsecondsPerProbe\":%.2f,\"readsPerProbe\":%.1f}\n",
+						mySourceNames[mySource],
+						theTrackCount,
+						(unsigned long)myBuffer.fSize,
+						theIterations,
+						(unsigned long long)myWallTime,
+						(double)myWallTime / (double)theIterations,
+						(double)myReadCount / (double)theIterations);
+			fflush(theReport);
+		}
+
+		if (myHaveReader) {
+			QTAtom_CloseFileReader(&myReader);
+			myHaveReader = false;
+		}
+	}
+
+bail:
+	if (myHaveReader)
+		QTAtom_CloseFileReader(&myReader);
+
+	if (theScratchPath != NULL)
+		QTSys_DeletePath(theScratchPath);
+
+	QTAtom_DisposeBuffer(&myBuffer);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTProbe_RunFuzzer
+// Probe theIterations mangled copies of a few seed movies, and check that the prober always comes back
+// with a sensible answer (and, when run under a memory checker, that it never reads outside the file).
+//
+// If theCorpusPath isn't NULL, we first write the seed movies into that folder, as a starting corpus for
+// coverage-guided fuzzers.
+//
+//////////
+
+OSErr QTProbe_RunFuzzer (FILE *theReport, long theIterations, UInt32 theSeed, const char *theCorpusPath)
+{
+	static const long		mySeedFlags[] = {
+								0,
+								kProbeSampleFastStart,
+								kProbeSampleMPEG4 | kProbeSampleFastStart,
+								kProbeSampleMPEG4 | kProbeSampleLargeMediaData,
+								kProbeSampleOpenEnded,
+								kProbeSampleMPEG4 | kProbeSampleFastStart | kProbeSampleOpenEnded
+							};
+	static const UInt32		myInterestingValues[] = {0, 1, 7, 8, 9, 16, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF};
+	enum { kSeedCount = sizeof(mySeedFlags) / sizeof(long) };
+	QTAtomBufferRecord		mySeeds[kSeedCount];
+	QTProbeInfoRecord		myInfo;
+	long					myKindCounts[3] = {0, 0, 0};
+	long					myMovieCount = 0;
+	long					myDamagedCount = 0;
+	long					myViolationCount = 0;
+	UInt32					myRandom = (theSeed != 0) ? theSeed : 0x2545F491;
+	QTUInt64				myStartTime;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theIterations <= 0)
+		theIterations = kProbeDefaultFuzzIterations;
+
+	for (myIndex = 0; myIndex < kSeedCount; myIndex++) {
+		QTAtom_InitBuffer(&mySeeds[myIndex]);
+		QTProbe_BuildSampleMovie(&mySeeds[myIndex], 1 + (myIndex % 3), kProbeFuzzMediaSize, mySeedFlags[myIndex]);
+		if (mySeeds[myIndex].fErr != noErr)
+			myErr = mySeeds[myIndex].fErr;
+	}
+
+	if (myErr != noErr)
+		goto bail;
+
+	// every seed is a good movie
+	for (myIndex = 0; myIndex < kSeedCount; myIndex++) {
+		myErr = QTProbe_ProbeMemory(mySeeds[myIndex].fData, mySeeds[myIndex].fSize, &myInfo);
+		if ((myErr != noErr) || !QTProbe_IsMovie(&myInfo) || (myInfo.fFlags & (kProbeFlagDamaged | kProbeFlagTruncated))) {
+			myErr = (myErr != noErr) ? myErr : invalidAtomErr;
+			goto bail;
+		}
+	}
+
+	if (theCorpusPath != NULL) {
+		for (myIndex = 0; myIndex < kSeedCount; myIndex++) {
+			char				myFileName[32];
+			char				myPath[kQTSysMaxPath];
+			QTSysFile			myFile;
+
+			QTSys_FormatString(myFileName, sizeof(myFileName), "seed-%ld.%s", myIndex, (mySeedFlags[myIndex] & kProbeSampleMPEG4) ? "mp4" : "mov");
+			myErr = QTSys_MakePath(myPath, sizeof(myPath), theCorpusPath, myFileName);
+			if (myErr == noErr)
+				myErr = QTSys_OpenFile(myPath, kQTSysOpenWrite, &myFile);
+			if (myErr != noErr)
+				goto bail;
+
+			myErr = QTSys_WriteFile(myFile, mySeeds[myIndex].fData, mySeeds[myIndex].fSize);
+			QTSys_CloseFile(myFile);
+			if (myErr != noErr)
+				goto bail;
+		}
+	}
+
+	myStartTime = QTSys_GetMicroseconds();
+
+	for (myIndex = 0; myIndex < theIterations; myIndex++) {
+		QTAtomBufferPtr		mySeed = &mySeeds[QTProbe_NextRandom(&myRandom) % kSeedCount];
+		UInt32				mySize = mySeed->fSize;
+		UInt32				myMutationCount = 1 + (QTProbe_NextRandom(&myRandom) % kProbeFuzzMaxMutations);
+		UInt32				myMutation;
+		UInt8				*myData;
+
+		// a block of exactly the file's size, so that a memory checker catches any read past its end
+		myData = (UInt8 *)malloc(mySize);
+		if (myData == NULL) {
+			myErr = memFullErr;
+			goto bail;
+		}
+
+		memcpy(myData, mySeed->fData, mySize);
+
+		for (myMutation = 0; (myMutation < myMutationCount) && (mySize > 0); myMutation++) {
+			UInt32			myOffset = QTProbe_NextRandom(&myRandom) % mySize;
+
+			switch (QTProbe_NextRandom(&myRandom) % 4) {
+				case 0:
+					// flip a bit
+					myData[myOffset] ^= (UInt8)(1 << (QTProbe_NextRandom(&myRandom) % 8));
+					break;
+
+				case 1:
+					// replace a byte
+					myData[myOffset] = (UInt8)QTProbe_NextRandom(&myRandom);
+					break;
+
+				case 2:
+					// replace four bytes (most likely part of an atom header) with a troublesome number
+					if (mySize - myOffset >= 4)
+						QTAtom_PutBE32(myData + myOffset, myInterestingValues[QTProbe_NextRandom(&myRandom) % (sizeof(myInterestingValues) / sizeof(UInt32))]);
+					break;
+
+				default:
+					// cut the file short
+					mySize = myOffset;
+					break;
+			}
+		}
+
+		myErr = QTProbe_ProbeMemory(myData, mySize, &myInfo);
+		free(myData);
+
+		// nothing in a file can make the prober fail, or claim more than it could have found
+		if ((myErr != noErr) ||
+			(myInfo.fKind < kProbeKindNone) || (myInfo.fKind > kProbeKindMPEG4) ||
+			((myInfo.fKind == kProbeKindNone) && (myInfo.fFlags != 0)) ||
+			(myInfo.fTrackCount < 0) ||
+			(myInfo.fMovieOffset + myInfo.fMovieSize > mySize)) {
+			myViolationCount++;
+			myErr = noErr;
+			continue;
+		}
+
+		myKindCounts[myInfo.fKind]++;
+		if (QTProbe_IsMovie(&myInfo))
+			myMovieCount++;
+		if (myInfo.fFlags & (kProbeFlagDamaged | kProbeFlagTruncated))
+			myDamagedCount++;
+	}
+
+	if (theReport != NULL) {
+		fprintf(theReport, "{\"fuzz\":\"probe\",\"seed\":%lu,\"iterations\":%ld,\"none\":%ld,\"quicktime\":%ld,\"mpeg4\":%ld,\"movies\":%ld,\"damaged\":%ld,\"violations\":%ld,\"wallMicroseconds\":%llu}\n",
+					(unsigned long)((theSeed != 0) ? theSeed : 0x2545F491),
+					theIterations,
+					myKindCounts[kProbeKindNone],
+					myKindCounts[kProbeKindQuickTime],
+					myKindCounts[kProbeKindMPEG4],
+					myMovieCount,
+					myDamagedCount,
+					myViolationCount,
+					(unsigned long long)(QTSys_GetMicroseconds() - myStartTime));
+		fflush(theReport);
+	}
+
+	if (myViolationCount > 0)
+		myErr = paramErr;
+
+bail:
+	for (myIndex = 0; myIndex < kSeedCount; myIndex++)
+		QTAtom_DisposeBuffer(&mySeeds[myIndex]);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTProbe_IsProbeCommandLine
+// Does the command line ask us to probe files, or to run the probe benchmark or fuzzer?
+//
+//////////
+
+Boolean QTProbe_IsProbeCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if ((strcmp(theArgv[myIndex], kProbeSwitch) == 0) || (strcmp(theArgv[myIndex], kProbeBenchmarkSwitch) == 0) || (strcmp(theArgv[myIndex], kProbeFuzzSwitch) == 0))
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTProbe_Main
+// Probe files, or run the probe benchmark or fuzzer. Returns one of the kProbeExit constants.
+//
+// Usage: -probe <file> ... [-report <file>]
+//        -probebench [<scratch file>] [-iterations <count>] [-tracks <count>] [-report <file>]
+//        -probefuzz [-iterations <count>] [-seed <number>] [-corpus <folder>] [-report <file>]
+//
+// When probing files, we write one line of JSON per file, and fail only if a file can't be read.
+//
+//////////
+
+int QTProbe_Main (int theArgc, char *theArgv[])
+{
+	const char			*myMode = NULL;
+	const char			*myReportPath = NULL;
+	const char			*myScratchPath = NULL;
+	const char			*myCorpusPath = NULL;
+	long				myIterations = 0;
+	long				myTrackCount = 0;
+	UInt32				mySeed = 0;
+	long				myFileCount = 0;
+	long				myFailedCount = 0;
+	FILE				*myReport = stdout;
+	QTProbeInfoRecord	myInfo;
+	int					myIndex;
+	OSErr				myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kProbeSwitch) == 0) || (strcmp(theArgv[myIndex], kProbeBenchmarkSwitch) == 0) || (strcmp(theArgv[myIndex], kProbeFuzzSwitch) == 0)) {
+			if (myMode == NULL)
+				myMode = theArgv[myIndex];
+		} else if ((strcmp(theArgv[myIndex], kProbeIterationsSwitch) == 0) && (myIndex + 1 < theArgc))
+			myIterations = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kProbeTracksSwitch) == 0) && (myIndex + 1 < theArgc))
+			myTrackCount = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kProbeSeedSwitch) == 0) && (myIndex + 1 < theArgc))
+			mySeed = (UInt32)strtoul(theArgv[++myIndex], NULL, 0);
+		else if ((strcmp(theArgv[myIndex], kProbeCorpusSwitch) == 0) && (myIndex + 1 < theArgc))
+			myCorpusPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kProbeReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+		else if ((myMode != NULL) && (theArgv[myIndex][0] != '-')) {
+			if (strcmp(myMode, kProbeBenchmarkSwitch) == 0)
+				myScratchPath = theArgv[myIndex];
+			myFileCount++;
+		}
+	}
+
+	if ((myMode == NULL) || ((strcmp(myMode, kProbeSwitch) == 0) && (myFileCount == 0)) || (myIterations < 0) || (myTrackCount < 0)) {
+		fprintf(stderr, "usage: %s %s <file> ... [%s <file>]\n", theArgv[0], kProbeSwitch, kProbeReportSwitch);
+		fprintf(stderr, "       %s %s [<scratch file>] [%s <count>] [%s <count>] [%s <file>]\n", theArgv[0], kProbeBenchmarkSwitch, kProbeIterationsSwitch, kProbeTracksSwitch, kProbeReportSwitch);
+		fprintf(stderr, "       %s %s [%s <count>] [%s <number>] [%s <folder>] [%s <file>]\n", theArgv[0], kProbeFuzzSwitch, kProbeIterationsSwitch, kProbeSeedSwitch, kProbeCorpusSwitch, kProbeReportSwitch);
+		return(kProbeExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kProbeExitUsage);
+		}
+	}
+
+	if (strcmp(myMode, kProbeBenchmarkSwitch) == 0) {
+		myErr = QTProbe_RunBenchmark(myReport, myScratchPath, myIterations, myTrackCount);
+		if (myErr != noErr)
+			fprintf(stderr, "probe benchmark failed (error %d)\n", (int)myErr);
+	} else if (strcmp(myMode, kProbeFuzzSwitch) == 0) {
+		myErr = QTProbe_RunFuzzer(myReport, myIterations, mySeed, myCorpusPath);
+		if (myErr != noErr)
+			fprintf(stderr, "probe fuzzer failed (error %d)\n", (int)myErr);
+	} else {
+		// the files are the arguments after -probe that aren't switches or switch values
+		for (myIndex = 1; myIndex < theArgc; myIndex++) {
+			if ((strcmp(theArgv[myIndex], kProbeReportSwitch) == 0) || (strcmp(theArgv[myIndex], kProbeIterationsSwitch) == 0) ||
+				(strcmp(theArgv[myIndex], kProbeTracksSwitch) == 0) || (strcmp(theArgv[myIndex], kProbeSeedSwitch) == 0) ||
+				(strcmp(theArgv[myIndex], kProbeCorpusSwitch) == 0)) {
+				myIndex++;
+				continue;
+			}
+
+			if (theArgv[myIndex][0] == '-')
+				continue;
+
+			myErr = QTProbe_ProbeFile(theArgv[myIndex], &myInfo);
+			if (myErr != noErr) {
+				memset(&myInfo, 0, sizeof(myInfo));
+				myFailedCount++;
+			}
+
+			QTProbe_WriteInfo(myReport, theArgv[myIndex], myErr, &myInfo);
+		}
+
+		fflush(myReport);
+		myErr = (myFailedCount > 0) ? ioErr : noErr;
+	}
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kProbeExitSuccess : kProbeExitFailed);
+}
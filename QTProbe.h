@@ -0,0 +1,130 @@
+//////////
+//
+//	File:		QTProbe.h
+//
+//	Contains:	Portable functions for finding out what a QuickTime or MPEG-4 file holds, without QuickTime.
+//				All utilities start with the prefix "QTProbe_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTProbe__
+#define __QTProbe__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTAtoms.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kProbeSwitch						"-probe"				// command-line switch that probes the files that follow it
+#define kProbeBenchmarkSwitch				"-probebench"			// command-line switch that selects the probe benchmark
+#define kProbeFuzzSwitch					"-probefuzz"			// command-line switch that selects the probe fuzzer
+#define kProbeIterationsSwitch				"-iterations"			// number of probes (benchmark) or mutated files (fuzzer)
+#define kProbeTracksSwitch					"-tracks"				// number of tracks in the synthetic movie
+#define kProbeSeedSwitch					"-seed"					// first value of the fuzzer's random number generator
+#define kProbeCorpusSwitch					"-corpus"				// folder to write the fuzzer's seed files into
+#define kProbeReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kProbeMaxTracks						16						// tracks described in a QTProbeInfoRecord
+#define kProbeMaxTopLevelAtoms				256						// we give up on files with more top-level atoms than this
+#define kProbeMaxTrackChildren				64						// or with more children than this in any atom we search
+#define kProbeWindowSize					4096					// bytes read from the underlying reader at once
+
+#define kProbeDefaultBenchmarkIterations	20000
+#define kProbeDefaultBenchmarkTracks		4
+#define kProbeDefaultFuzzIterations			100000
+
+// the kinds of file
+enum {
+	kProbeKindNone							= 0,					// not a QuickTime or MPEG-4 file
+	kProbeKindQuickTime						= 1,					// no 'ftyp' atom, or the 'qt  ' major brand
+	kProbeKindMPEG4							= 2						// an 'ftyp' atom with some other major brand
+};
+
+// flags in QTProbeInfoRecord.fFlags
+enum {
+	kProbeFlagMovieAtom						= 1L << 0,				// the file has a 'moov' atom
+	kProbeFlagMovieData						= 1L << 1,				// the file has an 'mdat' atom
+	kProbeFlagFastStart						= 1L << 2,				// the 'moov' atom comes before the first 'mdat' atom
+	kProbeFlagFragmented					= 1L << 3,				// the file has movie fragments ('mvex' or 'moof' atoms)
+	kProbeFlagCompressed					= 1L << 4,				// the movie atom is compressed ('cmov'); we can't see its tracks
+	kProbeFlagTruncated						= 1L << 5,				// the last top-level atom runs past the end of the file
+	kProbeFlagTooManyAtoms					= 1L << 6,				// we stopped looking before the end of the file
+	kProbeFlagDamaged						= 1L << 7				// some atom inside the movie atom is damaged
+};
+
+// exit codes returned by QTProbe_Main
+enum {
+	kProbeExitSuccess						= 0,
+	kProbeExitFailed						= 1,
+	kProbeExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// what we found out about one track
+typedef struct QTProbeTrackRecord {
+	UInt32					fTrackID;
+	OSType					fHandlerType;			// 'vide', 'soun', and so forth
+	OSType					fCodec;					// the data format of the first sample description, or 0
+	UInt32					fSampleDescriptionCount;
+	UInt32					fTimeScale;				// of the media
+	QTUInt64				fDuration;				// of the media, in its time scale
+	UInt32					fWidth;					// from the track header, in pixels
+	UInt32					fHeight;
+	UInt16					fChannelCount;			// for sound tracks
+	UInt32					fSampleRate;			// for sound tracks, in samples per second
+} QTProbeTrackRecord, *QTProbeTrackPtr;
+
+// what we found out about a file
+typedef struct QTProbeInfoRecord {
+	long					fKind;					// one of the kProbeKind constants
+	long					fFlags;					// kProbeFlag constants
+	OSType					fMajorBrand;			// from the 'ftyp' atom, or 0
+	UInt32					fMinorVersion;
+	QTUInt64				fMovieOffset;			// of the 'moov' atom
+	QTUInt64				fMovieSize;
+	UInt32					fTimeScale;				// of the movie
+	QTUInt64				fDuration;				// of the movie, in its time scale
+	long					fTrackCount;			// every track in the movie; only the first kProbeMaxTracks are in fTracks
+	QTProbeTrackRecord		fTracks[kProbeMaxTracks];
+	UInt32					fReadCount;				// calls to the underlying reader
+} QTProbeInfoRecord, *QTProbeInfoPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTProbe_ProbeReader (QTAtomReaderPtr theReader, QTProbeInfoPtr theInfo);
+OSErr						QTProbe_ProbeFile (const char *thePath, QTProbeInfoPtr theInfo);
+OSErr						QTProbe_ProbeMemory (const void *theData, QTUInt64 theSize, QTProbeInfoPtr theInfo);
+Boolean						QTProbe_IsMovie (QTProbeInfoPtr theInfo);
+void						QTProbe_WriteInfo (FILE *theStream, const char *thePath, OSErr theErr, QTProbeInfoPtr theInfo);
+
+OSErr						QTProbe_RunBenchmark (FILE *theReport, const char *theScratchPath, long theIterations, long theTrackCount);
+OSErr						QTProbe_RunFuzzer (FILE *theReport, long theIterations, UInt32 theSeed, const char *theCorpusPath);
+
+Boolean						QTProbe_IsProbeCommandLine (int theArgc, char *theArgv[]);
+int							QTProbe_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTProbe__
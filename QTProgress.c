@@ -0,0 +1,616 @@
+//////////
+//
+//	File:		QTProgress.c
+//
+//	Contains:	Portable functions for passing progress from a long operation to whoever displays it.
+//				All utilities start with the prefix "QTProg_".
+//
+//	QuickTime calls a movie progress procedure on the thread that is doing the work, as often as it
+//	likes; an export can report progress for every frame. If the progress procedure polls for events
+//	and redraws its dialog box every time, as QTDX_MovieProgressProc used to, the export spends a good
+//	part of its time drawing. So we split progress into a producer and its consumers. The producer
+//	(the progress procedure) just publishes the percentage done and a byte count in a QTProgressRecord,
+//	which costs two atomic increments and never blocks. Consumers read consistent snapshots of the
+//	record whenever they like; QTProg_ShouldRender lets them agree, without a lock, that only one of
+//	them renders in each interval. A consumer can be the producer itself (as in QTDX_MovieProgressProc,
+//	which must draw on the main thread) or a logger thread started by QTProg_StartLogger.
+//
+//	The record is a sequence lock: the producer makes fSequence odd, updates the fields and makes it
+//	even again, and a reader that sees fSequence odd or changed while it was reading simply reads again.
+//	That keeps the 64-bit byte count consistent on 32-bit processors, where it can't be read atomically.
+//	There must be only one producer for each record.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTProgress.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kProgLoggerSliceMilliseconds	10						// how often a logger thread checks whether it should stop
+#define kProgBenchmarkScratchSize		(256L * 1024L)			// the synthetic export's working set
+#define kProgBenchmarkRuns				3						// we report the fastest of this many runs of each kind
+#define kProgBenchmarkFrameBytes		(64L * 1024L)			// bytes "written" for each frame
+
+
+//////////
+//
+// data types
+//
+//////////
+
+struct QTProgLoggerRecord {
+	QTProgressPtr			fProgress;
+	FILE					*fStream;				// may be NULL, in which case we count lines but write nothing
+	char					*fName;
+	QTSysThread				fThread;
+	volatile long			fStopRequested;
+	long					fLineCount;
+	long					fLastUpdateCount;
+};
+
+// how a benchmark run reports progress
+enum {
+	kProgModeNone							= 0,	// it doesn't
+	kProgModeDirect							= 1,	// it renders on every callback
+	kProgModeThrottled						= 2,	// it publishes on every callback and renders at most once per interval
+	kProgModeLogged							= 3		// it publishes on every callback; a logger thread consumes
+};
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTProg_LoggerThread (void *theRefCon);
+static void					QTProg_LogSnapshot (QTProgLoggerPtr theLogger);
+static OSErr				QTProg_TimeExport (long theFrameCount, long theCallbackInterval, long theMode, UInt32 theRenderMicroseconds, UInt32 *theScratch, QTUInt64 *theWallTime, long *theRenderCount);
+static OSErr				QTProg_RunExport (long theFrameCount, long theCallbackInterval, long theMode, UInt32 theRenderMicroseconds, UInt32 *theScratch, QTUInt64 *theWallTime, long *theRenderCount);
+static void					QTProg_Render (QTProgressPtr theProgress, UInt32 theRenderMicroseconds);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Progress functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTProg_Init
+// Prepare a progress record for a new operation; consumers will render no more than once every
+// theIntervalMilliseconds.
+//
+//////////
+
+void QTProg_Init (QTProgressPtr theProgress, long theIntervalMilliseconds)
+{
+	memset(theProgress, 0, sizeof(QTProgressRecord));
+
+	theProgress->fIntervalMilliseconds = (theIntervalMilliseconds > 0) ? theIntervalMilliseconds : kProgDefaultIntervalMilliseconds;
+	theProgress->fStartTime = QTSys_GetMicroseconds();
+}
+
+
+//////////
+//
+// QTProg_Publish
+// Record how far the operation has got. Only the operation's own thread may call this.
+//
+//////////
+
+void QTProg_Publish (QTProgressPtr theProgress, long thePercentDone, QTUInt64 theBytesDone)
+{
+	if (thePercentDone < 0)
+		thePercentDone = 0;
+	if (thePercentDone > kProgDone)
+		thePercentDone = kProgDone;
+
+	QTSys_AtomicAdd(&theProgress->fSequence, 1);
+
+	theProgress->fPercentDone = thePercentDone;
+	theProgress->fBytesDone = theBytesDone;
+	theProgress->fUpdateCount++;
+
+	QTSys_AtomicAdd(&theProgress->fSequence, 1);
+}
+
+
+//////////
+//
+// QTProg_ShouldRender
+// Is it time for a consumer to render the progress? We return true at most once per interval,
+// to whichever consumer asks first, and once more when the operation reaches 100%.
+//
+//////////
+
+Boolean QTProg_ShouldRender (QTProgressPtr theProgress)
+{
+	long			myNow = (long)((QTSys_GetMicroseconds() - theProgress->fStartTime) / 1000);
+	long			myNext;
+
+	if (QTSys_AtomicLoad(&theProgress->fPercentDone) == kProgDone)
+		return(QTSys_AtomicCompareAndSwap(&theProgress->fFinalRendered, 0, 1));
+
+	myNext = QTSys_AtomicLoad(&theProgress->fNextRenderTime);
+	if (myNow < myNext)
+		return(false);
+
+	return(QTSys_AtomicCompareAndSwap(&theProgress->fNextRenderTime, myNext, myNow + theProgress->fIntervalMilliseconds));
+}
+
+
+//////////
+//
+// QTProg_GetSnapshot
+// Copy the progress record, consistently, into theSnapshot. Any thread may call this.
+//
+//////////
+
+void QTProg_GetSnapshot (QTProgressPtr theProgress, QTProgressSnapshotPtr theSnapshot)
+{
+	long			mySequence;
+
+	do {
+		// wait out a publish that's under way
+		mySequence = QTSys_AtomicLoad(&theProgress->fSequence);
+		if (mySequence & 1)
+			continue;
+
+		theSnapshot->fPercentDone = theProgress->fPercentDone;
+		theSnapshot->fBytesDone = theProgress->fBytesDone;
+		theSnapshot->fUpdateCount = theProgress->fUpdateCount;
+	} while ((mySequence & 1) || (QTSys_AtomicLoad(&theProgress->fSequence) != mySequence));
+
+	theSnapshot->fElapsedMicroseconds = QTSys_GetMicroseconds() - theProgress->fStartTime;
+}
+
+
+//////////
+//
+// QTProg_WriteSnapshot
+// Write a progress snapshot to theStream, as one line of JSON.
+//
+//////////
+
+void QTProg_WriteSnapshot (FILE *theStream, const char *theName, QTProgressSnapshotPtr theSnapshot)
+{
+	fputs("{\"progress\":", theStream);
+	QTSys_WriteJSONString(theStream, (theName != NULL) ? theName : "");
+	fprintf(theStream, ",\"percent\":%.2f,\"bytes\":%llu,\"updates\":%ld,\"elapsedMicroseconds\":%llu}\n",
+				100.0 * (double)theSnapshot->fPercentDone / (double)kProgDone,
+				(unsigned long long)theSnapshot->fBytesDone,
+				theSnapshot->fUpdateCount,
+				(unsigned long long)theSnapshot->fElapsedMicroseconds);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Logger functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTProg_StartLogger
+// Start a thread that writes a line of JSON to theStream once per interval, whenever the progress
+// has changed.
+//
+//////////
+
+OSErr QTProg_StartLogger (QTProgressPtr theProgress, FILE *theStream, const char *theName, QTProgLoggerPtr *theLogger)
+{
+	QTProgLoggerPtr		myLogger = NULL;
+	OSErr				myErr = noErr;
+
+	*theLogger = NULL;
+
+	myLogger = (QTProgLoggerPtr)calloc(1, sizeof(struct QTProgLoggerRecord));
+	if (myLogger == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myLogger->fProgress = theProgress;
+	myLogger->fStream = theStream;
+	myLogger->fName = QTSys_CopyString((theName != NULL) ? theName : "");
+	if (myLogger->fName == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = QTSys_NewThread(QTProg_LoggerThread, myLogger, &myLogger->fThread);
+	if (myErr != noErr)
+		goto bail;
+
+	*theLogger = myLogger;
+	myLogger = NULL;
+
+bail:
+	if (myLogger != NULL) {
+		free(myLogger->fName);
+		free(myLogger);
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTProg_StopLogger
+// Stop a logger thread, after it has logged the final progress, and dispose of it.
+// Returns the number of lines it logged.
+//
+//////////
+
+long QTProg_StopLogger (QTProgLoggerPtr theLogger)
+{
+	long			myLineCount;
+
+	if (theLogger == NULL)
+		return(0);
+
+	QTSys_AtomicStore(&theLogger->fStopRequested, 1);
+	QTSys_JoinThread(theLogger->fThread);
+
+	myLineCount = theLogger->fLineCount;
+
+	free(theLogger->fName);
+	free(theLogger);
+
+	return(myLineCount);
+}
+
+
+//////////
+//
+// QTProg_LoggerThread
+// The entry point of a logger thread.
+//
+//////////
+
+static void QTProg_LoggerThread (void *theRefCon)
+{
+	QTProgLoggerPtr		myLogger = (QTProgLoggerPtr)theRefCon;
+	long				myWaited = 0;
+
+	while (!QTSys_AtomicLoad(&myLogger->fStopRequested)) {
+		QTSys_Sleep(kProgLoggerSliceMilliseconds);
+
+		myWaited += kProgLoggerSliceMilliseconds;
+		if (myWaited < myLogger->fProgress->fIntervalMilliseconds)
+			continue;
+
+		QTProg_LogSnapshot(myLogger);
+		myWaited = 0;
+	}
+
+	QTProg_LogSnapshot(myLogger);
+}
+
+
+//////////
+//
+// QTProg_LogSnapshot
+// Log the current progress, unless it hasn't changed since we last logged it.
+//
+//////////
+
+static void QTProg_LogSnapshot (QTProgLoggerPtr theLogger)
+{
+	QTProgressSnapshotRecord	mySnapshot;
+
+	QTProg_GetSnapshot(theLogger->fProgress, &mySnapshot);
+	if (mySnapshot.fUpdateCount == theLogger->fLastUpdateCount)
+		return;
+
+	if (theLogger->fStream != NULL) {
+		QTProg_WriteSnapshot(theLogger->fStream, theLogger->fName, &mySnapshot);
+		fflush(theLogger->fStream);
+	}
+
+	theLogger->fLastUpdateCount = mySnapshot.fUpdateCount;
+	theLogger->fLineCount++;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTProg_RunBenchmark
+// Measure how much of a synthetic export's time goes to reporting its progress, and write a report
+// to theReport.
+//
+// The export does a fixed amount of work per frame and calls its progress procedure every 1, 10 or
+// 100 frames. The progress procedure either renders every time (as QTDX_MovieProgressProc used to),
+// renders at most once per interval, or only publishes while a logger thread consumes. Rendering is
+// simulated by keeping the processor busy for theRenderMicroseconds, which stands in for the event
+// polling and drawing that the progress dialog box does.
+//
+//////////
+
+OSErr QTProg_RunBenchmark (FILE *theReport, long theFrameCount, UInt32 theRenderMicroseconds)
+{
+	static const char		*myModeNames[] = {"none", "direct", "throttled", "logged"};
+	static const long		myCallbackIntervals[] = {1, 10, 100};
+	UInt32					*myScratch = NULL;
+	QTUInt64				myBaseTime;
+	QTUInt64				myWallTime;
+	long					myRenderCount;
+	long					myInterval;
+	long					myMode;
+	OSErr					myErr = noErr;
+
+	if (theFrameCount <= 0)
+		theFrameCount = kProgDefaultBenchmarkFrames;
+
+	myScratch = (UInt32 *)calloc(kProgBenchmarkScratchSize / sizeof(UInt32), sizeof(UInt32));
+	if (myScratch == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	// the export with no progress at all
+	myErr = QTProg_TimeExport(theFrameCount, 1, kProgModeNone, theRenderMicroseconds, myScratch, &myBaseTime, &myRenderCount);
+	if (myErr != noErr)
+		goto bail;
+
+	if (myBaseTime == 0)
+		myBaseTime = 1;
+
+	if (theReport != NULL) {
+		fprintf(theReport, "{\"benchmark\":\"progress\",\"mode\":\"none\",\"frames\":%ld,\"wallMicroseconds\":%llu}\n",
+					theFrameCount,
+					(unsigned long long)myBaseTime);
+		fflush(theReport);
+	}
+
+	for (myInterval = 0; myInterval < (long)(sizeof(myCallbackIntervals) / sizeof(myCallbackIntervals[0])); myInterval++) {
+		for (myMode = kProgModeDirect; myMode <= kProgModeLogged; myMode++) {
+			myErr = QTProg_TimeExport(theFrameCount, myCallbackIntervals[myInterval], myMode, theRenderMicroseconds, myScratch, &myWallTime, &myRenderCount);
+			if (myErr != noErr)
+				goto bail;
+
+			if (theReport != NULL) {
+				fprintf(theReport, "{\"benchmark\":\"progress\",\"mode\":\"%s\",\"framesPerCallback\":%ld,\"callbacks\":%ld,\"renders\":%ld,\"renderMicroseconds\":%lu,\"wallMicroseconds\":%llu,\"timeLostPercent\":%.1f}\n",
+							myModeNames[myMode],
+							myCallbackIntervals[myInterval],
+							theFrameCount / myCallbackIntervals[myInterval],
+							myRenderCount,
+							(unsigned long)theRenderMicroseconds,
+							(unsigned long long)myWallTime,
+							100.0 * ((double)myWallTime - (double)myBaseTime) / (double)myBaseTime);
+				fflush(theReport);
+			}
+		}
+	}
+
+bail:
+	free(myScratch);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTProg_TimeExport
+// Run the benchmark's synthetic export kProgBenchmarkRuns times, and return the fastest time.
+//
+//////////
+
+static OSErr QTProg_TimeExport (long theFrameCount, long theCallbackInterval, long theMode, UInt32 theRenderMicroseconds, UInt32 *theScratch, QTUInt64 *theWallTime, long *theRenderCount)
+{
+	QTUInt64				myWallTime;
+	long					myRenderCount;
+	long					myRun;
+	OSErr					myErr = noErr;
+
+	for (myRun = 0; myRun < kProgBenchmarkRuns; myRun++) {
+		myErr = QTProg_RunExport(theFrameCount, theCallbackInterval, theMode, theRenderMicroseconds, theScratch, &myWallTime, &myRenderCount);
+		if (myErr != noErr)
+			return(myErr);
+
+		if ((myRun == 0) || (myWallTime < *theWallTime)) {
+			*theWallTime = myWallTime;
+			*theRenderCount = myRenderCount;
+		}
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTProg_RunExport
+// Run the benchmark's synthetic export once, reporting progress in the specified way.
+//
+//////////
+
+static OSErr QTProg_RunExport (long theFrameCount, long theCallbackInterval, long theMode, UInt32 theRenderMicroseconds, UInt32 *theScratch, QTUInt64 *theWallTime, long *theRenderCount)
+{
+	QTProgressRecord		myProgress;
+	QTProgLoggerPtr			myLogger = NULL;
+	FILE					*myLogStream = NULL;
+	QTUInt64				myStartTime;
+	UInt32					mySeed = 1;
+	long					myCount = kProgBenchmarkScratchSize / sizeof(UInt32);
+	long					myFrame;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	*theWallTime = 0;
+	*theRenderCount = 0;
+
+	QTProg_Init(&myProgress, kProgDefaultIntervalMilliseconds);
+
+	if (theMode == kProgModeLogged) {
+		// if we can't get a scratch file, the logger still takes its snapshots
+		myLogStream = tmpfile();
+
+		myErr = QTProg_StartLogger(&myProgress, myLogStream, "benchmark", &myLogger);
+		if (myErr != noErr)
+			goto bail;
+	}
+
+	myStartTime = QTSys_GetMicroseconds();
+
+	for (myFrame = 1; myFrame <= theFrameCount; myFrame++) {
+		long			myPercentDone;
+
+		for (myIndex = 0; myIndex < myCount; myIndex++) {
+			mySeed = (mySeed * 1664525UL) + 1013904223UL;
+			theScratch[myIndex] ^= mySeed;
+		}
+
+		if ((theMode == kProgModeNone) || (((myFrame % theCallbackInterval) != 0) && (myFrame != theFrameCount)))
+			continue;
+
+		myPercentDone = (long)(((QTUInt64)myFrame * kProgDone) / (QTUInt64)theFrameCount);
+
+		switch (theMode) {
+			case kProgModeDirect:
+				QTProg_Publish(&myProgress, myPercentDone, (QTUInt64)myFrame * kProgBenchmarkFrameBytes);
+				QTProg_Render(&myProgress, theRenderMicroseconds);
+				(*theRenderCount)++;
+				break;
+
+			case kProgModeThrottled:
+				QTProg_Publish(&myProgress, myPercentDone, (QTUInt64)myFrame * kProgBenchmarkFrameBytes);
+				if (QTProg_ShouldRender(&myProgress)) {
+					QTProg_Render(&myProgress, theRenderMicroseconds);
+					(*theRenderCount)++;
+				}
+				break;
+
+			case kProgModeLogged:
+				QTProg_Publish(&myProgress, myPercentDone, (QTUInt64)myFrame * kProgBenchmarkFrameBytes);
+				break;
+		}
+	}
+
+	*theWallTime = QTSys_GetMicroseconds() - myStartTime;
+
+bail:
+	if (myLogger != NULL)
+		*theRenderCount = QTProg_StopLogger(myLogger);
+
+	if (myLogStream != NULL)
+		fclose(myLogStream);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTProg_Render
+// Pretend to draw the progress: take a snapshot, and keep the processor busy for theRenderMicroseconds.
+//
+//////////
+
+static void QTProg_Render (QTProgressPtr theProgress, UInt32 theRenderMicroseconds)
+{
+	QTProgressSnapshotRecord	mySnapshot;
+	QTUInt64					myStartTime = QTSys_GetMicroseconds();
+
+	QTProg_GetSnapshot(theProgress, &mySnapshot);
+
+	while (QTSys_GetMicroseconds() - myStartTime < theRenderMicroseconds)
+		;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTProg_IsProgressCommandLine
+// Does the command line ask us to run the progress benchmark?
+//
+//////////
+
+Boolean QTProg_IsProgressCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kProgBenchmarkSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTProg_Main
+// Run the progress benchmark. Returns one of the kProgExit constants.
+//
+// Usage: -progressbench [-frames <count>] [-render <microseconds>] [-report <file>]
+//
+//////////
+
+int QTProg_Main (int theArgc, char *theArgv[])
+{
+	const char			*myReportPath = NULL;
+	long				myFrameCount = 0;
+	long				myRenderMicroseconds = kProgDefaultBenchmarkRender;
+	FILE				*myReport = stdout;
+	int					myIndex;
+	OSErr				myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kProgFramesSwitch) == 0) && (myIndex + 1 < theArgc))
+			myFrameCount = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kProgRenderSwitch) == 0) && (myIndex + 1 < theArgc))
+			myRenderMicroseconds = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kProgReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if ((myFrameCount < 0) || (myRenderMicroseconds < 0)) {
+		fprintf(stderr, "usage: %s %s [%s <count>] [%s <microseconds>] [%s <file>]\n", theArgv[0], kProgBenchmarkSwitch, kProgFramesSwitch, kProgRenderSwitch, kProgReportSwitch);
+		return(kProgExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kProgExitUsage);
+		}
+	}
+
+	myErr = QTProg_RunBenchmark(myReport, myFrameCount, (UInt32)myRenderMicroseconds);
+	if (myErr != noErr)
+		fprintf(stderr, "progress benchmark failed (error %d)\n", (int)myErr);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kProgExitSuccess : kProgExitFailed);
+}
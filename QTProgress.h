@@ -0,0 +1,98 @@
+//////////
+//
+//	File:		QTProgress.h
+//
+//	Contains:	Portable functions for passing progress from a long operation to whoever displays it.
+//				All utilities start with the prefix "QTProg_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTProgress__
+#define __QTProgress__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSystem.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kProgBenchmarkSwitch				"-progressbench"		// command-line switch that selects the progress benchmark
+#define kProgFramesSwitch					"-frames"				// number of frames in the synthetic export
+#define kProgRenderSwitch					"-render"				// microseconds that drawing the progress takes
+#define kProgReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kProgDone							0x00010000L				// 100%, on the same scale as QuickTime's Fixed percentages
+#define kProgDefaultIntervalMilliseconds	100						// how often consumers render, at most
+#define kProgDefaultBenchmarkFrames			4000
+#define kProgDefaultBenchmarkRender			250
+
+// exit codes returned by QTProg_Main
+enum {
+	kProgExitSuccess						= 0,
+	kProgExitFailed							= 1,
+	kProgExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// progress shared between one producer (the operation) and any number of consumers; see QTProgress.c
+typedef struct QTProgressRecord {
+	volatile long			fSequence;				// odd while the producer is publishing
+	volatile long			fPercentDone;			// 0 to kProgDone
+	volatile QTUInt64		fBytesDone;
+	volatile long			fUpdateCount;			// calls to QTProg_Publish
+	volatile long			fNextRenderTime;		// milliseconds after fStartTime
+	volatile long			fFinalRendered;			// set once a consumer has claimed the 100% render
+	long					fIntervalMilliseconds;
+	QTUInt64				fStartTime;				// microseconds
+} QTProgressRecord, *QTProgressPtr;
+
+// a consistent copy of a progress record, from QTProg_GetSnapshot
+typedef struct QTProgressSnapshotRecord {
+	long					fPercentDone;
+	QTUInt64				fBytesDone;
+	long					fUpdateCount;
+	QTUInt64				fElapsedMicroseconds;
+} QTProgressSnapshotRecord, *QTProgressSnapshotPtr;
+
+typedef struct QTProgLoggerRecord			*QTProgLoggerPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+void						QTProg_Init (QTProgressPtr theProgress, long theIntervalMilliseconds);
+void						QTProg_Publish (QTProgressPtr theProgress, long thePercentDone, QTUInt64 theBytesDone);
+Boolean						QTProg_ShouldRender (QTProgressPtr theProgress);
+void						QTProg_GetSnapshot (QTProgressPtr theProgress, QTProgressSnapshotPtr theSnapshot);
+
+OSErr						QTProg_StartLogger (QTProgressPtr theProgress, FILE *theStream, const char *theName, QTProgLoggerPtr *theLogger);
+long						QTProg_StopLogger (QTProgLoggerPtr theLogger);
+void						QTProg_WriteSnapshot (FILE *theStream, const char *theName, QTProgressSnapshotPtr theSnapshot);
+
+OSErr						QTProg_RunBenchmark (FILE *theReport, long theFrameCount, UInt32 theRenderMicroseconds);
+
+Boolean						QTProg_IsProgressCommandLine (int theArgc, char *theArgv[]);
+int							QTProg_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTProgress__
@@ -0,0 +1,1196 @@
+//////////
+//
+//	File:		QTReference.c
+//
+//	Contains:	Portable functions for importing sound and DV files as reference movies, without copying their media.
+//				All utilities start with the prefix "QTRef_".
+//
+//	When a file can't be imported in place, ConvertFileToMovieFile copies all of its media into a new movie
+//	file. For WAV and AIFF files of uncompressed (or A-law or mu-law) sound, and for raw DV streams, the media
+//	is already laid out the way a QuickTime track wants it: evenly sized frames, one after another. So instead
+//	we write a reference movie, which holds nothing but a movie atom whose sample tables point into the
+//	original file through a URL data reference; it is a few kilobytes however long the source is.
+//
+//	QTRef_ReadSource works out the layout of a source, and returns unimpErr for any it can't point into
+//	(compressed sound, sample rates too high for a sound description, and so on); the caller should then
+//	fall back to a full conversion. QTRef_WriteReferenceMovie reports the bytes it didn't copy and, if
+//	the estimator has a history of full conversions, roughly how much time it saved.
+//
+//	A reference movie only works while its source stays where it was.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTReference.h"
+#include "QTEstimate.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kRefTypeRIFF				FOUR_CHAR_CODE('RIFF')
+#define kRefTypeWAVE				FOUR_CHAR_CODE('WAVE')
+#define kRefTypeFormat				FOUR_CHAR_CODE('fmt ')
+#define kRefTypeData				FOUR_CHAR_CODE('data')
+#define kRefTypeFORM				FOUR_CHAR_CODE('FORM')
+#define kRefTypeAIFF				FOUR_CHAR_CODE('AIFF')
+#define kRefTypeAIFC				FOUR_CHAR_CODE('AIFC')
+#define kRefTypeCommon				FOUR_CHAR_CODE('COMM')
+#define kRefTypeSoundData			FOUR_CHAR_CODE('SSND')
+
+#define kRefWAVEFormatPCM			0x0001
+#define kRefWAVEFormatFloat			0x0003
+#define kRefWAVEFormatALaw			0x0006
+#define kRefWAVEFormatMuLaw			0x0007
+#define kRefWAVEFormatExtensible	0xFFFE
+
+#define kRefDVAudioSection			3						// the section type of DIF blocks that hold sound
+#define kRefDVAudioSourcePack		0x50					// the AAUX pack that says what the sound is
+
+#define kRefSoundVersion1			1
+#define kRefVariableCompression		0xFFFE					// the compression ID (-2) of a version 1 sound description
+#define kRefVideoDescriptionSize	86
+#define kRefSelfContainedFlag		0x000001
+
+// sample description formats
+#define kRefFormatRaw				FOUR_CHAR_CODE('raw ')
+#define kRefFormatTwos				FOUR_CHAR_CODE('twos')
+#define kRefFormatSowt				FOUR_CHAR_CODE('sowt')
+#define kRefFormatInt24				FOUR_CHAR_CODE('in24')
+#define kRefFormatInt32				FOUR_CHAR_CODE('in32')
+#define kRefFormatFloat32			FOUR_CHAR_CODE('fl32')
+#define kRefFormatFloat64			FOUR_CHAR_CODE('fl64')
+#define kRefFormatALaw				FOUR_CHAR_CODE('alaw')
+#define kRefFormatMuLaw				FOUR_CHAR_CODE('ulaw')
+#define kRefFormatDVNTSC			FOUR_CHAR_CODE('dvc ')
+#define kRefFormatDVPAL				FOUR_CHAR_CODE('dvcp')
+#define kRefFormatDVAudio			FOUR_CHAR_CODE('dvca')
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTRef_ReadWAVE (QTSysFile theFile, QTRefSourcePtr theSource);
+static OSErr				QTRef_ReadAIFF (QTSysFile theFile, Boolean theIsCompressed, QTRefSourcePtr theSource);
+static OSErr				QTRef_ReadDV (QTSysFile theFile, Boolean theIsPAL, QTRefSourcePtr theSource);
+static OSErr				QTRef_SetSoundLayout (QTRefSourcePtr theSource, QTUInt64 theDataSize);
+static UInt32				QTRef_GetExtended (const UInt8 *theBytes);
+static UInt16				QTRef_GetLE16 (const UInt8 *theBytes);
+static UInt32				QTRef_GetLE32 (const UInt8 *theBytes);
+static void					QTRef_BeginTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, OSType theHandlerType, UInt32 theTimeScale, QTUInt64 theDuration, QTRefSourcePtr theSource, const char *theURL, UInt32 *theAtoms);
+static void					QTRef_EndTrack (QTAtomBufferPtr theBuffer, UInt32 *theAtoms);
+static void					QTRef_AppendSoundTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, QTRefSourcePtr theSource, const char *theURL);
+static void					QTRef_AppendDVTracks (QTAtomBufferPtr theBuffer, QTRefSourcePtr theSource, const char *theURL);
+static void					QTRef_AppendChunkTables (QTAtomBufferPtr theBuffer, QTUInt64 theFirstOffset, QTUInt64 theFrameCount, UInt32 theFramesPerChunk, UInt32 theBytesPerFrame);
+static QTUInt64				QTRef_GetMovieDuration (QTUInt64 theDuration, UInt32 theTimeScale);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Source functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTRef_ReadSource
+// Find out where the media of the file at thePath is, and whether a reference movie can point into it.
+//
+// Returns unimpErr if the file is of a kind (or in a format) we can't point into.
+//
+//////////
+
+OSErr QTRef_ReadSource (const char *thePath, QTRefSourcePtr theSource)
+{
+	QTSysFile				myFile = kQTSysInvalidFile;
+	UInt8					myHeader[12];
+	UInt32					myRead = 0;
+	OSErr					myErr = noErr;
+
+	if ((thePath == NULL) || (theSource == NULL))
+		return(paramErr);
+
+	memset(theSource, 0, sizeof(QTRefSourceRecord));
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenRead, &myFile);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTSys_GetFileSize(myFile, &theSource->fFileSize);
+	if (myErr == noErr)
+		myErr = QTSys_ReadFile(myFile, 0, myHeader, sizeof(myHeader), &myRead);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = unimpErr;
+	if (myRead < sizeof(myHeader))
+		goto bail;
+
+	if ((QTAtom_GetBE32(myHeader) == kRefTypeRIFF) && (QTAtom_GetBE32(myHeader + 8) == kRefTypeWAVE))
+		myErr = QTRef_ReadWAVE(myFile, theSource);
+	else if ((QTAtom_GetBE32(myHeader) == kRefTypeFORM) && (QTAtom_GetBE32(myHeader + 8) == kRefTypeAIFF))
+		myErr = QTRef_ReadAIFF(myFile, false, theSource);
+	else if ((QTAtom_GetBE32(myHeader) == kRefTypeFORM) && (QTAtom_GetBE32(myHeader + 8) == kRefTypeAIFC))
+		myErr = QTRef_ReadAIFF(myFile, true, theSource);
+
+	// a DV stream starts with the header block of its first DIF sequence; the top bit of the fourth byte says which system it is
+	else if ((myHeader[0] == 0x1F) && (myHeader[1] == 0x07) && (myHeader[2] == 0x00) && ((myHeader[3] & 0x7F) == 0x3F))
+		myErr = QTRef_ReadDV(myFile, (myHeader[3] & 0x80) != 0, theSource);
+
+bail:
+	QTSys_CloseFile(myFile);
+
+	if (myErr != noErr)
+		theSource->fKind = kRefKindNone;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRef_ReadWAVE
+// Find the format and data chunks of a WAV file.
+//
+// The chunks of a RIFF file have little-endian sizes, and are padded to an even length.
+//
+//////////
+
+static OSErr QTRef_ReadWAVE (QTSysFile theFile, QTRefSourcePtr theSource)
+{
+	UInt8					myChunk[40];
+	QTUInt64				myOffset = 12;
+	QTUInt64				myDataSize = 0;
+	UInt32					myChunkSize;
+	UInt32					myRead;
+	UInt16					myFormat = 0;
+	Boolean					myHasFormat = false;
+	Boolean					myHasData = false;
+	OSErr					myErr = noErr;
+
+	while (!(myHasFormat && myHasData) && (myOffset + 8 <= theSource->fFileSize)) {
+		myErr = QTSys_ReadFile(theFile, myOffset, myChunk, 8, &myRead);
+		if ((myErr != noErr) || (myRead < 8))
+			return((myErr != noErr) ? myErr : unimpErr);
+
+		myChunkSize = QTRef_GetLE32(myChunk + 4);
+
+		if (QTAtom_GetBE32(myChunk) == kRefTypeFormat) {
+			if (myChunkSize < 16)
+				return(unimpErr);
+
+			myErr = QTSys_ReadFile(theFile, myOffset + 8, myChunk, (myChunkSize < sizeof(myChunk)) ? myChunkSize : sizeof(myChunk), &myRead);
+			if ((myErr != noErr) || (myRead < 16))
+				return((myErr != noErr) ? myErr : unimpErr);
+
+			myFormat = QTRef_GetLE16(myChunk);
+			theSource->fChannelCount = QTRef_GetLE16(myChunk + 2);
+			theSource->fSampleRate = QTRef_GetLE32(myChunk + 4);
+			theSource->fBytesPerFrame = QTRef_GetLE16(myChunk + 12);
+			theSource->fBitsPerSample = QTRef_GetLE16(myChunk + 14);
+
+			// an extensible format puts the real format at the start of its subformat GUID
+			if ((myFormat == kRefWAVEFormatExtensible) && (myRead >= 26))
+				myFormat = QTRef_GetLE16(myChunk + 24);
+
+			myHasFormat = true;
+		} else if (QTAtom_GetBE32(myChunk) == kRefTypeData) {
+			theSource->fDataOffset = myOffset + 8;
+
+			// files written as streams may leave the data size at 0 or 0xFFFFFFFF; the data runs to the end
+			myDataSize = theSource->fFileSize - theSource->fDataOffset;
+			if ((myChunkSize != 0) && (myChunkSize < myDataSize))
+				myDataSize = myChunkSize;
+
+			myHasData = true;
+		}
+
+		myOffset += 8 + (QTUInt64)myChunkSize + (myChunkSize & 1);
+	}
+
+	if (!myHasFormat || !myHasData)
+		return(unimpErr);
+
+	theSource->fKind = kRefKindWAVE;
+	theSource->fLittleEndian = true;
+
+	switch (myFormat) {
+		case kRefWAVEFormatPCM:
+			switch (theSource->fBitsPerSample) {
+				case 8:		theSource->fFormat = kRefFormatRaw;		break;			// 8-bit WAV samples are unsigned
+				case 16:	theSource->fFormat = kRefFormatSowt;	break;
+				case 24:	theSource->fFormat = kRefFormatInt24;	break;
+				case 32:	theSource->fFormat = kRefFormatInt32;	break;
+				default:	return(unimpErr);
+			}
+			break;
+
+		case kRefWAVEFormatFloat:
+			switch (theSource->fBitsPerSample) {
+				case 32:	theSource->fFormat = kRefFormatFloat32;	break;
+				case 64:	theSource->fFormat = kRefFormatFloat64;	break;
+				default:	return(unimpErr);
+			}
+			break;
+
+		case kRefWAVEFormatALaw:
+			theSource->fFormat = kRefFormatALaw;
+			break;
+
+		case kRefWAVEFormatMuLaw:
+			theSource->fFormat = kRefFormatMuLaw;
+			break;
+
+		default:
+			return(unimpErr);
+	}
+
+	return(QTRef_SetSoundLayout(theSource, myDataSize));
+}
+
+
+//////////
+//
+// QTRef_ReadAIFF
+// Find the common and sound data chunks of an AIFF or AIFF-C file.
+//
+// The chunks of an IFF file have big-endian sizes, and are padded to an even length.
+//
+//////////
+
+static OSErr QTRef_ReadAIFF (QTSysFile theFile, Boolean theIsCompressed, QTRefSourcePtr theSource)
+{
+	UInt8					myChunk[26];
+	QTUInt64				myOffset = 12;
+	QTUInt64				myDataSize = 0;
+	QTUInt64				myFrameCount = 0;
+	UInt32					myChunkSize;
+	UInt32					myRead;
+	OSType					myCompression = FOUR_CHAR_CODE('NONE');
+	Boolean					myHasCommon = false;
+	Boolean					myHasData = false;
+	OSErr					myErr = noErr;
+
+	while (!(myHasCommon && myHasData) && (myOffset + 8 <= theSource->fFileSize)) {
+		myErr = QTSys_ReadFile(theFile, myOffset, myChunk, 8, &myRead);
+		if ((myErr != noErr) || (myRead < 8))
+			return((myErr != noErr) ? myErr : unimpErr);
+
+		myChunkSize = QTAtom_GetBE32(myChunk + 4);
+
+		if (QTAtom_GetBE32(myChunk) == kRefTypeCommon) {
+			myErr = QTSys_ReadFile(theFile, myOffset + 8, myChunk, (myChunkSize < sizeof(myChunk)) ? myChunkSize : sizeof(myChunk), &myRead);
+			if ((myErr != noErr) || (myRead < 18) || (theIsCompressed && (myRead < 22)))
+				return((myErr != noErr) ? myErr : unimpErr);
+
+			// channels, frames, bits per sample, an 80-bit sample rate and, in AIFF-C, a compression type
+			theSource->fChannelCount = QTAtom_GetBE16(myChunk);
+			myFrameCount = QTAtom_GetBE32(myChunk + 2);
+			theSource->fBitsPerSample = QTAtom_GetBE16(myChunk + 6);
+			theSource->fSampleRate = QTRef_GetExtended(myChunk + 8);
+			if (theIsCompressed)
+				myCompression = QTAtom_GetBE32(myChunk + 18);
+
+			myHasCommon = true;
+		} else if (QTAtom_GetBE32(myChunk) == kRefTypeSoundData) {
+			// the sound data chunk starts with an offset to the first frame, and a block size we can ignore
+			myErr = QTSys_ReadFile(theFile, myOffset + 8, myChunk, 8, &myRead);
+			if ((myErr != noErr) || (myRead < 8) || (myChunkSize < 8 + QTAtom_GetBE32(myChunk)))
+				return((myErr != noErr) ? myErr : unimpErr);
+
+			theSource->fDataOffset = myOffset + 16 + QTAtom_GetBE32(myChunk);
+			myDataSize = myChunkSize - 8 - QTAtom_GetBE32(myChunk);
+			if (theSource->fDataOffset + myDataSize > theSource->fFileSize)
+				myDataSize = (theSource->fDataOffset < theSource->fFileSize) ? theSource->fFileSize - theSource->fDataOffset : 0;
+
+			myHasData = true;
+		}
+
+		myOffset += 8 + (QTUInt64)myChunkSize + (myChunkSize & 1);
+	}
+
+	if (!myHasCommon || !myHasData)
+		return(unimpErr);
+
+	theSource->fKind = kRefKindAIFF;
+
+	switch (myCompression) {
+		case FOUR_CHAR_CODE('NONE'):
+		case kRefFormatTwos:
+			switch (theSource->fBitsPerSample) {
+				case 8:
+				case 16:	theSource->fFormat = kRefFormatTwos;	break;
+				case 24:	theSource->fFormat = kRefFormatInt24;	break;
+				case 32:	theSource->fFormat = kRefFormatInt32;	break;
+				default:	return(unimpErr);
+			}
+			break;
+
+		case kRefFormatSowt:
+			theSource->fLittleEndian = true;
+			switch (theSource->fBitsPerSample) {
+				case 16:	theSource->fFormat = kRefFormatSowt;	break;
+				case 24:	theSource->fFormat = kRefFormatInt24;	break;
+				case 32:	theSource->fFormat = kRefFormatInt32;	break;
+				default:	return(unimpErr);
+			}
+			break;
+
+		case kRefFormatFloat32:
+		case FOUR_CHAR_CODE('FL32'):
+			theSource->fFormat = kRefFormatFloat32;
+			theSource->fBitsPerSample = 32;
+			break;
+
+		case kRefFormatFloat64:
+		case FOUR_CHAR_CODE('FL64'):
+			theSource->fFormat = kRefFormatFloat64;
+			theSource->fBitsPerSample = 64;
+			break;
+
+		case kRefFormatALaw:
+		case FOUR_CHAR_CODE('ALAW'):
+			theSource->fFormat = kRefFormatALaw;
+			break;
+
+		case kRefFormatMuLaw:
+		case FOUR_CHAR_CODE('ULAW'):
+			theSource->fFormat = kRefFormatMuLaw;
+			break;
+
+		default:
+			return(unimpErr);
+	}
+
+	// the common chunk's frame count wins over the size of the sound data chunk, which may be padded
+	if ((theSource->fFormat == kRefFormatALaw) || (theSource->fFormat == kRefFormatMuLaw))
+		theSource->fBytesPerFrame = theSource->fChannelCount;
+	else
+		theSource->fBytesPerFrame = theSource->fChannelCount * (theSource->fBitsPerSample / 8);
+
+	if ((myFrameCount * theSource->fBytesPerFrame) < myDataSize)
+		myDataSize = myFrameCount * theSource->fBytesPerFrame;
+
+	return(QTRef_SetSoundLayout(theSource, myDataSize));
+}
+
+
+//////////
+//
+// QTRef_ReadDV
+// Work out the frames of a raw DV stream, and what sound they hold.
+//
+// We take every frame to be like the first; QuickTime's DV codecs cope with the odd damaged one.
+//
+//////////
+
+static OSErr QTRef_ReadDV (QTSysFile theFile, Boolean theIsPAL, QTRefSourcePtr theSource)
+{
+	static const UInt32		kSampleRates[] = {48000, 44100, 32000};
+	UInt8					*myFrame = NULL;
+	UInt32					myRead;
+	UInt32					myOffset;
+	UInt32					myRate;
+	OSErr					myErr = noErr;
+
+	theSource->fKind = kRefKindDV;
+	theSource->fIsPAL = theIsPAL;
+	theSource->fFormat = theIsPAL ? kRefFormatDVPAL : kRefFormatDVNTSC;
+	theSource->fBytesPerFrame = theIsPAL ? kRefDVFrameSizePAL : kRefDVFrameSizeNTSC;
+	theSource->fFrameCount = theSource->fFileSize / theSource->fBytesPerFrame;
+	theSource->fDataOffset = 0;
+	theSource->fDataSize = theSource->fFrameCount * theSource->fBytesPerFrame;
+
+	if (theSource->fFrameCount == 0)
+		return(unimpErr);
+
+	myFrame = (UInt8 *)malloc(theSource->fBytesPerFrame);
+	if (myFrame == NULL)
+		return(memFullErr);
+
+	myErr = QTSys_ReadFile(theFile, 0, myFrame, theSource->fBytesPerFrame, &myRead);
+	if (myErr != noErr)
+		goto bail;
+
+	// look through the first frame's sound blocks for the pack that gives the sample rate; if there isn't one, there's no sound
+	for (myOffset = 0; myOffset + kRefDVBlockSize <= myRead; myOffset += kRefDVBlockSize) {
+		if (((myFrame[myOffset] >> 5) != kRefDVAudioSection) || (myFrame[myOffset + 3] != kRefDVAudioSourcePack))
+			continue;
+
+		myRate = (myFrame[myOffset + 7] >> 3) & 0x07;
+		if (myRate < sizeof(kSampleRates) / sizeof(kSampleRates[0])) {
+			theSource->fSampleRate = kSampleRates[myRate];
+			theSource->fChannelCount = 2;
+			theSource->fBitsPerSample = 16;
+		}
+
+		break;
+	}
+
+bail:
+	free(myFrame);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRef_SetSoundLayout
+// Finish the layout of a sound source, once we know its format and how many bytes of sound it has.
+//
+// Sound descriptions give the sample rate as a 16.16 fixed-point number, so we can't point at sound
+// sampled more than 65535 times a second.
+//
+//////////
+
+static OSErr QTRef_SetSoundLayout (QTRefSourcePtr theSource, QTUInt64 theDataSize)
+{
+	if ((theSource->fFormat == kRefFormatALaw) || (theSource->fFormat == kRefFormatMuLaw)) {
+		theSource->fBitsPerSample = 16;						// what they decode to
+		theSource->fBytesPerFrame = theSource->fChannelCount;
+	}
+
+	if ((theSource->fChannelCount == 0) || (theSource->fSampleRate == 0) || (theSource->fSampleRate > 0xFFFF))
+		return(unimpErr);
+
+	if ((theSource->fFormat != kRefFormatALaw) && (theSource->fFormat != kRefFormatMuLaw) && (theSource->fBytesPerFrame != theSource->fChannelCount * (theSource->fBitsPerSample / 8UL)))
+		return(unimpErr);
+
+	theSource->fFrameCount = theDataSize / theSource->fBytesPerFrame;
+	theSource->fDataSize = theSource->fFrameCount * theSource->fBytesPerFrame;
+
+	return((theSource->fFrameCount > 0) ? noErr : unimpErr);
+}
+
+
+//////////
+//
+// QTRef_GetExtended
+// Convert an 80-bit IEEE extended number (as AIFF gives sample rates) into an integer; return 0 if it isn't a whole number we can hold.
+//
+//////////
+
+static UInt32 QTRef_GetExtended (const UInt8 *theBytes)
+{
+	int				myExponent = (int)(QTAtom_GetBE16(theBytes) & 0x7FFF) - 16383;
+	QTUInt64		myMantissa = QTAtom_GetBE64(theBytes + 2);
+	int				myShift = 63 - myExponent;
+
+	if ((theBytes[0] & 0x80) || (myExponent < 0) || (myExponent > 31))
+		return(0);
+
+	if ((myMantissa & (((QTUInt64)1 << myShift) - 1)) != 0)
+		return(0);
+
+	return((UInt32)(myMantissa >> myShift));
+}
+
+
+//////////
+//
+// QTRef_GetLE16
+// Get a little-endian 16-bit value.
+//
+//////////
+
+static UInt16 QTRef_GetLE16 (const UInt8 *theBytes)
+{
+	return((UInt16)(theBytes[0] | (theBytes[1] << 8)));
+}
+
+
+//////////
+//
+// QTRef_GetLE32
+// Get a little-endian 32-bit value.
+//
+//////////
+
+static UInt32 QTRef_GetLE32 (const UInt8 *theBytes)
+{
+	return((UInt32)theBytes[0] | ((UInt32)theBytes[1] << 8) | ((UInt32)theBytes[2] << 16) | ((UInt32)theBytes[3] << 24));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Movie functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTRef_MakeFileURL
+// Make the file URL of the file at thePath, for a URL data reference.
+//
+//////////
+
+OSErr QTRef_MakeFileURL (const char *thePath, char *theBuffer, size_t theBufferSize)
+{
+	static const char		kHexDigits[] = "0123456789ABCDEF";
+	char					myPath[kQTSysMaxPath];
+	const char				*myNext;
+	size_t					myLength;
+	OSErr					myErr = noErr;
+
+	myErr = QTSys_GetFullPath(myPath, sizeof(myPath), thePath);
+	if (myErr != noErr)
+		return(myErr);
+
+	// "file://" and then the path, which on Windows starts with a drive letter and needs a slash before it
+	myLength = (size_t)QTSys_FormatString(theBuffer, theBufferSize, (myPath[0] == '/') ? "file://" : "file:///");
+
+	for (myNext = myPath; *myNext != '\0'; myNext++) {
+		UInt8		myChar = (UInt8)*myNext;
+
+		if (myLength + 4 > theBufferSize)
+			return(paramErr);
+
+		if (myChar == '\\')
+			theBuffer[myLength++] = '/';
+		else if ((myChar <= ' ') || (myChar >= 0x7F) || (strchr("\"#%<>?[]^`{|}", myChar) != NULL)) {
+			theBuffer[myLength++] = '%';
+			theBuffer[myLength++] = kHexDigits[myChar >> 4];
+			theBuffer[myLength++] = kHexDigits[myChar & 0x0F];
+		} else
+			theBuffer[myLength++] = (char)myChar;
+	}
+
+	theBuffer[myLength] = '\0';
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTRef_BuildMovie
+// Build a reference movie (a file type atom and a movie atom) whose tracks point into the source at theURL.
+//
+//////////
+
+OSErr QTRef_BuildMovie (QTRefSourcePtr theSource, const char *theURL, QTAtomBufferPtr theBuffer)
+{
+	QTUInt64				myDuration;
+	UInt32					myAtom;
+	UInt32					myHeader;
+	UInt32					myTrackCount;
+
+	if ((theSource == NULL) || (theURL == NULL) || (theBuffer == NULL) || (theSource->fKind == kRefKindNone))
+		return(paramErr);
+
+	if (theSource->fKind == kRefKindDV) {
+		myDuration = QTRef_GetMovieDuration(theSource->fFrameCount * (theSource->fIsPAL ? 1 : 100), theSource->fIsPAL ? 25 : 2997);
+		myTrackCount = (theSource->fSampleRate != 0) ? 2 : 1;
+	} else {
+		myDuration = QTRef_GetMovieDuration(theSource->fFrameCount, theSource->fSampleRate);
+		myTrackCount = 1;
+	}
+
+	myAtom = QTAtom_BeginAtom(theBuffer, kAtomTypeFileType);
+	QTAtom_Append32(theBuffer, kAtomBrandQuickTime);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, kAtomBrandQuickTime);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myAtom = QTAtom_BeginAtom(theBuffer, kAtomTypeMovie);
+
+	// the movie header (version 0)
+	myHeader = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMovieHeader, 0, 0);
+	QTAtom_Append32(theBuffer, 0);								// creation time
+	QTAtom_Append32(theBuffer, 0);								// modification time
+	QTAtom_Append32(theBuffer, kRefMovieTimeScale);
+	QTAtom_Append32(theBuffer, (UInt32)myDuration);
+	QTAtom_Append32(theBuffer, 0x00010000);						// preferred rate
+	QTAtom_Append16(theBuffer, 0x0100);							// preferred volume
+	QTAtom_AppendZeros(theBuffer, 10);
+	QTAtom_Append32(theBuffer, 0x00010000);						// matrix
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append32(theBuffer, 0x00010000);
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append32(theBuffer, 0x40000000);
+	QTAtom_AppendZeros(theBuffer, 24);							// preview and poster times, selection, current time
+	QTAtom_Append32(theBuffer, myTrackCount + 1);				// next track ID
+	QTAtom_EndAtom(theBuffer, myHeader);
+
+	if (theSource->fKind == kRefKindDV)
+		QTRef_AppendDVTracks(theBuffer, theSource, theURL);
+	else
+		QTRef_AppendSoundTrack(theBuffer, 1, theSource, theURL);
+
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// a movie more than 2^32 movie time units (about 83 days) long isn't going to be a sound file
+	if ((theBuffer->fErr == noErr) && (myDuration > 0xFFFFFFFFUL))
+		return(unimpErr);
+
+	return(theBuffer->fErr);
+}
+
+
+//////////
+//
+// QTRef_BeginTrack
+// Begin a track with one data reference, to theURL, down to the start of its sample table.
+//
+// On return theAtoms holds the offsets of the atoms that QTRef_EndTrack must end.
+//
+//////////
+
+static void QTRef_BeginTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, OSType theHandlerType, UInt32 theTimeScale, QTUInt64 theDuration, QTRefSourcePtr theSource, const char *theURL, UInt32 *theAtoms)
+{
+	Boolean					myIsVideo = (theHandlerType == kAtomHandlerVideo);
+	UInt32					myAtom;
+
+	theAtoms[0] = QTAtom_BeginAtom(theBuffer, kAtomTypeTrack);
+
+	// the track header (version 0); enabled, in the movie, the preview and the poster
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTrackHeader, 0, 0x0F);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, theTrackID);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, (UInt32)QTRef_GetMovieDuration(theDuration, theTimeScale));
+	QTAtom_AppendZeros(theBuffer, 8);
+	QTAtom_Append16(theBuffer, 0);								// layer
+	QTAtom_Append16(theBuffer, 0);								// alternate group
+	QTAtom_Append16(theBuffer, myIsVideo ? 0 : 0x0100);			// volume
+	QTAtom_Append16(theBuffer, 0);
+	QTAtom_Append32(theBuffer, 0x00010000);						// matrix
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append32(theBuffer, 0x00010000);
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append32(theBuffer, 0x40000000);
+	QTAtom_Append32(theBuffer, myIsVideo ? (720UL << 16) : 0);
+	QTAtom_Append32(theBuffer, myIsVideo ? ((theSource->fIsPAL ? 576UL : 480UL) << 16) : 0);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	theAtoms[1] = QTAtom_BeginAtom(theBuffer, kAtomTypeMedia);
+
+	// the media header (version 1, in case the duration needs 64 bits)
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMediaHeader, 1, 0);
+	QTAtom_Append64(theBuffer, 0);
+	QTAtom_Append64(theBuffer, 0);
+	QTAtom_Append32(theBuffer, theTimeScale);
+	QTAtom_Append64(theBuffer, theDuration);
+	QTAtom_Append16(theBuffer, 0);								// language
+	QTAtom_Append16(theBuffer, 0);								// quality
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeHandler, 0, 0);
+	QTAtom_Append32(theBuffer, kAtomHandlerMedia);
+	QTAtom_Append32(theBuffer, theHandlerType);
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append8(theBuffer, 0);								// empty name
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	theAtoms[2] = QTAtom_BeginAtom(theBuffer, kAtomTypeMediaInfo);
+
+	// the media information header: graphics mode dither copy for video, centered balance for sound
+	if (myIsVideo) {
+		myAtom = QTAtom_BeginFullAtom(theBuffer, FOUR_CHAR_CODE('vmhd'), 0, 0x000001);
+		QTAtom_Append16(theBuffer, 0x0040);
+		QTAtom_AppendZeros(theBuffer, 6);
+	} else {
+		myAtom = QTAtom_BeginFullAtom(theBuffer, FOUR_CHAR_CODE('smhd'), 0, 0);
+		QTAtom_AppendZeros(theBuffer, 4);
+	}
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// the data handler, and its one data reference
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeHandler, 0, 0);
+	QTAtom_Append32(theBuffer, FOUR_CHAR_CODE('dhlr'));
+	QTAtom_Append32(theBuffer, kAtomTypeDataRefURL);
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append8(theBuffer, 0);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	theAtoms[3] = QTAtom_BeginAtom(theBuffer, kAtomTypeDataInfo);
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeDataRef, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	theAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeDataRefURL, 0, 0);
+	QTAtom_AppendBytes(theBuffer, theURL, (UInt32)strlen(theURL) + 1);
+	QTAtom_EndAtom(theBuffer, theAtoms[4]);
+	QTAtom_EndAtom(theBuffer, myAtom);
+	QTAtom_EndAtom(theBuffer, theAtoms[3]);
+
+	theAtoms[3] = QTAtom_BeginAtom(theBuffer, kAtomTypeSampleTable);
+}
+
+
+//////////
+//
+// QTRef_EndTrack
+// End a track begun by QTRef_BeginTrack.
+//
+//////////
+
+static void QTRef_EndTrack (QTAtomBufferPtr theBuffer, UInt32 *theAtoms)
+{
+	QTAtom_EndAtom(theBuffer, theAtoms[3]);
+	QTAtom_EndAtom(theBuffer, theAtoms[2]);
+	QTAtom_EndAtom(theBuffer, theAtoms[1]);
+	QTAtom_EndAtom(theBuffer, theAtoms[0]);
+}
+
+
+//////////
+//
+// QTRef_AppendSoundTrack
+// Append the track of a WAV or AIFF source.
+//
+// Each sound frame is a sample. Formats of more than 16 bits per sample need a version 1 sound
+// description, with an 'enda' atom if their samples are little-endian.
+//
+//////////
+
+static void QTRef_AppendSoundTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, QTRefSourcePtr theSource, const char *theURL)
+{
+	UInt32					myAtoms[5];
+	UInt32					myAtom;
+	UInt32					myEntry;
+	UInt32					myWave;
+	UInt32					myFramesPerChunk = kRefChunkBytes / theSource->fBytesPerFrame;
+	Boolean					myIsVersion1 = (theSource->fBitsPerSample > 16) && (theSource->fFormat != kRefFormatALaw) && (theSource->fFormat != kRefFormatMuLaw);
+
+	if (myFramesPerChunk == 0)
+		myFramesPerChunk = 1;
+
+	QTRef_BeginTrack(theBuffer, theTrackID, kAtomHandlerSound, theSource->fSampleRate, theSource->fFrameCount, theSource, theURL, myAtoms);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleDesc, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	myEntry = QTAtom_BeginAtom(theBuffer, theSource->fFormat);
+	QTAtom_AppendZeros(theBuffer, 6);
+	QTAtom_Append16(theBuffer, 1);								// data reference index
+	QTAtom_Append16(theBuffer, myIsVersion1 ? kRefSoundVersion1 : 0);
+	QTAtom_Append16(theBuffer, 0);								// revision
+	QTAtom_Append32(theBuffer, 0);								// vendor
+	QTAtom_Append16(theBuffer, theSource->fChannelCount);
+	QTAtom_Append16(theBuffer, theSource->fBitsPerSample);
+	QTAtom_Append16(theBuffer, myIsVersion1 ? kRefVariableCompression : 0);
+	QTAtom_Append16(theBuffer, 0);								// packet size
+	QTAtom_Append32(theBuffer, theSource->fSampleRate << 16);
+	if (myIsVersion1) {
+		QTAtom_Append32(theBuffer, 1);							// samples per packet
+		QTAtom_Append32(theBuffer, theSource->fBitsPerSample / 8);
+		QTAtom_Append32(theBuffer, theSource->fBytesPerFrame);
+		QTAtom_Append32(theBuffer, theSource->fBitsPerSample / 8);
+
+		if (theSource->fLittleEndian) {
+			myWave = QTAtom_BeginAtom(theBuffer, FOUR_CHAR_CODE('wave'));
+			QTAtom_Append32(theBuffer, 12);
+			QTAtom_Append32(theBuffer, FOUR_CHAR_CODE('frma'));
+			QTAtom_Append32(theBuffer, theSource->fFormat);
+			QTAtom_Append32(theBuffer, 10);
+			QTAtom_Append32(theBuffer, FOUR_CHAR_CODE('enda'));
+			QTAtom_Append16(theBuffer, 1);
+			QTAtom_Append32(theBuffer, 8);						// the terminator atom
+			QTAtom_Append32(theBuffer, 0);
+			QTAtom_EndAtom(theBuffer, myWave);
+		}
+	}
+	QTAtom_EndAtom(theBuffer, myEntry);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTimeToSample, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, (UInt32)theSource->fFrameCount);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// sound samples are all one unit big, whatever their format
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleSize, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, (UInt32)theSource->fFrameCount);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	QTRef_AppendChunkTables(theBuffer, theSource->fDataOffset, theSource->fFrameCount, myFramesPerChunk, theSource->fBytesPerFrame);
+
+	QTRef_EndTrack(theBuffer, myAtoms);
+}
+
+
+//////////
+//
+// QTRef_AppendDVTracks
+// Append the video track of a DV source and, if its frames hold sound, a sound track that points at the same frames.
+//
+// The sound track's samples are the DV frames too, so their durations (in sound samples) aren't
+// all the same; at 29.97 frames a second they follow the five-frame pattern that DV itself uses.
+//
+//////////
+
+static void QTRef_AppendDVTracks (QTAtomBufferPtr theBuffer, QTRefSourcePtr theSource, const char *theURL)
+{
+	UInt32					myAtoms[5];
+	UInt32					myAtom;
+	UInt32					myEntry;
+	UInt32					myCountOffset;
+	UInt32					myTimeScale = theSource->fIsPAL ? 25 : 2997;
+	UInt32					myFrameDuration = theSource->fIsPAL ? 1 : 100;
+	const char				*myName = theSource->fIsPAL ? "DV - PAL" : "DV/DVCPRO - NTSC";
+	QTUInt64				myFrame;
+	QTUInt64				myStart;
+	QTUInt64				myEnd;
+	UInt32					myRunDuration = 0;
+	UInt32					myRunCount = 0;
+	UInt32					myEntryCount = 0;
+
+	QTRef_BeginTrack(theBuffer, 1, kAtomHandlerVideo, myTimeScale, theSource->fFrameCount * myFrameDuration, theSource, theURL, myAtoms);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleDesc, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	myEntry = QTAtom_BeginAtom(theBuffer, theSource->fFormat);
+	QTAtom_AppendZeros(theBuffer, 6);
+	QTAtom_Append16(theBuffer, 1);								// data reference index
+	QTAtom_Append16(theBuffer, 0);								// version
+	QTAtom_Append16(theBuffer, 0);								// revision
+	QTAtom_Append32(theBuffer, FOUR_CHAR_CODE('appl'));
+	QTAtom_Append32(theBuffer, 0);								// temporal quality
+	QTAtom_Append32(theBuffer, 0x00000200);						// spatial quality (normal)
+	QTAtom_Append16(theBuffer, 720);
+	QTAtom_Append16(theBuffer, theSource->fIsPAL ? 576 : 480);
+	QTAtom_Append32(theBuffer, 72UL << 16);						// horizontal and vertical resolution
+	QTAtom_Append32(theBuffer, 72UL << 16);
+	QTAtom_Append32(theBuffer, 0);								// data size
+	QTAtom_Append16(theBuffer, 1);								// frames per sample
+	QTAtom_Append8(theBuffer, (UInt8)strlen(myName));			// the compressor name, a 32-byte Pascal string
+	QTAtom_AppendBytes(theBuffer, myName, (UInt32)strlen(myName));
+	QTAtom_AppendZeros(theBuffer, 31 - (UInt32)strlen(myName));
+	QTAtom_Append16(theBuffer, 24);								// depth
+	QTAtom_Append16(theBuffer, 0xFFFF);							// no color table
+	QTAtom_EndAtom(theBuffer, myEntry);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTimeToSample, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, (UInt32)theSource->fFrameCount);
+	QTAtom_Append32(theBuffer, myFrameDuration);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleSize, 0, 0);
+	QTAtom_Append32(theBuffer, theSource->fBytesPerFrame);
+	QTAtom_Append32(theBuffer, (UInt32)theSource->fFrameCount);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	QTRef_AppendChunkTables(theBuffer, theSource->fDataOffset, theSource->fFrameCount, kRefDVChunkFrames, theSource->fBytesPerFrame);
+
+	QTRef_EndTrack(theBuffer, myAtoms);
+
+	if (theSource->fSampleRate == 0)
+		return;
+
+	QTRef_BeginTrack(theBuffer, 2, kAtomHandlerSound, theSource->fSampleRate, (theSource->fFrameCount * myFrameDuration * theSource->fSampleRate) / myTimeScale, theSource, theURL, myAtoms);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleDesc, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	myEntry = QTAtom_BeginAtom(theBuffer, kRefFormatDVAudio);
+	QTAtom_AppendZeros(theBuffer, 6);
+	QTAtom_Append16(theBuffer, 1);								// data reference index
+	QTAtom_AppendZeros(theBuffer, 8);							// version, revision and vendor
+	QTAtom_Append16(theBuffer, theSource->fChannelCount);
+	QTAtom_Append16(theBuffer, theSource->fBitsPerSample);
+	QTAtom_Append16(theBuffer, 0);								// compression ID
+	QTAtom_Append16(theBuffer, 0);								// packet size
+	QTAtom_Append32(theBuffer, theSource->fSampleRate << 16);
+	QTAtom_EndAtom(theBuffer, myEntry);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// the duration of each frame is the sound samples up to the end of it, less those up to its start
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTimeToSample, 0, 0);
+	myCountOffset = theBuffer->fSize;
+	QTAtom_Append32(theBuffer, 0);
+	for (myFrame = 0, myStart = 0; myFrame < theSource->fFrameCount; myFrame++, myStart = myEnd) {
+		myEnd = ((myFrame + 1) * myFrameDuration * theSource->fSampleRate) / myTimeScale;
+
+		if ((myRunCount > 0) && ((UInt32)(myEnd - myStart) != myRunDuration)) {
+			QTAtom_Append32(theBuffer, myRunCount);
+			QTAtom_Append32(theBuffer, myRunDuration);
+			myEntryCount++;
+			myRunCount = 0;
+		}
+
+		myRunDuration = (UInt32)(myEnd - myStart);
+		myRunCount++;
+	}
+	QTAtom_Append32(theBuffer, myRunCount);
+	QTAtom_Append32(theBuffer, myRunDuration);
+	myEntryCount++;
+	if (theBuffer->fErr == noErr)
+		QTAtom_PutBE32(theBuffer->fData + myCountOffset, myEntryCount);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleSize, 0, 0);
+	QTAtom_Append32(theBuffer, theSource->fBytesPerFrame);
+	QTAtom_Append32(theBuffer, (UInt32)theSource->fFrameCount);
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	QTRef_AppendChunkTables(theBuffer, theSource->fDataOffset, theSource->fFrameCount, kRefDVChunkFrames, theSource->fBytesPerFrame);
+
+	QTRef_EndTrack(theBuffer, myAtoms);
+}
+
+
+//////////
+//
+// QTRef_AppendChunkTables
+// Append the sample-to-chunk and chunk offset atoms for frames laid out one after another from theFirstOffset.
+//
+// Every chunk has theFramesPerChunk frames, except perhaps the last.
+//
+//////////
+
+static void QTRef_AppendChunkTables (QTAtomBufferPtr theBuffer, QTUInt64 theFirstOffset, QTUInt64 theFrameCount, UInt32 theFramesPerChunk, UInt32 theBytesPerFrame)
+{
+	QTUInt64				myFullChunks = theFrameCount / theFramesPerChunk;
+	UInt32					myLastFrames = (UInt32)(theFrameCount % theFramesPerChunk);
+	QTUInt64				myChunkCount = myFullChunks + ((myLastFrames != 0) ? 1 : 0);
+	QTUInt64				myChunkBytes = (QTUInt64)theFramesPerChunk * theBytesPerFrame;
+	Boolean					myUse64 = (theFirstOffset + theFrameCount * theBytesPerFrame > 0xFFFFFFFFUL);
+	QTUInt64				myIndex;
+	UInt32					myAtom;
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleToChunk, 0, 0);
+	QTAtom_Append32(theBuffer, ((myFullChunks > 0) ? 1 : 0) + ((myLastFrames != 0) ? 1 : 0));
+	if (myFullChunks > 0) {
+		QTAtom_Append32(theBuffer, 1);							// first chunk
+		QTAtom_Append32(theBuffer, theFramesPerChunk);
+		QTAtom_Append32(theBuffer, 1);							// sample description index
+	}
+	if (myLastFrames != 0) {
+		QTAtom_Append32(theBuffer, (UInt32)myFullChunks + 1);
+		QTAtom_Append32(theBuffer, myLastFrames);
+		QTAtom_Append32(theBuffer, 1);
+	}
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	myAtom = QTAtom_BeginFullAtom(theBuffer, myUse64 ? kAtomTypeChunkOffset64 : kAtomTypeChunkOffset, 0, 0);
+	QTAtom_Append32(theBuffer, (UInt32)myChunkCount);
+	for (myIndex = 0; myIndex < myChunkCount; myIndex++) {
+		if (myUse64)
+			QTAtom_Append64(theBuffer, theFirstOffset + myIndex * myChunkBytes);
+		else
+			QTAtom_Append32(theBuffer, (UInt32)(theFirstOffset + myIndex * myChunkBytes));
+	}
+	QTAtom_EndAtom(theBuffer, myAtom);
+}
+
+
+//////////
+//
+// QTRef_GetMovieDuration
+// Convert a duration in some time scale into the movie's time scale, rounding up.
+//
+//////////
+
+static QTUInt64 QTRef_GetMovieDuration (QTUInt64 theDuration, UInt32 theTimeScale)
+{
+	return(((theDuration * kRefMovieTimeScale) + theTimeScale - 1) / theTimeScale);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Import functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTRef_WriteReferenceMovie
+// Write a reference movie at theOutPath that points into the source at theInPath.
+//
+// Returns unimpErr, having written nothing, if the source is of a kind we can't point into. To
+// estimate the time we saved, we use the estimator's history of theConversionOperation, whose work
+// is input bytes; pass 0 to skip the estimate.
+//
+//////////
+
+OSErr QTRef_WriteReferenceMovie (const char *theInPath, const char *theOutPath, OSType theConversionOperation, QTRefStatsPtr theStats)
+{
+	QTRefSourceRecord		mySource;
+	QTAtomBufferRecord		myMovie;
+	QTSysFile				myFile = kQTSysInvalidFile;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	QTUInt64				myConversionTime;
+	char					myURL[kQTSysMaxPath * 3];
+	double					myRate;
+	OSErr					myErr = noErr;
+
+	if ((theInPath == NULL) || (theOutPath == NULL) || (theStats == NULL))
+		return(paramErr);
+
+	memset(theStats, 0, sizeof(QTRefStatsRecord));
+	QTAtom_InitBuffer(&myMovie);
+
+	myErr = QTRef_ReadSource(theInPath, &mySource);
+	if (myErr == noErr)
+		myErr = QTRef_MakeFileURL(theInPath, myURL, sizeof(myURL));
+	if (myErr == noErr)
+		myErr = QTRef_BuildMovie(&mySource, myURL, &myMovie);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTSys_OpenFile(theOutPath, kQTSysOpenWrite, &myFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTSys_WriteFile(myFile, myMovie.fData, myMovie.fSize);
+	QTSys_CloseFile(myFile);
+	if (myErr != noErr) {
+		QTSys_DeletePath(theOutPath);
+		goto bail;
+	}
+
+	theStats->fSourceBytes = mySource.fFileSize;
+	theStats->fBytesWritten = myMovie.fSize;
+	theStats->fBytesSaved = mySource.fDataSize;
+	theStats->fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+
+	if ((theConversionOperation != 0) && QTEst_GetHistoryRate(theConversionOperation, &myRate)) {
+		myConversionTime = (QTUInt64)(1000000.0 * (double)mySource.fFileSize / myRate);
+		theStats->fMicrosecondsSaved = (myConversionTime > theStats->fMicroseconds) ? myConversionTime - theStats->fMicroseconds : 0;
+		theStats->fHasEstimate = true;
+	}
+
+bail:
+	QTAtom_DisposeBuffer(&myMovie);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRef_WriteStats
+// Write the numbers of a reference import into a line of JSON; the caller writes the rest of the line.
+//
+//////////
+
+void QTRef_WriteStats (FILE *theStream, QTRefStatsPtr theStats)
+{
+	fprintf(theStream, "\"sourceBytes\":%llu,\"bytesWritten\":%llu,\"bytesSaved\":%llu,\"wallMicroseconds\":%llu,\"microsecondsSaved\":",
+				(unsigned long long)theStats->fSourceBytes,
+				(unsigned long long)theStats->fBytesWritten,
+				(unsigned long long)theStats->fBytesSaved,
+				(unsigned long long)theStats->fMicroseconds);
+
+	if (theStats->fHasEstimate)
+		fprintf(theStream, "%llu", (unsigned long long)theStats->fMicrosecondsSaved);
+	else
+		fputs("null", theStream);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTRef_IsReferenceCommandLine
+// Does the specified command line ask for reference mode?
+//
+//////////
+
+Boolean QTRef_IsReferenceCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kRefSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTRef_Main
+// Run reference mode. Returns one of the kRefExit constants.
+//
+// Usage: -reference <source> [-out <movie>] [-report <file>]
+//
+// The reference movie defaults to the source's name with a ".mov" extension, next to it. Time saved
+// is estimated from the history of theConversionOperation, which the caller should have read. We don't
+// add to that history: writing a reference movie is no measure of how fast a full conversion runs, so
+// there's no estimate until the caller's full conversions have recorded some rates.
+//
+//////////
+
+int QTRef_Main (int theArgc, char *theArgv[], OSType theConversionOperation)
+{
+	QTRefStatsRecord		myStats;
+	const char				*myInPath = NULL;
+	const char				*myOutPath = NULL;
+	const char				*myReportPath = NULL;
+	FILE					*myReport = stdout;
+	char					myPath[kQTSysMaxPath];
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kRefSwitch) == 0) && (myIndex + 1 < theArgc))
+			myInPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kRefOutSwitch) == 0) && (myIndex + 1 < theArgc))
+			myOutPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kRefReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if (myInPath == NULL) {
+		fprintf(stderr, "usage: %s %s <source> [%s <movie>] [%s <file>]\n", theArgv[0], kRefSwitch, kRefOutSwitch, kRefReportSwitch);
+		return(kRefExitUsage);
+	}
+
+	if (myOutPath == NULL) {
+		if (QTSys_ReplaceExtension(myPath, sizeof(myPath), myInPath, kRefMovieExtension) != noErr) {
+			fprintf(stderr, "cannot name the reference movie; use %s\n", kRefOutSwitch);
+			return(kRefExitUsage);
+		}
+
+		myOutPath = myPath;
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kRefExitUsage);
+		}
+	}
+
+	myErr = QTRef_WriteReferenceMovie(myInPath, myOutPath, theConversionOperation, &myStats);
+	if (myErr == unimpErr)
+		fprintf(stderr, "%s can't be imported by reference\n", myInPath);
+	else if (myErr != noErr)
+		fprintf(stderr, "cannot write %s (error %d)\n", myOutPath, (int)myErr);
+
+	fputs("{\"input\":", myReport);
+	QTSys_WriteJSONString(myReport, myInPath);
+	fputs(",\"output\":", myReport);
+	QTSys_WriteJSONString(myReport, myOutPath);
+	fprintf(myReport, ",\"err\":%d,", (int)myErr);
+	QTRef_WriteStats(myReport, &myStats);
+	fputs("}\n", myReport);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kRefExitSuccess : kRefExitFailed);
+}
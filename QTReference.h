@@ -0,0 +1,108 @@
+//////////
+//
+//	File:		QTReference.h
+//
+//	Contains:	Portable functions for importing sound and DV files as reference movies, without copying their media.
+//				All utilities start with the prefix "QTRef_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTReference__
+#define __QTReference__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTAtoms.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kRefSwitch							"-reference"			// command-line switch that selects reference mode
+#define kRefOutSwitch						"-out"					// the reference movie to write
+#define kRefReportSwitch					"-report"				// write the report to a file instead of stdout
+#define kRefMovieExtension					"mov"					// extension given to reference movies by default
+
+#define kRefHeaderSize						4096					// bytes we read from the start of a source to find its layout
+#define kRefChunkBytes						(256L * 1024L)			// we divide sound into chunks of about this size
+#define kRefDVChunkFrames					30						// and DV into chunks of this many frames
+#define kRefDVBlockSize						80						// bytes in a DIF block
+#define kRefDVFrameSizeNTSC					120000					// 10 DIF sequences of 150 blocks
+#define kRefDVFrameSizePAL					144000					// 12 DIF sequences
+#define kRefMovieTimeScale					600
+
+// kinds of source we can point into
+enum {
+	kRefKindNone							= 0,
+	kRefKindWAVE							= 1,
+	kRefKindAIFF							= 2,
+	kRefKindDV								= 3
+};
+
+// exit codes returned by QTRef_Main
+enum {
+	kRefExitSuccess							= 0,
+	kRefExitFailed							= 1,
+	kRefExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// where the media of a source file is, and what it is
+typedef struct QTRefSourceRecord {
+	long					fKind;					// one of the kRefKind constants
+	QTUInt64				fFileSize;
+	QTUInt64				fDataOffset;			// of the first sound frame or DV frame
+	QTUInt64				fDataSize;				// of the whole frames that follow it
+	QTUInt64				fFrameCount;
+	UInt32					fBytesPerFrame;
+	OSType					fFormat;				// the sound or video sample description format
+	UInt32					fSampleRate;			// of the sound, in the source or in the DV frames; 0 if none
+	UInt16					fChannelCount;
+	UInt16					fBitsPerSample;
+	Boolean					fLittleEndian;			// for sound formats whose byte order isn't implied by their format
+	Boolean					fIsPAL;					// for DV: 625 lines at 25 frames a second, rather than 525 at 29.97
+} QTRefSourceRecord, *QTRefSourcePtr;
+
+// what QTRef_WriteReferenceMovie did, and what it spared us
+typedef struct QTRefStatsRecord {
+	QTUInt64				fSourceBytes;
+	QTUInt64				fBytesWritten;			// the size of the reference movie
+	QTUInt64				fBytesSaved;			// the media a full conversion would have copied
+	QTUInt64				fMicroseconds;
+	QTUInt64				fMicrosecondsSaved;		// valid only if fHasEstimate is true
+	Boolean					fHasEstimate;			// do we know how long a full conversion would have taken?
+} QTRefStatsRecord, *QTRefStatsPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTRef_ReadSource (const char *thePath, QTRefSourcePtr theSource);
+OSErr						QTRef_MakeFileURL (const char *thePath, char *theBuffer, size_t theBufferSize);
+OSErr						QTRef_BuildMovie (QTRefSourcePtr theSource, const char *theURL, QTAtomBufferPtr theBuffer);
+OSErr						QTRef_WriteReferenceMovie (const char *theInPath, const char *theOutPath, OSType theConversionOperation, QTRefStatsPtr theStats);
+void						QTRef_WriteStats (FILE *theStream, QTRefStatsPtr theStats);
+
+Boolean						QTRef_IsReferenceCommandLine (int theArgc, char *theArgv[]);
+int							QTRef_Main (int theArgc, char *theArgv[], OSType theConversionOperation);
+
+#endif	// __QTReference__
@@ -0,0 +1,1358 @@
+//////////
+//
+//	File:		QTRemux.c
+//
+//	Contains:	A portable engine that copies the samples of QuickTime and MPEG-4 files into a new file without re-encoding them.
+//				All utilities start with the prefix "QTRemux_".
+//
+//	QTDX_ExportMovieAsAnyTypeFile always goes through a movie export component, which decodes every
+//	frame and encodes it again, even when all we want is the same samples in a different container or
+//	in a single self-contained file. QTRemux_RemuxFile does that job from the sample tables instead:
+//
+//	  * Every chunk of every track is copied, byte for byte, into one new 'mdat' atom. The chunks keep
+//	    the order they had in the input file, so the tracks stay interleaved as they were, and chunks that
+//	    were next to each other in the input are copied with a single read. Nothing is decoded, so the
+//	    copy goes as fast as the disk does.
+//
+//	  * The new movie atom is the old one with each track's chunk offset table ('stco' or 'co64')
+//	    rewritten to point into the new 'mdat' atom; 'co64' is used only for a track that needs it. Every
+//	    other atom, including the sample descriptions and the other sample tables, is copied as it is.
+//
+//	  * The output file is [ftyp] mdat moov, or with kRemuxFastStart [ftyp] moov mdat, so that a player
+//	    can start before it has the whole file. Then the chunk offsets depend on the size of the movie
+//	    atom, so we build it until its size settles and know the whole layout before we write a byte;
+//	    the file is written in one sequential pass, kRemuxWriteBufferSize bytes at a time. If the output's
+//	    extension asks for a different container (an .mp4 from a QuickTime movie, or a .mov from an MPEG-4
+//	    file), we write a suitable 'ftyp' atom; otherwise we copy the input's, if it has one.
+//
+//	Movies whose samples live in other files (reference movies) can't be remuxed this way, and fail
+//	with couldNotResolveDataRef. QTRemux_VerifyFile reads every sample of both files and compares them.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTRemux.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kRemuxSelfContainedFlag		0x00000001				// in a data reference: the data is in this file
+#define kRemuxMaxLayoutPasses		8						// the movie atom's size settles long before this
+
+#define kRemuxMP4Extensions			"mp4 m4v m4a"			// extensions that ask for an MPEG-4 file
+#define kRemuxQuickTimeExtensions	"mov qt"				// and for a QuickTime movie
+
+// the benchmark's synthetic movie: a frame of video, then a chunk of sound, 30 times a second
+#define kRemuxBenchVideoSampleSize	(256L * 1024L)
+#define kRemuxBenchSoundSampleSize	1024L
+#define kRemuxBenchSoundPerChunk	4
+#define kRemuxBenchInFileName		"QTRemuxBench.mov"
+#define kRemuxBenchOutFileName		"QTRemuxBench-out.mov"
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// one chunk of one track, in the input file
+typedef struct QTRemuxChunkRecord {
+	QTUInt64				fOffset;
+	QTUInt64				fSize;
+	UInt32					fTrackIndex;
+	UInt32					fChunkIndex;			// 0-based
+} QTRemuxChunkRecord, *QTRemuxChunkPtr;
+
+// one track, and where its chunks go in the output file
+typedef struct QTRemuxTrackRecord {
+	QTStblTrackPtr			fTrack;
+	QTUInt64				*fNewOffsets;
+	Boolean					fUse64;					// write a 'co64' atom
+} QTRemuxTrackRecord, *QTRemuxTrackPtr;
+
+// the output file; all writes go through fBuffer
+typedef struct QTRemuxWriterRecord {
+	QTSysFile				fFile;
+	UInt8					*fBuffer;				// kRemuxWriteBufferSize bytes
+	UInt32					fFill;					// bytes in fBuffer not yet written
+	QTUInt64				fWriteCount;
+} QTRemuxWriterRecord, *QTRemuxWriterPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTRemux_CheckDataReferences (QTAtomReaderPtr theReader, QTStblTrackPtr theTrack);
+static OSErr				QTRemux_GetChunkSizes (QTStblTrackPtr theTrack, QTUInt64 *theSizes);
+static int					QTRemux_CompareChunks (const void *theChunk1, const void *theChunk2);
+static Boolean				QTRemux_HasExtension (const char *thePath, const char *theExtensions);
+static void					QTRemux_AppendFileType (QTAtomBufferPtr theBuffer, QTAtomReaderPtr theReader, QTStblMoviePtr theMovie, const char *theOutPath);
+static OSErr				QTRemux_BuildMovieAtom (QTAtomReaderPtr theReader, QTStblMoviePtr theMovie, QTRemuxTrackPtr theTracks, QTAtomBufferPtr theBuffer);
+static OSErr				QTRemux_AppendAtom (QTAtomBufferPtr theBuffer, QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, QTRemuxTrackPtr theTrack);
+static void					QTRemux_AppendChunkOffsets (QTAtomBufferPtr theBuffer, QTRemuxTrackPtr theTrack);
+static OSErr				QTRemux_WriteBytes (QTRemuxWriterPtr theWriter, const void *theData, UInt32 theLength);
+static OSErr				QTRemux_WriteAtomHeader (QTRemuxWriterPtr theWriter, OSType theType, QTUInt64 theSize, UInt32 theHeaderSize);
+static OSErr				QTRemux_CopyRange (QTAtomReaderPtr theReader, QTRemuxWriterPtr theWriter, QTUInt64 theOffset, QTUInt64 theLength);
+static OSErr				QTRemux_FlushWriter (QTRemuxWriterPtr theWriter);
+static OSErr				QTRemux_GrowBuffer (UInt8 **theBuffer, UInt32 *theCapacity, UInt32 theSize);
+static OSErr				QTRemux_WriteBenchmarkMovie (const char *thePath, long theGigabytes, QTUInt64 *theBytesWritten);
+static void					QTRemux_AppendBenchmarkTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, OSType theHandlerType, UInt32 theTimeScale, UInt32 theSampleCount, UInt32 theSampleDuration, UInt32 theSampleSize, UInt32 theSamplesPerChunk, QTUInt64 theFirstOffset, QTUInt64 theChunkStride);
+static void					QTRemux_WriteBenchmarkResult (FILE *theReport, const char *theMethod, long theGigabytes, OSErr theErr, QTUInt64 theBytes, QTUInt64 theMicroseconds);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Remux functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTRemux_RemuxFile
+// Copy the samples of the movie at theInPath into a new file at theOutPath, without decoding them.
+//
+// theFlags is 0 or kRemuxFastStart. If theMovieAtom isn't NULL, it receives the new movie atom, which
+// the caller disposes of with QTAtom_DisposeBuffer; theStats, which may be NULL, is filled in with what
+// we did.
+//
+//////////
+
+OSErr QTRemux_RemuxFile (const char *theInPath, const char *theOutPath, long theFlags, QTAtomBufferPtr theMovieAtom, QTRemuxStatsPtr theStats)
+{
+	QTAtomReaderRecord		myReader = {NULL, NULL, 0};
+	QTStblMovieRecord		myMovie;
+	QTRemuxTrackPtr			myTracks = NULL;
+	QTRemuxChunkPtr			myChunks = NULL;
+	QTUInt64				*mySizes = NULL;
+	QTAtomBufferRecord		myFileType;
+	QTAtomBufferRecord		myMovieAtom;
+	QTRemuxWriterRecord		myWriter = {kQTSysInvalidFile, NULL, 0, 0};
+	QTRemuxStatsRecord		myStats;
+	Boolean					myFastStart = ((theFlags & kRemuxFastStart) != 0);
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	QTUInt64				myChunkCount = 0;
+	QTUInt64				myOffset;
+	QTUInt64				myRangeStart;
+	QTUInt64				myRangeEnd;
+	UInt32					myDataHeaderSize = kAtomHeaderSize;
+	UInt32					myMovieSize = 0;
+	long					myTrackIndex;
+	long					myIndex;
+	QTUInt64				myChunk;
+	OSErr					myErr = noErr;
+
+	memset(&myMovie, 0, sizeof(myMovie));
+	memset(&myStats, 0, sizeof(myStats));
+	QTAtom_InitBuffer(&myFileType);
+	QTAtom_InitBuffer(&myMovieAtom);
+
+	if ((theInPath == NULL) || (theOutPath == NULL))
+		return(paramErr);
+
+	if (strcmp(theInPath, theOutPath) == 0)
+		return(dupFNErr);
+
+	myErr = QTAtom_OpenFileReader(theInPath, &myReader);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTStbl_ReadMovie(&myReader, &myMovie);
+	if (myErr != noErr)
+		goto bail;
+
+	myTracks = (QTRemuxTrackPtr)calloc((size_t)myMovie.fTrackCount + 1, sizeof(QTRemuxTrackRecord));
+	myWriter.fBuffer = (UInt8 *)malloc(kRemuxWriteBufferSize);
+	if ((myTracks == NULL) || (myWriter.fBuffer == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	for (myTrackIndex = 0; myTrackIndex < myMovie.fTrackCount; myTrackIndex++) {
+		QTStblTrackPtr		myTrack = &myMovie.fTracks[myTrackIndex];
+
+		myErr = QTRemux_CheckDataReferences(&myReader, myTrack);
+		if (myErr != noErr)
+			goto bail;
+
+		myTracks[myTrackIndex].fTrack = myTrack;
+		myTracks[myTrackIndex].fNewOffsets = (QTUInt64 *)calloc((size_t)myTrack->fChunkCount + 1, sizeof(QTUInt64));
+		if (myTracks[myTrackIndex].fNewOffsets == NULL) {
+			myErr = memFullErr;
+			goto bail;
+		}
+
+		myChunkCount += myTrack->fChunkCount;
+	}
+
+	// list every chunk of every track, in the order they appear in the input file
+	myChunks = (QTRemuxChunkPtr)malloc((size_t)(myChunkCount + 1) * sizeof(QTRemuxChunkRecord));
+	if (myChunks == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myChunk = 0;
+	for (myTrackIndex = 0; myTrackIndex < myMovie.fTrackCount; myTrackIndex++) {
+		QTStblTrackPtr		myTrack = &myMovie.fTracks[myTrackIndex];
+
+		free(mySizes);
+		mySizes = (QTUInt64 *)calloc((size_t)myTrack->fChunkCount + 1, sizeof(QTUInt64));
+		if (mySizes == NULL) {
+			myErr = memFullErr;
+			goto bail;
+		}
+
+		myErr = QTRemux_GetChunkSizes(myTrack, mySizes);
+		if (myErr != noErr)
+			goto bail;
+
+		for (myIndex = 0; myIndex < (long)myTrack->fChunkCount; myIndex++) {
+			QTRemuxChunkPtr		myRecord = &myChunks[myChunk++];
+
+			myRecord->fOffset = myTrack->fChunkOffsets[myIndex];
+			myRecord->fSize = mySizes[myIndex];
+			myRecord->fTrackIndex = (UInt32)myTrackIndex;
+			myRecord->fChunkIndex = (UInt32)myIndex;
+
+			// a chunk that runs past the end of the file means the file is truncated
+			if ((myRecord->fOffset > myReader.fSize) || (myRecord->fSize > myReader.fSize - myRecord->fOffset)) {
+				myErr = invalidMovie;
+				goto bail;
+			}
+
+			myStats.fDataBytes += myRecord->fSize;
+		}
+	}
+
+	qsort(myChunks, (size_t)myChunkCount, sizeof(QTRemuxChunkRecord), QTRemux_CompareChunks);
+
+	QTRemux_AppendFileType(&myFileType, &myReader, &myMovie, theOutPath);
+	if (myFileType.fErr != noErr) {
+		myErr = myFileType.fErr;
+		goto bail;
+	}
+
+	if (kAtomHeaderSize + myStats.fDataBytes > 0xFFFFFFFFUL)
+		myDataHeaderSize = kAtomExtendedHeaderSize;
+
+	// lay out the output file; with the movie atom first, the chunk offsets depend on its size, which
+	// depends on whether each track needs 'co64', which depends on the offsets; but a track only ever
+	// goes from 'stco' to 'co64', so the size soon stops changing
+	for (;;) {
+		myStats.fLayoutPasses++;
+
+		myOffset = myFileType.fSize + (myFastStart ? myMovieSize : 0) + myDataHeaderSize;
+		for (myChunk = 0; myChunk < myChunkCount; myChunk++) {
+			QTRemuxTrackPtr		myTrack = &myTracks[myChunks[myChunk].fTrackIndex];
+
+			myTrack->fNewOffsets[myChunks[myChunk].fChunkIndex] = myOffset;
+			if (myOffset > 0xFFFFFFFFUL)
+				myTrack->fUse64 = true;
+
+			myOffset += myChunks[myChunk].fSize;
+		}
+
+		QTAtom_DisposeBuffer(&myMovieAtom);
+		QTAtom_InitBuffer(&myMovieAtom);
+
+		myErr = QTRemux_BuildMovieAtom(&myReader, &myMovie, myTracks, &myMovieAtom);
+		if (myErr != noErr)
+			goto bail;
+
+		if (!myFastStart || (myMovieAtom.fSize == myMovieSize))
+			break;
+
+		if (myStats.fLayoutPasses == kRemuxMaxLayoutPasses) {
+			myErr = invalidMovie;
+			goto bail;
+		}
+
+		myMovieSize = myMovieAtom.fSize;
+	}
+
+	// write it all out in one pass; the chunks are copied in file order, and adjacent ones with one read
+	myErr = QTSys_OpenFile(theOutPath, kQTSysOpenWrite, &myWriter.fFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTRemux_WriteBytes(&myWriter, myFileType.fData, myFileType.fSize);
+	if ((myErr == noErr) && myFastStart)
+		myErr = QTRemux_WriteBytes(&myWriter, myMovieAtom.fData, myMovieAtom.fSize);
+	if (myErr == noErr)
+		myErr = QTRemux_WriteAtomHeader(&myWriter, kAtomTypeMovieData, myDataHeaderSize + myStats.fDataBytes, myDataHeaderSize);
+	if (myErr != noErr)
+		goto bail;
+
+	myRangeStart = myRangeEnd = (myChunkCount > 0) ? myChunks[0].fOffset : 0;
+	for (myChunk = 0; myChunk < myChunkCount; myChunk++) {
+		if (myChunks[myChunk].fOffset != myRangeEnd) {
+			myErr = QTRemux_CopyRange(&myReader, &myWriter, myRangeStart, myRangeEnd - myRangeStart);
+			if (myErr != noErr)
+				goto bail;
+
+			myStats.fRangeCount++;
+			myRangeStart = myRangeEnd = myChunks[myChunk].fOffset;
+		}
+
+		myRangeEnd += myChunks[myChunk].fSize;
+	}
+
+	if (myRangeEnd > myRangeStart) {
+		myErr = QTRemux_CopyRange(&myReader, &myWriter, myRangeStart, myRangeEnd - myRangeStart);
+		if (myErr != noErr)
+			goto bail;
+
+		myStats.fRangeCount++;
+	}
+
+	if (!myFastStart)
+		myErr = QTRemux_WriteBytes(&myWriter, myMovieAtom.fData, myMovieAtom.fSize);
+	if (myErr == noErr)
+		myErr = QTRemux_FlushWriter(&myWriter);
+	if (myErr != noErr)
+		goto bail;
+
+	myStats.fTrackCount = myMovie.fTrackCount;
+	myStats.fChunkCount = myChunkCount;
+	myStats.fMovieBytes = myMovieAtom.fSize;
+	myStats.fOutputBytes = myFileType.fSize + myDataHeaderSize + myStats.fDataBytes + myMovieAtom.fSize;
+
+	// hand over the movie atom
+	if (theMovieAtom != NULL) {
+		*theMovieAtom = myMovieAtom;
+		QTAtom_InitBuffer(&myMovieAtom);
+	}
+
+bail:
+	if (myWriter.fFile != kQTSysInvalidFile) {
+		QTSys_CloseFile(myWriter.fFile);
+		if (myErr != noErr)
+			QTSys_DeletePath(theOutPath);
+	}
+
+	if (myTracks != NULL)
+		for (myTrackIndex = 0; myTrackIndex < myMovie.fTrackCount; myTrackIndex++)
+			free(myTracks[myTrackIndex].fNewOffsets);
+
+	QTAtom_DisposeBuffer(&myMovieAtom);
+	QTAtom_DisposeBuffer(&myFileType);
+	QTStbl_DisposeMovie(&myMovie);
+	QTAtom_CloseFileReader(&myReader);
+
+	free(myWriter.fBuffer);
+	free(mySizes);
+	free(myChunks);
+	free(myTracks);
+
+	myStats.fWriteCount = myWriter.fWriteCount;
+	myStats.fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+	if (theStats != NULL)
+		*theStats = myStats;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_VerifyFile
+// Check that every sample of every track of the movie at theOutPath is the same as in the movie at theInPath.
+//
+// Returns ioErr if they differ, and theResult says where; theResult may be NULL.
+//
+//////////
+
+OSErr QTRemux_VerifyFile (const char *theInPath, const char *theOutPath, QTRemuxVerifyPtr theResult)
+{
+	QTAtomReaderRecord		myInReader = {NULL, NULL, 0};
+	QTAtomReaderRecord		myOutReader = {NULL, NULL, 0};
+	QTStblMovieRecord		myInMovie;
+	QTStblMovieRecord		myOutMovie;
+	QTRemuxVerifyRecord		myResult;
+	QTStblIteratorRecord	myInIterator;
+	QTStblIteratorRecord	myOutIterator;
+	QTStblSampleRecord		myInSample;
+	QTStblSampleRecord		myOutSample;
+	UInt8					*myInData = NULL;
+	UInt8					*myOutData = NULL;
+	UInt32					myInCapacity = 0;
+	UInt32					myOutCapacity = 0;
+	long					myTrackIndex;
+	OSErr					myErr = noErr;
+
+	memset(&myInMovie, 0, sizeof(myInMovie));
+	memset(&myOutMovie, 0, sizeof(myOutMovie));
+	memset(&myResult, 0, sizeof(myResult));
+
+	myErr = QTAtom_OpenFileReader(theInPath, &myInReader);
+	if (myErr == noErr)
+		myErr = QTAtom_OpenFileReader(theOutPath, &myOutReader);
+	if (myErr == noErr)
+		myErr = QTStbl_ReadMovie(&myInReader, &myInMovie);
+	if (myErr == noErr)
+		myErr = QTStbl_ReadMovie(&myOutReader, &myOutMovie);
+	if (myErr != noErr)
+		goto bail;
+
+	if (myInMovie.fTrackCount != myOutMovie.fTrackCount) {
+		myErr = ioErr;
+		goto bail;
+	}
+
+	for (myTrackIndex = 0; (myTrackIndex < myInMovie.fTrackCount) && (myErr == noErr); myTrackIndex++) {
+		QTStblTrackPtr		myInTrack = &myInMovie.fTracks[myTrackIndex];
+		QTStblTrackPtr		myOutTrack = &myOutMovie.fTracks[myTrackIndex];
+
+		if ((myInTrack->fTrackID != myOutTrack->fTrackID) || (myInTrack->fSampleCount != myOutTrack->fSampleCount)) {
+			myResult.fTrackID = myInTrack->fTrackID;
+			myErr = ioErr;
+			break;
+		}
+
+		QTStbl_InitIterator(myInTrack, &myInIterator);
+		QTStbl_InitIterator(myOutTrack, &myOutIterator);
+
+		while (QTStbl_NextSample(&myInIterator, &myInSample) && QTStbl_NextSample(&myOutIterator, &myOutSample)) {
+			myErr = QTRemux_GrowBuffer(&myInData, &myInCapacity, myInSample.fSize);
+			if (myErr == noErr)
+				myErr = QTRemux_GrowBuffer(&myOutData, &myOutCapacity, myOutSample.fSize);
+			if (myErr != noErr)
+				break;
+
+			if ((myInSample.fSize != myOutSample.fSize) || (myInSample.fTime != myOutSample.fTime) || (myInSample.fDuration != myOutSample.fDuration)) {
+				myErr = ioErr;
+			} else if (myInSample.fSize > 0) {
+				myErr = myInReader.fRead(myInReader.fRefCon, myInSample.fOffset, myInData, myInSample.fSize);
+				if (myErr == noErr)
+					myErr = myOutReader.fRead(myOutReader.fRefCon, myOutSample.fOffset, myOutData, myOutSample.fSize);
+				if ((myErr == noErr) && (memcmp(myInData, myOutData, myInSample.fSize) != 0))
+					myErr = ioErr;
+			}
+
+			if (myErr != noErr) {
+				myResult.fTrackID = myInTrack->fTrackID;
+				myResult.fSampleNumber = myInSample.fNumber;
+				break;
+			}
+
+			myResult.fSampleCount++;
+		}
+	}
+
+bail:
+	QTStbl_DisposeMovie(&myOutMovie);
+	QTStbl_DisposeMovie(&myInMovie);
+	QTAtom_CloseFileReader(&myOutReader);
+	QTAtom_CloseFileReader(&myInReader);
+
+	free(myOutData);
+	free(myInData);
+
+	if (theResult != NULL)
+		*theResult = myResult;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_CheckDataReferences
+// Make sure that every data reference of the track is to the file itself.
+//
+// A track with no data information atom at all is taken to be self-contained, as QuickTime takes it.
+//
+//////////
+
+static OSErr QTRemux_CheckDataReferences (QTAtomReaderPtr theReader, QTStblTrackPtr theTrack)
+{
+	static const OSType		kDataRefPath[] = {kAtomTypeMedia, kAtomTypeMediaInfo, kAtomTypeDataInfo, kAtomTypeDataRef};
+	QTAtomHeaderRecord		myAtom;
+	UInt8					*myData = NULL;
+	UInt32					mySize = 0;
+	UInt32					myCount;
+	UInt32					myOffset = 8;
+	OSErr					myErr = noErr;
+
+	if (QTAtom_FindPath(theReader, &theTrack->fTrackAtom, kDataRefPath, 4, &myAtom) != noErr)
+		return(noErr);
+
+	myErr = QTAtom_ReadPayload(theReader, &myAtom, &myData, &mySize);
+	if (myErr != noErr)
+		return(myErr);
+
+	// version and flags, entry count, then entries of size, type, version and flags, and data
+	myCount = (mySize >= 8) ? QTAtom_GetBE32(myData + 4) : 0;
+	for (; myCount > 0; myCount--) {
+		UInt32		myEntrySize;
+
+		if (mySize - myOffset < 12) {
+			myErr = invalidAtomErr;
+			break;
+		}
+
+		myEntrySize = QTAtom_GetBE32(myData + myOffset);
+		if ((QTAtom_GetBE32(myData + myOffset + 8) & kRemuxSelfContainedFlag) == 0) {
+			myErr = couldNotResolveDataRef;
+			break;
+		}
+
+		if ((myEntrySize < 12) || (myEntrySize > mySize - myOffset)) {
+			myErr = invalidAtomErr;
+			break;
+		}
+
+		myOffset += myEntrySize;
+	}
+
+	free(myData);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_GetChunkSizes
+// Add up the sizes of the samples in each chunk of the track.
+//
+//////////
+
+static OSErr QTRemux_GetChunkSizes (QTStblTrackPtr theTrack, QTUInt64 *theSizes)
+{
+	QTStblIteratorRecord	myIterator;
+	QTStblSampleRecord		mySample;
+	UInt32					myCount = 0;
+
+	QTStbl_InitIterator(theTrack, &myIterator);
+	while (QTStbl_NextSample(&myIterator, &mySample)) {
+		if ((mySample.fChunk == 0) || (mySample.fChunk > theTrack->fChunkCount))
+			return(invalidAtomErr);
+
+		theSizes[mySample.fChunk - 1] += mySample.fSize;
+		myCount++;
+	}
+
+	// the sample-to-chunk table must place every sample in a chunk
+	return((myCount == theTrack->fSampleCount) ? noErr : invalidAtomErr);
+}
+
+
+//////////
+//
+// QTRemux_CompareChunks
+// Order chunks by their offset in the input file; qsort comparison function.
+//
+//////////
+
+static int QTRemux_CompareChunks (const void *theChunk1, const void *theChunk2)
+{
+	const QTRemuxChunkRecord	*myChunk1 = (const QTRemuxChunkRecord *)theChunk1;
+	const QTRemuxChunkRecord	*myChunk2 = (const QTRemuxChunkRecord *)theChunk2;
+
+	if (myChunk1->fOffset != myChunk2->fOffset)
+		return((myChunk1->fOffset < myChunk2->fOffset) ? -1 : 1);
+
+	if (myChunk1->fTrackIndex != myChunk2->fTrackIndex)
+		return((myChunk1->fTrackIndex < myChunk2->fTrackIndex) ? -1 : 1);
+
+	return((myChunk1->fChunkIndex < myChunk2->fChunkIndex) ? -1 : (myChunk1->fChunkIndex > myChunk2->fChunkIndex));
+}
+
+
+//////////
+//
+// QTRemux_HasExtension
+// Is the extension of thePath one of the space-separated theExtensions (ignoring case)?
+//
+//////////
+
+static Boolean QTRemux_HasExtension (const char *thePath, const char *theExtensions)
+{
+	const char		*myExtension = QTSys_GetFileExtension(thePath);
+	char			myList[64];
+	char			*myWord;
+
+	if (*myExtension == '\0')
+		return(false);
+
+	QTSys_FormatString(myList, sizeof(myList), "%s", theExtensions);
+	for (myWord = strtok(myList, " "); myWord != NULL; myWord = strtok(NULL, " "))
+		if (QTSys_CompareStringsNoCase(myExtension, myWord) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTRemux_AppendFileType
+// Append the output file's 'ftyp' atom, if it should have one.
+//
+//////////
+
+static void QTRemux_AppendFileType (QTAtomBufferPtr theBuffer, QTAtomReaderPtr theReader, QTStblMoviePtr theMovie, const char *theOutPath)
+{
+	QTAtomHeaderRecord		myAtom;
+	UInt32					myStart;
+
+	if (theMovie->fIsQuickTime && QTRemux_HasExtension(theOutPath, kRemuxMP4Extensions)) {
+		myStart = QTAtom_BeginAtom(theBuffer, kAtomTypeFileType);
+		QTAtom_Append32(theBuffer, kRemuxBrandISO);
+		QTAtom_Append32(theBuffer, 0x00000200);
+		QTAtom_Append32(theBuffer, kRemuxBrandISO);
+		QTAtom_Append32(theBuffer, kRemuxBrandMP42);
+		QTAtom_EndAtom(theBuffer, myStart);
+	} else if (!theMovie->fIsQuickTime && QTRemux_HasExtension(theOutPath, kRemuxQuickTimeExtensions)) {
+		myStart = QTAtom_BeginAtom(theBuffer, kAtomTypeFileType);
+		QTAtom_Append32(theBuffer, kAtomBrandQuickTime);
+		QTAtom_Append32(theBuffer, kRemuxQuickTimeVersion);
+		QTAtom_Append32(theBuffer, kAtomBrandQuickTime);
+		QTAtom_EndAtom(theBuffer, myStart);
+	} else if (QTAtom_FindTopLevel(theReader, kAtomTypeFileType, &myAtom) == noErr) {
+		theBuffer->fErr = QTAtom_AppendAtomFrom(theBuffer, theReader, &myAtom);
+	}
+}
+
+
+//////////
+//
+// QTRemux_BuildMovieAtom
+// Build the new movie atom: the input's, with each track's chunk offsets replaced by its fNewOffsets.
+//
+//////////
+
+static OSErr QTRemux_BuildMovieAtom (QTAtomReaderPtr theReader, QTStblMoviePtr theMovie, QTRemuxTrackPtr theTracks, QTAtomBufferPtr theBuffer)
+{
+	QTAtomHeaderRecord		myAtom;
+	QTUInt64				myOffset = theMovie->fMovieAtom.fOffset + theMovie->fMovieAtom.fHeaderSize;
+	QTUInt64				myEnd = theMovie->fMovieAtom.fOffset + theMovie->fMovieAtom.fSize;
+	UInt32					myStart;
+	long					myTrackIndex = 0;
+	OSErr					myErr = noErr;
+
+	myStart = QTAtom_BeginAtom(theBuffer, kAtomTypeMovie);
+
+	// QTStbl_ReadMovie read the tracks in the order we meet them here
+	while ((myEnd - myOffset >= kAtomHeaderSize) && (myErr == noErr)) {
+		myErr = QTAtom_ReadHeader(theReader, myOffset, myEnd, &myAtom);
+		if (myErr != noErr)
+			break;
+
+		myOffset += myAtom.fSize;
+
+		if ((myAtom.fType == kAtomTypeFree) || (myAtom.fType == kAtomTypeSkip))
+			continue;
+
+		if ((myAtom.fType == kAtomTypeTrack) && (myTrackIndex < theMovie->fTrackCount))
+			myErr = QTRemux_AppendAtom(theBuffer, theReader, &myAtom, &theTracks[myTrackIndex++]);
+		else
+			myErr = QTAtom_AppendAtomFrom(theBuffer, theReader, &myAtom);
+	}
+
+	QTAtom_EndAtom(theBuffer, myStart);
+
+	if ((myErr == noErr) && (theBuffer->fErr != noErr))
+		myErr = theBuffer->fErr;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_AppendAtom
+// Append a copy of an atom within a track, with the track's chunk offset table rewritten.
+//
+//////////
+
+static OSErr QTRemux_AppendAtom (QTAtomBufferPtr theBuffer, QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, QTRemuxTrackPtr theTrack)
+{
+	QTAtomHeaderRecord		myChild;
+	QTUInt64				myOffset;
+	QTUInt64				myEnd;
+	UInt32					myStart;
+	OSErr					myErr = noErr;
+
+	switch (theAtom->fType) {
+		case kAtomTypeChunkOffset:
+		case kAtomTypeChunkOffset64:
+			QTRemux_AppendChunkOffsets(theBuffer, theTrack);
+			return(theBuffer->fErr);
+
+		case kAtomTypeTrack:
+		case kAtomTypeMedia:
+		case kAtomTypeMediaInfo:
+		case kAtomTypeSampleTable:
+			break;
+
+		default:
+			return(QTAtom_AppendAtomFrom(theBuffer, theReader, theAtom));
+	}
+
+	// the atoms on the way down to the sample table are copied child by child
+	myOffset = theAtom->fOffset + theAtom->fHeaderSize;
+	myEnd = theAtom->fOffset + theAtom->fSize;
+	myStart = QTAtom_BeginAtom(theBuffer, theAtom->fType);
+
+	while ((myEnd - myOffset >= kAtomHeaderSize) && (myErr == noErr)) {
+		myErr = QTAtom_ReadHeader(theReader, myOffset, myEnd, &myChild);
+		if (myErr != noErr)
+			break;
+
+		myOffset += myChild.fSize;
+
+		if ((myChild.fType == kAtomTypeFree) || (myChild.fType == kAtomTypeSkip))
+			continue;
+
+		myErr = QTRemux_AppendAtom(theBuffer, theReader, &myChild, theTrack);
+	}
+
+	QTAtom_EndAtom(theBuffer, myStart);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_AppendChunkOffsets
+// Append a chunk offset table ('stco' or, if need be, 'co64') holding the track's new chunk offsets.
+//
+//////////
+
+static void QTRemux_AppendChunkOffsets (QTAtomBufferPtr theBuffer, QTRemuxTrackPtr theTrack)
+{
+	UInt32			myCount = theTrack->fTrack->fChunkCount;
+	UInt32			myStart;
+	UInt32			myIndex;
+
+	myStart = QTAtom_BeginFullAtom(theBuffer, theTrack->fUse64 ? kAtomTypeChunkOffset64 : kAtomTypeChunkOffset, 0, 0);
+	QTAtom_Append32(theBuffer, myCount);
+
+	for (myIndex = 0; myIndex < myCount; myIndex++) {
+		if (theTrack->fUse64)
+			QTAtom_Append64(theBuffer, theTrack->fNewOffsets[myIndex]);
+		else
+			QTAtom_Append32(theBuffer, (UInt32)theTrack->fNewOffsets[myIndex]);
+	}
+
+	QTAtom_EndAtom(theBuffer, myStart);
+}
+
+
+//////////
+//
+// QTRemux_WriteBytes
+// Write bytes to the output file.
+//
+//////////
+
+static OSErr QTRemux_WriteBytes (QTRemuxWriterPtr theWriter, const void *theData, UInt32 theLength)
+{
+	const UInt8		*myData = (const UInt8 *)theData;
+	OSErr			myErr = noErr;
+
+	while ((theLength > 0) && (myErr == noErr)) {
+		UInt32		myLength = kRemuxWriteBufferSize - theWriter->fFill;
+
+		if (myLength > theLength)
+			myLength = theLength;
+
+		memcpy(theWriter->fBuffer + theWriter->fFill, myData, myLength);
+		theWriter->fFill += myLength;
+		if (theWriter->fFill == kRemuxWriteBufferSize)
+			myErr = QTRemux_FlushWriter(theWriter);
+
+		myData += myLength;
+		theLength -= myLength;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_WriteAtomHeader
+// Write an atom header with an explicit size.
+//
+//////////
+
+static OSErr QTRemux_WriteAtomHeader (QTRemuxWriterPtr theWriter, OSType theType, QTUInt64 theSize, UInt32 theHeaderSize)
+{
+	UInt8			myBytes[kAtomExtendedHeaderSize];
+
+	if (theHeaderSize == kAtomExtendedHeaderSize) {
+		QTAtom_PutBE32(myBytes, 1);
+		QTAtom_PutBE32(myBytes + 4, theType);
+		QTAtom_PutBE64(myBytes + 8, theSize);
+	} else {
+		if (theSize > 0xFFFFFFFFUL)
+			return(unimpErr);
+
+		QTAtom_PutBE32(myBytes, (UInt32)theSize);
+		QTAtom_PutBE32(myBytes + 4, theType);
+	}
+
+	return(QTRemux_WriteBytes(theWriter, myBytes, theHeaderSize));
+}
+
+
+//////////
+//
+// QTRemux_CopyRange
+// Copy bytes from the reader to the output file.
+//
+// We read straight into the free part of the writer's buffer, so the data is never copied in memory.
+//
+//////////
+
+static OSErr QTRemux_CopyRange (QTAtomReaderPtr theReader, QTRemuxWriterPtr theWriter, QTUInt64 theOffset, QTUInt64 theLength)
+{
+	OSErr			myErr = noErr;
+
+	while ((theLength > 0) && (myErr == noErr)) {
+		UInt32		myLength = kRemuxWriteBufferSize - theWriter->fFill;
+
+		if (myLength > theLength)
+			myLength = (UInt32)theLength;
+
+		myErr = theReader->fRead(theReader->fRefCon, theOffset, theWriter->fBuffer + theWriter->fFill, myLength);
+		if (myErr != noErr)
+			break;
+
+		theWriter->fFill += myLength;
+		if (theWriter->fFill == kRemuxWriteBufferSize)
+			myErr = QTRemux_FlushWriter(theWriter);
+
+		theOffset += myLength;
+		theLength -= myLength;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_FlushWriter
+// Write whatever is in the writer's buffer.
+//
+// The buffer is written only when it's full, or at the end, so every write but the last is of the same
+// size and starts at a multiple of that size.
+//
+//////////
+
+static OSErr QTRemux_FlushWriter (QTRemuxWriterPtr theWriter)
+{
+	OSErr			myErr = noErr;
+
+	if (theWriter->fFill > 0) {
+		myErr = QTSys_WriteFile(theWriter->fFile, theWriter->fBuffer, theWriter->fFill);
+		theWriter->fFill = 0;
+		theWriter->fWriteCount++;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_GrowBuffer
+// Make sure a buffer can hold theSize bytes.
+//
+//////////
+
+static OSErr QTRemux_GrowBuffer (UInt8 **theBuffer, UInt32 *theCapacity, UInt32 theSize)
+{
+	UInt8			*myBuffer;
+
+	if (theSize <= *theCapacity)
+		return(noErr);
+
+	myBuffer = (UInt8 *)realloc(*theBuffer, theSize);
+	if (myBuffer == NULL)
+		return(memFullErr);
+
+	*theBuffer = myBuffer;
+	*theCapacity = theSize;
+	return(noErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTRemux_RunBenchmark
+// Time flattening a synthetic movie of theGigabytes gigabytes, and write a report to theReport.
+//
+// The movie, with its movie atom at the end, is written into theDirectory; we then time copying it with
+// QTSys_CopyFile, which is as fast as the disk can go, and remuxing it with the movie atom at the end and
+// at the start. The files are deleted afterwards. Unless the movie is bigger than memory, some of it is
+// still in the file cache when we read it back, so use a movie bigger than memory to time the disk.
+//
+//////////
+
+OSErr QTRemux_RunBenchmark (FILE *theReport, long theGigabytes, const char *theDirectory)
+{
+	QTRemuxStatsRecord		myStats;
+	char					myInPath[kQTSysMaxPath];
+	char					myOutPath[kQTSysMaxPath];
+	QTUInt64				myStartTime;
+	QTUInt64				myBytes = 0;
+	QTUInt64				myCopyTime = 0;
+	OSErr					myErr = noErr;
+
+	if (theGigabytes <= 0)
+		theGigabytes = kRemuxDefaultBenchmarkGigabytes;
+	if (theDirectory == NULL)
+		theDirectory = ".";
+
+	myErr = QTSys_MakePath(myInPath, sizeof(myInPath), theDirectory, kRemuxBenchInFileName);
+	if (myErr == noErr)
+		myErr = QTSys_MakePath(myOutPath, sizeof(myOutPath), theDirectory, kRemuxBenchOutFileName);
+	if (myErr != noErr)
+		return(myErr);
+
+	myStartTime = QTSys_GetMicroseconds();
+	myErr = QTRemux_WriteBenchmarkMovie(myInPath, theGigabytes, &myBytes);
+	QTRemux_WriteBenchmarkResult(theReport, "write", theGigabytes, myErr, myBytes, QTSys_GetMicroseconds() - myStartTime);
+	if (myErr != noErr)
+		goto bail;
+
+	myStartTime = QTSys_GetMicroseconds();
+	myErr = QTSys_CopyFile(myInPath, myOutPath, &myBytes);
+	myCopyTime = QTSys_GetMicroseconds() - myStartTime;
+	QTRemux_WriteBenchmarkResult(theReport, "copy", theGigabytes, myErr, myBytes, myCopyTime);
+	QTSys_DeletePath(myOutPath);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTRemux_RemuxFile(myInPath, myOutPath, 0, NULL, &myStats);
+	QTRemux_WriteBenchmarkResult(theReport, "remux", theGigabytes, myErr, myStats.fOutputBytes, myStats.fMicroseconds);
+	QTSys_DeletePath(myOutPath);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTRemux_RemuxFile(myInPath, myOutPath, kRemuxFastStart, NULL, &myStats);
+	QTRemux_WriteBenchmarkResult(theReport, "faststart", theGigabytes, myErr, myStats.fOutputBytes, myStats.fMicroseconds);
+	QTSys_DeletePath(myOutPath);
+	if (myErr != noErr)
+		goto bail;
+
+	if (theReport != NULL) {
+		fprintf(theReport, "{\"benchmark\":\"flatten\",\"gigabytes\":%ld,\"layoutPasses\":%ld,\"writes\":%llu,\"fastStartTimeVsCopy\":%.2f}\n",
+					theGigabytes,
+					myStats.fLayoutPasses,
+					(unsigned long long)myStats.fWriteCount,
+					(double)myStats.fMicroseconds / (double)((myCopyTime > 0) ? myCopyTime : 1));
+		fflush(theReport);
+	}
+
+bail:
+	QTSys_DeletePath(myInPath);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_WriteBenchmarkMovie
+// Write the benchmark's movie: a video track and a sound track, interleaved, with the movie atom at the end.
+//
+// Each video sample starts with its sample number, so no two are the same.
+//
+//////////
+
+static OSErr QTRemux_WriteBenchmarkMovie (const char *thePath, long theGigabytes, QTUInt64 *theBytesWritten)
+{
+	QTRemuxWriterRecord		myWriter = {kQTSysInvalidFile, NULL, 0, 0};
+	QTAtomBufferRecord		myFileType;
+	QTAtomBufferRecord		myMovie;
+	UInt8					*mySample = NULL;
+	QTUInt64				myChunkStride = kRemuxBenchVideoSampleSize + kRemuxBenchSoundPerChunk * kRemuxBenchSoundSampleSize;
+	UInt32					myFrameCount = (UInt32)(((QTUInt64)theGigabytes << 30) / myChunkStride);
+	QTUInt64				myDataSize = (QTUInt64)myFrameCount * myChunkStride;
+	UInt32					myDataHeaderSize = (kAtomHeaderSize + myDataSize > 0xFFFFFFFFUL) ? kAtomExtendedHeaderSize : kAtomHeaderSize;
+	QTUInt64				myDataOffset;
+	UInt32					myAtom;
+	UInt32					myIndex;
+	OSErr					myErr = noErr;
+
+	*theBytesWritten = 0;
+
+	QTAtom_InitBuffer(&myFileType);
+	QTAtom_InitBuffer(&myMovie);
+
+	myAtom = QTAtom_BeginAtom(&myFileType, kAtomTypeFileType);
+	QTAtom_Append32(&myFileType, kAtomBrandQuickTime);
+	QTAtom_Append32(&myFileType, kRemuxQuickTimeVersion);
+	QTAtom_Append32(&myFileType, kAtomBrandQuickTime);
+	QTAtom_EndAtom(&myFileType, myAtom);
+
+	myDataOffset = myFileType.fSize + myDataHeaderSize;
+
+	// the movie header (version 0); 30 frames a second, 20 units each
+	myAtom = QTAtom_BeginAtom(&myMovie, kAtomTypeMovie);
+	{
+		UInt32		myHeader = QTAtom_BeginFullAtom(&myMovie, kAtomTypeMovieHeader, 0, 0);
+
+		QTAtom_Append32(&myMovie, 0);								// creation time
+		QTAtom_Append32(&myMovie, 0);								// modification time
+		QTAtom_Append32(&myMovie, 600);								// time scale
+		QTAtom_Append32(&myMovie, myFrameCount * 20);				// duration
+		QTAtom_Append32(&myMovie, 0x00010000);						// preferred rate
+		QTAtom_Append16(&myMovie, 0x0100);							// preferred volume
+		QTAtom_AppendZeros(&myMovie, 10);
+		QTAtom_AppendZeros(&myMovie, 36);							// matrix
+		QTAtom_AppendZeros(&myMovie, 24);							// preview and poster times, selection, current time
+		QTAtom_Append32(&myMovie, 3);								// next track ID
+		QTAtom_EndAtom(&myMovie, myHeader);
+	}
+	QTRemux_AppendBenchmarkTrack(&myMovie, 1, kAtomHandlerVideo, 600, myFrameCount, 20, kRemuxBenchVideoSampleSize, 1, myDataOffset, myChunkStride);
+	QTRemux_AppendBenchmarkTrack(&myMovie, 2, kAtomHandlerSound, 48000, myFrameCount * kRemuxBenchSoundPerChunk, 400, kRemuxBenchSoundSampleSize, kRemuxBenchSoundPerChunk, myDataOffset + kRemuxBenchVideoSampleSize, myChunkStride);
+	QTAtom_EndAtom(&myMovie, myAtom);
+
+	myErr = (myFileType.fErr != noErr) ? myFileType.fErr : myMovie.fErr;
+	if (myErr != noErr)
+		goto bail;
+
+	myWriter.fBuffer = (UInt8 *)malloc(kRemuxWriteBufferSize);
+	mySample = (UInt8 *)malloc(kRemuxBenchVideoSampleSize);
+	if ((myWriter.fBuffer == NULL) || (mySample == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < kRemuxBenchVideoSampleSize; myIndex++)
+		mySample[myIndex] = (UInt8)(myIndex * 31);
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenWrite, &myWriter.fFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTRemux_WriteBytes(&myWriter, myFileType.fData, myFileType.fSize);
+	if (myErr == noErr)
+		myErr = QTRemux_WriteAtomHeader(&myWriter, kAtomTypeMovieData, myDataHeaderSize + myDataSize, myDataHeaderSize);
+
+	for (myIndex = 0; (myIndex < myFrameCount) && (myErr == noErr); myIndex++) {
+		QTAtom_PutBE32(mySample, myIndex + 1);
+
+		myErr = QTRemux_WriteBytes(&myWriter, mySample, kRemuxBenchVideoSampleSize);
+		if (myErr == noErr)
+			myErr = QTRemux_WriteBytes(&myWriter, mySample + 4, kRemuxBenchSoundPerChunk * kRemuxBenchSoundSampleSize);
+	}
+
+	if (myErr == noErr)
+		myErr = QTRemux_WriteBytes(&myWriter, myMovie.fData, myMovie.fSize);
+	if (myErr == noErr)
+		myErr = QTRemux_FlushWriter(&myWriter);
+
+	if (myErr == noErr)
+		*theBytesWritten = myFileType.fSize + myDataHeaderSize + myDataSize + myMovie.fSize;
+
+bail:
+	if (myWriter.fFile != kQTSysInvalidFile) {
+		QTSys_CloseFile(myWriter.fFile);
+		if (myErr != noErr)
+			QTSys_DeletePath(thePath);
+	}
+
+	QTAtom_DisposeBuffer(&myMovie);
+	QTAtom_DisposeBuffer(&myFileType);
+	free(myWriter.fBuffer);
+	free(mySample);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTRemux_AppendBenchmarkTrack
+// Append a track whose samples are all the same size and duration, and whose chunks are evenly spaced.
+//
+//////////
+
+static void QTRemux_AppendBenchmarkTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, OSType theHandlerType, UInt32 theTimeScale, UInt32 theSampleCount, UInt32 theSampleDuration, UInt32 theSampleSize, UInt32 theSamplesPerChunk, QTUInt64 theFirstOffset, QTUInt64 theChunkStride)
+{
+	UInt32					myAtoms[6];
+	UInt32					myChunkCount = (theSampleCount + theSamplesPerChunk - 1) / theSamplesPerChunk;
+	QTUInt64				myDuration = (QTUInt64)theSampleCount * theSampleDuration;
+	Boolean					myUse64 = (theFirstOffset + (QTUInt64)myChunkCount * theChunkStride > 0xFFFFFFFFUL);
+	Boolean					myIsVideo = (theHandlerType == kAtomHandlerVideo);
+	UInt32					myIndex;
+
+	myAtoms[0] = QTAtom_BeginAtom(theBuffer, kAtomTypeTrack);
+
+	// the track header (version 0)
+	myAtoms[1] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTrackHeader, 0, 0x0F);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, theTrackID);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, (UInt32)(myDuration * 600 / theTimeScale));
+	QTAtom_AppendZeros(theBuffer, 8);
+	QTAtom_Append16(theBuffer, 0);								// layer
+	QTAtom_Append16(theBuffer, 0);								// alternate group
+	QTAtom_Append16(theBuffer, myIsVideo ? 0 : 0x0100);			// volume
+	QTAtom_Append16(theBuffer, 0);
+	QTAtom_AppendZeros(theBuffer, 36);							// matrix
+	QTAtom_Append32(theBuffer, myIsVideo ? (1920UL << 16) : 0);
+	QTAtom_Append32(theBuffer, myIsVideo ? (1080UL << 16) : 0);
+	QTAtom_EndAtom(theBuffer, myAtoms[1]);
+
+	myAtoms[1] = QTAtom_BeginAtom(theBuffer, kAtomTypeMedia);
+
+	// the media header (version 1)
+	myAtoms[2] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMediaHeader, 1, 0);
+	QTAtom_Append64(theBuffer, 0);
+	QTAtom_Append64(theBuffer, 0);
+	QTAtom_Append32(theBuffer, theTimeScale);
+	QTAtom_Append64(theBuffer, myDuration);
+	QTAtom_Append16(theBuffer, 0);								// language
+	QTAtom_Append16(theBuffer, 0);								// quality
+	QTAtom_EndAtom(theBuffer, myAtoms[2]);
+
+	myAtoms[2] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeHandler, 0, 0);
+	QTAtom_Append32(theBuffer, kAtomHandlerMedia);
+	QTAtom_Append32(theBuffer, theHandlerType);
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append8(theBuffer, 0);								// empty name
+	QTAtom_EndAtom(theBuffer, myAtoms[2]);
+
+	myAtoms[2] = QTAtom_BeginAtom(theBuffer, kAtomTypeMediaInfo);
+
+	// one data reference, to this file
+	myAtoms[3] = QTAtom_BeginAtom(theBuffer, kAtomTypeDataInfo);
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeDataRef, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	myAtoms[5] = QTAtom_BeginFullAtom(theBuffer, FOUR_CHAR_CODE('alis'), 0, kRemuxSelfContainedFlag);
+	QTAtom_EndAtom(theBuffer, myAtoms[5]);
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+	QTAtom_EndAtom(theBuffer, myAtoms[3]);
+
+	myAtoms[3] = QTAtom_BeginAtom(theBuffer, kAtomTypeSampleTable);
+
+	// a sample description with nothing but its type
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleDesc, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, 16);
+	QTAtom_Append32(theBuffer, myIsVideo ? FOUR_CHAR_CODE('avc1') : FOUR_CHAR_CODE('mp4a'));
+	QTAtom_AppendZeros(theBuffer, 6);
+	QTAtom_Append16(theBuffer, 1);								// data reference index
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTimeToSample, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, theSampleCount);
+	QTAtom_Append32(theBuffer, theSampleDuration);
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleToChunk, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, 1);								// first chunk
+	QTAtom_Append32(theBuffer, theSamplesPerChunk);
+	QTAtom_Append32(theBuffer, 1);								// sample description index
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleSize, 0, 0);
+	QTAtom_Append32(theBuffer, theSampleSize);
+	QTAtom_Append32(theBuffer, theSampleCount);
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, myUse64 ? kAtomTypeChunkOffset64 : kAtomTypeChunkOffset, 0, 0);
+	QTAtom_Append32(theBuffer, myChunkCount);
+	for (myIndex = 0; myIndex < myChunkCount; myIndex++) {
+		if (myUse64)
+			QTAtom_Append64(theBuffer, theFirstOffset + (QTUInt64)myIndex * theChunkStride);
+		else
+			QTAtom_Append32(theBuffer, (UInt32)(theFirstOffset + (QTUInt64)myIndex * theChunkStride));
+	}
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	QTAtom_EndAtom(theBuffer, myAtoms[3]);
+	QTAtom_EndAtom(theBuffer, myAtoms[2]);
+	QTAtom_EndAtom(theBuffer, myAtoms[1]);
+	QTAtom_EndAtom(theBuffer, myAtoms[0]);
+}
+
+
+//////////
+//
+// QTRemux_WriteBenchmarkResult
+// Write one line of the benchmark's report.
+//
+//////////
+
+static void QTRemux_WriteBenchmarkResult (FILE *theReport, const char *theMethod, long theGigabytes, OSErr theErr, QTUInt64 theBytes, QTUInt64 theMicroseconds)
+{
+	if (theReport == NULL)
+		return;
+
+	fprintf(theReport, "{\"benchmark\":\"flatten\",\"method\":\"%s\",\"gigabytes\":%ld,\"err\":%d,\"bytes\":%llu,\"wallMicroseconds\":%llu,\"megabytesPerSecond\":%.1f}\n",
+				theMethod,
+				theGigabytes,
+				(int)theErr,
+				(unsigned long long)theBytes,
+				(unsigned long long)theMicroseconds,
+				(theMicroseconds > 0) ? (double)theBytes / (double)theMicroseconds : 0.0);
+	fflush(theReport);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTRemux_IsRemuxCommandLine
+// Does the specified command line ask for remux mode, or for the flattening benchmark?
+//
+//////////
+
+Boolean QTRemux_IsRemuxCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if ((strcmp(theArgv[myIndex], kRemuxSwitch) == 0) || (strcmp(theArgv[myIndex], kRemuxBenchmarkSwitch) == 0))
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTRemux_Main
+// Run remux mode. Returns one of the kRemuxExit constants.
+//
+// Usage: -remux <input movie> <output movie> [-faststart] [-verify] [-report <file>]
+//        -flattenbench [-gigabytes <count>] [-dir <directory>] [-report <file>]
+//
+//////////
+
+int QTRemux_Main (int theArgc, char *theArgv[])
+{
+	QTRemuxStatsRecord		myStats;
+	QTRemuxVerifyRecord		myVerify;
+	const char				*myInPath = NULL;
+	const char				*myOutPath = NULL;
+	const char				*myReportPath = NULL;
+	const char				*myDirectory = NULL;
+	Boolean					myBenchmark = false;
+	Boolean					myVerifying = false;
+	long					myFlags = 0;
+	long					myGigabytes = 0;
+	FILE					*myReport = stdout;
+	QTUInt64				myVerifyTime = 0;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	memset(&myVerify, 0, sizeof(myVerify));
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kRemuxSwitch) == 0) && (myIndex + 2 < theArgc)) {
+			myInPath = theArgv[++myIndex];
+			myOutPath = theArgv[++myIndex];
+		} else if (strcmp(theArgv[myIndex], kRemuxBenchmarkSwitch) == 0) {
+			myBenchmark = true;
+		} else if (strcmp(theArgv[myIndex], kRemuxFastStartSwitch) == 0) {
+			myFlags |= kRemuxFastStart;
+		} else if (strcmp(theArgv[myIndex], kRemuxVerifySwitch) == 0) {
+			myVerifying = true;
+		} else if ((strcmp(theArgv[myIndex], kRemuxGigabytesSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myGigabytes = atol(theArgv[++myIndex]);
+		} else if ((strcmp(theArgv[myIndex], kRemuxDirectorySwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myDirectory = theArgv[++myIndex];
+		} else if ((strcmp(theArgv[myIndex], kRemuxReportSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myReportPath = theArgv[++myIndex];
+		}
+	}
+
+	if (!myBenchmark && ((myInPath == NULL) || (myOutPath == NULL))) {
+		fprintf(stderr, "usage: %s %s <input movie> <output movie> [%s] [%s] [%s <file>]\n", theArgv[0], kRemuxSwitch, kRemuxFastStartSwitch, kRemuxVerifySwitch, kRemuxReportSwitch);
+		fprintf(stderr, "       %s %s [%s <count>] [%s <directory>] [%s <file>]\n", theArgv[0], kRemuxBenchmarkSwitch, kRemuxGigabytesSwitch, kRemuxDirectorySwitch, kRemuxReportSwitch);
+		return(kRemuxExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kRemuxExitUsage);
+		}
+	}
+
+	if (myBenchmark) {
+		myErr = QTRemux_RunBenchmark(myReport, myGigabytes, myDirectory);
+		if (myReport != stdout)
+			fclose(myReport);
+
+		return((myErr == noErr) ? kRemuxExitSuccess : kRemuxExitFailed);
+	}
+
+	myErr = QTRemux_RemuxFile(myInPath, myOutPath, myFlags, NULL, &myStats);
+
+	if ((myErr == noErr) && myVerifying) {
+		myVerifyTime = QTSys_GetMicroseconds();
+		myErr = QTRemux_VerifyFile(myInPath, myOutPath, &myVerify);
+		myVerifyTime = QTSys_GetMicroseconds() - myVerifyTime;
+	}
+
+	fputs("{\"input\":", myReport);
+	QTSys_WriteJSONString(myReport, myInPath);
+	fputs(",\"output\":", myReport);
+	QTSys_WriteJSONString(myReport, myOutPath);
+	fprintf(myReport, ",\"err\":%d,\"fastStart\":%s,\"tracks\":%ld,\"chunks\":%llu,\"reads\":%llu,\"writes\":%llu,\"dataBytes\":%llu,\"movieBytes\":%lu,\"bytesWritten\":%llu,\"wallMicroseconds\":%llu,\"megabytesPerSecond\":%.1f",
+						(int)myErr,
+						((myFlags & kRemuxFastStart) ? "true" : "false"),
+						myStats.fTrackCount,
+						(unsigned long long)myStats.fChunkCount,
+						(unsigned long long)myStats.fRangeCount,
+						(unsigned long long)myStats.fWriteCount,
+						(unsigned long long)myStats.fDataBytes,
+						(unsigned long)myStats.fMovieBytes,
+						(unsigned long long)myStats.fOutputBytes,
+						(unsigned long long)myStats.fMicroseconds,
+						(myStats.fMicroseconds > 0) ? (double)myStats.fDataBytes / (double)myStats.fMicroseconds : 0.0);
+
+	if (myVerifying)
+		fprintf(myReport, ",\"verified\":%s,\"samplesCompared\":%llu,\"mismatchTrackID\":%lu,\"mismatchSample\":%lu,\"verifyMicroseconds\":%llu",
+						((myErr == noErr) ? "true" : "false"),
+						(unsigned long long)myVerify.fSampleCount,
+						(unsigned long)myVerify.fTrackID,
+						(unsigned long)myVerify.fSampleNumber,
+						(unsigned long long)myVerifyTime);
+
+	fputs("}\n", myReport);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kRemuxExitSuccess : kRemuxExitFailed);
+}
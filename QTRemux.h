@@ -0,0 +1,104 @@
+//////////
+//
+//	File:		QTRemux.h
+//
+//	Contains:	A portable engine that copies the samples of QuickTime and MPEG-4 files into a new file without re-encoding them.
+//				All utilities start with the prefix "QTRemux_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTRemux__
+#define __QTRemux__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSampleTable.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kRemuxSwitch						"-remux"				// command-line switch that selects remux mode
+#define kRemuxVerifySwitch					"-verify"				// compare every sample of the output with the input
+#define kRemuxFastStartSwitch				"-faststart"			// put the movie atom before the sample data
+#define kRemuxReportSwitch					"-report"				// write the report to a file instead of stdout
+#define kRemuxBenchmarkSwitch				"-flattenbench"			// command-line switch that selects the flattening benchmark
+#define kRemuxGigabytesSwitch				"-gigabytes"			// size of the benchmark's synthetic movie
+#define kRemuxDirectorySwitch				"-dir"					// where the benchmark writes its files
+
+#define kRemuxDefaultBenchmarkGigabytes		5						// big enough to need 64-bit chunk offsets
+#define kRemuxWriteBufferSize				(4L * 1024L * 1024L)	// every write but the last is this size, at a multiple of it
+
+// flags for QTRemux_RemuxFile
+enum {
+	kRemuxFastStart							= 1L << 0				// write ftyp, moov, mdat instead of ftyp, mdat, moov
+};
+
+// the file type that asks the parallel exporter (QTDataEx.c) to remux a job instead of exporting it
+#define kRemuxFileType						FOUR_CHAR_CODE('copy')
+
+// MPEG-4 brands we write when the output's extension asks for a different container than the input's
+#define kRemuxBrandISO						FOUR_CHAR_CODE('isom')
+#define kRemuxBrandMP42						FOUR_CHAR_CODE('mp42')
+#define kRemuxQuickTimeVersion				0x20050300				// the minor version QuickTime 7 writes
+
+// exit codes returned by QTRemux_Main
+enum {
+	kRemuxExitSuccess						= 0,
+	kRemuxExitFailed						= 1,
+	kRemuxExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// what QTRemux_RemuxFile did
+typedef struct QTRemuxStatsRecord {
+	long					fTrackCount;
+	QTUInt64				fChunkCount;
+	QTUInt64				fRangeCount;			// reads it took to copy the chunks; adjacent chunks are copied together
+	QTUInt64				fDataBytes;				// sample data copied
+	UInt32					fMovieBytes;			// size of the new movie atom
+	QTUInt64				fOutputBytes;
+	QTUInt64				fWriteCount;			// writes it took to write the output
+	long					fLayoutPasses;			// times the movie atom was built before its size settled
+	QTUInt64				fMicroseconds;
+} QTRemuxStatsRecord, *QTRemuxStatsPtr;
+
+// where QTRemux_VerifyFile found the first difference, if it found one
+typedef struct QTRemuxVerifyRecord {
+	QTUInt64				fSampleCount;			// samples compared
+	UInt32					fTrackID;				// of the first sample that differs, or 0
+	UInt32					fSampleNumber;
+} QTRemuxVerifyRecord, *QTRemuxVerifyPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTRemux_RemuxFile (const char *theInPath, const char *theOutPath, long theFlags, QTAtomBufferPtr theMovieAtom, QTRemuxStatsPtr theStats);
+OSErr						QTRemux_VerifyFile (const char *theInPath, const char *theOutPath, QTRemuxVerifyPtr theResult);
+
+OSErr						QTRemux_RunBenchmark (FILE *theReport, long theGigabytes, const char *theDirectory);
+
+Boolean						QTRemux_IsRemuxCommandLine (int theArgc, char *theArgv[]);
+int							QTRemux_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTRemux__
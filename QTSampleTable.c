@@ -0,0 +1,1386 @@
+//////////
+//
+//	File:		QTSampleTable.c
+//
+//	Contains:	Portable functions for reading the track and sample tables of QuickTime and MPEG-4 files.
+//				All utilities start with the prefix "QTStbl_".
+//
+//	QTStbl_ReadMovie reads the movie header and, for every track, the handful of header fields and the
+//	sample tables ('stts', 'stsc', 'stsz' and 'stco' or 'co64') that say where each sample lives and
+//	when it plays. The tables are kept in the compact form they have in the file; QTStbl_NextSample walks
+//	them together to produce one sample at a time. That matters for long files: a QuickTime sound track
+//	can have one "sample" per audio frame, and expanding its tables would take gigabytes.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSampleTable.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kStblInitialTrackCapacity	8						// initial size of a movie's track array
+#define kStblTimeEntryWindow		512						// 'stts' entries read at once by QTStbl_GetTrackFrameInfo
+#define kStblMaxBenchmarkTracks		3
+
+#define kAtomTypeCompactSampleSize	FOUR_CHAR_CODE('stz2')
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTStbl_ReadChild (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, OSType theType, UInt8 **theData, UInt32 *theSize);
+static OSErr				QTStbl_ReadTrackHeader (QTAtomReaderPtr theReader, QTStblTrackPtr theTrack);
+static OSErr				QTStbl_ReadMediaHeaders (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMedia, QTStblTrackPtr theTrack);
+static OSErr				QTStbl_ReadSampleTables (QTAtomReaderPtr theReader, QTAtomHeaderPtr theSampleTable, QTStblTrackPtr theTrack);
+static OSErr				QTStbl_SumTimeEntries (QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, QTStblFrameInfoPtr theInfo);
+static void					QTStbl_WriteFourCharCode (FILE *theStream, OSType theCode);
+static OSErr				QTStbl_StepTrack (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrackAtom, QTStblFrameInfoPtr theInfo);
+static void					QTStbl_BuildSampleMovie (QTAtomBufferPtr theBuffer, long theHours);
+static void					QTStbl_AppendSampleTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, OSType theHandlerType, UInt32 theTimeScale, const QTStblTimeEntryRecord *theEntries, UInt32 theEntryCount, UInt32 theUniformSampleSize, UInt32 theSamplesPerChunk);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Movie and track functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTStbl_ReadMovie
+// Read the movie header and the sample tables of every track in the movie.
+//
+//////////
+
+OSErr QTStbl_ReadMovie (QTAtomReaderPtr theReader, QTStblMoviePtr theMovie)
+{
+	QTAtomHeaderRecord		myAtom;
+	UInt8					*myData = NULL;
+	UInt32					mySize = 0;
+	long					myCapacity = 0;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	memset(theMovie, 0, sizeof(QTStblMovieRecord));
+
+	// a file with no 'ftyp' atom predates MPEG-4, so it's a QuickTime movie
+	theMovie->fIsQuickTime = true;
+	if (QTAtom_FindTopLevel(theReader, kAtomTypeFileType, &myAtom) == noErr) {
+		UInt8		myBrand[4];
+
+		if ((myAtom.fSize >= myAtom.fHeaderSize + 4) && (theReader->fRead(theReader->fRefCon, myAtom.fOffset + myAtom.fHeaderSize, myBrand, 4) == noErr))
+			theMovie->fIsQuickTime = (QTAtom_GetBE32(myBrand) == kAtomBrandQuickTime);
+	}
+
+	myErr = QTAtom_FindTopLevel(theReader, kAtomTypeMovie, &theMovie->fMovieAtom);
+	if (myErr != noErr) {
+		myErr = invalidMovie;
+		goto bail;
+	}
+
+	// the movie header
+	myErr = QTAtom_FindChild(theReader, &theMovie->fMovieAtom, kAtomTypeMovieHeader, 1, &theMovie->fMovieHeaderAtom);
+	if (myErr == noErr)
+		myErr = QTAtom_ReadPayload(theReader, &theMovie->fMovieHeaderAtom, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	if ((mySize < 100) || ((myData[0] == 1) && (mySize < 112))) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	if (myData[0] == 1) {
+		theMovie->fTimeScale = QTAtom_GetBE32(myData + 20);
+		theMovie->fDuration = QTAtom_GetBE64(myData + 24);
+	} else {
+		theMovie->fTimeScale = QTAtom_GetBE32(myData + 12);
+		theMovie->fDuration = QTAtom_GetBE32(myData + 16);
+	}
+	theMovie->fNextTrackID = QTAtom_GetBE32(myData + mySize - 4);
+
+	// the tracks
+	for (myIndex = 1; QTAtom_FindChild(theReader, &theMovie->fMovieAtom, kAtomTypeTrack, myIndex, &myAtom) == noErr; myIndex++) {
+		if (theMovie->fTrackCount == myCapacity) {
+			long				myNewCapacity = (myCapacity == 0) ? kStblInitialTrackCapacity : 2 * myCapacity;
+			QTStblTrackPtr		myTracks = (QTStblTrackPtr)realloc(theMovie->fTracks, (size_t)myNewCapacity * sizeof(QTStblTrackRecord));
+
+			if (myTracks == NULL) {
+				myErr = memFullErr;
+				goto bail;
+			}
+
+			theMovie->fTracks = myTracks;
+			myCapacity = myNewCapacity;
+		}
+
+		myErr = QTStbl_ReadTrack(theReader, &myAtom, &theMovie->fTracks[theMovie->fTrackCount]);
+		if (myErr != noErr)
+			goto bail;
+
+		theMovie->fTrackCount++;
+	}
+
+bail:
+	free(myData);
+
+	if (myErr != noErr)
+		QTStbl_DisposeMovie(theMovie);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTStbl_DisposeMovie
+// Dispose of the memory held by a movie record.
+//
+//////////
+
+void QTStbl_DisposeMovie (QTStblMoviePtr theMovie)
+{
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < theMovie->fTrackCount; myIndex++)
+		QTStbl_DisposeTrack(&theMovie->fTracks[myIndex]);
+
+	free(theMovie->fTracks);
+
+	theMovie->fTracks = NULL;
+	theMovie->fTrackCount = 0;
+}
+
+
+//////////
+//
+// QTStbl_ReadTrack
+// Read the headers and sample tables of the specified 'trak' atom.
+//
+//////////
+
+OSErr QTStbl_ReadTrack (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrackAtom, QTStblTrackPtr theTrack)
+{
+	static const OSType		kSampleTablePath[] = {kAtomTypeMediaInfo, kAtomTypeSampleTable};
+	QTAtomHeaderRecord		myMedia;
+	QTAtomHeaderRecord		mySampleTable;
+	OSErr					myErr = noErr;
+
+	memset(theTrack, 0, sizeof(QTStblTrackRecord));
+	theTrack->fTrackAtom = *theTrackAtom;
+
+	myErr = QTStbl_ReadTrackHeader(theReader, theTrack);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTAtom_FindChild(theReader, theTrackAtom, kAtomTypeMedia, 1, &myMedia);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTStbl_ReadMediaHeaders(theReader, &myMedia, theTrack);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTAtom_FindPath(theReader, &myMedia, kSampleTablePath, 2, &mySampleTable);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTStbl_ReadSampleTables(theReader, &mySampleTable, theTrack);
+
+bail:
+	if (myErr != noErr)
+		QTStbl_DisposeTrack(theTrack);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTStbl_DisposeTrack
+// Dispose of the sample tables held by a track record.
+//
+//////////
+
+void QTStbl_DisposeTrack (QTStblTrackPtr theTrack)
+{
+	free(theTrack->fSampleSizes);
+	free(theTrack->fTimeEntries);
+	free(theTrack->fChunkEntries);
+	free(theTrack->fChunkOffsets);
+
+	theTrack->fSampleSizes = NULL;
+	theTrack->fTimeEntries = NULL;
+	theTrack->fChunkEntries = NULL;
+	theTrack->fChunkOffsets = NULL;
+	theTrack->fSampleCount = 0;
+	theTrack->fTimeEntryCount = 0;
+	theTrack->fChunkEntryCount = 0;
+	theTrack->fChunkCount = 0;
+}
+
+
+//////////
+//
+// QTStbl_ReadChild
+// Read the payload of the first child of theParent of the specified type.
+//
+//////////
+
+static OSErr QTStbl_ReadChild (QTAtomReaderPtr theReader, QTAtomHeaderPtr theParent, OSType theType, UInt8 **theData, UInt32 *theSize)
+{
+	QTAtomHeaderRecord		myAtom;
+	OSErr					myErr = noErr;
+
+	*theData = NULL;
+	*theSize = 0;
+
+	myErr = QTAtom_FindChild(theReader, theParent, theType, 1, &myAtom);
+	if (myErr == noErr)
+		myErr = QTAtom_ReadPayload(theReader, &myAtom, theData, theSize);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTStbl_ReadTrackHeader
+// Read the track ID, duration and dimensions from the track header.
+//
+//////////
+
+static OSErr QTStbl_ReadTrackHeader (QTAtomReaderPtr theReader, QTStblTrackPtr theTrack)
+{
+	UInt8			*myData = NULL;
+	UInt32			mySize = 0;
+	UInt32			myBase;
+	OSErr			myErr = noErr;
+
+	myErr = QTStbl_ReadChild(theReader, &theTrack->fTrackAtom, kAtomTypeTrackHeader, &myData, &mySize);
+	if (myErr != noErr)
+		return(myErr);
+
+	// version 1 headers have 64-bit times and durations
+	myBase = (myData[0] == 1) ? 12 : 0;
+	if (mySize < 84 + myBase) {
+		free(myData);
+		return(invalidAtomErr);
+	}
+
+	if (myData[0] == 1) {
+		theTrack->fTrackID = QTAtom_GetBE32(myData + 20);
+		theTrack->fMovieDuration = QTAtom_GetBE64(myData + 28);
+	} else {
+		theTrack->fTrackID = QTAtom_GetBE32(myData + 12);
+		theTrack->fMovieDuration = QTAtom_GetBE32(myData + 20);
+	}
+
+	// the dimensions are 16.16 fixed-point numbers
+	theTrack->fWidth = QTAtom_GetBE32(myData + myBase + 76) >> 16;
+	theTrack->fHeight = QTAtom_GetBE32(myData + myBase + 80) >> 16;
+
+	free(myData);
+	return(noErr);
+}
+
+
+//////////
+//
+// QTStbl_ReadMediaHeaders
+// Read the media time scale and duration, and the handler type, from the media atom.
+//
+//////////
+
+static OSErr QTStbl_ReadMediaHeaders (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMedia, QTStblTrackPtr theTrack)
+{
+	UInt8			*myData = NULL;
+	UInt32			mySize = 0;
+	OSErr			myErr = noErr;
+
+	myErr = QTStbl_ReadChild(theReader, theMedia, kAtomTypeMediaHeader, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	if ((mySize < 20) || ((myData[0] == 1) && (mySize < 32))) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	if (myData[0] == 1) {
+		theTrack->fTimeScale = QTAtom_GetBE32(myData + 20);
+		theTrack->fDuration = QTAtom_GetBE64(myData + 24);
+	} else {
+		theTrack->fTimeScale = QTAtom_GetBE32(myData + 12);
+		theTrack->fDuration = QTAtom_GetBE32(myData + 16);
+	}
+
+	free(myData);
+
+	// the handler subtype follows the version, flags and component type
+	myErr = QTStbl_ReadChild(theReader, theMedia, kAtomTypeHandler, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	if (mySize < 12) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	theTrack->fHandlerType = QTAtom_GetBE32(myData + 8);
+
+bail:
+	free(myData);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTStbl_ReadSampleTables
+// Read the sample description type and the sample tables of a track.
+//
+// We check every entry count against the size of its atom, so a damaged file can't make us read past
+// the end of a table. The big tables (sample sizes, time-to-sample entries and chunk offsets) are
+// byte-swapped a whole array at a time by QTSwap; only the 'stsc' entries, which we check as we go, are
+// read one value at a time.
+//
+//////////
+
+static OSErr QTStbl_ReadSampleTables (QTAtomReaderPtr theReader, QTAtomHeaderPtr theSampleTable, QTStblTrackPtr theTrack)
+{
+	QTAtomHeaderRecord		myAtom;
+	Boolean					myIs64Bit = false;
+	UInt8					*myData = NULL;
+	UInt32					mySize = 0;
+	UInt32					myCount;
+	UInt32					myIndex;
+	OSErr					myErr = noErr;
+
+	// sample description: version and flags, entry count, then the first entry's size and type
+	myErr = QTStbl_ReadChild(theReader, theSampleTable, kAtomTypeSampleDesc, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	if ((mySize >= 16) && (QTAtom_GetBE32(myData + 4) > 0))
+		theTrack->fSampleFormat = QTAtom_GetBE32(myData + 12);
+
+	free(myData);
+	myData = NULL;
+
+	// sample sizes
+	myErr = QTStbl_ReadChild(theReader, theSampleTable, kAtomTypeSampleSize, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	if (mySize < 12) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	theTrack->fUniformSampleSize = QTAtom_GetBE32(myData + 4);
+	theTrack->fSampleCount = QTAtom_GetBE32(myData + 8);
+
+	if (theTrack->fUniformSampleSize == 0) {
+		myCount = theTrack->fSampleCount;
+		if (myCount > (mySize - 12) / 4) {
+			myErr = invalidAtomErr;
+			goto bail;
+		}
+
+		theTrack->fSampleSizes = (UInt32 *)malloc(((size_t)myCount + 1) * sizeof(UInt32));
+		if (theTrack->fSampleSizes == NULL) {
+			myErr = memFullErr;
+			goto bail;
+		}
+
+		QTSwap_ReadBE32(theTrack->fSampleSizes, myData + 12, myCount);
+	}
+
+	free(myData);
+	myData = NULL;
+
+	// time-to-sample
+	myErr = QTStbl_ReadChild(theReader, theSampleTable, kAtomTypeTimeToSample, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	myCount = (mySize >= 8) ? QTAtom_GetBE32(myData + 4) : 0;
+	if ((mySize < 8) || (myCount > (mySize - 8) / 8)) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	theTrack->fTimeEntries = (QTStblTimeEntryPtr)malloc(((size_t)myCount + 1) * sizeof(QTStblTimeEntryRecord));
+	if (theTrack->fTimeEntries == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	// an entry is a pair of 32-bit values, in the same order as in the file
+	QTSwap_ReadBE32((UInt32 *)theTrack->fTimeEntries, myData + 8, 2 * (size_t)myCount);
+	theTrack->fTimeEntryCount = myCount;
+
+	free(myData);
+	myData = NULL;
+
+	// sample-to-chunk
+	myErr = QTStbl_ReadChild(theReader, theSampleTable, kAtomTypeSampleToChunk, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	myCount = (mySize >= 8) ? QTAtom_GetBE32(myData + 4) : 0;
+	if ((mySize < 8) || (myCount > (mySize - 8) / 12)) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	theTrack->fChunkEntries = (QTStblChunkEntryPtr)malloc(((size_t)myCount + 1) * sizeof(QTStblChunkEntryRecord));
+	if (theTrack->fChunkEntries == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < myCount; myIndex++) {
+		QTStblChunkEntryPtr		myEntry = &theTrack->fChunkEntries[myIndex];
+
+		myEntry->fFirstChunk = QTAtom_GetBE32(myData + 8 + (12 * myIndex));
+		myEntry->fSamplesPerChunk = QTAtom_GetBE32(myData + 12 + (12 * myIndex));
+		myEntry->fDescIndex = QTAtom_GetBE32(myData + 16 + (12 * myIndex));
+
+		// first chunks must start at 1 and increase
+		if ((myEntry->fFirstChunk == 0) || ((myIndex > 0) && (myEntry->fFirstChunk <= myEntry[-1].fFirstChunk))) {
+			myErr = invalidAtomErr;
+			goto bail;
+		}
+	}
+	theTrack->fChunkEntryCount = myCount;
+
+	free(myData);
+	myData = NULL;
+
+	// chunk offsets, 32- or 64-bit
+	if (QTAtom_FindChild(theReader, theSampleTable, kAtomTypeChunkOffset, 1, &myAtom) != noErr) {
+		myErr = QTAtom_FindChild(theReader, theSampleTable, kAtomTypeChunkOffset64, 1, &myAtom);
+		if (myErr != noErr)
+			goto bail;
+		myIs64Bit = true;
+	}
+
+	myErr = QTAtom_ReadPayload(theReader, &myAtom, &myData, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	myCount = (mySize >= 8) ? QTAtom_GetBE32(myData + 4) : 0;
+	if ((mySize < 8) || (myCount > (mySize - 8) / (myIs64Bit ? 8 : 4))) {
+		myErr = invalidAtomErr;
+		goto bail;
+	}
+
+	theTrack->fChunkOffsets = (QTUInt64 *)malloc(((size_t)myCount + 1) * sizeof(QTUInt64));
+	if (theTrack->fChunkOffsets == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	if (myIs64Bit)
+		QTSwap_ReadBE64(theTrack->fChunkOffsets, myData + 8, myCount);
+	else
+		QTSwap_ReadBE32To64(theTrack->fChunkOffsets, myData + 8, myCount);
+	theTrack->fChunkCount = myCount;
+
+bail:
+	free(myData);
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Sample functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTStbl_GetSampleSize
+// Return the size of the specified (1-based) sample, or 0 if there is no such sample.
+//
+//////////
+
+UInt32 QTStbl_GetSampleSize (QTStblTrackPtr theTrack, UInt32 theSampleNumber)
+{
+	if ((theSampleNumber == 0) || (theSampleNumber > theTrack->fSampleCount))
+		return(0);
+
+	if (theTrack->fSampleSizes == NULL)
+		return(theTrack->fUniformSampleSize);
+
+	return(theTrack->fSampleSizes[theSampleNumber - 1]);
+}
+
+
+//////////
+//
+// QTStbl_InitIterator
+// Prepare to walk the samples of the specified track from the beginning.
+//
+//////////
+
+void QTStbl_InitIterator (QTStblTrackPtr theTrack, QTStblIteratorPtr theIterator)
+{
+	memset(theIterator, 0, sizeof(QTStblIteratorRecord));
+	theIterator->fTrack = theTrack;
+
+	if (theTrack->fTimeEntryCount > 0)
+		theIterator->fTimeRemaining = theTrack->fTimeEntries[0].fCount;
+
+	if ((theTrack->fChunkCount > 0) && (theTrack->fChunkEntryCount > 0)) {
+		while ((theIterator->fChunkEntry + 1 < theTrack->fChunkEntryCount) && (theTrack->fChunkEntries[theIterator->fChunkEntry + 1].fFirstChunk <= 1))
+			theIterator->fChunkEntry++;
+
+		theIterator->fSamplesLeftInChunk = theTrack->fChunkEntries[theIterator->fChunkEntry].fSamplesPerChunk;
+		theIterator->fOffset = theTrack->fChunkOffsets[0];
+	} else {
+		// no chunks at all, so QTStbl_NextSample will find nothing
+		theIterator->fChunk = theTrack->fChunkCount;
+	}
+}
+
+
+//////////
+//
+// QTStbl_NextSample
+// Return the next sample of the track, or false if there are no more (or the tables run out early).
+//
+//////////
+
+Boolean QTStbl_NextSample (QTStblIteratorPtr theIterator, QTStblSamplePtr theSample)
+{
+	QTStblTrackPtr		myTrack = theIterator->fTrack;
+
+	if (theIterator->fNextSample >= myTrack->fSampleCount)
+		return(false);
+
+	// move on to the next non-empty chunk
+	while (theIterator->fSamplesLeftInChunk == 0) {
+		if (++theIterator->fChunk >= myTrack->fChunkCount)
+			return(false);
+
+		while ((theIterator->fChunkEntry + 1 < myTrack->fChunkEntryCount) && (myTrack->fChunkEntries[theIterator->fChunkEntry + 1].fFirstChunk <= theIterator->fChunk + 1))
+			theIterator->fChunkEntry++;
+
+		theIterator->fSamplesLeftInChunk = myTrack->fChunkEntries[theIterator->fChunkEntry].fSamplesPerChunk;
+		theIterator->fOffset = myTrack->fChunkOffsets[theIterator->fChunk];
+	}
+
+	// move on to the next non-empty time-to-sample entry
+	while ((theIterator->fTimeRemaining == 0) && (theIterator->fTimeEntry + 1 < myTrack->fTimeEntryCount))
+		theIterator->fTimeRemaining = myTrack->fTimeEntries[++theIterator->fTimeEntry].fCount;
+
+	theSample->fNumber = theIterator->fNextSample + 1;
+	theSample->fChunk = theIterator->fChunk + 1;
+	theSample->fOffset = theIterator->fOffset;
+	theSample->fSize = (myTrack->fSampleSizes != NULL) ? myTrack->fSampleSizes[theIterator->fNextSample] : myTrack->fUniformSampleSize;
+	theSample->fTime = theIterator->fTime;
+	theSample->fDuration = 0;
+
+	if (theIterator->fTimeRemaining > 0) {
+		theSample->fDuration = myTrack->fTimeEntries[theIterator->fTimeEntry].fDuration;
+		theIterator->fTimeRemaining--;
+	}
+
+	theIterator->fNextSample++;
+	theIterator->fSamplesLeftInChunk--;
+	theIterator->fOffset += theSample->fSize;
+	theIterator->fTime += theSample->fDuration;
+
+	return(true);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Frame counting functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTStbl_GetTrackFrameInfo
+// Count the frames of the specified 'trak' atom, and find their total duration and whether they all
+// last the same time.
+//
+// QTUtils_GetFrameCount counts frames by stepping from one interesting time to the next, which costs a
+// call per frame; here we read the sample count from the 'stsz' (or 'stz2') header and sum the
+// run-length entries of the 'stts' atom, so the cost depends on the number of entries, not of frames.
+// A constant-frame-rate track usually has just one entry. We don't read the sample sizes or the chunk
+// tables at all, and we read the 'stts' entries through a small buffer on the stack, so we allocate
+// nothing however long the track is.
+//
+// We count media samples, as QTStbl_NextSample does; unlike QTUtils_GetFrameCount, we ignore edit lists.
+//
+//////////
+
+OSErr QTStbl_GetTrackFrameInfo (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrackAtom, QTStblFrameInfoPtr theInfo)
+{
+	static const OSType		kSampleTablePath[] = {kAtomTypeMediaInfo, kAtomTypeSampleTable};
+	QTStblTrackRecord		myTrack;
+	QTAtomHeaderRecord		myMedia;
+	QTAtomHeaderRecord		mySampleTable;
+	QTAtomHeaderRecord		myAtom;
+	UInt8					myHeader[12];
+	OSErr					myErr = noErr;
+
+	memset(theInfo, 0, sizeof(QTStblFrameInfoRecord));
+	memset(&myTrack, 0, sizeof(QTStblTrackRecord));
+	myTrack.fTrackAtom = *theTrackAtom;
+
+	myErr = QTStbl_ReadTrackHeader(theReader, &myTrack);
+	if (myErr == noErr)
+		myErr = QTAtom_FindChild(theReader, theTrackAtom, kAtomTypeMedia, 1, &myMedia);
+	if (myErr == noErr)
+		myErr = QTStbl_ReadMediaHeaders(theReader, &myMedia, &myTrack);
+	if (myErr == noErr)
+		myErr = QTAtom_FindPath(theReader, &myMedia, kSampleTablePath, 2, &mySampleTable);
+	if (myErr != noErr)
+		return(myErr);
+
+	theInfo->fTrackID = myTrack.fTrackID;
+	theInfo->fHandlerType = myTrack.fHandlerType;
+	theInfo->fTimeScale = myTrack.fTimeScale;
+
+	// the sample count is in the same place in both kinds of sample size atom
+	if (QTAtom_FindChild(theReader, &mySampleTable, kAtomTypeSampleSize, 1, &myAtom) != noErr) {
+		myErr = QTAtom_FindChild(theReader, &mySampleTable, kAtomTypeCompactSampleSize, 1, &myAtom);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	if (myAtom.fSize < myAtom.fHeaderSize + sizeof(myHeader))
+		return(invalidAtomErr);
+
+	myErr = theReader->fRead(theReader->fRefCon, myAtom.fOffset + myAtom.fHeaderSize, myHeader, sizeof(myHeader));
+	if (myErr != noErr)
+		return(myErr);
+
+	theInfo->fFrameCount = QTAtom_GetBE32(myHeader + 8);
+
+	// time-to-sample
+	myErr = QTAtom_FindChild(theReader, &mySampleTable, kAtomTypeTimeToSample, 1, &myAtom);
+	if (myErr != noErr)
+		return(myErr);
+
+	return(QTStbl_SumTimeEntries(theReader, &myAtom, theInfo));
+}
+
+
+//////////
+//
+// QTStbl_SumTimeEntries
+// Add up the entries of an 'stts' atom for the theInfo->fFrameCount samples of a track.
+//
+// We treat the tables the way QTStbl_NextSample does: entries past the last sample are ignored, and
+// samples past the last entry last no time. The frame rate is constant if every entry has the same
+// duration, except that the very last sample may differ; muxers often shorten it to make the track
+// end exactly where the audio does.
+//
+//////////
+
+static OSErr QTStbl_SumTimeEntries (QTAtomReaderPtr theReader, QTAtomHeaderPtr theAtom, QTStblFrameInfoPtr theInfo)
+{
+	UInt8					myEntries[8 * kStblTimeEntryWindow];
+	UInt8					myHeader[8];
+	QTUInt64				myOffset;
+	UInt32					myEntryCount;
+	UInt32					myRemaining = theInfo->fFrameCount;
+	UInt32					myFrameDuration = 0;
+	Boolean					myHaveDuration = false;
+	Boolean					myOddLastFrame = false;
+	Boolean					myConstant = true;
+	OSErr					myErr = noErr;
+
+	if (theAtom->fSize < theAtom->fHeaderSize + sizeof(myHeader))
+		return(invalidAtomErr);
+
+	myOffset = theAtom->fOffset + theAtom->fHeaderSize;
+	myErr = theReader->fRead(theReader->fRefCon, myOffset, myHeader, sizeof(myHeader));
+	if (myErr != noErr)
+		return(myErr);
+
+	myEntryCount = QTAtom_GetBE32(myHeader + 4);
+	if (myEntryCount > (theAtom->fSize - theAtom->fHeaderSize - sizeof(myHeader)) / 8)
+		return(invalidAtomErr);
+
+	myOffset += sizeof(myHeader);
+
+	while ((myEntryCount > 0) && (myRemaining > 0)) {
+		UInt32				myWindow = (myEntryCount < kStblTimeEntryWindow) ? myEntryCount : kStblTimeEntryWindow;
+		UInt32				myIndex;
+
+		myErr = theReader->fRead(theReader->fRefCon, myOffset, myEntries, 8 * myWindow);
+		if (myErr != noErr)
+			return(myErr);
+
+		for (myIndex = 0; (myIndex < myWindow) && (myRemaining > 0); myIndex++) {
+			UInt32			myCount = QTAtom_GetBE32(myEntries + (8 * myIndex));
+			UInt32			myDuration = QTAtom_GetBE32(myEntries + (8 * myIndex) + 4);
+
+			if (myCount == 0)
+				continue;
+			if (myCount > myRemaining)
+				myCount = myRemaining;
+
+			// an odd frame is allowed only at the very end
+			if (myOddLastFrame)
+				myConstant = false;
+
+			if (!myHaveDuration) {
+				myFrameDuration = myDuration;
+				theInfo->fMinFrameDuration = myDuration;
+				theInfo->fMaxFrameDuration = myDuration;
+				myHaveDuration = true;
+			} else if (myDuration != myFrameDuration) {
+				if (myCount == 1)
+					myOddLastFrame = true;
+				else
+					myConstant = false;
+			}
+
+			if (myDuration < theInfo->fMinFrameDuration)
+				theInfo->fMinFrameDuration = myDuration;
+			if (myDuration > theInfo->fMaxFrameDuration)
+				theInfo->fMaxFrameDuration = myDuration;
+
+			theInfo->fDuration += (QTUInt64)myCount * myDuration;
+			theInfo->fTimeEntryCount++;
+			myRemaining -= myCount;
+		}
+
+		myEntryCount -= myWindow;
+		myOffset += 8 * myWindow;
+	}
+
+	// samples that no entry covers last no time at all
+	if (myRemaining > 0) {
+		theInfo->fMinFrameDuration = 0;
+		myConstant = false;
+	}
+
+	theInfo->fConstantFrameRate = (myHaveDuration && myConstant);
+	theInfo->fFrameDuration = theInfo->fConstantFrameRate ? myFrameDuration : 0;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTStbl_GetMovieFrameInfo
+// Count the frames of every track in a movie, in one pass over the movie atom.
+//
+// We fill in the first theMaxTracks elements of theInfo and return the number of tracks in the movie.
+//
+//////////
+
+OSErr QTStbl_GetMovieFrameInfo (QTAtomReaderPtr theReader, QTStblFrameInfoPtr theInfo, long theMaxTracks, long *theTrackCount)
+{
+	QTAtomHeaderRecord		myMovie;
+	QTAtomHeaderRecord		myAtom;
+	QTUInt64				myOffset;
+	QTUInt64				myEnd;
+	OSErr					myErr = noErr;
+
+	*theTrackCount = 0;
+
+	if (QTAtom_FindTopLevel(theReader, kAtomTypeMovie, &myMovie) != noErr)
+		return(invalidMovie);
+
+	myOffset = myMovie.fOffset + myMovie.fHeaderSize;
+	myEnd = myMovie.fOffset + myMovie.fSize;
+
+	while (myOffset < myEnd) {
+		myErr = QTAtom_ReadHeader(theReader, myOffset, myEnd, &myAtom);
+		if (myErr != noErr)
+			return(myErr);
+
+		if (myAtom.fType == kAtomTypeTrack) {
+			if (*theTrackCount < theMaxTracks) {
+				myErr = QTStbl_GetTrackFrameInfo(theReader, &myAtom, &theInfo[*theTrackCount]);
+				if (myErr != noErr)
+					return(myErr);
+			}
+
+			(*theTrackCount)++;
+		}
+
+		myOffset += myAtom.fSize;
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTStbl_WriteFrameInfo
+// Write the frame counts of a file's tracks to theStream, as one line of JSON.
+//
+//////////
+
+void QTStbl_WriteFrameInfo (FILE *theStream, const char *thePath, OSErr theErr, QTStblFrameInfoPtr theInfo, long theTrackCount)
+{
+	long					myIndex;
+
+	fputs("{\"file\":", theStream);
+	QTSys_WriteJSONString(theStream, thePath);
+	fprintf(theStream, ",\"err\":%d", (int)theErr);
+
+	if (theErr == noErr) {
+		fprintf(theStream, ",\"trackCount\":%ld,\"tracks\":[", theTrackCount);
+
+		for (myIndex = 0; (myIndex < theTrackCount) && (myIndex < kStblMaxFrameInfoTracks); myIndex++) {
+			QTStblFrameInfoPtr	myTrack = &theInfo[myIndex];
+
+			fprintf(theStream, "%s{\"id\":%lu,\"handler\":", (myIndex > 0) ? "," : "", (unsigned long)myTrack->fTrackID);
+			QTStbl_WriteFourCharCode(theStream, myTrack->fHandlerType);
+			fprintf(theStream, ",\"timeScale\":%lu,\"frames\":%lu,\"duration\":%llu,\"timeEntries\":%lu,\"minFrameDuration\":%lu,\"maxFrameDuration\":%lu,\"constantFrameRate\":%s",
+						(unsigned long)myTrack->fTimeScale,
+						(unsigned long)myTrack->fFrameCount,
+						(unsigned long long)myTrack->fDuration,
+						(unsigned long)myTrack->fTimeEntryCount,
+						(unsigned long)myTrack->fMinFrameDuration,
+						(unsigned long)myTrack->fMaxFrameDuration,
+						myTrack->fConstantFrameRate ? "true" : "false");
+
+			if (myTrack->fTimeScale != 0)
+				fprintf(theStream, ",\"seconds\":%.3f", (double)myTrack->fDuration / (double)myTrack->fTimeScale);
+
+			if (myTrack->fConstantFrameRate)
+				fprintf(theStream, ",\"frameDuration\":%lu", (unsigned long)myTrack->fFrameDuration);
+
+			// the nominal rate of a constant-rate track, or else the average rate
+			if (myTrack->fConstantFrameRate && (myTrack->fFrameDuration != 0))
+				fprintf(theStream, ",\"fps\":%.3f", (double)myTrack->fTimeScale / (double)myTrack->fFrameDuration);
+			else if (myTrack->fDuration != 0)
+				fprintf(theStream, ",\"fps\":%.3f", (double)myTrack->fFrameCount * (double)myTrack->fTimeScale / (double)myTrack->fDuration);
+
+			fputc('}', theStream);
+		}
+
+		fputc(']', theStream);
+	}
+
+	fputs("}\n", theStream);
+}
+
+
+//////////
+//
+// QTStbl_WriteFourCharCode
+// Write a four-character code as a JSON string, replacing unprintable characters with '?'.
+//
+//////////
+
+static void QTStbl_WriteFourCharCode (FILE *theStream, OSType theCode)
+{
+	char					myString[5];
+	long					myIndex;
+
+	for (myIndex = 0; myIndex < 4; myIndex++) {
+		myString[myIndex] = (char)((theCode >> (24 - (8 * myIndex))) & 0xFF);
+		if ((myString[myIndex] < 0x20) || (myString[myIndex] > 0x7E))
+			myString[myIndex] = '?';
+	}
+
+	myString[4] = '\0';
+	QTSys_WriteJSONString(theStream, myString);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTStbl_RunBenchmark
+// Time counting the frames of long synthetic tracks by stepping through every sample, and by summing
+// the sample tables, and write a report to theReport.
+//
+// The movie has a 29.97 fps video track, a variable-rate video track with short runs of 24 and 30 fps
+// frames, and an AAC sound track, each theHours long. Stepping reads the whole sample table and walks
+// it with QTStbl_NextSample, one call per frame, just as QTUtils_GetFrameCount makes one call to
+// GetTrackNextInterestingTime per frame; we check that both ways give the same answers.
+//
+//////////
+
+OSErr QTStbl_RunBenchmark (FILE *theReport, long theHours, long theIterations)
+{
+	static const char		*myMethodNames[] = {"stepping", "tables"};
+	QTAtomBufferRecord		myBuffer;
+	QTAtomReaderRecord		myReader;
+	QTAtomHeaderRecord		myMovie;
+	QTAtomHeaderRecord		myTracks[kStblMaxBenchmarkTracks];
+	QTStblFrameInfoRecord	myInfo[2][kStblMaxBenchmarkTracks];
+	QTUInt64				myWallTimes[2][kStblMaxBenchmarkTracks];
+	long					myTrackIndex;
+	long					myMethod;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theHours <= 0)
+		theHours = kStblDefaultBenchmarkHours;
+	if (theIterations <= 0)
+		theIterations = kStblDefaultBenchmarkIterations;
+
+	QTAtom_InitBuffer(&myBuffer);
+	QTStbl_BuildSampleMovie(&myBuffer, theHours);
+	myErr = myBuffer.fErr;
+	if (myErr != noErr)
+		goto bail;
+
+	QTAtom_InitMemoryReader(&myReader, myBuffer.fData, myBuffer.fSize);
+
+	myErr = QTAtom_FindTopLevel(&myReader, kAtomTypeMovie, &myMovie);
+	for (myTrackIndex = 0; (myErr == noErr) && (myTrackIndex < kStblMaxBenchmarkTracks); myTrackIndex++)
+		myErr = QTAtom_FindChild(&myReader, &myMovie, kAtomTypeTrack, myTrackIndex + 1, &myTracks[myTrackIndex]);
+	if (myErr != noErr)
+		goto bail;
+
+	for (myTrackIndex = 0; myTrackIndex < kStblMaxBenchmarkTracks; myTrackIndex++) {
+		for (myMethod = 0; myMethod < 2; myMethod++) {
+			QTUInt64		myStartTime = QTSys_GetMicroseconds();
+
+			for (myIndex = 0; myIndex < theIterations; myIndex++) {
+				if (myMethod == 0)
+					myErr = QTStbl_StepTrack(&myReader, &myTracks[myTrackIndex], &myInfo[myMethod][myTrackIndex]);
+				else
+					myErr = QTStbl_GetTrackFrameInfo(&myReader, &myTracks[myTrackIndex], &myInfo[myMethod][myTrackIndex]);
+				if (myErr != noErr)
+					goto bail;
+			}
+
+			myWallTimes[myMethod][myTrackIndex] = QTSys_GetMicroseconds() - myStartTime;
+		}
+
+		// both ways must agree
+		if ((myInfo[0][myTrackIndex].fFrameCount != myInfo[1][myTrackIndex].fFrameCount) ||
+			(myInfo[0][myTrackIndex].fDuration != myInfo[1][myTrackIndex].fDuration) ||
+			(myInfo[0][myTrackIndex].fConstantFrameRate != myInfo[1][myTrackIndex].fConstantFrameRate) ||
+			(myInfo[0][myTrackIndex].fFrameDuration != myInfo[1][myTrackIndex].fFrameDuration)) {
+			myErr = invalidAtomErr;
+			goto bail;
+		}
+	}
+
+	if (theReport != NULL) {
+		for (myTrackIndex = 0; myTrackIndex < kStblMaxBenchmarkTracks; myTrackIndex++) {
+			QTStblFrameInfoPtr	myTrack = &myInfo[1][myTrackIndex];
+
+			for (myMethod = 0; myMethod < 2; myMethod++) {
+				fprintf(theReport, "{\"benchmark\":\"framecount\",\"method\":\"%s\",\"hours\":%ld,\"track\":%lu,\"handler\":",
+							myMethodNames[myMethod],
+							theHours,
+							(unsigned long)myTrack->fTrackID);
+				QTStbl_WriteFourCharCode(theReport, myTrack->fHandlerType);
+				fprintf(theReport, ",\"frames\":%lu,\"duration\":%llu,\"timeEntries\":%lu,\"constantFrameRate\":%s,\"iterations\":%ld,\"wallMicroseconds\":%llu,\"microsecondsPerCount\":%.2f}\n",
+							(unsigned long)myTrack->fFrameCount,
+							(unsigned long long)myTrack->fDuration,
+							(unsigned long)myTrack->fTimeEntryCount,
+							myTrack->fConstantFrameRate ? "true" : "false",
+							theIterations,
+							(unsigned long long)myWallTimes[myMethod][myTrackIndex],
+							(double)myWallTimes[myMethod][myTrackIndex] / (double)theIterations);
+			}
+
+			fprintf(theReport, "{\"benchmark\":\"framecount\",\"track\":%lu,\"speedup\":%.1f}\n",
+						(unsigned long)myTrack->fTrackID,
+						(double)myWallTimes[0][myTrackIndex] / (double)((myWallTimes[1][myTrackIndex] > 0) ? myWallTimes[1][myTrackIndex] : 1));
+		}
+
+		fflush(theReport);
+	}
+
+bail:
+	QTAtom_DisposeBuffer(&myBuffer);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTStbl_StepTrack
+// Count the frames of a track the slow way, by reading its sample tables and visiting every sample.
+//
+//////////
+
+static OSErr QTStbl_StepTrack (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrackAtom, QTStblFrameInfoPtr theInfo)
+{
+	QTStblTrackRecord		myTrack;
+	QTStblIteratorRecord	myIterator;
+	QTStblSampleRecord		mySample;
+	Boolean					myOddLastFrame = false;
+	OSErr					myErr = noErr;
+
+	memset(theInfo, 0, sizeof(QTStblFrameInfoRecord));
+
+	myErr = QTStbl_ReadTrack(theReader, theTrackAtom, &myTrack);
+	if (myErr != noErr)
+		return(myErr);
+
+	theInfo->fTrackID = myTrack.fTrackID;
+	theInfo->fHandlerType = myTrack.fHandlerType;
+	theInfo->fTimeScale = myTrack.fTimeScale;
+	theInfo->fConstantFrameRate = true;
+
+	QTStbl_InitIterator(&myTrack, &myIterator);
+	while (QTStbl_NextSample(&myIterator, &mySample)) {
+		if (theInfo->fFrameCount == 0) {
+			theInfo->fFrameDuration = mySample.fDuration;
+			theInfo->fMinFrameDuration = mySample.fDuration;
+			theInfo->fMaxFrameDuration = mySample.fDuration;
+		} else {
+			if (myOddLastFrame)
+				theInfo->fConstantFrameRate = false;
+			if (mySample.fDuration != theInfo->fFrameDuration)
+				myOddLastFrame = true;
+		}
+
+		if (mySample.fDuration < theInfo->fMinFrameDuration)
+			theInfo->fMinFrameDuration = mySample.fDuration;
+		if (mySample.fDuration > theInfo->fMaxFrameDuration)
+			theInfo->fMaxFrameDuration = mySample.fDuration;
+
+		theInfo->fDuration += mySample.fDuration;
+		theInfo->fFrameCount++;
+	}
+
+	if (theInfo->fFrameCount == 0)
+		theInfo->fConstantFrameRate = false;
+	if (!theInfo->fConstantFrameRate)
+		theInfo->fFrameDuration = 0;
+
+	QTStbl_DisposeTrack(&myTrack);
+	return(noErr);
+}
+
+
+//////////
+//
+// QTStbl_BuildSampleMovie
+// Build the benchmark's movie in theBuffer: three tracks, each theHours long, with no media data.
+//
+//////////
+
+static void QTStbl_BuildSampleMovie (QTAtomBufferPtr theBuffer, long theHours)
+{
+	QTStblTimeEntryRecord	myEntry;
+	QTStblTimeEntryPtr		myEntries;
+	UInt32					myEntryCount = 0;
+	UInt32					myFrameCount = 0;
+	UInt32					myFrames;
+	UInt32					myMovie;
+	UInt32					myAtom;
+	UInt32					mySeed = 0x2545F491;
+
+	myMovie = QTAtom_BeginAtom(theBuffer, kAtomTypeMovie);
+
+	// the movie header (version 0)
+	myAtom = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMovieHeader, 0, 0);
+	QTAtom_Append32(theBuffer, 0);								// creation time
+	QTAtom_Append32(theBuffer, 0);								// modification time
+	QTAtom_Append32(theBuffer, 600);							// time scale
+	QTAtom_Append32(theBuffer, (UInt32)theHours * 3600 * 600);	// duration
+	QTAtom_Append32(theBuffer, 0x00010000);						// preferred rate
+	QTAtom_Append16(theBuffer, 0x0100);							// preferred volume
+	QTAtom_AppendZeros(theBuffer, 10);
+	QTAtom_AppendZeros(theBuffer, 36);							// matrix
+	QTAtom_AppendZeros(theBuffer, 24);							// preview and poster times, selection, current time
+	QTAtom_Append32(theBuffer, kStblMaxBenchmarkTracks + 1);	// next track ID
+	QTAtom_EndAtom(theBuffer, myAtom);
+
+	// 29.97 fps video: one 'stts' entry, and a size for every frame
+	myEntry.fCount = (UInt32)(((QTUInt64)theHours * 3600 * 30000) / 1001);
+	myEntry.fDuration = 1001;
+	QTStbl_AppendSampleTrack(theBuffer, 1, kAtomHandlerVideo, 30000, &myEntry, 1, 0, 10);
+
+	// variable-rate video: runs of 1 to 8 frames at 24 or 30 fps, ending with one short frame
+	myFrames = (UInt32)theHours * 3600 * 27;
+	myEntries = (QTStblTimeEntryPtr)malloc(((size_t)myFrames + 1) * sizeof(QTStblTimeEntryRecord));
+	if (myEntries == NULL) {
+		theBuffer->fErr = memFullErr;
+		return;
+	}
+
+	while (myFrameCount < myFrames - 1) {
+		mySeed ^= mySeed << 13;
+		mySeed ^= mySeed >> 17;
+		mySeed ^= mySeed << 5;
+
+		myEntries[myEntryCount].fCount = 1 + (mySeed % 8);
+		if (myEntries[myEntryCount].fCount > myFrames - 1 - myFrameCount)
+			myEntries[myEntryCount].fCount = myFrames - 1 - myFrameCount;
+		myEntries[myEntryCount].fDuration = ((myEntryCount % 2) == 0) ? 3750 : 3000;
+		myFrameCount += myEntries[myEntryCount++].fCount;
+	}
+	myEntries[myEntryCount].fCount = 1;
+	myEntries[myEntryCount++].fDuration = 1500;
+
+	QTStbl_AppendSampleTrack(theBuffer, 2, kAtomHandlerVideo, 90000, myEntries, myEntryCount, 0, 10);
+	free(myEntries);
+
+	// AAC sound: 1024 samples per frame, all the same size
+	myEntry.fCount = (UInt32)(((QTUInt64)theHours * 3600 * 44100 + 1023) / 1024);
+	myEntry.fDuration = 1024;
+	QTStbl_AppendSampleTrack(theBuffer, 3, kAtomHandlerSound, 44100, &myEntry, 1, 371, 43);
+
+	QTAtom_EndAtom(theBuffer, myMovie);
+}
+
+
+//////////
+//
+// QTStbl_AppendSampleTrack
+// Append a track with the specified time-to-sample entries to theBuffer.
+//
+// If theUniformSampleSize is 0, every sample gets its own size; the chunk offsets are made up, since
+// there's no media data.
+//
+//////////
+
+static void QTStbl_AppendSampleTrack (QTAtomBufferPtr theBuffer, UInt32 theTrackID, OSType theHandlerType, UInt32 theTimeScale, const QTStblTimeEntryRecord *theEntries, UInt32 theEntryCount, UInt32 theUniformSampleSize, UInt32 theSamplesPerChunk)
+{
+	UInt32					myAtoms[5];
+	UInt32					mySampleCount = 0;
+	QTUInt64				myDuration = 0;
+	UInt32					myChunkCount;
+	UInt32					myIndex;
+	Boolean					myIsVideo = (theHandlerType == kAtomHandlerVideo);
+
+	for (myIndex = 0; myIndex < theEntryCount; myIndex++) {
+		mySampleCount += theEntries[myIndex].fCount;
+		myDuration += (QTUInt64)theEntries[myIndex].fCount * theEntries[myIndex].fDuration;
+	}
+	myChunkCount = (mySampleCount + theSamplesPerChunk - 1) / theSamplesPerChunk;
+
+	myAtoms[0] = QTAtom_BeginAtom(theBuffer, kAtomTypeTrack);
+
+	// the track header (version 0)
+	myAtoms[1] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTrackHeader, 0, 0x0F);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, theTrackID);
+	QTAtom_Append32(theBuffer, 0);
+	QTAtom_Append32(theBuffer, (UInt32)(myDuration * 600 / theTimeScale));
+	QTAtom_AppendZeros(theBuffer, 8);
+	QTAtom_Append16(theBuffer, 0);								// layer
+	QTAtom_Append16(theBuffer, 0);								// alternate group
+	QTAtom_Append16(theBuffer, myIsVideo ? 0 : 0x0100);			// volume
+	QTAtom_Append16(theBuffer, 0);
+	QTAtom_AppendZeros(theBuffer, 36);							// matrix
+	QTAtom_Append32(theBuffer, myIsVideo ? (1920UL << 16) : 0);
+	QTAtom_Append32(theBuffer, myIsVideo ? (1080UL << 16) : 0);
+	QTAtom_EndAtom(theBuffer, myAtoms[1]);
+
+	myAtoms[1] = QTAtom_BeginAtom(theBuffer, kAtomTypeMedia);
+
+	// the media header (version 1, so long tracks can't overflow it)
+	myAtoms[2] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMediaHeader, 1, 0);
+	QTAtom_Append64(theBuffer, 0);
+	QTAtom_Append64(theBuffer, 0);
+	QTAtom_Append32(theBuffer, theTimeScale);
+	QTAtom_Append64(theBuffer, myDuration);
+	QTAtom_Append16(theBuffer, 0);								// language
+	QTAtom_Append16(theBuffer, 0);								// quality
+	QTAtom_EndAtom(theBuffer, myAtoms[2]);
+
+	myAtoms[2] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeHandler, 0, 0);
+	QTAtom_Append32(theBuffer, kAtomHandlerMedia);
+	QTAtom_Append32(theBuffer, theHandlerType);
+	QTAtom_AppendZeros(theBuffer, 12);
+	QTAtom_Append8(theBuffer, 0);								// empty name
+	QTAtom_EndAtom(theBuffer, myAtoms[2]);
+
+	myAtoms[2] = QTAtom_BeginAtom(theBuffer, kAtomTypeMediaInfo);
+	myAtoms[3] = QTAtom_BeginAtom(theBuffer, kAtomTypeSampleTable);
+
+	// a sample description with nothing but its type
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleDesc, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, 16);
+	QTAtom_Append32(theBuffer, myIsVideo ? FOUR_CHAR_CODE('avc1') : FOUR_CHAR_CODE('mp4a'));
+	QTAtom_AppendZeros(theBuffer, 6);
+	QTAtom_Append16(theBuffer, 1);								// data reference index
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeTimeToSample, 0, 0);
+	QTAtom_Append32(theBuffer, theEntryCount);
+	for (myIndex = 0; myIndex < theEntryCount; myIndex++) {
+		QTAtom_Append32(theBuffer, theEntries[myIndex].fCount);
+		QTAtom_Append32(theBuffer, theEntries[myIndex].fDuration);
+	}
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleToChunk, 0, 0);
+	QTAtom_Append32(theBuffer, 1);
+	QTAtom_Append32(theBuffer, 1);								// first chunk
+	QTAtom_Append32(theBuffer, theSamplesPerChunk);
+	QTAtom_Append32(theBuffer, 1);								// sample description index
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeSampleSize, 0, 0);
+	QTAtom_Append32(theBuffer, theUniformSampleSize);
+	QTAtom_Append32(theBuffer, mySampleCount);
+	if (theUniformSampleSize == 0) {
+		for (myIndex = 0; myIndex < mySampleCount; myIndex++)
+			QTAtom_Append32(theBuffer, ((myIndex % 12) == 0) ? 60000 : 8000 + (myIndex % 7) * 500);
+	}
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	myAtoms[4] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeChunkOffset, 0, 0);
+	QTAtom_Append32(theBuffer, myChunkCount);
+	for (myIndex = 0; myIndex < myChunkCount; myIndex++)
+		QTAtom_Append32(theBuffer, 4096 + (myIndex * 4096));
+	QTAtom_EndAtom(theBuffer, myAtoms[4]);
+
+	QTAtom_EndAtom(theBuffer, myAtoms[3]);
+	QTAtom_EndAtom(theBuffer, myAtoms[2]);
+	QTAtom_EndAtom(theBuffer, myAtoms[1]);
+	QTAtom_EndAtom(theBuffer, myAtoms[0]);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTStbl_IsFrameCountCommandLine
+// Does the command line ask us to count frames or run the frame-counting benchmark?
+//
+//////////
+
+Boolean QTStbl_IsFrameCountCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if ((strcmp(theArgv[myIndex], kStblFrameCountSwitch) == 0) || (strcmp(theArgv[myIndex], kStblBenchmarkSwitch) == 0))
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTStbl_Main
+// Count the frames of files, or run the frame-counting benchmark. Returns one of the kStblExit constants.
+//
+// Usage: -framecount <file> ... [-report <file>]
+//        -framebench [-hours <count>] [-iterations <count>] [-report <file>]
+//
+// When counting frames, we write one line of JSON per file, and fail if any file can't be read.
+//
+//////////
+
+int QTStbl_Main (int theArgc, char *theArgv[])
+{
+	const char				*myMode = NULL;
+	const char				*myReportPath = NULL;
+	long					myHours = 0;
+	long					myIterations = 0;
+	long					myFileCount = 0;
+	long					myFailedCount = 0;
+	FILE					*myReport = stdout;
+	QTStblFrameInfoRecord	myInfo[kStblMaxFrameInfoTracks];
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kStblFrameCountSwitch) == 0) || (strcmp(theArgv[myIndex], kStblBenchmarkSwitch) == 0)) {
+			if (myMode == NULL)
+				myMode = theArgv[myIndex];
+		} else if ((strcmp(theArgv[myIndex], kStblHoursSwitch) == 0) && (myIndex + 1 < theArgc))
+			myHours = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kStblIterationsSwitch) == 0) && (myIndex + 1 < theArgc))
+			myIterations = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kStblReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+		else if ((myMode != NULL) && (theArgv[myIndex][0] != '-'))
+			myFileCount++;
+	}
+
+	if ((myMode == NULL) || ((strcmp(myMode, kStblFrameCountSwitch) == 0) && (myFileCount == 0)) || (myHours < 0) || (myHours > 24) || (myIterations < 0)) {
+		fprintf(stderr, "usage: %s %s <file> ... [%s <file>]\n", theArgv[0], kStblFrameCountSwitch, kStblReportSwitch);
+		fprintf(stderr, "       %s %s [%s <1-24>] [%s <count>] [%s <file>]\n", theArgv[0], kStblBenchmarkSwitch, kStblHoursSwitch, kStblIterationsSwitch, kStblReportSwitch);
+		return(kStblExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kStblExitUsage);
+		}
+	}
+
+	if (strcmp(myMode, kStblBenchmarkSwitch) == 0) {
+		myErr = QTStbl_RunBenchmark(myReport, myHours, myIterations);
+		if (myErr != noErr)
+			fprintf(stderr, "frame count benchmark failed (error %d)\n", (int)myErr);
+	} else {
+		// the files are the arguments after -framecount that aren't switches or switch values
+		for (myIndex = 1; myIndex < theArgc; myIndex++) {
+			QTAtomReaderRecord	myReader;
+			long				myTrackCount = 0;
+
+			if ((strcmp(theArgv[myIndex], kStblReportSwitch) == 0) || (strcmp(theArgv[myIndex], kStblHoursSwitch) == 0) ||
+				(strcmp(theArgv[myIndex], kStblIterationsSwitch) == 0)) {
+				myIndex++;
+				continue;
+			}
+
+			if (theArgv[myIndex][0] == '-')
+				continue;
+
+			myErr = QTAtom_OpenFileReader(theArgv[myIndex], &myReader);
+			if (myErr == noErr) {
+				myErr = QTStbl_GetMovieFrameInfo(&myReader, myInfo, kStblMaxFrameInfoTracks, &myTrackCount);
+				QTAtom_CloseFileReader(&myReader);
+			}
+
+			if (myErr != noErr)
+				myFailedCount++;
+
+			QTStbl_WriteFrameInfo(myReport, theArgv[myIndex], myErr, myInfo, myTrackCount);
+		}
+
+		fflush(myReport);
+		myErr = (myFailedCount > 0) ? ioErr : noErr;
+	}
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kStblExitSuccess : kStblExitFailed);
+}
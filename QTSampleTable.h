@@ -0,0 +1,165 @@
+//////////
+//
+//	File:		QTSampleTable.h
+//
+//	Contains:	Portable functions for reading the track and sample tables of QuickTime and MPEG-4 files.
+//				All utilities start with the prefix "QTStbl_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTSampleTable__
+#define __QTSampleTable__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTAtoms.h"
+#include "QTSwap.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kStblFrameCountSwitch				"-framecount"			// command-line switch that counts the frames of the files that follow it
+#define kStblBenchmarkSwitch				"-framebench"			// command-line switch that selects the frame-counting benchmark
+#define kStblHoursSwitch					"-hours"				// length of the benchmark's synthetic tracks
+#define kStblIterationsSwitch				"-iterations"			// number of counts of each kind
+#define kStblReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kStblMaxFrameInfoTracks				64						// tracks that -framecount reports on
+#define kStblDefaultBenchmarkHours			1
+#define kStblDefaultBenchmarkIterations		20
+
+// exit codes returned by QTStbl_Main
+enum {
+	kStblExitSuccess						= 0,
+	kStblExitFailed							= 1,
+	kStblExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// one 'stts' entry: fCount samples, each fDuration long
+typedef struct QTStblTimeEntryRecord {
+	UInt32					fCount;
+	UInt32					fDuration;
+} QTStblTimeEntryRecord, *QTStblTimeEntryPtr;
+
+// one 'stsc' entry: from chunk fFirstChunk (1-based) on, each chunk holds fSamplesPerChunk samples
+typedef struct QTStblChunkEntryRecord {
+	UInt32					fFirstChunk;
+	UInt32					fSamplesPerChunk;
+	UInt32					fDescIndex;
+} QTStblChunkEntryRecord, *QTStblChunkEntryPtr;
+
+// one track, with its sample tables in host byte order
+typedef struct QTStblTrackRecord {
+	QTAtomHeaderRecord		fTrackAtom;				// the 'trak' atom
+	UInt32					fTrackID;
+	OSType					fHandlerType;			// for instance, 'vide' or 'soun'
+	OSType					fSampleFormat;			// the type of the first sample description
+	UInt32					fWidth;					// from the track header, in pixels
+	UInt32					fHeight;
+	UInt32					fTimeScale;				// the media time scale
+	QTUInt64				fDuration;				// the media duration, in fTimeScale units
+	QTUInt64				fMovieDuration;			// the track duration, in the movie's time scale
+
+	UInt32					fSampleCount;
+	UInt32					fUniformSampleSize;		// the size of every sample, or 0 if fSampleSizes holds them
+	UInt32					*fSampleSizes;
+	QTStblTimeEntryPtr		fTimeEntries;
+	UInt32					fTimeEntryCount;
+	QTStblChunkEntryPtr		fChunkEntries;
+	UInt32					fChunkEntryCount;
+	QTUInt64				*fChunkOffsets;
+	UInt32					fChunkCount;
+} QTStblTrackRecord, *QTStblTrackPtr;
+
+typedef struct QTStblMovieRecord {
+	QTAtomHeaderRecord		fMovieAtom;				// the 'moov' atom
+	QTAtomHeaderRecord		fMovieHeaderAtom;		// the 'mvhd' atom
+	Boolean					fIsQuickTime;			// true for QuickTime movies, false for other MPEG-4 brands
+	UInt32					fTimeScale;
+	QTUInt64				fDuration;
+	UInt32					fNextTrackID;
+	QTStblTrackPtr			fTracks;
+	long					fTrackCount;
+} QTStblMovieRecord, *QTStblMoviePtr;
+
+// the frame count and duration of one track, read from its 'stts' and 'stsz' atoms alone
+typedef struct QTStblFrameInfoRecord {
+	UInt32					fTrackID;
+	OSType					fHandlerType;
+	UInt32					fTimeScale;				// the media time scale
+	UInt32					fFrameCount;			// the number of samples in the media
+	QTUInt64				fDuration;				// the sum of the sample durations, in fTimeScale units
+	UInt32					fTimeEntryCount;		// the number of 'stts' entries we summed
+	Boolean					fConstantFrameRate;		// true if every frame (except perhaps the last) has the same duration
+	UInt32					fFrameDuration;			// that duration, if fConstantFrameRate is true; otherwise 0
+	UInt32					fMinFrameDuration;
+	UInt32					fMaxFrameDuration;
+} QTStblFrameInfoRecord, *QTStblFrameInfoPtr;
+
+// one sample, as returned by QTStbl_NextSample
+typedef struct QTStblSampleRecord {
+	UInt32					fNumber;				// 1-based, as in the file format
+	UInt32					fChunk;					// 1-based
+	QTUInt64				fOffset;				// file offset of the sample data
+	UInt32					fSize;
+	QTUInt64				fTime;					// decode time, in the media time scale
+	UInt32					fDuration;
+} QTStblSampleRecord, *QTStblSamplePtr;
+
+// walks the samples of a track in order, without expanding the tables
+typedef struct QTStblIteratorRecord {
+	QTStblTrackPtr			fTrack;
+	UInt32					fNextSample;			// 0-based index of the next sample
+	UInt32					fTimeEntry;
+	UInt32					fTimeRemaining;			// samples left in fTimeEntry
+	UInt32					fChunkEntry;
+	UInt32					fChunk;					// 0-based index of the current chunk
+	UInt32					fSamplesLeftInChunk;
+	QTUInt64				fOffset;				// file offset of the next sample
+	QTUInt64				fTime;					// decode time of the next sample
+} QTStblIteratorRecord, *QTStblIteratorPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTStbl_ReadMovie (QTAtomReaderPtr theReader, QTStblMoviePtr theMovie);
+void						QTStbl_DisposeMovie (QTStblMoviePtr theMovie);
+OSErr						QTStbl_ReadTrack (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrackAtom, QTStblTrackPtr theTrack);
+void						QTStbl_DisposeTrack (QTStblTrackPtr theTrack);
+
+UInt32						QTStbl_GetSampleSize (QTStblTrackPtr theTrack, UInt32 theSampleNumber);
+void						QTStbl_InitIterator (QTStblTrackPtr theTrack, QTStblIteratorPtr theIterator);
+Boolean						QTStbl_NextSample (QTStblIteratorPtr theIterator, QTStblSamplePtr theSample);
+
+OSErr						QTStbl_GetTrackFrameInfo (QTAtomReaderPtr theReader, QTAtomHeaderPtr theTrackAtom, QTStblFrameInfoPtr theInfo);
+OSErr						QTStbl_GetMovieFrameInfo (QTAtomReaderPtr theReader, QTStblFrameInfoPtr theInfo, long theMaxTracks, long *theTrackCount);
+void						QTStbl_WriteFrameInfo (FILE *theStream, const char *thePath, OSErr theErr, QTStblFrameInfoPtr theInfo, long theTrackCount);
+
+OSErr						QTStbl_RunBenchmark (FILE *theReport, long theHours, long theIterations);
+
+Boolean						QTStbl_IsFrameCountCommandLine (int theArgc, char *theArgv[]);
+int							QTStbl_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTSampleTable__
@@ -0,0 +1,1018 @@
+//////////
+//
+//	File:		QTScan.c
+//
+//	Contains:	A portable engine that classifies every file in a directory tree by its contents, and remembers what it found.
+//				All utilities start with the prefix "QTScan_".
+//
+//	QTDX_FileCanBeImportedInPlace asks the Component Manager for an importer for one file at a time, going
+//	by the file's type or extension. For a folder of tens of thousands of stills, sounds and movies, we do
+//	better to read the first few bytes of each file and match them against the signatures of the formats
+//	QuickTime imports (QTScan_SniffFile); QuickTime movies and MPEG-4 files are left to QTProbe.c, which
+//	reads their atoms. Only a few formats without a signature, such as raw DV, are recognized by name.
+//
+//	QTScan_ScanDirectory walks a directory tree on one thread, which is mostly waiting for the file system
+//	anyway, and classifies the files it finds on a pool of worker threads. What it finds goes into an index
+//	file: for each file, its path, size, modification time, type, importer and whether QuickTime can open
+//	it in place. The next scan of the same tree reads only the files whose size or modification time has
+//	changed, and drops the ones that are gone; entries for files outside the tree are kept as they were.
+//
+//	The index file has a 16-byte header (magic, version, entry count, bytes of path names), a 40-byte
+//	record for each entry, the path names, and a checksum of everything before it. It is replaced
+//	atomically (QTSet_WriteFile), and a damaged or out-of-date one is ignored.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTScan.h"
+#include "QTSettings.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kScanIndexHeaderSize		16
+#define kScanIndexEntrySize			40
+#define kScanIndexTrailerSize		8
+#define kScanMaxIndexEntries		(16L * 1024L * 1024L)	// we ignore index files that claim more entries than this
+
+#define kScanFlagPending			(1L << 16)				// set while an entry waits to be classified; never saved
+#define kScanSavedFlags				(kScanFlagInPlace | kScanFlagByExtension | kScanFlagFailed)
+
+// file types for what we recognize
+#define kScanTypeMovie				FOUR_CHAR_CODE('MooV')
+#define kScanTypeMPEG4				FOUR_CHAR_CODE('mpg4')
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a format we recognize by the bytes at the start of a file
+typedef struct QTScanSignatureRecord {
+	UInt32					fOffset;
+	const char				*fBytes;
+	UInt32					fLength;
+	OSType					fFileType;
+	long					fCategory;
+	long					fFlags;
+} QTScanSignatureRecord, *QTScanSignaturePtr;
+
+// a format we recognize by the file name extension alone
+typedef struct QTScanExtensionRecord {
+	const char				*fExtension;
+	OSType					fFileType;
+	long					fCategory;
+	long					fFlags;
+} QTScanExtensionRecord, *QTScanExtensionPtr;
+
+// what the workers of QTScan_ScanDirectory share
+typedef struct QTScanRunRecord {
+	QTScanIndexPtr			fIndex;
+	long					*fPending;				// indexes into fIndex of the entries to classify
+	long					fPendingCount;
+	volatile long			fNextIndex;				// into fPending
+} QTScanRunRecord, *QTScanRunPtr;
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+// longer signatures first, where one begins with another
+static const QTScanSignatureRecord	gScanSignatures[] = {
+	{0,		"\377\330\377",				3,	FOUR_CHAR_CODE('JPEG'),	kScanCategoryStill,	kScanFlagInPlace},
+	{0,		"\211PNG\r\n\032\n",		8,	FOUR_CHAR_CODE('PNGf'),	kScanCategoryStill,	kScanFlagInPlace},
+	{0,		"GIF8",						4,	FOUR_CHAR_CODE('GIFf'),	kScanCategoryStill,	kScanFlagInPlace},
+	{0,		"II*\0",					4,	FOUR_CHAR_CODE('TIFF'),	kScanCategoryStill,	kScanFlagInPlace},
+	{0,		"MM\0*",					4,	FOUR_CHAR_CODE('TIFF'),	kScanCategoryStill,	kScanFlagInPlace},
+	{0,		"8BPS",						4,	FOUR_CHAR_CODE('8BPS'),	kScanCategoryStill,	kScanFlagInPlace},
+	{0,		"BM",						2,	FOUR_CHAR_CODE('BMPf'),	kScanCategoryStill,	kScanFlagInPlace},
+	{8,		"WAVE",						4,	FOUR_CHAR_CODE('WAVE'),	kScanCategoryAudio,	kScanFlagInPlace},
+	{8,		"AVI ",						4,	FOUR_CHAR_CODE('VfW '),	kScanCategoryVideo,	kScanFlagInPlace},
+	{8,		"AIFF",						4,	FOUR_CHAR_CODE('AIFF'),	kScanCategoryAudio,	kScanFlagInPlace},
+	{8,		"AIFC",						4,	FOUR_CHAR_CODE('AIFC'),	kScanCategoryAudio,	kScanFlagInPlace},
+	{0,		".snd",						4,	FOUR_CHAR_CODE('ULAW'),	kScanCategoryAudio,	kScanFlagInPlace},
+	{0,		"ID3",						3,	FOUR_CHAR_CODE('MP3 '),	kScanCategoryAudio,	kScanFlagInPlace},
+	{0,		"MThd",						4,	FOUR_CHAR_CODE('Midi'),	kScanCategoryAudio,	0},
+	{0,		"\0\0\001\272",				4,	FOUR_CHAR_CODE('MPEG'),	kScanCategoryVideo,	kScanFlagInPlace},
+	{0,		"\0\0\001\263",				4,	FOUR_CHAR_CODE('MPEG'),	kScanCategoryVideo,	kScanFlagInPlace},
+	{0,		"FWS",						3,	FOUR_CHAR_CODE('SWFL'),	kScanCategoryVideo,	kScanFlagInPlace},
+	{0,		"CWS",						3,	FOUR_CHAR_CODE('SWFL'),	kScanCategoryVideo,	kScanFlagInPlace}
+};
+
+static const QTScanExtensionRecord	gScanExtensions[] = {
+	{"dv",		FOUR_CHAR_CODE('dvc!'),	kScanCategoryVideo,	kScanFlagInPlace},
+	{"dif",		FOUR_CHAR_CODE('dvc!'),	kScanCategoryVideo,	kScanFlagInPlace},
+	{"pct",		FOUR_CHAR_CODE('PICT'),	kScanCategoryStill,	kScanFlagInPlace},
+	{"pict",	FOUR_CHAR_CODE('PICT'),	kScanCategoryStill,	kScanFlagInPlace},
+	{"txt",		FOUR_CHAR_CODE('TEXT'),	kScanCategoryText,	0}
+};
+
+// the top-level atoms a movie file may start with
+static const OSType				gScanAtomTypes[] = {
+	kAtomTypeFileType, kAtomTypeMovie, kAtomTypeMovieData, kAtomTypeFree, kAtomTypeSkip, kAtomTypeWide, FOUR_CHAR_CODE('pnot')
+};
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static UInt32				QTScan_HashPath (const char *thePath);
+static OSErr				QTScan_GrowTable (QTScanIndexPtr theIndex);
+static QTUInt64				QTScan_GetChecksum (const UInt8 *theData, UInt32 theSize);
+static Boolean				QTScan_IsInDirectory (const char *thePath, const char *theDirectory);
+static OSErr				QTScan_WalkDirectory (const char *theDirectory, long theDepth, const char *theIndexPath, QTScanIndexPtr theOldIndex, QTScanIndexPtr theNewIndex, QTScanSummaryPtr theSummary);
+static void					QTScan_ClassifyThread (void *theRefCon);
+static void					QTScan_WriteFourCharCode (FILE *theStream, OSType theCode);
+static void					QTScan_WriteEntryReport (FILE *theStream, QTScanEntryPtr theEntry);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Index functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTScan_InitIndex
+// Prepare an empty index.
+//
+//////////
+
+void QTScan_InitIndex (QTScanIndexPtr theIndex)
+{
+	memset(theIndex, 0, sizeof(QTScanIndexRecord));
+}
+
+
+//////////
+//
+// QTScan_DisposeIndex
+// Release the memory held by the specified index; the index record itself is not freed.
+//
+//////////
+
+void QTScan_DisposeIndex (QTScanIndexPtr theIndex)
+{
+	long		myIndex;
+
+	if (theIndex == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theIndex->fCount; myIndex++)
+		free(theIndex->fEntries[myIndex].fPath);
+
+	free(theIndex->fEntries);
+	free(theIndex->fTable);
+	memset(theIndex, 0, sizeof(QTScanIndexRecord));
+}
+
+
+//////////
+//
+// QTScan_AddEntry
+// Add a copy of theEntry (and of its path) to the specified index; the path must not be in it already.
+//
+//////////
+
+OSErr QTScan_AddEntry (QTScanIndexPtr theIndex, QTScanEntryPtr theEntry)
+{
+	QTScanEntryPtr		myEntry = NULL;
+	UInt32				mySlot;
+	OSErr				myErr = noErr;
+
+	if ((theIndex == NULL) || (theEntry == NULL) || (theEntry->fPath == NULL))
+		return(paramErr);
+
+	// grow the entry array, if necessary
+	if (theIndex->fCount == theIndex->fCapacity) {
+		long				myCapacity = (theIndex->fCapacity == 0) ? kScanInitialCapacity : theIndex->fCapacity * 2;
+		QTScanEntryPtr		myEntries;
+
+		myEntries = (QTScanEntryPtr)realloc(theIndex->fEntries, myCapacity * sizeof(QTScanEntryRecord));
+		if (myEntries == NULL)
+			return(memFullErr);
+
+		theIndex->fEntries = myEntries;
+		theIndex->fCapacity = myCapacity;
+	}
+
+	// keep the hash table no more than half full
+	if ((theIndex->fCount + 1) * 2 > theIndex->fTableSize) {
+		myErr = QTScan_GrowTable(theIndex);
+		if (myErr != noErr)
+			return(myErr);
+	}
+
+	myEntry = &theIndex->fEntries[theIndex->fCount];
+	*myEntry = *theEntry;
+	myEntry->fPath = QTSys_CopyString(theEntry->fPath);
+	if (myEntry->fPath == NULL)
+		return(memFullErr);
+
+	mySlot = QTScan_HashPath(myEntry->fPath) & (theIndex->fTableSize - 1);
+	while (theIndex->fTable[mySlot] >= 0)
+		mySlot = (mySlot + 1) & (theIndex->fTableSize - 1);
+
+	theIndex->fTable[mySlot] = theIndex->fCount++;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTScan_FindEntry
+// Return the entry for the specified path, or NULL if there is none.
+//
+//////////
+
+QTScanEntryPtr QTScan_FindEntry (QTScanIndexPtr theIndex, const char *thePath)
+{
+	UInt32			mySlot;
+
+	if ((theIndex == NULL) || (thePath == NULL) || (theIndex->fTableSize == 0))
+		return(NULL);
+
+	mySlot = QTScan_HashPath(thePath) & (theIndex->fTableSize - 1);
+	while (theIndex->fTable[mySlot] >= 0) {
+		if (strcmp(theIndex->fEntries[theIndex->fTable[mySlot]].fPath, thePath) == 0)
+			return(&theIndex->fEntries[theIndex->fTable[mySlot]]);
+
+		mySlot = (mySlot + 1) & (theIndex->fTableSize - 1);
+	}
+
+	return(NULL);
+}
+
+
+//////////
+//
+// QTScan_ReadIndex
+// Add the entries in an index file to theIndex.
+//
+// A missing, damaged or out-of-date index file is not an error; it just adds nothing.
+//
+//////////
+
+OSErr QTScan_ReadIndex (const char *thePath, QTScanIndexPtr theIndex)
+{
+	QTSetViewRecord			myView;
+	QTScanEntryRecord		myEntry;
+	const UInt8				*myNext;
+	const char				*myNames;
+	char					myPath[kQTSysMaxPath];
+	UInt32					myCount;
+	UInt32					myNameBytes;
+	UInt32					myNameOffset;
+	UInt32					myNameLength;
+	UInt32					myIndex;
+	OSErr					myErr = noErr;
+
+	if ((thePath == NULL) || (theIndex == NULL))
+		return(paramErr);
+
+	if (QTSet_OpenView(thePath, 0L, &myView) != noErr)
+		return(noErr);
+
+	// check the header, the size and the checksum before we believe anything in the file
+	if (myView.fSize < kScanIndexHeaderSize + kScanIndexTrailerSize)
+		goto bail;
+
+	myCount = QTAtom_GetBE32(myView.fData + 8);
+	myNameBytes = QTAtom_GetBE32(myView.fData + 12);
+	if ((QTAtom_GetBE32(myView.fData) != kScanIndexMagic) ||
+		(QTAtom_GetBE32(myView.fData + 4) != kScanIndexVersion) ||
+		(myCount > kScanMaxIndexEntries) ||
+		(myNameBytes > myView.fSize) ||
+		(myView.fSize != kScanIndexHeaderSize + (myCount * kScanIndexEntrySize) + myNameBytes + kScanIndexTrailerSize))
+		goto bail;
+
+	if (QTAtom_GetBE64(myView.fData + myView.fSize - kScanIndexTrailerSize) != QTScan_GetChecksum(myView.fData, myView.fSize - kScanIndexTrailerSize))
+		goto bail;
+
+	myNext = myView.fData + kScanIndexHeaderSize;
+	myNames = (const char *)myNext + (myCount * kScanIndexEntrySize);
+
+	for (myIndex = 0; (myIndex < myCount) && (myErr == noErr); myIndex++, myNext += kScanIndexEntrySize) {
+		myNameOffset = QTAtom_GetBE32(myNext);
+		myNameLength = QTAtom_GetBE32(myNext + 4);
+		if ((myNameOffset > myNameBytes) || (myNameLength > myNameBytes - myNameOffset) || (myNameLength >= sizeof(myPath)))
+			continue;
+
+		memcpy(myPath, myNames + myNameOffset, myNameLength);
+		myPath[myNameLength] = '\0';
+
+		myEntry.fPath = myPath;
+		myEntry.fSize = QTAtom_GetBE64(myNext + 8);
+		myEntry.fModificationTime = QTAtom_GetBE64(myNext + 16);
+		myEntry.fFileType = QTAtom_GetBE32(myNext + 24);
+		myEntry.fImporter = QTAtom_GetBE32(myNext + 28);
+		myEntry.fCategory = (long)QTAtom_GetBE32(myNext + 32);
+		myEntry.fFlags = (long)QTAtom_GetBE32(myNext + 36) & kScanSavedFlags;
+		if ((myEntry.fCategory < kScanCategoryUnknown) || (myEntry.fCategory > kScanCategoryText))
+			continue;
+
+		if (QTScan_FindEntry(theIndex, myPath) == NULL)
+			myErr = QTScan_AddEntry(theIndex, &myEntry);
+	}
+
+bail:
+	QTSet_CloseView(&myView);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTScan_WriteIndex
+// Save theIndex in an index file.
+//
+// The file is replaced atomically, so a reader never sees half of it; if it already holds the same
+// bytes, it isn't touched at all.
+//
+//////////
+
+OSErr QTScan_WriteIndex (const char *thePath, QTScanIndexPtr theIndex)
+{
+	QTSysIOVecRecord		myPart;
+	UInt8					*myData = NULL;
+	UInt8					*myNext;
+	char					*myNames;
+	UInt32					myNameBytes = 0;
+	UInt32					myNameLength;
+	UInt32					mySize;
+	long					myIndex;
+	Boolean					myWritten;
+	OSErr					myErr = noErr;
+
+	if ((thePath == NULL) || (theIndex == NULL) || (theIndex->fCount > kScanMaxIndexEntries))
+		return(paramErr);
+
+	for (myIndex = 0; myIndex < theIndex->fCount; myIndex++)
+		myNameBytes += (UInt32)strlen(theIndex->fEntries[myIndex].fPath);
+
+	mySize = kScanIndexHeaderSize + ((UInt32)theIndex->fCount * kScanIndexEntrySize) + myNameBytes + kScanIndexTrailerSize;
+
+	myData = (UInt8 *)malloc(mySize);
+	if (myData == NULL)
+		return(memFullErr);
+
+	QTAtom_PutBE32(myData, kScanIndexMagic);
+	QTAtom_PutBE32(myData + 4, kScanIndexVersion);
+	QTAtom_PutBE32(myData + 8, (UInt32)theIndex->fCount);
+	QTAtom_PutBE32(myData + 12, myNameBytes);
+
+	myNext = myData + kScanIndexHeaderSize;
+	myNames = (char *)myNext + (theIndex->fCount * kScanIndexEntrySize);
+	myNameBytes = 0;
+
+	for (myIndex = 0; myIndex < theIndex->fCount; myIndex++) {
+		QTScanEntryPtr	myEntry = &theIndex->fEntries[myIndex];
+
+		myNameLength = (UInt32)strlen(myEntry->fPath);
+		memcpy(myNames + myNameBytes, myEntry->fPath, myNameLength);
+
+		QTAtom_PutBE32(myNext, myNameBytes);
+		QTAtom_PutBE32(myNext + 4, myNameLength);
+		QTAtom_PutBE64(myNext + 8, myEntry->fSize);
+		QTAtom_PutBE64(myNext + 16, myEntry->fModificationTime);
+		QTAtom_PutBE32(myNext + 24, myEntry->fFileType);
+		QTAtom_PutBE32(myNext + 28, myEntry->fImporter);
+		QTAtom_PutBE32(myNext + 32, (UInt32)myEntry->fCategory);
+		QTAtom_PutBE32(myNext + 36, (UInt32)(myEntry->fFlags & kScanSavedFlags));
+
+		myNameBytes += myNameLength;
+		myNext += kScanIndexEntrySize;
+	}
+
+	QTAtom_PutBE64(myData + mySize - kScanIndexTrailerSize, QTScan_GetChecksum(myData, mySize - kScanIndexTrailerSize));
+
+	myPart.fData = myData;
+	myPart.fLength = mySize;
+	myErr = QTSet_WriteFile(thePath, &myPart, 1, &myWritten);
+
+	free(myData);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTScan_HashPath
+// Hash a path (FNV-1a), for the index's hash table.
+//
+//////////
+
+static UInt32 QTScan_HashPath (const char *thePath)
+{
+	UInt32			myHash = 2166136261UL;
+
+	while (*thePath != '\0') {
+		myHash ^= (UInt8)*thePath++;
+		myHash *= 16777619UL;
+	}
+
+	return(myHash);
+}
+
+
+//////////
+//
+// QTScan_GrowTable
+// Double the size of the index's hash table, and put every entry back into it.
+//
+//////////
+
+static OSErr QTScan_GrowTable (QTScanIndexPtr theIndex)
+{
+	long			myTableSize = (theIndex->fTableSize == 0) ? kScanInitialCapacity * 2 : theIndex->fTableSize * 2;
+	long			*myTable;
+	long			myIndex;
+	UInt32			mySlot;
+
+	myTable = (long *)malloc(myTableSize * sizeof(long));
+	if (myTable == NULL)
+		return(memFullErr);
+
+	for (myIndex = 0; myIndex < myTableSize; myIndex++)
+		myTable[myIndex] = -1;
+
+	for (myIndex = 0; myIndex < theIndex->fCount; myIndex++) {
+		mySlot = QTScan_HashPath(theIndex->fEntries[myIndex].fPath) & (myTableSize - 1);
+		while (myTable[mySlot] >= 0)
+			mySlot = (mySlot + 1) & (myTableSize - 1);
+
+		myTable[mySlot] = myIndex;
+	}
+
+	free(theIndex->fTable);
+	theIndex->fTable = myTable;
+	theIndex->fTableSize = myTableSize;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTScan_GetChecksum
+// Compute the checksum of the specified bytes.
+//
+//////////
+
+static QTUInt64 QTScan_GetChecksum (const UInt8 *theData, UInt32 theSize)
+{
+	QTUInt64		myChecksum = kScanChecksumSeed;
+	UInt32			myIndex;
+
+	for (myIndex = 0; myIndex < theSize; myIndex++) {
+		myChecksum ^= (QTUInt64)theData[myIndex];
+		myChecksum *= kScanChecksumPrime;
+	}
+
+	return(myChecksum);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Classification functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTScan_SniffFile
+// Find out what sort of file is at thePath, and fill in the type, importer, category and flags of theEntry.
+//
+// An error means we couldn't read the file; theEntry then has kScanFlagFailed set.
+//
+//////////
+
+OSErr QTScan_SniffFile (const char *thePath, QTScanEntryPtr theEntry)
+{
+	QTProbeInfoRecord		myInfo;
+	QTSysFile				myFile = kQTSysInvalidFile;
+	UInt8					myBytes[kScanSniffSize];
+	UInt32					myCount = 0;
+	OSType					myAtomType;
+	const char				*myExtension;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	theEntry->fFileType = 0;
+	theEntry->fImporter = 0;
+	theEntry->fCategory = kScanCategoryUnknown;
+	theEntry->fFlags = 0;
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenRead, &myFile);
+	if (myErr == noErr) {
+		myErr = QTSys_ReadFile(myFile, 0, myBytes, sizeof(myBytes), &myCount);
+		QTSys_CloseFile(myFile);
+	}
+
+	if (myErr != noErr) {
+		theEntry->fFlags = kScanFlagFailed;
+		return(myErr);
+	}
+
+	// files made of atoms go to the prober, which knows a movie when it sees one
+	if (myCount >= kAtomHeaderSize) {
+		myAtomType = QTAtom_GetBE32(myBytes + 4);
+		for (myIndex = 0; myIndex < (long)(sizeof(gScanAtomTypes) / sizeof(gScanAtomTypes[0])); myIndex++) {
+			if (myAtomType != gScanAtomTypes[myIndex])
+				continue;
+
+			if ((QTProbe_ProbeFile(thePath, &myInfo) == noErr) && QTProbe_IsMovie(&myInfo)) {
+				theEntry->fFileType = (myInfo.fKind == kProbeKindMPEG4) ? kScanTypeMPEG4 : kScanTypeMovie;
+				theEntry->fImporter = (myInfo.fKind == kProbeKindMPEG4) ? kScanTypeMPEG4 : 0;
+				theEntry->fCategory = kScanCategoryMovie;
+				theEntry->fFlags = kScanFlagInPlace;
+				return(noErr);
+			}
+
+			break;
+		}
+	}
+
+	for (myIndex = 0; myIndex < (long)(sizeof(gScanSignatures) / sizeof(gScanSignatures[0])); myIndex++) {
+		const QTScanSignatureRecord		*mySignature = &gScanSignatures[myIndex];
+
+		if ((mySignature->fOffset + mySignature->fLength <= myCount) && (memcmp(myBytes + mySignature->fOffset, mySignature->fBytes, mySignature->fLength) == 0)) {
+			theEntry->fFileType = mySignature->fFileType;
+			theEntry->fCategory = mySignature->fCategory;
+			theEntry->fFlags = mySignature->fFlags;
+			break;
+		}
+	}
+
+	// MPEG audio has no signature, just a frame sync: eleven bits set, and a layer (which AAC leaves at 0)
+	if ((theEntry->fFileType == 0) && (myCount >= 2) && (myBytes[0] == 0xFF) && ((myBytes[1] & 0xE0) == 0xE0) && ((myBytes[1] & 0x06) != 0)) {
+		theEntry->fFileType = FOUR_CHAR_CODE('MP3 ');
+		theEntry->fCategory = kScanCategoryAudio;
+		theEntry->fFlags = kScanFlagInPlace;
+	}
+
+	if (theEntry->fFileType == 0) {
+		myExtension = QTSys_GetFileExtension(thePath);
+		for (myIndex = 0; (myExtension != NULL) && (myIndex < (long)(sizeof(gScanExtensions) / sizeof(gScanExtensions[0]))); myIndex++) {
+			if (QTSys_CompareStringsNoCase(myExtension, gScanExtensions[myIndex].fExtension) == 0) {
+				theEntry->fFileType = gScanExtensions[myIndex].fFileType;
+				theEntry->fCategory = gScanExtensions[myIndex].fCategory;
+				theEntry->fFlags = gScanExtensions[myIndex].fFlags | kScanFlagByExtension;
+				break;
+			}
+		}
+	}
+
+	// QuickTime's importers are registered under the file types they import
+	theEntry->fImporter = theEntry->fFileType;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTScan_GetCategoryName
+// Return the name of one of the kScanCategory constants, for reports.
+//
+//////////
+
+const char *QTScan_GetCategoryName (long theCategory)
+{
+	static const char		*myNames[] = {"unknown", "movie", "still", "audio", "video", "text"};
+
+	if ((theCategory < kScanCategoryUnknown) || (theCategory > kScanCategoryText))
+		return("unknown");
+
+	return(myNames[theCategory]);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Scanning functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTScan_ScanDirectory
+// Classify every file in the tree at theDirectory on theWorkerCount threads, updating the index file at
+// theIndexPath; write a line of JSON for every file we read, and one for the whole scan, to theReport.
+//
+// A worker count of 0 or less means one worker per processor.
+//
+//////////
+
+OSErr QTScan_ScanDirectory (const char *theDirectory, const char *theIndexPath, long theWorkerCount, FILE *theReport, QTScanSummaryPtr theSummary)
+{
+	QTScanIndexRecord		myOldIndex;
+	QTScanIndexRecord		myNewIndex;
+	QTScanSummaryRecord		mySummary;
+	QTScanRunRecord			myRun;
+	QTSysThread				myThreads[kScanMaxWorkers];
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	QTUInt64				myTime;
+	long					myThreadCount = 0;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if ((theDirectory == NULL) || (theIndexPath == NULL))
+		return(paramErr);
+
+	QTScan_InitIndex(&myOldIndex);
+	QTScan_InitIndex(&myNewIndex);
+	memset(&mySummary, 0, sizeof(mySummary));
+	memset(&myRun, 0, sizeof(myRun));
+
+	myErr = QTScan_ReadIndex(theIndexPath, &myOldIndex);
+	if (myErr != noErr)
+		goto bail;
+
+	// find the files, and reuse what we know about those that haven't changed
+	myErr = QTScan_WalkDirectory(theDirectory, 0, theIndexPath, &myOldIndex, &myNewIndex, &mySummary);
+	if (myErr != noErr)
+		goto bail;
+
+	myTime = QTSys_GetMicroseconds();
+	mySummary.fWalkMicroseconds = myTime - myStartTime;
+
+	// classify the rest
+	myRun.fIndex = &myNewIndex;
+	myRun.fPending = (long *)malloc((myNewIndex.fCount + 1) * sizeof(long));
+	if (myRun.fPending == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < myNewIndex.fCount; myIndex++)
+		if (myNewIndex.fEntries[myIndex].fFlags & kScanFlagPending)
+			myRun.fPending[myRun.fPendingCount++] = myIndex;
+
+	if (theWorkerCount <= 0)
+		theWorkerCount = QTSys_GetProcessorCount();
+	if (theWorkerCount > kScanMaxWorkers)
+		theWorkerCount = kScanMaxWorkers;
+	if (theWorkerCount > myRun.fPendingCount)
+		theWorkerCount = myRun.fPendingCount;
+
+	for (myIndex = 0; myIndex < theWorkerCount; myIndex++) {
+		if (QTSys_NewThread(QTScan_ClassifyThread, &myRun, &myThreads[myThreadCount]) != noErr)
+			break;
+
+		myThreadCount++;
+	}
+
+	// if we couldn't start any threads, do the work on this one
+	if (myThreadCount == 0)
+		QTScan_ClassifyThread(&myRun);
+
+	for (myIndex = 0; myIndex < myThreadCount; myIndex++)
+		QTSys_JoinThread(myThreads[myIndex]);
+
+	mySummary.fWorkerCount = ((myThreadCount == 0) && (myRun.fPendingCount > 0)) ? 1 : myThreadCount;
+	mySummary.fClassifiedCount = myRun.fPendingCount;
+	mySummary.fClassifyMicroseconds = QTSys_GetMicroseconds() - myTime;
+
+	for (myIndex = 0; myIndex < myRun.fPendingCount; myIndex++) {
+		QTScanEntryPtr		myEntry = &myNewIndex.fEntries[myRun.fPending[myIndex]];
+
+		if (myEntry->fFlags & kScanFlagFailed)
+			mySummary.fFailedCount++;
+
+		if (theReport != NULL)
+			QTScan_WriteEntryReport(theReport, myEntry);
+	}
+
+	for (myIndex = 0; myIndex < myNewIndex.fCount; myIndex++)
+		mySummary.fCategoryCounts[myNewIndex.fEntries[myIndex].fCategory]++;
+
+	// keep what we know about files outside this tree, and count the files in it that are gone
+	for (myIndex = 0; (myIndex < myOldIndex.fCount) && (myErr == noErr); myIndex++) {
+		QTScanEntryPtr		myEntry = &myOldIndex.fEntries[myIndex];
+
+		if (QTScan_IsInDirectory(myEntry->fPath, theDirectory)) {
+			if (QTScan_FindEntry(&myNewIndex, myEntry->fPath) == NULL)
+				mySummary.fRemovedCount++;
+		} else {
+			myErr = QTScan_AddEntry(&myNewIndex, myEntry);
+		}
+	}
+
+	if (myErr == noErr)
+		myErr = QTScan_WriteIndex(theIndexPath, &myNewIndex);
+
+	mySummary.fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+
+	if (theReport != NULL) {
+		fputs("{\"summary\":true,\"directory\":", theReport);
+		QTSys_WriteJSONString(theReport, theDirectory);
+		fprintf(theReport, ",\"err\":%d,\"files\":%ld,\"directories\":%ld,\"reused\":%ld,\"classified\":%ld,\"removed\":%ld,\"failed\":%ld",
+					(int)myErr,
+					mySummary.fFileCount,
+					mySummary.fDirectoryCount,
+					mySummary.fReusedCount,
+					mySummary.fClassifiedCount,
+					mySummary.fRemovedCount,
+					mySummary.fFailedCount);
+
+		for (myIndex = kScanCategoryUnknown; myIndex <= kScanCategoryText; myIndex++)
+			fprintf(theReport, ",\"%s\":%ld", QTScan_GetCategoryName(myIndex), mySummary.fCategoryCounts[myIndex]);
+
+		fprintf(theReport, ",\"workers\":%ld,\"walkMicroseconds\":%llu,\"classifyMicroseconds\":%llu,\"wallMicroseconds\":%llu}\n",
+					mySummary.fWorkerCount,
+					(unsigned long long)mySummary.fWalkMicroseconds,
+					(unsigned long long)mySummary.fClassifyMicroseconds,
+					(unsigned long long)mySummary.fMicroseconds);
+		fflush(theReport);
+	}
+
+bail:
+	free(myRun.fPending);
+	QTScan_DisposeIndex(&myNewIndex);
+	QTScan_DisposeIndex(&myOldIndex);
+
+	if (theSummary != NULL)
+		*theSummary = mySummary;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTScan_IsInDirectory
+// Is thePath in the tree at theDirectory?
+//
+//////////
+
+static Boolean QTScan_IsInDirectory (const char *thePath, const char *theDirectory)
+{
+	size_t			myLength = strlen(theDirectory);
+
+	if (strncmp(thePath, theDirectory, myLength) != 0)
+		return(false);
+
+	if ((myLength > 0) && ((theDirectory[myLength - 1] == '/') || (theDirectory[myLength - 1] == kQTSysPathSeparator)))
+		return(true);
+
+	return((thePath[myLength] == '/') || (thePath[myLength] == kQTSysPathSeparator));
+}
+
+
+//////////
+//
+// QTScan_WalkDirectory
+// Add an entry to theNewIndex for every file in the tree at theDirectory.
+//
+// Files whose size and modification time match their entries in theOldIndex keep what we knew about
+// them; the others are marked kScanFlagPending. We don't list the index file itself.
+//
+//////////
+
+static OSErr QTScan_WalkDirectory (const char *theDirectory, long theDepth, const char *theIndexPath, QTScanIndexPtr theOldIndex, QTScanIndexPtr theNewIndex, QTScanSummaryPtr theSummary)
+{
+	QTSysDirectory			myDirectory = NULL;
+	QTSysDirEntryRecord		myDirEntry;
+	QTScanEntryRecord		myEntry;
+	QTScanEntryPtr			myOldEntry;
+	char					myPath[kQTSysMaxPath];
+	OSErr					myErr = noErr;
+
+	if (theDepth > kScanMaxDepth)
+		return(noErr);
+
+	myErr = QTSys_OpenDirectory(theDirectory, &myDirectory);
+	if (myErr != noErr)
+		return(myErr);
+
+	theSummary->fDirectoryCount++;
+
+	while (QTSys_ReadDirectory(myDirectory, &myDirEntry) == noErr) {
+		if (QTSys_MakePath(myPath, sizeof(myPath), theDirectory, myDirEntry.fName) != noErr)
+			continue;
+
+		if (myDirEntry.fIsDirectory) {
+			// a subdirectory we can't read is left out, not the whole scan
+			QTScan_WalkDirectory(myPath, theDepth + 1, theIndexPath, theOldIndex, theNewIndex, theSummary);
+			continue;
+		}
+
+		if (strcmp(myPath, theIndexPath) == 0)
+			continue;
+
+		memset(&myEntry, 0, sizeof(myEntry));
+		myEntry.fPath = myPath;
+		myEntry.fSize = myDirEntry.fSize;
+		myEntry.fModificationTime = myDirEntry.fModificationTime;
+		myEntry.fFlags = kScanFlagPending;
+
+		myOldEntry = QTScan_FindEntry(theOldIndex, myPath);
+		if ((myOldEntry != NULL) && !(myOldEntry->fFlags & kScanFlagFailed) && (myOldEntry->fSize == myEntry.fSize) && (myOldEntry->fModificationTime == myEntry.fModificationTime)) {
+			myEntry.fFileType = myOldEntry->fFileType;
+			myEntry.fImporter = myOldEntry->fImporter;
+			myEntry.fCategory = myOldEntry->fCategory;
+			myEntry.fFlags = myOldEntry->fFlags;
+			theSummary->fReusedCount++;
+		}
+
+		myErr = QTScan_AddEntry(theNewIndex, &myEntry);
+		if (myErr != noErr)
+			break;
+
+		theSummary->fFileCount++;
+	}
+
+	QTSys_CloseDirectory(myDirectory);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTScan_ClassifyThread
+// Classify pending entries until there are none left.
+//
+//////////
+
+static void QTScan_ClassifyThread (void *theRefCon)
+{
+	QTScanRunPtr		myRun = (QTScanRunPtr)theRefCon;
+	QTScanEntryPtr		myEntry;
+	long				myIndex;
+
+	for (;;) {
+		myIndex = QTSys_AtomicAdd(&myRun->fNextIndex, 1) - 1;
+		if (myIndex >= myRun->fPendingCount)
+			break;
+
+		myEntry = &myRun->fIndex->fEntries[myRun->fPending[myIndex]];
+		QTScan_SniffFile(myEntry->fPath, myEntry);
+	}
+}
+
+
+//////////
+//
+// QTScan_WriteFourCharCode
+// Write a four-character code as a JSON string, or null if it is 0.
+//
+//////////
+
+static void QTScan_WriteFourCharCode (FILE *theStream, OSType theCode)
+{
+	char		myString[5];
+	long		myIndex;
+
+	if (theCode == 0) {
+		fputs("null", theStream);
+		return;
+	}
+
+	for (myIndex = 0; myIndex < 4; myIndex++) {
+		myString[myIndex] = (char)(theCode >> (24 - (8 * myIndex)));
+		if ((myString[myIndex] < ' ') || (myString[myIndex] > '~'))
+			myString[myIndex] = '?';
+	}
+
+	myString[4] = '\0';
+	QTSys_WriteJSONString(theStream, myString);
+}
+
+
+//////////
+//
+// QTScan_WriteEntryReport
+// Write what we found out about one file, as one line of JSON.
+//
+//////////
+
+static void QTScan_WriteEntryReport (FILE *theStream, QTScanEntryPtr theEntry)
+{
+	fputs("{\"file\":", theStream);
+	QTSys_WriteJSONString(theStream, theEntry->fPath);
+	fprintf(theStream, ",\"size\":%llu,\"category\":\"%s\",\"type\":", (unsigned long long)theEntry->fSize, QTScan_GetCategoryName(theEntry->fCategory));
+	QTScan_WriteFourCharCode(theStream, theEntry->fFileType);
+	fputs(",\"importer\":", theStream);
+	QTScan_WriteFourCharCode(theStream, theEntry->fImporter);
+	fprintf(theStream, ",\"inPlace\":%s,\"byExtension\":%s,\"failed\":%s}\n",
+				(theEntry->fFlags & kScanFlagInPlace) ? "true" : "false",
+				(theEntry->fFlags & kScanFlagByExtension) ? "true" : "false",
+				(theEntry->fFlags & kScanFlagFailed) ? "true" : "false");
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTScan_IsScanCommandLine
+// Does the specified command line ask for scanning mode?
+//
+//////////
+
+Boolean QTScan_IsScanCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kScanSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTScan_Main
+// Run scanning mode. Returns one of the kScanExit constants.
+//
+// Usage: -scan <directory> [-index <file>] [-workers <count>] [-report <file>]
+//
+// The index defaults to kScanIndexFileName in the user's cache folder.
+//
+//////////
+
+int QTScan_Main (int theArgc, char *theArgv[])
+{
+	QTScanSummaryRecord		mySummary;
+	const char				*myDirectory = NULL;
+	const char				*myIndexPath = NULL;
+	const char				*myReportPath = NULL;
+	FILE					*myReport = stdout;
+	char					myCachePath[kQTSysMaxPath];
+	long					myWorkerCount = 0;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kScanSwitch) == 0) && (myIndex + 1 < theArgc))
+			myDirectory = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kScanIndexSwitch) == 0) && (myIndex + 1 < theArgc))
+			myIndexPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kScanWorkersSwitch) == 0) && (myIndex + 1 < theArgc))
+			myWorkerCount = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kScanReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if (myDirectory == NULL) {
+		fprintf(stderr, "usage: %s %s <directory> [%s <file>] [%s <count>] [%s <file>]\n", theArgv[0], kScanSwitch, kScanIndexSwitch, kScanWorkersSwitch, kScanReportSwitch);
+		return(kScanExitUsage);
+	}
+
+	if (myIndexPath == NULL) {
+		myErr = QTSys_GetCacheDirectory(myCachePath, sizeof(myCachePath));
+		if (myErr == noErr)
+			myErr = QTSys_MakePath(myCachePath, sizeof(myCachePath), myCachePath, kScanIndexFileName);
+		if (myErr != noErr) {
+			fprintf(stderr, "cannot find a cache folder for the index; use %s\n", kScanIndexSwitch);
+			return(kScanExitUsage);
+		}
+
+		myIndexPath = myCachePath;
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kScanExitUsage);
+		}
+	}
+
+	myErr = QTScan_ScanDirectory(myDirectory, myIndexPath, myWorkerCount, myReport, &mySummary);
+	if (myErr != noErr)
+		fprintf(stderr, "cannot scan %s (error %d)\n", myDirectory, (int)myErr);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return(((myErr == noErr) && (mySummary.fFailedCount == 0)) ? kScanExitSuccess : kScanExitSomeFailed);
+}
@@ -0,0 +1,134 @@
+//////////
+//
+//	File:		QTScan.h
+//
+//	Contains:	A portable engine that classifies every file in a directory tree by its contents, and remembers what it found.
+//				All utilities start with the prefix "QTScan_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTScan__
+#define __QTScan__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTProbe.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kScanSwitch							"-scan"					// command-line switch that selects scanning mode
+#define kScanIndexSwitch					"-index"				// the index file to read and update
+#define kScanWorkersSwitch					"-workers"				// number of threads classifying files
+#define kScanReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kScanIndexFileName					"QTDataExScan.index"	// the default index, in the user's cache folder
+#define kScanIndexMagic						FOUR_CHAR_CODE('QTSx')	// first four bytes of an index file
+#define kScanIndexVersion					1
+#define kScanChecksumSeed					(((QTUInt64)0xCBF29CE4UL << 32) | 0x84222325UL)	// the FNV-1a offset basis
+#define kScanChecksumPrime					(((QTUInt64)0x00000100UL << 32) | 0x000001B3UL)	// the FNV-1a prime
+
+#define kScanSniffSize						64						// bytes we read from the start of each file
+#define kScanMaxDepth						64						// deepest directory we go into
+#define kScanMaxWorkers						64
+#define kScanInitialCapacity				256
+
+// what sort of file it is
+enum {
+	kScanCategoryUnknown					= 0,
+	kScanCategoryMovie						= 1,					// a QuickTime movie or MPEG-4 file
+	kScanCategoryStill						= 2,
+	kScanCategoryAudio						= 3,
+	kScanCategoryVideo						= 4,					// video in some other container
+	kScanCategoryText						= 5
+};
+
+// flags in QTScanEntryRecord.fFlags
+enum {
+	kScanFlagInPlace						= 1L << 0,				// QuickTime can open it without converting it first
+	kScanFlagByExtension					= 1L << 1,				// its contents told us nothing; we went by its name
+	kScanFlagFailed							= 1L << 2				// we couldn't read it; we'll try again next time
+};
+
+// exit codes returned by QTScan_Main
+enum {
+	kScanExitSuccess						= 0,
+	kScanExitSomeFailed						= 1,
+	kScanExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// what we know about one file
+typedef struct QTScanEntryRecord {
+	char					*fPath;
+	QTUInt64				fSize;
+	QTUInt64				fModificationTime;		// as QTSys_GetPathModificationTime returns it
+	OSType					fFileType;				// the Mac OS file type of what we found, or 0
+	OSType					fImporter;				// the subtype of the movie importer that opens it, or 0 for movies
+	long					fCategory;				// one of the kScanCategory constants
+	long					fFlags;					// kScanFlag constants
+} QTScanEntryRecord, *QTScanEntryPtr;
+
+// the entries of an index file, with a hash table to find them by path
+typedef struct QTScanIndexRecord {
+	QTScanEntryPtr			fEntries;
+	long					fCount;
+	long					fCapacity;
+	long					*fTable;				// indexes into fEntries, or -1; fTableSize is a power of 2
+	long					fTableSize;
+} QTScanIndexRecord, *QTScanIndexPtr;
+
+// what QTScan_ScanDirectory did
+typedef struct QTScanSummaryRecord {
+	long					fFileCount;
+	long					fDirectoryCount;
+	long					fReusedCount;			// files that hadn't changed since the last scan
+	long					fClassifiedCount;		// files we had to read
+	long					fRemovedCount;			// files in the index that are gone
+	long					fFailedCount;
+	long					fCategoryCounts[kScanCategoryText + 1];
+	long					fWorkerCount;
+	QTUInt64				fWalkMicroseconds;
+	QTUInt64				fClassifyMicroseconds;
+	QTUInt64				fMicroseconds;
+} QTScanSummaryRecord, *QTScanSummaryPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+void						QTScan_InitIndex (QTScanIndexPtr theIndex);
+void						QTScan_DisposeIndex (QTScanIndexPtr theIndex);
+OSErr						QTScan_AddEntry (QTScanIndexPtr theIndex, QTScanEntryPtr theEntry);
+QTScanEntryPtr				QTScan_FindEntry (QTScanIndexPtr theIndex, const char *thePath);
+OSErr						QTScan_ReadIndex (const char *thePath, QTScanIndexPtr theIndex);
+OSErr						QTScan_WriteIndex (const char *thePath, QTScanIndexPtr theIndex);
+
+OSErr						QTScan_SniffFile (const char *thePath, QTScanEntryPtr theEntry);
+const char *				QTScan_GetCategoryName (long theCategory);
+OSErr						QTScan_ScanDirectory (const char *theDirectory, const char *theIndexPath, long theWorkerCount, FILE *theReport, QTScanSummaryPtr theSummary);
+
+Boolean						QTScan_IsScanCommandLine (int theArgc, char *theArgv[]);
+int							QTScan_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTScan__
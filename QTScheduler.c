@@ -0,0 +1,1217 @@
+//////////
+//
+//	File:		QTScheduler.c
+//
+//	Contains:	A multi-worker scheduler for running movie exports in parallel.
+//				All utilities start with the prefix "QTSched_".
+//
+//	QTDX_ExportMovieAsAnyTypeFile exports one movie at a time on the main thread, so a machine with
+//	several processors spends most of a long export with all but one of them idle. This file runs
+//	exports on a pool of worker threads instead. Jobs wait in a bounded priority queue (so a caller
+//	that submits thousands of jobs blocks rather than using unbounded memory); higher priorities are
+//	started first, and jobs of equal priority are started in the order they were submitted. A job can
+//	be cancelled while it is queued (it is simply removed) or while it is running (the exporter polls
+//	QTSched_IsJobCancelled and gives up).
+//
+//	Movie export components are not safe to share between threads, so each worker creates its own
+//	exporter instance through the QTSchedExporterRecord interface and uses it for every job it runs.
+//	QTDataEx.c supplies an exporter that calls QuickTime; QTSched_GetSyntheticExporter supplies one
+//	that just burns a fixed amount of processor time, which QTSched_RunBenchmark uses to measure how
+//	throughput scales with the number of workers.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTScheduler.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kSchedInitialListCapacity	64						// initial number of jobs in a job list
+#define kSchedMaxLineLength			(2 * kQTSysMaxPath + 32)// longest job-list line we accept
+#define kSchedListSeparator			'\t'
+#define kSchedListComment			'#'
+
+#define kSchedSyntheticScratchSize	(64L * 1024L)			// per-worker state of the synthetic exporter
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTSchedWorkerRecord {
+	QTSchedulerPtr			fScheduler;
+	long					fIndex;
+	QTSysThread				fThread;
+	QTSchedJobPtr			fCurrentJob;			// the job this worker is running, or NULL
+} QTSchedWorkerRecord, *QTSchedWorkerPtr;
+
+struct QTSchedulerRecord {
+	QTSchedExporterPtr		fExporter;
+	QTSysMutex				fMutex;					// protects everything below, and the state of every submitted job
+	QTSysCondition			fWorkAvailable;			// signalled when a job is queued, or when we shut down
+	QTSysCondition			fSpaceAvailable;		// signalled when a job leaves the queue
+	QTSysCondition			fJobFinished;			// broadcast when a job finishes, fails or is cancelled
+	QTSchedJobPtr			*fQueue;				// a binary heap, highest priority first
+	long					fQueueCount;
+	long					fQueueCapacity;
+	long					fRunningCount;
+	long					fNextSequence;
+	Boolean					fShuttingDown;
+	QTSchedWorkerPtr		fWorkers;
+	long					fWorkerCount;
+};
+
+// the jobs read from a job-list file, and the strings they point to
+typedef struct QTSchedJobListRecord {
+	QTSchedJobPtr			fJobs;
+	long					fCount;
+	long					fCapacity;
+} QTSchedJobListRecord, *QTSchedJobListPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTSched_WorkerThread (void *theRefCon);
+static void					QTSched_FinishJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob, OSErr theErr);
+static Boolean				QTSched_JobPrecedes (QTSchedJobPtr theJob1, QTSchedJobPtr theJob2);
+static void					QTSched_SetQueueEntry (QTSchedulerPtr theScheduler, long theIndex, QTSchedJobPtr theJob);
+static void					QTSched_SiftUp (QTSchedulerPtr theScheduler, long theIndex);
+static void					QTSched_SiftDown (QTSchedulerPtr theScheduler, long theIndex);
+static void					QTSched_InsertInQueue (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob);
+static QTSchedJobPtr		QTSched_RemoveFromQueue (QTSchedulerPtr theScheduler, long theIndex);
+
+static const char *			QTSched_GetStateName (long theState);
+static OSType				QTSched_StringToOSType (const char *theString);
+static OSErr				QTSched_ReadJobList (const char *thePath, OSType theDefaultType, QTSchedJobListPtr theList);
+static void					QTSched_DisposeJobList (QTSchedJobListPtr theList);
+
+static OSErr				QTSched_SyntheticNewWorker (void *theRefCon, void **theWorkerData);
+static OSErr				QTSched_SyntheticExportJob (void *theWorkerData, QTSchedJobPtr theJob);
+static void					QTSched_SyntheticDisposeWorker (void *theWorkerData);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Scheduler functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSched_NewScheduler
+// Create a scheduler that runs jobs on theWorkerCount threads, with room for theQueueCapacity waiting jobs.
+//
+// A worker count of 0 or less means one worker per processor.
+//
+//////////
+
+OSErr QTSched_NewScheduler (QTSchedExporterPtr theExporter, long theWorkerCount, long theQueueCapacity, QTSchedulerPtr *theScheduler)
+{
+	QTSchedulerPtr			mySched = NULL;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if ((theExporter == NULL) || (theScheduler == NULL))
+		return(paramErr);
+
+	*theScheduler = NULL;
+
+	if (theWorkerCount <= 0)
+		theWorkerCount = QTSys_GetProcessorCount();
+	if (theWorkerCount > kSchedMaxWorkers)
+		theWorkerCount = kSchedMaxWorkers;
+	if (theQueueCapacity <= 0)
+		theQueueCapacity = kSchedDefaultQueueCapacity;
+
+	mySched = (QTSchedulerPtr)calloc(1, sizeof(struct QTSchedulerRecord));
+	if (mySched == NULL)
+		return(memFullErr);
+
+	mySched->fExporter = theExporter;
+	mySched->fQueueCapacity = theQueueCapacity;
+	mySched->fQueue = (QTSchedJobPtr *)calloc((size_t)theQueueCapacity, sizeof(QTSchedJobPtr));
+	mySched->fWorkers = (QTSchedWorkerPtr)calloc((size_t)theWorkerCount, sizeof(QTSchedWorkerRecord));
+	if ((mySched->fQueue == NULL) || (mySched->fWorkers == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = QTSys_NewMutex(&mySched->fMutex);
+	if (myErr == noErr)
+		myErr = QTSys_NewCondition(&mySched->fWorkAvailable);
+	if (myErr == noErr)
+		myErr = QTSys_NewCondition(&mySched->fSpaceAvailable);
+	if (myErr == noErr)
+		myErr = QTSys_NewCondition(&mySched->fJobFinished);
+	if (myErr == noErr)
+		myErr = QTEst_InitHistory();		// our workers' estimators share the history
+	if (myErr != noErr)
+		goto bail;
+
+	// start the workers; if some of them can't be started, we make do with the ones that were
+	for (myIndex = 0; myIndex < theWorkerCount; myIndex++) {
+		QTSchedWorkerPtr	myWorker = &mySched->fWorkers[mySched->fWorkerCount];
+
+		myWorker->fScheduler = mySched;
+		myWorker->fIndex = mySched->fWorkerCount;
+		myErr = QTSys_NewThread(QTSched_WorkerThread, myWorker, &myWorker->fThread);
+		if (myErr != noErr)
+			break;
+
+		mySched->fWorkerCount++;
+	}
+
+	if (mySched->fWorkerCount > 0)
+		myErr = noErr;
+
+bail:
+	if (myErr != noErr) {
+		QTSched_DisposeScheduler(mySched);
+		mySched = NULL;
+	}
+
+	*theScheduler = mySched;
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSched_DisposeScheduler
+// Cancel any jobs that are still queued, wait for the running jobs to finish, and dispose of the scheduler.
+//
+//////////
+
+void QTSched_DisposeScheduler (QTSchedulerPtr theScheduler)
+{
+	long			myIndex;
+
+	if (theScheduler == NULL)
+		return;
+
+	if (theScheduler->fMutex != NULL) {
+		QTSys_LockMutex(theScheduler->fMutex);
+		while (theScheduler->fQueueCount > 0)
+			QTSched_FinishJob(theScheduler, QTSched_RemoveFromQueue(theScheduler, theScheduler->fQueueCount - 1), userCanceledErr);
+		theScheduler->fShuttingDown = true;
+		QTSys_BroadcastCondition(theScheduler->fWorkAvailable);
+		QTSys_BroadcastCondition(theScheduler->fSpaceAvailable);
+		QTSys_UnlockMutex(theScheduler->fMutex);
+	}
+
+	for (myIndex = 0; myIndex < theScheduler->fWorkerCount; myIndex++)
+		QTSys_JoinThread(theScheduler->fWorkers[myIndex].fThread);
+
+	QTSys_DisposeCondition(theScheduler->fJobFinished);
+	QTSys_DisposeCondition(theScheduler->fSpaceAvailable);
+	QTSys_DisposeCondition(theScheduler->fWorkAvailable);
+	QTSys_DisposeMutex(theScheduler->fMutex);
+
+	free(theScheduler->fWorkers);
+	free(theScheduler->fQueue);
+	free(theScheduler);
+}
+
+
+//////////
+//
+// QTSched_SubmitJob
+// Queue the specified job, waiting for room in the queue if it is full.
+//
+//////////
+
+OSErr QTSched_SubmitJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob)
+{
+	OSErr			myErr = noErr;
+
+	if ((theScheduler == NULL) || (theJob == NULL))
+		return(paramErr);
+
+	QTSys_LockMutex(theScheduler->fMutex);
+
+	if ((theJob->fState == kSchedJobQueued) || (theJob->fState == kSchedJobRunning)) {
+		myErr = paramErr;
+		goto bail;
+	}
+
+	while ((theScheduler->fQueueCount == theScheduler->fQueueCapacity) && !theScheduler->fShuttingDown)
+		QTSys_WaitCondition(theScheduler->fSpaceAvailable, theScheduler->fMutex);
+
+	if (theScheduler->fShuttingDown) {
+		myErr = userCanceledErr;
+		goto bail;
+	}
+
+	QTSched_InsertInQueue(theScheduler, theJob);
+
+bail:
+	QTSys_UnlockMutex(theScheduler->fMutex);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSched_TrySubmitJob
+// Queue the specified job if there is room in the queue; return whether it was queued.
+//
+//////////
+
+Boolean QTSched_TrySubmitJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob)
+{
+	Boolean			myQueued = false;
+
+	if ((theScheduler == NULL) || (theJob == NULL))
+		return(false);
+
+	QTSys_LockMutex(theScheduler->fMutex);
+
+	if ((theJob->fState != kSchedJobQueued) && (theJob->fState != kSchedJobRunning) &&
+		(theScheduler->fQueueCount < theScheduler->fQueueCapacity) && !theScheduler->fShuttingDown) {
+		QTSched_InsertInQueue(theScheduler, theJob);
+		myQueued = true;
+	}
+
+	QTSys_UnlockMutex(theScheduler->fMutex);
+	return(myQueued);
+}
+
+
+//////////
+//
+// QTSched_CancelJob
+// Cancel the specified job.
+//
+// A queued job is removed from the queue at once. A running job is only asked to stop; it is finished
+// (and QTSched_WaitForJob returns) when the exporter next polls QTSched_IsJobCancelled and gives up.
+//
+//////////
+
+void QTSched_CancelJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob)
+{
+	if ((theScheduler == NULL) || (theJob == NULL))
+		return;
+
+	QTSys_LockMutex(theScheduler->fMutex);
+
+	if (theJob->fState == kSchedJobQueued) {
+		QTSched_RemoveFromQueue(theScheduler, theJob->fQueueIndex);
+		QTSched_FinishJob(theScheduler, theJob, userCanceledErr);
+	} else if (theJob->fState == kSchedJobRunning) {
+		QTSys_AtomicStore(&theJob->fCancelRequested, 1);
+	}
+
+	QTSys_UnlockMutex(theScheduler->fMutex);
+}
+
+
+//////////
+//
+// QTSched_CancelAllJobs
+// Cancel every queued job, and ask every running job to stop.
+//
+// Jobs that are submitted after this call returns are not affected.
+//
+//////////
+
+void QTSched_CancelAllJobs (QTSchedulerPtr theScheduler)
+{
+	long			myIndex;
+
+	if (theScheduler == NULL)
+		return;
+
+	QTSys_LockMutex(theScheduler->fMutex);
+
+	while (theScheduler->fQueueCount > 0)
+		QTSched_FinishJob(theScheduler, QTSched_RemoveFromQueue(theScheduler, theScheduler->fQueueCount - 1), userCanceledErr);
+
+	// the running jobs aren't in the queue, so we have to ask each worker which job it is running
+	for (myIndex = 0; myIndex < theScheduler->fWorkerCount; myIndex++)
+		if (theScheduler->fWorkers[myIndex].fCurrentJob != NULL)
+			QTSys_AtomicStore(&theScheduler->fWorkers[myIndex].fCurrentJob->fCancelRequested, 1);
+
+	QTSys_UnlockMutex(theScheduler->fMutex);
+}
+
+
+//////////
+//
+// QTSched_IsJobCancelled
+// Has the specified job been asked to stop? Exporters call this from their progress procedures.
+//
+//////////
+
+Boolean QTSched_IsJobCancelled (QTSchedJobPtr theJob)
+{
+	return(QTSys_AtomicLoad(&theJob->fCancelRequested) != 0);
+}
+
+
+//////////
+//
+// QTSched_GetJobRemainingMilliseconds
+// Return how long the specified job's export has left, or kEstUnknown if we can't tell yet.
+//
+// Jobs that haven't started may still have an estimate, from the history of earlier exports of the same
+// file type, if the exporter has told the job's estimator how much work it has; otherwise they return
+// kEstUnknown. Any thread may call this.
+//
+//////////
+
+long QTSched_GetJobRemainingMilliseconds (QTSchedJobPtr theJob)
+{
+	if (QTSys_AtomicLoad(&theJob->fState) >= kSchedJobDone)
+		return(0);
+
+	return(QTEst_GetRemainingMilliseconds(&theJob->fEstimator));
+}
+
+
+//////////
+//
+// QTSched_WaitForJob
+// Wait until the specified job has finished, failed or been cancelled.
+//
+//////////
+
+void QTSched_WaitForJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob)
+{
+	if ((theScheduler == NULL) || (theJob == NULL))
+		return;
+
+	QTSys_LockMutex(theScheduler->fMutex);
+	while ((theJob->fState == kSchedJobQueued) || (theJob->fState == kSchedJobRunning))
+		QTSys_WaitCondition(theScheduler->fJobFinished, theScheduler->fMutex);
+	QTSys_UnlockMutex(theScheduler->fMutex);
+}
+
+
+//////////
+//
+// QTSched_WaitForAllJobs
+// Wait until the queue is empty and no job is running.
+//
+//////////
+
+void QTSched_WaitForAllJobs (QTSchedulerPtr theScheduler)
+{
+	if (theScheduler == NULL)
+		return;
+
+	QTSys_LockMutex(theScheduler->fMutex);
+	while ((theScheduler->fQueueCount > 0) || (theScheduler->fRunningCount > 0))
+		QTSys_WaitCondition(theScheduler->fJobFinished, theScheduler->fMutex);
+	QTSys_UnlockMutex(theScheduler->fMutex);
+}
+
+
+//////////
+//
+// QTSched_WorkerThread
+// The body of each worker thread: take the most urgent job from the queue, export it, repeat.
+//
+// If the worker can't create its exporter instance, it still takes jobs from the queue and fails them
+// with that error; otherwise the jobs would wait forever if every worker had the same problem.
+//
+//////////
+
+static void QTSched_WorkerThread (void *theRefCon)
+{
+	QTSchedWorkerPtr		myWorker = (QTSchedWorkerPtr)theRefCon;
+	QTSchedulerPtr			mySched = myWorker->fScheduler;
+	QTSchedExporterPtr		myExporter = mySched->fExporter;
+	void					*myWorkerData = NULL;
+	QTSchedJobPtr			myJob = NULL;
+	OSErr					myWorkerErr = noErr;
+	OSErr					myErr = noErr;
+
+	myWorkerErr = myExporter->fNewWorker(myExporter->fRefCon, &myWorkerData);
+
+	for (;;) {
+		QTSys_LockMutex(mySched->fMutex);
+
+		while ((mySched->fQueueCount == 0) && !mySched->fShuttingDown)
+			QTSys_WaitCondition(mySched->fWorkAvailable, mySched->fMutex);
+
+		if (mySched->fQueueCount == 0) {
+			QTSys_UnlockMutex(mySched->fMutex);
+			break;
+		}
+
+		myJob = QTSched_RemoveFromQueue(mySched, 0);
+		QTSys_AtomicStore(&myJob->fState, kSchedJobRunning);
+		myJob->fWorkerIndex = myWorker->fIndex;
+		myJob->fStartTime = QTSys_GetMicroseconds();
+		mySched->fRunningCount++;
+		myWorker->fCurrentJob = myJob;
+
+		QTSys_UnlockMutex(mySched->fMutex);
+
+		if (myWorkerErr != noErr)
+			myErr = myWorkerErr;
+		else if (QTSched_IsJobCancelled(myJob))
+			myErr = userCanceledErr;
+		else
+			myErr = myExporter->fExportJob(myWorkerData, myJob);
+
+		QTSys_LockMutex(mySched->fMutex);
+		mySched->fRunningCount--;
+		myWorker->fCurrentJob = NULL;
+		QTSched_FinishJob(mySched, myJob, myErr);
+		QTSys_UnlockMutex(mySched->fMutex);
+	}
+
+	if (myWorkerErr == noErr)
+		myExporter->fDisposeWorker(myWorkerData);
+}
+
+
+//////////
+//
+// QTSched_FinishJob
+// Record the outcome of a job and wake anyone waiting for it. The caller must hold the scheduler's mutex.
+//
+//////////
+
+static void QTSched_FinishJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob, OSErr theErr)
+{
+	theJob->fErr = theErr;
+	theJob->fEndTime = QTSys_GetMicroseconds();
+
+	if (theErr == noErr)
+		QTSys_AtomicStore(&theJob->fState, kSchedJobDone);
+	else if (theErr == userCanceledErr)
+		QTSys_AtomicStore(&theJob->fState, kSchedJobCancelled);
+	else
+		QTSys_AtomicStore(&theJob->fState, kSchedJobFailed);
+
+	QTSys_BroadcastCondition(theScheduler->fJobFinished);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Queue functions.
+//
+// The queue is a binary heap of job pointers, ordered by priority and then by submission order. Each job
+// remembers its position in the heap, so that QTSched_CancelJob can remove it without a search. All of
+// these functions must be called with the scheduler's mutex held.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSched_JobPrecedes
+// Should theJob1 be started before theJob2?
+//
+//////////
+
+static Boolean QTSched_JobPrecedes (QTSchedJobPtr theJob1, QTSchedJobPtr theJob2)
+{
+	if (theJob1->fPriority != theJob2->fPriority)
+		return(theJob1->fPriority > theJob2->fPriority);
+
+	return(theJob1->fSequence < theJob2->fSequence);
+}
+
+
+//////////
+//
+// QTSched_SetQueueEntry
+// Put a job at the specified position in the heap.
+//
+//////////
+
+static void QTSched_SetQueueEntry (QTSchedulerPtr theScheduler, long theIndex, QTSchedJobPtr theJob)
+{
+	theScheduler->fQueue[theIndex] = theJob;
+	theJob->fQueueIndex = theIndex;
+}
+
+
+//////////
+//
+// QTSched_SiftUp
+// Move the job at the specified position towards the top of the heap until the heap is ordered again.
+//
+//////////
+
+static void QTSched_SiftUp (QTSchedulerPtr theScheduler, long theIndex)
+{
+	QTSchedJobPtr	myJob = theScheduler->fQueue[theIndex];
+
+	while (theIndex > 0) {
+		long		myParent = (theIndex - 1) / 2;
+
+		if (!QTSched_JobPrecedes(myJob, theScheduler->fQueue[myParent]))
+			break;
+
+		QTSched_SetQueueEntry(theScheduler, theIndex, theScheduler->fQueue[myParent]);
+		theIndex = myParent;
+	}
+
+	QTSched_SetQueueEntry(theScheduler, theIndex, myJob);
+}
+
+
+//////////
+//
+// QTSched_SiftDown
+// Move the job at the specified position towards the bottom of the heap until the heap is ordered again.
+//
+//////////
+
+static void QTSched_SiftDown (QTSchedulerPtr theScheduler, long theIndex)
+{
+	QTSchedJobPtr	myJob = theScheduler->fQueue[theIndex];
+
+	for (;;) {
+		long		myChild = (2 * theIndex) + 1;
+
+		if (myChild >= theScheduler->fQueueCount)
+			break;
+
+		if ((myChild + 1 < theScheduler->fQueueCount) && QTSched_JobPrecedes(theScheduler->fQueue[myChild + 1], theScheduler->fQueue[myChild]))
+			myChild++;
+
+		if (!QTSched_JobPrecedes(theScheduler->fQueue[myChild], myJob))
+			break;
+
+		QTSched_SetQueueEntry(theScheduler, theIndex, theScheduler->fQueue[myChild]);
+		theIndex = myChild;
+	}
+
+	QTSched_SetQueueEntry(theScheduler, theIndex, myJob);
+}
+
+
+//////////
+//
+// QTSched_InsertInQueue
+// Add a job to the queue, which must not be full, and wake a worker to run it.
+//
+//////////
+
+static void QTSched_InsertInQueue (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob)
+{
+	QTSys_AtomicStore(&theJob->fState, kSchedJobQueued);
+	theJob->fCancelRequested = 0;
+	theJob->fErr = noErr;
+	theJob->fWorkerIndex = -1;
+	theJob->fSubmitTime = QTSys_GetMicroseconds();
+	theJob->fStartTime = 0;
+	theJob->fEndTime = 0;
+	theJob->fSequence = theScheduler->fNextSequence++;
+
+	theScheduler->fQueueCount++;
+	QTSched_SetQueueEntry(theScheduler, theScheduler->fQueueCount - 1, theJob);
+	QTSched_SiftUp(theScheduler, theScheduler->fQueueCount - 1);
+
+	QTSys_SignalCondition(theScheduler->fWorkAvailable);
+}
+
+
+//////////
+//
+// QTSched_RemoveFromQueue
+// Remove the job at the specified position in the queue, and wake a thread waiting to submit a job.
+//
+//////////
+
+static QTSchedJobPtr QTSched_RemoveFromQueue (QTSchedulerPtr theScheduler, long theIndex)
+{
+	QTSchedJobPtr	myJob = theScheduler->fQueue[theIndex];
+	long			myLast = --theScheduler->fQueueCount;
+
+	// move the last job into the hole and restore the heap order in whichever direction it is broken
+	if (theIndex != myLast) {
+		QTSched_SetQueueEntry(theScheduler, theIndex, theScheduler->fQueue[myLast]);
+		QTSched_SiftDown(theScheduler, theIndex);
+		QTSched_SiftUp(theScheduler, theScheduler->fQueue[theIndex]->fQueueIndex);
+	}
+
+	theScheduler->fQueue[myLast] = NULL;
+	myJob->fQueueIndex = -1;
+
+	QTSys_SignalCondition(theScheduler->fSpaceAvailable);
+
+	return(myJob);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Job functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSched_InitJob
+// Initialize a job record, ready to be submitted.
+//
+//////////
+
+void QTSched_InitJob (QTSchedJobPtr theJob, const char *theInPath, const char *theOutPath, OSType theFileType, long thePriority)
+{
+	memset(theJob, 0, sizeof(QTSchedJobRecord));
+
+	theJob->fInPath = theInPath;
+	theJob->fOutPath = theOutPath;
+	theJob->fFileType = theFileType;
+	theJob->fPriority = thePriority;
+	QTSys_AtomicStore(&theJob->fState, kSchedJobIdle);
+	theJob->fWorkerIndex = -1;
+	theJob->fQueueIndex = -1;
+
+	QTEst_Init(&theJob->fEstimator, theFileType, 0, 0);
+}
+
+
+//////////
+//
+// QTSched_WriteJobReport
+// Write the outcome of one job as a single line of JSON.
+//
+//////////
+
+void QTSched_WriteJobReport (FILE *theReport, QTSchedJobPtr theJob)
+{
+	QTUInt64		myQueuedTime = 0;
+	QTUInt64		myExportTime = 0;
+
+	if (theJob->fStartTime != 0) {
+		myQueuedTime = theJob->fStartTime - theJob->fSubmitTime;
+		myExportTime = theJob->fEndTime - theJob->fStartTime;
+	} else if (theJob->fEndTime != 0) {
+		myQueuedTime = theJob->fEndTime - theJob->fSubmitTime;
+	}
+
+	fputs("{\"input\":", theReport);
+	QTSys_WriteJSONString(theReport, theJob->fInPath);
+	fputs(",\"output\":", theReport);
+	QTSys_WriteJSONString(theReport, theJob->fOutPath);
+	fprintf(theReport, ",\"type\":\"%c%c%c%c\",\"priority\":%ld,\"status\":\"%s\",\"err\":%d,\"worker\":%ld,\"queuedMicroseconds\":%llu,\"exportMicroseconds\":%llu}\n",
+						(char)((theJob->fFileType >> 24) & 0xFF),
+						(char)((theJob->fFileType >> 16) & 0xFF),
+						(char)((theJob->fFileType >> 8) & 0xFF),
+						(char)(theJob->fFileType & 0xFF),
+						theJob->fPriority,
+						QTSched_GetStateName(theJob->fState),
+						(int)theJob->fErr,
+						theJob->fWorkerIndex,
+						(unsigned long long)myQueuedTime,
+						(unsigned long long)myExportTime);
+}
+
+
+//////////
+//
+// QTSched_GetStateName
+// Return the name used for the specified job state in reports.
+//
+//////////
+
+static const char *QTSched_GetStateName (long theState)
+{
+	switch (theState) {
+		case kSchedJobQueued:			return("queued");
+		case kSchedJobRunning:			return("running");
+		case kSchedJobDone:				return("exported");
+		case kSchedJobFailed:			return("failed");
+		case kSchedJobCancelled:		return("cancelled");
+		default:						return("idle");
+	}
+}
+
+
+//////////
+//
+// QTSched_StringToOSType
+// Convert a string of up to four characters into an OSType, padding it with spaces.
+//
+//////////
+
+static OSType QTSched_StringToOSType (const char *theString)
+{
+	OSType			myType = 0;
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < 4; myIndex++) {
+		unsigned char	myChar = ' ';
+
+		if ((theString != NULL) && (*theString != '\0'))
+			myChar = (unsigned char)*theString++;
+
+		myType = (myType << 8) | myChar;
+	}
+
+	return(myType);
+}
+
+
+//////////
+//
+// QTSched_ReadJobList
+// Read the job-list file at the specified path into theList.
+//
+// Each line has an input path, an output path, and optionally an output file type and a priority, all
+// separated by tabs. Blank lines and lines beginning with '#' are ignored.
+//
+//////////
+
+static OSErr QTSched_ReadJobList (const char *thePath, OSType theDefaultType, QTSchedJobListPtr theList)
+{
+	FILE			*myFile = NULL;
+	char			myLine[kSchedMaxLineLength];
+	OSErr			myErr = noErr;
+
+	myFile = fopen(thePath, "r");
+	if (myFile == NULL)
+		return(fnfErr);
+
+	while (fgets(myLine, sizeof(myLine), myFile) != NULL) {
+		char			*myFields[4] = {NULL, NULL, NULL, NULL};
+		char			*myField = QTSys_TrimLine(myLine);
+		long			myCount = 0;
+		QTSchedJobPtr	myJob;
+
+		if ((*myField == '\0') || (*myField == kSchedListComment))
+			continue;
+
+		while ((myField != NULL) && (myCount < 4)) {
+			myFields[myCount++] = myField;
+			myField = strchr(myField, kSchedListSeparator);
+			if (myField != NULL)
+				*myField++ = '\0';
+		}
+
+		if ((myCount < 2) || (*myFields[0] == '\0') || (*myFields[1] == '\0')) {
+			myErr = paramErr;
+			break;
+		}
+
+		if (theList->fCount == theList->fCapacity) {
+			long			myCapacity = (theList->fCapacity == 0) ? kSchedInitialListCapacity : 2 * theList->fCapacity;
+			QTSchedJobPtr	myJobs = (QTSchedJobPtr)realloc(theList->fJobs, (size_t)myCapacity * sizeof(QTSchedJobRecord));
+
+			if (myJobs == NULL) {
+				myErr = memFullErr;
+				break;
+			}
+
+			theList->fJobs = myJobs;
+			theList->fCapacity = myCapacity;
+		}
+
+		myJob = &theList->fJobs[theList->fCount];
+		QTSched_InitJob(myJob,
+						QTSys_CopyString(myFields[0]),
+						QTSys_CopyString(myFields[1]),
+						((myCount > 2) && (*myFields[2] != '\0')) ? QTSched_StringToOSType(myFields[2]) : theDefaultType,
+						(myCount > 3) ? atol(myFields[3]) : kSchedPriorityNormal);
+		theList->fCount++;
+
+		if ((myJob->fInPath == NULL) || (myJob->fOutPath == NULL)) {
+			myErr = memFullErr;
+			break;
+		}
+	}
+
+	fclose(myFile);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSched_DisposeJobList
+// Dispose of the jobs read by QTSched_ReadJobList.
+//
+//////////
+
+static void QTSched_DisposeJobList (QTSchedJobListPtr theList)
+{
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < theList->fCount; myIndex++) {
+		free((void *)theList->fJobs[myIndex].fInPath);
+		free((void *)theList->fJobs[myIndex].fOutPath);
+	}
+
+	free(theList->fJobs);
+
+	theList->fJobs = NULL;
+	theList->fCount = 0;
+	theList->fCapacity = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Synthetic exporter.
+//
+// The synthetic exporter stands in for a real movie exporter when we want to measure the scheduler
+// rather than QuickTime: each job keeps one processor busy for a fixed time, stirring a per-worker
+// scratch buffer (the stand-in for the exporter instance) and polling for cancellation as it goes.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static UInt32						gSyntheticMicroseconds = kSchedDefaultBenchmarkMicroseconds;
+
+static QTSchedExporterRecord		gSyntheticExporter = {
+	&gSyntheticMicroseconds,
+	QTSched_SyntheticNewWorker,
+	QTSched_SyntheticExportJob,
+	QTSched_SyntheticDisposeWorker
+};
+
+typedef struct QTSchedSyntheticWorkerRecord {
+	UInt32					fMicroseconds;
+	UInt32					*fScratch;
+} QTSchedSyntheticWorkerRecord, *QTSchedSyntheticWorkerPtr;
+
+
+//////////
+//
+// QTSched_GetSyntheticExporter
+// Return an exporter whose jobs each take theMicroseconds of processor time.
+//
+//////////
+
+QTSchedExporterPtr QTSched_GetSyntheticExporter (UInt32 theMicroseconds)
+{
+	gSyntheticMicroseconds = theMicroseconds;
+	return(&gSyntheticExporter);
+}
+
+
+//////////
+//
+// QTSched_SyntheticNewWorker
+// Create the per-worker state of the synthetic exporter.
+//
+//////////
+
+static OSErr QTSched_SyntheticNewWorker (void *theRefCon, void **theWorkerData)
+{
+	QTSchedSyntheticWorkerPtr	myWorker = (QTSchedSyntheticWorkerPtr)malloc(sizeof(QTSchedSyntheticWorkerRecord));
+
+	*theWorkerData = myWorker;
+	if (myWorker == NULL)
+		return(memFullErr);
+
+	myWorker->fMicroseconds = *(UInt32 *)theRefCon;
+	myWorker->fScratch = (UInt32 *)calloc(1, kSchedSyntheticScratchSize);
+	if (myWorker->fScratch == NULL) {
+		free(myWorker);
+		*theWorkerData = NULL;
+		return(memFullErr);
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSched_SyntheticExportJob
+// Keep this processor busy for the configured time, or until the job is cancelled.
+//
+//////////
+
+static OSErr QTSched_SyntheticExportJob (void *theWorkerData, QTSchedJobPtr theJob)
+{
+	QTSchedSyntheticWorkerPtr	myWorker = (QTSchedSyntheticWorkerPtr)theWorkerData;
+	QTUInt64					myStartTime = QTSys_GetMicroseconds();
+	UInt32						mySeed = (UInt32)theJob->fSequence;
+	long						myCount = kSchedSyntheticScratchSize / sizeof(UInt32);
+	long						myIndex;
+
+	QTEst_Init(&theJob->fEstimator, theJob->fFileType, myWorker->fMicroseconds, myStartTime);
+
+	while (QTSys_GetMicroseconds() - myStartTime < myWorker->fMicroseconds) {
+		QTUInt64		myNow = QTSys_GetMicroseconds();
+
+		if (QTSched_IsJobCancelled(theJob))
+			return(userCanceledErr);
+
+		QTEst_Update(&theJob->fEstimator, (long)(((myNow - myStartTime) * kProgDone) / myWorker->fMicroseconds), myNow);
+
+		for (myIndex = 0; myIndex < myCount; myIndex++) {
+			mySeed = (mySeed * 1664525UL) + 1013904223UL;
+			myWorker->fScratch[myIndex] ^= mySeed;
+		}
+	}
+
+	QTEst_Update(&theJob->fEstimator, kProgDone, QTSys_GetMicroseconds());
+	QTEst_Finish(&theJob->fEstimator, QTSys_GetMicroseconds());
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSched_SyntheticDisposeWorker
+// Dispose of the per-worker state of the synthetic exporter.
+//
+//////////
+
+static void QTSched_SyntheticDisposeWorker (void *theWorkerData)
+{
+	QTSchedSyntheticWorkerPtr	myWorker = (QTSchedSyntheticWorkerPtr)theWorkerData;
+
+	if (myWorker == NULL)
+		return;
+
+	free(myWorker->fScratch);
+	free(myWorker);
+}
+
+
+//////////
+//
+// QTSched_RunBenchmark
+// Measure export throughput with 1, 2, 4, ... theMaxWorkers workers, using the synthetic exporter.
+//
+// Each run exports theJobCount jobs of theMicroseconds each; we write one JSON line per run, giving
+// the throughput and the speedup over a single worker. With enough processors the speedup should be
+// close to the number of workers.
+//
+//////////
+
+OSErr QTSched_RunBenchmark (FILE *theReport, long theMaxWorkers, long theJobCount, UInt32 theMicroseconds)
+{
+	QTSchedJobPtr			myJobs = NULL;
+	QTSchedulerPtr			mySched = NULL;
+	double					myBaseRate = 0.0;
+	long					myWorkers;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theMaxWorkers <= 0)
+		theMaxWorkers = QTSys_GetProcessorCount();
+	if (theMaxWorkers > kSchedMaxWorkers)
+		theMaxWorkers = kSchedMaxWorkers;
+	if (theJobCount <= 0)
+		theJobCount = kSchedDefaultBenchmarkJobs;
+
+	myJobs = (QTSchedJobPtr)calloc((size_t)theJobCount, sizeof(QTSchedJobRecord));
+	if (myJobs == NULL)
+		return(memFullErr);
+
+	// double the worker count each run, finishing with exactly theMaxWorkers
+	for (myWorkers = 1; myWorkers <= theMaxWorkers; myWorkers = ((myWorkers < theMaxWorkers) && (2 * myWorkers > theMaxWorkers)) ? theMaxWorkers : 2 * myWorkers) {
+		QTUInt64		myStartTime;
+		QTUInt64		myWallTime;
+		double			myRate;
+		long			myFailed = 0;
+
+		myErr = QTSched_NewScheduler(QTSched_GetSyntheticExporter(theMicroseconds), myWorkers, kSchedDefaultQueueCapacity, &mySched);
+		if (myErr != noErr)
+			goto bail;
+
+		myStartTime = QTSys_GetMicroseconds();
+
+		// the queue is smaller than the job count, so this also exercises the submitter blocking on a full queue
+		for (myIndex = 0; myIndex < theJobCount; myIndex++) {
+			QTSched_InitJob(&myJobs[myIndex], "synthetic", "synthetic", FOUR_CHAR_CODE('null'), kSchedPriorityNormal);
+			QTSched_SubmitJob(mySched, &myJobs[myIndex]);
+		}
+
+		QTSched_WaitForAllJobs(mySched);
+		myWallTime = QTSys_GetMicroseconds() - myStartTime;
+
+		QTSched_DisposeScheduler(mySched);
+		mySched = NULL;
+
+		for (myIndex = 0; myIndex < theJobCount; myIndex++)
+			if (myJobs[myIndex].fState != kSchedJobDone)
+				myFailed++;
+
+		myRate = (myWallTime > 0) ? ((double)theJobCount * 1000000.0 / (double)myWallTime) : 0.0;
+		if (myWorkers == 1)
+			myBaseRate = myRate;
+
+		if (theReport != NULL) {
+			fprintf(theReport, "{\"benchmark\":\"scheduler\",\"workers\":%ld,\"jobs\":%ld,\"jobMicroseconds\":%lu,\"failed\":%ld,\"wallMicroseconds\":%llu,\"jobsPerSecond\":%.2f,\"speedup\":%.2f}\n",
+						myWorkers,
+						theJobCount,
+						(unsigned long)theMicroseconds,
+						myFailed,
+						(unsigned long long)myWallTime,
+						myRate,
+						(myBaseRate > 0.0) ? (myRate / myBaseRate) : 0.0);
+			fflush(theReport);
+		}
+	}
+
+bail:
+	free(myJobs);
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSched_IsSchedulerCommandLine
+// Does the specified command line ask for parallel export mode or for the scheduler benchmark?
+//
+//////////
+
+Boolean QTSched_IsSchedulerCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if ((strcmp(theArgv[myIndex], kSchedExportSwitch) == 0) || (strcmp(theArgv[myIndex], kSchedBenchmarkSwitch) == 0))
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTSched_Main
+// Run parallel export mode (or the benchmark), using the specified exporter. Returns one of the kSchedExit constants.
+//
+// Usage: -export <job list> [-type <file type>] [-workers <count>] [-queue <count>] [-report <file>]
+//        -exportbench [-workers <count>] [-report <file>]
+//
+// The report has one JSON line per job, in job-list order, and a summary line at the end. Only -export needs
+// theExporter; the benchmark always uses QTSched_GetSyntheticExporter, so theExporter may be NULL for it.
+//
+//////////
+
+int QTSched_Main (int theArgc, char *theArgv[], QTSchedExporterPtr theExporter)
+{
+	QTSchedJobListRecord	myList = {NULL, 0, 0};
+	QTSchedulerPtr			mySched = NULL;
+	const char				*myListPath = NULL;
+	const char				*myReportPath = NULL;
+	OSType					myDefaultType = FOUR_CHAR_CODE('MooV');
+	Boolean					myBenchmark = false;
+	long					myWorkers = 0;
+	long					myQueueCapacity = kSchedDefaultQueueCapacity;
+	long					myCounts[kSchedJobCancelled + 1] = {0, 0, 0, 0, 0, 0};
+	FILE					*myReport = stdout;
+	QTUInt64				myStartTime;
+	int						myExitCode = kSchedExitSuccess;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kSchedExportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myListPath = theArgv[++myIndex];
+		else if (strcmp(theArgv[myIndex], kSchedBenchmarkSwitch) == 0)
+			myBenchmark = true;
+		else if ((strcmp(theArgv[myIndex], kSchedTypeSwitch) == 0) && (myIndex + 1 < theArgc))
+			myDefaultType = QTSched_StringToOSType(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSchedWorkersSwitch) == 0) && (myIndex + 1 < theArgc))
+			myWorkers = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSchedQueueSwitch) == 0) && (myIndex + 1 < theArgc))
+			myQueueCapacity = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSchedReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if (!myBenchmark && ((myListPath == NULL) || (theExporter == NULL))) {
+		fprintf(stderr, "usage: %s %s <job list> [%s <file type>] [%s <count>] [%s <count>] [%s <file>]\n", theArgv[0], kSchedExportSwitch, kSchedTypeSwitch, kSchedWorkersSwitch, kSchedQueueSwitch, kSchedReportSwitch);
+		fprintf(stderr, "       %s %s [%s <count>] [%s <file>]\n", theArgv[0], kSchedBenchmarkSwitch, kSchedWorkersSwitch, kSchedReportSwitch);
+		return(kSchedExitUsage);
+	}
+
+	if (!myBenchmark) {
+		myErr = QTSched_ReadJobList(myListPath, myDefaultType, &myList);
+		if (myErr != noErr) {
+			fprintf(stderr, "cannot read job list %s (error %d)\n", myListPath, (int)myErr);
+			QTSched_DisposeJobList(&myList);
+			return(kSchedExitUsage);
+		}
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			QTSched_DisposeJobList(&myList);
+			return(kSchedExitUsage);
+		}
+	}
+
+	if (myBenchmark) {
+		myErr = QTSched_RunBenchmark(myReport, myWorkers, kSchedDefaultBenchmarkJobs, kSchedDefaultBenchmarkMicroseconds);
+		myExitCode = (myErr == noErr) ? kSchedExitSuccess : kSchedExitSomeFailed;
+		goto bail;
+	}
+
+	myStartTime = QTSys_GetMicroseconds();
+
+	myErr = QTSched_NewScheduler(theExporter, myWorkers, myQueueCapacity, &mySched);
+	if (myErr != noErr) {
+		fprintf(stderr, "cannot start the export workers (error %d)\n", (int)myErr);
+		myExitCode = kSchedExitUsage;
+		goto bail;
+	}
+
+	// submitting blocks whenever the queue is full, so the workers set the pace
+	for (myIndex = 0; myIndex < myList.fCount; myIndex++)
+		QTSched_SubmitJob(mySched, &myList.fJobs[myIndex]);
+
+	for (myIndex = 0; myIndex < myList.fCount; myIndex++) {
+		QTSchedJobPtr		myJob = &myList.fJobs[myIndex];
+
+		QTSched_WaitForJob(mySched, myJob);
+		myCounts[myJob->fState]++;
+
+		QTSched_WriteJobReport(myReport, myJob);
+		fflush(myReport);
+	}
+
+	fprintf(myReport, "{\"summary\":true,\"jobs\":%ld,\"exported\":%ld,\"failed\":%ld,\"cancelled\":%ld,\"workers\":%ld,\"wallMicroseconds\":%llu}\n",
+						myList.fCount,
+						myCounts[kSchedJobDone],
+						myCounts[kSchedJobFailed],
+						myCounts[kSchedJobCancelled],
+						mySched->fWorkerCount,
+						(unsigned long long)(QTSys_GetMicroseconds() - myStartTime));
+	fflush(myReport);
+
+	if (myCounts[kSchedJobDone] != myList.fCount)
+		myExitCode = kSchedExitSomeFailed;
+
+bail:
+	QTSched_DisposeScheduler(mySched);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	QTSched_DisposeJobList(&myList);
+
+	return(myExitCode);
+}
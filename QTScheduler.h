@@ -0,0 +1,135 @@
+//////////
+//
+//	File:		QTScheduler.h
+//
+//	Contains:	A multi-worker scheduler for running movie exports in parallel.
+//				All utilities start with the prefix "QTSched_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTScheduler__
+#define __QTScheduler__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTEstimate.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kSchedExportSwitch					"-export"				// command-line switch that selects parallel export mode
+#define kSchedBenchmarkSwitch				"-exportbench"			// run the synthetic-exporter throughput benchmark
+#define kSchedWorkersSwitch					"-workers"				// number of worker threads
+#define kSchedQueueSwitch					"-queue"				// maximum number of queued (not yet running) jobs
+#define kSchedTypeSwitch					"-type"					// default output file type for job-list lines that have none
+#define kSchedReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kSchedDefaultQueueCapacity			64
+#define kSchedMaxWorkers					64
+#define kSchedDefaultBenchmarkJobs			64
+#define kSchedDefaultBenchmarkMicroseconds	20000					// CPU time each synthetic export takes
+
+// job priorities; any long will do, higher runs first
+enum {
+	kSchedPriorityLow						= -100,
+	kSchedPriorityNormal					= 0,
+	kSchedPriorityHigh						= 100
+};
+
+// state of a single job
+enum {
+	kSchedJobIdle							= 0,					// not submitted yet
+	kSchedJobQueued							= 1,					// waiting for a worker
+	kSchedJobRunning						= 2,					// being exported
+	kSchedJobDone							= 3,					// exported successfully
+	kSchedJobFailed							= 4,					// the exporter returned an error
+	kSchedJobCancelled						= 5						// cancelled before or during the export
+};
+
+// exit codes returned by QTSched_Main
+enum {
+	kSchedExitSuccess						= 0,
+	kSchedExitSomeFailed					= 1,
+	kSchedExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTSchedulerRecord			*QTSchedulerPtr;
+
+// one export; the caller owns the record (and the paths) and must not touch it while it is queued or running
+typedef struct QTSchedJobRecord {
+	const char				*fInPath;				// the movie to export
+	const char				*fOutPath;				// the file to export it into
+	OSType					fFileType;				// the output file type (selects the exporter)
+	long					fPriority;				// higher priorities are started first
+	void					*fRefCon;				// for the caller's use
+
+	volatile long			fState;					// one of the kSchedJob constants; always written with QTSys_AtomicStore
+	volatile long			fCancelRequested;		// set by QTSched_CancelJob; polled by the exporter
+	OSErr					fErr;					// error returned by the exporter, if any
+	long					fWorkerIndex;			// the worker that ran the job
+	QTUInt64				fSubmitTime;			// times, in microseconds
+	QTUInt64				fStartTime;
+	QTUInt64				fEndTime;
+	QTEstimatorRecord		fEstimator;				// how long the export has left; the exporter keeps it up to date
+
+	// private to QTScheduler.c
+	long					fSequence;				// submission order, used to keep equal priorities FIFO
+	long					fQueueIndex;			// position in the scheduler's queue, or -1
+} QTSchedJobRecord, *QTSchedJobPtr;
+
+// the exporter interface; each worker thread calls fNewWorker once to get its own exporter instance,
+// passes that instance to fExportJob for every job it runs, and calls fDisposeWorker when it quits
+typedef struct QTSchedExporterRecord {
+	void					*fRefCon;
+	OSErr					(*fNewWorker) (void *theRefCon, void **theWorkerData);
+	OSErr					(*fExportJob) (void *theWorkerData, QTSchedJobPtr theJob);
+	void					(*fDisposeWorker) (void *theWorkerData);
+} QTSchedExporterRecord, *QTSchedExporterPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTSched_NewScheduler (QTSchedExporterPtr theExporter, long theWorkerCount, long theQueueCapacity, QTSchedulerPtr *theScheduler);
+void						QTSched_DisposeScheduler (QTSchedulerPtr theScheduler);
+
+OSErr						QTSched_SubmitJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob);
+Boolean						QTSched_TrySubmitJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob);
+void						QTSched_CancelJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob);
+void						QTSched_CancelAllJobs (QTSchedulerPtr theScheduler);
+Boolean						QTSched_IsJobCancelled (QTSchedJobPtr theJob);
+long						QTSched_GetJobRemainingMilliseconds (QTSchedJobPtr theJob);
+void						QTSched_WaitForJob (QTSchedulerPtr theScheduler, QTSchedJobPtr theJob);
+void						QTSched_WaitForAllJobs (QTSchedulerPtr theScheduler);
+
+void						QTSched_InitJob (QTSchedJobPtr theJob, const char *theInPath, const char *theOutPath, OSType theFileType, long thePriority);
+void						QTSched_WriteJobReport (FILE *theReport, QTSchedJobPtr theJob);
+
+QTSchedExporterPtr			QTSched_GetSyntheticExporter (UInt32 theMicroseconds);
+OSErr						QTSched_RunBenchmark (FILE *theReport, long theMaxWorkers, long theJobCount, UInt32 theMicroseconds);
+
+Boolean						QTSched_IsSchedulerCommandLine (int theArgc, char *theArgv[]);
+int							QTSched_Main (int theArgc, char *theArgv[], QTSchedExporterPtr theExporter);
+
+#endif	// __QTScheduler__
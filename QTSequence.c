@@ -0,0 +1,1186 @@
+//////////
+//
+//	File:		QTSequence.c
+//
+//	Contains:	A portable engine that turns a numbered sequence of still images into one movie, decoding
+//				the stills on several threads within a fixed memory budget.
+//				All utilities start with the prefix "QTSeq_".
+//
+//	QTFrame_OpenMovieInWindow opens a still with a graphics importer and shows it on its own. A sequence
+//	of tens of thousands of numbered stills (render output, scans, time-lapse frames) is one movie, and
+//	decoding the stills one after another leaves all but one processor idle while the compressor waits.
+//
+//	QTSeq_FindSequence takes any one still of a sequence, finds the number in its name, and collects the
+//	files in the same folder whose names differ from it only in that number, from that still on. Missing
+//	numbers are allowed: the still before a gap is held until the next one, so the movie keeps time.
+//
+//	QTSeq_ImportSequence decodes the stills on a pool of threads into a fixed set of frame buffers, as
+//	many as fit in the memory budget, and adds them to the movie in order on the calling thread. Frame n
+//	always goes into buffer n modulo the buffer count, and a thread may take frame n only once frame
+//	n minus the buffer count has been added to the movie; so the buffers are reused from one frame to the
+//	next, at most the buffer count of frames are decoded and waiting at once, and a slow still or a slow
+//	compressor holds the other threads back rather than letting them run ahead.
+//
+//	The importer interface keeps QuickTime out of this file: QTDataEx.c decodes with graphics importers
+//	and compresses with the Standard Compression component, and the stub importer here reads binary PPM
+//	stills and writes their pixels to a plain file, so the engine can be exercised anywhere.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSequence.h"
+#include "QTAtoms.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kSeqStubHeaderSize			64						// bytes we read to find the size of a PPM still
+#define kSeqStubMovieType			FOUR_CHAR_CODE('QTSq')	// first four bytes of a stub movie
+#define kSeqStubMovieHeaderSize		16
+#define kSeqStubFrameHeaderSize		8
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// what the threads of QTSeq_ImportSequence share
+typedef struct QTSeqRunRecord {
+	QTSeqSequencePtr		fSequence;
+	QTSeqImporterPtr		fImporter;
+	QTSysMutex				fMutex;
+	QTSysCondition			fFrameReady;			// signalled when a thread finishes a frame, or stops
+	QTSysCondition			fBufferFree;			// signalled when a frame is added to the movie, or we stop
+	QTFanFrameRecord		*fBuffers;
+	long					*fReadyFrames;			// for each buffer, the frame decoded into it, or -1
+	long					fBufferCount;
+	long					fWidth;
+	long					fHeight;
+	long					fNextFrame;				// the next frame a thread may take
+	long					fAddedCount;			// frames added to the movie
+	long					fPeakBuffers;
+	QTUInt64				fDecodeMicroseconds;
+	OSErr					fErr;					// the first error; once it is set, everyone stops
+} QTSeqRunRecord, *QTSeqRunPtr;
+
+// the stub importer's decoder: a buffer for the file it reads, kept from one still to the next
+typedef struct QTSeqStubDecoderRecord {
+	UInt8					*fData;
+	UInt32					fCapacity;
+} QTSeqStubDecoderRecord, *QTSeqStubDecoderPtr;
+
+typedef struct QTSeqStubMovieRecord {
+	QTSysFile				fFile;
+	char					fPath[kQTSysMaxPath];
+} QTSeqStubMovieRecord, *QTSeqStubMoviePtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static Boolean				QTSeq_IsDigit (char theChar);
+static int					QTSeq_CompareFrames (const void *theFrame1, const void *theFrame2);
+static OSErr				QTSeq_AddFrame (QTSeqSequencePtr theSequence, const char *thePath, long theNumber);
+static void					QTSeq_Stop (QTSeqRunPtr theRun, OSErr theErr);
+static Boolean				QTSeq_DecodeNextFrame (QTSeqRunPtr theRun, void *theDecoder);
+static void					QTSeq_DecodeThread (void *theRefCon);
+
+static OSErr				QTSeq_StubReadHeader (const UInt8 *theData, UInt32 theSize, long *theWidth, long *theHeight, UInt32 *theDataOffset);
+static OSErr				QTSeq_StubGetFrameSize (void *theRefCon, const char *thePath, long *theWidth, long *theHeight);
+static OSErr				QTSeq_StubNewDecoder (void *theRefCon, void **theDecoder);
+static OSErr				QTSeq_StubDecodeFrame (void *theDecoder, const char *thePath, QTFanFramePtr theFrame);
+static void					QTSeq_StubDisposeDecoder (void *theDecoder);
+static OSErr				QTSeq_StubBeginMovie (void *theRefCon, const char *theOutPath, const QTFanFormatRecord *theFormat, void **theMovie);
+static OSErr				QTSeq_StubAddFrame (void *theMovie, const QTFanFrameRecord *theFrame);
+static OSErr				QTSeq_StubEndMovie (void *theMovie, OSErr theErr);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Sequence functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSeq_FindSequence
+// Find the stills of the sequence that the still at thePath belongs to, from that still on.
+//
+// The frame number is the last run of digits in the file name before its extension. The other stills
+// are the files in the same folder whose names have the same text before and after the number.
+//
+//////////
+
+OSErr QTSeq_FindSequence (const char *thePath, QTSeqSequencePtr theSequence)
+{
+	QTSysDirectory			myDirectory = NULL;
+	QTSysDirEntryRecord		myDirEntry;
+	char					myPath[kQTSysMaxPath];
+	const char				*myName;
+	const char				*myExtension;
+	size_t					myPrefixLength;
+	size_t					mySuffixLength;
+	size_t					myLength;
+	size_t					myStart;
+	size_t					myEnd;
+	long					myFirstNumber;
+	long					myNumber;
+	long					myIndex;
+	long					myCount;
+	OSErr					myErr = noErr;
+
+	if ((thePath == NULL) || (theSequence == NULL))
+		return(paramErr);
+
+	memset(theSequence, 0, sizeof(QTSeqSequenceRecord));
+
+	myName = QTSys_GetFileName(thePath);
+	myExtension = strrchr(myName, '.');
+
+	myEnd = (myExtension != NULL) ? (size_t)(myExtension - myName) : strlen(myName);
+	while ((myEnd > 0) && !QTSeq_IsDigit(myName[myEnd - 1]))
+		myEnd--;
+
+	myStart = myEnd;
+	while ((myStart > 0) && QTSeq_IsDigit(myName[myStart - 1]))
+		myStart--;
+
+	// a name without a number isn't part of a sequence
+	if ((myStart == myEnd) || (myEnd - myStart > kSeqMaxDigits))
+		return(paramErr);
+
+	myLength = (size_t)(myName - thePath);
+	if ((myLength >= sizeof(theSequence->fDirectory)) || (myStart >= sizeof(theSequence->fPrefix)) || (strlen(myName + myEnd) >= sizeof(theSequence->fSuffix)))
+		return(paramErr);
+
+	memcpy(theSequence->fDirectory, thePath, myLength);
+	theSequence->fDirectory[myLength] = '\0';
+	memcpy(theSequence->fPrefix, myName, myStart);
+	theSequence->fPrefix[myStart] = '\0';
+	strcpy(theSequence->fSuffix, myName + myEnd);
+
+	myPrefixLength = myStart;
+	mySuffixLength = strlen(theSequence->fSuffix);
+	myFirstNumber = atol(myName + myStart);
+
+	myErr = QTSys_OpenDirectory((myLength > 0) ? theSequence->fDirectory : ".", &myDirectory);
+	if (myErr != noErr)
+		return(myErr);
+
+	while (QTSys_ReadDirectory(myDirectory, &myDirEntry) == noErr) {
+		myLength = strlen(myDirEntry.fName);
+		if (myDirEntry.fIsDirectory || (myLength <= myPrefixLength + mySuffixLength) || (myLength - myPrefixLength - mySuffixLength > kSeqMaxDigits))
+			continue;
+
+		if ((strncmp(myDirEntry.fName, theSequence->fPrefix, myPrefixLength) != 0) || (strcmp(myDirEntry.fName + myLength - mySuffixLength, theSequence->fSuffix) != 0))
+			continue;
+
+		for (myStart = myPrefixLength; myStart < myLength - mySuffixLength; myStart++)
+			if (!QTSeq_IsDigit(myDirEntry.fName[myStart]))
+				break;
+
+		if (myStart < myLength - mySuffixLength)
+			continue;
+
+		myNumber = atol(myDirEntry.fName + myPrefixLength);
+		if (myNumber < myFirstNumber)
+			continue;
+
+		myErr = QTSys_MakePath(myPath, sizeof(myPath), theSequence->fDirectory, myDirEntry.fName);
+		if (myErr == noErr)
+			myErr = QTSeq_AddFrame(theSequence, myPath, myNumber);
+		if (myErr != noErr)
+			break;
+	}
+
+	QTSys_CloseDirectory(myDirectory);
+
+	if ((myErr == noErr) && (theSequence->fCount == 0))
+		myErr = fnfErr;
+
+	if (myErr != noErr) {
+		QTSeq_DisposeSequence(theSequence);
+		return(myErr);
+	}
+
+	qsort(theSequence->fFrames, (size_t)theSequence->fCount, sizeof(QTSeqFrameRecord), QTSeq_CompareFrames);
+
+	// "7" and "007" are the same frame; we keep the first by name, and count the numbers we don't have
+	myCount = 1;
+	for (myIndex = 1; myIndex < theSequence->fCount; myIndex++) {
+		QTSeqFramePtr		myFrame = &theSequence->fFrames[myIndex];
+		QTSeqFramePtr		myPrevFrame = &theSequence->fFrames[myCount - 1];
+
+		if (myFrame->fNumber == myPrevFrame->fNumber) {
+			free(myFrame->fPath);
+			continue;
+		}
+
+		theSequence->fMissingCount += myFrame->fNumber - myPrevFrame->fNumber - 1;
+		theSequence->fFrames[myCount++] = *myFrame;
+	}
+
+	theSequence->fCount = myCount;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSeq_DisposeSequence
+// Release the memory held by a sequence.
+//
+//////////
+
+void QTSeq_DisposeSequence (QTSeqSequencePtr theSequence)
+{
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < theSequence->fCount; myIndex++)
+		free(theSequence->fFrames[myIndex].fPath);
+
+	free(theSequence->fFrames);
+	theSequence->fFrames = NULL;
+	theSequence->fCount = 0;
+	theSequence->fCapacity = 0;
+	theSequence->fMissingCount = 0;
+}
+
+
+//////////
+//
+// QTSeq_GetDefaultMoviePath
+// Copy into theBuffer the path of the movie we make from a sequence unless told otherwise: the text
+// before the numbers, without any trailing separator, with a movie extension, in the stills' folder.
+//
+//////////
+
+OSErr QTSeq_GetDefaultMoviePath (QTSeqSequencePtr theSequence, char *theBuffer, size_t theBufferSize)
+{
+	char			myName[kQTSysMaxPath];
+	size_t			myLength;
+
+	strcpy(myName, theSequence->fPrefix);
+
+	myLength = strlen(myName);
+	while ((myLength > 0) && ((myName[myLength - 1] == '.') || (myName[myLength - 1] == '_') || (myName[myLength - 1] == '-') || (myName[myLength - 1] == ' ')))
+		myName[--myLength] = '\0';
+
+	if (QTSys_FormatString(myName + myLength, sizeof(myName) - myLength, "%s.%s", (myLength > 0) ? "" : kSeqDefaultMovieName, kSeqMovieExtension) < 0)
+		return(paramErr);
+
+	return(QTSys_MakePath(theBuffer, theBufferSize, theSequence->fDirectory, myName));
+}
+
+
+//////////
+//
+// QTSeq_GetRateSettings
+// Set the time scale and frame duration of theSettings for theRate frames a second.
+//
+// We keep the rate to a thousandth of a frame a second, so 29.97 becomes a duration of 100 in a time
+// scale of 2997, and 25 a duration of 1 in a time scale of 25.
+//
+//////////
+
+OSErr QTSeq_GetRateSettings (double theRate, QTSeqSettingsPtr theSettings)
+{
+	long			myTimeScale;
+	long			myDuration = 1000;
+	long			myDivisor;
+	long			myRemainder;
+	long			myValue;
+
+	if (!(theRate > 0.0) || (theRate > kSeqMaxRate))
+		return(paramErr);
+
+	myTimeScale = (long)((theRate * 1000.0) + 0.5);
+	if (myTimeScale == 0)
+		return(paramErr);
+
+	// divide both by their greatest common divisor
+	myDivisor = myTimeScale;
+	myValue = myDuration;
+	while (myValue != 0) {
+		myRemainder = myDivisor % myValue;
+		myDivisor = myValue;
+		myValue = myRemainder;
+	}
+
+	theSettings->fTimeScale = myTimeScale / myDivisor;
+	theSettings->fFrameDuration = myDuration / myDivisor;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSeq_IsDigit
+// Is theChar a decimal digit? (isdigit depends on the locale, and on the sign of char.)
+//
+//////////
+
+static Boolean QTSeq_IsDigit (char theChar)
+{
+	return((theChar >= '0') && (theChar <= '9'));
+}
+
+
+//////////
+//
+// QTSeq_CompareFrames
+// Order frames by number, and frames with the same number by path; for qsort.
+//
+//////////
+
+static int QTSeq_CompareFrames (const void *theFrame1, const void *theFrame2)
+{
+	const QTSeqFrameRecord		*myFrame1 = (const QTSeqFrameRecord *)theFrame1;
+	const QTSeqFrameRecord		*myFrame2 = (const QTSeqFrameRecord *)theFrame2;
+
+	if (myFrame1->fNumber != myFrame2->fNumber)
+		return((myFrame1->fNumber < myFrame2->fNumber) ? -1 : 1);
+
+	return(strcmp(myFrame1->fPath, myFrame2->fPath));
+}
+
+
+//////////
+//
+// QTSeq_AddFrame
+// Add a still to a sequence, growing it as needed.
+//
+//////////
+
+static OSErr QTSeq_AddFrame (QTSeqSequencePtr theSequence, const char *thePath, long theNumber)
+{
+	QTSeqFramePtr		myFrames;
+	long				myCapacity;
+
+	if (theSequence->fCount == theSequence->fCapacity) {
+		myCapacity = (theSequence->fCapacity == 0) ? kSeqInitialCapacity : (theSequence->fCapacity * 2);
+		myFrames = (QTSeqFramePtr)realloc(theSequence->fFrames, myCapacity * sizeof(QTSeqFrameRecord));
+		if (myFrames == NULL)
+			return(memFullErr);
+
+		theSequence->fFrames = myFrames;
+		theSequence->fCapacity = myCapacity;
+	}
+
+	theSequence->fFrames[theSequence->fCount].fPath = QTSys_CopyString(thePath);
+	if (theSequence->fFrames[theSequence->fCount].fPath == NULL)
+		return(memFullErr);
+
+	theSequence->fFrames[theSequence->fCount].fNumber = theNumber;
+	theSequence->fCount++;
+
+	return(noErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Import functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSeq_ImportSequence
+// Make a movie at theOutPath with one video track holding the stills of theSequence, in order.
+//
+// Each still lasts for the frame numbers up to the next one, so a gap in the numbers holds the still
+// before it. The movie is the size of the first still; later stills of other sizes are scaled to fit.
+//
+//////////
+
+OSErr QTSeq_ImportSequence (QTSeqSequencePtr theSequence, QTSeqImporterPtr theImporter, const char *theOutPath, QTSeqSettingsPtr theSettings, QTSeqStatsPtr theStats)
+{
+	QTSeqRunRecord			myRun;
+	QTSeqStatsRecord		myStats;
+	QTFanFormatRecord		myFormat;
+	QTSysThread				myThreads[kSeqMaxWorkers];
+	QTFanFramePtr			myFrame;
+	QTSeqFramePtr			myFrames;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	QTUInt64				myTime;
+	QTUInt64				myFrameBytes;
+	QTUInt64				myBufferCount;
+	void					*myMovie = NULL;
+	void					*myDecoder = NULL;
+	long					myThreadCount = 0;
+	long					myWorkerCount;
+	long					myIndex;
+	Boolean					myHasMutex = false;
+	Boolean					myHasFrameReady = false;
+	Boolean					myHasBufferFree = false;
+	OSErr					myErr = noErr;
+
+	if ((theSequence == NULL) || (theSequence->fCount == 0) || (theImporter == NULL) || (theOutPath == NULL) || (theSettings == NULL))
+		return(paramErr);
+
+	if ((theSettings->fTimeScale <= 0) || (theSettings->fFrameDuration <= 0))
+		return(paramErr);
+
+	memset(&myRun, 0, sizeof(myRun));
+	memset(&myStats, 0, sizeof(myStats));
+	myRun.fSequence = theSequence;
+	myRun.fImporter = theImporter;
+	myFrames = theSequence->fFrames;
+
+	myErr = theImporter->fGetFrameSize(theImporter->fRefCon, myFrames[0].fPath, &myRun.fWidth, &myRun.fHeight);
+	if (myErr != noErr)
+		goto bail;
+
+	if ((myRun.fWidth <= 0) || (myRun.fHeight <= 0)) {
+		myErr = paramErr;
+		goto bail;
+	}
+
+	// as many frame buffers as fit in the budget, but no more than there are stills
+	myFrameBytes = (QTUInt64)myRun.fWidth * myRun.fHeight * 4;
+	myBufferCount = theSettings->fBudgetBytes / myFrameBytes;
+	if ((myBufferCount == 0) || (myFrameBytes > 0x7FFFFFFFUL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	if (myBufferCount > (QTUInt64)theSequence->fCount)
+		myBufferCount = theSequence->fCount;
+
+	myRun.fBufferCount = (long)myBufferCount;
+	myRun.fBuffers = (QTFanFrameRecord *)calloc(myRun.fBufferCount, sizeof(QTFanFrameRecord));
+	myRun.fReadyFrames = (long *)malloc(myRun.fBufferCount * sizeof(long));
+	if ((myRun.fBuffers == NULL) || (myRun.fReadyFrames == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < myRun.fBufferCount; myIndex++)
+		myRun.fReadyFrames[myIndex] = -1;
+
+	myErr = QTSys_NewMutex(&myRun.fMutex);
+	if (myErr != noErr)
+		goto bail;
+	myHasMutex = true;
+
+	myErr = QTSys_NewCondition(&myRun.fFrameReady);
+	if (myErr != noErr)
+		goto bail;
+	myHasFrameReady = true;
+
+	myErr = QTSys_NewCondition(&myRun.fBufferFree);
+	if (myErr != noErr)
+		goto bail;
+	myHasBufferFree = true;
+
+	myFormat.fWidth = myRun.fWidth;
+	myFormat.fHeight = myRun.fHeight;
+	myFormat.fTimeScale = theSettings->fTimeScale;
+	myFormat.fFrameCount = theSequence->fCount;
+
+	myErr = theImporter->fBeginMovie(theImporter->fRefCon, theOutPath, &myFormat, &myMovie);
+	if (myErr != noErr) {
+		myMovie = NULL;
+		goto bail;
+	}
+
+	// more threads than buffers would only wait for them
+	myWorkerCount = theSettings->fWorkerCount;
+	if (myWorkerCount <= 0)
+		myWorkerCount = QTSys_GetProcessorCount();
+	if (myWorkerCount > kSeqMaxWorkers)
+		myWorkerCount = kSeqMaxWorkers;
+	if (myWorkerCount > myRun.fBufferCount)
+		myWorkerCount = myRun.fBufferCount;
+
+	for (myIndex = 0; myIndex < myWorkerCount; myIndex++) {
+		if (QTSys_NewThread(QTSeq_DecodeThread, &myRun, &myThreads[myThreadCount]) != noErr)
+			break;
+
+		myThreadCount++;
+	}
+
+	// if we couldn't start any threads, we decode each frame on this one just before we add it
+	if (myThreadCount == 0) {
+		myErr = theImporter->fNewDecoder(theImporter->fRefCon, &myDecoder);
+		if (myErr != noErr) {
+			myDecoder = NULL;
+			QTSeq_Stop(&myRun, myErr);
+		}
+	}
+
+	for (myIndex = 0; myIndex < theSequence->fCount; myIndex++) {
+		myFrame = &myRun.fBuffers[myIndex % myRun.fBufferCount];
+
+		if (myDecoder != NULL)
+			QTSeq_DecodeNextFrame(&myRun, myDecoder);
+
+		myTime = QTSys_GetMicroseconds();
+
+		QTSys_LockMutex(myRun.fMutex);
+		while ((myRun.fErr == noErr) && (myRun.fReadyFrames[myIndex % myRun.fBufferCount] != myIndex))
+			QTSys_WaitCondition(myRun.fFrameReady, myRun.fMutex);
+		myErr = myRun.fErr;
+		QTSys_UnlockMutex(myRun.fMutex);
+
+		myStats.fWaitMicroseconds += QTSys_GetMicroseconds() - myTime;
+
+		if (myErr != noErr)
+			break;
+
+		myFrame->fTime = (myFrames[myIndex].fNumber - myFrames[0].fNumber) * theSettings->fFrameDuration;
+		if (myIndex + 1 < theSequence->fCount)
+			myFrame->fDuration = (myFrames[myIndex + 1].fNumber - myFrames[myIndex].fNumber) * theSettings->fFrameDuration;
+		else
+			myFrame->fDuration = theSettings->fFrameDuration;
+
+		myErr = theImporter->fAddFrame(myMovie, myFrame);
+
+		QTSys_LockMutex(myRun.fMutex);
+		myRun.fReadyFrames[myIndex % myRun.fBufferCount] = -1;
+		myRun.fAddedCount++;
+		if ((myErr != noErr) && (myRun.fErr == noErr))
+			myRun.fErr = myErr;
+		QTSys_BroadcastCondition(myRun.fBufferFree);
+		QTSys_UnlockMutex(myRun.fMutex);
+
+		if (myErr != noErr)
+			break;
+	}
+
+	// an error on any thread stops the others; wait for them before we report it
+	for (myIndex = 0; myIndex < myThreadCount; myIndex++)
+		QTSys_JoinThread(myThreads[myIndex]);
+
+	if (myDecoder != NULL)
+		theImporter->fDisposeDecoder(myDecoder);
+
+	myErr = myRun.fErr;
+	myStats.fWorkerCount = (myThreadCount == 0) ? 1 : myThreadCount;
+
+bail:
+	if (myMovie != NULL)
+		myErr = theImporter->fEndMovie(myMovie, myErr);
+
+	myStats.fFrameCount = myRun.fAddedCount;
+	myStats.fBufferCount = myRun.fBufferCount;
+	myStats.fPeakBuffers = myRun.fPeakBuffers;
+	myStats.fDecodeMicroseconds = myRun.fDecodeMicroseconds;
+
+	if (myRun.fBuffers != NULL) {
+		for (myIndex = 0; myIndex < myRun.fBufferCount; myIndex++) {
+			myStats.fBufferBytes += myRun.fBuffers[myIndex].fCapacity;
+			free(myRun.fBuffers[myIndex].fData);
+		}
+	}
+
+	free(myRun.fBuffers);
+	free(myRun.fReadyFrames);
+
+	if (myHasBufferFree)
+		QTSys_DisposeCondition(myRun.fBufferFree);
+	if (myHasFrameReady)
+		QTSys_DisposeCondition(myRun.fFrameReady);
+	if (myHasMutex)
+		QTSys_DisposeMutex(myRun.fMutex);
+
+	myStats.fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+
+	if (theStats != NULL)
+		*theStats = myStats;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSeq_Stop
+// Record the first error of a run, and wake everyone so they can stop.
+//
+//////////
+
+static void QTSeq_Stop (QTSeqRunPtr theRun, OSErr theErr)
+{
+	QTSys_LockMutex(theRun->fMutex);
+	if (theRun->fErr == noErr)
+		theRun->fErr = theErr;
+	QTSys_BroadcastCondition(theRun->fFrameReady);
+	QTSys_BroadcastCondition(theRun->fBufferFree);
+	QTSys_UnlockMutex(theRun->fMutex);
+}
+
+
+//////////
+//
+// QTSeq_DecodeNextFrame
+// Take the next frame of a run, waiting for its buffer to be free, and decode it. Returns false once there
+// are no frames left, or the run has stopped.
+//
+//////////
+
+static Boolean QTSeq_DecodeNextFrame (QTSeqRunPtr theRun, void *theDecoder)
+{
+	QTFanFramePtr		myFrame;
+	QTUInt64			myTime;
+	long				myIndex;
+	OSErr				myErr;
+
+	QTSys_LockMutex(theRun->fMutex);
+
+	// frame n goes into the buffer that frame n minus the buffer count used, once the movie has it
+	while ((theRun->fErr == noErr) && (theRun->fNextFrame < theRun->fSequence->fCount) && (theRun->fNextFrame >= theRun->fAddedCount + theRun->fBufferCount))
+		QTSys_WaitCondition(theRun->fBufferFree, theRun->fMutex);
+
+	if ((theRun->fErr != noErr) || (theRun->fNextFrame >= theRun->fSequence->fCount)) {
+		QTSys_UnlockMutex(theRun->fMutex);
+		return(false);
+	}
+
+	myIndex = theRun->fNextFrame++;
+	if (theRun->fNextFrame - theRun->fAddedCount > theRun->fPeakBuffers)
+		theRun->fPeakBuffers = theRun->fNextFrame - theRun->fAddedCount;
+
+	QTSys_UnlockMutex(theRun->fMutex);
+
+	// no one else touches this buffer until we mark it ready
+	myFrame = &theRun->fBuffers[myIndex % theRun->fBufferCount];
+	myFrame->fKind = kFanFrameVideo;
+	myFrame->fIndex = myIndex;
+	myFrame->fWidth = theRun->fWidth;
+	myFrame->fHeight = theRun->fHeight;
+	myFrame->fRowBytes = theRun->fWidth * 4;
+
+	myTime = QTSys_GetMicroseconds();
+
+	myErr = QTFan_ReserveFrame(myFrame, (UInt32)(myFrame->fRowBytes * myFrame->fHeight));
+	if (myErr == noErr)
+		myErr = theRun->fImporter->fDecodeFrame(theDecoder, theRun->fSequence->fFrames[myIndex].fPath, myFrame);
+
+	myTime = QTSys_GetMicroseconds() - myTime;
+
+	QTSys_LockMutex(theRun->fMutex);
+	theRun->fDecodeMicroseconds += myTime;
+	if (myErr == noErr) {
+		theRun->fReadyFrames[myIndex % theRun->fBufferCount] = myIndex;
+		QTSys_BroadcastCondition(theRun->fFrameReady);
+	}
+	QTSys_UnlockMutex(theRun->fMutex);
+
+	if (myErr != noErr) {
+		QTSys_Trace("QTSeq: cannot decode %s (error %d)\n", theRun->fSequence->fFrames[myIndex].fPath, (int)myErr);
+		QTSeq_Stop(theRun, myErr);
+		return(false);
+	}
+
+	return(true);
+}
+
+
+//////////
+//
+// QTSeq_DecodeThread
+// Decode frames until there are none left.
+//
+//////////
+
+static void QTSeq_DecodeThread (void *theRefCon)
+{
+	QTSeqRunPtr			myRun = (QTSeqRunPtr)theRefCon;
+	void				*myDecoder = NULL;
+	OSErr				myErr;
+
+	myErr = myRun->fImporter->fNewDecoder(myRun->fImporter->fRefCon, &myDecoder);
+	if (myErr != noErr) {
+		QTSeq_Stop(myRun, myErr);
+		return;
+	}
+
+	while (QTSeq_DecodeNextFrame(myRun, myDecoder))
+		;
+
+	myRun->fImporter->fDisposeDecoder(myDecoder);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Stub importer.
+//
+// The stub importer reads binary PPM (P6) stills with 8-bit samples, and writes a "movie" that is a
+// 16-byte header (kSeqStubMovieType, width, height, time scale) followed by each frame's time and
+// duration and its 32-bit ARGB pixels, all big-endian; this gives the engine real work to do when
+// QuickTime is not available.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static QTSeqImporterRecord		gStubImporter = {
+	NULL,
+	QTSeq_StubGetFrameSize,
+	QTSeq_StubNewDecoder,
+	QTSeq_StubDecodeFrame,
+	QTSeq_StubDisposeDecoder,
+	QTSeq_StubBeginMovie,
+	QTSeq_StubAddFrame,
+	QTSeq_StubEndMovie
+};
+
+
+//////////
+//
+// QTSeq_GetStubImporter
+// Return an importer that does not need QuickTime.
+//
+//////////
+
+QTSeqImporterPtr QTSeq_GetStubImporter (void)
+{
+	return(&gStubImporter);
+}
+
+
+//////////
+//
+// QTSeq_StubReadHeader
+// Find the size of a PPM still, and where its pixels start.
+//
+//////////
+
+static OSErr QTSeq_StubReadHeader (const UInt8 *theData, UInt32 theSize, long *theWidth, long *theHeight, UInt32 *theDataOffset)
+{
+	long			myValues[3];
+	long			myIndex;
+	UInt32			myOffset = 2;
+
+	if ((theSize < 2) || (theData[0] != 'P') || (theData[1] != '6'))
+		return(badFormat);
+
+	// width, height and maximum sample value, separated by white space and comments
+	for (myIndex = 0; myIndex < 3; myIndex++) {
+		for (;;) {
+			if (myOffset >= theSize)
+				return(badFormat);
+
+			if (theData[myOffset] == '#') {
+				while ((myOffset < theSize) && (theData[myOffset] != '\n'))
+					myOffset++;
+			} else if ((theData[myOffset] == ' ') || (theData[myOffset] == '\t') || (theData[myOffset] == '\r') || (theData[myOffset] == '\n')) {
+				myOffset++;
+			} else {
+				break;
+			}
+		}
+
+		myValues[myIndex] = 0;
+		while ((myOffset < theSize) && QTSeq_IsDigit((char)theData[myOffset]) && (myValues[myIndex] < 0x10000L))
+			myValues[myIndex] = (myValues[myIndex] * 10) + (theData[myOffset++] - '0');
+	}
+
+	// one white space character comes before the pixels
+	if ((myOffset >= theSize) || (myValues[0] <= 0) || (myValues[1] <= 0) || (myValues[0] >= 0x10000L) || (myValues[1] >= 0x10000L) || (myValues[2] != 255))
+		return(badFormat);
+
+	*theWidth = myValues[0];
+	*theHeight = myValues[1];
+	*theDataOffset = myOffset + 1;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSeq_StubGetFrameSize
+// Read the size of a PPM still from its header.
+//
+//////////
+
+static OSErr QTSeq_StubGetFrameSize (void *theRefCon, const char *thePath, long *theWidth, long *theHeight)
+{
+#pragma unused(theRefCon)
+	QTSysFile			myFile = kQTSysInvalidFile;
+	UInt8				myHeader[kSeqStubHeaderSize];
+	UInt32				myDataOffset;
+	UInt32				myRead = 0;
+	OSErr				myErr = noErr;
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenRead, &myFile);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTSys_ReadFile(myFile, 0, myHeader, sizeof(myHeader), &myRead);
+	if (myErr == eofErr)
+		myErr = noErr;
+
+	QTSys_CloseFile(myFile);
+
+	if (myErr == noErr)
+		myErr = QTSeq_StubReadHeader(myHeader, myRead, theWidth, theHeight, &myDataOffset);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSeq_StubNewDecoder
+// Make a decoder for one thread.
+//
+//////////
+
+static OSErr QTSeq_StubNewDecoder (void *theRefCon, void **theDecoder)
+{
+#pragma unused(theRefCon)
+
+	*theDecoder = calloc(1, sizeof(QTSeqStubDecoderRecord));
+
+	return((*theDecoder == NULL) ? memFullErr : noErr);
+}
+
+
+//////////
+//
+// QTSeq_StubDecodeFrame
+// Read a PPM still and draw it into theFrame, scaling it to the nearest pixel if it is another size.
+//
+//////////
+
+static OSErr QTSeq_StubDecodeFrame (void *theDecoder, const char *thePath, QTFanFramePtr theFrame)
+{
+	QTSeqStubDecoderPtr		myDecoder = (QTSeqStubDecoderPtr)theDecoder;
+	QTSysFile				myFile = kQTSysInvalidFile;
+	QTUInt64				myFileSize = 0;
+	const UInt8				*mySource;
+	UInt8					*myDest;
+	UInt8					*myData;
+	UInt32					myDataOffset;
+	UInt32					myRead = 0;
+	long					myWidth;
+	long					myHeight;
+	long					myX;
+	long					myY;
+	OSErr					myErr = noErr;
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenRead, &myFile);
+	if (myErr != noErr)
+		return(myErr);
+
+	myErr = QTSys_GetFileSize(myFile, &myFileSize);
+	if ((myErr == noErr) && (myFileSize > 0x7FFFFFFFUL))
+		myErr = badFormat;
+
+	if ((myErr == noErr) && (myFileSize > myDecoder->fCapacity)) {
+		myData = (UInt8 *)realloc(myDecoder->fData, (size_t)myFileSize);
+		if (myData != NULL) {
+			myDecoder->fData = myData;
+			myDecoder->fCapacity = (UInt32)myFileSize;
+		} else {
+			myErr = memFullErr;
+		}
+	}
+
+	if (myErr == noErr)
+		myErr = QTSys_ReadFile(myFile, 0, myDecoder->fData, (UInt32)myFileSize, &myRead);
+
+	QTSys_CloseFile(myFile);
+
+	if ((myErr == noErr) && (myRead != myFileSize))
+		myErr = eofErr;
+	if (myErr == noErr)
+		myErr = QTSeq_StubReadHeader(myDecoder->fData, myRead, &myWidth, &myHeight, &myDataOffset);
+	if ((myErr == noErr) && ((QTUInt64)myWidth * myHeight * 3 > myRead - myDataOffset))
+		myErr = badFormat;
+	if (myErr != noErr)
+		return(myErr);
+
+	for (myY = 0; myY < theFrame->fHeight; myY++) {
+		myDest = theFrame->fData + (myY * theFrame->fRowBytes);
+		mySource = myDecoder->fData + myDataOffset + ((((QTUInt64)myY * myHeight) / theFrame->fHeight) * myWidth * 3);
+
+		for (myX = 0; myX < theFrame->fWidth; myX++) {
+			const UInt8		*myPixel = mySource + ((((QTUInt64)myX * myWidth) / theFrame->fWidth) * 3);
+
+			*myDest++ = 0xFF;
+			*myDest++ = myPixel[0];
+			*myDest++ = myPixel[1];
+			*myDest++ = myPixel[2];
+		}
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSeq_StubDisposeDecoder
+// Release a decoder made by QTSeq_StubNewDecoder.
+//
+//////////
+
+static void QTSeq_StubDisposeDecoder (void *theDecoder)
+{
+	QTSeqStubDecoderPtr		myDecoder = (QTSeqStubDecoderPtr)theDecoder;
+
+	if (myDecoder != NULL)
+		free(myDecoder->fData);
+
+	free(myDecoder);
+}
+
+
+//////////
+//
+// QTSeq_StubBeginMovie
+// Create a stub movie and write its header.
+//
+//////////
+
+static OSErr QTSeq_StubBeginMovie (void *theRefCon, const char *theOutPath, const QTFanFormatRecord *theFormat, void **theMovie)
+{
+#pragma unused(theRefCon)
+	QTSeqStubMoviePtr		myMovie;
+	UInt8					myHeader[kSeqStubMovieHeaderSize];
+	OSErr					myErr = noErr;
+
+	myMovie = (QTSeqStubMoviePtr)calloc(1, sizeof(QTSeqStubMovieRecord));
+	if (myMovie == NULL)
+		return(memFullErr);
+
+	myErr = (QTSys_FormatString(myMovie->fPath, sizeof(myMovie->fPath), "%s", theOutPath) < 0) ? paramErr : noErr;
+	if (myErr == noErr)
+		myErr = QTSys_OpenFile(theOutPath, kQTSysOpenWrite, &myMovie->fFile);
+
+	if (myErr == noErr) {
+		QTAtom_PutBE32(myHeader, kSeqStubMovieType);
+		QTAtom_PutBE32(myHeader + 4, (UInt32)theFormat->fWidth);
+		QTAtom_PutBE32(myHeader + 8, (UInt32)theFormat->fHeight);
+		QTAtom_PutBE32(myHeader + 12, (UInt32)theFormat->fTimeScale);
+
+		myErr = QTSys_WriteFile(myMovie->fFile, myHeader, sizeof(myHeader));
+		if (myErr != noErr) {
+			QTSys_CloseFile(myMovie->fFile);
+			QTSys_DeletePath(theOutPath);
+		}
+	}
+
+	if (myErr != noErr) {
+		free(myMovie);
+		return(myErr);
+	}
+
+	*theMovie = myMovie;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSeq_StubAddFrame
+// Append a frame to a stub movie.
+//
+//////////
+
+static OSErr QTSeq_StubAddFrame (void *theMovie, const QTFanFrameRecord *theFrame)
+{
+	QTSeqStubMoviePtr		myMovie = (QTSeqStubMoviePtr)theMovie;
+	UInt8					myHeader[kSeqStubFrameHeaderSize];
+	OSErr					myErr = noErr;
+
+	QTAtom_PutBE32(myHeader, (UInt32)theFrame->fTime);
+	QTAtom_PutBE32(myHeader + 4, (UInt32)theFrame->fDuration);
+
+	myErr = QTSys_WriteFile(myMovie->fFile, myHeader, sizeof(myHeader));
+	if (myErr == noErr)
+		myErr = QTSys_WriteFile(myMovie->fFile, theFrame->fData, theFrame->fSize);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSeq_StubEndMovie
+// Close a stub movie, deleting it if we didn't finish it.
+//
+//////////
+
+static OSErr QTSeq_StubEndMovie (void *theMovie, OSErr theErr)
+{
+	QTSeqStubMoviePtr		myMovie = (QTSeqStubMoviePtr)theMovie;
+
+	QTSys_CloseFile(myMovie->fFile);
+	if (theErr != noErr)
+		QTSys_DeletePath(myMovie->fPath);
+
+	free(myMovie);
+	return(theErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSeq_IsSequenceCommandLine
+// Does the specified command line ask for sequence mode?
+//
+//////////
+
+Boolean QTSeq_IsSequenceCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kSeqSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTSeq_Main
+// Run sequence mode. Returns one of the kSeqExit constants.
+//
+// Usage: -sequence <still> [-out <movie>] [-rate <frames a second>] [-workers <count>] [-budget <megabytes>] [-report <file>]
+//
+// The sequence starts at the named still. The movie defaults to the name the stills share, in their
+// folder (QTSeq_GetDefaultMoviePath), at 30 frames a second, decoding with a thread for each processor
+// into at most kSeqDefaultBudgetMegabytes of frames.
+//
+//////////
+
+int QTSeq_Main (int theArgc, char *theArgv[], QTSeqImporterPtr theImporter)
+{
+	QTSeqSequenceRecord		mySequence;
+	QTSeqSettingsRecord		mySettings;
+	QTSeqStatsRecord		myStats;
+	const char				*myInPath = NULL;
+	const char				*myOutPath = NULL;
+	const char				*myReportPath = NULL;
+	FILE					*myReport = stdout;
+	char					myPath[kQTSysMaxPath];
+	double					myRate = 0.0;
+	long					myBudget = kSeqDefaultBudgetMegabytes;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	memset(&mySettings, 0, sizeof(mySettings));
+	memset(&myStats, 0, sizeof(myStats));
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kSeqSwitch) == 0) && (myIndex + 1 < theArgc))
+			myInPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kSeqOutSwitch) == 0) && (myIndex + 1 < theArgc))
+			myOutPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kSeqRateSwitch) == 0) && (myIndex + 1 < theArgc))
+			myRate = atof(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSeqWorkersSwitch) == 0) && (myIndex + 1 < theArgc))
+			mySettings.fWorkerCount = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSeqBudgetSwitch) == 0) && (myIndex + 1 < theArgc))
+			myBudget = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSeqReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if (myRate != 0.0)
+		myErr = QTSeq_GetRateSettings(myRate, &mySettings);
+	else {
+		mySettings.fTimeScale = kSeqDefaultTimeScale;
+		mySettings.fFrameDuration = kSeqDefaultFrameDuration;
+	}
+
+	if ((myInPath == NULL) || (myErr != noErr) || (myBudget <= 0)) {
+		fprintf(stderr, "usage: %s %s <still> [%s <movie>] [%s <frames a second>] [%s <count>] [%s <megabytes>] [%s <file>]\n",
+					theArgv[0], kSeqSwitch, kSeqOutSwitch, kSeqRateSwitch, kSeqWorkersSwitch, kSeqBudgetSwitch, kSeqReportSwitch);
+		return(kSeqExitUsage);
+	}
+
+	mySettings.fBudgetBytes = (QTUInt64)myBudget * 1024 * 1024;
+
+	myErr = QTSeq_FindSequence(myInPath, &mySequence);
+	if (myErr != noErr) {
+		fprintf(stderr, "cannot find a numbered sequence at %s (error %d)\n", myInPath, (int)myErr);
+		return(kSeqExitUsage);
+	}
+
+	if (myOutPath == NULL) {
+		myErr = QTSeq_GetDefaultMoviePath(&mySequence, myPath, sizeof(myPath));
+		if (myErr != noErr) {
+			fprintf(stderr, "cannot name a movie for %s; use %s\n", myInPath, kSeqOutSwitch);
+			QTSeq_DisposeSequence(&mySequence);
+			return(kSeqExitUsage);
+		}
+
+		myOutPath = myPath;
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			QTSeq_DisposeSequence(&mySequence);
+			return(kSeqExitUsage);
+		}
+	}
+
+	myErr = QTSeq_ImportSequence(&mySequence, theImporter, myOutPath, &mySettings, &myStats);
+	if (myErr == memFullErr)
+		fprintf(stderr, "cannot import %s within %ld megabytes\n", myInPath, myBudget);
+	else if (myErr != noErr)
+		fprintf(stderr, "cannot import %s (error %d)\n", myInPath, (int)myErr);
+
+	fputs("{\"sequence\":", myReport);
+	QTSys_WriteJSONString(myReport, mySequence.fFrames[0].fPath);
+	fputs(",\"out\":", myReport);
+	QTSys_WriteJSONString(myReport, myOutPath);
+	fprintf(myReport, ",\"err\":%d,\"stills\":%ld,\"first\":%ld,\"last\":%ld,\"missing\":%ld,\"frames\":%ld,\"timeScale\":%ld,\"frameDuration\":%ld",
+				(int)myErr,
+				mySequence.fCount,
+				mySequence.fFrames[0].fNumber,
+				mySequence.fFrames[mySequence.fCount - 1].fNumber,
+				mySequence.fMissingCount,
+				myStats.fFrameCount,
+				mySettings.fTimeScale,
+				mySettings.fFrameDuration);
+	fprintf(myReport, ",\"workers\":%ld,\"buffers\":%ld,\"peakBuffers\":%ld,\"bufferBytes\":%llu,\"budgetBytes\":%llu,\"decodeMicroseconds\":%llu,\"waitMicroseconds\":%llu,\"wallMicroseconds\":%llu}\n",
+				myStats.fWorkerCount,
+				myStats.fBufferCount,
+				myStats.fPeakBuffers,
+				(unsigned long long)myStats.fBufferBytes,
+				(unsigned long long)mySettings.fBudgetBytes,
+				(unsigned long long)myStats.fDecodeMicroseconds,
+				(unsigned long long)myStats.fWaitMicroseconds,
+				(unsigned long long)myStats.fMicroseconds);
+	fflush(myReport);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	QTSeq_DisposeSequence(&mySequence);
+
+	return((myErr == noErr) ? kSeqExitSuccess : kSeqExitFailed);
+}
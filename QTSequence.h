@@ -0,0 +1,133 @@
+//////////
+//
+//	File:		QTSequence.h
+//
+//	Contains:	A portable engine that turns a numbered sequence of still images into one movie, decoding
+//				the stills on several threads within a fixed memory budget.
+//				All utilities start with the prefix "QTSeq_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTSequence__
+#define __QTSequence__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTFanout.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kSeqSwitch							"-sequence"				// command-line switch that selects sequence mode
+#define kSeqOutSwitch						"-out"					// the movie to write
+#define kSeqRateSwitch						"-rate"					// frames per second; may be fractional, as in 29.97
+#define kSeqWorkersSwitch					"-workers"				// number of threads decoding stills
+#define kSeqBudgetSwitch					"-budget"				// megabytes of decoded frames we may hold at once
+#define kSeqReportSwitch					"-report"				// write the report to a file instead of stdout
+#define kSeqMovieExtension					"mov"
+#define kSeqDefaultMovieName				"sequence"				// for sequences whose names are only numbers
+
+#define kSeqDefaultTimeScale				600
+#define kSeqDefaultFrameDuration			20						// 30 frames a second
+#define kSeqDefaultBudgetMegabytes			256
+#define kSeqMaxRate							1000.0
+#define kSeqMaxDigits						9						// longest frame number we recognize
+#define kSeqMaxWorkers						64
+#define kSeqInitialCapacity					256
+
+// exit codes returned by QTSeq_Main
+enum {
+	kSeqExitSuccess							= 0,
+	kSeqExitFailed							= 1,
+	kSeqExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// one still of a sequence
+typedef struct QTSeqFrameRecord {
+	char					*fPath;
+	long					fNumber;				// the number in its file name
+} QTSeqFrameRecord, *QTSeqFramePtr;
+
+// the stills that make up a sequence, in order of their numbers
+typedef struct QTSeqSequenceRecord {
+	QTSeqFramePtr			fFrames;
+	long					fCount;
+	long					fCapacity;
+	long					fMissingCount;			// numbers between the first and last that have no still
+	char					fDirectory[kQTSysMaxPath];// where the stills are, with its trailing separator, or ""
+	char					fPrefix[kQTSysMaxPath];	// what comes before the number in each file name
+	char					fSuffix[kQTSysMaxPath];	// and what comes after it
+} QTSeqSequenceRecord, *QTSeqSequencePtr;
+
+// the importer interface; QTDataEx.c supplies one that calls QuickTime, and QTSeq_GetStubImporter
+// supplies one that runs anywhere. fGetFrameSize and the movie functions run on the thread that called
+// QTSeq_ImportSequence; each decoding thread calls fNewDecoder, then fDecodeFrame for each of its stills,
+// then fDisposeDecoder. fDecodeFrame draws a still into the frame it is given, scaling it to the frame's
+// size if the still is a different size from the first
+typedef struct QTSeqImporterRecord {
+	void					*fRefCon;
+	OSErr					(*fGetFrameSize) (void *theRefCon, const char *thePath, long *theWidth, long *theHeight);
+	OSErr					(*fNewDecoder) (void *theRefCon, void **theDecoder);
+	OSErr					(*fDecodeFrame) (void *theDecoder, const char *thePath, QTFanFramePtr theFrame);
+	void					(*fDisposeDecoder) (void *theDecoder);
+	OSErr					(*fBeginMovie) (void *theRefCon, const char *theOutPath, const QTFanFormatRecord *theFormat, void **theMovie);
+	OSErr					(*fAddFrame) (void *theMovie, const QTFanFrameRecord *theFrame);
+	OSErr					(*fEndMovie) (void *theMovie, OSErr theErr);
+} QTSeqImporterRecord, *QTSeqImporterPtr;
+
+typedef struct QTSeqSettingsRecord {
+	long					fWorkerCount;			// 0 for one per processor
+	QTUInt64				fBudgetBytes;			// most memory the decoded frames may take at once
+	long					fTimeScale;
+	long					fFrameDuration;			// of one frame number, in fTimeScale units
+} QTSeqSettingsRecord, *QTSeqSettingsPtr;
+
+// what QTSeq_ImportSequence did
+typedef struct QTSeqStatsRecord {
+	long					fFrameCount;			// stills added to the movie
+	long					fWorkerCount;
+	long					fBufferCount;			// frames we could hold at once
+	long					fPeakBuffers;			// most we did hold at once
+	QTUInt64				fBufferBytes;			// memory the frames took at the end
+	QTUInt64				fDecodeMicroseconds;	// of all the decoding threads together
+	QTUInt64				fWaitMicroseconds;		// time the movie waited for the next still
+	QTUInt64				fMicroseconds;
+} QTSeqStatsRecord, *QTSeqStatsPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTSeq_FindSequence (const char *thePath, QTSeqSequencePtr theSequence);
+void						QTSeq_DisposeSequence (QTSeqSequencePtr theSequence);
+OSErr						QTSeq_GetDefaultMoviePath (QTSeqSequencePtr theSequence, char *theBuffer, size_t theBufferSize);
+OSErr						QTSeq_GetRateSettings (double theRate, QTSeqSettingsPtr theSettings);
+OSErr						QTSeq_ImportSequence (QTSeqSequencePtr theSequence, QTSeqImporterPtr theImporter, const char *theOutPath, QTSeqSettingsPtr theSettings, QTSeqStatsPtr theStats);
+
+QTSeqImporterPtr			QTSeq_GetStubImporter (void);
+
+Boolean						QTSeq_IsSequenceCommandLine (int theArgc, char *theArgv[]);
+int							QTSeq_Main (int theArgc, char *theArgv[], QTSeqImporterPtr theImporter);
+
+#endif	// __QTSequence__
@@ -0,0 +1,1159 @@
+//////////
+//
+//	File:		QTSettings.c
+//
+//	Contains:	Portable functions for reading and writing the exporter settings files that QTDataEx saves.
+//				All utilities start with the prefix "QTSet_".
+//
+//	QTDataEx saves movie exporter settings as a flattened QT atom container (see
+//	QTDX_SaveExporterSettingsInFile). The original reader opened the file for writing, allocated
+//	a zero-filled handle as big as the file and copied the whole file into it before anybody looked
+//	at the data. The functions here map the file read-only instead and walk the atom container in
+//	place, so that a corrupt or truncated settings file is rejected without allocating anything,
+//	and a caller that needs only a few atoms never copies the rest. If the file can't be mapped
+//	(some network file systems don't support it), QTSet_OpenView quietly reads it into memory.
+//
+//	The original writer deleted the settings file and then wrote a new one in its place, so a crash
+//	in between lost the settings, and it rewrote the file even when nothing had changed. QTSet_WriteFile
+//	writes a temporary file next to the settings file, flushes it and renames it over the old file, so
+//	the settings file always holds either the old settings or the new ones; and it doesn't write at all
+//	if the file already holds exactly the new bytes, which is the common case when every job of a long
+//	batch saves the same settings.
+//
+//	When QTDataEx hints thousands of movies into one folder, it reads the same settings file for every
+//	one of them. The cache functions keep the parsed settings (for QTDataEx, a QTAtomContainer) in
+//	memory, keyed by the exporter's subtype and manufacturer and the settings file's path. Each lookup
+//	checks the file's size and modification time, so editing or replacing the file is noticed at once.
+//	Entries are reference counted: a thread that gets an entry can use its value while other threads
+//	replace or evict it, and the value is disposed of when the last user releases it.
+//
+//	A QT atom container starts with a 12-byte header (10 reserved bytes and a lock count), followed
+//	by the root atom, of type 'sean'. Each atom has a 20-byte header: size, type, atom ID, 2 reserved
+//	bytes, child count and 4 more reserved bytes. An atom with children holds nothing but its children;
+//	a leaf atom's data follows its header. All the numbers are big-endian.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSettings.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kSetBenchmarkLeafSize		(64L * 1024L)			// data size of each leaf atom in the synthetic settings file
+#define kSetBenchmarkLeafType		FOUR_CHAR_CODE('blob')
+#define kSetMaxSize					0x7FFFFFFFUL			// settings end up in a handle, whose size is a long
+
+
+//////////
+//
+// data types
+//
+//////////
+
+struct QTSetCacheEntryRecord {
+	OSType					fSubType;
+	OSType					fManufacturer;
+	char					*fPath;
+	QTSetFileStampRecord	fStamp;
+	void					*fValue;
+	long					fRefCount;				// one for the cache, while the entry is in it, plus one per user
+	QTUInt64				fLastUse;				// the cache's clock when the entry was last used
+};
+
+struct QTSetCacheRecord {
+	QTSysMutex				fMutex;
+	QTSetCacheDisposeProcPtr	fDisposeProc;
+	QTSetCacheEntryPtr		*fEntries;
+	long					fCount;
+	long					fCapacity;
+	QTUInt64				fClock;
+	QTSetCacheStatsRecord	fStats;
+};
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static volatile long		gSetTempSequence = 0;			// makes temporary file names unique within this process
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// View functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSet_OpenView
+// Make the contents of the specified settings file available in memory, mapping the file if we can.
+//
+// If the file can't be mapped (or theFlags includes kSetViewDontMap), we read it into a buffer instead;
+// either way, the caller reads theView->fData and calls QTSet_CloseView when done.
+//
+//////////
+
+OSErr QTSet_OpenView (const char *thePath, long theFlags, QTSetViewPtr theView)
+{
+	QTSysFile		myFile = kQTSysInvalidFile;
+	QTUInt64		mySize = 0;
+	UInt32			myCount = 0;
+	OSErr			myErr = noErr;
+
+	if ((thePath == NULL) || (theView == NULL))
+		return(paramErr);
+
+	memset(theView, 0, sizeof(QTSetViewRecord));
+
+	if ((theFlags & kSetViewDontMap) == 0) {
+		myErr = QTSys_MapFile(thePath, &theView->fMapping);
+		if (myErr == noErr) {
+			if (theView->fMapping.fSize > kSetMaxSize) {
+				QTSys_UnmapFile(&theView->fMapping);
+				return(memFullErr);
+			}
+
+			theView->fData = (const UInt8 *)theView->fMapping.fData;
+			theView->fSize = (UInt32)theView->fMapping.fSize;
+			theView->fMapped = true;
+			return(noErr);
+		}
+
+		// there's no point in trying to read a file that isn't there
+		if ((myErr == fnfErr) || (myErr == dirNFErr))
+			return(myErr);
+	}
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenRead, &myFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTSys_GetFileSize(myFile, &mySize);
+	if (myErr != noErr)
+		goto bail;
+
+	if (mySize > kSetMaxSize) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	// allocate at least one byte, so that an empty file still gets a buffer
+	theView->fBuffer = (UInt8 *)malloc((size_t)mySize + 1);
+	if (theView->fBuffer == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = QTSys_ReadFile(myFile, 0, theView->fBuffer, (UInt32)mySize, &myCount);
+	if ((myErr == noErr) && (myCount != (UInt32)mySize))
+		myErr = eofErr;
+	if (myErr != noErr)
+		goto bail;
+
+	theView->fData = theView->fBuffer;
+	theView->fSize = myCount;
+
+bail:
+	QTSys_CloseFile(myFile);
+
+	if (myErr != noErr)
+		QTSet_CloseView(theView);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSet_CloseView
+// Release the memory or mapping behind a view opened by QTSet_OpenView.
+//
+//////////
+
+void QTSet_CloseView (QTSetViewPtr theView)
+{
+	if (theView == NULL)
+		return;
+
+	if (theView->fMapped)
+		QTSys_UnmapFile(&theView->fMapping);
+
+	free(theView->fBuffer);
+	memset(theView, 0, sizeof(QTSetViewRecord));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Writing functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSet_FileMatches
+// Does the file at thePath hold exactly the bytes of theParts, one after the other?
+//
+//////////
+
+Boolean QTSet_FileMatches (const char *thePath, const QTSysIOVecRecord *theParts, long theCount)
+{
+	QTSetViewRecord		myView;
+	QTUInt64			myFileSize = 0;
+	QTUInt64			myTotal = 0;
+	UInt32				myOffset = 0;
+	Boolean				myMatches = true;
+	long				myIndex;
+
+	for (myIndex = 0; myIndex < theCount; myIndex++)
+		myTotal += theParts[myIndex].fLength;
+
+	// compare the sizes before looking at any data
+	if ((QTSys_GetPathSize(thePath, &myFileSize) != noErr) || (myFileSize != myTotal) || (myTotal == 0))
+		return(false);
+
+	if (QTSet_OpenView(thePath, 0, &myView) != noErr)
+		return(false);
+
+	for (myIndex = 0; (myIndex < theCount) && myMatches; myIndex++) {
+		if ((myView.fSize - myOffset < theParts[myIndex].fLength) || (memcmp(myView.fData + myOffset, theParts[myIndex].fData, theParts[myIndex].fLength) != 0))
+			myMatches = false;
+
+		myOffset += theParts[myIndex].fLength;
+	}
+
+	if (myOffset != myView.fSize)
+		myMatches = false;
+
+	QTSet_CloseView(&myView);
+	return(myMatches);
+}
+
+
+//////////
+//
+// QTSet_WriteFile
+// Replace the file at thePath with the concatenation of theParts, atomically.
+//
+// If the file already holds exactly these bytes we leave it alone; theWritten (if not NULL) tells the
+// caller whether we wrote anything. Otherwise the data goes into a uniquely named temporary file in the
+// same directory, which is flushed to disk and then renamed over thePath. If anything fails, the
+// temporary file is deleted and thePath is untouched.
+//
+//////////
+
+OSErr QTSet_WriteFile (const char *thePath, const QTSysIOVecRecord *theParts, long theCount, Boolean *theWritten)
+{
+	QTSysFile		myFile = kQTSysInvalidFile;
+	char			myTempPath[kQTSysMaxPath];
+	Boolean			myTempCreated = false;
+	OSErr			myErr = noErr;
+
+	if (theWritten != NULL)
+		*theWritten = false;
+
+	if ((thePath == NULL) || ((theParts == NULL) && (theCount > 0)) || (theCount < 0) || (theCount > kSetMaxWriteParts))
+		return(paramErr);
+
+	if (QTSet_FileMatches(thePath, theParts, theCount))
+		return(noErr);
+
+	// several threads (or several copies of QTDataEx) may be saving the same settings file at once
+	if (QTSys_FormatString(myTempPath, sizeof(myTempPath), "%s.%lu.%ld%s", thePath, QTSys_GetProcessID(), QTSys_AtomicAdd(&gSetTempSequence, 1), kSetTempFileExtension) < 0) {
+		myErr = paramErr;
+		goto bail;
+	}
+
+	myErr = QTSys_OpenFile(myTempPath, kQTSysOpenWrite, &myFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myTempCreated = true;
+
+	myErr = QTSys_WriteFileVector(myFile, theParts, theCount);
+	if (myErr != noErr)
+		goto bail;
+
+	// the new data must be on the disk before the rename makes it the settings file
+	myErr = QTSys_FlushFile(myFile);
+	if (myErr != noErr)
+		goto bail;
+
+	QTSys_CloseFile(myFile);
+	myFile = kQTSysInvalidFile;
+
+	myErr = QTSys_ReplacePath(myTempPath, thePath);
+	if (myErr != noErr)
+		goto bail;
+
+	myTempCreated = false;
+
+	if (theWritten != NULL)
+		*theWritten = true;
+
+bail:
+	QTSys_CloseFile(myFile);
+
+	if (myTempCreated)
+		QTSys_DeletePath(myTempPath);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Cache functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSet_GetFileStamp
+// Get the size and modification time of the file at the specified path.
+//
+//////////
+
+OSErr QTSet_GetFileStamp (const char *thePath, QTSetFileStampPtr theStamp)
+{
+	OSErr			myErr = noErr;
+
+	memset(theStamp, 0, sizeof(QTSetFileStampRecord));
+
+	myErr = QTSys_GetPathSize(thePath, &theStamp->fSize);
+	if (myErr == noErr)
+		myErr = QTSys_GetPathModificationTime(thePath, &theStamp->fModificationTime);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSet_NewCache
+// Create an empty cache that holds up to theCapacity settings; theDisposeProc disposes of the values.
+//
+//////////
+
+OSErr QTSet_NewCache (long theCapacity, QTSetCacheDisposeProcPtr theDisposeProc, QTSetCachePtr *theCache)
+{
+	QTSetCachePtr	myCache = NULL;
+	OSErr			myErr = noErr;
+
+	if (theCache == NULL)
+		return(paramErr);
+
+	*theCache = NULL;
+
+	if (theCapacity <= 0)
+		theCapacity = kSetDefaultCacheCapacity;
+
+	myCache = (QTSetCachePtr)calloc(1, sizeof(struct QTSetCacheRecord));
+	if (myCache == NULL)
+		return(memFullErr);
+
+	myCache->fDisposeProc = theDisposeProc;
+	myCache->fCapacity = theCapacity;
+
+	myCache->fEntries = (QTSetCacheEntryPtr *)calloc((size_t)theCapacity, sizeof(QTSetCacheEntryPtr));
+	if (myCache->fEntries == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = QTSys_NewMutex(&myCache->fMutex);
+
+bail:
+	if (myErr != noErr) {
+		free(myCache->fEntries);
+		free(myCache);
+	} else {
+		*theCache = myCache;
+	}
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSet_DropReference
+// Drop one reference to the specified entry, disposing of it if that was the last one. Call with the cache locked.
+//
+//////////
+
+static void QTSet_DropReference (QTSetCachePtr theCache, QTSetCacheEntryPtr theEntry)
+{
+	if (--theEntry->fRefCount > 0)
+		return;
+
+	if ((theCache->fDisposeProc != NULL) && (theEntry->fValue != NULL))
+		theCache->fDisposeProc(theEntry->fValue);
+
+	free(theEntry->fPath);
+	free(theEntry);
+}
+
+
+//////////
+//
+// QTSet_RemoveEntry
+// Take the entry at theIndex out of the cache. Call with the cache locked.
+//
+//////////
+
+static void QTSet_RemoveEntry (QTSetCachePtr theCache, long theIndex)
+{
+	QTSetCacheEntryPtr	myEntry = theCache->fEntries[theIndex];
+
+	// the order of the entries doesn't matter, so fill the hole with the last entry
+	theCache->fEntries[theIndex] = theCache->fEntries[--theCache->fCount];
+	theCache->fEntries[theCache->fCount] = NULL;
+
+	QTSet_DropReference(theCache, myEntry);
+}
+
+
+//////////
+//
+// QTSet_FindEntry
+// Return the index of the entry with the specified key, or -1. Call with the cache locked.
+//
+//////////
+
+static long QTSet_FindEntry (QTSetCachePtr theCache, OSType theSubType, OSType theManufacturer, const char *thePath)
+{
+	long			myIndex;
+
+	for (myIndex = 0; myIndex < theCache->fCount; myIndex++) {
+		QTSetCacheEntryPtr	myEntry = theCache->fEntries[myIndex];
+
+		if ((myEntry->fSubType == theSubType) && (myEntry->fManufacturer == theManufacturer) && (strcmp(myEntry->fPath, thePath) == 0))
+			return(myIndex);
+	}
+
+	return(-1);
+}
+
+
+//////////
+//
+// QTSet_DisposeCache
+// Dispose of a cache and of every value in it; nobody may be using any of its entries.
+//
+//////////
+
+void QTSet_DisposeCache (QTSetCachePtr theCache)
+{
+	if (theCache == NULL)
+		return;
+
+	while (theCache->fCount > 0)
+		QTSet_RemoveEntry(theCache, theCache->fCount - 1);
+
+	QTSys_DisposeMutex(theCache->fMutex);
+	free(theCache->fEntries);
+	free(theCache);
+}
+
+
+//////////
+//
+// QTSet_AcquireCachedValue
+// Look up the settings that the specified exporter read from the specified file.
+//
+// On a hit, theValue receives the cached value and we return its entry; the caller may use the value
+// until it passes the entry to QTSet_ReleaseCachedValue, and must not change it. On a miss (including
+// when the file has changed since the value was cached) we return NULL, and theStamp receives the file's
+// current stamp; the caller should read the file and then pass that stamp to QTSet_StoreCachedValue.
+// Taking the stamp before reading means that if the file changes in the meantime, the next lookup misses.
+//
+//////////
+
+QTSetCacheEntryPtr QTSet_AcquireCachedValue (QTSetCachePtr theCache, OSType theSubType, OSType theManufacturer, const char *thePath, QTSetFileStampPtr theStamp, void **theValue)
+{
+	QTSetCacheEntryPtr	myEntry = NULL;
+	Boolean				myExists;
+	long				myIndex;
+
+	*theValue = NULL;
+
+	myExists = (QTSet_GetFileStamp(thePath, theStamp) == noErr);
+
+	QTSys_LockMutex(theCache->fMutex);
+
+	myIndex = QTSet_FindEntry(theCache, theSubType, theManufacturer, thePath);
+	if (myIndex >= 0) {
+		myEntry = theCache->fEntries[myIndex];
+
+		if (myExists && (memcmp(&myEntry->fStamp, theStamp, sizeof(QTSetFileStampRecord)) == 0)) {
+			myEntry->fRefCount++;
+			myEntry->fLastUse = ++theCache->fClock;
+			*theValue = myEntry->fValue;
+		} else {
+			QTSet_RemoveEntry(theCache, myIndex);
+			theCache->fStats.fInvalidations++;
+			myEntry = NULL;
+		}
+	}
+
+	if (myEntry != NULL)
+		theCache->fStats.fHits++;
+	else
+		theCache->fStats.fMisses++;
+
+	QTSys_UnlockMutex(theCache->fMutex);
+
+	return(myEntry);
+}
+
+
+//////////
+//
+// QTSet_ReleaseCachedValue
+// Tell the cache that we're done with a value returned by QTSet_AcquireCachedValue.
+//
+//////////
+
+void QTSet_ReleaseCachedValue (QTSetCachePtr theCache, QTSetCacheEntryPtr theEntry)
+{
+	if ((theCache == NULL) || (theEntry == NULL))
+		return;
+
+	QTSys_LockMutex(theCache->fMutex);
+	QTSet_DropReference(theCache, theEntry);
+	QTSys_UnlockMutex(theCache->fMutex);
+}
+
+
+//////////
+//
+// QTSet_StoreCachedValue
+// Add the settings that the specified exporter read from the specified file to the cache.
+//
+// theStamp should be the one that QTSet_AcquireCachedValue returned. If we return noErr, the cache owns
+// theValue from now on; otherwise the caller still owns it. A full cache evicts its least recently used entry.
+//
+//////////
+
+OSErr QTSet_StoreCachedValue (QTSetCachePtr theCache, OSType theSubType, OSType theManufacturer, const char *thePath, QTSetFileStampPtr theStamp, void *theValue)
+{
+	QTSetCacheEntryPtr	myEntry = NULL;
+	long				myIndex;
+
+	if ((theCache == NULL) || (thePath == NULL) || (theStamp == NULL) || (theValue == NULL))
+		return(paramErr);
+
+	// a file we couldn't stat has nothing to compare against later
+	if ((theStamp->fSize == 0) && (theStamp->fModificationTime == 0))
+		return(paramErr);
+
+	myEntry = (QTSetCacheEntryPtr)calloc(1, sizeof(struct QTSetCacheEntryRecord));
+	if (myEntry == NULL)
+		return(memFullErr);
+
+	myEntry->fPath = QTSys_CopyString(thePath);
+	if (myEntry->fPath == NULL) {
+		free(myEntry);
+		return(memFullErr);
+	}
+
+	myEntry->fSubType = theSubType;
+	myEntry->fManufacturer = theManufacturer;
+	myEntry->fStamp = *theStamp;
+	myEntry->fValue = theValue;
+	myEntry->fRefCount = 1;
+
+	QTSys_LockMutex(theCache->fMutex);
+
+	// another thread may have stored the same settings while we were reading them
+	myIndex = QTSet_FindEntry(theCache, theSubType, theManufacturer, thePath);
+	if (myIndex >= 0)
+		QTSet_RemoveEntry(theCache, myIndex);
+
+	if (theCache->fCount == theCache->fCapacity) {
+		long		myOldest = 0;
+
+		for (myIndex = 1; myIndex < theCache->fCount; myIndex++)
+			if (theCache->fEntries[myIndex]->fLastUse < theCache->fEntries[myOldest]->fLastUse)
+				myOldest = myIndex;
+
+		QTSet_RemoveEntry(theCache, myOldest);
+		theCache->fStats.fEvictions++;
+	}
+
+	myEntry->fLastUse = ++theCache->fClock;
+	theCache->fEntries[theCache->fCount++] = myEntry;
+
+	QTSys_UnlockMutex(theCache->fMutex);
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSet_InvalidateCachedPath
+// Drop every cached value read from the specified file; call this after saving new settings into it.
+//
+//////////
+
+void QTSet_InvalidateCachedPath (QTSetCachePtr theCache, const char *thePath)
+{
+	long			myIndex;
+
+	if ((theCache == NULL) || (thePath == NULL))
+		return;
+
+	QTSys_LockMutex(theCache->fMutex);
+
+	for (myIndex = theCache->fCount - 1; myIndex >= 0; myIndex--) {
+		if (strcmp(theCache->fEntries[myIndex]->fPath, thePath) == 0) {
+			QTSet_RemoveEntry(theCache, myIndex);
+			theCache->fStats.fInvalidations++;
+		}
+	}
+
+	QTSys_UnlockMutex(theCache->fMutex);
+}
+
+
+//////////
+//
+// QTSet_GetCacheStats
+// Get the hit and miss counters of the specified cache.
+//
+//////////
+
+void QTSet_GetCacheStats (QTSetCachePtr theCache, QTSetCacheStatsPtr theStats)
+{
+	if (theStats == NULL)
+		return;
+
+	memset(theStats, 0, sizeof(QTSetCacheStatsRecord));
+	if (theCache == NULL)
+		return;
+
+	QTSys_LockMutex(theCache->fMutex);
+	*theStats = theCache->fStats;
+	theStats->fEntryCount = theCache->fCount;
+	QTSys_UnlockMutex(theCache->fMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Atom container functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSet_ReadAtomHeader
+// Read the header of the atom at theOffset, making sure that the atom lies inside [theOffset, theEnd).
+//
+//////////
+
+static OSErr QTSet_ReadAtomHeader (const UInt8 *theData, UInt32 theOffset, UInt32 theEnd, QTSetAtomPtr theAtom)
+{
+	const UInt8		*myHeader = theData + theOffset;
+
+	if ((theOffset > theEnd) || (theEnd - theOffset < kSetAtomHeaderSize))
+		return(invalidAtomContainerErr);
+
+	theAtom->fOffset = theOffset;
+	theAtom->fSize = QTAtom_GetBE32(myHeader);
+	theAtom->fType = QTAtom_GetBE32(myHeader + 4);
+	theAtom->fID = QTAtom_GetBE32(myHeader + 8);
+	theAtom->fChildCount = QTAtom_GetBE16(myHeader + 14);
+
+	if ((theAtom->fSize < kSetAtomHeaderSize) || (theAtom->fSize > theEnd - theOffset))
+		return(invalidAtomContainerErr);
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSet_ValidateAtom
+// Make sure that the specified atom and all its descendants lie inside their parents, counting them as we go.
+//
+//////////
+
+static OSErr QTSet_ValidateAtom (const UInt8 *theData, QTSetAtomPtr theAtom, long theDepth, UInt32 *theAtomCount)
+{
+	QTSetAtomRecord		myChild;
+	UInt32				myOffset;
+	UInt32				myEnd;
+	UInt16				myIndex;
+	OSErr				myErr = noErr;
+
+	(*theAtomCount)++;
+
+	if (theAtom->fChildCount == 0)
+		return(noErr);
+
+	if (theDepth >= kSetMaxAtomDepth)
+		return(invalidAtomContainerErr);
+
+	myOffset = theAtom->fOffset + kSetAtomHeaderSize;
+	myEnd = theAtom->fOffset + theAtom->fSize;
+
+	for (myIndex = 0; myIndex < theAtom->fChildCount; myIndex++) {
+		myErr = QTSet_ReadAtomHeader(theData, myOffset, myEnd, &myChild);
+		if (myErr == noErr)
+			myErr = QTSet_ValidateAtom(theData, &myChild, theDepth + 1, theAtomCount);
+		if (myErr != noErr)
+			return(myErr);
+
+		myOffset += myChild.fSize;
+	}
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSet_GetRootAtom
+// Find the root atom of the QT atom container in theData.
+//
+// We also accept a bare root atom, without the 12-byte container header in front of it.
+//
+//////////
+
+OSErr QTSet_GetRootAtom (const UInt8 *theData, UInt32 theSize, QTSetAtomPtr theAtom)
+{
+	UInt32			myOffset = 0;
+	OSErr			myErr = noErr;
+
+	if ((theData == NULL) || (theAtom == NULL))
+		return(paramErr);
+
+	if ((theSize >= kSetAtomHeaderSize) && (QTAtom_GetBE32(theData + 4) != kSetRootAtomType))
+		myOffset = kSetContainerHeaderSize;
+
+	myErr = QTSet_ReadAtomHeader(theData, myOffset, theSize, theAtom);
+	if ((myErr == noErr) && (theAtom->fType != kSetRootAtomType))
+		myErr = invalidAtomContainerErr;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSet_ValidateContainer
+// Make sure that theData holds a well-formed QT atom container, without copying any of it.
+//
+// On success, theAtomCount (if not NULL) receives the number of atoms in the container, root included.
+// The other atom container functions assume that the container has passed this test.
+//
+//////////
+
+OSErr QTSet_ValidateContainer (const UInt8 *theData, UInt32 theSize, UInt32 *theAtomCount)
+{
+	QTSetAtomRecord		myRoot;
+	UInt32				myCount = 0;
+	OSErr				myErr = noErr;
+
+	myErr = QTSet_GetRootAtom(theData, theSize, &myRoot);
+	if (myErr == noErr)
+		myErr = QTSet_ValidateAtom(theData, &myRoot, 0, &myCount);
+
+	if (theAtomCount != NULL)
+		*theAtomCount = (myErr == noErr) ? myCount : 0;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSet_FindChildAtom
+// Find the theIndex'th (1-based) child of theParent that has the specified type.
+//
+//////////
+
+OSErr QTSet_FindChildAtom (const UInt8 *theData, QTSetAtomPtr theParent, OSType theType, UInt32 theIndex, QTSetAtomPtr theChild)
+{
+	UInt32			myOffset;
+	UInt32			myEnd;
+	UInt16			myIndex;
+	OSErr			myErr = noErr;
+
+	if ((theData == NULL) || (theParent == NULL) || (theChild == NULL) || (theIndex == 0))
+		return(paramErr);
+
+	myOffset = theParent->fOffset + kSetAtomHeaderSize;
+	myEnd = theParent->fOffset + theParent->fSize;
+
+	for (myIndex = 0; myIndex < theParent->fChildCount; myIndex++) {
+		myErr = QTSet_ReadAtomHeader(theData, myOffset, myEnd, theChild);
+		if (myErr != noErr)
+			return(myErr);
+
+		if ((theChild->fType == theType) && (--theIndex == 0))
+			return(noErr);
+
+		myOffset += theChild->fSize;
+	}
+
+	return(invalidAtomErr);
+}
+
+
+//////////
+//
+// QTSet_GetLeafData
+// Return a pointer to the data of the specified leaf atom, and its size; this points into the container itself.
+//
+//////////
+
+const UInt8 *QTSet_GetLeafData (const UInt8 *theData, QTSetAtomPtr theAtom, UInt32 *theDataSize)
+{
+	if ((theData == NULL) || (theAtom == NULL) || (theAtom->fChildCount != 0)) {
+		if (theDataSize != NULL)
+			*theDataSize = 0;
+		return(NULL);
+	}
+
+	if (theDataSize != NULL)
+		*theDataSize = theAtom->fSize - kSetAtomHeaderSize;
+
+	return(theData + theAtom->fOffset + kSetAtomHeaderSize);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSet_WriteSyntheticFile
+// Write a settings file of about theSize bytes: a root atom holding up to 64K leaf atoms of noise.
+//
+// The file is written as settings files are, with QTSet_WriteFile: the container and root atom headers are
+// one part and the leaves another, so the two go out in one gathered write without being copied together.
+//
+//////////
+
+static OSErr QTSet_WriteSyntheticFile (const char *thePath, UInt32 theSize)
+{
+	QTSysIOVecRecord	myParts[2];
+	UInt8				*myLeaves = NULL;
+	UInt8				*myLeaf;
+	UInt8				myHeader[kSetContainerHeaderSize + kSetAtomHeaderSize];
+	UInt32				myLeafCount;
+	UInt32				myIndex;
+	UInt32				mySeed = 0x2545F491;
+	OSErr				myErr = noErr;
+
+	myLeafCount = theSize / (kSetAtomHeaderSize + kSetBenchmarkLeafSize);
+	if (myLeafCount == 0)
+		myLeafCount = 1;
+	if (myLeafCount > 0xFFFF)
+		return(paramErr);
+
+	myLeaves = (UInt8 *)malloc(myLeafCount * (kSetAtomHeaderSize + kSetBenchmarkLeafSize));
+	if (myLeaves == NULL)
+		return(memFullErr);
+
+	memset(myHeader, 0, sizeof(myHeader));
+	QTAtom_PutBE32(myHeader + kSetContainerHeaderSize, kSetAtomHeaderSize + myLeafCount * (kSetAtomHeaderSize + kSetBenchmarkLeafSize));
+	QTAtom_PutBE32(myHeader + kSetContainerHeaderSize + 4, kSetRootAtomType);
+	QTAtom_PutBE32(myHeader + kSetContainerHeaderSize + 8, 1);
+	QTAtom_PutBE16(myHeader + kSetContainerHeaderSize + 14, (UInt16)myLeafCount);
+
+	for (myIndex = 0; myIndex < myLeafCount; myIndex++) {
+		UInt32		myByte;
+
+		myLeaf = myLeaves + myIndex * (kSetAtomHeaderSize + kSetBenchmarkLeafSize);
+		memset(myLeaf, 0, kSetAtomHeaderSize);
+		QTAtom_PutBE32(myLeaf, kSetAtomHeaderSize + kSetBenchmarkLeafSize);
+		QTAtom_PutBE32(myLeaf + 4, kSetBenchmarkLeafType);
+		QTAtom_PutBE32(myLeaf + 8, myIndex + 1);
+
+		// a simple xorshift generator is plenty for noise
+		for (myByte = 0; myByte < kSetBenchmarkLeafSize; myByte++) {
+			mySeed ^= mySeed << 13;
+			mySeed ^= mySeed >> 17;
+			mySeed ^= mySeed << 5;
+			myLeaf[kSetAtomHeaderSize + myByte] = (UInt8)mySeed;
+		}
+	}
+
+	myParts[0].fData = myHeader;
+	myParts[0].fLength = sizeof(myHeader);
+	myParts[1].fData = myLeaves;
+	myParts[1].fLength = myLeafCount * (kSetAtomHeaderSize + kSetBenchmarkLeafSize);
+
+	myErr = QTSet_WriteFile(thePath, myParts, 2, NULL);
+
+	free(myLeaves);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSet_ReadThroughCache
+// Get the settings file at thePath as QTDX_GetExporterSettingsFromFile does: from theCache if it's there and
+// unchanged, otherwise by mapping, validating and copying it, and then keeping the copy in theCache.
+//
+//////////
+
+static OSErr QTSet_ReadThroughCache (QTSetCachePtr theCache, const char *thePath, UInt32 *theAtomCount, Boolean *theMapped)
+{
+	QTSetFileStampRecord	myStamp;
+	QTSetCacheEntryPtr		myEntry = NULL;
+	QTSetViewRecord			myView;
+	void					*myValue = NULL;
+	UInt8					*myCopy = NULL;
+	OSErr					myErr = noErr;
+
+	myEntry = QTSet_AcquireCachedValue(theCache, kSetRootAtomType, 0, thePath, &myStamp, &myValue);
+	if (myEntry != NULL) {
+		QTSet_ReleaseCachedValue(theCache, myEntry);
+		return(noErr);
+	}
+
+	myErr = QTSet_OpenView(thePath, 0, &myView);
+	if (myErr != noErr)
+		return(myErr);
+
+	*theMapped = myView.fMapped;
+	myErr = QTSet_ValidateContainer(myView.fData, myView.fSize, theAtomCount);
+	if (myErr != noErr)
+		goto bail;
+
+	myCopy = (UInt8 *)malloc(myView.fSize);
+	if (myCopy == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	memcpy(myCopy, myView.fData, myView.fSize);
+
+	// the cache owns the copy once it accepts it
+	if (QTSet_StoreCachedValue(theCache, kSetRootAtomType, 0, thePath, &myStamp, myCopy) != noErr)
+		free(myCopy);
+
+bail:
+	QTSet_CloseView(&myView);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSet_RunBenchmark
+// Compare the ways of getting at a large settings file, writing one JSON line per reader.
+//
+// "read" is what QTDataEx used to do: read the whole file into memory, then look at it. "mapped" maps
+// the file and validates the atom container in place. "mapped+copy" is what QTDX_ReadHandleFromFile now
+// does, because an exporter insists on a handle: map, validate, then copy the bytes once. "cached" is what
+// it does with USE_SETTINGS_CACHE set: only the first read goes to the file, and the later ones find the
+// copy in a settings cache; its line adds the cache's hit and miss counts. The synthetic file is written to
+// theScratchPath and deleted afterwards; it's read once before timing starts, so all the readers work from
+// the file system cache.
+//
+//////////
+
+OSErr QTSet_RunBenchmark (FILE *theReport, const char *theScratchPath, UInt32 theSize, long theIterations)
+{
+	static const char		*myReaderNames[] = {"read", "mapped", "mapped+copy", "cached"};
+	QTSetCachePtr			myCache = NULL;
+	QTSetCacheStatsRecord	myStats;
+	QTSetViewRecord			myView;
+	UInt8					*myCopy = NULL;
+	UInt32					myAtomCount = 0;
+	long					myReader;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theScratchPath == NULL)
+		return(paramErr);
+	if (theSize == 0)
+		theSize = kSetDefaultBenchmarkSize;
+	if (theIterations <= 0)
+		theIterations = kSetDefaultBenchmarkIterations;
+
+	myErr = QTSet_WriteSyntheticFile(theScratchPath, theSize);
+	if (myErr != noErr)
+		goto bail;
+
+	// warm up the file system cache
+	myErr = QTSet_OpenView(theScratchPath, kSetViewDontMap, &myView);
+	if (myErr != noErr)
+		goto bail;
+
+	theSize = myView.fSize;
+	QTSet_CloseView(&myView);
+
+	myCopy = (UInt8 *)malloc(theSize);
+	if (myCopy == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = QTSet_NewCache(1, free, &myCache);
+	if (myErr != noErr)
+		goto bail;
+
+	for (myReader = 0; myReader < (long)(sizeof(myReaderNames) / sizeof(myReaderNames[0])); myReader++) {
+		QTUInt64		myStartTime;
+		QTUInt64		myWallTime;
+		Boolean			myMapped = false;
+
+		myStartTime = QTSys_GetMicroseconds();
+
+		for (myIndex = 0; (myIndex < theIterations) && (myErr == noErr); myIndex++) {
+			if (myReader == 3) {
+				myErr = QTSet_ReadThroughCache(myCache, theScratchPath, &myAtomCount, &myMapped);
+				continue;
+			}
+
+			myErr = QTSet_OpenView(theScratchPath, (myReader == 0) ? kSetViewDontMap : 0, &myView);
+			if (myErr != noErr)
+				break;
+
+			myMapped = myView.fMapped;
+			myErr = QTSet_ValidateContainer(myView.fData, myView.fSize, &myAtomCount);
+			if ((myErr == noErr) && (myReader == 2))
+				memcpy(myCopy, myView.fData, myView.fSize);
+
+			QTSet_CloseView(&myView);
+		}
+
+		if (myErr != noErr)
+			goto bail;
+
+		myWallTime = QTSys_GetMicroseconds() - myStartTime;
+
+		if (theReport != NULL) {
+			fprintf(theReport, "{\"benchmark\":\"settings\",\"reader\":\"%s\",\"mapped\":%s,\"bytes\":%lu,\"atoms\":%lu,\"iterations\":%ld,\"wallMicroseconds\":%llu,\"microsecondsPerRead\":%.1f,\"megabytesPerSecond\":%.1f",
+						myReaderNames[myReader],
+						myMapped ? "true" : "false",
+						(unsigned long)theSize,
+						(unsigned long)myAtomCount,
+						theIterations,
+						(unsigned long long)myWallTime,
+						(double)myWallTime / (double)theIterations,
+						(myWallTime > 0) ? ((double)theSize * (double)theIterations / (double)myWallTime) : 0.0);
+
+			if (myReader == 3) {
+				QTSet_GetCacheStats(myCache, &myStats);
+				fprintf(theReport, ",\"cacheHits\":%llu,\"cacheMisses\":%llu", (unsigned long long)myStats.fHits, (unsigned long long)myStats.fMisses);
+			}
+
+			fprintf(theReport, "}\n");
+			fflush(theReport);
+		}
+	}
+
+bail:
+	QTSys_DeletePath(theScratchPath);
+	QTSet_DisposeCache(myCache);
+	free(myCopy);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSet_IsSettingsCommandLine
+// Does the specified command line ask for the settings reader benchmark?
+//
+//////////
+
+Boolean QTSet_IsSettingsCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kSetBenchmarkSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTSet_Main
+// Run the settings reader benchmark. Returns one of the kSetExit constants.
+//
+// Usage: -settingsbench <scratch file> [-size <bytes>] [-iterations <count>] [-report <file>]
+//
+//////////
+
+int QTSet_Main (int theArgc, char *theArgv[])
+{
+	const char			*myScratchPath = NULL;
+	const char			*myReportPath = NULL;
+	UInt32				mySize = kSetDefaultBenchmarkSize;
+	long				myIterations = kSetDefaultBenchmarkIterations;
+	FILE				*myReport = stdout;
+	int					myIndex;
+	OSErr				myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kSetBenchmarkSwitch) == 0) && (myIndex + 1 < theArgc))
+			myScratchPath = theArgv[++myIndex];
+		else if ((strcmp(theArgv[myIndex], kSetSizeSwitch) == 0) && (myIndex + 1 < theArgc))
+			mySize = (UInt32)strtoul(theArgv[++myIndex], NULL, 10);
+		else if ((strcmp(theArgv[myIndex], kSetIterationsSwitch) == 0) && (myIndex + 1 < theArgc))
+			myIterations = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSetReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if (myScratchPath == NULL) {
+		fprintf(stderr, "usage: %s %s <scratch file> [%s <bytes>] [%s <count>] [%s <file>]\n", theArgv[0], kSetBenchmarkSwitch, kSetSizeSwitch, kSetIterationsSwitch, kSetReportSwitch);
+		return(kSetExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kSetExitUsage);
+		}
+	}
+
+	myErr = QTSet_RunBenchmark(myReport, myScratchPath, mySize, myIterations);
+	if (myErr != noErr)
+		fprintf(stderr, "settings benchmark failed (error %d)\n", (int)myErr);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kSetExitSuccess : kSetExitFailed);
+}
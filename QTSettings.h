@@ -0,0 +1,138 @@
+//////////
+//
+//	File:		QTSettings.h
+//
+//	Contains:	Portable functions for reading and writing the exporter settings files that QTDataEx saves.
+//				All utilities start with the prefix "QTSet_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTSettings__
+#define __QTSettings__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTAtoms.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kSetBenchmarkSwitch					"-settingsbench"		// command-line switch that selects the reader benchmark
+#define kSetSizeSwitch						"-size"					// size of the synthetic settings file, in bytes
+#define kSetIterationsSwitch				"-iterations"			// number of reads of each kind
+#define kSetReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kSetContainerHeaderSize				12						// 10 reserved bytes + lock count
+#define kSetAtomHeaderSize					20						// size, type, ID, reserved, child count, reserved
+#define kSetRootAtomType					FOUR_CHAR_CODE('sean')
+#define kSetMaxAtomDepth					32						// deepest nesting we follow
+
+#define kSetTempFileExtension				".tmp"					// QTSet_WriteFile writes into <path>.<process>.<n>.tmp first
+#define kSetMaxWriteParts					0x7FFF
+
+#define kSetDefaultCacheCapacity			32						// settings files a cache remembers at once
+
+#define kSetDefaultBenchmarkSize			(8L * 1024L * 1024L)
+#define kSetDefaultBenchmarkIterations		20
+
+// flags for QTSet_OpenView
+enum {
+	kSetViewDontMap							= 1L << 0				// read the file into memory even if it could be mapped
+};
+
+// exit codes returned by QTSet_Main
+enum {
+	kSetExitSuccess							= 0,
+	kSetExitFailed							= 1,
+	kSetExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// the bytes of a settings file, either mapped or read into memory
+typedef struct QTSetViewRecord {
+	const UInt8				*fData;
+	UInt32					fSize;
+	Boolean					fMapped;				// true if fData points into fMapping
+	QTSysMappedFileRecord	fMapping;
+	UInt8					*fBuffer;				// the copy, if we couldn't map the file
+} QTSetViewRecord, *QTSetViewPtr;
+
+// one atom of a QT atom container, located in place; offsets are from the start of the container
+typedef struct QTSetAtomRecord {
+	UInt32					fOffset;				// offset of the atom header
+	UInt32					fSize;					// the whole atom, header included
+	OSType					fType;
+	UInt32					fID;
+	UInt16					fChildCount;			// 0 for leaf atoms, whose data follows the header
+} QTSetAtomRecord, *QTSetAtomPtr;
+
+// what a settings file looked like on disk; if either field changes, the file has changed
+typedef struct QTSetFileStampRecord {
+	QTUInt64				fSize;
+	QTUInt64				fModificationTime;
+} QTSetFileStampRecord, *QTSetFileStampPtr;
+
+typedef struct QTSetCacheStatsRecord {
+	QTUInt64				fHits;
+	QTUInt64				fMisses;
+	QTUInt64				fInvalidations;			// entries dropped because their file changed or was saved again
+	QTUInt64				fEvictions;				// entries dropped to make room for others
+	long					fEntryCount;
+} QTSetCacheStatsRecord, *QTSetCacheStatsPtr;
+
+// a cache of parsed settings; see the cache functions in QTSettings.c
+typedef struct QTSetCacheRecord			*QTSetCachePtr;
+typedef struct QTSetCacheEntryRecord	*QTSetCacheEntryPtr;
+
+typedef void				(*QTSetCacheDisposeProcPtr) (void *theValue);
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTSet_OpenView (const char *thePath, long theFlags, QTSetViewPtr theView);
+void						QTSet_CloseView (QTSetViewPtr theView);
+
+OSErr						QTSet_WriteFile (const char *thePath, const QTSysIOVecRecord *theParts, long theCount, Boolean *theWritten);
+Boolean						QTSet_FileMatches (const char *thePath, const QTSysIOVecRecord *theParts, long theCount);
+
+OSErr						QTSet_GetFileStamp (const char *thePath, QTSetFileStampPtr theStamp);
+OSErr						QTSet_NewCache (long theCapacity, QTSetCacheDisposeProcPtr theDisposeProc, QTSetCachePtr *theCache);
+void						QTSet_DisposeCache (QTSetCachePtr theCache);
+QTSetCacheEntryPtr			QTSet_AcquireCachedValue (QTSetCachePtr theCache, OSType theSubType, OSType theManufacturer, const char *thePath, QTSetFileStampPtr theStamp, void **theValue);
+void						QTSet_ReleaseCachedValue (QTSetCachePtr theCache, QTSetCacheEntryPtr theEntry);
+OSErr						QTSet_StoreCachedValue (QTSetCachePtr theCache, OSType theSubType, OSType theManufacturer, const char *thePath, QTSetFileStampPtr theStamp, void *theValue);
+void						QTSet_InvalidateCachedPath (QTSetCachePtr theCache, const char *thePath);
+void						QTSet_GetCacheStats (QTSetCachePtr theCache, QTSetCacheStatsPtr theStats);
+
+OSErr						QTSet_ValidateContainer (const UInt8 *theData, UInt32 theSize, UInt32 *theAtomCount);
+OSErr						QTSet_GetRootAtom (const UInt8 *theData, UInt32 theSize, QTSetAtomPtr theAtom);
+OSErr						QTSet_FindChildAtom (const UInt8 *theData, QTSetAtomPtr theParent, OSType theType, UInt32 theIndex, QTSetAtomPtr theChild);
+const UInt8 *				QTSet_GetLeafData (const UInt8 *theData, QTSetAtomPtr theAtom, UInt32 *theDataSize);
+
+OSErr						QTSet_RunBenchmark (FILE *theReport, const char *theScratchPath, UInt32 theSize, long theIterations);
+
+Boolean						QTSet_IsSettingsCommandLine (int theArgc, char *theArgv[]);
+int							QTSet_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTSettings__
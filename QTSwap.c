@@ -0,0 +1,1156 @@
+//////////
+//
+//	File:		QTSwap.c
+//
+//	Contains:	Portable functions for byte-swapping whole arrays of 16-, 32- and 64-bit values, using the
+//				widest vector instructions the processor has.
+//				All utilities start with the prefix "QTSwap_".
+//
+//	Everything in a movie file is big-endian, and everything we run on now is little-endian, so reading a
+//	sample table means swapping every entry in it; a long sound track has millions of them. Swapping one
+//	value at a time (as QTAtom_GetBE32 and the Endian macros do) is fine for headers, but for tables we swap
+//	a whole array at once, 16 or 32 bytes per instruction.
+//
+//	There is a kernel for each instruction set we know about (plain C, SSE2, AVX2 and NEON), and we pick
+//	the fastest one the processor can run the first time we're asked to swap anything. A kernel is built
+//	only if the compiler can build it: Visual Studio 2005 knows nothing of AVX2, for instance, so the
+//	Windows application gets the SSE2 kernel at best. QTSwap_RunCheck compares every kernel with the plain
+//	C one, and QTSwap_RunBenchmark times them all on tables of various sizes.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSwap.h"
+#include "QTAtoms.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define USE_SSE2_KERNELS			1
+#else
+#define USE_SSE2_KERNELS			0
+#endif
+
+// Visual Studio has had the AVX2 intrinsics only since 2012
+#if USE_SSE2_KERNELS && (!defined(_MSC_VER) || (_MSC_VER >= 1700))
+#define USE_AVX2_KERNELS			1
+#else
+#define USE_AVX2_KERNELS			0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define USE_NEON_KERNELS			1
+#else
+#define USE_NEON_KERNELS			0
+#endif
+
+#if USE_SSE2_KERNELS
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <emmintrin.h>
+#endif
+
+#if USE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+#if USE_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+// gcc and clang compile a function for a newer instruction set than the rest of the file only if asked to
+#if defined(__GNUC__)
+#define QTSWAP_TARGET(theTarget)	__attribute__((target(theTarget)))
+#else
+#define QTSWAP_TARGET(theTarget)
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kSwapWidenWindow			1024					// 32-bit values QTSwap_ReadBE32To64 swaps at once, on the stack
+#define kSwapCheckMaxLength			128						// the check tries every length of array up to this
+#define kSwapCheckMaxOffset			16						// and every misalignment of source and destination below this
+#define kSwapCheckGuardByte			0xA5					// fills the destination around the array, to catch writes past either end
+#define kSwapCheckDefaultSeed		0x2545F491
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static void					QTSwap_Swap16Scalar (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap32Scalar (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap64Scalar (void *theDest, const void *theSource, size_t theCount);
+#if USE_SSE2_KERNELS
+static void					QTSwap_Swap16SSE2 (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap32SSE2 (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap64SSE2 (void *theDest, const void *theSource, size_t theCount);
+#endif
+#if USE_AVX2_KERNELS
+static void					QTSwap_Swap16AVX2 (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap32AVX2 (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap64AVX2 (void *theDest, const void *theSource, size_t theCount);
+#endif
+#if USE_NEON_KERNELS
+static void					QTSwap_Swap16NEON (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap32NEON (void *theDest, const void *theSource, size_t theCount);
+static void					QTSwap_Swap64NEON (void *theDest, const void *theSource, size_t theCount);
+#endif
+static Boolean				QTSwap_IsKernelSupported (long theKernel);
+static long					QTSwap_CheckKernel (QTSwapKernelsPtr theKernels, long theWidth, const UInt8 *theSource, UInt8 *theDest, UInt8 *theExpected);
+static long					QTSwap_CheckReaders (const UInt8 *theSource, UInt8 *theDest, long *theCaseCount);
+static UInt32				QTSwap_NextRandom (UInt32 *theSeed);
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static QTSwapKernelsRecord	gSwapKernels[kSwapKernelCount] = {
+	{"scalar", QTSwap_Swap16Scalar, QTSwap_Swap32Scalar, QTSwap_Swap64Scalar},
+#if USE_SSE2_KERNELS
+	{"sse2", QTSwap_Swap16SSE2, QTSwap_Swap32SSE2, QTSwap_Swap64SSE2},
+#else
+	{"sse2", NULL, NULL, NULL},
+#endif
+#if USE_AVX2_KERNELS
+	{"avx2", QTSwap_Swap16AVX2, QTSwap_Swap32AVX2, QTSwap_Swap64AVX2},
+#else
+	{"avx2", NULL, NULL, NULL},
+#endif
+#if USE_NEON_KERNELS
+	{"neon", QTSwap_Swap16NEON, QTSwap_Swap32NEON, QTSwap_Swap64NEON}
+#else
+	{"neon", NULL, NULL, NULL}
+#endif
+};
+
+static volatile long		gSwapBestKernel = -1;		// -1 until QTSwap_GetBestKernel has looked at the processor
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Swapping functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSwap_Swap16
+// Swap the bytes of theCount 16-bit values, with the fastest kernel we have.
+//
+//////////
+
+void QTSwap_Swap16 (void *theDest, const void *theSource, size_t theCount)
+{
+	gSwapKernels[QTSwap_GetBestKernel()].fSwap16(theDest, theSource, theCount);
+}
+
+
+//////////
+//
+// QTSwap_Swap32
+// Swap the bytes of theCount 32-bit values, with the fastest kernel we have.
+//
+//////////
+
+void QTSwap_Swap32 (void *theDest, const void *theSource, size_t theCount)
+{
+	gSwapKernels[QTSwap_GetBestKernel()].fSwap32(theDest, theSource, theCount);
+}
+
+
+//////////
+//
+// QTSwap_Swap64
+// Swap the bytes of theCount 64-bit values, with the fastest kernel we have.
+//
+//////////
+
+void QTSwap_Swap64 (void *theDest, const void *theSource, size_t theCount)
+{
+	gSwapKernels[QTSwap_GetBestKernel()].fSwap64(theDest, theSource, theCount);
+}
+
+
+//////////
+//
+// QTSwap_ReadBE32
+// Convert theCount big-endian 32-bit values, as they are in a file, to native ones.
+//
+//////////
+
+void QTSwap_ReadBE32 (UInt32 *theDest, const UInt8 *theSource, size_t theCount)
+{
+#if QTSWAP_HOST_BIG_ENDIAN
+	if ((const UInt8 *)theDest != theSource)
+		memmove(theDest, theSource, theCount * sizeof(UInt32));
+#else
+	QTSwap_Swap32(theDest, theSource, theCount);
+#endif
+}
+
+
+//////////
+//
+// QTSwap_ReadBE64
+// Convert theCount big-endian 64-bit values, as they are in a file, to native ones.
+//
+//////////
+
+void QTSwap_ReadBE64 (QTUInt64 *theDest, const UInt8 *theSource, size_t theCount)
+{
+#if QTSWAP_HOST_BIG_ENDIAN
+	if ((const UInt8 *)theDest != theSource)
+		memmove(theDest, theSource, theCount * sizeof(QTUInt64));
+#else
+	QTSwap_Swap64(theDest, theSource, theCount);
+#endif
+}
+
+
+//////////
+//
+// QTSwap_ReadBE32To64
+// Convert theCount big-endian 32-bit values to native 64-bit ones, as we do for 'stco' chunk offsets.
+//
+// We swap a window of values into a buffer on the stack and widen them from there, so the widening loop
+// is a simple one the compiler can vectorize too.
+//
+//////////
+
+void QTSwap_ReadBE32To64 (QTUInt64 *theDest, const UInt8 *theSource, size_t theCount)
+{
+	UInt32					myWindow[kSwapWidenWindow];
+
+	while (theCount > 0) {
+		size_t				myCount = (theCount < kSwapWidenWindow) ? theCount : kSwapWidenWindow;
+		size_t				myIndex;
+
+		QTSwap_ReadBE32(myWindow, theSource, myCount);
+		for (myIndex = 0; myIndex < myCount; myIndex++)
+			theDest[myIndex] = myWindow[myIndex];
+
+		theDest += myCount;
+		theSource += myCount * sizeof(UInt32);
+		theCount -= myCount;
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Kernel functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSwap_Swap16Scalar
+// Swap 16-bit values one at a time; the other kernels use this for whatever is left over after their last
+// whole vector.
+//
+// We copy each value in and out with memcpy, because neither array need be aligned; compilers turn those
+// into plain loads and stores.
+//
+//////////
+
+static void QTSwap_Swap16Scalar (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	UInt16					myValue;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex < theCount; myIndex++) {
+		memcpy(&myValue, mySource + (2 * myIndex), sizeof(myValue));
+		myValue = (UInt16)((myValue >> 8) | (myValue << 8));
+		memcpy(myDest + (2 * myIndex), &myValue, sizeof(myValue));
+	}
+}
+
+
+//////////
+//
+// QTSwap_Swap32Scalar
+// Swap 32-bit values one at a time.
+//
+//////////
+
+static void QTSwap_Swap32Scalar (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	UInt32					myValue;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex < theCount; myIndex++) {
+		memcpy(&myValue, mySource + (4 * myIndex), sizeof(myValue));
+		myValue = (myValue >> 24) | ((myValue >> 8) & 0x0000FF00) | ((myValue << 8) & 0x00FF0000) | (myValue << 24);
+		memcpy(myDest + (4 * myIndex), &myValue, sizeof(myValue));
+	}
+}
+
+
+//////////
+//
+// QTSwap_Swap64Scalar
+// Swap 64-bit values one at a time, as two swapped 32-bit halves in the opposite order.
+//
+//////////
+
+static void QTSwap_Swap64Scalar (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	UInt32					myHalves[2];
+	UInt32					myValue;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex < theCount; myIndex++) {
+		memcpy(myHalves, mySource + (8 * myIndex), sizeof(myHalves));
+
+		myValue = myHalves[0];
+		myHalves[0] = (myHalves[1] >> 24) | ((myHalves[1] >> 8) & 0x0000FF00) | ((myHalves[1] << 8) & 0x00FF0000) | (myHalves[1] << 24);
+		myHalves[1] = (myValue >> 24) | ((myValue >> 8) & 0x0000FF00) | ((myValue << 8) & 0x00FF0000) | (myValue << 24);
+
+		memcpy(myDest + (8 * myIndex), myHalves, sizeof(myHalves));
+	}
+}
+
+
+#if USE_SSE2_KERNELS
+
+//////////
+//
+// QTSwap_Swap16SSE2
+// Swap 16-bit values eight at a time, by shifting each one left and right a byte and combining the two.
+//
+//////////
+
+QTSWAP_TARGET("sse2") static void QTSwap_Swap16SSE2 (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 8 <= theCount; myIndex += 8) {
+		__m128i				myValues = _mm_loadu_si128((const __m128i *)(mySource + (2 * myIndex)));
+
+		myValues = _mm_or_si128(_mm_slli_epi16(myValues, 8), _mm_srli_epi16(myValues, 8));
+		_mm_storeu_si128((__m128i *)(myDest + (2 * myIndex)), myValues);
+	}
+
+	QTSwap_Swap16Scalar(myDest + (2 * myIndex), mySource + (2 * myIndex), theCount - myIndex);
+}
+
+
+//////////
+//
+// QTSwap_Swap32SSE2
+// Swap 32-bit values four at a time: swap the bytes of each 16-bit half, then swap the halves.
+//
+// SSE2 has no byte shuffle (that came with SSSE3), but it can shuffle 16-bit words.
+//
+//////////
+
+QTSWAP_TARGET("sse2") static void QTSwap_Swap32SSE2 (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 4 <= theCount; myIndex += 4) {
+		__m128i				myValues = _mm_loadu_si128((const __m128i *)(mySource + (4 * myIndex)));
+
+		myValues = _mm_or_si128(_mm_slli_epi16(myValues, 8), _mm_srli_epi16(myValues, 8));
+		myValues = _mm_shufflelo_epi16(myValues, _MM_SHUFFLE(2, 3, 0, 1));
+		myValues = _mm_shufflehi_epi16(myValues, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128((__m128i *)(myDest + (4 * myIndex)), myValues);
+	}
+
+	QTSwap_Swap32Scalar(myDest + (4 * myIndex), mySource + (4 * myIndex), theCount - myIndex);
+}
+
+
+//////////
+//
+// QTSwap_Swap64SSE2
+// Swap 64-bit values two at a time: swap the bytes of each 16-bit word, then reverse the four words.
+//
+//////////
+
+QTSWAP_TARGET("sse2") static void QTSwap_Swap64SSE2 (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 2 <= theCount; myIndex += 2) {
+		__m128i				myValues = _mm_loadu_si128((const __m128i *)(mySource + (8 * myIndex)));
+
+		myValues = _mm_or_si128(_mm_slli_epi16(myValues, 8), _mm_srli_epi16(myValues, 8));
+		myValues = _mm_shufflelo_epi16(myValues, _MM_SHUFFLE(0, 1, 2, 3));
+		myValues = _mm_shufflehi_epi16(myValues, _MM_SHUFFLE(0, 1, 2, 3));
+		_mm_storeu_si128((__m128i *)(myDest + (8 * myIndex)), myValues);
+	}
+
+	QTSwap_Swap64Scalar(myDest + (8 * myIndex), mySource + (8 * myIndex), theCount - myIndex);
+}
+
+#endif	// USE_SSE2_KERNELS
+
+
+#if USE_AVX2_KERNELS
+
+//////////
+//
+// QTSwap_Swap16AVX2
+// Swap 16-bit values sixteen at a time, with a byte shuffle.
+//
+// The AVX2 byte shuffle works within each 16-byte half of the register, so every mask repeats itself.
+//
+//////////
+
+QTSWAP_TARGET("avx2") static void QTSwap_Swap16AVX2 (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	__m256i					myMask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+													  1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 16 <= theCount; myIndex += 16) {
+		__m256i				myValues = _mm256_loadu_si256((const __m256i *)(mySource + (2 * myIndex)));
+
+		_mm256_storeu_si256((__m256i *)(myDest + (2 * myIndex)), _mm256_shuffle_epi8(myValues, myMask));
+	}
+
+	QTSwap_Swap16Scalar(myDest + (2 * myIndex), mySource + (2 * myIndex), theCount - myIndex);
+}
+
+
+//////////
+//
+// QTSwap_Swap32AVX2
+// Swap 32-bit values eight at a time, with a byte shuffle.
+//
+//////////
+
+QTSWAP_TARGET("avx2") static void QTSwap_Swap32AVX2 (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	__m256i					myMask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+													  3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 8 <= theCount; myIndex += 8) {
+		__m256i				myValues = _mm256_loadu_si256((const __m256i *)(mySource + (4 * myIndex)));
+
+		_mm256_storeu_si256((__m256i *)(myDest + (4 * myIndex)), _mm256_shuffle_epi8(myValues, myMask));
+	}
+
+	QTSwap_Swap32Scalar(myDest + (4 * myIndex), mySource + (4 * myIndex), theCount - myIndex);
+}
+
+
+//////////
+//
+// QTSwap_Swap64AVX2
+// Swap 64-bit values four at a time, with a byte shuffle.
+//
+//////////
+
+QTSWAP_TARGET("avx2") static void QTSwap_Swap64AVX2 (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	__m256i					myMask = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+													  7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 4 <= theCount; myIndex += 4) {
+		__m256i				myValues = _mm256_loadu_si256((const __m256i *)(mySource + (8 * myIndex)));
+
+		_mm256_storeu_si256((__m256i *)(myDest + (8 * myIndex)), _mm256_shuffle_epi8(myValues, myMask));
+	}
+
+	QTSwap_Swap64Scalar(myDest + (8 * myIndex), mySource + (8 * myIndex), theCount - myIndex);
+}
+
+#endif	// USE_AVX2_KERNELS
+
+
+#if USE_NEON_KERNELS
+
+//////////
+//
+// QTSwap_Swap16NEON
+// Swap 16-bit values eight at a time, with NEON's byte-reversing instruction.
+//
+//////////
+
+static void QTSwap_Swap16NEON (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 8 <= theCount; myIndex += 8)
+		vst1q_u8(myDest + (2 * myIndex), vrev16q_u8(vld1q_u8(mySource + (2 * myIndex))));
+
+	QTSwap_Swap16Scalar(myDest + (2 * myIndex), mySource + (2 * myIndex), theCount - myIndex);
+}
+
+
+//////////
+//
+// QTSwap_Swap32NEON
+// Swap 32-bit values four at a time.
+//
+//////////
+
+static void QTSwap_Swap32NEON (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 4 <= theCount; myIndex += 4)
+		vst1q_u8(myDest + (4 * myIndex), vrev32q_u8(vld1q_u8(mySource + (4 * myIndex))));
+
+	QTSwap_Swap32Scalar(myDest + (4 * myIndex), mySource + (4 * myIndex), theCount - myIndex);
+}
+
+
+//////////
+//
+// QTSwap_Swap64NEON
+// Swap 64-bit values two at a time.
+//
+//////////
+
+static void QTSwap_Swap64NEON (void *theDest, const void *theSource, size_t theCount)
+{
+	UInt8					*myDest = (UInt8 *)theDest;
+	const UInt8				*mySource = (const UInt8 *)theSource;
+	size_t					myIndex;
+
+	for (myIndex = 0; myIndex + 2 <= theCount; myIndex += 2)
+		vst1q_u8(myDest + (8 * myIndex), vrev64q_u8(vld1q_u8(mySource + (8 * myIndex))));
+
+	QTSwap_Swap64Scalar(myDest + (8 * myIndex), mySource + (8 * myIndex), theCount - myIndex);
+}
+
+#endif	// USE_NEON_KERNELS
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Dispatch functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSwap_GetBestKernel
+// Return the fastest kernel this processor can run, looking at the processor only the first time.
+//
+// Two threads that get here together both look, and both store the same answer.
+//
+//////////
+
+long QTSwap_GetBestKernel (void)
+{
+	long					myKernel = QTSys_AtomicLoad(&gSwapBestKernel);
+
+	if (myKernel < 0) {
+		for (myKernel = kSwapKernelCount - 1; myKernel > kSwapKernelScalar; myKernel--)
+			if (QTSwap_GetKernels(myKernel) != NULL)
+				break;
+
+		QTSys_AtomicStore(&gSwapBestKernel, myKernel);
+		QTSys_Trace("byte swapping with the %s kernel", gSwapKernels[myKernel].fName);
+	}
+
+	return(myKernel);
+}
+
+
+//////////
+//
+// QTSwap_GetKernels
+// Return the specified kernel, or NULL if it isn't built into the engine or the processor can't run it.
+//
+//////////
+
+QTSwapKernelsPtr QTSwap_GetKernels (long theKernel)
+{
+	if ((theKernel < 0) || (theKernel >= kSwapKernelCount))
+		return(NULL);
+
+	if ((gSwapKernels[theKernel].fSwap16 == NULL) || !QTSwap_IsKernelSupported(theKernel))
+		return(NULL);
+
+	return(&gSwapKernels[theKernel]);
+}
+
+
+//////////
+//
+// QTSwap_IsKernelSupported
+// Can this processor (and operating system) run the specified kernel?
+//
+// AVX2 needs the operating system to save the upper halves of the vector registers too, which it tells us
+// through XGETBV; gcc's __builtin_cpu_supports checks that for us. Every 64-bit x86 processor has SSE2,
+// and every processor we'd build the NEON kernels for has NEON.
+//
+//////////
+
+static Boolean QTSwap_IsKernelSupported (long theKernel)
+{
+	switch (theKernel) {
+		case kSwapKernelScalar:
+			return(true);
+
+#if USE_SSE2_KERNELS && defined(_MSC_VER)
+		case kSwapKernelSSE2: {
+#if defined(_M_X64)
+			return(true);
+#else
+			int				myInfo[4];
+
+			__cpuid(myInfo, 1);
+			return((myInfo[3] & (1 << 26)) != 0);
+#endif
+		}
+#elif USE_SSE2_KERNELS
+		case kSwapKernelSSE2:
+			__builtin_cpu_init();
+			return(__builtin_cpu_supports("sse2") != 0);
+#endif
+
+#if USE_AVX2_KERNELS && defined(_MSC_VER)
+		case kSwapKernelAVX2: {
+			int				myInfo[4];
+
+			// OSXSAVE and AVX, then the operating system's support for the YMM registers, then AVX2 itself
+			__cpuid(myInfo, 1);
+			if ((myInfo[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+				return(false);
+			if ((_xgetbv(0) & 0x06) != 0x06)
+				return(false);
+
+			__cpuid(myInfo, 0);
+			if (myInfo[0] < 7)
+				return(false);
+
+			__cpuidex(myInfo, 7, 0);
+			return((myInfo[1] & (1 << 5)) != 0);
+		}
+#elif USE_AVX2_KERNELS
+		case kSwapKernelAVX2:
+			__builtin_cpu_init();
+			return(__builtin_cpu_supports("avx2") != 0);
+#endif
+
+#if USE_NEON_KERNELS
+		case kSwapKernelNEON:
+			return(true);
+#endif
+
+		default:
+			return(false);
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Checking functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSwap_RunCheck
+// Check every kernel the processor can run against the scalar one, and write a report to theReport.
+//
+// First we check the scalar kernel itself, against the big-endian accessors in QTAtoms.h. Then, for each
+// round of random data, we swap every 16-bit value there is, and arrays of every width and of every length
+// up to kSwapCheckMaxLength, from every misalignment of the source to every misalignment of the
+// destination and in place; each kernel must give exactly the scalar kernel's answer and leave the
+// bytes on either side of its destination alone. Lengths up to kSwapCheckMaxLength cover every way an
+// array can divide into vectors and a leftover tail, several times over.
+//
+//////////
+
+OSErr QTSwap_RunCheck (FILE *theReport, long theIterations, UInt32 theSeed)
+{
+	static const long		myWidths[] = {2, 4, 8};
+	size_t					myBufferSize = 65536 * 2;		// every 16-bit value, which is more than the other checks need
+	UInt8					*mySource = NULL;
+	UInt8					*myDest = NULL;
+	UInt8					*myExpected = NULL;
+	UInt8					*myAllValues = NULL;
+	long					myCaseCounts[kSwapKernelCount];
+	long					myFailureCounts[kSwapKernelCount];
+	long					myFailureCount = 0;
+	UInt32					myRandom = (theSeed != 0) ? theSeed : kSwapCheckDefaultSeed;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	long					myKernel;
+	long					myIteration;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theIterations <= 0)
+		theIterations = kSwapDefaultCheckIterations;
+
+	mySource = (UInt8 *)malloc(myBufferSize);
+	myDest = (UInt8 *)malloc(myBufferSize);
+	myExpected = (UInt8 *)malloc(myBufferSize);
+	myAllValues = (UInt8 *)malloc(myBufferSize);
+	if ((mySource == NULL) || (myDest == NULL) || (myExpected == NULL) || (myAllValues == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	memset(myCaseCounts, 0, sizeof(myCaseCounts));
+	memset(myFailureCounts, 0, sizeof(myFailureCounts));
+
+	for (myIteration = 0; myIteration < theIterations; myIteration++) {
+		for (myIndex = 0; myIndex < (long)myBufferSize; myIndex++)
+			mySource[myIndex] = (UInt8)(QTSwap_NextRandom(&myRandom) >> 24);
+
+		// every 16-bit value, in a different order each round
+		for (myIndex = 0; myIndex < 65536; myIndex++)
+			QTAtom_PutBE16(myAllValues + (2 * myIndex), (UInt16)(myIndex ^ (myIteration * 0x9E37)));
+
+		myFailureCounts[kSwapKernelScalar] += QTSwap_CheckReaders(mySource, myDest, &myCaseCounts[kSwapKernelScalar]);
+
+		for (myKernel = kSwapKernelScalar + 1; myKernel < kSwapKernelCount; myKernel++) {
+			QTSwapKernelsPtr	myKernels = QTSwap_GetKernels(myKernel);
+
+			if (myKernels == NULL)
+				continue;
+
+			gSwapKernels[kSwapKernelScalar].fSwap16(myExpected, myAllValues, 65536);
+			myKernels->fSwap16(myDest, myAllValues, 65536);
+			myCaseCounts[myKernel]++;
+			if (memcmp(myDest, myExpected, 65536 * 2) != 0)
+				myFailureCounts[myKernel]++;
+
+			for (myIndex = 0; myIndex < (long)(sizeof(myWidths) / sizeof(long)); myIndex++) {
+				myCaseCounts[myKernel] += (kSwapCheckMaxLength + 1) * ((kSwapCheckMaxOffset * kSwapCheckMaxOffset) + kSwapCheckMaxOffset);
+				myFailureCounts[myKernel] += QTSwap_CheckKernel(myKernels, myWidths[myIndex], mySource, myDest, myExpected);
+			}
+		}
+	}
+
+	for (myKernel = kSwapKernelScalar; myKernel < kSwapKernelCount; myKernel++)
+		myFailureCount += myFailureCounts[myKernel];
+
+	if (theReport != NULL) {
+		for (myKernel = kSwapKernelScalar; myKernel < kSwapKernelCount; myKernel++)
+			fprintf(theReport, "{\"check\":\"byteswap\",\"kernel\":\"%s\",\"available\":%s,\"cases\":%ld,\"failures\":%ld}\n",
+						gSwapKernels[myKernel].fName,
+						(QTSwap_GetKernels(myKernel) != NULL) ? "true" : "false",
+						myCaseCounts[myKernel],
+						myFailureCounts[myKernel]);
+
+		fprintf(theReport, "{\"check\":\"byteswap\",\"seed\":%lu,\"iterations\":%ld,\"selected\":\"%s\",\"failures\":%ld,\"wallMicroseconds\":%llu}\n",
+					(unsigned long)((theSeed != 0) ? theSeed : kSwapCheckDefaultSeed),
+					theIterations,
+					gSwapKernels[QTSwap_GetBestKernel()].fName,
+					myFailureCount,
+					(unsigned long long)(QTSys_GetMicroseconds() - myStartTime));
+		fflush(theReport);
+	}
+
+	if (myFailureCount > 0)
+		myErr = paramErr;
+
+bail:
+	free(mySource);
+	free(myDest);
+	free(myExpected);
+	free(myAllValues);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSwap_CheckKernel
+// Compare one kernel's swapping of theWidth-byte values with the scalar kernel's, for every length and
+// misalignment; return the number of cases that differ.
+//
+//////////
+
+static long QTSwap_CheckKernel (QTSwapKernelsPtr theKernels, long theWidth, const UInt8 *theSource, UInt8 *theDest, UInt8 *theExpected)
+{
+	QTSwapProcPtr			myScalarProc = NULL;
+	QTSwapProcPtr			myProc = NULL;
+	size_t					myAreaSize = (kSwapCheckMaxLength * 8) + (2 * kSwapCheckMaxOffset);
+	size_t					myLength;
+	size_t					mySourceOffset;
+	size_t					myDestOffset;
+	size_t					myIndex;
+	long					myFailureCount = 0;
+
+	switch (theWidth) {
+		case 2:
+			myScalarProc = gSwapKernels[kSwapKernelScalar].fSwap16;
+			myProc = theKernels->fSwap16;
+			break;
+		case 4:
+			myScalarProc = gSwapKernels[kSwapKernelScalar].fSwap32;
+			myProc = theKernels->fSwap32;
+			break;
+		default:
+			myScalarProc = gSwapKernels[kSwapKernelScalar].fSwap64;
+			myProc = theKernels->fSwap64;
+			break;
+	}
+
+	for (myLength = 0; myLength <= kSwapCheckMaxLength; myLength++) {
+		size_t				mySize = myLength * theWidth;
+
+		for (mySourceOffset = 0; mySourceOffset < kSwapCheckMaxOffset; mySourceOffset++) {
+			myScalarProc(theExpected, theSource + mySourceOffset, myLength);
+
+			// from every misalignment to every other
+			for (myDestOffset = 0; myDestOffset < kSwapCheckMaxOffset; myDestOffset++) {
+				memset(theDest, kSwapCheckGuardByte, myAreaSize);
+				myProc(theDest + myDestOffset, theSource + mySourceOffset, myLength);
+
+				if (memcmp(theDest + myDestOffset, theExpected, mySize) != 0) {
+					myFailureCount++;
+					continue;
+				}
+
+				for (myIndex = 0; myIndex < myAreaSize; myIndex++) {
+					if (((myIndex < myDestOffset) || (myIndex >= myDestOffset + mySize)) && (theDest[myIndex] != kSwapCheckGuardByte)) {
+						myFailureCount++;
+						break;
+					}
+				}
+			}
+
+			// and in place
+			memset(theDest, kSwapCheckGuardByte, myAreaSize);
+			memcpy(theDest + mySourceOffset, theSource + mySourceOffset, mySize);
+			myProc(theDest + mySourceOffset, theDest + mySourceOffset, myLength);
+			if (memcmp(theDest + mySourceOffset, theExpected, mySize) != 0)
+				myFailureCount++;
+		}
+	}
+
+	return(myFailureCount);
+}
+
+
+//////////
+//
+// QTSwap_CheckReaders
+// Check the scalar kernels, and the functions that read big-endian arrays with the best kernel, against
+// QTAtom_GetBE16, QTAtom_GetBE32 and QTAtom_GetBE64; return the number of values that differ, and add
+// the number we compared to theCaseCount.
+//
+// theSource and theDest must each hold (kSwapWidenWindow + kSwapCheckMaxLength) 64-bit values.
+//
+//////////
+
+static long QTSwap_CheckReaders (const UInt8 *theSource, UInt8 *theDest, long *theCaseCount)
+{
+	UInt16					myValue16;
+	UInt32					myValue32;
+	QTUInt64				myValue64;
+	size_t					myCount = kSwapCheckMaxLength * 2;
+	size_t					myIndex;
+	long					myFailureCount = 0;
+
+	// the scalar kernels swap on any host; they match the accessors only on a little-endian one
+	if (!QTSWAP_HOST_BIG_ENDIAN) {
+		*theCaseCount += 3 * (long)myCount;
+
+		gSwapKernels[kSwapKernelScalar].fSwap16(theDest, theSource + 1, myCount);
+		for (myIndex = 0; myIndex < myCount; myIndex++) {
+			memcpy(&myValue16, theDest + (2 * myIndex), sizeof(myValue16));
+			if (myValue16 != QTAtom_GetBE16(theSource + 1 + (2 * myIndex)))
+				myFailureCount++;
+		}
+
+		gSwapKernels[kSwapKernelScalar].fSwap32(theDest, theSource + 1, myCount);
+		for (myIndex = 0; myIndex < myCount; myIndex++) {
+			memcpy(&myValue32, theDest + (4 * myIndex), sizeof(myValue32));
+			if (myValue32 != QTAtom_GetBE32(theSource + 1 + (4 * myIndex)))
+				myFailureCount++;
+		}
+
+		gSwapKernels[kSwapKernelScalar].fSwap64(theDest, theSource + 1, myCount);
+		for (myIndex = 0; myIndex < myCount; myIndex++) {
+			memcpy(&myValue64, theDest + (8 * myIndex), sizeof(myValue64));
+			if (myValue64 != QTAtom_GetBE64(theSource + 1 + (8 * myIndex)))
+				myFailureCount++;
+		}
+	}
+
+	// the readers write aligned arrays, as the sample table code does; we check some past the widening window
+	{
+		UInt32				myValues32[kSwapCheckMaxLength];
+		QTUInt64			myValues64[kSwapWidenWindow + kSwapCheckMaxLength];
+
+		*theCaseCount += (2 * kSwapCheckMaxLength) + kSwapWidenWindow + kSwapCheckMaxLength;
+
+		QTSwap_ReadBE32(myValues32, theSource + 3, kSwapCheckMaxLength);
+		for (myIndex = 0; myIndex < kSwapCheckMaxLength; myIndex++)
+			if (myValues32[myIndex] != QTAtom_GetBE32(theSource + 3 + (4 * myIndex)))
+				myFailureCount++;
+
+		QTSwap_ReadBE64(myValues64, theSource + 3, kSwapCheckMaxLength);
+		for (myIndex = 0; myIndex < kSwapCheckMaxLength; myIndex++)
+			if (myValues64[myIndex] != QTAtom_GetBE64(theSource + 3 + (8 * myIndex)))
+				myFailureCount++;
+
+		QTSwap_ReadBE32To64(myValues64, theSource, kSwapWidenWindow + kSwapCheckMaxLength);
+		for (myIndex = 0; myIndex < kSwapWidenWindow + kSwapCheckMaxLength; myIndex++)
+			if (myValues64[myIndex] != QTAtom_GetBE32(theSource + (4 * myIndex)))
+				myFailureCount++;
+	}
+
+	return(myFailureCount);
+}
+
+
+//////////
+//
+// QTSwap_NextRandom
+// A small xorshift generator, so that the check uses the same data every time it's given the same seed.
+//
+//////////
+
+static UInt32 QTSwap_NextRandom (UInt32 *theSeed)
+{
+	UInt32					myValue = *theSeed;
+
+	myValue ^= myValue << 13;
+	myValue ^= myValue >> 17;
+	myValue ^= myValue << 5;
+
+	*theSeed = myValue;
+	return(myValue);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSwap_RunBenchmark
+// Time every kernel the processor can run, swapping tables of 16-, 32- and 64-bit values of various sizes,
+// and write a report to theReport.
+//
+// Each size swaps the same number of bytes in all: theIterations passes over the largest table, and
+// proportionally more over the smaller ones, so small tables show the cost of each call and large ones the
+// speed of memory. After timing a kernel we swap its output back with the scalar kernel and check that we
+// get the source again.
+//
+//////////
+
+OSErr QTSwap_RunBenchmark (FILE *theReport, long theIterations)
+{
+	static const long		myEntryCounts[] = {16, 256, 4096, 65536, 1024L * 1024L, kSwapMaxBenchmarkEntries};
+	static const long		myWidths[] = {2, 4, 8};
+	UInt8					*mySource = NULL;
+	UInt8					*myDest = NULL;
+	UInt32					myRandom = kSwapCheckDefaultSeed;
+	long					myWidthIndex;
+	long					mySizeIndex;
+	long					myKernel;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if (theIterations <= 0)
+		theIterations = kSwapDefaultBenchmarkIterations;
+
+	mySource = (UInt8 *)malloc(kSwapMaxBenchmarkEntries * 8);
+	myDest = (UInt8 *)malloc(kSwapMaxBenchmarkEntries * 8);
+	if ((mySource == NULL) || (myDest == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	for (myIndex = 0; myIndex < kSwapMaxBenchmarkEntries * 2; myIndex++)
+		QTAtom_PutBE32(mySource + (4 * myIndex), QTSwap_NextRandom(&myRandom));
+
+	if (theReport != NULL)
+		fprintf(theReport, "{\"benchmark\":\"byteswap\",\"selected\":\"%s\"}\n", gSwapKernels[QTSwap_GetBestKernel()].fName);
+
+	for (myWidthIndex = 0; myWidthIndex < (long)(sizeof(myWidths) / sizeof(long)); myWidthIndex++) {
+		long				myWidth = myWidths[myWidthIndex];
+
+		for (mySizeIndex = 0; mySizeIndex < (long)(sizeof(myEntryCounts) / sizeof(long)); mySizeIndex++) {
+			long			myEntryCount = myEntryCounts[mySizeIndex];
+			long			myPassCount = theIterations * (kSwapMaxBenchmarkEntries / myEntryCount);
+			QTUInt64		myScalarTime = 0;
+
+			for (myKernel = kSwapKernelScalar; myKernel < kSwapKernelCount; myKernel++) {
+				QTSwapKernelsPtr	myKernels = QTSwap_GetKernels(myKernel);
+				QTSwapProcPtr		myProc;
+				QTSwapProcPtr		myScalarProc;
+				QTUInt64			myStartTime;
+				QTUInt64			myWallTime;
+				long				myPass;
+
+				if (myKernels == NULL)
+					continue;
+
+				myProc = (myWidth == 2) ? myKernels->fSwap16 : ((myWidth == 4) ? myKernels->fSwap32 : myKernels->fSwap64);
+				myScalarProc = (myWidth == 2) ? gSwapKernels[kSwapKernelScalar].fSwap16 :
+							   ((myWidth == 4) ? gSwapKernels[kSwapKernelScalar].fSwap32 : gSwapKernels[kSwapKernelScalar].fSwap64);
+
+				myStartTime = QTSys_GetMicroseconds();
+				for (myPass = 0; myPass < myPassCount; myPass++)
+					myProc(myDest, mySource, myEntryCount);
+				myWallTime = QTSys_GetMicroseconds() - myStartTime;
+
+				if (myKernel == kSwapKernelScalar)
+					myScalarTime = myWallTime;
+
+				// swapping twice must give back what we started with
+				myScalarProc(myDest, myDest, myEntryCount);
+				if (memcmp(myDest, mySource, myEntryCount * myWidth) != 0) {
+					myErr = paramErr;
+					goto bail;
+				}
+
+				if (theReport != NULL)
+					fprintf(theReport, "{\"benchmark\":\"byteswap\",\"kernel\":\"%s\",\"bits\":%ld,\"entries\":%ld,\"passes\":%ld,\"wallMicroseconds\":%llu,\"megabytesPerSecond\":%.1f,\"speedup\":%.2f}\n",
+								myKernels->fName,
+								myWidth * 8,
+								myEntryCount,
+								myPassCount,
+								(unsigned long long)myWallTime,
+								((double)myPassCount * (double)myEntryCount * (double)myWidth) / (double)((myWallTime > 0) ? myWallTime : 1),
+								(double)myScalarTime / (double)((myWallTime > 0) ? myWallTime : 1));
+			}
+		}
+	}
+
+	if (theReport != NULL)
+		fflush(theReport);
+
+bail:
+	free(mySource);
+	free(myDest);
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSwap_IsSwapCommandLine
+// Does the command line ask us to check or time the byte-swapping kernels?
+//
+//////////
+
+Boolean QTSwap_IsSwapCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if ((strcmp(theArgv[myIndex], kSwapBenchmarkSwitch) == 0) || (strcmp(theArgv[myIndex], kSwapCheckSwitch) == 0))
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTSwap_Main
+// Check or time the byte-swapping kernels. Returns one of the kSwapExit constants.
+//
+// Usage: -swapcheck [-iterations <count>] [-seed <number>] [-report <file>]
+//        -swapbench [-iterations <count>] [-report <file>]
+//
+//////////
+
+int QTSwap_Main (int theArgc, char *theArgv[])
+{
+	const char				*myMode = NULL;
+	const char				*myReportPath = NULL;
+	long					myIterations = 0;
+	UInt32					mySeed = 0;
+	FILE					*myReport = stdout;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kSwapBenchmarkSwitch) == 0) || (strcmp(theArgv[myIndex], kSwapCheckSwitch) == 0)) {
+			if (myMode == NULL)
+				myMode = theArgv[myIndex];
+		} else if ((strcmp(theArgv[myIndex], kSwapIterationsSwitch) == 0) && (myIndex + 1 < theArgc))
+			myIterations = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kSwapSeedSwitch) == 0) && (myIndex + 1 < theArgc))
+			mySeed = (UInt32)strtoul(theArgv[++myIndex], NULL, 0);
+		else if ((strcmp(theArgv[myIndex], kSwapReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if ((myMode == NULL) || (myIterations < 0)) {
+		fprintf(stderr, "usage: %s %s [%s <count>] [%s <number>] [%s <file>]\n", theArgv[0], kSwapCheckSwitch, kSwapIterationsSwitch, kSwapSeedSwitch, kSwapReportSwitch);
+		fprintf(stderr, "       %s %s [%s <count>] [%s <file>]\n", theArgv[0], kSwapBenchmarkSwitch, kSwapIterationsSwitch, kSwapReportSwitch);
+		return(kSwapExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kSwapExitUsage);
+		}
+	}
+
+	if (strcmp(myMode, kSwapCheckSwitch) == 0) {
+		myErr = QTSwap_RunCheck(myReport, myIterations, mySeed);
+		if (myErr != noErr)
+			fprintf(stderr, "byte swap check failed (error %d)\n", (int)myErr);
+	} else {
+		myErr = QTSwap_RunBenchmark(myReport, myIterations);
+		if (myErr != noErr)
+			fprintf(stderr, "byte swap benchmark failed (error %d)\n", (int)myErr);
+	}
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kSwapExitSuccess : kSwapExitFailed);
+}
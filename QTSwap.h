@@ -0,0 +1,110 @@
+//////////
+//
+//	File:		QTSwap.h
+//
+//	Contains:	Portable functions for byte-swapping whole arrays of 16-, 32- and 64-bit values, using the
+//				widest vector instructions the processor has.
+//				All utilities start with the prefix "QTSwap_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTSwap__
+#define __QTSwap__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSystem.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+// is the host big-endian? Windows and our Linux tier run on little-endian x86 and ARM, but the engine files
+// still build on big-endian Macs
+#if defined(TARGET_RT_BIG_ENDIAN)
+#define QTSWAP_HOST_BIG_ENDIAN				TARGET_RT_BIG_ENDIAN
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+#define QTSWAP_HOST_BIG_ENDIAN				(__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#else
+#define QTSWAP_HOST_BIG_ENDIAN				0
+#endif
+
+#define kSwapBenchmarkSwitch				"-swapbench"			// command-line switch that selects the byte-swapping benchmark
+#define kSwapCheckSwitch					"-swapcheck"			// command-line switch that checks every kernel against the scalar one
+#define kSwapIterationsSwitch				"-iterations"			// passes over the largest table (benchmark) or rounds of random data (check)
+#define kSwapSeedSwitch						"-seed"					// first value of the check's random number generator
+#define kSwapReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kSwapDefaultBenchmarkIterations		8
+#define kSwapDefaultCheckIterations			4
+#define kSwapMaxBenchmarkEntries			(4L * 1024L * 1024L)	// entries in the largest table the benchmark swaps
+
+// the kernels, from slowest to fastest; a kernel that isn't built into this copy of the engine is never available
+enum {
+	kSwapKernelScalar						= 0,
+	kSwapKernelSSE2							= 1,
+	kSwapKernelAVX2							= 2,
+	kSwapKernelNEON							= 3,
+	kSwapKernelCount						= 4
+};
+
+// exit codes returned by QTSwap_Main
+enum {
+	kSwapExitSuccess						= 0,
+	kSwapExitFailed							= 1,
+	kSwapExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a kernel swaps the bytes of theCount values from theSource into theDest; the two may be the same array,
+// but must not otherwise overlap, and neither needs to be aligned
+typedef void (*QTSwapProcPtr) (void *theDest, const void *theSource, size_t theCount);
+
+typedef struct QTSwapKernelsRecord {
+	const char				*fName;
+	QTSwapProcPtr			fSwap16;
+	QTSwapProcPtr			fSwap32;
+	QTSwapProcPtr			fSwap64;
+} QTSwapKernelsRecord, *QTSwapKernelsPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+void						QTSwap_Swap16 (void *theDest, const void *theSource, size_t theCount);
+void						QTSwap_Swap32 (void *theDest, const void *theSource, size_t theCount);
+void						QTSwap_Swap64 (void *theDest, const void *theSource, size_t theCount);
+
+void						QTSwap_ReadBE32 (UInt32 *theDest, const UInt8 *theSource, size_t theCount);
+void						QTSwap_ReadBE64 (QTUInt64 *theDest, const UInt8 *theSource, size_t theCount);
+void						QTSwap_ReadBE32To64 (QTUInt64 *theDest, const UInt8 *theSource, size_t theCount);
+
+long						QTSwap_GetBestKernel (void);
+QTSwapKernelsPtr			QTSwap_GetKernels (long theKernel);
+
+OSErr						QTSwap_RunBenchmark (FILE *theReport, long theIterations);
+OSErr						QTSwap_RunCheck (FILE *theReport, long theIterations, UInt32 theSeed);
+
+Boolean						QTSwap_IsSwapCommandLine (int theArgc, char *theArgv[]);
+int							QTSwap_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTSwap__
@@ -0,0 +1,1939 @@
+//////////
+//
+//	File:		QTSystem.c
+//
+//	Contains:	Portable system services for the QTDataEx engine files.
+//				All utilities start with the prefix "QTSys_".
+//
+//	Everything in this file uses Win32 calls on Windows and POSIX calls elsewhere; nothing here
+//	touches QuickTime, so the engine files built on top of it can run without QuickTime installed.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+// clock_gettime, st_mtim and realpath are POSIX and X/Open, not C99; ask for them before any system
+// header is included, so the engine builds with -std=c99 as well as with the GNU dialects
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE				700
+#endif
+
+#include "QTSystem.h"
+
+#include <stdarg.h>
+
+#if defined(_WIN32)
+// we use the Windows Vista condition variables
+#if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0600)
+#undef _WIN32_WINNT
+#define _WIN32_WINNT				0x0600
+#endif
+#ifndef _WINDOWS_
+#include <windows.h>
+#endif
+#include <process.h>
+#if QTSYS_HAS_ALLOC_HOOK
+#include <crtdbg.h>
+#endif
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kQTSysCopyBufferSize		(1024L * 1024L)				// size of the buffer used by QTSys_CopyFile
+#define kQTSysTraceUnknown			0							// states of the trace stream
+#define kQTSysTraceOpening			1
+#define kQTSysTraceOff				2
+#define kQTSysTraceOn				3
+
+#define kQTSysMaxIOVecs				64							// pieces per writev call; POSIX promises at least 16
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static volatile long		gQTSysTraceState = kQTSysTraceUnknown;
+static FILE					*gQTSysTraceStream = NULL;
+
+static volatile long		gQTSysCountingAllocations = 0;			// between QTSys_StartAllocationCount and QTSys_StopAllocationCount?
+static volatile long		gQTSysAllocationCount = 0;
+#if QTSYS_HAS_ALLOC_HOOK
+static _CRT_ALLOC_HOOK		gQTSysSavedAllocHook = NULL;
+#endif
+
+
+//////////
+//
+// data types
+//
+//////////
+
+struct QTSysMutexRecord {
+#if defined(_WIN32)
+	CRITICAL_SECTION		fSection;
+#else
+	pthread_mutex_t			fMutex;
+#endif
+};
+
+struct QTSysConditionRecord {
+#if defined(_WIN32)
+	CONDITION_VARIABLE		fCondition;
+#else
+	pthread_cond_t			fCondition;
+#endif
+};
+
+struct QTSysThreadRecord {
+#if defined(_WIN32)
+	HANDLE					fHandle;
+#else
+	pthread_t				fThread;
+#endif
+	QTSysThreadProcPtr		fProc;
+	void					*fRefCon;
+};
+
+struct QTSysDirectoryRecord {
+#if defined(_WIN32)
+	HANDLE					fFind;
+	WIN32_FIND_DATAA		fData;
+	Boolean					fHasData;				// fData holds an entry we haven't returned yet
+#else
+	DIR						*fDirectory;
+#endif
+};
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Time functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSys_GetMicroseconds
+// Return a monotonic time stamp, in microseconds. Only differences between two values are meaningful.
+//
+//////////
+
+QTUInt64 QTSys_GetMicroseconds (void)
+{
+#if defined(_WIN32)
+	static LARGE_INTEGER	myFrequency = {0};
+	LARGE_INTEGER			myCounter;
+
+	if (myFrequency.QuadPart == 0)
+		QueryPerformanceFrequency(&myFrequency);
+
+	QueryPerformanceCounter(&myCounter);
+
+	return((QTUInt64)((myCounter.QuadPart / myFrequency.QuadPart) * 1000000 +
+					  ((myCounter.QuadPart % myFrequency.QuadPart) * 1000000) / myFrequency.QuadPart));
+#else
+	struct timespec			myTime;
+
+	clock_gettime(CLOCK_MONOTONIC, &myTime);
+
+	return((QTUInt64)myTime.tv_sec * 1000000 + (QTUInt64)(myTime.tv_nsec / 1000));
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Trace functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSys_IsTracing
+// Is tracing turned on? It is if the environment variable QTDATAEX_TRACE names a file we can append to.
+//
+// The first call opens the trace file; while it does that, other threads see tracing as turned off.
+//
+//////////
+
+Boolean QTSys_IsTracing (void)
+{
+	const char		*myPath;
+	long			myState = QTSys_AtomicLoad(&gQTSysTraceState);
+
+	if (myState != kQTSysTraceUnknown)
+		return(myState == kQTSysTraceOn);
+
+	if (!QTSys_AtomicCompareAndSwap(&gQTSysTraceState, kQTSysTraceUnknown, kQTSysTraceOpening))
+		return(false);
+
+	myPath = getenv(kQTSysTraceVariable);
+	if ((myPath != NULL) && (myPath[0] != '\0'))
+		gQTSysTraceStream = (strcmp(myPath, "-") == 0) ? stderr : fopen(myPath, "a");
+
+	QTSys_AtomicStore(&gQTSysTraceState, (gQTSysTraceStream != NULL) ? kQTSysTraceOn : kQTSysTraceOff);
+
+	return(gQTSysTraceStream != NULL);
+}
+
+
+//////////
+//
+// QTSys_Trace
+// Write one line to the trace file, if tracing is turned on; we add the newline.
+//
+// By convention, each line is a JSON object with a "trace" field naming the subsystem.
+//
+//////////
+
+void QTSys_Trace (const char *theFormat, ...)
+{
+	va_list		myArgs;
+
+	if (!QTSys_IsTracing())
+		return;
+
+	va_start(myArgs, theFormat);
+	vfprintf(gQTSysTraceStream, theFormat, myArgs);
+	va_end(myArgs);
+
+	fputc('\n', gQTSysTraceStream);
+	fflush(gQTSysTraceStream);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSys_ErrorFromSystem
+// Map the last system error onto the closest File Manager error.
+//
+//////////
+
+static OSErr QTSys_ErrorFromSystem (void)
+{
+#if defined(_WIN32)
+	switch (GetLastError()) {
+		case ERROR_FILE_NOT_FOUND:		return(fnfErr);
+		case ERROR_PATH_NOT_FOUND:		return(dirNFErr);
+		case ERROR_FILE_EXISTS:
+		case ERROR_ALREADY_EXISTS:		return(dupFNErr);
+		case ERROR_NOT_ENOUGH_MEMORY:
+		case ERROR_OUTOFMEMORY:			return(memFullErr);
+		case ERROR_INVALID_PARAMETER:	return(paramErr);
+		default:						return(ioErr);
+	}
+#else
+	switch (errno) {
+		case ENOENT:					return(fnfErr);
+		case ENOTDIR:					return(dirNFErr);
+		case EEXIST:					return(dupFNErr);
+		case ENOMEM:					return(memFullErr);
+		case EINVAL:					return(paramErr);
+		default:						return(ioErr);
+	}
+#endif
+}
+
+
+//////////
+//
+// QTSys_OpenFile
+// Open the file at the specified path, either read-only or for writing (creating or truncating it).
+//
+//////////
+
+OSErr QTSys_OpenFile (const char *thePath, long theMode, QTSysFile *theFile)
+{
+#if defined(_WIN32)
+	HANDLE		myHandle;
+
+	if ((thePath == NULL) || (theFile == NULL))
+		return(paramErr);
+
+	if (theMode == kQTSysOpenWrite)
+		myHandle = CreateFileA(thePath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	else if (theMode == kQTSysOpenUpdate)
+		myHandle = CreateFileA(thePath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	else
+		myHandle = CreateFileA(thePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (myHandle == INVALID_HANDLE_VALUE) {
+		*theFile = kQTSysInvalidFile;
+		return(QTSys_ErrorFromSystem());
+	}
+
+	*theFile = (QTSysFile)myHandle;
+	return(noErr);
+#else
+	int			myDescriptor;
+
+	if ((thePath == NULL) || (theFile == NULL))
+		return(paramErr);
+
+	if (theMode == kQTSysOpenWrite)
+		myDescriptor = open(thePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	else if (theMode == kQTSysOpenUpdate)
+		myDescriptor = open(thePath, O_RDWR);
+	else
+		myDescriptor = open(thePath, O_RDONLY);
+
+	if (myDescriptor < 0) {
+		*theFile = kQTSysInvalidFile;
+		return(QTSys_ErrorFromSystem());
+	}
+
+	// store the descriptor biased by one, so that descriptor 0 is not mistaken for kQTSysInvalidFile
+	*theFile = (QTSysFile)(size_t)(myDescriptor + 1);
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_ReadFile
+// Read up to theLength bytes starting at theOffset; the number of bytes actually read is returned in theRead.
+//
+//////////
+
+OSErr QTSys_ReadFile (QTSysFile theFile, QTUInt64 theOffset, void *theBuffer, UInt32 theLength, UInt32 *theRead)
+{
+#if defined(_WIN32)
+	OVERLAPPED	myOverlapped;
+	DWORD		myCount = 0;
+
+	memset(&myOverlapped, 0, sizeof(myOverlapped));
+	myOverlapped.Offset = (DWORD)(theOffset & 0xFFFFFFFF);
+	myOverlapped.OffsetHigh = (DWORD)(theOffset >> 32);
+
+	if (!ReadFile((HANDLE)theFile, theBuffer, theLength, &myCount, &myOverlapped))
+		if (GetLastError() != ERROR_HANDLE_EOF)
+			return(QTSys_ErrorFromSystem());
+
+	if (theRead != NULL)
+		*theRead = (UInt32)myCount;
+
+	return(noErr);
+#else
+	int			myDescriptor = (int)(size_t)theFile - 1;
+	UInt32		myTotal = 0;
+	ssize_t		myCount;
+
+	while (myTotal < theLength) {
+		myCount = pread(myDescriptor, (char *)theBuffer + myTotal, theLength - myTotal, (off_t)(theOffset + myTotal));
+		if (myCount < 0) {
+			if (errno == EINTR)
+				continue;
+			return(QTSys_ErrorFromSystem());
+		}
+
+		if (myCount == 0)
+			break;
+
+		myTotal += (UInt32)myCount;
+	}
+
+	if (theRead != NULL)
+		*theRead = myTotal;
+
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_WriteFile
+// Write the specified bytes at the current position of the file.
+//
+//////////
+
+OSErr QTSys_WriteFile (QTSysFile theFile, const void *theBuffer, UInt32 theLength)
+{
+#if defined(_WIN32)
+	DWORD		myCount = 0;
+
+	if (!WriteFile((HANDLE)theFile, theBuffer, theLength, &myCount, NULL) || (myCount != theLength))
+		return(QTSys_ErrorFromSystem());
+
+	return(noErr);
+#else
+	int			myDescriptor = (int)(size_t)theFile - 1;
+	UInt32		myTotal = 0;
+	ssize_t		myCount;
+
+	while (myTotal < theLength) {
+		myCount = write(myDescriptor, (const char *)theBuffer + myTotal, theLength - myTotal);
+		if (myCount < 0) {
+			if (errno == EINTR)
+				continue;
+			return(QTSys_ErrorFromSystem());
+		}
+
+		myTotal += (UInt32)myCount;
+	}
+
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_WriteFileVector
+// Write theCount pieces of data, one after the other, at the current position of the file.
+//
+// On POSIX systems this is a gathered write (writev), so a file made of a header and a body goes out in
+// one system call without first being copied into one buffer. Windows has WriteFileGather, but only for
+// unbuffered, page-aligned I/O, so there we copy the pieces into one buffer and write that; only if we
+// can't get the memory do we write the pieces in turn.
+//
+//////////
+
+OSErr QTSys_WriteFileVector (QTSysFile theFile, const QTSysIOVecRecord *theVector, long theCount)
+{
+#if defined(_WIN32)
+	char			*myBuffer = NULL;
+	QTUInt64		myTotal = 0;
+	UInt32			myOffset = 0;
+	long			myIndex;
+	OSErr			myErr = noErr;
+
+	if (theCount == 1)
+		return(QTSys_WriteFile(theFile, theVector[0].fData, theVector[0].fLength));
+
+	for (myIndex = 0; myIndex < theCount; myIndex++)
+		myTotal += theVector[myIndex].fLength;
+
+	if ((myTotal > 0) && (myTotal <= 0xFFFFFFFF))
+		myBuffer = (char *)malloc((size_t)myTotal);
+
+	if (myBuffer != NULL) {
+		for (myIndex = 0; myIndex < theCount; myIndex++) {
+			memcpy(myBuffer + myOffset, theVector[myIndex].fData, theVector[myIndex].fLength);
+			myOffset += theVector[myIndex].fLength;
+		}
+
+		myErr = QTSys_WriteFile(theFile, myBuffer, myOffset);
+		free(myBuffer);
+		return(myErr);
+	}
+
+	for (myIndex = 0; (myIndex < theCount) && (myErr == noErr); myIndex++)
+		if (theVector[myIndex].fLength > 0)
+			myErr = QTSys_WriteFile(theFile, theVector[myIndex].fData, theVector[myIndex].fLength);
+
+	return(myErr);
+#else
+	int				myDescriptor = (int)(size_t)theFile - 1;
+	struct iovec	myVecs[kQTSysMaxIOVecs];
+	long			myIndex = 0;
+	UInt32			myDone = 0;				// bytes of theVector[myIndex] already written
+	ssize_t			myCount;
+	int				myVecCount;
+
+	while (myIndex < theCount) {
+		// gather as many of the remaining pieces as one call takes
+		for (myVecCount = 0; (myVecCount < kQTSysMaxIOVecs) && (myIndex + myVecCount < theCount); myVecCount++) {
+			const QTSysIOVecRecord	*myPiece = &theVector[myIndex + myVecCount];
+			UInt32					mySkip = (myVecCount == 0) ? myDone : 0;
+
+			myVecs[myVecCount].iov_base = (char *)myPiece->fData + mySkip;
+			myVecs[myVecCount].iov_len = myPiece->fLength - mySkip;
+		}
+
+		myCount = writev(myDescriptor, myVecs, myVecCount);
+		if (myCount < 0) {
+			if (errno == EINTR)
+				continue;
+			return(QTSys_ErrorFromSystem());
+		}
+
+		// step over the pieces that went out completely; a short write leaves us partway into one
+		while ((myIndex < theCount) && ((UInt32)myCount >= theVector[myIndex].fLength - myDone)) {
+			myCount -= (ssize_t)(theVector[myIndex].fLength - myDone);
+			myDone = 0;
+			myIndex++;
+		}
+
+		if (myIndex < theCount)
+			myDone += (UInt32)myCount;
+	}
+
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_WriteFileAt
+// Write data at the specified offset of a file, without moving its current position.
+//
+//////////
+
+OSErr QTSys_WriteFileAt (QTSysFile theFile, QTUInt64 theOffset, const void *theBuffer, UInt32 theLength)
+{
+#if defined(_WIN32)
+	OVERLAPPED	myOverlapped;
+	DWORD		myCount = 0;
+
+	memset(&myOverlapped, 0, sizeof(myOverlapped));
+	myOverlapped.Offset = (DWORD)(theOffset & 0xFFFFFFFF);
+	myOverlapped.OffsetHigh = (DWORD)(theOffset >> 32);
+
+	if (!WriteFile((HANDLE)theFile, theBuffer, theLength, &myCount, &myOverlapped) || (myCount != theLength))
+		return(QTSys_ErrorFromSystem());
+
+	return(noErr);
+#else
+	int			myDescriptor = (int)(size_t)theFile - 1;
+	UInt32		myTotal = 0;
+	ssize_t		myCount;
+
+	while (myTotal < theLength) {
+		myCount = pwrite(myDescriptor, (const char *)theBuffer + myTotal, theLength - myTotal, (off_t)(theOffset + myTotal));
+		if (myCount < 0) {
+			if (errno == EINTR)
+				continue;
+			return(QTSys_ErrorFromSystem());
+		}
+
+		myTotal += (UInt32)myCount;
+	}
+
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_FlushFile
+// Make sure that everything written to the file so far is on the disk.
+//
+//////////
+
+OSErr QTSys_FlushFile (QTSysFile theFile)
+{
+#if defined(_WIN32)
+	if (!FlushFileBuffers((HANDLE)theFile))
+		return(QTSys_ErrorFromSystem());
+#else
+	if (fsync((int)(size_t)theFile - 1) != 0)
+		return(QTSys_ErrorFromSystem());
+#endif
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSys_GetFileSize
+// Get the size, in bytes, of an open file.
+//
+//////////
+
+OSErr QTSys_GetFileSize (QTSysFile theFile, QTUInt64 *theSize)
+{
+#if defined(_WIN32)
+	LARGE_INTEGER	mySize;
+
+	if (!GetFileSizeEx((HANDLE)theFile, &mySize))
+		return(QTSys_ErrorFromSystem());
+
+	*theSize = (QTUInt64)mySize.QuadPart;
+	return(noErr);
+#else
+	struct stat		myStat;
+
+	if (fstat((int)(size_t)theFile - 1, &myStat) != 0)
+		return(QTSys_ErrorFromSystem());
+
+	*theSize = (QTUInt64)myStat.st_size;
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_SetFileSize
+// Make an open file theSize bytes long; if it grows, the new bytes read as zeros.
+//
+//////////
+
+OSErr QTSys_SetFileSize (QTSysFile theFile, QTUInt64 theSize)
+{
+#if defined(_WIN32)
+	FILE_END_OF_FILE_INFO	myInfo;
+
+	myInfo.EndOfFile.QuadPart = (LONGLONG)theSize;
+	if (!SetFileInformationByHandle((HANDLE)theFile, FileEndOfFileInfo, &myInfo, sizeof(myInfo)))
+		return(QTSys_ErrorFromSystem());
+
+	return(noErr);
+#else
+	if (ftruncate((int)(size_t)theFile - 1, (off_t)theSize) != 0)
+		return(QTSys_ErrorFromSystem());
+
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_CloseFile
+// Close a file opened by QTSys_OpenFile.
+//
+//////////
+
+void QTSys_CloseFile (QTSysFile theFile)
+{
+	if (theFile == kQTSysInvalidFile)
+		return;
+
+#if defined(_WIN32)
+	CloseHandle((HANDLE)theFile);
+#else
+	close((int)(size_t)theFile - 1);
+#endif
+}
+
+
+//////////
+//
+// QTSys_FileExists
+// Is there a file or directory at the specified path?
+//
+//////////
+
+Boolean QTSys_FileExists (const char *thePath)
+{
+#if defined(_WIN32)
+	return(GetFileAttributesA(thePath) != INVALID_FILE_ATTRIBUTES);
+#else
+	struct stat		myStat;
+
+	return(stat(thePath, &myStat) == 0);
+#endif
+}
+
+
+//////////
+//
+// QTSys_GetPathSize
+// Get the size, in bytes, of the file at the specified path.
+//
+//////////
+
+OSErr QTSys_GetPathSize (const char *thePath, QTUInt64 *theSize)
+{
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA	myData;
+
+	if (!GetFileAttributesExA(thePath, GetFileExInfoStandard, &myData))
+		return(QTSys_ErrorFromSystem());
+
+	*theSize = ((QTUInt64)myData.nFileSizeHigh << 32) | (QTUInt64)myData.nFileSizeLow;
+	return(noErr);
+#else
+	struct stat		myStat;
+
+	if (stat(thePath, &myStat) != 0)
+		return(QTSys_ErrorFromSystem());
+
+	*theSize = (QTUInt64)myStat.st_size;
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_GetPathModificationTime
+// Get the time the file at the specified path was last modified.
+//
+// The time is in units of 100 nanoseconds, from an epoch that depends on the platform; it's good only
+// for comparing with other times from this function. We use the finest resolution the system offers,
+// so that a file rewritten twice within one second looks modified.
+//
+//////////
+
+OSErr QTSys_GetPathModificationTime (const char *thePath, QTUInt64 *theTime)
+{
+#if defined(_WIN32)
+	WIN32_FILE_ATTRIBUTE_DATA	myData;
+
+	if (!GetFileAttributesExA(thePath, GetFileExInfoStandard, &myData))
+		return(QTSys_ErrorFromSystem());
+
+	*theTime = ((QTUInt64)myData.ftLastWriteTime.dwHighDateTime << 32) | (QTUInt64)myData.ftLastWriteTime.dwLowDateTime;
+	return(noErr);
+#else
+	struct stat		myStat;
+
+	if (stat(thePath, &myStat) != 0)
+		return(QTSys_ErrorFromSystem());
+
+#if defined(__APPLE__)
+	*theTime = (QTUInt64)myStat.st_mtimespec.tv_sec * 10000000 + (QTUInt64)myStat.st_mtimespec.tv_nsec / 100;
+#else
+	*theTime = (QTUInt64)myStat.st_mtim.tv_sec * 10000000 + (QTUInt64)myStat.st_mtim.tv_nsec / 100;
+#endif
+	return(noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_DeletePath
+// Delete the file at the specified path; it is not an error if there is no such file.
+//
+//////////
+
+OSErr QTSys_DeletePath (const char *thePath)
+{
+#if defined(_WIN32)
+	if (!DeleteFileA(thePath))
+		if (GetLastError() != ERROR_FILE_NOT_FOUND)
+			return(QTSys_ErrorFromSystem());
+#else
+	if (unlink(thePath) != 0)
+		if (errno != ENOENT)
+			return(QTSys_ErrorFromSystem());
+#endif
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSys_ReplacePath
+// Rename the file at theSrcPath to theDstPath, replacing any file already there.
+//
+// The replacement is atomic: anybody opening theDstPath gets either the old file or the new one, never
+// a mixture and never nothing, even if we crash halfway.
+//
+//////////
+
+OSErr QTSys_ReplacePath (const char *theSrcPath, const char *theDstPath)
+{
+#if defined(_WIN32)
+	if (!MoveFileExA(theSrcPath, theDstPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		return(QTSys_ErrorFromSystem());
+#else
+	if (rename(theSrcPath, theDstPath) != 0)
+		return(QTSys_ErrorFromSystem());
+#endif
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSys_CopyFile
+// Copy the data of one file into a new file, overwriting any existing file at the destination.
+//
+//////////
+
+OSErr QTSys_CopyFile (const char *theSrcPath, const char *theDstPath, QTUInt64 *theBytesWritten)
+{
+	QTSysFile	mySrcFile = kQTSysInvalidFile;
+	QTSysFile	myDstFile = kQTSysInvalidFile;
+	char		*myBuffer = NULL;
+	QTUInt64	myOffset = 0;
+	UInt32		myCount = 0;
+	OSErr		myErr = noErr;
+
+	myBuffer = (char *)malloc(kQTSysCopyBufferSize);
+	if (myBuffer == NULL) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myErr = QTSys_OpenFile(theSrcPath, kQTSysOpenRead, &mySrcFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myErr = QTSys_OpenFile(theDstPath, kQTSysOpenWrite, &myDstFile);
+	if (myErr != noErr)
+		goto bail;
+
+	do {
+		myErr = QTSys_ReadFile(mySrcFile, myOffset, myBuffer, kQTSysCopyBufferSize, &myCount);
+		if ((myErr == noErr) && (myCount > 0))
+			myErr = QTSys_WriteFile(myDstFile, myBuffer, myCount);
+
+		myOffset += myCount;
+	} while ((myErr == noErr) && (myCount == kQTSysCopyBufferSize));
+
+bail:
+	if (theBytesWritten != NULL)
+		*theBytesWritten = myOffset;
+
+	QTSys_CloseFile(mySrcFile);
+	QTSys_CloseFile(myDstFile);
+	free(myBuffer);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTSys_MapFile
+// Map the whole file at the specified path into memory, read-only.
+//
+// The mapping doesn't depend on the file staying open, so we close it right away; the caller just keeps
+// theMapping and passes it to QTSys_UnmapFile when done. Empty files can't be mapped (we return eofErr),
+// and some file systems (network shares, pipes) can't be mapped at all; callers should be prepared to
+// fall back to QTSys_ReadFile whenever this fails with anything other than fnfErr.
+//
+//////////
+
+OSErr QTSys_MapFile (const char *thePath, QTSysMappedFilePtr theMapping)
+{
+#if defined(_WIN32)
+	HANDLE			myFile = INVALID_HANDLE_VALUE;
+	HANDLE			myMapping = NULL;
+	LARGE_INTEGER	mySize;
+	void			*myData = NULL;
+	OSErr			myErr = noErr;
+
+	if ((thePath == NULL) || (theMapping == NULL))
+		return(paramErr);
+
+	theMapping->fData = NULL;
+	theMapping->fSize = 0;
+
+	myFile = CreateFileA(thePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (myFile == INVALID_HANDLE_VALUE) {
+		myErr = QTSys_ErrorFromSystem();
+		goto bail;
+	}
+
+	if (!GetFileSizeEx(myFile, &mySize)) {
+		myErr = QTSys_ErrorFromSystem();
+		goto bail;
+	}
+
+	if (mySize.QuadPart == 0) {
+		myErr = eofErr;
+		goto bail;
+	}
+
+	// a 32-bit process can't map more than its address space
+	if ((QTUInt64)mySize.QuadPart > (QTUInt64)(size_t)-1) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myMapping = CreateFileMappingA(myFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (myMapping == NULL) {
+		myErr = QTSys_ErrorFromSystem();
+		goto bail;
+	}
+
+	myData = MapViewOfFile(myMapping, FILE_MAP_READ, 0, 0, 0);
+	if (myData == NULL) {
+		myErr = QTSys_ErrorFromSystem();
+		goto bail;
+	}
+
+	theMapping->fData = myData;
+	theMapping->fSize = (QTUInt64)mySize.QuadPart;
+
+bail:
+	// the view keeps the mapping object alive
+	if (myMapping != NULL)
+		CloseHandle(myMapping);
+	if (myFile != INVALID_HANDLE_VALUE)
+		CloseHandle(myFile);
+
+	return(myErr);
+#else
+	struct stat		myStat;
+	void			*myData;
+	int				myDescriptor;
+	OSErr			myErr = noErr;
+
+	if ((thePath == NULL) || (theMapping == NULL))
+		return(paramErr);
+
+	theMapping->fData = NULL;
+	theMapping->fSize = 0;
+
+	myDescriptor = open(thePath, O_RDONLY);
+	if (myDescriptor < 0)
+		return(QTSys_ErrorFromSystem());
+
+	if (fstat(myDescriptor, &myStat) != 0) {
+		myErr = QTSys_ErrorFromSystem();
+		goto bail;
+	}
+
+	if (!S_ISREG(myStat.st_mode)) {
+		myErr = unimpErr;
+		goto bail;
+	}
+
+	if (myStat.st_size == 0) {
+		myErr = eofErr;
+		goto bail;
+	}
+
+	if ((QTUInt64)myStat.st_size > (QTUInt64)(size_t)-1) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myData = mmap(NULL, (size_t)myStat.st_size, PROT_READ, MAP_PRIVATE, myDescriptor, 0);
+	if (myData == MAP_FAILED) {
+		myErr = QTSys_ErrorFromSystem();
+		goto bail;
+	}
+
+	theMapping->fData = myData;
+	theMapping->fSize = (QTUInt64)myStat.st_size;
+
+bail:
+	close(myDescriptor);
+	return(myErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_UnmapFile
+// Release a view created by QTSys_MapFile.
+//
+//////////
+
+void QTSys_UnmapFile (QTSysMappedFilePtr theMapping)
+{
+	if ((theMapping == NULL) || (theMapping->fData == NULL))
+		return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile(theMapping->fData);
+#else
+	munmap((void *)theMapping->fData, (size_t)theMapping->fSize);
+#endif
+
+	theMapping->fData = NULL;
+	theMapping->fSize = 0;
+}
+
+
+//////////
+//
+// QTSys_OpenDirectory
+// Start reading the entries of the directory at the specified path.
+//
+//////////
+
+OSErr QTSys_OpenDirectory (const char *thePath, QTSysDirectory *theDirectory)
+{
+	QTSysDirectory		myDirectory = NULL;
+	OSErr				myErr = noErr;
+
+	*theDirectory = NULL;
+
+	myDirectory = (QTSysDirectory)calloc(1, sizeof(struct QTSysDirectoryRecord));
+	if (myDirectory == NULL)
+		return(memFullErr);
+
+#if defined(_WIN32)
+	{
+		char			myPattern[kQTSysMaxPath];
+
+		myErr = QTSys_MakePath(myPattern, sizeof(myPattern), thePath, "*");
+		if (myErr == noErr) {
+			myDirectory->fFind = FindFirstFileA(myPattern, &myDirectory->fData);
+			if (myDirectory->fFind == INVALID_HANDLE_VALUE)
+				myErr = QTSys_ErrorFromSystem();
+			else
+				myDirectory->fHasData = true;
+		}
+	}
+#else
+	myDirectory->fDirectory = opendir(thePath);
+	if (myDirectory->fDirectory == NULL)
+		myErr = QTSys_ErrorFromSystem();
+#endif
+
+	if (myErr != noErr) {
+		free(myDirectory);
+		return(myErr);
+	}
+
+	*theDirectory = myDirectory;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSys_ReadDirectory
+// Get the next file or directory in a directory; eofErr means there are no more.
+//
+// We skip "." and "..", anything that is neither a file nor a directory, and links to directories
+// (reparse points, on Windows), so that a walk down a directory tree can't go round in circles.
+//
+//////////
+
+OSErr QTSys_ReadDirectory (QTSysDirectory theDirectory, QTSysDirEntryPtr theEntry)
+{
+#if defined(_WIN32)
+	WIN32_FIND_DATAA	*myData = &theDirectory->fData;
+
+	for (;;) {
+		if (!theDirectory->fHasData) {
+			if (!FindNextFileA(theDirectory->fFind, myData))
+				return((GetLastError() == ERROR_NO_MORE_FILES) ? eofErr : QTSys_ErrorFromSystem());
+		}
+
+		theDirectory->fHasData = false;
+
+		if ((strcmp(myData->cFileName, ".") == 0) || (strcmp(myData->cFileName, "..") == 0))
+			continue;
+
+		if ((myData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && (myData->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+			continue;
+
+		if (myData->dwFileAttributes & FILE_ATTRIBUTE_DEVICE)
+			continue;
+
+		theEntry->fName = myData->cFileName;
+		theEntry->fIsDirectory = (myData->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+		theEntry->fSize = ((QTUInt64)myData->nFileSizeHigh << 32) | (QTUInt64)myData->nFileSizeLow;
+		theEntry->fModificationTime = ((QTUInt64)myData->ftLastWriteTime.dwHighDateTime << 32) | (QTUInt64)myData->ftLastWriteTime.dwLowDateTime;
+		return(noErr);
+	}
+#else
+	struct dirent		*myEntry;
+	struct stat			myStat;
+
+	for (;;) {
+		errno = 0;
+		myEntry = readdir(theDirectory->fDirectory);
+		if (myEntry == NULL)
+			return((errno == 0) ? eofErr : QTSys_ErrorFromSystem());
+
+		if ((strcmp(myEntry->d_name, ".") == 0) || (strcmp(myEntry->d_name, "..") == 0))
+			continue;
+
+		// follow links to files, but not to directories
+		if (fstatat(dirfd(theDirectory->fDirectory), myEntry->d_name, &myStat, AT_SYMLINK_NOFOLLOW) != 0)
+			continue;
+
+		if (S_ISLNK(myStat.st_mode))
+			if ((fstatat(dirfd(theDirectory->fDirectory), myEntry->d_name, &myStat, 0) != 0) || S_ISDIR(myStat.st_mode))
+				continue;
+
+		if (!S_ISREG(myStat.st_mode) && !S_ISDIR(myStat.st_mode))
+			continue;
+
+		theEntry->fName = myEntry->d_name;
+		theEntry->fIsDirectory = S_ISDIR(myStat.st_mode);
+		theEntry->fSize = (QTUInt64)myStat.st_size;
+#if defined(__APPLE__)
+		theEntry->fModificationTime = (QTUInt64)myStat.st_mtimespec.tv_sec * 10000000 + (QTUInt64)myStat.st_mtimespec.tv_nsec / 100;
+#else
+		theEntry->fModificationTime = (QTUInt64)myStat.st_mtim.tv_sec * 10000000 + (QTUInt64)myStat.st_mtim.tv_nsec / 100;
+#endif
+		return(noErr);
+	}
+#endif
+}
+
+
+//////////
+//
+// QTSys_CloseDirectory
+// Finish reading a directory opened with QTSys_OpenDirectory.
+//
+//////////
+
+void QTSys_CloseDirectory (QTSysDirectory theDirectory)
+{
+	if (theDirectory == NULL)
+		return;
+
+#if defined(_WIN32)
+	FindClose(theDirectory->fFind);
+#else
+	closedir(theDirectory->fDirectory);
+#endif
+
+	free(theDirectory);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Threading functions.
+//
+// These are thin wrappers around Win32 threads and pthreads. The objects are heap-allocated, so that the
+// engine headers don't need to include <windows.h> or <pthread.h>.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSys_NewMutex
+// Create a new (non-recursive) mutex.
+//
+//////////
+
+OSErr QTSys_NewMutex (QTSysMutex *theMutex)
+{
+	QTSysMutex		myMutex = (QTSysMutex)malloc(sizeof(struct QTSysMutexRecord));
+
+	*theMutex = myMutex;
+	if (myMutex == NULL)
+		return(memFullErr);
+
+#if defined(_WIN32)
+	InitializeCriticalSection(&myMutex->fSection);
+#else
+	pthread_mutex_init(&myMutex->fMutex, NULL);
+#endif
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSys_LockMutex
+// Acquire the specified mutex, waiting if necessary.
+//
+//////////
+
+void QTSys_LockMutex (QTSysMutex theMutex)
+{
+#if defined(_WIN32)
+	EnterCriticalSection(&theMutex->fSection);
+#else
+	pthread_mutex_lock(&theMutex->fMutex);
+#endif
+}
+
+
+//////////
+//
+// QTSys_UnlockMutex
+// Release the specified mutex.
+//
+//////////
+
+void QTSys_UnlockMutex (QTSysMutex theMutex)
+{
+#if defined(_WIN32)
+	LeaveCriticalSection(&theMutex->fSection);
+#else
+	pthread_mutex_unlock(&theMutex->fMutex);
+#endif
+}
+
+
+//////////
+//
+// QTSys_DisposeMutex
+// Dispose of a mutex created by QTSys_NewMutex.
+//
+//////////
+
+void QTSys_DisposeMutex (QTSysMutex theMutex)
+{
+	if (theMutex == NULL)
+		return;
+
+#if defined(_WIN32)
+	DeleteCriticalSection(&theMutex->fSection);
+#else
+	pthread_mutex_destroy(&theMutex->fMutex);
+#endif
+
+	free(theMutex);
+}
+
+
+//////////
+//
+// QTSys_NewCondition
+// Create a new condition variable.
+//
+//////////
+
+OSErr QTSys_NewCondition (QTSysCondition *theCondition)
+{
+	QTSysCondition	myCondition = (QTSysCondition)malloc(sizeof(struct QTSysConditionRecord));
+
+	*theCondition = myCondition;
+	if (myCondition == NULL)
+		return(memFullErr);
+
+#if defined(_WIN32)
+	InitializeConditionVariable(&myCondition->fCondition);
+#else
+	pthread_cond_init(&myCondition->fCondition, NULL);
+#endif
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSys_WaitCondition
+// Atomically release theMutex and wait for theCondition to be signalled; theMutex is held again on return.
+//
+// As always with condition variables, the caller must re-check its predicate in a loop.
+//
+//////////
+
+void QTSys_WaitCondition (QTSysCondition theCondition, QTSysMutex theMutex)
+{
+#if defined(_WIN32)
+	SleepConditionVariableCS(&theCondition->fCondition, &theMutex->fSection, INFINITE);
+#else
+	pthread_cond_wait(&theCondition->fCondition, &theMutex->fMutex);
+#endif
+}
+
+
+//////////
+//
+// QTSys_SignalCondition
+// Wake one thread waiting on the specified condition.
+//
+//////////
+
+void QTSys_SignalCondition (QTSysCondition theCondition)
+{
+#if defined(_WIN32)
+	WakeConditionVariable(&theCondition->fCondition);
+#else
+	pthread_cond_signal(&theCondition->fCondition);
+#endif
+}
+
+
+//////////
+//
+// QTSys_BroadcastCondition
+// Wake all threads waiting on the specified condition.
+//
+//////////
+
+void QTSys_BroadcastCondition (QTSysCondition theCondition)
+{
+#if defined(_WIN32)
+	WakeAllConditionVariable(&theCondition->fCondition);
+#else
+	pthread_cond_broadcast(&theCondition->fCondition);
+#endif
+}
+
+
+//////////
+//
+// QTSys_DisposeCondition
+// Dispose of a condition variable created by QTSys_NewCondition.
+//
+//////////
+
+void QTSys_DisposeCondition (QTSysCondition theCondition)
+{
+	if (theCondition == NULL)
+		return;
+
+#if !defined(_WIN32)
+	pthread_cond_destroy(&theCondition->fCondition);
+#endif
+
+	free(theCondition);
+}
+
+
+//////////
+//
+// QTSys_ThreadEntry
+// The entry point of every thread created by QTSys_NewThread.
+//
+//////////
+
+#if defined(_WIN32)
+static unsigned __stdcall QTSys_ThreadEntry (void *theRefCon)
+#else
+static void *QTSys_ThreadEntry (void *theRefCon)
+#endif
+{
+	QTSysThread		myThread = (QTSysThread)theRefCon;
+
+	myThread->fProc(myThread->fRefCon);
+
+	return(0);
+}
+
+
+//////////
+//
+// QTSys_NewThread
+// Start a new thread that calls theProc(theRefCon). The thread must later be joined with QTSys_JoinThread.
+//
+//////////
+
+OSErr QTSys_NewThread (QTSysThreadProcPtr theProc, void *theRefCon, QTSysThread *theThread)
+{
+	QTSysThread		myThread = (QTSysThread)malloc(sizeof(struct QTSysThreadRecord));
+
+	*theThread = NULL;
+	if (myThread == NULL)
+		return(memFullErr);
+
+	myThread->fProc = theProc;
+	myThread->fRefCon = theRefCon;
+
+#if defined(_WIN32)
+	myThread->fHandle = (HANDLE)_beginthreadex(NULL, 0, QTSys_ThreadEntry, myThread, 0, NULL);
+	if (myThread->fHandle == 0) {
+		free(myThread);
+		return(memFullErr);
+	}
+#else
+	if (pthread_create(&myThread->fThread, NULL, QTSys_ThreadEntry, myThread) != 0) {
+		free(myThread);
+		return(memFullErr);
+	}
+#endif
+
+	*theThread = myThread;
+	return(noErr);
+}
+
+
+//////////
+//
+// QTSys_JoinThread
+// Wait for the specified thread to finish, then dispose of it.
+//
+//////////
+
+void QTSys_JoinThread (QTSysThread theThread)
+{
+	if (theThread == NULL)
+		return;
+
+#if defined(_WIN32)
+	WaitForSingleObject(theThread->fHandle, INFINITE);
+	CloseHandle(theThread->fHandle);
+#else
+	pthread_join(theThread->fThread, NULL);
+#endif
+
+	free(theThread);
+}
+
+
+//////////
+//
+// QTSys_GetProcessorCount
+// Return the number of processors available to this process.
+//
+//////////
+
+long QTSys_GetProcessorCount (void)
+{
+#if defined(_WIN32)
+	SYSTEM_INFO		myInfo;
+
+	GetSystemInfo(&myInfo);
+	return((long)myInfo.dwNumberOfProcessors);
+#else
+	long			myCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return((myCount > 0) ? myCount : 1);
+#endif
+}
+
+
+//////////
+//
+// QTSys_GetProcessID
+// Get the identifier of the current process.
+//
+//////////
+
+unsigned long QTSys_GetProcessID (void)
+{
+#if defined(_WIN32)
+	return((unsigned long)GetCurrentProcessId());
+#else
+	return((unsigned long)getpid());
+#endif
+}
+
+
+//////////
+//
+// QTSys_Sleep
+// Suspend the calling thread for the specified number of milliseconds.
+//
+//////////
+
+void QTSys_Sleep (UInt32 theMilliseconds)
+{
+#if defined(_WIN32)
+	Sleep(theMilliseconds);
+#else
+	struct timespec		myTime;
+
+	myTime.tv_sec = theMilliseconds / 1000;
+	myTime.tv_nsec = (long)(theMilliseconds % 1000) * 1000000L;
+	while ((nanosleep(&myTime, &myTime) != 0) && (errno == EINTR))
+		;
+#endif
+}
+
+
+//////////
+//
+// QTSys_AtomicAdd
+// Atomically add theDelta to *theValue; return the new value.
+//
+//////////
+
+long QTSys_AtomicAdd (volatile long *theValue, long theDelta)
+{
+#if defined(_WIN32)
+	return(InterlockedExchangeAdd(theValue, theDelta) + theDelta);
+#else
+	return(__sync_add_and_fetch(theValue, theDelta));
+#endif
+}
+
+
+//////////
+//
+// QTSys_AtomicLoad
+// Read *theValue with a full memory barrier.
+//
+//////////
+
+long QTSys_AtomicLoad (volatile long *theValue)
+{
+#if defined(_WIN32)
+	return(InterlockedCompareExchange(theValue, 0, 0));
+#else
+	return(__sync_add_and_fetch(theValue, 0));
+#endif
+}
+
+
+//////////
+//
+// QTSys_AtomicStore
+// Write *theValue with a full memory barrier on both sides, so that it also publishes any earlier writes.
+//
+// __sync_lock_test_and_set is only an acquire barrier, which lets earlier writes be seen after it; the
+// barrier before it makes the store a release too.
+//
+//////////
+
+void QTSys_AtomicStore (volatile long *theValue, long theNewValue)
+{
+#if defined(_WIN32)
+	InterlockedExchange(theValue, theNewValue);
+#else
+	__sync_synchronize();
+	__sync_lock_test_and_set(theValue, theNewValue);
+	__sync_synchronize();
+#endif
+}
+
+
+//////////
+//
+// QTSys_AtomicCompareAndSwap
+// If *theValue equals theOldValue, replace it with theNewValue; return whether the swap happened.
+//
+//////////
+
+Boolean QTSys_AtomicCompareAndSwap (volatile long *theValue, long theOldValue, long theNewValue)
+{
+#if defined(_WIN32)
+	return(InterlockedCompareExchange(theValue, theNewValue, theOldValue) == theOldValue);
+#else
+	return(__sync_bool_compare_and_swap(theValue, theOldValue, theNewValue));
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Path and string functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTSys_GetCacheDirectory
+// Get the directory where we keep caches that can be thrown away at any time.
+//
+// On Windows that's the local (non-roaming) application data folder; on Mac OS X it's ~/Library/Caches,
+// and elsewhere $XDG_CACHE_HOME or ~/.cache. We fall back to the temporary folder if all else fails.
+//
+//////////
+
+OSErr QTSys_GetCacheDirectory (char *theBuffer, size_t theBufferSize)
+{
+	const char		*myBase;
+	int				myCount = -1;
+
+#if defined(_WIN32)
+	myBase = getenv("LOCALAPPDATA");
+	if ((myBase != NULL) && (myBase[0] != '\0'))
+		myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s", myBase);
+	else if ((theBufferSize > 0) && (theBufferSize <= 0xFFFFFFFF) && (GetTempPathA((DWORD)theBufferSize, theBuffer) > 0))
+		myCount = (int)strlen(theBuffer);
+#else
+	myBase = getenv("XDG_CACHE_HOME");
+	if ((myBase != NULL) && (myBase[0] != '\0')) {
+		myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s", myBase);
+	} else {
+		myBase = getenv("HOME");
+		if ((myBase != NULL) && (myBase[0] != '\0'))
+#if defined(__APPLE__)
+			myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s/Library/Caches", myBase);
+#else
+			myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s/.cache", myBase);
+#endif
+	}
+
+	if ((myCount >= 0) && !QTSys_FileExists(theBuffer))
+		myCount = -1;
+
+	if (myCount < 0)
+		myCount = QTSys_FormatString(theBuffer, theBufferSize, "/tmp");
+#endif
+
+	return((myCount < 0) ? paramErr : noErr);
+}
+
+
+//////////
+//
+// QTSys_GetFileName
+// Return a pointer to the file name portion of the specified path.
+//
+// We accept both kinds of separators on Windows, since manifests are often written on other systems.
+//
+//////////
+
+const char *QTSys_GetFileName (const char *thePath)
+{
+	const char		*myName = thePath;
+	const char		*myChar;
+
+	for (myChar = thePath; *myChar != '\0'; myChar++)
+		if ((*myChar == '/') || (*myChar == kQTSysPathSeparator))
+			myName = myChar + 1;
+
+	return(myName);
+}
+
+
+//////////
+//
+// QTSys_GetFileExtension
+// Return a pointer to the extension (without the period) of the specified path, or to an empty string.
+//
+//////////
+
+const char *QTSys_GetFileExtension (const char *thePath)
+{
+	const char		*myName = QTSys_GetFileName(thePath);
+	const char		*myPeriod = strrchr(myName, '.');
+
+	if ((myPeriod == NULL) || (myPeriod == myName))
+		return(myName + strlen(myName));
+
+	return(myPeriod + 1);
+}
+
+
+//////////
+//
+// QTSys_MakePath
+// Join a directory and a file name into a path.
+//
+//////////
+
+OSErr QTSys_MakePath (char *theBuffer, size_t theBufferSize, const char *theDirectory, const char *theFileName)
+{
+	size_t		myLength;
+	int			myCount;
+
+	if ((theDirectory == NULL) || (*theDirectory == '\0'))
+		myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s", theFileName);
+	else {
+		myLength = strlen(theDirectory);
+		if ((theDirectory[myLength - 1] == '/') || (theDirectory[myLength - 1] == kQTSysPathSeparator))
+			myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s%s", theDirectory, theFileName);
+		else
+			myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s%c%s", theDirectory, kQTSysPathSeparator, theFileName);
+	}
+
+	return((myCount < 0) ? paramErr : noErr);
+}
+
+
+//////////
+//
+// QTSys_GetFullPath
+// Copy the full (absolute) path of the file at thePath into theBuffer.
+//
+//////////
+
+OSErr QTSys_GetFullPath (char *theBuffer, size_t theBufferSize, const char *thePath)
+{
+#if defined(_WIN32)
+	DWORD			myLength;
+
+	myLength = GetFullPathNameA(thePath, (DWORD)theBufferSize, theBuffer, NULL);
+	if (myLength == 0)
+		return(QTSys_ErrorFromSystem());
+
+	return((myLength < theBufferSize) ? noErr : paramErr);
+#else
+	char			*myPath;
+	int				myCount;
+
+	myPath = realpath(thePath, NULL);
+	if (myPath == NULL)
+		return(QTSys_ErrorFromSystem());
+
+	myCount = QTSys_FormatString(theBuffer, theBufferSize, "%s", myPath);
+	free(myPath);
+
+	return((myCount < 0) ? paramErr : noErr);
+#endif
+}
+
+
+//////////
+//
+// QTSys_ReplaceExtension
+// Copy the specified file name into theBuffer, replacing its extension (if any) with theExtension.
+//
+//////////
+
+OSErr QTSys_ReplaceExtension (char *theBuffer, size_t theBufferSize, const char *theFileName, const char *theExtension)
+{
+	const char		*myExtension = QTSys_GetFileExtension(theFileName);
+	size_t			myStemLength = (size_t)(myExtension - theFileName);
+	int				myCount;
+
+	// back up over the period, if there was an extension
+	if (*myExtension != '\0')
+		myStemLength--;
+
+	myCount = QTSys_FormatString(theBuffer, theBufferSize, "%.*s.%s", (int)myStemLength, theFileName, theExtension);
+
+	return((myCount < 0) ? paramErr : noErr);
+}
+
+
+//////////
+//
+// QTSys_CopyString
+// Return a newly allocated copy of the specified string.
+//
+// The caller is responsible for disposing of the pointer returned by this function (by calling free).
+//
+//////////
+
+char *QTSys_CopyString (const char *theString)
+{
+	size_t		myLength = strlen(theString) + 1;
+	char		*myCopy = (char *)malloc(myLength);
+
+	if (myCopy != NULL)
+		memcpy(myCopy, theString, myLength);
+
+	return(myCopy);
+}
+
+
+//////////
+//
+// QTSys_CompareStringsNoCase
+// Compare two ASCII strings, ignoring case; returns <0, 0 or >0 like strcmp.
+//
+//////////
+
+int QTSys_CompareStringsNoCase (const char *theString1, const char *theString2)
+{
+	int		myChar1;
+	int		myChar2;
+
+	do {
+		myChar1 = (unsigned char)*theString1++;
+		myChar2 = (unsigned char)*theString2++;
+
+		if ((myChar1 >= 'A') && (myChar1 <= 'Z'))
+			myChar1 += 'a' - 'A';
+		if ((myChar2 >= 'A') && (myChar2 <= 'Z'))
+			myChar2 += 'a' - 'A';
+	} while ((myChar1 == myChar2) && (myChar1 != '\0'));
+
+	return(myChar1 - myChar2);
+}
+
+
+//////////
+//
+// QTSys_FormatString
+// Like snprintf, but always terminates the output; returns -1 if the output did not fit.
+//
+//////////
+
+int QTSys_FormatString (char *theBuffer, size_t theBufferSize, const char *theFormat, ...)
+{
+	va_list		myArgs;
+	int			myCount;
+
+	if ((theBuffer == NULL) || (theBufferSize == 0))
+		return(-1);
+
+	va_start(myArgs, theFormat);
+#if defined(_MSC_VER)
+	myCount = _vsnprintf(theBuffer, theBufferSize, theFormat, myArgs);
+#else
+	myCount = vsnprintf(theBuffer, theBufferSize, theFormat, myArgs);
+#endif
+	va_end(myArgs);
+
+	theBuffer[theBufferSize - 1] = '\0';
+
+	if ((myCount < 0) || ((size_t)myCount >= theBufferSize))
+		return(-1);
+
+	return(myCount);
+}
+
+
+//////////
+//
+// QTSys_WriteJSONString
+// Write the specified C string to a stream as a quoted, escaped JSON string.
+//
+//////////
+
+void QTSys_WriteJSONString (FILE *theStream, const char *theString)
+{
+	const unsigned char		*myChar;
+
+	fputc('"', theStream);
+
+	for (myChar = (const unsigned char *)theString; (myChar != NULL) && (*myChar != '\0'); myChar++) {
+		switch (*myChar) {
+			case '"':	fputs("\\\"", theStream);	break;
+			case '\\':	fputs("\\\\", theStream);	break;
+			case '\n':	fputs("\\n", theStream);	break;
+			case '\r':	fputs("\\r", theStream);	break;
+			case '\t':	fputs("\\t", theStream);	break;
+			default:
+				if (*myChar < 0x20)
+					fprintf(theStream, "\\u%04x", *myChar);
+				else
+					fputc(*myChar, theStream);
+				break;
+		}
+	}
+
+	fputc('"', theStream);
+}
+
+
+//////////
+//
+// QTSys_TrimLine
+// Strip leading and trailing white space (including any line terminator) from a line, in place.
+//
+//////////
+
+char *QTSys_TrimLine (char *theLine)
+{
+	char		*myEnd;
+
+	while ((*theLine == ' ') || (*theLine == '\t'))
+		theLine++;
+
+	myEnd = theLine + strlen(theLine);
+	while ((myEnd > theLine) && ((myEnd[-1] == ' ') || (myEnd[-1] == '\t') || (myEnd[-1] == '\r') || (myEnd[-1] == '\n')))
+		myEnd--;
+
+	*myEnd = '\0';
+
+	return(theLine);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Allocation-counting functions.
+//
+// These let a check (such as the string check in QTEstimate.c) make sure that some code allocates no memory.
+// In a debug build with Microsoft's C run-time library, an allocation hook sees every allocation in the
+// process. Everywhere else, we see only the allocations of the files that define QTSYS_COUNT_ALLOCATIONS
+// (see QTSystem.h), whose calls to malloc, calloc and realloc go through the counted versions below.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if QTSYS_HAS_ALLOC_HOOK
+//////////
+//
+// QTSys_AllocHook
+// Count the allocations the C run-time library makes while we're counting; let them all go ahead.
+//
+// The library calls this before every allocation, reallocation and free. It must not itself call anything
+// that might allocate.
+//
+//////////
+
+static int __cdecl QTSys_AllocHook (int theType, void *theData, size_t theSize, int theBlockUse, long theRequest, const unsigned char *theFileName, int theLine)
+{
+	if ((theType == _HOOK_ALLOC) || (theType == _HOOK_REALLOC))
+		QTSys_AtomicAdd(&gQTSysAllocationCount, 1);
+
+	return(TRUE);
+}
+#endif
+
+
+//////////
+//
+// QTSys_StartAllocationCount
+// Start counting allocations. Returns true if we see every allocation, false if only the counted ones.
+//
+//////////
+
+Boolean QTSys_StartAllocationCount (void)
+{
+	QTSys_AtomicStore(&gQTSysAllocationCount, 0);
+	QTSys_AtomicStore(&gQTSysCountingAllocations, 1);
+
+#if QTSYS_HAS_ALLOC_HOOK
+	gQTSysSavedAllocHook = _CrtSetAllocHook(QTSys_AllocHook);
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+
+//////////
+//
+// QTSys_StopAllocationCount
+// Stop counting allocations; return how many there were since QTSys_StartAllocationCount.
+//
+//////////
+
+long QTSys_StopAllocationCount (void)
+{
+#if QTSYS_HAS_ALLOC_HOOK
+	_CrtSetAllocHook(gQTSysSavedAllocHook);
+#endif
+
+	QTSys_AtomicStore(&gQTSysCountingAllocations, 0);
+	return(QTSys_AtomicLoad(&gQTSysAllocationCount));
+}
+
+
+//////////
+//
+// QTSys_CountedMalloc
+// Call malloc, counting the call if we're counting allocations.
+//
+// With an allocation hook, the hook counts the call instead. The same goes for the next two functions.
+//
+//////////
+
+void *QTSys_CountedMalloc (size_t theSize)
+{
+	if (!QTSYS_HAS_ALLOC_HOOK && (gQTSysCountingAllocations != 0))
+		QTSys_AtomicAdd(&gQTSysAllocationCount, 1);
+
+	return(malloc(theSize));
+}
+
+
+//////////
+//
+// QTSys_CountedCalloc
+// Call calloc, counting the call if we're counting allocations.
+//
+//////////
+
+void *QTSys_CountedCalloc (size_t theCount, size_t theSize)
+{
+	if (!QTSYS_HAS_ALLOC_HOOK && (gQTSysCountingAllocations != 0))
+		QTSys_AtomicAdd(&gQTSysAllocationCount, 1);
+
+	return(calloc(theCount, theSize));
+}
+
+
+//////////
+//
+// QTSys_CountedRealloc
+// Call realloc, counting the call if we're counting allocations.
+//
+//////////
+
+void *QTSys_CountedRealloc (void *thePtr, size_t theSize)
+{
+	if (!QTSYS_HAS_ALLOC_HOOK && (gQTSysCountingAllocations != 0))
+		QTSys_AtomicAdd(&gQTSysAllocationCount, 1);
+
+	return(realloc(thePtr, theSize));
+}
@@ -0,0 +1,286 @@
+//////////
+//
+//	File:		QTSystem.h
+//
+//	Contains:	Portable system services for the QTDataEx engine files.
+//				All utilities start with the prefix "QTSys_".
+//
+//	The engine files (QTBatch.c and friends) must build both inside the Windows application and on
+//	our Linux preprocessing tier, where there is no QuickTime. So they include this header instead of
+//	the QuickTime headers; it pulls in MacTypes.h where that is available and otherwise supplies the
+//	handful of Mac types and error codes the engine code uses, so that the engine can keep using
+//	OSErr, noErr and friends the same way the rest of this sample does.
+//
+//////////
+
+#pragma once
+
+#ifndef __QTSystem__
+#define __QTSystem__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#if defined(_WIN32)
+#ifndef __Prefix_File__
+#include "WinPrefix.h"
+#endif
+#endif
+
+#if defined(_WIN32) || defined(__APPLE__)
+#define QTSYS_HAS_MACTYPES			1
+#else
+#define QTSYS_HAS_MACTYPES			0
+#endif
+
+#if QTSYS_HAS_MACTYPES
+#ifndef __MACTYPES__
+#include <MacTypes.h>
+#endif
+#ifndef __MACERRORS__
+#include <MacErrors.h>
+#endif
+#endif
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#if !defined(_MSC_VER)
+#include <stdint.h>
+#endif
+
+
+//////////
+//
+// data types
+//
+//////////
+
+#if defined(_MSC_VER)
+typedef unsigned __int64			QTUInt64;
+typedef __int64						QTSInt64;
+#else
+typedef uint64_t					QTUInt64;
+typedef int64_t						QTSInt64;
+#endif
+
+#if !QTSYS_HAS_MACTYPES
+// the subset of MacTypes.h and MacErrors.h that the engine files use
+typedef unsigned char				UInt8;
+typedef signed char					SInt8;
+typedef uint16_t					UInt16;
+typedef int16_t						SInt16;
+typedef uint32_t					UInt32;
+typedef int32_t						SInt32;
+typedef uint32_t					OSType;
+typedef uint32_t					FourCharCode;
+typedef int16_t						OSErr;
+typedef unsigned char				Boolean;
+typedef unsigned char				*StringPtr;
+typedef const unsigned char			*ConstStringPtr;
+typedef unsigned char				Str255[256];
+
+#ifndef true
+#define true						1
+#define false						0
+#endif
+
+#define FOUR_CHAR_CODE(x)			(x)
+
+enum {
+	noErr							= 0,
+	paramErr						= -50,
+	memFullErr						= -108,
+	fnfErr							= -43,
+	ioErr							= -36,
+	eofErr							= -39,
+	dupFNErr						= -48,
+	dirNFErr						= -120,
+	userCanceledErr					= -128,
+	unimpErr						= -4,
+	badFormat						= -206,
+	invalidMovie					= -2010,
+	badComponentType				= -2003,
+	couldNotResolveDataRef			= -2000,
+	invalidAtomErr					= -2100,
+	invalidAtomContainerErr			= -2102
+};
+#endif
+
+// platform-neutral file handle; on Windows this is a HANDLE and elsewhere a file descriptor
+typedef void *						QTSysFile;
+#define kQTSysInvalidFile			((QTSysFile)0)
+
+// a read-only view of a whole file; see QTSys_MapFile
+typedef struct QTSysMappedFileRecord {
+	const void				*fData;
+	QTUInt64				fSize;
+} QTSysMappedFileRecord, *QTSysMappedFilePtr;
+
+// one entry of a directory; see QTSys_ReadDirectory
+typedef struct QTSysDirEntryRecord {
+	const char				*fName;					// good until the next call to QTSys_ReadDirectory
+	Boolean					fIsDirectory;
+	QTUInt64				fSize;
+	QTUInt64				fModificationTime;		// as QTSys_GetPathModificationTime returns it
+} QTSysDirEntryRecord, *QTSysDirEntryPtr;
+
+// one piece of a gathered write; see QTSys_WriteFileVector
+typedef struct QTSysIOVecRecord {
+	const void				*fData;
+	UInt32					fLength;
+} QTSysIOVecRecord, *QTSysIOVecPtr;
+
+// opaque threading objects; see the threading functions in QTSystem.c
+typedef struct QTSysMutexRecord		*QTSysMutex;
+typedef struct QTSysConditionRecord	*QTSysCondition;
+typedef struct QTSysThreadRecord	*QTSysThread;
+typedef struct QTSysDirectoryRecord	*QTSysDirectory;
+
+typedef void						(*QTSysThreadProcPtr) (void *theRefCon);
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#if defined(_WIN32)
+#define kQTSysPathSeparator			'\\'
+#else
+#define kQTSysPathSeparator			'/'
+#endif
+
+#define kQTSysMaxPath				1024
+
+#define kQTSysTraceVariable			"QTDATAEX_TRACE"			// environment variable naming the trace file ("-" for stderr)
+
+enum {
+	kQTSysOpenRead					= 0,						// read-only access to an existing file
+	kQTSysOpenWrite					= 1,						// create or truncate a file for writing
+	kQTSysOpenUpdate				= 2							// read and write an existing file, keeping what's in it
+};
+
+
+//////////
+//
+// compiler macros
+//
+//////////
+
+#if defined(_MSC_VER)
+#define QTSYS_INLINE				static __inline
+#else
+#define QTSYS_INLINE				static inline
+#endif
+
+// the debug C run-time library tells an allocation hook about every allocation; see QTSys_StartAllocationCount
+#if defined(_MSC_VER) && defined(_DEBUG)
+#define QTSYS_HAS_ALLOC_HOOK		1
+#else
+#define QTSYS_HAS_ALLOC_HOOK		0
+#endif
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+QTUInt64					QTSys_GetMicroseconds (void);
+
+Boolean						QTSys_IsTracing (void);
+void						QTSys_Trace (const char *theFormat, ...);
+
+OSErr						QTSys_OpenFile (const char *thePath, long theMode, QTSysFile *theFile);
+OSErr						QTSys_ReadFile (QTSysFile theFile, QTUInt64 theOffset, void *theBuffer, UInt32 theLength, UInt32 *theRead);
+OSErr						QTSys_WriteFile (QTSysFile theFile, const void *theBuffer, UInt32 theLength);
+OSErr						QTSys_WriteFileVector (QTSysFile theFile, const QTSysIOVecRecord *theVector, long theCount);
+OSErr						QTSys_WriteFileAt (QTSysFile theFile, QTUInt64 theOffset, const void *theBuffer, UInt32 theLength);
+OSErr						QTSys_FlushFile (QTSysFile theFile);
+OSErr						QTSys_GetFileSize (QTSysFile theFile, QTUInt64 *theSize);
+OSErr						QTSys_SetFileSize (QTSysFile theFile, QTUInt64 theSize);
+void						QTSys_CloseFile (QTSysFile theFile);
+
+Boolean						QTSys_FileExists (const char *thePath);
+OSErr						QTSys_GetPathSize (const char *thePath, QTUInt64 *theSize);
+OSErr						QTSys_GetPathModificationTime (const char *thePath, QTUInt64 *theTime);
+OSErr						QTSys_DeletePath (const char *thePath);
+OSErr						QTSys_ReplacePath (const char *theSrcPath, const char *theDstPath);
+OSErr						QTSys_CopyFile (const char *theSrcPath, const char *theDstPath, QTUInt64 *theBytesWritten);
+OSErr						QTSys_MapFile (const char *thePath, QTSysMappedFilePtr theMapping);
+void						QTSys_UnmapFile (QTSysMappedFilePtr theMapping);
+OSErr						QTSys_OpenDirectory (const char *thePath, QTSysDirectory *theDirectory);
+OSErr						QTSys_ReadDirectory (QTSysDirectory theDirectory, QTSysDirEntryPtr theEntry);
+void						QTSys_CloseDirectory (QTSysDirectory theDirectory);
+
+OSErr						QTSys_NewMutex (QTSysMutex *theMutex);
+void						QTSys_LockMutex (QTSysMutex theMutex);
+void						QTSys_UnlockMutex (QTSysMutex theMutex);
+void						QTSys_DisposeMutex (QTSysMutex theMutex);
+OSErr						QTSys_NewCondition (QTSysCondition *theCondition);
+void						QTSys_WaitCondition (QTSysCondition theCondition, QTSysMutex theMutex);
+void						QTSys_SignalCondition (QTSysCondition theCondition);
+void						QTSys_BroadcastCondition (QTSysCondition theCondition);
+void						QTSys_DisposeCondition (QTSysCondition theCondition);
+OSErr						QTSys_NewThread (QTSysThreadProcPtr theProc, void *theRefCon, QTSysThread *theThread);
+void						QTSys_JoinThread (QTSysThread theThread);
+long						QTSys_GetProcessorCount (void);
+unsigned long				QTSys_GetProcessID (void);
+void						QTSys_Sleep (UInt32 theMilliseconds);
+
+long						QTSys_AtomicAdd (volatile long *theValue, long theDelta);
+long						QTSys_AtomicLoad (volatile long *theValue);
+void						QTSys_AtomicStore (volatile long *theValue, long theNewValue);
+Boolean						QTSys_AtomicCompareAndSwap (volatile long *theValue, long theOldValue, long theNewValue);
+
+OSErr						QTSys_GetCacheDirectory (char *theBuffer, size_t theBufferSize);
+const char *				QTSys_GetFileName (const char *thePath);
+const char *				QTSys_GetFileExtension (const char *thePath);
+OSErr						QTSys_MakePath (char *theBuffer, size_t theBufferSize, const char *theDirectory, const char *theFileName);
+OSErr						QTSys_GetFullPath (char *theBuffer, size_t theBufferSize, const char *thePath);
+OSErr						QTSys_ReplaceExtension (char *theBuffer, size_t theBufferSize, const char *theFileName, const char *theExtension);
+
+char *						QTSys_CopyString (const char *theString);
+int							QTSys_CompareStringsNoCase (const char *theString1, const char *theString2);
+int							QTSys_FormatString (char *theBuffer, size_t theBufferSize, const char *theFormat, ...);
+void						QTSys_WriteJSONString (FILE *theStream, const char *theString);
+char *						QTSys_TrimLine (char *theLine);
+
+Boolean						QTSys_StartAllocationCount (void);
+long						QTSys_StopAllocationCount (void);
+void *						QTSys_CountedMalloc (size_t theSize);
+void *						QTSys_CountedCalloc (size_t theCount, size_t theSize);
+void *						QTSys_CountedRealloc (void *thePtr, size_t theSize);
+
+
+//////////
+//
+// allocation counting
+//
+//////////
+
+// a file that defines QTSYS_COUNT_ALLOCATIONS before it includes this header allocates through the counted
+// versions of malloc, calloc and realloc, so QTSys_StopAllocationCount sees its allocations in every build
+#if defined(QTSYS_COUNT_ALLOCATIONS)
+#define malloc(theSize)						QTSys_CountedMalloc(theSize)
+#define calloc(theCount, theSize)			QTSys_CountedCalloc(theCount, theSize)
+#define realloc(thePtr, theSize)			QTSys_CountedRealloc(thePtr, theSize)
+#endif
+
+#endif	// __QTSystem__
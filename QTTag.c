@@ -0,0 +1,967 @@
+//////////
+//
+//	File:		QTTag.c
+//
+//	Contains:	A portable engine that edits the user data of many movie files at once, without opening them as movies.
+//				All utilities start with the prefix "QTTag_".
+//
+//	QTUtils_AddCopyrightToMovie and its friends change one user data item of one open movie, and the movie
+//	then has to be saved. To put the same copyright notice into thousands of files, we don't need QuickTime
+//	at all: we read each file's movie atom, rebuild just its user data atom ('udta'), copying every other
+//	atom untouched, and save the new movie atom with QTUpd_UpdateMovieAtom, which writes only what changed.
+//
+//	The edits come from a table, one per line: an item, a tab, and a value. The item is one of "copyright",
+//	"name", "info", "author", "comment" and "loop", or any four-character type; an '@' at the start of a
+//	type stands for the copyright sign that begins the standard text types, so "@cpy" is the same as
+//	"copyright". Items whose type begins with the copyright sign hold text, which replaces the item's
+//	text in kTagTextLanguage and leaves its other languages alone; other items get the value's bytes. The
+//	value of "loop" is "none", "normal" or "palindrome", as in QTUtils_SetMovieFileLoopingInfo. An empty
+//	value removes the item.
+//
+//	Files are tagged on a pool of worker threads. Reading a movie atom and saving it are the only steps
+//	that touch the disk, and a gate lets no more than a set number of files do either at once, so a
+//	large pool doesn't swamp a disk (or a file server) with requests.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTTag.h"
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// lets no more than fLimit threads in at once
+typedef struct QTTagGateRecord {
+	QTSysMutex				fMutex;
+	QTSysCondition			fCondition;
+	long					fCount;
+	long					fLimit;
+} QTTagGateRecord, *QTTagGatePtr;
+
+// what the workers of QTTag_TagFiles share
+typedef struct QTTagRunRecord {
+	QTTagFileListPtr		fFiles;
+	QTTagEditListPtr		fEdits;
+	QTTagGatePtr			fGate;
+	volatile long			fNextIndex;				// of the next file to tag
+	QTSysMutex				fReportMutex;			// guards fReport and fSummary
+	FILE					*fReport;
+	QTTagSummaryRecord		fSummary;
+} QTTagRunRecord, *QTTagRunPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTTag_AddEdit (QTTagEditListPtr theEdits, OSType theType, long theKind, const void *theValue, UInt32 theLength);
+static long					QTTag_FindLastEdit (QTTagEditListPtr theEdits, OSType theType);
+static void					QTTag_AppendItem (QTAtomBufferPtr theBuffer, QTTagEditPtr theEdit, const UInt8 *theOldData, UInt32 theOldSize);
+static OSErr				QTTag_TagFileThroughGate (QTTagEntryPtr theEntry, QTTagEditListPtr theEdits, QTTagGatePtr theGate);
+static void					QTTag_EnterGate (QTTagGatePtr theGate);
+static void					QTTag_LeaveGate (QTTagGatePtr theGate);
+static void					QTTag_WorkerThread (void *theRefCon);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Edit table functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTag_ParseEdit
+// Add the edit described by an item name and a value (as in an edit table) to theEdits.
+//
+//////////
+
+OSErr QTTag_ParseEdit (const char *theItem, const char *theValue, QTTagEditListPtr theEdits)
+{
+	static const struct {
+		const char			*fName;
+		const char			*fType;
+	} myNames[] = {
+		{"copyright",	"\251cpy"},
+		{"name",		"\251nam"},
+		{"info",		"\251inf"},
+		{"author",		"\251aut"},
+		{"comment",		"\251cmt"},
+		{"loop",		"LOOP"}
+	};
+	const char				*myType = NULL;
+	UInt8					myBytes[4];
+	UInt32					myLength;
+	long					myIndex;
+
+	if ((theItem == NULL) || (theEdits == NULL))
+		return(paramErr);
+
+	if (theValue == NULL)
+		theValue = "";
+
+	for (myIndex = 0; myIndex < (long)(sizeof(myNames) / sizeof(myNames[0])); myIndex++)
+		if (QTSys_CompareStringsNoCase(theItem, myNames[myIndex].fName) == 0)
+			myType = myNames[myIndex].fType;
+
+	if (myType == NULL) {
+		if (strlen(theItem) != 4)
+			return(paramErr);
+		myType = theItem;
+	}
+
+	memcpy(myBytes, myType, 4);
+	if (myBytes[0] == kTagCopyrightStandIn)
+		myBytes[0] = (UInt8)kTagCopyrightSign;
+
+	myLength = (UInt32)strlen(theValue);
+	if (myLength == 0)
+		return(QTTag_AddEdit(theEdits, QTAtom_GetBE32(myBytes), kTagEditRemove, NULL, 0));
+
+	if (QTAtom_GetBE32(myBytes) == kTagTypeLoop) {
+		UInt8		myLoopInfo[4];
+
+		if (QTSys_CompareStringsNoCase(theValue, "none") == 0)
+			return(QTTag_AddEdit(theEdits, kTagTypeLoop, kTagEditRemove, NULL, 0));
+		else if (QTSys_CompareStringsNoCase(theValue, "normal") == 0)
+			QTAtom_PutBE32(myLoopInfo, 0);
+		else if (QTSys_CompareStringsNoCase(theValue, "palindrome") == 0)
+			QTAtom_PutBE32(myLoopInfo, 1);
+		else {
+			fprintf(stderr, "invalid loop value \"%s\"; use none, normal or palindrome\n", theValue);
+			return(paramErr);
+		}
+
+		return(QTTag_AddEdit(theEdits, kTagTypeLoop, kTagEditLoop, myLoopInfo, 4));
+	}
+
+	if (myBytes[0] == (UInt8)kTagCopyrightSign) {
+		// the length of a text entry is 16 bits
+		if (myLength > 0xFFFF)
+			return(paramErr);
+
+		return(QTTag_AddEdit(theEdits, QTAtom_GetBE32(myBytes), kTagEditText, theValue, myLength));
+	}
+
+	return(QTTag_AddEdit(theEdits, QTAtom_GetBE32(myBytes), kTagEditData, theValue, myLength));
+}
+
+
+//////////
+//
+// QTTag_ReadEdits
+// Read an edit table into theEdits.
+//
+// Each line holds an item and a value, separated by a tab; a line with no tab, or nothing after it,
+// removes the item. Blank lines and lines beginning with '#' are ignored.
+//
+//////////
+
+OSErr QTTag_ReadEdits (const char *thePath, QTTagEditListPtr theEdits)
+{
+	FILE			*myFile = NULL;
+	char			myLine[kTagMaxLineLength];
+	char			*myItem;
+	char			*myValue;
+	OSErr			myErr = noErr;
+
+	if ((thePath == NULL) || (theEdits == NULL))
+		return(paramErr);
+
+	myFile = fopen(thePath, "r");
+	if (myFile == NULL)
+		return(fnfErr);
+
+	while ((myErr == noErr) && (fgets(myLine, sizeof(myLine), myFile) != NULL)) {
+		myItem = QTSys_TrimLine(myLine);
+		if ((*myItem == '\0') || (*myItem == kTagListComment))
+			continue;
+
+		// the value keeps any spaces inside it, but not the line ending
+		myValue = strchr(myItem, kTagListSeparator);
+		if (myValue != NULL) {
+			*myValue++ = '\0';
+			myItem = QTSys_TrimLine(myItem);
+		}
+
+		myErr = QTTag_ParseEdit(myItem, myValue, theEdits);
+	}
+
+	fclose(myFile);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTTag_DisposeEdits
+// Release the memory held by the specified edit list; the list record itself is not freed.
+//
+//////////
+
+void QTTag_DisposeEdits (QTTagEditListPtr theEdits)
+{
+	long		myIndex;
+
+	if (theEdits == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theEdits->fCount; myIndex++)
+		free(theEdits->fEdits[myIndex].fValue);
+
+	free(theEdits->fEdits);
+	memset(theEdits, 0, sizeof(QTTagEditListRecord));
+}
+
+
+//////////
+//
+// QTTag_AddEdit
+// Append an edit to the specified edit list, with a copy of its value.
+//
+//////////
+
+static OSErr QTTag_AddEdit (QTTagEditListPtr theEdits, OSType theType, long theKind, const void *theValue, UInt32 theLength)
+{
+	QTTagEditPtr		myEdit = NULL;
+
+	// grow the edit array, if necessary
+	if (theEdits->fCount == theEdits->fCapacity) {
+		long				myCapacity = (theEdits->fCapacity == 0) ? kTagInitialCapacity : theEdits->fCapacity * 2;
+		QTTagEditPtr		myEdits;
+
+		myEdits = (QTTagEditPtr)realloc(theEdits->fEdits, myCapacity * sizeof(QTTagEditRecord));
+		if (myEdits == NULL)
+			return(memFullErr);
+
+		theEdits->fEdits = myEdits;
+		theEdits->fCapacity = myCapacity;
+	}
+
+	myEdit = &theEdits->fEdits[theEdits->fCount];
+	myEdit->fType = theType;
+	myEdit->fKind = theKind;
+	myEdit->fLength = theLength;
+
+	// allocate at least one byte, so that an empty value still gets a block of memory
+	myEdit->fValue = (char *)malloc(theLength + 1);
+	if (myEdit->fValue == NULL)
+		return(memFullErr);
+
+	if (theLength > 0)
+		memcpy(myEdit->fValue, theValue, theLength);
+	myEdit->fValue[theLength] = '\0';
+
+	theEdits->fCount++;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTTag_FindLastEdit
+// Return the index of the last edit of theType, which is the one that counts, or -1 if there is none.
+//
+//////////
+
+static long QTTag_FindLastEdit (QTTagEditListPtr theEdits, OSType theType)
+{
+	long		myIndex;
+
+	for (myIndex = theEdits->fCount - 1; myIndex >= 0; myIndex--)
+		if (theEdits->fEdits[myIndex].fType == theType)
+			return(myIndex);
+
+	return(-1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// File list functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTag_AddFile
+// Append a file to the specified file list.
+//
+//////////
+
+OSErr QTTag_AddFile (QTTagFileListPtr theFiles, const char *thePath)
+{
+	QTTagEntryPtr		myEntry = NULL;
+
+	if ((theFiles == NULL) || (thePath == NULL))
+		return(paramErr);
+
+	// grow the entry array, if necessary
+	if (theFiles->fCount == theFiles->fCapacity) {
+		long				myCapacity = (theFiles->fCapacity == 0) ? kTagInitialCapacity : theFiles->fCapacity * 2;
+		QTTagEntryPtr		myEntries;
+
+		myEntries = (QTTagEntryPtr)realloc(theFiles->fEntries, myCapacity * sizeof(QTTagEntryRecord));
+		if (myEntries == NULL)
+			return(memFullErr);
+
+		theFiles->fEntries = myEntries;
+		theFiles->fCapacity = myCapacity;
+	}
+
+	myEntry = &theFiles->fEntries[theFiles->fCount];
+	memset(myEntry, 0, sizeof(QTTagEntryRecord));
+
+	myEntry->fPath = QTSys_CopyString(thePath);
+	if (myEntry->fPath == NULL)
+		return(memFullErr);
+
+	theFiles->fCount++;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTTag_ReadFileList
+// Read a list of files to tag, one path per line, into theFiles.
+//
+// Blank lines and lines beginning with '#' are ignored.
+//
+//////////
+
+OSErr QTTag_ReadFileList (const char *thePath, QTTagFileListPtr theFiles)
+{
+	FILE			*myFile = NULL;
+	char			myLine[kTagMaxLineLength];
+	char			*myPath;
+	OSErr			myErr = noErr;
+
+	if ((thePath == NULL) || (theFiles == NULL))
+		return(paramErr);
+
+	myFile = fopen(thePath, "r");
+	if (myFile == NULL)
+		return(fnfErr);
+
+	while ((myErr == noErr) && (fgets(myLine, sizeof(myLine), myFile) != NULL)) {
+		myPath = QTSys_TrimLine(myLine);
+		if ((*myPath == '\0') || (*myPath == kTagListComment))
+			continue;
+
+		myErr = QTTag_AddFile(theFiles, myPath);
+	}
+
+	fclose(myFile);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTTag_DisposeFileList
+// Release the memory held by the specified file list; the list record itself is not freed.
+//
+//////////
+
+void QTTag_DisposeFileList (QTTagFileListPtr theFiles)
+{
+	long		myIndex;
+
+	if (theFiles == NULL)
+		return;
+
+	for (myIndex = 0; myIndex < theFiles->fCount; myIndex++)
+		free(theFiles->fEntries[myIndex].fPath);
+
+	free(theFiles->fEntries);
+	memset(theFiles, 0, sizeof(QTTagFileListRecord));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Tagging functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTag_EditUserData
+// Apply theEdits to the contents of a user data atom, and append the new contents to theNewUserData.
+//
+// The first item of each edited type is replaced where it is, so the order of the items doesn't change;
+// later items of that type are kept, unless the edit removes them all. Items that the movie doesn't have
+// yet go at the end. QuickTime ends some user data atoms with a zero long; we keep it there.
+//
+//////////
+
+OSErr QTTag_EditUserData (const UInt8 *theUserData, UInt32 theSize, QTTagEditListPtr theEdits, QTAtomBufferPtr theNewUserData)
+{
+	Boolean			*myDone = NULL;
+	Boolean			myHasTerminator = false;
+	UInt32			myOffset = 0;
+	UInt32			myItemSize;
+	OSType			myType;
+	long			myIndex;
+	OSErr			myErr = noErr;
+
+	myDone = (Boolean *)calloc(theEdits->fCount + 1, sizeof(Boolean));
+	if (myDone == NULL)
+		return(memFullErr);
+
+	while (myOffset < theSize) {
+		if ((theSize - myOffset < kAtomHeaderSize) || (QTAtom_GetBE32(theUserData + myOffset) == 0)) {
+			// only zeros may follow the last item
+			for (; myOffset < theSize; myOffset++)
+				if (theUserData[myOffset] != 0)
+					myErr = invalidAtomErr;
+
+			myHasTerminator = true;
+			break;
+		}
+
+		myItemSize = QTAtom_GetBE32(theUserData + myOffset);
+		myType = QTAtom_GetBE32(theUserData + myOffset + 4);
+		if ((myItemSize < kAtomHeaderSize) || (myItemSize > theSize - myOffset)) {
+			myErr = invalidAtomErr;
+			break;
+		}
+
+		myIndex = QTTag_FindLastEdit(theEdits, myType);
+		if (myIndex < 0) {
+			QTAtom_AppendBytes(theNewUserData, theUserData + myOffset, myItemSize);
+		} else if (theEdits->fEdits[myIndex].fKind == kTagEditRemove) {
+			// leave it out
+		} else if (myDone[myIndex]) {
+			QTAtom_AppendBytes(theNewUserData, theUserData + myOffset, myItemSize);
+		} else {
+			QTTag_AppendItem(theNewUserData, &theEdits->fEdits[myIndex], theUserData + myOffset + kAtomHeaderSize, myItemSize - kAtomHeaderSize);
+			myDone[myIndex] = true;
+		}
+
+		myOffset += myItemSize;
+	}
+
+	// add the items that weren't there
+	for (myIndex = 0; (myIndex < theEdits->fCount) && (myErr == noErr); myIndex++)
+		if ((theEdits->fEdits[myIndex].fKind != kTagEditRemove) && !myDone[myIndex] && (QTTag_FindLastEdit(theEdits, theEdits->fEdits[myIndex].fType) == myIndex))
+			QTTag_AppendItem(theNewUserData, &theEdits->fEdits[myIndex], NULL, 0);
+
+	if (myHasTerminator)
+		QTAtom_Append32(theNewUserData, 0);
+
+	free(myDone);
+
+	if (myErr == noErr)
+		myErr = theNewUserData->fErr;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTTag_AppendItem
+// Append the user data item made by applying theEdit to the item whose data (if any) is theOldData.
+//
+// A text item holds entries of a 16-bit length, a 16-bit language code and the text, as AddUserDataText
+// writes them. We replace the entry in kTagTextLanguage or add one, and keep the others; if the old
+// data isn't made of entries, we throw it away.
+//
+//////////
+
+static void QTTag_AppendItem (QTAtomBufferPtr theBuffer, QTTagEditPtr theEdit, const UInt8 *theOldData, UInt32 theOldSize)
+{
+	Boolean			myWellFormed = true;
+	Boolean			myReplaced = false;
+	UInt32			myOffset;
+	UInt32			myLength;
+	UInt32			myItem;
+
+	myItem = QTAtom_BeginAtom(theBuffer, theEdit->fType);
+
+	if (theEdit->fKind == kTagEditText) {
+		for (myOffset = 0; (myOffset < theOldSize) && myWellFormed; myOffset += 4 + myLength) {
+			myLength = 0;
+			if (theOldSize - myOffset < 4)
+				myWellFormed = false;
+			else
+				myLength = QTAtom_GetBE16(theOldData + myOffset);
+
+			if (myWellFormed && (myLength > theOldSize - myOffset - 4))
+				myWellFormed = false;
+		}
+
+		for (myOffset = 0; (myOffset < theOldSize) && myWellFormed; myOffset += 4 + myLength) {
+			myLength = QTAtom_GetBE16(theOldData + myOffset);
+			if ((QTAtom_GetBE16(theOldData + myOffset + 2) == kTagTextLanguage) && !myReplaced) {
+				QTAtom_Append16(theBuffer, (UInt16)theEdit->fLength);
+				QTAtom_Append16(theBuffer, kTagTextLanguage);
+				QTAtom_AppendBytes(theBuffer, theEdit->fValue, theEdit->fLength);
+				myReplaced = true;
+			} else {
+				QTAtom_AppendBytes(theBuffer, theOldData + myOffset, 4 + myLength);
+			}
+		}
+
+		if (!myReplaced) {
+			QTAtom_Append16(theBuffer, (UInt16)theEdit->fLength);
+			QTAtom_Append16(theBuffer, kTagTextLanguage);
+			QTAtom_AppendBytes(theBuffer, theEdit->fValue, theEdit->fLength);
+		}
+	} else {
+		QTAtom_AppendBytes(theBuffer, theEdit->fValue, theEdit->fLength);
+	}
+
+	QTAtom_EndAtom(theBuffer, myItem);
+}
+
+
+//////////
+//
+// QTTag_TagFile
+// Apply theEdits to the movie file named by theEntry, filling in the rest of the entry.
+//
+//////////
+
+OSErr QTTag_TagFile (QTTagEntryPtr theEntry, QTTagEditListPtr theEdits)
+{
+	return(QTTag_TagFileThroughGate(theEntry, theEdits, NULL));
+}
+
+
+//////////
+//
+// QTTag_TagFileThroughGate
+// Apply theEdits to the movie file named by theEntry, going through theGate (if any) to read and write it.
+//
+//////////
+
+static OSErr QTTag_TagFileThroughGate (QTTagEntryPtr theEntry, QTTagEditListPtr theEdits, QTTagGatePtr theGate)
+{
+	QTAtomReaderRecord		myReader;
+	QTAtomReaderRecord		myMovieReader;
+	QTAtomHeaderRecord		myMovie;
+	QTAtomHeaderRecord		myChild;
+	QTAtomBufferRecord		myNewMovie;
+	QTAtomBufferRecord		myUserData;
+	QTUpdStatsRecord		myStats;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	QTUInt64				myOffset;
+	Boolean					myFoundUserData = false;
+	UInt8					*myData = NULL;
+	UInt32					mySize = 0;
+	UInt32					myMovieAtom;
+	UInt32					myUserDataAtom;
+	OSErr					myErr = noErr;
+
+	QTAtom_InitBuffer(&myNewMovie);
+	QTAtom_InitBuffer(&myUserData);
+	theEntry->fMethod = kUpdMethodUnchanged;
+
+	// read the movie atom
+	QTTag_EnterGate(theGate);
+	myErr = QTAtom_OpenFileReader(theEntry->fPath, &myReader);
+	if (myErr == noErr) {
+		myErr = QTAtom_FindTopLevel(&myReader, kAtomTypeMovie, &myMovie);
+		if (myErr == noErr)
+			myErr = QTAtom_ReadPayload(&myReader, &myMovie, &myData, &mySize);
+		else
+			myErr = invalidMovie;
+
+		QTAtom_CloseFileReader(&myReader);
+	}
+	QTTag_LeaveGate(theGate);
+
+	if (myErr != noErr)
+		goto bail;
+
+	theEntry->fBytesRead = myMovie.fSize;
+
+	// copy its children, with the user data edited
+	QTAtom_InitMemoryReader(&myMovieReader, myData, mySize);
+	myMovieAtom = QTAtom_BeginAtom(&myNewMovie, kAtomTypeMovie);
+
+	for (myOffset = 0; (myOffset < mySize) && (myErr == noErr); myOffset += myChild.fSize) {
+		myErr = QTAtom_ReadHeader(&myMovieReader, myOffset, mySize, &myChild);
+		if (myErr != noErr)
+			break;
+
+		// the user data of a compressed movie is out of our reach
+		if (myChild.fType == kTagTypeCompressedMovie)
+			myErr = unimpErr;
+
+		if ((myChild.fType == kAtomTypeUserData) && !myFoundUserData) {
+			theEntry->fOldUserDataSize = (UInt32)myChild.fSize;
+
+			myErr = QTTag_EditUserData(myData + myOffset + myChild.fHeaderSize, (UInt32)(myChild.fSize - myChild.fHeaderSize), theEdits, &myUserData);
+			if (myErr == noErr) {
+				myUserDataAtom = QTAtom_BeginAtom(&myNewMovie, kAtomTypeUserData);
+				QTAtom_AppendBytes(&myNewMovie, myUserData.fData, myUserData.fSize);
+				QTAtom_EndAtom(&myNewMovie, myUserDataAtom);
+				theEntry->fNewUserDataSize = kAtomHeaderSize + myUserData.fSize;
+			}
+
+			myFoundUserData = true;
+		} else {
+			QTAtom_AppendBytes(&myNewMovie, myData + myOffset, (UInt32)myChild.fSize);
+		}
+	}
+
+	if ((myErr == noErr) && !myFoundUserData) {
+		myErr = QTTag_EditUserData(NULL, 0, theEdits, &myUserData);
+		if ((myErr == noErr) && (myUserData.fSize > 0)) {
+			myUserDataAtom = QTAtom_BeginAtom(&myNewMovie, kAtomTypeUserData);
+			QTAtom_AppendBytes(&myNewMovie, myUserData.fData, myUserData.fSize);
+			QTAtom_EndAtom(&myNewMovie, myUserDataAtom);
+			theEntry->fNewUserDataSize = kAtomHeaderSize + myUserData.fSize;
+		}
+	}
+
+	QTAtom_EndAtom(&myNewMovie, myMovieAtom);
+	if (myErr == noErr)
+		myErr = myNewMovie.fErr;
+	if (myErr != noErr)
+		goto bail;
+
+	// save it, unless nothing has changed
+	if ((myMovie.fHeaderSize == kAtomHeaderSize) && (myNewMovie.fSize == myMovie.fSize) && (memcmp(myNewMovie.fData + kAtomHeaderSize, myData, mySize) == 0))
+		goto bail;
+
+	QTTag_EnterGate(theGate);
+	myErr = QTUpd_UpdateMovieAtom(theEntry->fPath, myNewMovie.fData, myNewMovie.fSize, &myStats);
+	QTTag_LeaveGate(theGate);
+
+	theEntry->fMethod = myStats.fMethod;
+	theEntry->fBytesWritten = myStats.fBytesWritten;
+
+bail:
+	free(myData);
+	QTAtom_DisposeBuffer(&myUserData);
+	QTAtom_DisposeBuffer(&myNewMovie);
+
+	theEntry->fErr = myErr;
+	theEntry->fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTTag_TagFiles
+// Apply theEdits to every file in theFiles, on theWorkerCount threads, with at most theIOLimit files
+// being read or written at once; write a line of JSON per file, and one for the whole run, to theReport.
+//
+// A worker count of 0 or less means one worker per processor; an I/O limit of 0 or less means
+// kTagDefaultIOLimit. The lines for the files are written as they finish, so they needn't be in order.
+//
+//////////
+
+OSErr QTTag_TagFiles (QTTagFileListPtr theFiles, QTTagEditListPtr theEdits, long theWorkerCount, long theIOLimit, FILE *theReport, QTTagSummaryPtr theSummary)
+{
+	QTTagRunRecord			myRun;
+	QTTagGateRecord			myGate;
+	QTSysThread				myThreads[kTagMaxWorkers];
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	long					myThreadCount = 0;
+	long					myIndex;
+	OSErr					myErr = noErr;
+
+	if ((theFiles == NULL) || (theEdits == NULL))
+		return(paramErr);
+
+	if (theWorkerCount <= 0)
+		theWorkerCount = QTSys_GetProcessorCount();
+	if (theWorkerCount > kTagMaxWorkers)
+		theWorkerCount = kTagMaxWorkers;
+	if (theWorkerCount > theFiles->fCount)
+		theWorkerCount = theFiles->fCount;
+	if (theIOLimit <= 0)
+		theIOLimit = kTagDefaultIOLimit;
+
+	memset(&myRun, 0, sizeof(myRun));
+	memset(&myGate, 0, sizeof(myGate));
+	myRun.fFiles = theFiles;
+	myRun.fEdits = theEdits;
+	myRun.fGate = &myGate;
+	myRun.fReport = theReport;
+	myGate.fLimit = theIOLimit;
+
+	myErr = QTSys_NewMutex(&myGate.fMutex);
+	if (myErr == noErr)
+		myErr = QTSys_NewCondition(&myGate.fCondition);
+	if (myErr == noErr)
+		myErr = QTSys_NewMutex(&myRun.fReportMutex);
+	if (myErr != noErr)
+		goto bail;
+
+	for (myIndex = 0; myIndex < theWorkerCount; myIndex++) {
+		if (QTSys_NewThread(QTTag_WorkerThread, &myRun, &myThreads[myThreadCount]) != noErr)
+			break;
+
+		myThreadCount++;
+	}
+
+	// if we couldn't start any threads, do the work on this one
+	if (myThreadCount == 0)
+		QTTag_WorkerThread(&myRun);
+
+	for (myIndex = 0; myIndex < myThreadCount; myIndex++)
+		QTSys_JoinThread(myThreads[myIndex]);
+
+	myRun.fSummary.fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+
+	if (theReport != NULL) {
+		fprintf(theReport, "{\"summary\":true,\"files\":%ld,\"changed\":%ld,\"unchanged\":%ld,\"failed\":%ld,\"workers\":%ld,\"ioLimit\":%ld,\"bytesRead\":%llu,\"bytesWritten\":%llu,\"wallMicroseconds\":%llu,\"filesPerSecond\":%.1f}\n",
+					theFiles->fCount,
+					myRun.fSummary.fChangedCount,
+					myRun.fSummary.fUnchangedCount,
+					myRun.fSummary.fFailedCount,
+					(myThreadCount == 0) ? 1L : myThreadCount,
+					theIOLimit,
+					(unsigned long long)myRun.fSummary.fBytesRead,
+					(unsigned long long)myRun.fSummary.fBytesWritten,
+					(unsigned long long)myRun.fSummary.fMicroseconds,
+					(myRun.fSummary.fMicroseconds > 0) ? (double)theFiles->fCount * 1000000.0 / (double)myRun.fSummary.fMicroseconds : 0.0);
+		fflush(theReport);
+	}
+
+bail:
+	if (myRun.fReportMutex != NULL)
+		QTSys_DisposeMutex(myRun.fReportMutex);
+	if (myGate.fCondition != NULL)
+		QTSys_DisposeCondition(myGate.fCondition);
+	if (myGate.fMutex != NULL)
+		QTSys_DisposeMutex(myGate.fMutex);
+
+	if (theSummary != NULL)
+		*theSummary = myRun.fSummary;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTTag_WriteEntryReport
+// Write a line of JSON describing what happened to one file.
+//
+//////////
+
+void QTTag_WriteEntryReport (FILE *theReport, long theIndex, QTTagEntryPtr theEntry)
+{
+	if ((theReport == NULL) || (theEntry == NULL))
+		return;
+
+	fprintf(theReport, "{\"index\":%ld,\"file\":", theIndex);
+	QTSys_WriteJSONString(theReport, theEntry->fPath);
+	fprintf(theReport, ",\"err\":%d,\"method\":\"%s\",\"oldUserDataBytes\":%lu,\"newUserDataBytes\":%lu,\"bytesWritten\":%llu,\"microseconds\":%llu}\n",
+				(int)theEntry->fErr,
+				(theEntry->fErr == noErr) ? QTUpd_GetMethodName(theEntry->fMethod) : "failed",
+				(unsigned long)theEntry->fOldUserDataSize,
+				(unsigned long)theEntry->fNewUserDataSize,
+				(unsigned long long)theEntry->fBytesWritten,
+				(unsigned long long)theEntry->fMicroseconds);
+}
+
+
+//////////
+//
+// QTTag_WorkerThread
+// Tag files until there are none left.
+//
+//////////
+
+static void QTTag_WorkerThread (void *theRefCon)
+{
+	QTTagRunPtr			myRun = (QTTagRunPtr)theRefCon;
+	QTTagEntryPtr		myEntry;
+	long				myIndex;
+
+	for (;;) {
+		myIndex = QTSys_AtomicAdd(&myRun->fNextIndex, 1) - 1;
+		if (myIndex >= myRun->fFiles->fCount)
+			break;
+
+		myEntry = &myRun->fFiles->fEntries[myIndex];
+		QTTag_TagFileThroughGate(myEntry, myRun->fEdits, myRun->fGate);
+
+		QTSys_LockMutex(myRun->fReportMutex);
+
+		if (myEntry->fErr != noErr)
+			myRun->fSummary.fFailedCount++;
+		else if (myEntry->fMethod == kUpdMethodUnchanged)
+			myRun->fSummary.fUnchangedCount++;
+		else
+			myRun->fSummary.fChangedCount++;
+
+		myRun->fSummary.fBytesRead += myEntry->fBytesRead;
+		myRun->fSummary.fBytesWritten += myEntry->fBytesWritten;
+
+		QTTag_WriteEntryReport(myRun->fReport, myIndex, myEntry);
+
+		QTSys_UnlockMutex(myRun->fReportMutex);
+	}
+}
+
+
+//////////
+//
+// QTTag_EnterGate
+// Wait until fewer than the gate's limit of threads are inside it, and go in; a NULL gate lets everyone in.
+//
+//////////
+
+static void QTTag_EnterGate (QTTagGatePtr theGate)
+{
+	if (theGate == NULL)
+		return;
+
+	QTSys_LockMutex(theGate->fMutex);
+	while (theGate->fCount >= theGate->fLimit)
+		QTSys_WaitCondition(theGate->fCondition, theGate->fMutex);
+	theGate->fCount++;
+	QTSys_UnlockMutex(theGate->fMutex);
+}
+
+
+//////////
+//
+// QTTag_LeaveGate
+// Leave a gate, letting in a thread that's waiting for it.
+//
+//////////
+
+static void QTTag_LeaveGate (QTTagGatePtr theGate)
+{
+	if (theGate == NULL)
+		return;
+
+	QTSys_LockMutex(theGate->fMutex);
+	theGate->fCount--;
+	QTSys_SignalCondition(theGate->fCondition);
+	QTSys_UnlockMutex(theGate->fMutex);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTag_IsTagCommandLine
+// Does the specified command line ask for tagging mode?
+//
+//////////
+
+Boolean QTTag_IsTagCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kTagSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTTag_Main
+// Run tagging mode. Returns one of the kTagExit constants.
+//
+// Usage: -tag <file list> [-edits <table>] [-set <item>=<value>] ... [-workers <count>] [-io <count>] [-report <file>]
+//
+//////////
+
+int QTTag_Main (int theArgc, char *theArgv[])
+{
+	QTTagFileListRecord		myFiles = {NULL, 0, 0};
+	QTTagEditListRecord		myEdits = {NULL, 0, 0};
+	QTTagSummaryRecord		mySummary;
+	const char				*myListPath = NULL;
+	const char				*myReportPath = NULL;
+	FILE					*myReport = stdout;
+	char					*myValue;
+	long					myWorkerCount = 0;
+	long					myIOLimit = 0;
+	int						myExitCode = kTagExitUsage;
+	int						myIndex;
+	OSErr					myErr = noErr;
+
+	memset(&mySummary, 0, sizeof(mySummary));
+
+	// the edits are applied in the order they're given, so a later one wins
+	for (myIndex = 1; (myIndex < theArgc) && (myErr == noErr); myIndex++) {
+		if ((strcmp(theArgv[myIndex], kTagSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myListPath = theArgv[++myIndex];
+		} else if ((strcmp(theArgv[myIndex], kTagEditsSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myErr = QTTag_ReadEdits(theArgv[++myIndex], &myEdits);
+		} else if ((strcmp(theArgv[myIndex], kTagSetSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myValue = strchr(theArgv[++myIndex], kTagSetSeparator);
+			if (myValue != NULL)
+				*myValue++ = '\0';
+			myErr = QTTag_ParseEdit(theArgv[myIndex], myValue, &myEdits);
+		} else if ((strcmp(theArgv[myIndex], kTagWorkersSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myWorkerCount = atol(theArgv[++myIndex]);
+		} else if ((strcmp(theArgv[myIndex], kTagIOSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myIOLimit = atol(theArgv[++myIndex]);
+		} else if ((strcmp(theArgv[myIndex], kTagReportSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myReportPath = theArgv[++myIndex];
+		} else {
+			myErr = paramErr;
+		}
+	}
+
+	if ((myErr != noErr) || (myListPath == NULL) || (myEdits.fCount == 0)) {
+		fprintf(stderr, "usage: %s %s <file list> [%s <table>] [%s <item>=<value>] ... [%s <count>] [%s <count>] [%s <file>]\n", theArgv[0], kTagSwitch, kTagEditsSwitch, kTagSetSwitch, kTagWorkersSwitch, kTagIOSwitch, kTagReportSwitch);
+		goto bail;
+	}
+
+	myErr = QTTag_ReadFileList(myListPath, &myFiles);
+	if (myErr != noErr) {
+		fprintf(stderr, "cannot read file list %s (error %d)\n", myListPath, (int)myErr);
+		goto bail;
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			goto bail;
+		}
+	}
+
+	myErr = QTTag_TagFiles(&myFiles, &myEdits, myWorkerCount, myIOLimit, myReport, &mySummary);
+	myExitCode = ((myErr == noErr) && (mySummary.fFailedCount == 0)) ? kTagExitSuccess : kTagExitSomeFailed;
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+bail:
+	QTTag_DisposeFileList(&myFiles);
+	QTTag_DisposeEdits(&myEdits);
+
+	return(myExitCode);
+}
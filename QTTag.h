@@ -0,0 +1,141 @@
+//////////
+//
+//	File:		QTTag.h
+//
+//	Contains:	A portable engine that edits the user data of many movie files at once, without opening them as movies.
+//				All utilities start with the prefix "QTTag_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTTag__
+#define __QTTag__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTUpdate.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kTagSwitch							"-tag"					// command-line switch that selects tagging mode
+#define kTagEditsSwitch						"-edits"				// the table of edits to apply to every file
+#define kTagSetSwitch						"-set"					// one more edit, as <item>=<value>
+#define kTagWorkersSwitch					"-workers"				// number of files in progress at once
+#define kTagIOSwitch						"-io"					// number of files being read or written at once
+#define kTagReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kTagDefaultIOLimit					4
+#define kTagMaxWorkers						64
+#define kTagInitialCapacity					64
+#define kTagMaxLineLength					(kQTSysMaxPath + 1024)
+
+#define kTagListComment						'#'
+#define kTagListSeparator					'\t'
+#define kTagSetSeparator					'='
+
+// text items in the style of AddUserDataText
+#define kTagTypeLoop						FOUR_CHAR_CODE('LOOP')
+#define kTagTypeCompressedMovie				FOUR_CHAR_CODE('cmov')
+#define kTagTextLanguage					0						// the language code of the text we write (English)
+#define kTagCopyrightSign					((char)0xA9)			// first character of the standard text item types
+#define kTagCopyrightStandIn				'@'						// how to type it in an edit table: "@cpy" means '©cpy'
+
+// what an edit does
+enum {
+	kTagEditText							= 0,					// set the text of an item, in kTagTextLanguage
+	kTagEditData							= 1,					// replace the data of an item with the value's bytes
+	kTagEditLoop							= 2,					// set the looping state, like QTUtils_SetMovieFileLoopingInfo
+	kTagEditRemove							= 3						// remove every item of the type
+};
+
+// exit codes returned by QTTag_Main
+enum {
+	kTagExitSuccess							= 0,
+	kTagExitSomeFailed						= 1,
+	kTagExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// a single change to a movie's user data
+typedef struct QTTagEditRecord {
+	OSType					fType;					// of the user data item
+	long					fKind;					// one of the kTagEdit constants
+	char					*fValue;				// text or data; for kTagEditLoop, a big-endian long
+	UInt32					fLength;
+} QTTagEditRecord, *QTTagEditPtr;
+
+typedef struct QTTagEditListRecord {
+	QTTagEditPtr			fEdits;
+	long					fCount;
+	long					fCapacity;
+} QTTagEditListRecord, *QTTagEditListPtr;
+
+// one file to tag, and what happened to it
+typedef struct QTTagEntryRecord {
+	char					*fPath;
+	OSErr					fErr;
+	long					fMethod;				// how the movie atom was saved; one of the kUpdMethod constants
+	UInt32					fOldUserDataSize;		// of the movie's user data atom, or 0 if it had none
+	UInt32					fNewUserDataSize;
+	QTUInt64				fBytesRead;
+	QTUInt64				fBytesWritten;
+	QTUInt64				fMicroseconds;
+} QTTagEntryRecord, *QTTagEntryPtr;
+
+typedef struct QTTagFileListRecord {
+	QTTagEntryPtr			fEntries;
+	long					fCount;
+	long					fCapacity;
+} QTTagFileListRecord, *QTTagFileListPtr;
+
+// what QTTag_TagFiles did, all told
+typedef struct QTTagSummaryRecord {
+	long					fChangedCount;
+	long					fUnchangedCount;
+	long					fFailedCount;
+	QTUInt64				fBytesRead;
+	QTUInt64				fBytesWritten;
+	QTUInt64				fMicroseconds;
+} QTTagSummaryRecord, *QTTagSummaryPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTTag_ParseEdit (const char *theItem, const char *theValue, QTTagEditListPtr theEdits);
+OSErr						QTTag_ReadEdits (const char *thePath, QTTagEditListPtr theEdits);
+void						QTTag_DisposeEdits (QTTagEditListPtr theEdits);
+
+OSErr						QTTag_AddFile (QTTagFileListPtr theFiles, const char *thePath);
+OSErr						QTTag_ReadFileList (const char *thePath, QTTagFileListPtr theFiles);
+void						QTTag_DisposeFileList (QTTagFileListPtr theFiles);
+
+OSErr						QTTag_EditUserData (const UInt8 *theUserData, UInt32 theSize, QTTagEditListPtr theEdits, QTAtomBufferPtr theNewUserData);
+OSErr						QTTag_TagFile (QTTagEntryPtr theEntry, QTTagEditListPtr theEdits);
+OSErr						QTTag_TagFiles (QTTagFileListPtr theFiles, QTTagEditListPtr theEdits, long theWorkerCount, long theIOLimit, FILE *theReport, QTTagSummaryPtr theSummary);
+void						QTTag_WriteEntryReport (FILE *theReport, long theIndex, QTTagEntryPtr theEntry);
+
+Boolean						QTTag_IsTagCommandLine (int theArgc, char *theArgv[]);
+int							QTTag_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTTag__
@@ -0,0 +1,737 @@
+//////////
+//
+//	File:		QTTelemetry.c
+//
+//	Contains:	Portable functions for streaming the progress of long operations to other processes.
+//				All utilities start with the prefix "QTTel_".
+//
+//	The progress dialog box tells a person at the screen how an operation is going; nobody sees it when
+//	we run headless on a render farm. So a progress procedure can also report to a telemetry stream,
+//	which writes newline-delimited JSON events to a sink: standard output, a file, a named pipe or a
+//	Unix-domain socket. A stream writes a "start" event when the operation begins, a "progress" event
+//	at most once per interval and an "end" event when it finishes. Each event carries the operation,
+//	the percentage done, bytes in and out, frames processed, the throughput since the previous event
+//	and the estimated time remaining. Values we don't know are null.
+//
+//	QuickTime tells a progress procedure only the fraction done, so bytes in and frames processed are
+//	that fraction of the input's size and frame count; bytes out is the size of the output file so far.
+//
+//	The default sink is named by the environment variable QTDATAEX_TELEMETRY, just as QTDATAEX_TRACE
+//	names the trace file (see QTSystem.c): "-" for standard output, "file:", "pipe:" or "unix:" followed
+//	by a path, or just a path, which means a file. QTDATAEX_TELEMETRY_INTERVAL sets the interval.
+//
+//	Telemetry must never slow down or stop the operation it reports on. Pipes and sockets are written
+//	without blocking; if the reader falls behind we drop whole events (the gap in the "sequence" numbers
+//	shows how many), and if the reader goes away we stop writing altogether.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTTelemetry.h"
+
+#include <stdarg.h>
+
+#if defined(_WIN32)
+#ifndef _WINDOWS_
+#include <windows.h>
+#endif
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kTelDefaultUnknown				0						// states of the default sink
+#define kTelDefaultOpening				1
+#define kTelDefaultOff					2
+#define kTelDefaultOn					3
+
+
+//////////
+//
+// global variables
+//
+//////////
+
+static volatile long		gTelDefaultState = kTelDefaultUnknown;
+static QTTelSinkPtr			gTelDefaultSink = NULL;
+
+
+//////////
+//
+// data types
+//
+//////////
+
+struct QTTelSinkRecord {
+	long					fKind;					// one of the kTelSink constants
+#if defined(_WIN32)
+	HANDLE					fHandle;
+#else
+	int						fDescriptor;
+#endif
+	QTSysMutex				fMutex;					// keeps the events of different streams from interleaving
+	long					fIntervalMilliseconds;
+	volatile long			fSequence;				// events written or dropped
+	volatile long			fDroppedCount;
+	Boolean					fBroken;				// the reader has gone away
+	long					fPendingOffset;			// the unwritten end of an event that only partly fit
+	long					fPendingLength;
+	char					fPending[kTelMaxEventLength];
+};
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static long					QTTel_WriteBytes (QTTelSinkPtr theSink, const char *theBuffer, long theLength);
+static void					QTTel_WriteEvent (QTTelSinkPtr theSink, const char *theEvent, long theLength);
+static void					QTTel_EmitEvent (QTTelStreamPtr theStream, const char *theEvent, OSErr theErr);
+static void					QTTel_Append (char *theBuffer, long *theLength, const char *theFormat, ...);
+static void					QTTel_AppendString (char *theBuffer, long *theLength, const char *theString);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Sink functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTel_OpenSink
+// Open the sink that theSpec names; streams that use it write a progress event at most once every
+// theIntervalMilliseconds.
+//
+// A named pipe must already have a reader, and a socket a listener; otherwise we fail, rather than
+// wait, since the operation shouldn't be held up by its telemetry. There are no Unix-domain sockets
+// on the Windows systems we support, so there a "unix:" sink fails with unimpErr; use a named pipe
+// ("pipe:\\.\pipe\name") instead.
+//
+//////////
+
+OSErr QTTel_OpenSink (const char *theSpec, long theIntervalMilliseconds, QTTelSinkPtr *theSink)
+{
+	QTTelSinkPtr		mySink = NULL;
+	const char			*myPath = theSpec;
+	long				myKind = kTelSinkFile;
+	OSErr				myErr = noErr;
+
+	*theSink = NULL;
+
+	if ((theSpec == NULL) || (theSpec[0] == '\0'))
+		return(paramErr);
+
+	if (strcmp(theSpec, "-") == 0) {
+		myKind = kTelSinkStdout;
+	} else if (strncmp(theSpec, kTelFilePrefix, strlen(kTelFilePrefix)) == 0) {
+		myPath = theSpec + strlen(kTelFilePrefix);
+	} else if (strncmp(theSpec, kTelPipePrefix, strlen(kTelPipePrefix)) == 0) {
+		myKind = kTelSinkPipe;
+		myPath = theSpec + strlen(kTelPipePrefix);
+	} else if (strncmp(theSpec, kTelSocketPrefix, strlen(kTelSocketPrefix)) == 0) {
+		myKind = kTelSinkSocket;
+		myPath = theSpec + strlen(kTelSocketPrefix);
+	}
+
+	if ((myKind != kTelSinkStdout) && (myPath[0] == '\0'))
+		return(paramErr);
+
+	mySink = (QTTelSinkPtr)calloc(1, sizeof(struct QTTelSinkRecord));
+	if (mySink == NULL)
+		return(memFullErr);
+
+	mySink->fKind = myKind;
+	mySink->fIntervalMilliseconds = (theIntervalMilliseconds > 0) ? theIntervalMilliseconds : kTelDefaultIntervalMilliseconds;
+
+#if defined(_WIN32)
+	mySink->fHandle = INVALID_HANDLE_VALUE;
+
+	switch (myKind) {
+		case kTelSinkStdout:
+			mySink->fHandle = GetStdHandle(STD_OUTPUT_HANDLE);
+			break;
+
+		case kTelSinkFile:
+			mySink->fHandle = CreateFileA(myPath, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+			break;
+
+		case kTelSinkPipe:
+			mySink->fHandle = CreateFileA(myPath, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (mySink->fHandle != INVALID_HANDLE_VALUE) {
+				DWORD		myMode = PIPE_READMODE_BYTE | PIPE_NOWAIT;
+
+				SetNamedPipeHandleState(mySink->fHandle, &myMode, NULL, NULL);
+			}
+			break;
+
+		case kTelSinkSocket:
+			myErr = unimpErr;
+			goto bail;
+	}
+
+	if ((mySink->fHandle == INVALID_HANDLE_VALUE) || (mySink->fHandle == NULL)) {
+		myErr = (GetLastError() == ERROR_FILE_NOT_FOUND) ? fnfErr : ioErr;
+		goto bail;
+	}
+#else
+	mySink->fDescriptor = -1;
+
+	switch (myKind) {
+		case kTelSinkStdout:
+			mySink->fDescriptor = STDOUT_FILENO;
+			break;
+
+		case kTelSinkFile:
+			mySink->fDescriptor = open(myPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+			break;
+
+		case kTelSinkPipe:
+			// this fails with ENXIO if nobody has the pipe open for reading
+			mySink->fDescriptor = open(myPath, O_WRONLY | O_NONBLOCK);
+			break;
+
+		case kTelSinkSocket: {
+			struct sockaddr_un		myAddress;
+
+			if (strlen(myPath) >= sizeof(myAddress.sun_path)) {
+				myErr = paramErr;
+				goto bail;
+			}
+
+			memset(&myAddress, 0, sizeof(myAddress));
+			myAddress.sun_family = AF_UNIX;
+			strcpy(myAddress.sun_path, myPath);
+
+			mySink->fDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+			if ((mySink->fDescriptor >= 0) && (connect(mySink->fDescriptor, (struct sockaddr *)&myAddress, sizeof(myAddress)) != 0)) {
+				int		myError = errno;
+
+				close(mySink->fDescriptor);
+				mySink->fDescriptor = -1;
+				errno = myError;
+			}
+
+			if (mySink->fDescriptor >= 0)
+				fcntl(mySink->fDescriptor, F_SETFL, fcntl(mySink->fDescriptor, F_GETFL) | O_NONBLOCK);
+			break;
+		}
+	}
+
+	if (mySink->fDescriptor < 0) {
+		myErr = ((errno == ENOENT) || (errno == ENXIO) || (errno == ECONNREFUSED)) ? fnfErr : ioErr;
+		goto bail;
+	}
+
+	// a reader that goes away should make our writes fail with EPIPE, not kill the process
+	if ((myKind == kTelSinkPipe) || (myKind == kTelSinkSocket))
+		signal(SIGPIPE, SIG_IGN);
+#endif
+
+	myErr = QTSys_NewMutex(&mySink->fMutex);
+	if (myErr != noErr)
+		goto bail;
+
+	*theSink = mySink;
+	mySink = NULL;
+
+bail:
+	if (mySink != NULL)
+		QTTel_CloseSink(mySink);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTTel_CloseSink
+// Close a sink and dispose of it; no stream may be using it.
+//
+//////////
+
+void QTTel_CloseSink (QTTelSinkPtr theSink)
+{
+	if (theSink == NULL)
+		return;
+
+#if defined(_WIN32)
+	if ((theSink->fKind != kTelSinkStdout) && (theSink->fHandle != INVALID_HANDLE_VALUE) && (theSink->fHandle != NULL))
+		CloseHandle(theSink->fHandle);
+#else
+	if ((theSink->fKind != kTelSinkStdout) && (theSink->fDescriptor >= 0))
+		close(theSink->fDescriptor);
+#endif
+
+	if (theSink->fMutex != NULL)
+		QTSys_DisposeMutex(theSink->fMutex);
+
+	free(theSink);
+}
+
+
+//////////
+//
+// QTTel_GetDefaultSink
+// Return the sink named by the environment variable QTDATAEX_TELEMETRY, or NULL if there is none.
+//
+// The first call opens the sink; while it does that, other threads see telemetry as turned off. The
+// default sink stays open until the process quits.
+//
+//////////
+
+QTTelSinkPtr QTTel_GetDefaultSink (void)
+{
+	const char		*mySpec;
+	const char		*myInterval;
+	long			myState = QTSys_AtomicLoad(&gTelDefaultState);
+
+	if (myState != kTelDefaultUnknown)
+		return((myState == kTelDefaultOn) ? gTelDefaultSink : NULL);
+
+	if (!QTSys_AtomicCompareAndSwap(&gTelDefaultState, kTelDefaultUnknown, kTelDefaultOpening))
+		return(NULL);
+
+	mySpec = getenv(kTelSinkVariable);
+	myInterval = getenv(kTelIntervalVariable);
+	if ((mySpec != NULL) && (mySpec[0] != '\0')) {
+		if (QTTel_OpenSink(mySpec, (myInterval != NULL) ? atol(myInterval) : 0, &gTelDefaultSink) != noErr)
+			QTSys_Trace("{\"trace\":\"telemetry\",\"error\":\"cannot open sink\"}");
+	}
+
+	QTSys_AtomicStore(&gTelDefaultState, (gTelDefaultSink != NULL) ? kTelDefaultOn : kTelDefaultOff);
+
+	return(gTelDefaultSink);
+}
+
+
+//////////
+//
+// QTTel_GetEventCount
+// Return the number of events that streams have tried to write to a sink, whether or not they got through.
+//
+//////////
+
+long QTTel_GetEventCount (QTTelSinkPtr theSink)
+{
+	return((theSink != NULL) ? QTSys_AtomicLoad(&theSink->fSequence) : 0);
+}
+
+
+//////////
+//
+// QTTel_GetDroppedCount
+// Return the number of events we dropped because the sink's reader was too slow or had gone away.
+//
+//////////
+
+long QTTel_GetDroppedCount (QTTelSinkPtr theSink)
+{
+	return((theSink != NULL) ? QTSys_AtomicLoad(&theSink->fDroppedCount) : 0);
+}
+
+
+//////////
+//
+// QTTel_WriteBytes
+// Write as much of theBuffer to the sink as it will take without blocking; return the number of bytes
+// written, or -1 if the sink is broken. Files and standard output take everything.
+//
+//////////
+
+static long QTTel_WriteBytes (QTTelSinkPtr theSink, const char *theBuffer, long theLength)
+{
+	long			myTotal = 0;
+
+#if defined(_WIN32)
+	DWORD			myCount;
+
+	while (myTotal < theLength) {
+		myCount = 0;
+		if (!WriteFile(theSink->fHandle, theBuffer + myTotal, (DWORD)(theLength - myTotal), &myCount, NULL))
+			return((myTotal > 0) ? myTotal : -1);
+
+		// a non-blocking pipe that is full takes nothing
+		if (myCount == 0)
+			break;
+
+		myTotal += (long)myCount;
+	}
+#else
+	ssize_t			myCount;
+
+	while (myTotal < theLength) {
+		myCount = write(theSink->fDescriptor, theBuffer + myTotal, (size_t)(theLength - myTotal));
+		if (myCount < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				break;
+			return((myTotal > 0) ? myTotal : -1);
+		}
+
+		myTotal += (long)myCount;
+	}
+#endif
+
+	return(myTotal);
+}
+
+
+//////////
+//
+// QTTel_WriteEvent
+// Write one event (a line, with its newline) to the sink, or drop it. The caller holds the sink's mutex.
+//
+// We never split an event between two lines of the output: if only the start of an event fits, we keep
+// the rest and write it before the next event, and drop the events that arrive in the meantime.
+//
+//////////
+
+static void QTTel_WriteEvent (QTTelSinkPtr theSink, const char *theEvent, long theLength)
+{
+	long			myCount;
+
+	if (theSink->fBroken)
+		goto dropped;
+
+	if (theSink->fPendingOffset < theSink->fPendingLength) {
+		myCount = QTTel_WriteBytes(theSink, theSink->fPending + theSink->fPendingOffset, theSink->fPendingLength - theSink->fPendingOffset);
+		if (myCount < 0) {
+			theSink->fBroken = true;
+			goto dropped;
+		}
+
+		theSink->fPendingOffset += myCount;
+		if (theSink->fPendingOffset < theSink->fPendingLength)
+			goto dropped;
+	}
+
+	myCount = QTTel_WriteBytes(theSink, theEvent, theLength);
+	if (myCount < 0) {
+		theSink->fBroken = true;
+		goto dropped;
+	}
+
+	if (myCount == 0)
+		goto dropped;
+
+	if (myCount < theLength) {
+		memcpy(theSink->fPending, theEvent + myCount, (size_t)(theLength - myCount));
+		theSink->fPendingOffset = 0;
+		theSink->fPendingLength = theLength - myCount;
+	}
+
+	return;
+
+dropped:
+	QTSys_AtomicAdd(&theSink->fDroppedCount, 1);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Stream functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTTel_BeginStream
+// Start reporting on an operation, and write its "start" event. If theSink is NULL, the stream (and
+// every call on it) does nothing.
+//
+// The operation name and the output path must stay valid until QTTel_EndStream; we copy the job name.
+// The estimator, if any, belongs to the caller, who keeps it up to date.
+//
+//////////
+
+void QTTel_BeginStream (QTTelStreamPtr theStream, QTTelSinkPtr theSink, const char *theJobName, const char *theOperation, OSType theFileType, const char *theOutPath, QTUInt64 theInputBytes, QTUInt64 theTotalFrames, QTEstimatorPtr theEstimator)
+{
+	memset(theStream, 0, sizeof(QTTelStreamRecord));
+
+	if (theSink == NULL)
+		return;
+
+	theStream->fSink = theSink;
+	if (theJobName != NULL) {
+		strncpy(theStream->fJobName, theJobName, sizeof(theStream->fJobName) - 1);
+		theStream->fJobName[sizeof(theStream->fJobName) - 1] = '\0';
+	}
+
+	theStream->fOperation = (theOperation != NULL) ? theOperation : "unknown";
+	theStream->fFileType = theFileType;
+	theStream->fOutPath = theOutPath;
+	theStream->fInputBytes = theInputBytes;
+	theStream->fTotalFrames = theTotalFrames;
+	theStream->fEstimator = theEstimator;
+	theStream->fStartTime = QTSys_GetMicroseconds();
+	theStream->fLastEventTime = theStream->fStartTime;
+	theStream->fNextEventTime = theStream->fStartTime + ((QTUInt64)theSink->fIntervalMilliseconds * 1000);
+
+	QTTel_EmitEvent(theStream, "start", noErr);
+}
+
+
+//////////
+//
+// QTTel_UpdateStream
+// Record how far the operation has got, and write a "progress" event if one is due.
+//
+// A progress procedure can call this every time it is called; unless an event is due, all it costs is
+// reading the clock.
+//
+//////////
+
+void QTTel_UpdateStream (QTTelStreamPtr theStream, long thePercentDone)
+{
+	QTUInt64		myNow;
+
+	if (theStream->fSink == NULL)
+		return;
+
+	if (thePercentDone < 0)
+		thePercentDone = 0;
+	if (thePercentDone > kProgDone)
+		thePercentDone = kProgDone;
+
+	theStream->fPercentDone = thePercentDone;
+
+	myNow = QTSys_GetMicroseconds();
+	if (myNow < theStream->fNextEventTime)
+		return;
+
+	QTTel_EmitEvent(theStream, "progress", noErr);
+	theStream->fNextEventTime = myNow + ((QTUInt64)theStream->fSink->fIntervalMilliseconds * 1000);
+}
+
+
+//////////
+//
+// QTTel_EndStream
+// Write the operation's "end" event; theErr is the operation's result. The stream can then be begun again.
+//
+//////////
+
+void QTTel_EndStream (QTTelStreamPtr theStream, OSErr theErr)
+{
+	if (theStream->fSink == NULL)
+		return;
+
+	if (theErr == noErr)
+		theStream->fPercentDone = kProgDone;
+
+	QTTel_EmitEvent(theStream, "end", theErr);
+	theStream->fSink = NULL;
+}
+
+
+//////////
+//
+// QTTel_EmitEvent
+// Format an event describing the stream's current state, and write it to the stream's sink.
+//
+//////////
+
+static void QTTel_EmitEvent (QTTelStreamPtr theStream, const char *theEvent, OSErr theErr)
+{
+	QTTelSinkPtr	mySink = theStream->fSink;
+	char			myEvent[kTelMaxEventLength];
+	long			myLength = 0;
+	QTUInt64		myNow = QTSys_GetMicroseconds();
+	QTUInt64		myBytesIn = 0;
+	QTUInt64		myBytesOut = 0;
+	QTUInt64		myFrames = 0;
+	QTUInt64		myBytes = 0;
+	Boolean			myHasBytesIn = (theStream->fInputBytes != 0);
+	Boolean			myHasBytesOut = false;
+	Boolean			myHasBytes = false;
+	Boolean			myHasFrames = (theStream->fTotalFrames != 0);
+	double			myDone = (double)theStream->fPercentDone / (double)kProgDone;
+	double			mySeconds = (myNow > theStream->fLastEventTime) ? (double)(myNow - theStream->fLastEventTime) / 1000000.0 : 0.0;
+	long			myRemaining = kEstUnknown;
+
+	// work out everything we can before we take the sink's mutex
+	if (myHasBytesIn)
+		myBytesIn = (QTUInt64)(myDone * (double)(QTSInt64)theStream->fInputBytes);
+	if (myHasFrames)
+		myFrames = (QTUInt64)(myDone * (double)(QTSInt64)theStream->fTotalFrames);
+	if (theStream->fOutPath != NULL)
+		myHasBytesOut = (QTSys_GetPathSize(theStream->fOutPath, &myBytesOut) == noErr);
+
+	// the throughput is measured in output bytes if we can see the output, and in input bytes otherwise
+	if (myHasBytesOut) {
+		myBytes = myBytesOut;
+		myHasBytes = true;
+	} else if (myHasBytesIn) {
+		myBytes = myBytesIn;
+		myHasBytes = true;
+	}
+
+	if (strcmp(theEvent, "end") == 0)
+		myRemaining = (theErr == noErr) ? 0 : kEstUnknown;
+	else if (theStream->fEstimator != NULL)
+		myRemaining = QTEst_GetRemainingMilliseconds(theStream->fEstimator);
+
+	QTSys_LockMutex(mySink->fMutex);
+
+	QTTel_Append(myEvent, &myLength, "{\"event\":\"%s\",\"sequence\":%ld,\"pid\":%lu,\"job\":", theEvent, mySink->fSequence + 1, QTSys_GetProcessID());
+	QTTel_AppendString(myEvent, &myLength, theStream->fJobName);
+	QTTel_Append(myEvent, &myLength, ",\"operation\":");
+	QTTel_AppendString(myEvent, &myLength, theStream->fOperation);
+
+	if (theStream->fFileType != 0) {
+		char		myType[5];
+
+		myType[0] = (char)((theStream->fFileType >> 24) & 0xFF);
+		myType[1] = (char)((theStream->fFileType >> 16) & 0xFF);
+		myType[2] = (char)((theStream->fFileType >> 8) & 0xFF);
+		myType[3] = (char)(theStream->fFileType & 0xFF);
+		myType[4] = '\0';
+		QTTel_Append(myEvent, &myLength, ",\"fileType\":");
+		QTTel_AppendString(myEvent, &myLength, myType);
+	}
+
+	QTTel_Append(myEvent, &myLength, ",\"elapsedMilliseconds\":%llu,\"percent\":%.2f",
+					(unsigned long long)((myNow - theStream->fStartTime) / 1000), 100.0 * myDone);
+
+	if (myHasBytesIn)
+		QTTel_Append(myEvent, &myLength, ",\"bytesIn\":%llu,\"bytesInTotal\":%llu", (unsigned long long)myBytesIn, (unsigned long long)theStream->fInputBytes);
+	else
+		QTTel_Append(myEvent, &myLength, ",\"bytesIn\":null,\"bytesInTotal\":null");
+
+	if (myHasBytesOut)
+		QTTel_Append(myEvent, &myLength, ",\"bytesOut\":%llu", (unsigned long long)myBytesOut);
+	else
+		QTTel_Append(myEvent, &myLength, ",\"bytesOut\":null");
+
+	if (myHasFrames)
+		QTTel_Append(myEvent, &myLength, ",\"frames\":%llu,\"framesTotal\":%llu", (unsigned long long)myFrames, (unsigned long long)theStream->fTotalFrames);
+	else
+		QTTel_Append(myEvent, &myLength, ",\"frames\":null,\"framesTotal\":null");
+
+	// the throughput is instantaneous: it covers the time since the stream's previous event
+	if (myHasBytes && (mySeconds > 0.0) && (myBytes >= theStream->fLastBytes))
+		QTTel_Append(myEvent, &myLength, ",\"bytesPerSecond\":%.0f", (double)(QTSInt64)(myBytes - theStream->fLastBytes) / mySeconds);
+	else
+		QTTel_Append(myEvent, &myLength, ",\"bytesPerSecond\":null");
+
+	if (myHasFrames && (mySeconds > 0.0) && (myFrames >= theStream->fLastFrames))
+		QTTel_Append(myEvent, &myLength, ",\"framesPerSecond\":%.2f", (double)(QTSInt64)(myFrames - theStream->fLastFrames) / mySeconds);
+	else
+		QTTel_Append(myEvent, &myLength, ",\"framesPerSecond\":null");
+
+	if (myRemaining != kEstUnknown)
+		QTTel_Append(myEvent, &myLength, ",\"remainingMilliseconds\":%ld", myRemaining);
+	else
+		QTTel_Append(myEvent, &myLength, ",\"remainingMilliseconds\":null");
+
+	if (strcmp(theEvent, "end") == 0)
+		QTTel_Append(myEvent, &myLength, ",\"status\":\"%s\",\"err\":%d",
+					(theErr == noErr) ? "done" : ((theErr == userCanceledErr) ? "cancelled" : "failed"), (int)theErr);
+
+	QTTel_Append(myEvent, &myLength, "}\n");
+
+	// an event that didn't fit is no use to anyone; we count it as dropped
+	QTSys_AtomicAdd(&mySink->fSequence, 1);
+	if ((myLength > 0) && (myEvent[myLength - 1] == '\n'))
+		QTTel_WriteEvent(mySink, myEvent, myLength);
+	else
+		QTSys_AtomicAdd(&mySink->fDroppedCount, 1);
+
+	QTSys_UnlockMutex(mySink->fMutex);
+
+	theStream->fLastEventTime = myNow;
+	theStream->fLastBytes = myBytes;
+	theStream->fLastFrames = myFrames;
+}
+
+
+//////////
+//
+// QTTel_Append
+// Append formatted text to an event of theLength bytes. If the text doesn't fit, the event stays
+// unterminated, and so is never written.
+//
+//////////
+
+static void QTTel_Append (char *theBuffer, long *theLength, const char *theFormat, ...)
+{
+	va_list			myArgs;
+	long			mySpace = kTelMaxEventLength - *theLength;
+	int				myCount;
+
+	if (mySpace <= 1)
+		return;
+
+	va_start(myArgs, theFormat);
+#if defined(_MSC_VER)
+	myCount = _vsnprintf(theBuffer + *theLength, (size_t)mySpace, theFormat, myArgs);
+#else
+	myCount = vsnprintf(theBuffer + *theLength, (size_t)mySpace, theFormat, myArgs);
+#endif
+	va_end(myArgs);
+
+	if ((myCount < 0) || (myCount >= mySpace)) {
+		// leave the event full, so that nothing more is appended
+		*theLength = kTelMaxEventLength;
+		return;
+	}
+
+	*theLength += myCount;
+}
+
+
+//////////
+//
+// QTTel_AppendString
+// Append a C string to an event, as a quoted, escaped JSON string.
+//
+// We escape just as QTSys_WriteJSONString does, but into memory, since a whole event must go to the
+// sink in one write.
+//
+//////////
+
+static void QTTel_AppendString (char *theBuffer, long *theLength, const char *theString)
+{
+	const unsigned char		*myChar;
+
+	QTTel_Append(theBuffer, theLength, "\"");
+
+	for (myChar = (const unsigned char *)theString; (myChar != NULL) && (*myChar != '\0'); myChar++) {
+		switch (*myChar) {
+			case '"':	QTTel_Append(theBuffer, theLength, "\\\"");	break;
+			case '\\':	QTTel_Append(theBuffer, theLength, "\\\\");	break;
+			case '\n':	QTTel_Append(theBuffer, theLength, "\\n");	break;
+			case '\r':	QTTel_Append(theBuffer, theLength, "\\r");	break;
+			case '\t':	QTTel_Append(theBuffer, theLength, "\\t");	break;
+			default:
+				if (*myChar < 0x20)
+					QTTel_Append(theBuffer, theLength, "\\u%04x", *myChar);
+				else
+					QTTel_Append(theBuffer, theLength, "%c", *myChar);
+				break;
+		}
+	}
+
+	QTTel_Append(theBuffer, theLength, "\"");
+}
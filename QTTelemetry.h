@@ -0,0 +1,95 @@
+//////////
+//
+//	File:		QTTelemetry.h
+//
+//	Contains:	Portable functions for streaming the progress of long operations to other processes.
+//				All utilities start with the prefix "QTTel_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTTelemetry__
+#define __QTTelemetry__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTEstimate.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kTelSinkVariable					"QTDATAEX_TELEMETRY"			// environment variable naming the default sink; see QTTel_OpenSink
+#define kTelIntervalVariable				"QTDATAEX_TELEMETRY_INTERVAL"	// and how often it gets progress events, in milliseconds
+
+#define kTelFilePrefix						"file:"
+#define kTelPipePrefix						"pipe:"
+#define kTelSocketPrefix					"unix:"
+
+#define kTelDefaultIntervalMilliseconds		1000
+#define kTelMaxEventLength					1024					// longest line we write; longer job names are cut short
+#define kTelMaxJobNameLength				128
+
+// kinds of sink
+enum {
+	kTelSinkStdout							= 0,
+	kTelSinkFile							= 1,					// appended to
+	kTelSinkPipe							= 2,					// a named pipe (FIFO) that someone is already reading
+	kTelSinkSocket							= 3						// a Unix-domain stream socket that someone is listening on
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTTelSinkRecord				*QTTelSinkPtr;
+
+// the telemetry of one operation; only the operation's own thread may use it, but any number of
+// streams (on any threads) can share a sink
+typedef struct QTTelStreamRecord {
+	QTTelSinkPtr			fSink;					// NULL if telemetry is turned off; every function then does nothing
+	char					fJobName[kTelMaxJobNameLength];
+	const char				*fOperation;			// "export", "import" and so on; a string constant
+	OSType					fFileType;				// the output file type, or 0
+	const char				*fOutPath;				// the output file, whose size is bytesOut; may be NULL
+	QTUInt64				fInputBytes;			// size of the input, or 0 if unknown
+	QTUInt64				fTotalFrames;			// frames in the input, or 0 if unknown
+	QTEstimatorPtr			fEstimator;				// supplies the remaining time; may be NULL
+	QTUInt64				fStartTime;				// microseconds
+	QTUInt64				fNextEventTime;
+	QTUInt64				fLastEventTime;
+	QTUInt64				fLastBytes;				// bytes out (or in) at the last event, for the throughput
+	QTUInt64				fLastFrames;
+	long					fPercentDone;			// 0 to kProgDone
+} QTTelStreamRecord, *QTTelStreamPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTTel_OpenSink (const char *theSpec, long theIntervalMilliseconds, QTTelSinkPtr *theSink);
+void						QTTel_CloseSink (QTTelSinkPtr theSink);
+QTTelSinkPtr				QTTel_GetDefaultSink (void);
+long						QTTel_GetEventCount (QTTelSinkPtr theSink);
+long						QTTel_GetDroppedCount (QTTelSinkPtr theSink);
+
+void						QTTel_BeginStream (QTTelStreamPtr theStream, QTTelSinkPtr theSink, const char *theJobName, const char *theOperation, OSType theFileType, const char *theOutPath, QTUInt64 theInputBytes, QTUInt64 theTotalFrames, QTEstimatorPtr theEstimator);
+void						QTTel_UpdateStream (QTTelStreamPtr theStream, long thePercentDone);
+void						QTTel_EndStream (QTTelStreamPtr theStream, OSErr theErr);
+
+#endif	// __QTTelemetry__
@@ -0,0 +1,801 @@
+//////////
+//
+//	File:		QTTypeRegistry.c
+//
+//	Contains:	A portable, immutable index of the file types and extensions that QTDataEx can open.
+//				All utilities start with the prefix "QTReg_".
+//
+//	The file-opening dialog box calls our filter function once for every item in a folder, and the
+//	filter used to look for the item's file type in gValidFileTypes, an unsorted list of every type
+//	that a movie importer or graphics importer can open. That's fine for a folder of ten files and
+//	not fine at all for a 100,000-file folder on a network share, where the filter does one linear
+//	scan of a few hundred types per item.
+//
+//	Here, we collect the same information in a QTRegBuilderRecord and then freeze it into a registry:
+//	a compact array of entries and an open-addressed hash table over it, never more than half full, so
+//	a lookup costs one hash and (almost always) one probe. A registry never changes once it's built, so
+//	any number of threads can look things up in it without locking. Each entry also says which importer
+//	handles the type, so callers that go on to open the file don't have to search for the component again.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTTypeRegistry.h"
+#include "QTSettings.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kRegMaxExtensionLength		4						// extensions are packed into an OSType
+#define kRegBenchmarkKnownPercent	60						// share of the synthetic listing that we can open
+
+#define kRegFingerprintPrime		(((QTUInt64)0x00000100UL << 32) | 0x000001B3UL)		// the 64-bit FNV prime
+#define kRegCacheHeaderSize			20						// magic, version, fingerprint, entry count
+#define kRegCacheEntrySize			20						// key, key kind, component type, subtype, manufacturer
+#define kRegCacheTrailerSize		8						// checksum of everything before it
+#define kRegMaxCacheEntries			0x00100000				// more than any real set of components
+
+
+//////////
+//
+// data types
+//
+//////////
+
+struct QTTypeRegistryRecord {
+	QTRegEntryPtr			fEntries;
+	long					fCount;
+	UInt32					*fSlots;				// 1-based indexes into fEntries; 0 marks an empty slot
+	UInt32					fMask;					// the number of slots, minus 1
+};
+
+
+//////////
+//
+// QTReg_Hash
+// Hash a key; the kind is mixed in so that the file type 'jpg ' and the extension "jpg" don't collide.
+//
+//////////
+
+QTSYS_INLINE UInt32 QTReg_Hash (OSType theKey, long theKeyKind)
+{
+	UInt32			myHash = ((UInt32)theKey ^ ((UInt32)theKeyKind * 0x85EBCA6BUL)) * 0x9E3779B1UL;
+
+	return(myHash ^ (myHash >> 16));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Builder functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTReg_InitBuilder
+// Prepare an empty builder.
+//
+//////////
+
+void QTReg_InitBuilder (QTRegBuilderPtr theBuilder)
+{
+	memset(theBuilder, 0, sizeof(QTRegBuilderRecord));
+}
+
+
+//////////
+//
+// QTReg_DisposeBuilder
+// Release the memory held by a builder.
+//
+//////////
+
+void QTReg_DisposeBuilder (QTRegBuilderPtr theBuilder)
+{
+	if (theBuilder == NULL)
+		return;
+
+	free(theBuilder->fEntries);
+	memset(theBuilder, 0, sizeof(QTRegBuilderRecord));
+}
+
+
+//////////
+//
+// QTReg_AddEntry
+// Append one entry to a builder, growing it as needed.
+//
+//////////
+
+static OSErr QTReg_AddEntry (QTRegBuilderPtr theBuilder, OSType theKey, long theKeyKind, OSType theComponentType, OSType theSubType, OSType theManufacturer)
+{
+	QTRegEntryPtr	myEntry;
+
+	if (theBuilder == NULL)
+		return(paramErr);
+
+	if (theBuilder->fErr != noErr)
+		return(theBuilder->fErr);
+
+	if (theBuilder->fCount == theBuilder->fCapacity) {
+		long			myCapacity = (theBuilder->fCapacity > 0) ? (2 * theBuilder->fCapacity) : kRegInitialBuilderCapacity;
+		QTRegEntryPtr	myEntries = (QTRegEntryPtr)realloc(theBuilder->fEntries, (size_t)myCapacity * sizeof(QTRegEntryRecord));
+
+		if (myEntries == NULL) {
+			theBuilder->fErr = memFullErr;
+			return(memFullErr);
+		}
+
+		theBuilder->fEntries = myEntries;
+		theBuilder->fCapacity = myCapacity;
+	}
+
+	myEntry = &theBuilder->fEntries[theBuilder->fCount++];
+	myEntry->fKey = theKey;
+	myEntry->fKeyKind = theKeyKind;
+	myEntry->fComponentType = theComponentType;
+	myEntry->fComponentSubType = theSubType;
+	myEntry->fComponentManufacturer = theManufacturer;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTReg_AddFileType
+// Record that files of the specified type can be opened using the specified component.
+//
+//////////
+
+OSErr QTReg_AddFileType (QTRegBuilderPtr theBuilder, OSType theFileType, OSType theComponentType, OSType theSubType, OSType theManufacturer)
+{
+	return(QTReg_AddEntry(theBuilder, theFileType, kRegKeyFileType, theComponentType, theSubType, theManufacturer));
+}
+
+
+//////////
+//
+// QTReg_AddExtension
+// Record that files with the specified extension can be opened using the specified component.
+//
+// Extensions longer than four characters can't be represented, so we quietly ignore them.
+//
+//////////
+
+OSErr QTReg_AddExtension (QTRegBuilderPtr theBuilder, const char *theExtension, OSType theComponentType, OSType theSubType, OSType theManufacturer)
+{
+	OSType			myKey = QTReg_ExtensionToKey(theExtension);
+
+	if (myKey == 0)
+		return(noErr);
+
+	return(QTReg_AddEntry(theBuilder, myKey, kRegKeyExtension, theComponentType, theSubType, theManufacturer));
+}
+
+
+//////////
+//
+// QTReg_ExtensionToKey
+// Pack a file name extension (without the period) into an OSType, folded to lowercase and padded with spaces.
+//
+// Returns 0 for an empty extension or one that is longer than four characters. Importers that declare
+// movieImportSubTypeIsFileExtension use an extension packed this way (uppercase) as their subtype.
+//
+//////////
+
+OSType QTReg_ExtensionToKey (const char *theExtension)
+{
+	OSType			myKey = 0;
+	size_t			myLength;
+	size_t			myIndex;
+
+	if (theExtension == NULL)
+		return(0);
+
+	myLength = strlen(theExtension);
+	if ((myLength == 0) || (myLength > kRegMaxExtensionLength))
+		return(0);
+
+	for (myIndex = 0; myIndex < kRegMaxExtensionLength; myIndex++) {
+		unsigned char	myChar = (myIndex < myLength) ? (unsigned char)theExtension[myIndex] : ' ';
+
+		if ((myChar >= 'A') && (myChar <= 'Z'))
+			myChar += 'a' - 'A';
+
+		myKey = (myKey << 8) | myChar;
+	}
+
+	return(myKey);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Registry functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTReg_FindSlot
+// Return the slot that holds the specified key, or the empty slot where it would go.
+//
+//////////
+
+static UInt32 QTReg_FindSlot (QTTypeRegistryPtr theRegistry, OSType theKey, long theKeyKind)
+{
+	UInt32			mySlot = QTReg_Hash(theKey, theKeyKind) & theRegistry->fMask;
+
+	// the table is never more than half full, so this always ends
+	while (theRegistry->fSlots[mySlot] != 0) {
+		QTRegEntryPtr	myEntry = &theRegistry->fEntries[theRegistry->fSlots[mySlot] - 1];
+
+		if ((myEntry->fKey == theKey) && (myEntry->fKeyKind == theKeyKind))
+			break;
+
+		mySlot = (mySlot + 1) & theRegistry->fMask;
+	}
+
+	return(mySlot);
+}
+
+
+//////////
+//
+// QTReg_NewRegistry
+// Freeze the entries collected by a builder into a registry; the builder can then be disposed of.
+//
+// If the builder holds several entries for one key, the first one wins; so add the components you
+// prefer first (QTFrame_BuildFileTypeList adds movie importers before graphics importers).
+//
+//////////
+
+OSErr QTReg_NewRegistry (QTRegBuilderPtr theBuilder, QTTypeRegistryPtr *theRegistry)
+{
+	QTTypeRegistryPtr	myRegistry = NULL;
+	UInt32				mySlotCount = 4;
+	long				myIndex;
+	OSErr				myErr = noErr;
+
+	if ((theBuilder == NULL) || (theRegistry == NULL))
+		return(paramErr);
+
+	*theRegistry = NULL;
+
+	if (theBuilder->fErr != noErr)
+		return(theBuilder->fErr);
+
+	// keep the table at most half full
+	while (mySlotCount < 2 * (UInt32)theBuilder->fCount)
+		mySlotCount *= 2;
+
+	myRegistry = (QTTypeRegistryPtr)calloc(1, sizeof(struct QTTypeRegistryRecord));
+	if (myRegistry == NULL)
+		return(memFullErr);
+
+	myRegistry->fEntries = (QTRegEntryPtr)malloc((size_t)(theBuilder->fCount + 1) * sizeof(QTRegEntryRecord));
+	myRegistry->fSlots = (UInt32 *)calloc(mySlotCount, sizeof(UInt32));
+	if ((myRegistry->fEntries == NULL) || (myRegistry->fSlots == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	myRegistry->fMask = mySlotCount - 1;
+
+	for (myIndex = 0; myIndex < theBuilder->fCount; myIndex++) {
+		QTRegEntryPtr	myEntry = &theBuilder->fEntries[myIndex];
+		UInt32			mySlot = QTReg_FindSlot(myRegistry, myEntry->fKey, myEntry->fKeyKind);
+
+		if (myRegistry->fSlots[mySlot] != 0)
+			continue;
+
+		myRegistry->fEntries[myRegistry->fCount] = *myEntry;
+		myRegistry->fSlots[mySlot] = (UInt32)++myRegistry->fCount;
+	}
+
+bail:
+	if (myErr != noErr)
+		QTReg_DisposeRegistry(myRegistry);
+	else
+		*theRegistry = myRegistry;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTReg_DisposeRegistry
+// Dispose of a registry.
+//
+//////////
+
+void QTReg_DisposeRegistry (QTTypeRegistryPtr theRegistry)
+{
+	if (theRegistry == NULL)
+		return;
+
+	free(theRegistry->fEntries);
+	free(theRegistry->fSlots);
+	free(theRegistry);
+}
+
+
+//////////
+//
+// QTReg_Lookup
+// Look up a key; if it's there, copy its entry into theEntry (if not NULL) and return true.
+//
+//////////
+
+static Boolean QTReg_Lookup (QTTypeRegistryPtr theRegistry, OSType theKey, long theKeyKind, QTRegEntryPtr theEntry)
+{
+	UInt32			mySlot;
+
+	if (theRegistry == NULL)
+		return(false);
+
+	mySlot = QTReg_FindSlot(theRegistry, theKey, theKeyKind);
+	if (theRegistry->fSlots[mySlot] == 0)
+		return(false);
+
+	if (theEntry != NULL)
+		*theEntry = theRegistry->fEntries[theRegistry->fSlots[mySlot] - 1];
+
+	return(true);
+}
+
+
+//////////
+//
+// QTReg_LookupFileType
+// Can we open files of the specified type? If so, theEntry (if not NULL) says which component opens them.
+//
+//////////
+
+Boolean QTReg_LookupFileType (QTTypeRegistryPtr theRegistry, OSType theFileType, QTRegEntryPtr theEntry)
+{
+	return(QTReg_Lookup(theRegistry, theFileType, kRegKeyFileType, theEntry));
+}
+
+
+//////////
+//
+// QTReg_LookupFileName
+// Can we open a file with the specified name, judging by its extension?
+//
+//////////
+
+Boolean QTReg_LookupFileName (QTTypeRegistryPtr theRegistry, const char *theFileName, QTRegEntryPtr theEntry)
+{
+	OSType			myKey;
+
+	if (theFileName == NULL)
+		return(false);
+
+	myKey = QTReg_ExtensionToKey(QTSys_GetFileExtension(theFileName));
+	if (myKey == 0)
+		return(false);
+
+	return(QTReg_Lookup(theRegistry, myKey, kRegKeyExtension, theEntry));
+}
+
+
+//////////
+//
+// QTReg_GetEntryCount
+// Return the number of distinct keys in a registry.
+//
+//////////
+
+long QTReg_GetEntryCount (QTTypeRegistryPtr theRegistry)
+{
+	return((theRegistry != NULL) ? theRegistry->fCount : 0);
+}
+
+
+//////////
+//
+// QTReg_GetEntries
+// Return the entries of a registry, in the order they were first added.
+//
+//////////
+
+const QTRegEntryRecord *QTReg_GetEntries (QTTypeRegistryPtr theRegistry)
+{
+	return((theRegistry != NULL) ? theRegistry->fEntries : NULL);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Cache functions.
+//
+// Finding out which file types we can open means asking every movie importer and graphics importer,
+// which on a machine with many components takes long enough to notice at startup. So we save the
+// registry in a small cache file, along with a fingerprint of whatever the entries were derived from,
+// and read it back on the next launch instead of asking the components again.
+//
+// A cache file is big-endian: a header (magic, version, fingerprint, entry count), the entries (five
+// 32-bit fields each), then a checksum of everything before it. A cache file that's missing, damaged,
+// or made for a different fingerprint is simply ignored; callers then build the registry the long way
+// and write a new cache.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTReg_MixFingerprint
+// Mix a 32-bit value into a fingerprint; start with kRegFingerprintSeed.
+//
+//////////
+
+QTUInt64 QTReg_MixFingerprint (QTUInt64 theFingerprint, UInt32 theValue)
+{
+	short			myShift;
+
+	for (myShift = 24; myShift >= 0; myShift -= 8) {
+		theFingerprint ^= (QTUInt64)((theValue >> myShift) & 0xFF);
+		theFingerprint *= kRegFingerprintPrime;
+	}
+
+	return(theFingerprint);
+}
+
+
+//////////
+//
+// QTReg_GetChecksum
+// Compute the checksum of the specified bytes.
+//
+//////////
+
+static QTUInt64 QTReg_GetChecksum (const UInt8 *theData, UInt32 theSize)
+{
+	QTUInt64		myChecksum = kRegFingerprintSeed;
+	UInt32			myIndex;
+
+	for (myIndex = 0; myIndex < theSize; myIndex++) {
+		myChecksum ^= (QTUInt64)theData[myIndex];
+		myChecksum *= kRegFingerprintPrime;
+	}
+
+	return(myChecksum);
+}
+
+
+//////////
+//
+// QTReg_WriteCache
+// Save a registry in a cache file, tagged with the specified fingerprint.
+//
+// The file is replaced atomically, so a reader never sees half of it; if it already holds the same
+// bytes, it isn't touched at all.
+//
+//////////
+
+OSErr QTReg_WriteCache (const char *thePath, QTTypeRegistryPtr theRegistry, QTUInt64 theFingerprint)
+{
+	QTSysIOVecRecord	myPart;
+	UInt8				*myData = NULL;
+	UInt8				*myNext;
+	UInt32				mySize;
+	long				myIndex;
+	Boolean				myWritten;
+	OSErr				myErr = noErr;
+
+	if ((thePath == NULL) || (theRegistry == NULL) || (theRegistry->fCount > kRegMaxCacheEntries))
+		return(paramErr);
+
+	mySize = kRegCacheHeaderSize + ((UInt32)theRegistry->fCount * kRegCacheEntrySize) + kRegCacheTrailerSize;
+
+	myData = (UInt8 *)malloc(mySize);
+	if (myData == NULL)
+		return(memFullErr);
+
+	QTAtom_PutBE32(myData, kRegCacheMagic);
+	QTAtom_PutBE32(myData + 4, kRegCacheVersion);
+	QTAtom_PutBE64(myData + 8, theFingerprint);
+	QTAtom_PutBE32(myData + 16, (UInt32)theRegistry->fCount);
+
+	myNext = myData + kRegCacheHeaderSize;
+	for (myIndex = 0; myIndex < theRegistry->fCount; myIndex++) {
+		QTRegEntryPtr	myEntry = &theRegistry->fEntries[myIndex];
+
+		QTAtom_PutBE32(myNext, myEntry->fKey);
+		QTAtom_PutBE32(myNext + 4, (UInt32)myEntry->fKeyKind);
+		QTAtom_PutBE32(myNext + 8, myEntry->fComponentType);
+		QTAtom_PutBE32(myNext + 12, myEntry->fComponentSubType);
+		QTAtom_PutBE32(myNext + 16, myEntry->fComponentManufacturer);
+		myNext += kRegCacheEntrySize;
+	}
+
+	QTAtom_PutBE64(myNext, QTReg_GetChecksum(myData, mySize - kRegCacheTrailerSize));
+
+	myPart.fData = myData;
+	myPart.fLength = mySize;
+	myErr = QTSet_WriteFile(thePath, &myPart, 1, &myWritten);
+
+	free(myData);
+	return(myErr);
+}
+
+
+//////////
+//
+// QTReg_ReadCache
+// Read a registry from a cache file, if the file is intact and was written for the specified fingerprint.
+//
+// If it isn't, that's not an error: we return noErr and set *theRegistry to NULL.
+//
+//////////
+
+OSErr QTReg_ReadCache (const char *thePath, QTUInt64 theFingerprint, QTTypeRegistryPtr *theRegistry)
+{
+	QTSetViewRecord		myView;
+	QTRegBuilderRecord	myBuilder;
+	const UInt8			*myNext;
+	UInt32				myCount;
+	UInt32				myIndex;
+	OSErr				myErr = noErr;
+
+	if ((thePath == NULL) || (theRegistry == NULL))
+		return(paramErr);
+
+	*theRegistry = NULL;
+
+	QTReg_InitBuilder(&myBuilder);
+
+	if (QTSet_OpenView(thePath, 0L, &myView) != noErr)
+		return(noErr);
+
+	// check the header, the size and the checksum before we believe anything in the file
+	if (myView.fSize < kRegCacheHeaderSize + kRegCacheTrailerSize)
+		goto bail;
+
+	myCount = QTAtom_GetBE32(myView.fData + 16);
+	if ((QTAtom_GetBE32(myView.fData) != kRegCacheMagic) ||
+		(QTAtom_GetBE32(myView.fData + 4) != kRegCacheVersion) ||
+		(QTAtom_GetBE64(myView.fData + 8) != theFingerprint) ||
+		(myCount > kRegMaxCacheEntries) ||
+		(myView.fSize != kRegCacheHeaderSize + (myCount * kRegCacheEntrySize) + kRegCacheTrailerSize))
+		goto bail;
+
+	if (QTAtom_GetBE64(myView.fData + myView.fSize - kRegCacheTrailerSize) != QTReg_GetChecksum(myView.fData, myView.fSize - kRegCacheTrailerSize))
+		goto bail;
+
+	myNext = myView.fData + kRegCacheHeaderSize;
+	for (myIndex = 0; myIndex < myCount; myIndex++) {
+		long			myKeyKind = (long)QTAtom_GetBE32(myNext + 4);
+
+		if ((myKeyKind != kRegKeyFileType) && (myKeyKind != kRegKeyExtension))
+			goto bail;
+
+		QTReg_AddEntry(&myBuilder, QTAtom_GetBE32(myNext), myKeyKind, QTAtom_GetBE32(myNext + 8), QTAtom_GetBE32(myNext + 12), QTAtom_GetBE32(myNext + 16));
+		myNext += kRegCacheEntrySize;
+	}
+
+	myErr = QTReg_NewRegistry(&myBuilder, theRegistry);
+
+bail:
+	QTReg_DisposeBuilder(&myBuilder);
+	QTSet_CloseView(&myView);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTReg_NextRandom
+// A small xorshift generator, so that the benchmark does the same work every time.
+//
+//////////
+
+static UInt32 QTReg_NextRandom (UInt32 *theSeed)
+{
+	*theSeed ^= *theSeed << 13;
+	*theSeed ^= *theSeed >> 17;
+	*theSeed ^= *theSeed << 5;
+
+	return(*theSeed);
+}
+
+
+//////////
+//
+// QTReg_RunBenchmark
+// Compare the old linear scan with registry lookups over a synthetic directory listing.
+//
+// We make up theTypeCount file types and a listing of theEntryCount files, 60% of which have one of
+// those types and the rest types we can't open; then we filter the listing by scanning the type list
+// (as the filter functions used to) and by looking each type up in a registry. We write one JSON line
+// per method; both must find the same number of files we can open.
+//
+//////////
+
+OSErr QTReg_RunBenchmark (FILE *theReport, long theEntryCount, long theTypeCount)
+{
+	static const char	*myMethodNames[] = {"linear", "registry"};
+	QTRegBuilderRecord	myBuilder;
+	QTTypeRegistryPtr	myRegistry = NULL;
+	OSType				*myTypes = NULL;
+	OSType				*myListing = NULL;
+	long				myMatches[2] = {0, 0};
+	UInt32				mySeed = 0x9E3779B9;
+	long				myMethod;
+	long				myIndex;
+	OSErr				myErr = noErr;
+
+	if (theEntryCount <= 0)
+		theEntryCount = kRegDefaultBenchmarkEntries;
+	if (theTypeCount <= 0)
+		theTypeCount = kRegDefaultBenchmarkTypes;
+
+	QTReg_InitBuilder(&myBuilder);
+
+	myTypes = (OSType *)malloc((size_t)theTypeCount * sizeof(OSType));
+	myListing = (OSType *)malloc((size_t)theEntryCount * sizeof(OSType));
+	if ((myTypes == NULL) || (myListing == NULL)) {
+		myErr = memFullErr;
+		goto bail;
+	}
+
+	// printable four-character codes, like real file types; the top bit of the first byte is never set,
+	// so the unknown types below (which set it) can't match by accident
+	for (myIndex = 0; myIndex < theTypeCount; myIndex++) {
+		myTypes[myIndex] = (QTReg_NextRandom(&mySeed) & 0x3F3F3F3F) | 0x40404040;
+		QTReg_AddFileType(&myBuilder, myTypes[myIndex], FOUR_CHAR_CODE('eat '), myTypes[myIndex], FOUR_CHAR_CODE('bnch'));
+	}
+
+	myErr = QTReg_NewRegistry(&myBuilder, &myRegistry);
+	if (myErr != noErr)
+		goto bail;
+
+	for (myIndex = 0; myIndex < theEntryCount; myIndex++) {
+		if ((long)(QTReg_NextRandom(&mySeed) % 100) < kRegBenchmarkKnownPercent)
+			myListing[myIndex] = myTypes[QTReg_NextRandom(&mySeed) % (UInt32)theTypeCount];
+		else
+			myListing[myIndex] = QTReg_NextRandom(&mySeed) | 0x80000000UL;
+	}
+
+	for (myMethod = 0; myMethod < 2; myMethod++) {
+		QTUInt64		myStartTime;
+		QTUInt64		myWallTime;
+
+		myStartTime = QTSys_GetMicroseconds();
+
+		for (myIndex = 0; myIndex < theEntryCount; myIndex++) {
+			if (myMethod == 0) {
+				long		myType;
+
+				for (myType = 0; myType < theTypeCount; myType++)
+					if (myListing[myIndex] == myTypes[myType])
+						break;
+
+				if (myType < theTypeCount)
+					myMatches[myMethod]++;
+			} else {
+				if (QTReg_LookupFileType(myRegistry, myListing[myIndex], NULL))
+					myMatches[myMethod]++;
+			}
+		}
+
+		myWallTime = QTSys_GetMicroseconds() - myStartTime;
+
+		if (theReport != NULL) {
+			fprintf(theReport, "{\"benchmark\":\"typeregistry\",\"method\":\"%s\",\"entries\":%ld,\"types\":%ld,\"matches\":%ld,\"wallMicroseconds\":%llu,\"nanosecondsPerEntry\":%.1f}\n",
+						myMethodNames[myMethod],
+						theEntryCount,
+						theTypeCount,
+						myMatches[myMethod],
+						(unsigned long long)myWallTime,
+						(double)myWallTime * 1000.0 / (double)theEntryCount);
+			fflush(theReport);
+		}
+	}
+
+	if (myMatches[0] != myMatches[1])
+		myErr = paramErr;
+
+bail:
+	QTReg_DisposeRegistry(myRegistry);
+	QTReg_DisposeBuilder(&myBuilder);
+	free(myTypes);
+	free(myListing);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTReg_IsRegistryCommandLine
+// Does the specified command line ask for the registry benchmark?
+//
+//////////
+
+Boolean QTReg_IsRegistryCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kRegBenchmarkSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTReg_Main
+// Run the registry benchmark. Returns one of the kRegExit constants.
+//
+// Usage: -typebench [-entries <count>] [-types <count>] [-report <file>]
+//
+//////////
+
+int QTReg_Main (int theArgc, char *theArgv[])
+{
+	const char			*myReportPath = NULL;
+	long				myEntryCount = kRegDefaultBenchmarkEntries;
+	long				myTypeCount = kRegDefaultBenchmarkTypes;
+	FILE				*myReport = stdout;
+	int					myIndex;
+	OSErr				myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kRegEntriesSwitch) == 0) && (myIndex + 1 < theArgc))
+			myEntryCount = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kRegTypesSwitch) == 0) && (myIndex + 1 < theArgc))
+			myTypeCount = atol(theArgv[++myIndex]);
+		else if ((strcmp(theArgv[myIndex], kRegReportSwitch) == 0) && (myIndex + 1 < theArgc))
+			myReportPath = theArgv[++myIndex];
+	}
+
+	if ((myEntryCount < 0) || (myTypeCount < 0)) {
+		fprintf(stderr, "usage: %s %s [%s <count>] [%s <count>] [%s <file>]\n", theArgv[0], kRegBenchmarkSwitch, kRegEntriesSwitch, kRegTypesSwitch, kRegReportSwitch);
+		return(kRegExitUsage);
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kRegExitUsage);
+		}
+	}
+
+	myErr = QTReg_RunBenchmark(myReport, myEntryCount, myTypeCount);
+	if (myErr != noErr)
+		fprintf(stderr, "registry benchmark failed (error %d)\n", (int)myErr);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kRegExitSuccess : kRegExitFailed);
+}
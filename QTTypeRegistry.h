@@ -0,0 +1,115 @@
+//////////
+//
+//	File:		QTTypeRegistry.h
+//
+//	Contains:	A portable, immutable index of the file types and extensions that QTDataEx can open.
+//				All utilities start with the prefix "QTReg_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTTypeRegistry__
+#define __QTTypeRegistry__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTSystem.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kRegBenchmarkSwitch					"-typebench"			// command-line switch that selects the registry benchmark
+#define kRegEntriesSwitch					"-entries"				// number of entries in the synthetic directory listing
+#define kRegTypesSwitch						"-types"				// number of file types in the synthetic registry
+#define kRegReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kRegDefaultBenchmarkEntries			100000
+#define kRegDefaultBenchmarkTypes			250
+#define kRegInitialBuilderCapacity			128
+
+#define kRegCacheMagic						FOUR_CHAR_CODE('QTRg')	// first four bytes of a registry cache file
+#define kRegCacheVersion					1
+#define kRegFingerprintSeed					(((QTUInt64)0xCBF29CE4UL << 32) | 0x84222325UL)	// start value for QTReg_MixFingerprint (the FNV-1a offset basis)
+
+// kinds of keys
+enum {
+	kRegKeyFileType							= 1,					// a Mac OS file type
+	kRegKeyExtension						= 2						// a file name extension, folded to lowercase
+};
+
+// the component type of an entry for files that QuickTime opens directly, without an importer
+#define kRegNoImporter						0
+
+// exit codes returned by QTReg_Main
+enum {
+	kRegExitSuccess							= 0,
+	kRegExitFailed							= 1,
+	kRegExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+// one file type or extension, and the importer that handles it
+typedef struct QTRegEntryRecord {
+	OSType					fKey;					// the file type, or the extension packed like a file type ('jpg ')
+	long					fKeyKind;				// kRegKeyFileType or kRegKeyExtension
+	OSType					fComponentType;			// MovieImportType, GraphicsImporterComponentType or kRegNoImporter
+	OSType					fComponentSubType;
+	OSType					fComponentManufacturer;
+} QTRegEntryRecord, *QTRegEntryPtr;
+
+// collects entries for QTReg_NewRegistry; the first entry added for a key wins
+typedef struct QTRegBuilderRecord {
+	QTRegEntryPtr			fEntries;
+	long					fCount;
+	long					fCapacity;
+	OSErr					fErr;					// the first error, if any; once set, further additions are ignored
+} QTRegBuilderRecord, *QTRegBuilderPtr;
+
+typedef struct QTTypeRegistryRecord		*QTTypeRegistryPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+void						QTReg_InitBuilder (QTRegBuilderPtr theBuilder);
+void						QTReg_DisposeBuilder (QTRegBuilderPtr theBuilder);
+OSErr						QTReg_AddFileType (QTRegBuilderPtr theBuilder, OSType theFileType, OSType theComponentType, OSType theSubType, OSType theManufacturer);
+OSErr						QTReg_AddExtension (QTRegBuilderPtr theBuilder, const char *theExtension, OSType theComponentType, OSType theSubType, OSType theManufacturer);
+OSType						QTReg_ExtensionToKey (const char *theExtension);
+
+OSErr						QTReg_NewRegistry (QTRegBuilderPtr theBuilder, QTTypeRegistryPtr *theRegistry);
+void						QTReg_DisposeRegistry (QTTypeRegistryPtr theRegistry);
+Boolean						QTReg_LookupFileType (QTTypeRegistryPtr theRegistry, OSType theFileType, QTRegEntryPtr theEntry);
+Boolean						QTReg_LookupFileName (QTTypeRegistryPtr theRegistry, const char *theFileName, QTRegEntryPtr theEntry);
+long						QTReg_GetEntryCount (QTTypeRegistryPtr theRegistry);
+const QTRegEntryRecord *	QTReg_GetEntries (QTTypeRegistryPtr theRegistry);
+
+QTUInt64					QTReg_MixFingerprint (QTUInt64 theFingerprint, UInt32 theValue);
+OSErr						QTReg_WriteCache (const char *thePath, QTTypeRegistryPtr theRegistry, QTUInt64 theFingerprint);
+OSErr						QTReg_ReadCache (const char *thePath, QTUInt64 theFingerprint, QTTypeRegistryPtr *theRegistry);
+
+OSErr						QTReg_RunBenchmark (FILE *theReport, long theEntryCount, long theTypeCount);
+
+Boolean						QTReg_IsRegistryCommandLine (int theArgc, char *theArgv[]);
+int							QTReg_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTTypeRegistry__
@@ -0,0 +1,720 @@
+//////////
+//
+//	File:		QTUpdate.c
+//
+//	Contains:	Portable functions for saving a changed movie atom into its movie file without rewriting the file.
+//				All utilities start with the prefix "QTUpd_".
+//
+//	Most changes to a movie that has been saved, such as its looping state or its copyright notice, change
+//	a few bytes of its movie atom and nothing else. QTUpd_UpdateMovieAtom saves the new movie atom with
+//	as little writing as it can:
+//
+//	  * If the new movie atom is the same size as the old one, we write only the bytes that differ, in
+//	    runs that take in short stretches of unchanged bytes.
+//
+//	  * If not, but it fits into the old one and any free space right after it (exactly, or leaving room
+//	    for a 'free' atom), we write it there. So a fast-start file stays fast-start.
+//
+//	  * Otherwise we write it at the end of the file, and only then turn the old one into a 'free' atom,
+//	    by rewriting its type; a file cut short while we write still has its old movie atom. If the last
+//	    atom of the file has a size of 0, which means it runs to the end of the file, we first give it its
+//	    real size, so that it doesn't take in the new movie atom; when that size needs 64 bits, which we
+//	    can't fit into its header, we give up and leave the file alone.
+//
+//	We never read or move the movie data, so the time this takes doesn't depend on the size of the file.
+//
+//////////
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTUpdate.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kUpdBenchFileName			"QTUpdateBench.mov"
+#define kUpdBenchSampleSize			(256L * 1024L)			// the benchmark's movie atom has 4 bytes of table per sample this size
+#define kUpdLoopType				FOUR_CHAR_CODE('LOOP')
+#define kUpdCopyrightType			FOUR_CHAR_CODE('\251cpy')
+#define kUpdBenchCopyright			"Copyright Apple Computer, Inc."
+#define kUpdOpenFileName			"QTUpdateOpen.mov"
+#define kUpdOpenDataSize			(64L * 1024L)			// bytes of movie data in the open-ended check's files
+#define kUpdOpenHugeDataSize		((QTUInt64)5 << 30)		// too many for a 32-bit atom size
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+static OSErr				QTUpd_ReadFile (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength);
+static OSErr				QTUpd_FindMovieAtom (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMovie, QTUInt64 *theRoom, QTAtomHeaderPtr theOpenAtom);
+static OSErr				QTUpd_Write (QTSysFile theFile, QTUInt64 theOffset, const void *theData, UInt32 theLength, QTUpdStatsPtr theStats);
+static void					QTUpd_BuildBenchmarkMovie (QTAtomBufferPtr theBuffer, long theGigabytes, UInt32 theLoopInfo, Boolean theAddCopyright);
+static OSErr				QTUpd_CheckMovieAtom (const char *thePath, QTAtomBufferPtr theExpected);
+static OSErr				QTUpd_RunOpenEndedCheck (FILE *theReport, const char *theDirectory);
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Update functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTUpd_UpdateMovieAtom
+// Replace the movie atom of the movie file at thePath with the theSize bytes at theMovieAtom.
+//
+// theMovieAtom must be a whole 'moov' atom, header included, such as PutMovieIntoHandle makes; theStats,
+// which may be NULL, says how we saved it.
+//
+//////////
+
+OSErr QTUpd_UpdateMovieAtom (const char *thePath, const void *theMovieAtom, UInt32 theSize, QTUpdStatsPtr theStats)
+{
+	const UInt8				*myNewData = (const UInt8 *)theMovieAtom;
+	UInt8					*myOldData = NULL;
+	QTAtomReaderRecord		myReader = {NULL, NULL, 0};
+	QTAtomHeaderRecord		myMovie;
+	QTAtomHeaderRecord		myOpenAtom;
+	QTUpdStatsRecord		myStats;
+	QTSysFile				myFile = kQTSysInvalidFile;
+	QTUInt64				myStartTime = QTSys_GetMicroseconds();
+	QTUInt64				myRoom = 0;
+	UInt8					myBytes[kAtomHeaderSize];
+	UInt32					myIndex;
+	UInt32					myStart;
+	UInt32					myEnd;
+	OSErr					myErr = noErr;
+
+	memset(&myStats, 0, sizeof(myStats));
+
+	if ((thePath == NULL) || (myNewData == NULL) || (theSize < kAtomHeaderSize))
+		return(paramErr);
+
+	if ((QTAtom_GetBE32(myNewData) != theSize) || (QTAtom_GetBE32(myNewData + 4) != kAtomTypeMovie))
+		return(paramErr);
+
+	myErr = QTSys_OpenFile(thePath, kQTSysOpenUpdate, &myFile);
+	if (myErr != noErr)
+		goto bail;
+
+	myReader.fRefCon = myFile;
+	myReader.fRead = QTUpd_ReadFile;
+	myErr = QTSys_GetFileSize(myFile, &myReader.fSize);
+	if (myErr == noErr)
+		myErr = QTUpd_FindMovieAtom(&myReader, &myMovie, &myRoom, &myOpenAtom);
+	if (myErr != noErr)
+		goto bail;
+
+	myStats.fMovieOffset = myMovie.fOffset;
+
+	if (myMovie.fSize == theSize) {
+		// the same size: write the runs of bytes that differ
+		myOldData = (UInt8 *)malloc(theSize);
+		if (myOldData == NULL) {
+			myErr = memFullErr;
+			goto bail;
+		}
+
+		myErr = QTUpd_ReadFile(myFile, myMovie.fOffset, myOldData, theSize);
+		if (myErr != noErr)
+			goto bail;
+
+		myStats.fMethod = kUpdMethodUnchanged;
+		myIndex = 0;
+		while ((myIndex < theSize) && (myErr == noErr)) {
+			if (myOldData[myIndex] == myNewData[myIndex]) {
+				myIndex++;
+				continue;
+			}
+
+			// take in any more differences that are no more than kUpdMergeGap bytes further on
+			myStart = myIndex;
+			myEnd = myIndex + 1;
+			for (myIndex = myEnd; (myIndex < theSize) && (myIndex - myEnd < kUpdMergeGap); myIndex++)
+				if (myOldData[myIndex] != myNewData[myIndex])
+					myEnd = myIndex + 1;
+
+			myErr = QTUpd_Write(myFile, myMovie.fOffset + myStart, myNewData + myStart, myEnd - myStart, &myStats);
+			myStats.fMethod = kUpdMethodPatched;
+			myIndex = myEnd;
+		}
+	} else if ((theSize <= myRoom) && ((myRoom - theSize == 0) || (myRoom - theSize >= kAtomHeaderSize)) && (myRoom <= 0xFFFFFFFFUL)) {
+		// it fits where the old one was; what's left over becomes a 'free' atom
+		myErr = QTUpd_Write(myFile, myMovie.fOffset, myNewData, theSize, &myStats);
+		if ((myErr == noErr) && (myRoom > theSize)) {
+			QTAtom_PutBE32(myBytes, (UInt32)(myRoom - theSize));
+			QTAtom_PutBE32(myBytes + 4, kAtomTypeFree);
+			myErr = QTUpd_Write(myFile, myMovie.fOffset + theSize, myBytes, kAtomHeaderSize, &myStats);
+		}
+
+		myStats.fMethod = kUpdMethodInPlace;
+	} else {
+		// an atom that runs to the end of the file would take in the one we append, so it needs a real size
+		if (myOpenAtom.fSize > 0xFFFFFFFFUL) {
+			myErr = unimpErr;
+			goto bail;
+		}
+
+		if (myOpenAtom.fSize != 0) {
+			QTAtom_PutBE32(myBytes, (UInt32)myOpenAtom.fSize);
+			myErr = QTUpd_Write(myFile, myOpenAtom.fOffset, myBytes, 4, &myStats);
+			if (myErr != noErr)
+				goto bail;
+		}
+
+		// write the new one at the end before we give up the old one
+		myErr = QTUpd_Write(myFile, myReader.fSize, myNewData, theSize, &myStats);
+		if (myErr == noErr) {
+			QTAtom_PutBE32(myBytes, kAtomTypeFree);
+			myErr = QTUpd_Write(myFile, myMovie.fOffset + 4, myBytes, 4, &myStats);
+		}
+
+		myStats.fMethod = kUpdMethodAppended;
+		myStats.fMovieOffset = myReader.fSize;
+	}
+
+bail:
+	if (myFile != kQTSysInvalidFile)
+		QTSys_CloseFile(myFile);
+
+	free(myOldData);
+
+	myStats.fMicroseconds = QTSys_GetMicroseconds() - myStartTime;
+	if (theStats != NULL)
+		*theStats = myStats;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTUpd_GetMethodName
+// Return the name of one of the kUpdMethod constants, for reports.
+//
+//////////
+
+const char *QTUpd_GetMethodName (long theMethod)
+{
+	switch (theMethod) {
+		case kUpdMethodUnchanged:		return("unchanged");
+		case kUpdMethodPatched:			return("patched");
+		case kUpdMethodInPlace:			return("inPlace");
+		case kUpdMethodAppended:		return("appended");
+		default:						return("unknown");
+	}
+}
+
+
+//////////
+//
+// QTUpd_ReadFile
+// Read bytes from a file opened with QTSys_OpenFile; the fRead function of our atom reader.
+//
+//////////
+
+static OSErr QTUpd_ReadFile (void *theRefCon, QTUInt64 theOffset, void *theBuffer, UInt32 theLength)
+{
+	UInt32			myCount = 0;
+	OSErr			myErr = noErr;
+
+	myErr = QTSys_ReadFile((QTSysFile)theRefCon, theOffset, theBuffer, theLength, &myCount);
+	if ((myErr == noErr) && (myCount != theLength))
+		myErr = eofErr;
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTUpd_FindMovieAtom
+// Find the movie atom that QuickTime reads (the first), and the room it has: its own size plus that of
+// any free atoms right after it.
+//
+// theOpenAtom gets the last atom of the file if its size is 0, so that it runs to the end of the file (that
+// may be the movie atom itself); otherwise its fSize is 0. Anything we append would become part of it.
+//
+//////////
+
+static OSErr QTUpd_FindMovieAtom (QTAtomReaderPtr theReader, QTAtomHeaderPtr theMovie, QTUInt64 *theRoom, QTAtomHeaderPtr theOpenAtom)
+{
+	QTAtomHeaderRecord		myAtom;
+	QTUInt64				myOffset = 0;
+	UInt8					myBytes[4];
+	OSErr					myErr = noErr;
+
+	memset(theOpenAtom, 0, sizeof(QTAtomHeaderRecord));
+
+	// we hop from header to header, so even a huge 'mdat' atom costs us one read
+	for (;;) {
+		if (theReader->fSize - myOffset < kAtomHeaderSize)
+			return(invalidMovie);
+
+		myErr = QTAtom_ReadHeader(theReader, myOffset, theReader->fSize, theMovie);
+		if (myErr != noErr)
+			return(myErr);
+
+		if (theMovie->fType == kAtomTypeMovie)
+			break;
+
+		myOffset += theMovie->fSize;
+	}
+
+	*theRoom = theMovie->fSize;
+	myOffset = theMovie->fOffset + theMovie->fSize;
+
+	while (theReader->fSize - myOffset >= kAtomHeaderSize) {
+		if (QTAtom_ReadHeader(theReader, myOffset, theReader->fSize, &myAtom) != noErr)
+			break;
+
+		if ((myAtom.fType != kAtomTypeFree) && (myAtom.fType != kAtomTypeSkip))
+			break;
+
+		*theRoom += myAtom.fSize;
+		myOffset += myAtom.fSize;
+	}
+
+	// the atom that reaches the end of the file may say so with a size of 0, which QTAtom_ReadHeader doesn't tell us
+	myAtom = *theMovie;
+	myOffset = theMovie->fOffset;
+	while (myOffset + myAtom.fSize < theReader->fSize) {
+		myOffset += myAtom.fSize;
+		myErr = QTAtom_ReadHeader(theReader, myOffset, theReader->fSize, &myAtom);
+		if (myErr != noErr)
+			return(noErr);					// trailing bytes that aren't an atom can't take in anything
+	}
+
+	myErr = theReader->fRead(theReader->fRefCon, myAtom.fOffset, myBytes, 4);
+	if (myErr != noErr)
+		return(myErr);
+
+	if (QTAtom_GetBE32(myBytes) == 0)
+		*theOpenAtom = myAtom;
+
+	return(noErr);
+}
+
+
+//////////
+//
+// QTUpd_Write
+// Write bytes at an offset of the file, and count them.
+//
+//////////
+
+static OSErr QTUpd_Write (QTSysFile theFile, QTUInt64 theOffset, const void *theData, UInt32 theLength, QTUpdStatsPtr theStats)
+{
+	theStats->fWriteCount++;
+	theStats->fBytesWritten += theLength;
+
+	return(QTSys_WriteFileAt(theFile, theOffset, theData, theLength));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Benchmark functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTUpd_RunBenchmark
+// Time saving three metadata changes to a movie file of theGigabytes gigabytes, and write a report to theReport.
+//
+// The file has its movie atom first, with a block that stands in for the sample tables of that much
+// movie data, and then an 'mdat' atom of zeros, which the file system needn't store. We change the
+// looping state (the same size), add a copyright notice (bigger, so it goes at the end), and take it
+// out again (smaller, so it stays at the end); after each we check that the file's movie atom is the
+// one we saved. Then QTUpd_RunOpenEndedCheck tries files whose last atom runs to the end of the file.
+//
+//////////
+
+OSErr QTUpd_RunBenchmark (FILE *theReport, long theGigabytes, const char *theDirectory)
+{
+	static const char		*myStepNames[] = {"loop", "addCopyright", "removeCopyright"};
+	QTAtomBufferRecord		myBuffer;
+	QTUpdStatsRecord		myStats;
+	QTSysFile				myFile = kQTSysInvalidFile;
+	char					myPath[kQTSysMaxPath];
+	QTUInt64				myDataSize;
+	UInt8					myHeader[kAtomExtendedHeaderSize];
+	long					myStep;
+	OSErr					myErr = noErr;
+
+	if (theGigabytes <= 0)
+		theGigabytes = kUpdDefaultBenchmarkGigabytes;
+	if (theDirectory == NULL)
+		theDirectory = ".";
+
+	myErr = QTSys_MakePath(myPath, sizeof(myPath), theDirectory, kUpdBenchFileName);
+	if (myErr != noErr)
+		return(myErr);
+
+	QTAtom_InitBuffer(&myBuffer);
+
+	// ftyp, moov, mdat
+	QTAtom_Append32(&myBuffer, 20);
+	QTAtom_Append32(&myBuffer, kAtomTypeFileType);
+	QTAtom_Append32(&myBuffer, kAtomBrandQuickTime);
+	QTAtom_Append32(&myBuffer, 0x20050300);
+	QTAtom_Append32(&myBuffer, kAtomBrandQuickTime);
+	QTUpd_BuildBenchmarkMovie(&myBuffer, theGigabytes, 0, false);
+	if (myBuffer.fErr != noErr) {
+		myErr = myBuffer.fErr;
+		goto bail;
+	}
+
+	myDataSize = (QTUInt64)theGigabytes << 30;
+	QTAtom_PutBE32(myHeader, 1);
+	QTAtom_PutBE32(myHeader + 4, kAtomTypeMovieData);
+	QTAtom_PutBE64(myHeader + 8, kAtomExtendedHeaderSize + myDataSize);
+
+	myErr = QTSys_OpenFile(myPath, kQTSysOpenWrite, &myFile);
+	if (myErr == noErr)
+		myErr = QTSys_WriteFile(myFile, myBuffer.fData, myBuffer.fSize);
+	if (myErr == noErr)
+		myErr = QTSys_WriteFile(myFile, myHeader, kAtomExtendedHeaderSize);
+	if (myErr == noErr)
+		myErr = QTSys_SetFileSize(myFile, myBuffer.fSize + kAtomExtendedHeaderSize + myDataSize);
+	if (myFile != kQTSysInvalidFile)
+		QTSys_CloseFile(myFile);
+	if (myErr != noErr)
+		goto bail;
+
+	for (myStep = 0; myStep < 3; myStep++) {
+		QTAtom_DisposeBuffer(&myBuffer);
+		QTAtom_InitBuffer(&myBuffer);
+		QTUpd_BuildBenchmarkMovie(&myBuffer, theGigabytes, 1, (myStep == 1));
+		if (myBuffer.fErr != noErr) {
+			myErr = myBuffer.fErr;
+			goto bail;
+		}
+
+		myErr = QTUpd_UpdateMovieAtom(myPath, myBuffer.fData, myBuffer.fSize, &myStats);
+		if (myErr == noErr)
+			myErr = QTUpd_CheckMovieAtom(myPath, &myBuffer);
+
+		if (theReport != NULL) {
+			fprintf(theReport, "{\"benchmark\":\"update\",\"step\":\"%s\",\"gigabytes\":%ld,\"err\":%d,\"method\":\"%s\",\"movieBytes\":%lu,\"movieOffset\":%llu,\"writes\":%ld,\"bytesWritten\":%llu,\"wallMicroseconds\":%llu}\n",
+						myStepNames[myStep],
+						theGigabytes,
+						(int)myErr,
+						QTUpd_GetMethodName(myStats.fMethod),
+						(unsigned long)myBuffer.fSize,
+						(unsigned long long)myStats.fMovieOffset,
+						myStats.fWriteCount,
+						(unsigned long long)myStats.fBytesWritten,
+						(unsigned long long)myStats.fMicroseconds);
+			fflush(theReport);
+		}
+
+		if (myErr != noErr)
+			break;
+	}
+
+	if (myErr == noErr)
+		myErr = QTUpd_RunOpenEndedCheck(theReport, theDirectory);
+
+bail:
+	QTSys_DeletePath(myPath);
+	QTAtom_DisposeBuffer(&myBuffer);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTUpd_BuildBenchmarkMovie
+// Append the benchmark's movie atom to theBuffer.
+//
+//////////
+
+static void QTUpd_BuildBenchmarkMovie (QTAtomBufferPtr theBuffer, long theGigabytes, UInt32 theLoopInfo, Boolean theAddCopyright)
+{
+	UInt32				myMovie;
+	UInt32				myAtoms[2];
+	UInt32				myLength = (UInt32)strlen(kUpdBenchCopyright);
+
+	myMovie = QTAtom_BeginAtom(theBuffer, kAtomTypeMovie);
+
+	// the movie header (version 0)
+	myAtoms[0] = QTAtom_BeginFullAtom(theBuffer, kAtomTypeMovieHeader, 0, 0);
+	QTAtom_Append32(theBuffer, 0);								// creation time
+	QTAtom_Append32(theBuffer, 0);								// modification time
+	QTAtom_Append32(theBuffer, 600);							// time scale
+	QTAtom_Append32(theBuffer, 0);								// duration
+	QTAtom_Append32(theBuffer, 0x00010000);						// preferred rate
+	QTAtom_Append16(theBuffer, 0x0100);							// preferred volume
+	QTAtom_AppendZeros(theBuffer, 10);
+	QTAtom_AppendZeros(theBuffer, 36);							// matrix
+	QTAtom_AppendZeros(theBuffer, 24);							// preview and poster times, selection, current time
+	QTAtom_Append32(theBuffer, 2);								// next track ID
+	QTAtom_EndAtom(theBuffer, myAtoms[0]);
+
+	// in place of a track, as big as the sample tables of a movie of this size would be
+	myAtoms[0] = QTAtom_BeginAtom(theBuffer, kAtomTypeTrack);
+	QTAtom_AppendZeros(theBuffer, (UInt32)((((QTUInt64)theGigabytes << 30) / kUpdBenchSampleSize) * 4));
+	QTAtom_EndAtom(theBuffer, myAtoms[0]);
+
+	// the user data: the looping state and, perhaps, a copyright notice
+	myAtoms[0] = QTAtom_BeginAtom(theBuffer, kAtomTypeUserData);
+
+	myAtoms[1] = QTAtom_BeginAtom(theBuffer, kUpdLoopType);
+	QTAtom_Append32(theBuffer, theLoopInfo);
+	QTAtom_EndAtom(theBuffer, myAtoms[1]);
+
+	if (theAddCopyright) {
+		myAtoms[1] = QTAtom_BeginAtom(theBuffer, kUpdCopyrightType);
+		QTAtom_Append16(theBuffer, (UInt16)myLength);
+		QTAtom_Append16(theBuffer, 0);							// language
+		QTAtom_AppendBytes(theBuffer, kUpdBenchCopyright, myLength);
+		QTAtom_EndAtom(theBuffer, myAtoms[1]);
+	}
+
+	QTAtom_EndAtom(theBuffer, myAtoms[0]);
+	QTAtom_EndAtom(theBuffer, myMovie);
+}
+
+
+//////////
+//
+// QTUpd_CheckMovieAtom
+// Check that the movie file at thePath holds just one movie atom, and that it's the one in theExpected.
+//
+//////////
+
+static OSErr QTUpd_CheckMovieAtom (const char *thePath, QTAtomBufferPtr theExpected)
+{
+	QTAtomReaderRecord		myReader;
+	QTAtomHeaderRecord		myAtom;
+	QTUInt64				myOffset = 0;
+	UInt8					*myData = NULL;
+	UInt32					mySize = 0;
+	long					myCount = 0;
+	OSErr					myErr = noErr;
+
+	myErr = QTAtom_OpenFileReader(thePath, &myReader);
+	if (myErr != noErr)
+		return(myErr);
+
+	// the atoms must cover the file exactly
+	while ((myErr == noErr) && (myOffset < myReader.fSize)) {
+		myErr = QTAtom_ReadHeader(&myReader, myOffset, myReader.fSize, &myAtom);
+		if (myErr != noErr)
+			break;
+
+		if (myAtom.fType == kAtomTypeMovie) {
+			myCount++;
+
+			myErr = QTAtom_ReadPayload(&myReader, &myAtom, &myData, &mySize);
+			if ((myErr == noErr) && ((myAtom.fSize != theExpected->fSize) || (memcmp(myData, theExpected->fData + kAtomHeaderSize, mySize) != 0)))
+				myErr = invalidMovie;
+
+			free(myData);
+			myData = NULL;
+		}
+
+		myOffset += myAtom.fSize;
+	}
+
+	if ((myErr == noErr) && ((myCount != 1) || (myOffset != myReader.fSize)))
+		myErr = invalidMovie;
+
+	QTAtom_CloseFileReader(&myReader);
+
+	return(myErr);
+}
+
+
+//////////
+//
+// QTUpd_RunOpenEndedCheck
+// Check that appending a movie atom to a file whose last atom has a size of 0 leaves a file we can read.
+//
+// We make three small files: a fast-start file whose movie data runs to the end of the file, one whose
+// movie atom does, and a fast-start one with more movie data than a 32-bit size can give; the last is sparse.
+// A bigger movie atom has to be appended to each. The first two must end up with just the new movie atom;
+// the third must be refused, with its old movie atom still in place.
+//
+//////////
+
+static OSErr QTUpd_RunOpenEndedCheck (FILE *theReport, const char *theDirectory)
+{
+	static const char		*myCaseNames[] = {"openEndedData", "openEndedMovie", "openEndedHugeData"};
+	static const Boolean	myMovieFirst[] = {true, false, true};
+	static const QTUInt64	myDataSizes[] = {kUpdOpenDataSize, kUpdOpenDataSize, kUpdOpenHugeDataSize};
+	static const OSErr		myExpectedErrs[] = {noErr, noErr, unimpErr};
+	QTAtomBufferRecord		myOldMovie;
+	QTAtomBufferRecord		myNewMovie;
+	QTUpdStatsRecord		myStats;
+	QTSysFile				myFile = kQTSysInvalidFile;
+	char					myPath[kQTSysMaxPath];
+	UInt8					myHeader[20];
+	QTUInt64				myOffset;
+	long					myCase;
+	OSErr					myUpdateErr = noErr;
+	OSErr					myErr = noErr;
+
+	myErr = QTSys_MakePath(myPath, sizeof(myPath), theDirectory, kUpdOpenFileName);
+	if (myErr != noErr)
+		return(myErr);
+
+	QTAtom_InitBuffer(&myOldMovie);
+	QTAtom_InitBuffer(&myNewMovie);
+	QTUpd_BuildBenchmarkMovie(&myOldMovie, 0, 0, false);
+	QTUpd_BuildBenchmarkMovie(&myNewMovie, 0, 1, true);
+	myErr = (myOldMovie.fErr != noErr) ? myOldMovie.fErr : myNewMovie.fErr;
+
+	for (myCase = 0; (myCase < 3) && (myErr == noErr); myCase++) {
+		// ftyp, then moov and mdat in either order, with a size of 0 for whichever is last
+		QTAtom_PutBE32(myHeader, 20);
+		QTAtom_PutBE32(myHeader + 4, kAtomTypeFileType);
+		QTAtom_PutBE32(myHeader + 8, kAtomBrandQuickTime);
+		QTAtom_PutBE32(myHeader + 12, 0x20050300);
+		QTAtom_PutBE32(myHeader + 16, kAtomBrandQuickTime);
+
+		myErr = QTSys_OpenFile(myPath, kQTSysOpenWrite, &myFile);
+		if (myErr == noErr)
+			myErr = QTSys_WriteFile(myFile, myHeader, 20);
+
+		if (myMovieFirst[myCase]) {
+			QTAtom_PutBE32(myHeader, 0);
+			QTAtom_PutBE32(myHeader + 4, kAtomTypeMovieData);
+			myOffset = 20 + myOldMovie.fSize;
+			if (myErr == noErr)
+				myErr = QTSys_WriteFile(myFile, myOldMovie.fData, myOldMovie.fSize);
+			if (myErr == noErr)
+				myErr = QTSys_WriteFile(myFile, myHeader, kAtomHeaderSize);
+			if (myErr == noErr)
+				myErr = QTSys_SetFileSize(myFile, myOffset + kAtomHeaderSize + myDataSizes[myCase]);
+		} else {
+			QTAtom_PutBE32(myHeader, (UInt32)(kAtomHeaderSize + myDataSizes[myCase]));
+			QTAtom_PutBE32(myHeader + 4, kAtomTypeMovieData);
+			myOffset = 20 + kAtomHeaderSize + myDataSizes[myCase];
+			if (myErr == noErr)
+				myErr = QTSys_WriteFile(myFile, myHeader, kAtomHeaderSize);
+			if (myErr == noErr)
+				myErr = QTSys_WriteFileAt(myFile, myOffset, myOldMovie.fData, myOldMovie.fSize);
+			QTAtom_PutBE32(myHeader, 0);
+			if (myErr == noErr)
+				myErr = QTSys_WriteFileAt(myFile, myOffset, myHeader, 4);
+		}
+
+		if (myFile != kQTSysInvalidFile)
+			QTSys_CloseFile(myFile);
+		myFile = kQTSysInvalidFile;
+		if (myErr != noErr)
+			break;
+
+		memset(&myStats, 0, sizeof(myStats));
+		myUpdateErr = QTUpd_UpdateMovieAtom(myPath, myNewMovie.fData, myNewMovie.fSize, &myStats);
+		if (myUpdateErr != myExpectedErrs[myCase])
+			myErr = (myUpdateErr != noErr) ? myUpdateErr : invalidMovie;
+		else
+			myErr = QTUpd_CheckMovieAtom(myPath, (myUpdateErr == noErr) ? &myNewMovie : &myOldMovie);
+
+		if (theReport != NULL) {
+			fprintf(theReport, "{\"benchmark\":\"update\",\"step\":\"%s\",\"err\":%d,\"updateErr\":%d,\"method\":\"%s\",\"writes\":%ld}\n",
+						myCaseNames[myCase],
+						(int)myErr,
+						(int)myUpdateErr,
+						QTUpd_GetMethodName(myStats.fMethod),
+						myStats.fWriteCount);
+			fflush(theReport);
+		}
+	}
+
+	QTSys_DeletePath(myPath);
+	QTAtom_DisposeBuffer(&myOldMovie);
+	QTAtom_DisposeBuffer(&myNewMovie);
+
+	return(myErr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Command-line functions.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//////////
+//
+// QTUpd_IsUpdateCommandLine
+// Does the specified command line ask for the movie-update benchmark?
+//
+//////////
+
+Boolean QTUpd_IsUpdateCommandLine (int theArgc, char *theArgv[])
+{
+	int			myIndex;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++)
+		if (strcmp(theArgv[myIndex], kUpdBenchmarkSwitch) == 0)
+			return(true);
+
+	return(false);
+}
+
+
+//////////
+//
+// QTUpd_Main
+// Run the movie-update benchmark. Returns one of the kUpdExit constants.
+//
+// Usage: -updatebench [-gigabytes <count>] [-dir <directory>] [-report <file>]
+//
+//////////
+
+int QTUpd_Main (int theArgc, char *theArgv[])
+{
+	const char			*myDirectory = NULL;
+	const char			*myReportPath = NULL;
+	FILE				*myReport = stdout;
+	long				myGigabytes = 0;
+	int					myIndex;
+	OSErr				myErr = noErr;
+
+	for (myIndex = 1; myIndex < theArgc; myIndex++) {
+		if ((strcmp(theArgv[myIndex], kUpdGigabytesSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myGigabytes = atol(theArgv[++myIndex]);
+		} else if ((strcmp(theArgv[myIndex], kUpdDirectorySwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myDirectory = theArgv[++myIndex];
+		} else if ((strcmp(theArgv[myIndex], kUpdReportSwitch) == 0) && (myIndex + 1 < theArgc)) {
+			myReportPath = theArgv[++myIndex];
+		} else if (strcmp(theArgv[myIndex], kUpdBenchmarkSwitch) != 0) {
+			fprintf(stderr, "usage: %s %s [%s <count>] [%s <directory>] [%s <file>]\n", theArgv[0], kUpdBenchmarkSwitch, kUpdGigabytesSwitch, kUpdDirectorySwitch, kUpdReportSwitch);
+			return(kUpdExitUsage);
+		}
+	}
+
+	if (myReportPath != NULL) {
+		myReport = fopen(myReportPath, "w");
+		if (myReport == NULL) {
+			fprintf(stderr, "cannot create report %s\n", myReportPath);
+			return(kUpdExitUsage);
+		}
+	}
+
+	myErr = QTUpd_RunBenchmark(myReport, myGigabytes, myDirectory);
+
+	if (myReport != stdout)
+		fclose(myReport);
+
+	return((myErr == noErr) ? kUpdExitSuccess : kUpdExitFailed);
+}
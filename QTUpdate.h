@@ -0,0 +1,84 @@
+//////////
+//
+//	File:		QTUpdate.h
+//
+//	Contains:	Portable functions for saving a changed movie atom into its movie file without rewriting the file.
+//				All utilities start with the prefix "QTUpd_".
+//
+//////////
+
+#pragma once
+
+#ifndef __QTUpdate__
+#define __QTUpdate__
+
+
+//////////
+//
+// header files
+//
+//////////
+
+#include "QTAtoms.h"
+
+
+//////////
+//
+// constants
+//
+//////////
+
+#define kUpdBenchmarkSwitch					"-updatebench"			// command-line switch that selects the movie-update benchmark
+#define kUpdGigabytesSwitch					"-gigabytes"			// size of the benchmark's (sparse) movie file
+#define kUpdDirectorySwitch					"-dir"					// where the benchmark writes its file
+#define kUpdReportSwitch					"-report"				// write the report to a file instead of stdout
+
+#define kUpdDefaultBenchmarkGigabytes		50
+#define kUpdMergeGap						32						// patch across runs of this many unchanged bytes
+
+// how QTUpd_UpdateMovieAtom saved the movie atom
+enum {
+	kUpdMethodUnchanged						= 0,					// nothing had changed
+	kUpdMethodPatched						= 1,					// the same size: just the bytes that changed
+	kUpdMethodInPlace						= 2,					// rewritten where it was, into free space that followed it
+	kUpdMethodAppended						= 3						// written at the end of the file; the old one is now free space
+};
+
+// exit codes returned by QTUpd_Main
+enum {
+	kUpdExitSuccess							= 0,
+	kUpdExitFailed							= 1,
+	kUpdExitUsage							= 2
+};
+
+
+//////////
+//
+// data types
+//
+//////////
+
+typedef struct QTUpdStatsRecord {
+	long					fMethod;				// one of the kUpdMethod constants
+	QTUInt64				fMovieOffset;			// where the movie atom is now
+	long					fWriteCount;
+	QTUInt64				fBytesWritten;
+	QTUInt64				fMicroseconds;
+} QTUpdStatsRecord, *QTUpdStatsPtr;
+
+
+//////////
+//
+// function prototypes
+//
+//////////
+
+OSErr						QTUpd_UpdateMovieAtom (const char *thePath, const void *theMovieAtom, UInt32 theSize, QTUpdStatsPtr theStats);
+const char *				QTUpd_GetMethodName (long theMethod);
+
+OSErr						QTUpd_RunBenchmark (FILE *theReport, long theGigabytes, const char *theDirectory);
+
+Boolean						QTUpd_IsUpdateCommandLine (int theArgc, char *theArgv[]);
+int							QTUpd_Main (int theArgc, char *theArgv[]);
+
+#endif	// __QTUpdate__